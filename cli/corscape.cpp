@@ -11,7 +11,9 @@
 //
 
 #include "humlib.h"
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 using namespace hum;
 using namespace std;
@@ -20,29 +22,29 @@ void   processFile      (HumdrumFile& infile, Options& options);
 void   printInputData   (vector<double>& x, vector<double>& y);
 void   printInputData   (vector<double>& x);
 void   extractData      (HumdrumFile& infile, vector<double>& x, int xindex, vector<double>&y, int yindex);
-bool   getCorrelation   (double& output, vector<double>& x, int xstart, vector<double>& y, int ystart, int len);
-bool   getCorrelation2  (double& output, vector<double>& x, int xstart, vector<double>& y);
 void   printRawAnalysis (vector<vector<double>>& analysis);
-void   doRowAnalysis    (vector<double>& row, int windowlen, vector<double>& x, vector<double>& y);
-void   doArchRowAnalysis(vector<double>& row, int windowlen, vector<double>& x);
-void   doCombRowAnalysis(vector<double>& row, int windowlen, vector<double>& x);
+void   doRowAnalysis    (vector<double>& row, int windowlen, CorrelationScape& scape);
+void   doArchRowAnalysis(vector<double>& row, int windowlen, CorrelationScape& scape);
+void   doCombRowAnalysis(vector<double>& row, int windowlen, CorrelationScape& scape);
+void   storeRowValues   (vector<double>& row);
 void   printCorrelationScape(vector<vector<double>>& correlations,
                          vector<double>& x, vector<double>& xsmooth,
                          vector<double>& y, vector<double>& ysmooth);
-void   printPixelRow    (ostream& out, vector<PixelColor>& row, int repeat, bool adjust = false);
 void   getPixelRow      (vector<PixelColor>& row, vector<double>& cor);
 void   getArch          (vector<double>& arch);
 void   getComb          (vector<double>& comb, int cycle);
-void   printInputPlot   (vector<double>& x, vector<double>& y, int cols, int crepeat, int rows);
-void   printInputPlot2  (vector<double>& x, vector<double>& y, int cols, int crepeat, int rows);
-void   printInputPlotSmooth(vector<double>& x, vector<double>& xsmooth, int cols,
-                         int crepeat, int plotrows);
+void   addInputPlot     (PixelImage& image, vector<double>& x, vector<double>& y,
+                         int cols, int crepeat, int rows);
+void   addInputPlot2    (PixelImage& image, vector<double>& x, vector<double>& y,
+                         int cols, int crepeat, int rows);
+void   addInputPlotSmooth(PixelImage& image, vector<double>& x, vector<double>& xsmooth,
+                         int cols, int crepeat, int plotrows);
 void   getMinMax        (double& minvalue, double& maxvalue, vector<double>& x,
                          vector<double>& y);
 int    scaleValue       (double input, double minvalue, double maxvalue, int maxout);
 void   storeDataInPlot  (vector<vector<int>>& plot, vector<double>& x, int xpoint,
 		                   double minvalue, double maxvalue, int crepeat);
-void   printColorMap    (int maxcols, int crepeat, int plotrows);
+void   addColorMap      (PixelImage& image, int maxcols, int crepeat, int plotrows);
 vector<double> smoothSequence(vector<double>& input);
 vector<double> unsmoothSequence(vector<double>& input);
 int    getColumnIndex   (HumdrumFile& infile, const string& query, int dvalue);
@@ -75,6 +77,9 @@ int main(int argc, char** argv) {
 	options.define("s|smooth=b", "smooth input data");
 	options.define("S|unsmooth=b", "unsmooth input data");
 	options.define("sf|smooth-factor=d:0.4", "smoothing factor");
+	options.define("j|jobs|threads=i:1", "number of threads for calculating the scape");
+	options.define("ascii=b", "write ASCII (P3) PPM image instead of binary (P6)");
+	options.define("png=b", "write PNG image instead of PPM");
 	options.process(argc, argv);
 	HumdrumFileStream instream(options);
 	HumdrumFile infile;
@@ -176,32 +181,53 @@ void processFile(HumdrumFile& infile, Options& options) {
 		return;
 	}
 
+	vector<double>& xdata = (smoothQ || unsmoothQ) ? xsmooth : x;
+	vector<double>& ydata = (smoothQ || unsmoothQ) ? ysmooth : y;
+	CorrelationScape scape;
+	if (singleQ) {
+		scape.setSequence(xdata);
+		if (combQ) {
+			scape.setCombCycle(options.getInteger("comb"));
+		}
+	} else {
+		scape.setSequences(xdata, ydata);
+	}
+
 	int tsize = (int)x.size();
 	vector<vector<double>> analysis;
 	analysis.resize(x.size()-1);
 	for (int i=0; i<tsize-1; i++) {
 		analysis.at(i).resize(i+1);
 		fill(analysis.at(i).begin(), analysis.at(i).end(), -123456789.0);
-		if (archQ) {
-			if (smoothQ || unsmoothQ) {
-				doArchRowAnalysis(analysis.at(i), tsize-i, xsmooth);
-			} else {
-				doArchRowAnalysis(analysis.at(i), tsize-i, x);
-			}
-		} else if (combQ) {
-			if (smoothQ || unsmoothQ) {
-				doCombRowAnalysis(analysis.at(i), tsize-i, xsmooth);
-			} else {
-				doCombRowAnalysis(analysis.at(i), tsize-i, x);
-			}
-		} else {
-			// Regular correlation plot comparing two sequences
-			if (smoothQ || unsmoothQ) {
-				doRowAnalysis(analysis.at(i), tsize-i, xsmooth, ysmooth);
+	}
+
+	// The rows are independent of each other, so they are shared
+	// among the threads (longest windows first).
+	int rowcount = tsize - 1;
+	atomic<int> next(0);
+	auto analyzeRows = [&]() {
+		int i;
+		while ((i = next++) < rowcount) {
+			if (archQ) {
+				doArchRowAnalysis(analysis[i], tsize-i, scape);
+			} else if (combQ) {
+				doCombRowAnalysis(analysis[i], tsize-i, scape);
 			} else {
-				doRowAnalysis(analysis.at(i), tsize-i, x, y);
+				// Regular correlation plot comparing two sequences
+				doRowAnalysis(analysis[i], tsize-i, scape);
 			}
 		}
+	};
+
+	int threadcount = min(max(options.getInteger("threads"), 1), max(rowcount, 1));
+	vector<thread> threads;
+	threads.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		threads.emplace_back(analyzeRows);
+	}
+	analyzeRows();
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
 	}
 
 	// Set the min an max row.  Make more efficient by not
@@ -241,92 +267,68 @@ void processFile(HumdrumFile& infile, Options& options) {
 
 //////////////////////////////
 //
-// doArchRowAnalysis --
+// doArchRowAnalysis -- Correlate the x sequence with an arch that has
+//     the length of the window.
 //
 
-void doArchRowAnalysis(vector<double>& row, int windowlen, vector<double>& x) {
+void doArchRowAnalysis(vector<double>& row, int windowlen, CorrelationScape& scape) {
 	vector<double> y(windowlen);
 	getArch(y);
-
-	for (int i=0; i<(int)row.size(); i++) {
-		double value;
-		int status;
-		status = getCorrelation2(value, x, i, y);
-		if (!status) {
-			cerr << "Error" << endl;
-			return;
-		}
-		if (Convert::isNaN(value)) {
-			// suppressing 0/0 cases (converting them to zeros).
-			// This will happen most likely at length-2 correlations, but
-			// can happen with vastly decreasing likelihood for larger
-			// correlations when comparing flat sequences that have a
-			// zero standard devaition.
-			row.at(i) = -0.0;
-		} else {
-			row.at(i) = value;
-		}
+	if (!scape.getRow(row, y)) {
+		cerr << "Error" << endl;
+		return;
 	}
+	storeRowValues(row);
 }
 
 
 
 //////////////////////////////
 //
-// doCombRowAnalysis --
+// doCombRowAnalysis -- Correlate the x sequence with a comb pattern.
 //
 
-void doCombRowAnalysis(vector<double>& row, int windowlen, vector<double>& x) {
-	vector<double> y(windowlen);
-	int cycle = options.getInteger("comb");
-	getComb(y, cycle);
+void doCombRowAnalysis(vector<double>& row, int windowlen, CorrelationScape& scape) {
+	if (!scape.getCombRow(row, windowlen)) {
+		cerr << "Error" << endl;
+		return;
+	}
+	storeRowValues(row);
+}
 
-	for (int i=0; i<(int)row.size(); i++) {
-		double value;
-		int status;
-		status = getCorrelation2(value, x, i, y);
-		if (!status) {
-			cerr << "Error" << endl;
-			return;
-		}
-		if (Convert::isNaN(value)) {
-			// suppressing 0/0 cases (converting them to zeros).
-			// This will happen most likely at length-2 correlations, but
-			// can happen with vastly decreasing likelihood for larger
-			// correlations when comparing flat sequences that have a
-			// zero standard devaition.
-			row.at(i) = -0.0;
-		} else {
-			row.at(i) = value;
-		}
+
+
+//////////////////////////////
+//
+// doRowAnalysis -- Correlate windows of the x and y sequences.
+//
+
+void doRowAnalysis(vector<double>& row, int windowlen, CorrelationScape& scape) {
+	if (!scape.getRow(row, windowlen)) {
+		cerr << "Error" << endl;
+		return;
 	}
+	storeRowValues(row);
 }
 
 
 
 //////////////////////////////
 //
-// doRowAnalysis --
+// storeRowValues -- Apply the --negate option to a row of correlations.
 //
 
-void doRowAnalysis(vector<double>& row, int windowlen, vector<double>& x, vector<double>& y) {
+void storeRowValues(vector<double>& row) {
 	for (int i=0; i<(int)row.size(); i++) {
-		double value;
-		int status;
-		status = getCorrelation(value, x, i, y, i, windowlen);
-		if (!status) {
-			cerr << "Error" << endl;
-			return;
-		}
-		if (Convert::isNaN(value)) {
+		if (Convert::isNaN(row[i])) {
 			// suppressing 0/0 cases (converting them to zeros).
 			// This will happen most likely at length-2 correlations, but
 			// can happen with vastly decreasing likelihood for larger
 			// correlations when comparing flat sequences that have a
 			// zero standard devaition.
-			row.at(i) = -0.0;
+			row[i] = -0.0;
 		} else {
-			row.at(i) = value;
+			row[i] *= Negate;
 		}
 	}
 }
@@ -359,83 +361,6 @@ void printRawAnalysis(vector<vector<double>>& analysis) {
 
 
 
-//////////////////////////////
-//
-// getCorrelation -- return value is status: true if successful; false otherwise.
-//
-
-bool getCorrelation(double& output, vector<double>& x, int xstart, vector<double>& y, int ystart, int len) {
-	if ((xstart == 0) && (len == (int)x.size())) {
-		if ((ystart == 0) && (len == (int)y.size())) {
-			output = Convert::pearsonCorrelation(x, y);
-			output *= Negate;
-			return 1;
-		}
-	}
-
-	if (xstart + len > (int)x.size()) {
-		cerr << "Error: Cannot go beyond end of vector x: " << xstart + len << " max is " << ((int)x.size()) << endl;
-		cerr << "XSTART " << xstart << " LEN " << len << " vector size: " << x.size() << endl;
-		return 0;
-	}
-
-	if (ystart + len > (int)y.size()) {
-		cerr << "Error: Cannot go beyond end of vector y: " << ystart + len << " max is " << ((int)y.size()) << endl;
-		cerr << "YSTART " << ystart << " LEN " << len << " vector size: " << y.size() << endl;
-		return 0;
-	}
-
-	auto x1 = x.begin() + xstart;
-	auto x2 = x.begin() + xstart + len;
-	auto y1 = y.begin() + ystart;
-	auto y2 = y.begin() + xstart + len;
-
-	vector<double> xx(x1, x2);
-	vector<double> yy(y1, y2);
-
-	output = Convert::pearsonCorrelation(xx, yy);
-	output *= Negate;
-	return 1;
-}
-
-
-
-//////////////////////////////
-//
-// getCorrelation2 -- return value is status: true if successful; false otherwise.  This version
-//    is used to correlate a subsequence of x with the entire y sequence (for the arch analysis).
-//
-
-bool getCorrelation2(double& output, vector<double>& x, int xstart, vector<double>& y) {
-	int ystart = 0;
-	int len = (int)y.size();
-
-	if ((xstart == 0) && (len == (int)x.size())) {
-		if ((ystart == 0) && (len == (int)y.size())) {
-			output = Convert::pearsonCorrelation(x, y);
-			output *= Negate;
-			return 1;
-		}
-	}
-
-	if (xstart + len > (int)x.size()) {
-		cerr << "Error: Cannot go beyond end of vector x: " << xstart + len << " max is " << ((int)x.size()) << endl;
-		cerr << "XSTART " << xstart << " LEN " << len << endl;
-		return 0;
-	}
-
-	auto x1 = x.begin() + xstart;
-	auto x2 = x.begin() + xstart + len;
-
-	vector<double> xx(x1, x2);
-
-	output = Convert::pearsonCorrelation(xx, y);
-	output *= Negate;
-	return 1;
-}
-
-
-
 //////////////////////////////
 //
 // extractData --
@@ -614,7 +539,6 @@ void printCorrelationScape(vector<vector<double>>& correlations,
 		vector<double>& y, vector<double>& ysmooth) {
 	int rrepeat = 1;
 	int crepeat = 2;
-	int maxrows = (int)correlations.size();
 	int maxcols = (int)correlations.back().size();
 
 	bool archQ = options.getBoolean("arch");
@@ -630,13 +554,8 @@ void printCorrelationScape(vector<vector<double>>& correlations,
 	if (plotrows < 100) {
 		plotrows = 100;
 	}
-	int prows = plotrows;
-	if (plot2Q) {
-		prows *= 2;
-	}
 	if (!(plotQ || plot2Q)) {
 		plotrows = 0;
-		prows = 0;
 	}
 	if (plotQ) {
 		// force the width of the plot to match the full sequence length
@@ -649,59 +568,63 @@ void printCorrelationScape(vector<vector<double>>& correlations,
 		maprows = 0;
 	}
 
-	cout << "P3\n";
-	cout << (crepeat * maxcols) << " " << (rrepeat * maxrows + prows + maprows) << "\n";
-	cout << "255\n";
-
+	PixelImage image;
 	vector<PixelColor> row(maxcols);
 
 	for (int i=0; i<(int)correlations.size(); i++) {
 		getPixelRow(row, correlations[i]);
-		for (int j=0; j<rrepeat; j++) {
-			printPixelRow(cout, row, crepeat, !(i%2));
-		}
+		// Shift every other row by one pixel to center the odd rows:
+		image.addRow(row, crepeat, rrepeat, (i % 2) ? 0 : 1);
 	}
 
 	if (colormapQ) {
-		printColorMap(maxcols, crepeat, maprows);
+		addColorMap(image, maxcols, crepeat, maprows);
 	}
 	if (plotQ) {
 		if (singleQ && (smoothQ || unsmoothQ)) {
-			printInputPlotSmooth(x, xsmooth, maxcols, crepeat, plotrows);
+			addInputPlotSmooth(image, x, xsmooth, maxcols, crepeat, plotrows);
 		} else {
-			printInputPlot(x, y, maxcols, crepeat, plotrows);
+			addInputPlot(image, x, y, maxcols, crepeat, plotrows);
 		}
 	} else if (plot2Q) {
 		if (singleQ && !(smoothQ || unsmoothQ)) {
-			printInputPlot(x, y, maxcols, crepeat, plotrows);
+			addInputPlot(image, x, y, maxcols, crepeat, plotrows);
 		} else if (singleQ && (smoothQ || unsmoothQ)) {
 			vector<double> empty;
-			printInputPlotSmooth(x, empty, maxcols, crepeat, plotrows);
-			printInputPlotSmooth(empty, xsmooth, maxcols, crepeat, plotrows);
+			addInputPlotSmooth(image, x, empty, maxcols, crepeat, plotrows);
+			addInputPlotSmooth(image, empty, xsmooth, maxcols, crepeat, plotrows);
 		} else {
-			printInputPlot2(x, y, maxcols, crepeat, plotrows);
+			addInputPlot2(image, x, y, maxcols, crepeat, plotrows);
 		}
 	}
+
+	if (options.getBoolean("png")) {
+		image.writePng(cout);
+	} else if (options.getBoolean("ascii")) {
+		image.writePpm3(cout);
+	} else {
+		image.writePpm6(cout);
+	}
 }
 
 
 
 //////////////////////////////
 //
-// printColorMap --
+// addColorMap -- Add the color map to the bottom of the image.
 //
 
-void printColorMap(int maxcols, int crepeat, int plotrows) {
+void addColorMap(PixelImage& image, int maxcols, int crepeat, int plotrows) {
+	if (plotrows <= 0) {
+		return;
+	}
 	double coolest = options.getDouble("coolest");
-	PixelColor pc;
 	int colval = maxcols * crepeat;
-	for (int i=0; i<plotrows; i++) {
-		for (int j=0; j<colval; j++) {
-			pc.setHue((double)(colval - j - 1) / colval * coolest);
-			cout << pc << " ";
-		}
-		cout << endl;
+	vector<PixelColor> row(colval);
+	for (int j=0; j<colval; j++) {
+		row[j].setHue((double)(colval - j - 1) / colval * coolest);
 	}
+	image.addRow(row, 1, plotrows);
 }
 
 
@@ -774,24 +697,25 @@ int scaleValue(double input, double minvalue, double maxvalue, int maxout) {
 
 //////////////////////////////
 //
-// printInputPlot2 -- Print two separate plots of data.
+// addInputPlot2 -- Add two separate plots of data to the image.
 //
 
-void printInputPlot2(vector<double>& x, vector<double>& y, int cols,
-		int crepeat, int rows) {
+void addInputPlot2(PixelImage& image, vector<double>& x, vector<double>& y,
+		int cols, int crepeat, int rows) {
 	vector<double> empty;
-	printInputPlot(x, empty, cols, crepeat, rows);
-	printInputPlot(empty, y, cols, crepeat, rows);
+	addInputPlot(image, x, empty, cols, crepeat, rows);
+	addInputPlot(image, empty, y, cols, crepeat, rows);
 }
 
 
-void printInputPlotSmooth(vector<double>& x, vector<double>& xsmooth, int cols,
-	int crepeat, int rows) {
-	printInputPlot(x, xsmooth, cols, crepeat, rows);
+void addInputPlotSmooth(PixelImage& image, vector<double>& x,
+		vector<double>& xsmooth, int cols, int crepeat, int rows) {
+	addInputPlot(image, x, xsmooth, cols, crepeat, rows);
 }
 
 
-void printInputPlot(vector<double>& x, vector<double>& y, int cols, int crepeat, int rows) {
+void addInputPlot(PixelImage& image, vector<double>& x, vector<double>& y,
+		int cols, int crepeat, int rows) {
 	if (crepeat != 2) {
 		// requiring crepeat to be 2
 		return;
@@ -818,42 +742,43 @@ void printInputPlot(vector<double>& x, vector<double>& y, int cols, int crepeat,
 		storeDataInPlot(plot, y, ypoint, minvalue, maxvalue, crepeat);
 	}
 
+	vector<PixelColor> row(cols * crepeat);
 	for (int i=0; i<rows; i++) {
 		for (int j=0; j<cols * crepeat; j++) {
 			switch (plot[i][j]) {
 				case 1:
-					cout << "0 0 250 ";
+					row[j].setColor(0, 0, 250);
 					break;
 				case 101:
 				case 201:
-					cout << "200 200 250 ";
+					row[j].setColor(200, 200, 250);
 					break;
 				case 102:
 				case 202:
-					cout << "250 200 200 ";
+					row[j].setColor(250, 200, 200);
 					break;
 				case 103:
 				case 203:
 				case 303:
 				case 403:
-					cout << "240 200 240 ";
+					row[j].setColor(240, 200, 240);
 					break;
 				case 2:
-					cout << "250 0 0 ";
+					row[j].setColor(250, 0, 0);
 					break;
 				case 3:
-					cout << "220 0 220 ";
+					row[j].setColor(220, 0, 220);
 					break;
 				case 0:
-					cout << "255 255 255 ";
+					row[j].setColor(255, 255, 255);
 					break;
 				default:
 					cerr << "UNKNOWN COLOR CODE: " << (int)plot[i][j] << endl;
 					// Some problem: unknown pixel type
-					cout << "0 0 0 ";
+					row[j].setColor(0, 0, 0);
 			}
 		}
-		cout << endl;
+		image.addRow(row);
 	}
 }
 
@@ -938,34 +863,6 @@ void getPixelRow(vector<PixelColor>& row, vector<double>& cor) {
 
 
 
-//////////////////////////////
-//
-// printPixelRow --
-//
-
-void printPixelRow(ostream& out, vector<PixelColor>& row, int repeat, bool adjust) {
-	for (int i=0; i<(int)row.size(); i++) {
-		int newrepeat = repeat;
-		if (adjust) {
-			if (i == 0) {
-				newrepeat = repeat + 1;
-			}
-			if (i == (int)row.size() - 1) {
-				newrepeat = repeat - 1;
-			}
-			if (newrepeat < 0) {
-				newrepeat = 0;
-			}
-		}
-		for (int j=0; j<newrepeat; j++) {
-			out << row[i] << ' ';
-		}
-	}
-	out << "\n";
-}
-
-
-
 //////////////////////////////
 //
 // getArch -- return a half-cycle sine wave. getArch -- return a half-cycle sinewave.
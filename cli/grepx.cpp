@@ -12,7 +12,7 @@
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_grep)
+LINE_STREAM_INTERFACE(Tool_grep)
 
 
 
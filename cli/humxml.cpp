@@ -9,7 +9,8 @@
 //
 // Description:   Reveal data structure of Humdrum file and internal parameters.
 //                Optionally run various analyses of the data to calculate
-//                content-based parameters.
+//                content-based parameters.  Output is XML, or JSON with
+//                the -j option.
 //
 
 #include "humlib.h"
@@ -28,6 +29,11 @@ int main(int argc, char **argv) {
 	options.define("t|ties=b",             "analyze ties");
 	options.define("x|text-repetitions=b", "analyze text repetitions");
 
+	// Output options:
+	options.define("j|json=b",             "print analyzed structure as JSON");
+	options.define("f|fields=s",           "JSON content: lines,tokens,links,strands,rhythm,parameters");
+	options.define("c|compact=b",          "print compact JSON without indentation");
+
 	// Processing not run automatically with -A option:
 
 	options.process(argc, argv);
@@ -96,7 +102,12 @@ int main(int argc, char **argv) {
 		infile.analyzeTextRepetition();
 	}
 
-	infile.printXml();
+	if (options.getBoolean("json")) {
+		string indent = options.getBoolean("compact") ? "" : "\t";
+		infile.printJson(cout, options.getString("fields"), indent);
+	} else {
+		infile.printXml();
+	}
 }
 
 
@@ -29,31 +29,31 @@ int main(int argc, char** argv) {
 	Options options;
 	options.define("x|columns=i:4", "Number of columns in image");
 	options.define("y|rows=i:4", "Number of rows in image");
+	options.define("ascii=b", "write ASCII (P3) PPM image instead of binary (P6)");
+	options.define("png=b", "write PNG image instead of PPM");
 	options.process(argc, argv);
 
 	int rows = options.getInteger("rows");
 	int cols = options.getInteger("columns");
 
-	vector<vector<PixelColor>> image(rows);
-	for (int y=0; y<(int)image.size(); y++) {
-			image[y].resize(cols);
-			for (int x=0; x<(int)image[y].size(); x++) {
-				image[y][x].setRedF((double)y/rows);
-				image[y][x].setBlueF((double)x/cols);
+	PixelImage image(cols, rows);
+	PixelColor color;
+	for (int y=0; y<image.getRowCount(); y++) {
+			for (int x=0; x<image.getWidth(); x++) {
+				color.setRedF((double)y/rows);
+				color.setGreen(0);
+				color.setBlueF((double)x/cols);
+				image.setPixel(y, x, color);
 			}
 	}
 
-	// Output image header:
-	cout << "P3" << endl;
-	cout << cols << " " << rows << endl;
-	cout << 255 << endl;
-
-	// Output image pixels:
-	for (int y=0; y<(int)image.size(); y++) {
-			for (int x=0; x<(int)image[y].size(); x++) {
-				cout << image[y][x] << " ";
-			}
-			cout << endl;
+	// Output image:
+	if (options.getBoolean("png")) {
+		image.writePng(cout);
+	} else if (options.getBoolean("ascii")) {
+		image.writePpm3(cout);
+	} else {
+		image.writePpm6(cout);
 	}
 
 	return 0;
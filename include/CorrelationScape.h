@@ -0,0 +1,107 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 18:41:26 PDT 2026
+// Last Modified: Sat Oct 17 18:41:26 PDT 2026
+// Filename:      CorrelationScape.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/CorrelationScape.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Windowed Pearson correlations for correlation scapes.
+//                Running sums of the input sequences are stored so that
+//                the correlation of any window of two sequences can be
+//                calculated in constant time.  A window of one sequence
+//                can also be correlated with an arbitrary pattern (such as
+//                the arch for corscape --arch), or with a comb pattern,
+//                which uses sums over every n-th value of the sequence.
+//
+
+#ifndef _CORRELATIONSCAPE_H_INCLUDED
+#define _CORRELATIONSCAPE_H_INCLUDED
+
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class CorrelationScape {
+	public:
+		              CorrelationScape  (void);
+		              CorrelationScape  (const std::vector<double>& x,
+		                                 const std::vector<double>& y);
+
+		void          clear             (void);
+		void          setSequences      (const std::vector<double>& x,
+		                                 const std::vector<double>& y);
+		void          setSequence       (const std::vector<double>& x);
+		void          setCombCycle      (int cycle);
+		int           getSize           (void) const { return m_size; }
+		int           getCombCycle      (void) const { return m_cycle; }
+
+		// The correlation functions return NAN if either window has no
+		// variation (the 0/0 case of Convert::pearsonCorrelation).
+		double        getCorrelation    (int start, int length) const;
+		double        getCorrelation    (int start, const std::vector<double>& pattern) const;
+		double        getCombCorrelation(int start, int length) const;
+
+		// Fill a row of the scape: row[i] is the correlation of the window
+		// starting at i.  Returns false if the windows do not fit into the
+		// sequences.  Rows can be calculated in separate threads once the
+		// sequences (and comb cycle) have been set.
+		bool          getRow            (std::vector<double>& row, int length) const;
+		bool          getRow            (std::vector<double>& row,
+		                                 const std::vector<double>& pattern) const;
+		bool          getCombRow        (std::vector<double>& row, int length) const;
+
+	protected:
+		static void   prepareSums       (std::vector<double>& sum,
+		                                 std::vector<double>& sumsq,
+		                                 std::vector<double>& centered,
+		                                 const std::vector<double>& input);
+		static void   preparePattern    (std::vector<double>& centered,
+		                                 double& variance, double& tolerance,
+		                                 const std::vector<double>& pattern);
+		void          prepareComb       (double& sum, double& variance,
+		                                 double& tolerance, int length) const;
+		double        getVariance       (const std::vector<double>& sum,
+		                                 const std::vector<double>& sumsq,
+		                                 int start, int length,
+		                                 double& tolerance) const;
+		double        getPatternCorrelation(int start,
+		                                 const std::vector<double>& pattern,
+		                                 double variance, double tolerance) const;
+		double        getCombCorrelation(int start, int length, double patternsum,
+		                                 double variance, double tolerance) const;
+		static double correlate         (double covariance,
+		                                 double xvariance, double xtolerance,
+		                                 double yvariance, double ytolerance);
+
+	private:
+		int                 m_size  = 0;
+		int                 m_cycle = 0;
+
+		// Input sequences minus their means, and their running sums
+		// (m_sumx[i] is the sum of the first i values):
+		std::vector<double> m_x;
+		std::vector<double> m_sumx;
+		std::vector<double> m_sumxx;
+		std::vector<double> m_y;
+		std::vector<double> m_sumy;
+		std::vector<double> m_sumyy;
+		std::vector<double> m_sumxy;
+
+		// Running sums of every m_cycle-th value of m_x for comb patterns
+		// (m_combsum[i] = m_x[i] + m_combsum[i-m_cycle]):
+		std::vector<double> m_combsum;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _CORRELATIONSCAPE_H_INCLUDED */
+
+
+
@@ -13,6 +13,8 @@
 #ifndef _HUMADDRESS_H_INCLUDED
 #define _HUMADDRESS_H_INCLUDED
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 namespace hum {
@@ -50,16 +52,29 @@ class HumAddress {
 		void                setOwner          (HLp aLine);
 		void                setFieldIndex     (int fieldlindex);
 		void                setSpineInfo      (const std::string& spineinfo);
+		void                shareSpineInfo    (const HumAddress& address);
 		void                setTrack          (int aTrack, int aSubtrack);
 		void                setTrack          (int aTrack);
 		void                setSubtrack       (int aSubtrack);
 		void                setSubtrackCount  (int aSubtrack);
+		void                releaseSpineInfo  (void);
 
 	private:
 
-		// fieldindex: This is the index of the token in the HumdrumLine
-		// which owns this token.
-		int m_fieldindex;
+		// SpineInfo: A spine info string which is shared by the addresses
+		// of the tokens in a spine between spine manipulators (see
+		// shareSpineInfo()).  It is deleted with the last address using it.
+		struct SpineInfo {
+			std::string      m_text;
+			std::atomic<int> m_refs;
+		};
+
+		// The address is stored in every token, so the fields are packed:
+		// the owner and spine info pointers first, then the field index,
+		// and then the track numbers (which are limited to 1000).
+
+		// owner: This is the line which manages the given token.
+		HLp          m_owner;
 
 		// spining: This is the spine position of the token. A simple spine
 		// position is an integer, starting with "1" for the first spine
@@ -71,18 +86,24 @@ class HumAddress {
 		// But in this case there is a spine info simplification which will
 		// convert "(#)a (#)b" into "#" where # is the original spine number.
 		// Other more complicated mergers may be simplified in the future.
-		std::string m_spining;
+		// The string is shared by the tokens in the same part of a spine,
+		// and m_spining is NULL if the spine info is empty.
+		SpineInfo* m_spining;
+
+		// fieldindex: This is the index of the token in the HumdrumLine
+		// which owns this token.
+		int m_fieldindex;
 
 		// track: This is the track number of the spine.  It is the first
 		// number found in the spineinfo string.
-		int m_track;
+		int16_t m_track;
 
 		// subtrack: This is the subtrack number for the spine.  When a spine
 		// is not split, it will be 0, if the spine has been split with *^,
 		// then the left-subspine will be in subtrack 1 and the right-spine
 		// will be subtrack 2.  If subspines are exchanged with *x, then their
 		// subtrack assignments will also change.
-		int m_subtrack;
+		int16_t m_subtrack;
 
 		// subtrackcount: The number of currently active subtracks tokens
 		// on the owning HumdrumLine (in the same track).  The subtrack range
@@ -91,9 +112,6 @@ class HumAddress {
 		// no tokens in the track (such as for global comments).
 		int m_subtrackcount;
 
-		// owner: This is the line which manages the given token.
-		HLp          m_owner;
-
 	friend class HumdrumToken;
 	friend class HumdrumLine;
 	friend class HumdrumFile;
@@ -106,10 +106,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 namespace hum {
 
 class HumNum;
+class HumJsonWriter;
 class HumdrumToken;
 typedef HumdrumToken* HTp;
 
@@ -129,8 +131,13 @@ typedef std::map<std::string, HumParameter> MapKV;
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
+		               HumHash             (HumHash&& hash) noexcept;
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+		HumHash&       operator=           (HumHash&& hash) noexcept;
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -233,6 +240,8 @@ class HumHash {
 		                                    const std::string& indent = "\t");
 		std::ostream&  printXmlAsGlobal    (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
+		void           printJson           (HumJsonWriter& json,
+		                                    const char* key = "parameters");
 
 		void           setOrigin           (const std::string& key,
 		                                    HumdrumToken* tok);
@@ -256,6 +265,8 @@ class HumHash {
 		                                    const std::string& ns2,
 		                                    const std::string& parameter) const;
 
+		void           remapTokens         (const std::unordered_map<HTp, HTp>& tokenmap);
+
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
@@ -15,6 +15,7 @@
 #define _HUMINSTRUMENT_H_INCLUDED
 
 #include <stdlib.h>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -49,10 +50,15 @@ class HumInstrument {
 
 	private:
 		int                            m_index;
-		static std::vector<_HumInstrument>  m_data;
-		static int                     m_classcount;
+
+		// m_data: instrument table, shared with other objects until it
+		// is changed with setGM().
+		std::shared_ptr<std::vector<_HumInstrument>> m_data;
+
+		explicit    HumInstrument       (std::shared_ptr<std::vector<_HumInstrument>> data);
 
 	protected:
+		static std::shared_ptr<std::vector<_HumInstrument>> getDefaultData(void);
 		void       initialize          (void);
 		void       afi                 (const char* humdrum_name, int midinum,
 		                                const char* EN_name);
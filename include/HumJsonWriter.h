@@ -0,0 +1,103 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 23:12:04 PDT 2026
+// Last Modified: Sat Oct 17 23:12:04 PDT 2026
+// Filename:      HumJsonWriter.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumJsonWriter.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Streaming JSON writer used by HumdrumFile::printJson()
+//                and related functions.  Values are written directly into
+//                a fixed output buffer which is flushed to the output
+//                stream when full, so no intermediate strings are
+//                created for escaping, numbers or token IDs.  Commas and
+//                indentation are inserted automatically from the nesting
+//                state.  An empty indent string gives compact output.
+//
+
+#ifndef _HUMJSONWRITER_H_INCLUDED
+#define _HUMJSONWRITER_H_INCLUDED
+
+#include "HumNum.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumJsonWriter {
+	public:
+		// Selectable content for HumdrumFile::printJson():
+		enum {
+			FIELD_LINES      = 1 << 0,  // line type, text and references
+			FIELD_TOKENS     = 1 << 1,  // tokens on each line
+			FIELD_LINKS      = 1 << 2,  // next/previous token IDs
+			FIELD_STRANDS    = 1 << 3,  // strand list and token strand index
+			FIELD_RHYTHM     = 1 << 4,  // durations and timestamps
+			FIELD_PARAMETERS = 1 << 5,  // HumHash and linked parameters
+			FIELD_ALL        = (1 << 6) - 1
+		};
+
+		                HumJsonWriter   (std::ostream& out,
+		                                 const std::string& indent = "\t");
+		               ~HumJsonWriter   ();
+
+		void            beginObject     (void);
+		void            endObject       (void);
+		void            beginArray      (void);
+		void            endArray        (void);
+
+		void            writeKey        (const char* key);
+		void            writeKey        (const std::string& key);
+		void            writeString     (const std::string& value);
+		void            writeString     (const char* value);
+		void            writeInt        (int value);
+		void            writeBool       (bool value);
+		void            writeNull       (void);
+		void            writeNumber     (HumNum value);
+		void            writeLineId     (int line);
+		void            writeTokenId    (int line, int field);
+		void            flush           (void);
+
+		// Prefix for line and token IDs (see HumdrumFileBase::getXmlIdPrefix):
+		void            setIdPrefix     (const std::string& prefix) { m_prefix = prefix; }
+		const std::string& getIdPrefix  (void) const { return m_prefix; }
+
+		static int      parseFields     (const std::string& list);
+
+	protected:
+		void            separate        (void);
+		void            newline         (void);
+		void            put             (char ch);
+		void            put             (const char* text, size_t count);
+		void            putInt          (int value);
+		void            putEscaped      (const char* text, size_t count);
+
+	private:
+		std::ostream&     m_out;
+		std::string       m_indent;
+		std::string       m_prefix;
+		std::vector<char> m_buffer;
+		size_t            m_used    = 0;
+
+		// One entry for each open object/array: true if nothing has been
+		// written in it yet.
+		std::vector<bool> m_empty;
+
+		// true if the next value follows a key on the same line:
+		bool              m_afterKey = false;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMJSONWRITER_H_INCLUDED */
+
+
+
@@ -0,0 +1,227 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:48:03 PDT 2026
+// Last Modified: Sat Oct 17 19:48:03 PDT 2026
+// Filename:      HumKernNote.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumKernNote.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Single-pass lexer for **kern tokens.  HumKernToken reads
+//                a token once and stores a compact HumKernNote record for
+//                each chord note (space-separated subtoken), along with the
+//                token-level information used by the Convert::isKern*(),
+//                Convert::hasKern*() and Convert::getKern*ElisionLevel()
+//                scanners.  Analyses that read many tokens reuse one
+//                HumKernToken and call lex() for each token.
+//
+
+#ifndef _HUMKERNNOTE_H_INCLUDED
+#define _HUMKERNNOTE_H_INCLUDED
+
+#include "HumNum.h"
+
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumKernNote {
+	public:
+		// Articulation bitmasks (see getArticulations()):
+		enum {
+			ART_STACCATO      = 0x0001,  // '
+			ART_STACCATISSIMO = 0x0002,  // `
+			ART_ACCENT        = 0x0004,  // ^
+			ART_MARCATO       = 0x0008,  // ^^
+			ART_TENUTO        = 0x0010,  // ~
+			ART_FERMATA       = 0x0020,  // ;
+			ART_HARMONIC      = 0x0040,  // o
+			ART_ARPEGGIO      = 0x0080,  // :
+			ART_UPBOW         = 0x0100,  // v
+			ART_DOWNBOW       = 0x0200,  // u
+			ART_BREATH        = 0x0400,  // ,
+			ART_PIZZICATO     = 0x0800,  // "
+			ART_SFORZANDO     = 0x1000   // z
+		};
+
+		// Ornament bitmasks (see getOrnaments()):
+		enum {
+			ORN_TRILL_MINOR   = 0x01,  // t
+			ORN_TRILL_MAJOR   = 0x02,  // T
+			ORN_MORDENT_MINOR = 0x04,  // m
+			ORN_MORDENT_MAJOR = 0x08,  // M
+			ORN_LOWER_MINOR   = 0x10,  // w (inverted mordent)
+			ORN_LOWER_MAJOR   = 0x20,  // W (inverted mordent)
+			ORN_TURN          = 0x40,  // S
+			ORN_INVERTED_TURN = 0x80   // $
+		};
+
+		                HumKernNote         (void) {}
+
+		// Location of the subtoken in the token text:
+		int             getStart            (void) const { return m_start; }
+		int             getLength           (void) const { return m_length; }
+		std::string     getText             (const std::string& token) const;
+		bool            contains            (const std::string& token,
+		                                     const std::string& pattern) const;
+
+		// Pitch: a rest marker ('r') is ignored, so pitched rests and
+		// unsounding notes in chords have a pitch.  The values are the
+		// same as Convert::kernToBase40() and Convert::kernToBase7() for
+		// the subtoken (with 'r' removed).
+		bool            hasPitch            (void) const { return m_diatonic >= 0; }
+		int             getBase40           (void) const;
+		int             getBase7            (void) const;
+		int             getDiatonicPC       (void) const { return m_diatonic; }
+		int             getOctave           (void) const;
+		int             getAccidentalCount  (void) const { return m_accidentals; }
+		char            getAccidentalMark   (void) const { return m_accidentalMark; }
+		bool            hasExplicitNatural  (void) const { return m_flags & FLAG_NATURAL; }
+		bool            isAccidentalHidden  (void) const;
+
+		bool            isRest              (void) const { return m_flags & FLAG_REST; }
+		bool            isUnpitched         (void) const { return m_flags & FLAG_UNPITCHED; }
+		bool            isNote              (void) const;
+		bool            isInvisible         (void) const { return m_flags & FLAG_INVISIBLE; }
+
+		// Rhythm:
+		HumNum          getDuration         (void) const;
+		int             getRhythm           (void) const { return m_rhythm; }
+		int             getRhythmDenominator(void) const { return m_rhythmDen; }
+		int             getDots             (void) const { return m_dots; }
+		bool            isGrace             (void) const { return m_flags & FLAG_GRACE; }
+
+		// Ties:
+		bool            isTieStart          (void) const { return m_flags & FLAG_TIE_START; }
+		bool            isTieContinue       (void) const { return m_flags & FLAG_TIE_CONTINUE; }
+		bool            isTieEnd            (void) const { return m_flags & FLAG_TIE_END; }
+		bool            isSecondaryTiedNote (void) const;
+
+		// Slurs, phrases and beams:
+		int             getSlurStartCount   (void) const { return m_slurStarts; }
+		int             getSlurEndCount     (void) const { return m_slurEnds; }
+		int             getPhraseStartCount (void) const { return m_phraseStarts; }
+		int             getPhraseEndCount   (void) const { return m_phraseEnds; }
+		int             getBeamStartCount   (void) const { return m_beamStarts; }
+		int             getBeamEndCount     (void) const { return m_beamEnds; }
+		int             getHookCount        (void) const { return m_hooks; }
+
+		char            getStemDirection    (void) const { return m_stem; }
+		int             getArticulations    (void) const { return m_articulations; }
+		bool            hasArticulation     (int mask) const { return (m_articulations & mask) != 0; }
+		int             getOrnaments        (void) const { return m_ornaments; }
+		bool            hasOrnament         (int mask) const { return (m_ornaments & mask) != 0; }
+
+	protected:
+		enum {
+			FLAG_REST         = 0x0001,
+			FLAG_UNPITCHED    = 0x0002,
+			FLAG_GRACE        = 0x0004,
+			FLAG_TIE_START    = 0x0008,
+			FLAG_TIE_CONTINUE = 0x0010,
+			FLAG_TIE_END      = 0x0020,
+			FLAG_NATURAL      = 0x0040,
+			FLAG_INVISIBLE    = 0x0080,
+			FLAG_HIDDEN_ACCID = 0x0100,
+			FLAG_MIXED_CASE   = 0x0200
+		};
+
+	private:
+		int            m_start          = 0;
+		int            m_length         = 0;
+		int            m_rhythm         = -1;  // -1 = no rhythm, 0 = breve or longer
+		int            m_rhythmDen      = 1;   // for rational rhythms (3%2)
+		unsigned short m_flags          = 0;
+		unsigned short m_articulations  = 0;
+		signed char    m_diatonic       = -1;  // 0=C ... 6=B; -1 = no pitch
+		signed char    m_octave         = 0;
+		signed char    m_accidentals    = 0;
+		char           m_accidentalMark = '\0';
+		unsigned char  m_ornaments      = 0;
+		unsigned char  m_dots           = 0;
+		unsigned char  m_zeros          = 0;   // 1 = breve, 2 = long, 3 = maxima
+		unsigned char  m_slurStarts     = 0;
+		unsigned char  m_slurEnds       = 0;
+		unsigned char  m_phraseStarts   = 0;
+		unsigned char  m_phraseEnds     = 0;
+		unsigned char  m_beamStarts     = 0;
+		unsigned char  m_beamEnds       = 0;
+		unsigned char  m_hooks          = 0;
+		char           m_stem           = '\0';
+
+	friend class HumKernToken;
+};
+
+
+
+class HumKernToken {
+	public:
+		                   HumKernToken     (void) {}
+		                   HumKernToken     (const std::string& token);
+
+		void               clear            (void);
+		void               lex              (const std::string& token);
+
+		// Chord notes (one for each subtoken, including empty subtokens
+		// caused by extra spaces, as in HumdrumToken::getSubtokenCount()):
+		int                getNoteCount     (void) const { return (int)m_notes.size(); }
+		const HumKernNote& getNote          (int index) const;
+
+		// Token-level information, matching the Convert::isKern*() and
+		// Convert::hasKern*() functions for the whole token:
+		bool               hasRest          (void) const { return m_hasRest; }
+		bool               hasPitch         (void) const { return m_hasPitch; }
+		bool               isNote           (void) const { return m_hasPitch && !m_hasRest; }
+		bool               isSecondaryTiedNote(void) const { return isNote() && m_hasTieContinuation; }
+		bool               isNoteAttack     (void) const { return isNote() && !m_hasTieContinuation; }
+		char               getStemDirection (void) const { return m_stem; }
+
+		int                getSlurStartCount  (void) const { return getMarkerCount('('); }
+		int                getSlurEndCount    (void) const { return getMarkerCount(')'); }
+		int                getPhraseStartCount(void) const { return getMarkerCount('{'); }
+		int                getPhraseEndCount  (void) const { return getMarkerCount('}'); }
+		int                getBeamStartCount  (void) const { return getMarkerCount('L'); }
+		int                getBeamEndCount    (void) const { return getMarkerCount('J'); }
+
+		// Number of '&' characters before the (index+1)-th marker in the
+		// token, or -1 if there is no such marker:
+		int                getSlurStartElisionLevel  (int index = 0) const { return getElisionLevel('(', index); }
+		int                getSlurEndElisionLevel    (int index = 0) const { return getElisionLevel(')', index); }
+		int                getPhraseStartElisionLevel(int index = 0) const { return getElisionLevel('{', index); }
+		int                getPhraseEndElisionLevel  (int index = 0) const { return getElisionLevel('}', index); }
+		int                getBeamStartElisionLevel  (int index = 0) const { return getElisionLevel('L', index); }
+		int                getBeamEndElisionLevel    (int index = 0) const { return getElisionLevel('J', index); }
+
+		int                getMarkerCount   (char marker) const;
+		int                getElisionLevel  (char marker, int index) const;
+
+	private:
+		// Slur, phrase and beam markers in the order that they occur
+		// in the token:
+		class Marker {
+			public:
+				char          m_type;     // ( ) { } L or J
+				unsigned char m_elision;  // number of '&' before the marker
+				short         m_note;     // index of the chord note
+		};
+
+		std::vector<HumKernNote> m_notes;
+		std::vector<Marker>      m_markers;
+		bool                     m_hasRest            = false;
+		bool                     m_hasPitch           = false;
+		bool                     m_hasTieContinuation = false;
+		char                     m_stem               = '\0';
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMKERNNOTE_H_INCLUDED */
+
+
+
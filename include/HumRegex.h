@@ -14,6 +14,9 @@
 #ifndef _HUMREGEX_H_INCLUDED
 #define _HUMREGEX_H_INCLUDED
 
+#include "HumRegexNfa.h"
+
+#include <memory>
 #include <regex>
 #include <string>
 #include <vector>
@@ -118,31 +121,60 @@ class HumRegex {
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
 
+		int         searchText         (const std::string& input, int startindex,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		bool        matchText          (const std::string& input,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		std::string replaceText        (const std::string& input,
+		                                const std::string& replacement,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		void        appendFormat       (std::string& output, const std::string& format,
+		                                const std::string& input,
+		                                const std::vector<int>& captures, int prefix);
+		const HumRegexNfa* getNfa      (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+		const std::regex&  getRegex    (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
 
 	private:
 
 		// m_regex: stores the regular expression to use as a default.
+		// It is only used for expressions which cannot be handled by
+		// m_nfa, and it is recompiled only when the expression changes.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
 		// .assign(string) == set the regular expression.
 		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
 		std::regex m_regex;
-
-		// m_matches: stores the matches from a search:
-		//
-		// http://en.cppreference.com/w/cpp/regex/match_results
-		// .empty()     == check if match was successful.
-		// .size()      == number of matches.
-		// .length(i)   == return length of a submatch.
-		// .position(i) == return start index of submatch in search string.
-		// .str(i)      == return string of submatch.
-		// operator[i]  == return submatch.
-		// .prefix
-		// .suffix
-		// .begin()     == start of submatch list.
-		// .end()       == end of submatch list.
-		std::smatch m_matches;
+		std::string m_regexexp;
+		std::regex_constants::syntax_option_type m_regexexpflags;
+		bool m_regexQ = false;
+
+		// m_nfa: linear-time matcher for m_nfaexp, or NULL if the expression
+		// needs std::regex (see HumRegexNfa).  Compiled expressions are
+		// shared between HumRegex objects.
+		std::shared_ptr<const HumRegexNfa> m_nfa;
+		std::string m_nfaexp;
+		std::regex_constants::syntax_option_type m_nfaflags;
+		bool m_nfaQ = false;
+
+		// m_input: copy of the string from the last search, which is
+		// searched starting at index m_begin.
+		std::string m_input;
+		int m_begin = 0;
+
+		// m_captures: stores the matches from the last search as start/end
+		// index pairs in m_input: [0..1] is the complete match and the
+		// following pairs are the submatches (-1 if a submatch did not
+		// participate in the match).  Empty if the search failed.
+		std::vector<int> m_captures;
 
 		// m_regexflags: store default settings for regex processing
 		// http://en.cppreference.com/w/cpp/regex/syntax_option_type
@@ -0,0 +1,148 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 22:05:48 PDT 2026
+// Last Modified: Sat Oct 17 22:05:48 PDT 2026
+// Filename:      HumRegexNfa.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumRegexNfa.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Linear-time regular expression matcher used by HumRegex.
+//                An ECMAScript expression is compiled into a Thompson NFA
+//                which is simulated with a Pike VM (one thread per NFA
+//                state, ordered by priority), so that matching never
+//                backtracks and the submatches are the same as those of
+//                std::regex (leftmost match, greedy/lazy quantifiers, first
+//                alternative preferred).  Expressions that use features
+//                outside of the supported subset (backreferences,
+//                lookaheads, POSIX bracket classes, etc.) fail to compile,
+//                and HumRegex then uses std::regex for them.
+//
+//                Supported syntax: literals and escaped punctuation,
+//                ".", [...] and [^...] with ranges, \d \D \w \W \s \S,
+//                \t \n \v \f \r \xHH, ^ $ \b \B, (...) and (?:...), "|",
+//                and the * + ? {n} {n,} {n,m} quantifiers with an
+//                optional "?" for lazy matching.
+//
+
+#ifndef _HUMREGEXNFA_H_INCLUDED
+#define _HUMREGEXNFA_H_INCLUDED
+
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumRegexNfa {
+	public:
+		                HumRegexNfa     (void);
+		                HumRegexNfa     (const std::string& exp, bool icase = false);
+
+		bool            compile         (const std::string& exp, bool icase = false);
+		void            clear           (void);
+		bool            isValid         (void) const { return m_valid; }
+		int             getGroupCount   (void) const { return m_groups; }
+		int             getProgramSize  (void) const { return (int)m_program.size(); }
+
+		// Search input starting at index start.  The searched range begins
+		// at index begin (for ^ and \b).  On success captures contains the
+		// start/end index pairs of the match and each group (-1 when a
+		// group did not participate).  continuous: match only at start;
+		// notnull: do not accept an empty match.
+		bool            search          (const std::string& input, int begin,
+		                                 int start, std::vector<int>& captures,
+		                                 bool continuous = false,
+		                                 bool notnull = false) const;
+
+		// Match the entire input string:
+		bool            match           (const std::string& input) const;
+
+		// Shared compiled expressions (NULL if the expression is not
+		// supported):
+		static std::shared_ptr<const HumRegexNfa> getCompiled(
+		                                 const std::string& exp, bool icase);
+
+	protected:
+		class Instruction {
+			public:
+				unsigned char m_op;
+				int           m_x;
+				int           m_y;
+		};
+
+		class Node {
+			public:
+				int              m_type;
+				int              m_value = 0;  // character, class or group
+				int              m_min   = 0;
+				int              m_max   = 0;   // -1 for unbounded
+				bool             m_greedy = true;
+				std::vector<int> m_children;
+		};
+
+		class ThreadList;
+
+		// parsing:
+		int             parseAlternation(void);
+		int             parseSequence   (void);
+		int             parseRepeat     (void);
+		int             parseAtom       (void);
+		int             parseEscape     (void);
+		int             parseBracket    (void);
+		int             parseBracketTerm(std::bitset<256>& set, bool& classQ);
+		int             makeNode        (int type, int value = 0);
+		int             makeClass       (const std::bitset<256>& set);
+		int             makeCharacter   (unsigned char ch);
+		bool            isNullable      (int node) const;
+
+		// compiling:
+		bool            emit            (int node);
+		int             addInstruction  (int op, int x = 0, int y = 0);
+		void            makeStartInfo   (void);
+
+		// matching:
+		bool            run             (const std::string& input, int begin,
+		                                 int start, int* captures, int slots,
+		                                 bool continuous, bool notnull,
+		                                 bool fullQ) const;
+		void            addThread       (ThreadList& list, int pc, int* captures,
+		                                 int slots, const std::string& input,
+		                                 int begin, int pos) const;
+		int             findStart       (const std::string& input, int pos) const;
+
+	private:
+		bool                          m_valid     = false;
+		bool                          m_icase     = false;
+		int                           m_groups    = 0;
+		std::vector<Instruction>      m_program;
+		std::vector<std::bitset<256>> m_classes;
+
+		// Characters which can start a match (when the expression cannot
+		// match an empty string), used to skip to candidate positions:
+		bool                          m_firstQ    = false;
+		int                           m_firstChar = -1;
+		std::bitset<256>              m_first;
+
+		// true if all matches must start at the beginning of the input:
+		bool                          m_anchored  = false;
+
+		// temporary parsing state:
+		std::string                   m_exp;
+		int                           m_pos       = 0;
+		int                           m_depth     = 0;
+		std::vector<Node>             m_nodes;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMREGEXNFA_H_INCLUDED */
+
+
+
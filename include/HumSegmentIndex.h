@@ -0,0 +1,106 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 21:12:36 PDT 2026
+// Last Modified: Sat Oct 17 21:12:36 PDT 2026
+// Filename:      HumSegmentIndex.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumSegmentIndex.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Byte-offset index of the !!!!SEGMENT: records in a
+//                concatenated Humdrum file, so that a single segment can
+//                be read with a direct seek instead of parsing all of the
+//                segments before it.  The index can be stored in a sidecar
+//                file next to the data file (filename + ".segidx").
+//
+
+#ifndef _HUMSEGMENTINDEX_H_INCLUDED
+#define _HUMSEGMENTINDEX_H_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumSegmentIndex {
+	public:
+		                   HumSegmentIndex     (void);
+		                   HumSegmentIndex     (const std::string& filename);
+
+		void               clear               (void);
+		int                getSize             (void) const { return (int)m_segments.size(); }
+		int                getCount            (void) const { return getSize(); }
+		const std::string& getFilename         (void) const { return m_filename; }
+
+		// Create the index by scanning a data file:
+		bool               build               (const std::string& filename,
+		                                        bool referencesQ = false);
+		bool               build               (std::istream& input,
+		                                        bool referencesQ = false);
+
+		// Sidecar index files:
+		bool               load                (const std::string& filename,
+		                                        bool referencesQ = false);
+		bool               readIndex           (const std::string& indexname);
+		bool               readIndex           (std::istream& input);
+		bool               writeIndex          (const std::string& indexname) const;
+		bool               writeIndex          (std::ostream& output) const;
+		static std::string getIndexFilename    (const std::string& filename);
+
+		// Segment information:
+		int                getSegment          (const std::string& name) const;
+		long long          getOffset           (int index) const;
+		long long          getLength           (int index) const;
+		const std::string& getName             (int index) const;
+		int                getLevel            (int index) const;
+		const std::vector<std::string>& getUniversals(int index) const;
+		const std::vector<std::string>& getReferenceKeys(int index) const;
+		bool               hasReferenceKey     (int index, const std::string& key) const;
+		bool               hasReferenceKeys    (void) const { return m_referencesQ; }
+
+		bool               getText             (std::istream& input, int index,
+		                                        std::string& text) const;
+
+	protected:
+		void               addSegment          (long long offset, const std::string& line);
+		int                addUniversals       (const std::vector<std::string>& universals);
+		void               makeNameIndex       (void);
+
+	private:
+		class Segment {
+			public:
+				long long                m_offset    = 0;
+				long long                m_length    = 0;
+				int                      m_level     = 0;
+				int                      m_universal = -1;  // index into m_universals
+				std::string              m_name;
+				std::vector<std::string> m_keys;
+		};
+
+		std::string                           m_filename;
+		long long                             m_filesize   = 0;
+		bool                                  m_referencesQ = false;
+		std::vector<Segment>                  m_segments;
+
+		// Universal comments from earlier segments that are prepended to a
+		// segment when it is read (see HumdrumFileStream::getFile()):
+		std::vector<std::vector<std::string>> m_universals;
+
+		// Segment index for each name (first segment with a given name):
+		std::unordered_map<std::string, int>  m_names;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMSEGMENTINDEX_H_INCLUDED */
+
+
+
@@ -25,8 +25,13 @@ namespace hum {
 class HumSignifiers {
 	public:
 		              HumSignifiers    (void);
+		              HumSignifiers    (const HumSignifiers& signifiers);
+		              HumSignifiers    (HumSignifiers&& signifiers) noexcept;
 		             ~HumSignifiers    ();
 
+		HumSignifiers& operator=       (const HumSignifiers& signifiers);
+		HumSignifiers& operator=       (HumSignifiers&& signifiers) noexcept;
+
 		void          clear            (void);
 		bool          addSignifier     (const std::string& rdfline);
 		bool          hasKernLinkSignifier (void);
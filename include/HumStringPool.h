@@ -0,0 +1,56 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 22:05:19 PDT 2026
+// Last Modified: Sat Oct 17 22:05:19 PDT 2026
+// Filename:      HumStringPool.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumStringPool.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Thread-safe pool of shared immutable strings.  Each
+//                distinct string is stored once, and intern() returns a
+//                pointer to the stored copy, so objects that hold the
+//                same string can share it, and interned strings can be
+//                compared by pointer.  Strings are never removed from the
+//                pool, so the pointers stay valid for the life of the pool.
+//
+
+#ifndef _HUMSTRINGPOOL_H_INCLUDED
+#define _HUMSTRINGPOOL_H_INCLUDED
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace hum {
+
+// START_MERGE
+
+class HumStringPool {
+	public:
+		                   HumStringPool     (void);
+		                  ~HumStringPool     ();
+
+		const std::string* intern            (const std::string& text);
+		const std::string* find              (const std::string& text) const;
+		int                getSize           (void) const;
+		size_t             getTextSize       (void) const;
+
+	private:
+		                   HumStringPool     (const HumStringPool& pool) = delete;
+		HumStringPool&     operator=         (const HumStringPool& pool) = delete;
+
+		mutable std::mutex              m_mutex;
+		std::unordered_set<std::string> m_strings;
+		size_t                          m_textsize = 0;  // characters in m_strings
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMSTRINGPOOL_H_INCLUDED */
+
+
+
@@ -0,0 +1,75 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:12:40 PDT 2026
+// Last Modified: Sat Oct 17 19:12:40 PDT 2026
+// Filename:      HumTokenLinks.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumTokenLinks.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   List of links from a token to the next or previous tokens
+//                in its spine.  Almost every token has exactly one next and
+//                one previous token (only spine manipulators have more), so
+//                a single link is stored inside of the object, and a
+//                separate array is allocated only for two or more links.
+//
+
+#ifndef _HUMTOKENLINKS_H_INCLUDED
+#define _HUMTOKENLINKS_H_INCLUDED
+
+#include "HumAddress.h"
+
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumTokenLinks {
+	public:
+		                 HumTokenLinks  (void) {}
+		                 HumTokenLinks  (const HumTokenLinks& links);
+		                ~HumTokenLinks  ();
+
+		HumTokenLinks&   operator=      (const HumTokenLinks& links);
+
+		int              size           (void) const { return m_size; }
+		bool             empty          (void) const { return m_size == 0; }
+		void             clear          (void);
+		void             resize         (int count);
+		void             push_back      (HTp token);
+
+		HTp*             data           (void) { return m_capacity > 1 ? m_array : &m_single; }
+		const HTp*       data           (void) const { return m_capacity > 1 ? m_array : &m_single; }
+		HTp&             operator[]     (int index) { return data()[index]; }
+		HTp              operator[]     (int index) const { return data()[index]; }
+		HTp&             back           (void) { return data()[m_size - 1]; }
+		HTp*             begin          (void) { return data(); }
+		HTp*             end            (void) { return data() + m_size; }
+		const HTp*       begin          (void) const { return data(); }
+		const HTp*       end            (void) const { return data() + m_size; }
+		std::vector<HTp> toVector       (void) const;
+
+	protected:
+		void             reserve        (int count);
+
+	private:
+		// m_single is used when m_capacity is 1, otherwise m_array points
+		// to an allocated array of m_capacity links.
+		union {
+			HTp          m_single = NULL;
+			HTp*         m_array;
+		};
+		int              m_size     = 0;
+		int              m_capacity = 1;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMTOKENLINKS_H_INCLUDED */
+
+
+
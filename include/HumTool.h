@@ -15,6 +15,7 @@
 
 #include "Options.h"
 #include "HumdrumFileSet.h"
+#include "HumdrumLineStream.h"
 
 #include <sstream>
 #include <string>
@@ -188,6 +189,39 @@ int main(int argc, char** argv) {                                          \
 
 
 
+//////////////////////////////
+//
+// LINE_STREAM_INTERFACE -- Use HumdrumLineStream to send the input one
+//    line at a time to the filter, which prints its results directly
+//    (constant-memory implementation for line-based filters).
+//
+
+#define LINE_STREAM_INTERFACE(CLASS)                                       \
+int main(int argc, char** argv) {                                          \
+	hum::CLASS interface;                                                   \
+	if (!interface.process(argc, argv)) {                                   \
+		interface.getError(std::cerr);                                       \
+		return -1;                                                           \
+	}                                                                       \
+	hum::HumdrumLineStream instream(static_cast<hum::Options&>(interface)); \
+	bool status = interface.run(instream, std::cout);                       \
+	interface.finally();                                                    \
+	if (interface.hasWarning()) {                                           \
+		interface.getWarning(std::cerr);                                     \
+	}                                                                       \
+	if (interface.hasAnyText()) {                                           \
+	   interface.getAllText(std::cout);                                     \
+	}                                                                       \
+	if (interface.hasError()) {                                             \
+		interface.getError(std::cerr);                                       \
+        return -1;                                                         \
+	}                                                                       \
+	interface.clearOutput();                                                \
+	return !status;                                                         \
+}
+
+
+
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
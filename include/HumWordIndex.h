@@ -0,0 +1,111 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 02:41:17 PDT 2026
+// Last Modified: Sun Oct 18 02:41:17 PDT 2026
+// Filename:      HumWordIndex.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumWordIndex.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Index of the lyric words in the **silbe (or **text)
+//                spines of a Humdrum file.  Syllables are joined into
+//                words, and each word is stored with its start token and
+//                the start token of the next word in the same spine.
+//                Words are normalized (case-folded, with diacritics and
+//                punctuation removed) and sorted, so that exact, prefix
+//                and wildcard lookups are binary searches rather than a
+//                scan of every word.  Indexes for a set of files can be
+//                written one after another into a single text file and
+//                read back without loading the Humdrum data (see the
+//                msearch --make-index and --index options).
+//
+
+#ifndef _HUMWORDINDEX_H_INCLUDED
+#define _HUMWORDINDEX_H_INCLUDED
+
+#include "HumdrumFile.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumWordIndex {
+	public:
+		                   HumWordIndex      (void);
+		                   HumWordIndex      (HumdrumFile& infile);
+
+		void               clear             (void);
+		bool               build             (HumdrumFile& infile);
+		int                getSize           (void) const { return (int)m_words.size(); }
+		int                getCount          (void) const { return getSize(); }
+		const std::string& getName           (void) const { return m_name; }
+		void               setName           (const std::string& name) { m_name = name; }
+		int                getLineCount      (void) const { return m_linecount; }
+
+		// Word information:
+		const std::string& getWord           (int index) const;
+		const std::string& getKey            (int index) const;
+		int                getTrack          (int index) const;
+		int                getLineIndex      (int index) const;
+		int                getFieldIndex     (int index) const;
+		HTp                getStartToken     (HumdrumFile& infile, int index) const;
+		HTp                getNextToken      (HumdrumFile& infile, int index) const;
+
+		// Lookups (results are word indexes in file order):
+		int                find              (std::vector<int>& matches,
+		                                      const std::string& query) const;
+		int                findExact         (std::vector<int>& matches,
+		                                      const std::string& word) const;
+		int                findPrefix        (std::vector<int>& matches,
+		                                      const std::string& prefix) const;
+		int                findWildcard      (std::vector<int>& matches,
+		                                      const std::string& pattern) const;
+
+		static std::string normalize         (const std::string& text,
+		                                      bool wildcardsQ = false);
+		static bool        wildcardMatch     (const char* pattern, const char* text);
+
+		// Serialization:
+		bool               writeIndex        (std::ostream& output) const;
+		bool               readIndex         (std::istream& input);
+
+	protected:
+		void               addSpine          (HTp starttoken);
+		void               sortKeys          (void);
+		void               getRange          (const std::string& prefix,
+		                                      int& first, int& last) const;
+
+	private:
+		class Word {
+			public:
+				int         m_line      = -1;
+				int         m_field     = -1;
+				int         m_nextline  = -1;  // start of next word in spine
+				int         m_nextfield = -1;
+				int         m_track     = 0;
+				std::string m_text;            // word as written (syllables joined)
+				std::string m_key;             // normalized word
+		};
+
+		std::string       m_name;
+		int               m_linecount = 0;
+		std::vector<Word> m_words;
+
+		// Word indexes sorted by normalized word (then by file order):
+		std::vector<int>  m_sorted;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMWORDINDEX_H_INCLUDED */
+
+
+
@@ -0,0 +1,105 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 17:20:31 PDT 2026
+// Last Modified: Sat Oct 17 17:20:31 PDT 2026
+// Filename:      HumdrumExpansionView.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumdrumExpansionView.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read-only view of a HumdrumFile in the order given by
+//                an expansion list such as *>[A,A,B] (performance order).
+//                The view stores only an index from expanded line order
+//                to the lines of the original file, along with the time
+//                shift needed for each repeated section, so the expanded
+//                score is never copied or reparsed.
+//
+
+#ifndef _HUMDRUMEXPANSIONVIEW_H_INCLUDED
+#define _HUMDRUMEXPANSIONVIEW_H_INCLUDED
+
+#include "HumNum.h"
+#include "HumdrumFile.h"
+
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumdrumExpansionView {
+	public:
+		                    HumdrumExpansionView  (void);
+		                    HumdrumExpansionView  (HumdrumFile& infile,
+		                                           const std::string& variant = "");
+		                   ~HumdrumExpansionView  () {}
+
+		void                clear                 (void);
+		void                setKeepLists          (bool state) { m_keepQ = state; }
+		bool                analyze               (HumdrumFile& infile,
+		                                           const std::string& variant = "",
+		                                           const std::string& realization = "");
+
+		bool                isExpanded            (void) const { return m_expandedQ; }
+		HumdrumFile*        getFile               (void) const { return m_infile; }
+		int                 getLineCount          (void) const { return (int)m_lines.size(); }
+		HumdrumLine&        operator[]            (int index) const;
+		HumdrumLine&        getLine               (int index) const { return (*this)[index]; }
+		int                 getLineIndex          (int index) const { return m_lines[index]; }
+		HumNum              getDurationFromStart  (int index) const;
+		HumNum              getDuration           (int index) const;
+		HumNum              getScoreDuration      (void) const { return m_scoreDuration; }
+		int                 getSectionIndex       (int index) const;
+		bool                isHeader              (int index) const { return m_sections[index] == 0; }
+		bool                isFooter              (int index) const;
+
+		// Expansion list information:
+		int                 getSequenceCount      (void) const { return (int)m_sequence.size(); }
+		const std::string&  getSequenceLabel      (int index) const { return m_sequence[index]; }
+		bool                hasSequenceLabel      (int index) const { return m_sequenceLine[index] >= 0; }
+		int                 getSequenceStart      (int index) const { return m_sequenceStart[index]; }
+		int                 getSequenceEnd        (int index) const { return m_sequenceEnd[index]; }
+		int                 getFooterStart        (void) const { return m_footerStart; }
+
+		static void         getLabelSequence      (std::vector<std::string>& labelsequence,
+		                                           const std::string& astring);
+		static bool         isExpansionList       (HTp token);
+
+	protected:
+		int                 findLabelSequence     (HumdrumFile& infile,
+		                                           const std::string& variant);
+		void                addLines              (int startline, int endline,
+		                                           int section, bool filter);
+
+	private:
+		HumdrumFile*              m_infile = NULL;
+		bool                      m_keepQ = false;     // keep *>[...] lines
+		bool                      m_expandedQ = false; // label sequence found
+
+		// Expanded line order (one entry per line in the view):
+		std::vector<int>          m_lines;     // line index in original file
+		std::vector<int>          m_sections;  // index into m_shifts
+
+		// Time shift for each section: [0] = header, [1..n] = sequence
+		// entries, [n+1] = footer:
+		std::vector<HumNum>       m_shifts;
+		HumNum                    m_scoreDuration;
+
+		// Label sequence of the expansion list:
+		std::vector<std::string>  m_sequence;
+		std::vector<int>          m_sequenceLine;  // label line in file or -1
+		std::vector<int>          m_sequenceStart; // first index in view
+		std::vector<int>          m_sequenceEnd;   // one past last index in view
+		int                       m_footerStart = 0;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMDRUMEXPANSIONVIEW_H_INCLUDED */
+
+
+
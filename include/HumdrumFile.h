@@ -32,12 +32,22 @@ class HumdrumFile : public HUMDRUMFILE_PARENT {
 		              HumdrumFile          (void);
 		              HumdrumFile          (const std::string& filename);
 		              HumdrumFile          (std::istream& filename);
+		              HumdrumFile          (HumdrumFile& infile);
+		              HumdrumFile          (HumdrumFile&& infile) noexcept;
 		             ~HumdrumFile          ();
 
+		HumdrumFile& operator=             (HumdrumFile& infile);
+		HumdrumFile& operator=             (HumdrumFile&& infile) noexcept;
+		HumdrumFile   clone                (void) const;
+
 		std::ostream& printXml             (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlParameterInfo(std::ostream& out, int level,
 		                                    const std::string& indent);
+		std::ostream& printJson            (std::ostream& out = std::cout,
+		                                    const std::string& fields = "",
+		                                    const std::string& indent = "\t");
+		void          printJson            (HumJsonWriter& json, int fields);
 };
 
 
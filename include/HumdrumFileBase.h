@@ -21,9 +21,12 @@
 #include "HumSignifiers.h"
 #include "HumdrumLine.h"
 
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 // USING_URI is defined if you want to be able to download Humdrum data
@@ -60,6 +63,11 @@ namespace hum {
 //                        a list of tokens from lines which hasSpines() it true.
 // * OPT_NOREST     => don't include **kern rests.
 // * OPT_NOTIE      => don't include **kern secondary tied notes.
+// * OPT_NOBARLINE  => don't include barlines.
+// * OPT_NODATA     => don't include data tokens (other than barlines).
+// * OPT_NOTANDEM   => don't include any interpretation tokens (OPT_NOINTERP
+//                        only removes manipulators, exclusive interpretations
+//                        and terminators).
 //
 // Compound options:
 // * OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
@@ -76,6 +84,9 @@ namespace hum {
 #define OPT_NOGLOBAL  0x040
 #define OPT_NOREST    0x080
 #define OPT_NOTIE     0x100
+#define OPT_NOBARLINE 0x200
+#define OPT_NODATA    0x400
+#define OPT_NOTANDEM  0x800
 #define OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
@@ -93,6 +104,235 @@ class TokenPair {
 };
 
 
+// HumTrackIndex: the tokens of a track in line order, which are stored by
+// HumdrumFileBase::analyzeTracks() for use by HumTrackView.  Each non-empty
+// line of the file is a row: global lines have a single token in each
+// track's index (the global comment or reference record), and other lines
+// have the tokens of the track in field order.
+
+class HumTrackIndex {
+	public:
+		void clear(void) {
+			m_tokens.clear();
+			m_rows.clear();
+			m_global.clear();
+		}
+
+		// m_tokens: the tokens of the track, row by row.
+		std::vector<HTp> m_tokens;
+
+		// m_rows: index of the first token of each row in m_tokens, followed
+		// by the size of m_tokens.
+		std::vector<int> m_rows;
+
+		// m_global: true for rows which are global lines.
+		std::vector<char> m_global;
+};
+
+
+// HumTrackView: non-owning view of the tokens in a track (or spine) which
+// is read from the file's track index, so iterating it does not allocate
+// memory.  Create views with HumdrumFileBase::getTrackView(), getSpineView()
+// or getPrimaryTrackView().  The options are the OPT_* flags also used by
+// getTrackSequence(), and the rows of the view are the same as the lists
+// returned by getTrackSequence().  A view should not be used after lines
+// or tokens are added to or removed from the file.
+//
+// Example:
+//    for (auto row : infile.getTrackView(track, OPT_DATA)) {
+//       for (HTp token : row) { ... }   // all subspines on a line
+//    }
+//    for (HTp token : infile.getPrimaryTrackView(track, OPT_ATTACKS).tokens()) {
+//       ...
+//    }
+
+class HumTrackView {
+	public:
+		// Row: the tokens of the track on one line which pass the filters.
+		class Row {
+			public:
+				class iterator {
+					public:
+						typedef std::forward_iterator_tag iterator_category;
+						typedef HTp                       value_type;
+						typedef std::ptrdiff_t            difference_type;
+						typedef const HTp*                pointer;
+						typedef HTp                       reference;
+
+						iterator(void) {}
+						iterator(const HTp* current, const HTp* last, int options);
+						HTp       operator*   (void) const { return *m_current; }
+						iterator& operator++  (void);
+						iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+						bool      operator==  (const iterator& other) const
+						                         { return m_current == other.m_current; }
+						bool      operator!=  (const iterator& other) const
+						                         { return m_current != other.m_current; }
+					private:
+						void      skip        (void);
+						const HTp* m_current = NULL;
+						const HTp* m_last    = NULL;
+						int        m_options = 0;
+				};
+
+				Row(void) {}
+				Row(const HTp* first, const HTp* last, int options);
+				iterator  begin       (void) const
+				                         { return iterator(m_first, m_last, m_options); }
+				iterator  end         (void) const
+				                         { return iterator(m_last, m_last, m_options); }
+				bool      empty       (void) const { return m_first == m_last; }
+				int       size        (void) const;
+				HTp       front       (void) const { return *begin(); }
+				HTp       operator[]  (int index) const;
+				int       getLineIndex(void) const;
+
+			private:
+				const HTp* m_first   = NULL;
+				const HTp* m_last    = NULL;
+				int        m_options = 0;
+		};
+
+		// iterator: rows of the view.
+		class iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef Row                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const Row*                pointer;
+				typedef Row                       reference;
+
+				iterator(void) {}
+				iterator(const HumTrackIndex* index, int options, int row);
+				Row       operator*   (void) const { return m_current; }
+				const Row* operator-> (void) const { return &m_current; }
+				iterator& operator++  (void);
+				iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+				bool      operator==  (const iterator& other) const
+				                         { return m_row == other.m_row; }
+				bool      operator!=  (const iterator& other) const
+				                         { return m_row != other.m_row; }
+			private:
+				void      skip        (void);
+				const HumTrackIndex* m_index = NULL;
+				int       m_options = 0;
+				int       m_row = 0;
+				Row       m_current;
+		};
+
+		// token_iterator: tokens of all rows of the view.
+		class token_iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef HTp                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const HTp*                pointer;
+				typedef HTp                       reference;
+
+				token_iterator(void) {}
+				token_iterator(iterator row, iterator last);
+				HTp       operator*   (void) const { return *m_token; }
+				token_iterator& operator++ (void);
+				token_iterator  operator++ (int)
+				              { token_iterator old = *this; ++*this; return old; }
+				bool      operator==  (const token_iterator& other) const
+				            { return (m_row == other.m_row) && (m_token == other.m_token); }
+				bool      operator!=  (const token_iterator& other) const
+				            { return !(*this == other); }
+			private:
+				iterator      m_row;
+				iterator      m_last;
+				Row::iterator m_token;
+		};
+
+		class TokenRange {
+			public:
+				TokenRange(iterator first, iterator last) : m_first(first), m_last(last) {}
+				token_iterator begin(void) const
+				                   { return token_iterator(m_first, m_last); }
+				token_iterator end(void) const
+				                   { return token_iterator(m_last, m_last); }
+			private:
+				iterator m_first;
+				iterator m_last;
+		};
+
+		              HumTrackView  (void) {}
+		              HumTrackView  (const HumTrackIndex* index, int options)
+		                               : m_index(index), m_options(options) {}
+		iterator      begin         (void) const
+		                               { return iterator(m_index, m_options, 0); }
+		iterator      end           (void) const
+		                { return iterator(m_index, m_options, getRowCount(m_index)); }
+		bool          empty         (void) const { return begin() == end(); }
+		int           size          (void) const;
+		TokenRange    tokens        (void) const { return TokenRange(begin(), end()); }
+		int           getOptions    (void) const { return m_options; }
+
+		static bool   isAccepted    (HTp token, int options);
+
+	protected:
+		static int    getRowCount   (const HumTrackIndex* index);
+		static bool   makeRow       (const HumTrackIndex* index, int options,
+		                             int row, Row& output);
+
+	private:
+		const HumTrackIndex* m_index = NULL;
+		int                  m_options = 0;
+};
+
+
+// HumSpineStartView: non-owning view of the starting exclusive
+// interpretations of the spines in a file (optionally only those of
+// a given data type), from HumdrumFileBase::getSpineStartView().
+// Iterators keep their own copy of the data type, so they remain valid
+// after the view is copied or destroyed (but not after the spines of
+// the file are analyzed again).
+
+class HumSpineStartView {
+	public:
+		class iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef HTp                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const HTp*                pointer;
+				typedef HTp                       reference;
+
+				iterator(void) {}
+				iterator(const HTp* current, const HTp* last, const std::string& exinterp);
+				HTp       operator*   (void) const { return *m_current; }
+				iterator& operator++  (void);
+				iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+				bool      operator==  (const iterator& other) const
+				                         { return m_current == other.m_current; }
+				bool      operator!=  (const iterator& other) const
+				                         { return m_current != other.m_current; }
+			private:
+				void      skip        (void);
+				const HTp*  m_current = NULL;
+				const HTp*  m_last    = NULL;
+				std::string m_exinterp;   // empty for all spines
+		};
+
+		              HumSpineStartView(void) {}
+		              HumSpineStartView(const HTp* first, const HTp* last);
+		              HumSpineStartView(const HTp* first, const HTp* last,
+		                                const std::string& exinterp);
+		iterator      begin         (void) const
+		                               { return iterator(m_first, m_last, m_exinterp); }
+		iterator      end           (void) const
+		                               { return iterator(m_last, m_last, m_exinterp); }
+		bool          empty         (void) const { return begin() == end(); }
+		int           size          (void) const;
+
+	private:
+		const HTp*  m_first = NULL;
+		const HTp*  m_last  = NULL;
+		std::string m_exinterp;   // empty for all spines
+};
+
+
 // HumFileAnalysis: class used to manage analysis states for a Humdrum file.
 
 class HumFileAnalysis {
@@ -108,6 +348,7 @@ class HumFileAnalysis {
 			m_phrases_analyzed   = false;
 			m_nulls_analyzed     = false;
 			m_strophes_analyzed  = false;
+			m_metric_analyzed    = false;
 
 			m_barlines_analyzed  = false;
 			m_barlines_different = false;
@@ -145,6 +386,10 @@ class HumFileAnalysis {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_metric_analyzed: Used to keep track of whether or not the
+		// metric index is valid (see HumdrumFileContent::getMetricInfo()).
+		bool m_metric_analyzed = false;
+
 		// m_barlines_analyzed: Used to keep track of wheter or not
 		// barlines have beena analyzed yet.
 		bool m_barlines_analyzed = false;
@@ -161,11 +406,14 @@ class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
 		              HumdrumFileBase          (HumdrumFileBase& infile);
+		              HumdrumFileBase          (HumdrumFileBase&& infile) noexcept;
 		              HumdrumFileBase          (const std::string& contents);
 		              HumdrumFileBase          (std::istream& contents);
 		             ~HumdrumFileBase          ();
 
 		HumdrumFileBase& operator=             (HumdrumFileBase& infile);
+		HumdrumFileBase& operator=             (HumdrumFileBase&& infile) noexcept;
+		void          cloneFrom                (const HumdrumFileBase& infile);
 		bool          read                     (std::istream& contents);
 		bool          read                     (const char* filename);
 		bool          read                     (const std::string& filename);
@@ -265,6 +513,10 @@ class HumdrumFileBase : public HumHash {
 		std::vector<HTp> getKernLikeSpineStartList(void);
 		void          getStaffLikeSpineStartList(std::vector<HTp>& spinestarts);
 		std::vector<HTp> getStaffLikeSpineStartList(void);
+		HumSpineStartView getSpineStartView    (void);
+		HumSpineStartView getSpineStartView    (const std::string& exinterp);
+		HumSpineStartView getKernSpineStartView(void)
+		                                { return getSpineStartView("**kern"); }
 		int           getExinterpCount         (const std::string& exinterp);
 		void          getTrackStartList        (std::vector<HTp>& spinestarts)
 		                               { return getSpineStartList(spinestarts); }
@@ -329,6 +581,17 @@ class HumdrumFileBase : public HumHash {
 		void          getPrimarySpineSequence  (std::vector<HTp>& sequence,
 		                                        int spine, int options);
 
+		HumTrackView  getTrackView             (int track, int options = 0);
+		HumTrackView  getTrackView             (HTp starttoken, int options = 0)
+		                   { return getTrackView(starttoken->getTrack(), options); }
+		HumTrackView  getPrimaryTrackView      (int track, int options = 0)
+		                     { return getTrackView(track, options | OPT_PRIMARY); }
+		HumTrackView  getSpineView             (int spine, int options = 0)
+		                              { return getTrackView(spine+1, options); }
+		HumTrackView  getPrimarySpineView      (int spine, int options = 0)
+		                   { return getTrackView(spine+1, options | OPT_PRIMARY); }
+		void          invalidateTrackIndex     (void) { m_trackindexvalid = false; }
+
 		void          getTrackSeq              (std::vector<std::vector<HTp> >& sequence,
 		                                        HTp starttoken, int options)
 		                     { getTrackSequence(sequence, starttoken, options); }
@@ -356,6 +619,9 @@ class HumdrumFileBase : public HumHash {
 		bool          analyzeTracks             (void);
 		bool          analyzeLines              (void);
 
+		static std::string getMergedSpineInfo   (std::vector<std::string>& info,
+		                                         int starti, int extra);
+
 	protected:
 		static int    getChunk                  (int socket_id,
 		                                         std::stringstream& inputdata,
@@ -374,12 +640,11 @@ class HumdrumFileBase : public HumHash {
 		bool          adjustSpines              (HumdrumLine& line,
 		                                         std::vector<std::string>& datatype,
 		                                         std::vector<std::string>& sinfo);
-		std::string   getMergedSpineInfo        (std::vector<std::string>& info,
-		                                         int starti, int extra);
 		bool          stitchLinesTogether       (HumdrumLine& previous,
 		                                         HumdrumLine& next);
 		void          addToTrackStarts          (HTp token);
-		void          addUniqueTokens           (std::vector<HTp>& target,
+		void          buildTrackIndex           (void);
+		void          addUniqueTokens           (HumTokenLinks& target,
 		                                         std::vector<HTp>& source);
 		bool          processNonNullDataTokensForTrackForward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
@@ -389,6 +654,15 @@ class HumdrumFileBase : public HumHash {
 		bool          setParseError             (const std::string& err);
 		bool          setParseError             (const char* format, ...);
 //		void          fixMerges                 (int linei);
+		void          moveFrom                  (HumdrumFileBase& infile) noexcept;
+		static HTp    remapToken                (HTp token,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenList            (std::vector<HTp>& tokens,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenList            (HumTokenLinks& tokens,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenPairs           (std::vector<TokenPair>& pairs,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
 
 	protected:
 
@@ -415,6 +689,14 @@ class HumdrumFileBase : public HumHash {
 		// dimension is the list of terminators.
 		std::vector<std::vector<HTp> > m_trackends;
 
+		// m_trackindex: tokens of each track in line order, used by
+		// HumTrackView.  The first element is reserved as in m_trackstarts.
+		std::vector<HumTrackIndex> m_trackindex;
+
+		// m_trackindexvalid: false when lines or tokens have been added
+		// or removed since m_trackindex was built.
+		bool m_trackindexvalid = false;
+
 		// m_barlines: list of barlines in the data.  If the first measures is
 		// a pickup measure, then the first entry will not point to the first
 		// starting exclusive interpretation line rather than to a barline.
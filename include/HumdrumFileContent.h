@@ -27,13 +27,41 @@ namespace hum {
 
 // START_MERGE
 
+class HumMetricInfo {
+	public:
+		// m_top: Top number of the prevailing time signature (the default
+		// meter before any time signature is 1/4).
+		int m_top = 1;
+
+		// m_bottom: Bottom number of the prevailing time signature.
+		int m_bottom = 4;
+
+		// m_tick: Position of the line from the previous barline in ticks
+		// (see HumdrumFileContent::getMetricTpq()).
+		int m_tick = 0;
+
+		// m_measure: Measure ordinal of the line: the number of barlines
+		// at or before the line (0 for a pickup measure).
+		int m_measure = 0;
+
+		// m_level: Metric level of the line (see getMetricLevels()), or NAN
+		// for non-data lines.
+		double m_level = NAN;
+};
+
+
 class HumdrumFileContent : public HumdrumFileStructure {
 	public:
 		       HumdrumFileContent         (void);
 		       HumdrumFileContent         (const std::string& filename);
 		       HumdrumFileContent         (std::istream& contents);
+		       HumdrumFileContent         (HumdrumFileContent& infile);
+		       HumdrumFileContent         (HumdrumFileContent&& infile) noexcept;
 		      ~HumdrumFileContent         ();
 
+		HumdrumFileContent& operator=     (HumdrumFileContent& infile);
+		HumdrumFileContent& operator=     (HumdrumFileContent&& infile) noexcept;
+
 		bool   analyzeSlurs               (void);  // in src/HumdrumFileContents-slur.cpp
 		bool   analyzeBeams               (void);  // in src/HumdrumFileContents-beam.cpp
 		bool   analyzePhrasings           (void);
@@ -66,6 +94,9 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		// in HumdrumFileContent-metlev.cpp
 		void  getMetricLevels             (std::vector<double>& output, int track = 0,
 		                                   double undefined = NAN);
+		const HumMetricInfo& getMetricInfo(int line, int track = 0);
+		double getMetricLevel             (int line, int track = 0);
+		int   getMetricTpq                (void);
 		// in HumdrumFileContent-timesig.cpp
 		void  getTimeSigs                 (std::vector<std::pair<int, HumNum> >& output,
 		                                   int track = 0);
@@ -180,6 +211,19 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		void    getBaselines              (std::vector<std::vector<int>>& centerlines);
 		void    createLinkedTies          (std::vector<std::pair<HTp, int>>& starts,
 		                                   std::vector<std::pair<HTp, int>>& ends);
+
+		// Metric index:
+		int     getMetricTrack            (int track);
+		void    analyzeMetricIndex        (int track);
+		static bool getMeter              (HTp token, int& top, int& bot);
+
+	private:
+		// m_metricIndex: Metric information for each line of the file,
+		// indexed by track and then by line.  A track is analyzed the
+		// first time that it is queried, and the index is rebuilt after
+		// the file analyses are cleared (such as when reading a new file).
+		std::vector<std::vector<HumMetricInfo>> m_metricIndex;
+		int m_metricTpq = 0;
 };
 
 
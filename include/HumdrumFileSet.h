@@ -15,6 +15,7 @@
 #define _HUMDRUMFILESET_H_INCLUDED
 
 
+#include "HumSegmentIndex.h"
 #include "HumdrumFile.h"
 #include "HumdrumFileStream.h"
 #include "Options.h"
@@ -62,6 +63,18 @@ class HumdrumFileSet {
       int                   readAppend       (Options& options);
       int                   readAppend       (HumdrumFileStream& instream);
       int                   readAppendHumdrum(HumdrumFile& infile);
+
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              int threads = 1);
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              const std::vector<int>& segments,
+                                              int threads = 1);
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              const std::vector<std::string>& names,
+                                              int threads = 1);
+      int                   readAppendSegments(const HumSegmentIndex& index,
+                                              const std::vector<int>& segments,
+                                              int threads = 1);
 		int                   appendHumdrumPointer(HumdrumFile* infile);
 
    protected:
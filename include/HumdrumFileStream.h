@@ -18,6 +18,7 @@
 #ifndef _HUMDRUMFILESTREAM_H_INCLUDED
 #define _HUMDRUMFILESTREAM_H_INCLUDED
 
+#include "HumSegmentIndex.h"
 #include "HumdrumFile.h"
 #include "Options.h"
 
@@ -54,6 +55,18 @@ class HumdrumFileStream {
 		int             read               (HumdrumFileSet& infiles);
 		int             readSingleSegment  (HumdrumFileSet& infiles);
 
+		// Random access to segments with a HumSegmentIndex:
+		bool            loadSegmentIndex   (const std::string& filename,
+		                                    bool referencesQ = false);
+		const HumSegmentIndex& getSegmentIndex(void) const { return m_segmentindex; }
+		int             readSegment        (HumdrumFile& infile, int index);
+		int             readSegment        (HumdrumFile& infile,
+		                                    const std::string& name);
+		static int      readSegment        (HumdrumFile& infile,
+		                                    std::istream& input,
+		                                    const HumSegmentIndex& segmentindex,
+		                                    int index);
+
 	protected:
 		std::stringstream m_stringbuffer;   // used to read files from a string
 		std::ifstream     m_instream;       // used to read from list of files
@@ -66,6 +79,9 @@ class HumdrumFileStream {
 
 		std::vector<std::string>  m_universals;     // storage for universal comments
 
+		HumSegmentIndex   m_segmentindex;   // used by readSegment()
+		std::ifstream     m_segmentstream;  // data file for m_segmentindex
+
 		// Automatic URL downloading of data from internet in read():
 		void     fillUrlBuffer            (std::stringstream& uribuffer,
 		                                   const std::string& uriname);
@@ -33,7 +33,13 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		              HumdrumFileStructure         (void);
 		              HumdrumFileStructure         (const std::string& filename);
 		              HumdrumFileStructure         (std::istream& contents);
+		              HumdrumFileStructure         (HumdrumFileStructure& infile);
+		              HumdrumFileStructure         (HumdrumFileStructure&& infile) noexcept;
 		             ~HumdrumFileStructure         ();
+
+		HumdrumFileStructure& operator=            (HumdrumFileStructure& infile);
+		HumdrumFileStructure& operator=            (HumdrumFileStructure&& infile) noexcept;
+
 		bool          hasFilters                   (void);
 		bool          hasGlobalFilters             (void);
 		bool          hasUniversalFilters          (void);
@@ -153,12 +159,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            int line);
 		bool          decrementDurStates           (std::vector<HumNum>& durs,
 		                                            HumNum linedur, int line);
-		bool          assignDurationsToTrack       (HTp starttoken,
-		                                            HumNum startdur);
-		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		bool          assignDurationsFromStart     (void);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
-		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
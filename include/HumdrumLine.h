@@ -25,6 +25,7 @@
 namespace hum {
 
 class HumdrumFile;
+class HumJsonWriter;
 
 // START_MERGE
 
@@ -103,6 +104,7 @@ class HumdrumLine : public std::string, public HumHash {
 		                                    const std::string& indent);
 		std::ostream& printGlobalXmlParameterInfo(std::ostream& out, int level,
 		                                    const std::string& indent);
+		void          printJson            (HumJsonWriter& json, int fields);
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void          clearTokenLinkInfo   (void);
@@ -192,6 +194,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     setLineIndex           (int index);
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
+		void     invalidateTrackIndex   (void);
 		int      createTokensFromLine   (void);
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
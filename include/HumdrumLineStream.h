@@ -0,0 +1,148 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 13:41:09 PDT 2026
+// Last Modified: Sat Oct 17 13:41:09 PDT 2026
+// Filename:      HumdrumLineStream.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumdrumLineStream.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read Humdrum data one line at a time, keeping track
+//                of the spine structure (*^, *v, *x, *+, *-) incrementally
+//                so that each line can be given to a filter with its
+//                track and subtrack information and then discarded.
+//                Memory usage is constant with respect to the length of
+//                the input.  Input files and segments are split in the
+//                same way as HumdrumFileStream.
+//
+
+#ifndef _HUMDRUMLINESTREAM_H_INCLUDED
+#define _HUMDRUMLINESTREAM_H_INCLUDED
+
+#include "Options.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumdrumLineStream {
+	public:
+		                    HumdrumLineStream   (void);
+		                    HumdrumLineStream   (const std::vector<std::string>& list);
+		                    HumdrumLineStream   (Options& options);
+
+		int                 setFileList         (const std::vector<std::string>& list);
+		void                loadString          (const std::string& data);
+
+		bool                readLine            (void);
+		bool                analyzeLine         (const std::string& line);
+		void                reset               (void);
+
+		// Information about the current input segment:
+		bool                isSegmentStart      (void) const { return m_segmentStart; }
+		int                 getSegmentIndex     (void) const { return m_segment; }
+		const std::string&  getFilename         (void) const { return m_filename; }
+		int                 getLineIndex        (void) const { return m_lineindex; }
+		int                 getMaxTrack         (void) const { return m_maxtrack; }
+		bool                isValid             (void) const { return m_parseError.empty(); }
+		const std::string&  getParseError       (void) const { return m_parseError; }
+
+		// Information about the current line:
+		const std::string&  getLine             (void) const { return m_line; }
+		int                 getFieldCount       (void) const { return (int)m_tokens.size(); }
+		int                 getTokenCount       (void) const { return (int)m_tokens.size(); }
+		const std::string&  getToken            (int index) const { return m_tokens[index]; }
+		const std::vector<std::string>& getTokens (void) const { return m_tokens; }
+		int                 getTrack            (int index) const;
+		int                 getSubtrack         (int index) const;
+		const std::string&  getSpineInfo        (int index) const;
+		const std::string&  getDataType         (int index) const;
+		const std::vector<int>& getTracks       (void) const { return m_linetracks; }
+
+		bool                isEmpty             (void) const { return m_line.empty(); }
+		bool                isComment           (void) const { return equalChar(0, '!'); }
+		bool                isGlobalComment     (void) const { return equalChar(0, '!') && equalChar(1, '!'); }
+		bool                isLocalComment      (void) const { return equalChar(0, '!') && !equalChar(1, '!'); }
+		bool                isReference         (void) const;
+		bool                isInterpretation    (void) const { return equalChar(0, '*'); }
+		bool                isExclusive         (void) const { return equalChar(0, '*') && equalChar(1, '*'); }
+		bool                isBarline           (void) const { return equalChar(0, '='); }
+		bool                isData              (void) const;
+		bool                hasSpines           (void) const { return !(isEmpty() || isGlobalComment()); }
+		bool                isManipulator       (void) const { return m_manipulator; }
+		bool                isAllNull           (void) const;
+		bool                equalFieldsQ        (const std::string& exinterp,
+		                                         const std::string& value) const;
+
+		static bool         isManipulator       (const std::string& token);
+
+	protected:
+		bool                getRawLine          (std::string& line);
+		bool                openNextInput       (void);
+		void                startSegment        (void);
+		void                tokenizeLine        (void);
+		void                analyzeSpines       (void);
+		bool                adjustSpines        (void);
+		void                analyzeTracks       (void);
+		bool                setParseError       (const std::string& err);
+		bool                equalChar           (int index, char ch) const {
+		                       return ((int)m_line.size() > index) && (m_line[index] == ch);
+		                    }
+		static int          getTrackFromSpineInfo(const std::string& info);
+
+	private:
+		// input sources:
+		std::stringstream         m_stringbuffer; // used to read from a string
+		std::ifstream             m_instream;     // used to read from list of files
+		std::istream*             m_input = NULL; // current input stream
+		std::vector<std::string>  m_filelist;     // used when not using cin
+		int                       m_curfile = -1; // index into filelist
+		bool                      m_stringQ = false; // reading from m_stringbuffer
+
+		// segment splitting (same rules as HumdrumFileStream):
+		std::vector<std::string>  m_universals;   // universal comments of segment
+		std::vector<std::string>  m_output;       // lines waiting to be analyzed
+		std::string               m_filename;     // filename of current segment
+		int                       m_segment = -1; // index of current segment
+		bool                      m_segmentStart = false; // first line of segment
+		bool                      m_dataFound = false;
+		bool                      m_starstarFound = false;
+		bool                      m_starminusFound = false;
+		bool                      m_newUniversals = false;
+		bool                      m_segmentPending = true;
+
+		// spine tracking:
+		std::vector<std::string>  m_datatype;     // exclusive interp. of each spine
+		std::vector<std::string>  m_sinfo;        // spine info of each spine
+		std::vector<int>          m_strack;       // track of each spine
+		bool                      m_init = false; // first ** line was found
+		bool                      m_manipulator = false;
+		bool                      m_exclusiveStart = false; // line defines spines
+		bool                      m_addOpen = false; // *+ waiting for **
+		int                       m_maxtrack = 0;
+		int                       m_lineindex = -1;
+		std::string               m_parseError;
+
+		// current line:
+		std::string               m_line;
+		std::vector<std::string>  m_tokens;
+		std::vector<int>          m_linetracks;
+		std::vector<int>          m_linesubtracks;
+		std::vector<int>          m_subtrackcount;
+		std::vector<int>          m_subtrackindex;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMDRUMLINESTREAM_H_INCLUDED */
+
+
+
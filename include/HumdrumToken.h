@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class HumParamSet;
@@ -23,7 +24,9 @@ class HumParamSet;
 #include "HumNum.h"
 #include "HumAddress.h"
 #include "HumHash.h"
+#include "HumKernNote.h"
 #include "HumParamSet.h"
+#include "HumTokenLinks.h"
 
 namespace hum {
 
@@ -32,6 +35,90 @@ namespace hum {
 
 typedef HumdrumToken* HTp;
 
+
+// HumSubtoken: a subtoken (such as a chord note) in the text of a token,
+// without a copy of the text.  For space-separated subtokens of a **kern
+// token the **kern record of the note (pitch, rhythm, ties) is also
+// available.
+
+class HumSubtoken {
+	public:
+		std::string_view   getText             (void) const { return m_text; }
+		std::string        getString           (void) const { return std::string(m_text); }
+		int                getIndex            (void) const { return m_index; }
+		int                getStart            (void) const { return m_start; }
+		bool               contains            (char ch) const
+		                      { return m_text.find(ch) != std::string_view::npos; }
+		bool               operator==          (std::string_view text) const
+		                      { return m_text == text; }
+		bool               operator!=          (std::string_view text) const
+		                      { return m_text != text; }
+
+		// **kern information (an empty record if the token is not **kern
+		// or the subtokens are not separated by spaces):
+		const HumKernNote& getKernNote         (void) const;
+		bool               hasPitch            (void) const { return getKernNote().hasPitch(); }
+		bool               isRest              (void) const { return getKernNote().isRest(); }
+		bool               isNote              (void) const { return getKernNote().isNote(); }
+		bool               isSecondaryTiedNote (void) const { return getKernNote().isSecondaryTiedNote(); }
+		int                getBase40           (void) const { return getKernNote().getBase40(); }
+		int                getBase7            (void) const { return getKernNote().getBase7(); }
+		int                getMidiNoteNumber   (void) const;
+		HumNum             getDuration         (void) const { return getKernNote().getDuration(); }
+
+	private:
+		std::string_view   m_text;
+		int                m_index = 0;
+		int                m_start = 0;
+		const HumKernNote* m_note  = NULL;
+
+	friend class HumSubtokenView;
+};
+
+
+// HumSubtokenView: iterate over the subtokens of a token without allocating
+// strings.  Space-separated subtokens of a **kern token are read from a
+// **kern record which is lexed when the view is created (see HumKernToken);
+// other subtokens are found by searching the token text.  The view is
+// invalid after the token text is changed.
+
+class HumSubtokenView {
+	public:
+		class iterator {
+			public:
+				                   iterator    (void) {}
+				                   iterator    (const HumSubtokenView* view, int index);
+				const HumSubtoken& operator*   (void) const { return m_current; }
+				const HumSubtoken* operator->  (void) const { return &m_current; }
+				iterator&          operator++  (void);
+				bool               operator==  (const iterator& other) const
+				                      { return m_current.m_index == other.m_current.m_index; }
+				bool               operator!=  (const iterator& other) const
+				                      { return m_current.m_index != other.m_current.m_index; }
+			private:
+				void               load        (int start);
+				const HumSubtokenView* m_view = NULL;
+				HumSubtoken        m_current;
+		};
+
+		                   HumSubtokenView     (const HumdrumToken& token,
+		                                        const std::string& separator = " ");
+		int                size                (void) const { return m_size; }
+		bool               isKern              (void) const { return m_kernQ; }
+		HumSubtoken        operator[]          (int index) const;
+		iterator           begin               (void) const { return iterator(this, 0); }
+		iterator           end                 (void) const { return iterator(this, m_size); }
+
+	private:
+		std::string_view    m_text;
+		std::string         m_separator;
+		HumKernToken        m_kern;
+		bool                m_kernQ = false;
+		int                 m_size = 0;
+};
+
+
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -252,6 +339,7 @@ class HumdrumToken : public std::string, public HumHash {
 		std::string   getSubtoken          (int index,
 		                                    const std::string& separator = " ") const;
 		std::vector<std::string> getSubtokens (const std::string& separator = " ") const;
+		HumSubtokenView getSubtokenView    (const std::string& separator = " ") const;
 		void     replaceSubtoken           (int index, const std::string& newsubtok,
 		                                    const std::string& separator = " ");
 		void     setParameters             (HTp ptok);
@@ -267,6 +355,9 @@ class HumdrumToken : public std::string, public HumHash {
 		int      getPhraseStartElisionLevel(int index) const;
 		int      getPhraseEndElisionLevel  (int index = 0) const;
 
+		HumKernToken getKernInfo           (void) const;
+		HumKernNote  getKernNote           (int index = 0) const;
+
 		HTp      getSlurStartToken         (int number = 1);
 		int      getSlurStartNumber        (int endnumber);
 		HTp      getSlurEndToken           (int number = 1);
@@ -279,6 +370,7 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 		std::ostream& printGlobalXmlParameterInfo(std::ostream& out = std::cout, int level = 0,
 		                                   const std::string& indent = "\t");
+		void          printJson            (HumJsonWriter& json, int fields);
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void     setText                   (const std::string& text);
@@ -287,6 +379,7 @@ class HumdrumToken : public std::string, public HumHash {
 		int      addLinkedParameterSet     (HTp token);
 		int      getLinkedParameterSetCount(void);
 		HumParamSet* getLinkedParameterSet (int index);
+		HTp      getLinkedParameterToken   (int index);
 		HumParamSet* getParameterSet       (void);
 		void         clearLinkInfo         (void);
 		std::string getSlurLayoutParameter (const std::string& keyname, int subtokenindex = -1);
@@ -358,6 +451,7 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setLineIndex              (int lineindex);
 		void     setFieldIndex             (int fieldlindex);
 		void     setSpineInfo              (const std::string& spineinfo);
+		void     shareSpineInfo            (HTp token);
 		void     setSubtrack               (int aSubtrack);
 		void     setSubtrackCount          (int count);
 		void     setPreviousToken          (HTp aToken);
@@ -400,22 +494,26 @@ class HumdrumToken : public std::string, public HumHash {
 		// following token, but there can be two tokens if the current
 		// token is *^, and there will be zero following tokens after a
 		// spine terminating token (*-).
-		std::vector<HTp> m_nextTokens;     // link to next token(s) in spine
+		HumTokenLinks m_nextTokens;     // link to next token(s) in spine
 
 		// previousTokens: Simiar to nextTokens, but for the immediately
 		// follow token(s) in the data.  Typically there will be one
 		// preceding token, but there can be multiple tokens when the previous
 		// line has *v merge tokens for the spine.  Exclusive interpretations
 		// have no tokens preceding them.
-		std::vector<HTp> m_previousTokens; // link to last token(s) in spine
+		HumTokenLinks m_previousTokens; // link to last token(s) in spine
 
 		// nextNonNullTokens: This is a list of non-tokens in the spine
 		// that follow this one.
-		std::vector<HTp> m_nextNonNullTokens;
+		HumTokenLinks m_nextNonNullTokens;
 
 		// previousNonNullTokens: This is a list of non-tokens in the spine
 		// that preced this one.
-		std::vector<HTp> m_previousNonNullTokens;
+		HumTokenLinks m_previousNonNullTokens;
+
+		// m_nullresolve: used to point to the token that a null token
+		// refers to.
+		HTp m_nullresolve;
 
 		// rhycheck: Used to perfrom HumdrumFileStructure::analyzeRhythm
 		// recursively.
@@ -426,25 +524,33 @@ class HumdrumToken : public std::string, public HumHash {
 		// (not the 2-d one).
 		int m_strand;
 
-		// m_nullresolve: used to point to the token that a null token
-		// refers to.
-		HTp m_nullresolve;
+		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
+		bool m_rhythm_analyzed = false;
 
-		// m_linkedParameterTokens: List of Humdrum tokens which are parameters
-		// (mostly only layout parameters at the moment).
-		// Was previously called m_linkedParameters;
-		std::vector<HTp> m_linkedParameterTokens;
+		// ColdData: Data which only a few tokens in a file use.  It is
+		// allocated the first time that one of the values is set.
+		class ColdData {
+			public:
+				~ColdData() { delete m_parameterSet; }
 
-		// m_parameterSet: A single parameter encoded in the text of the
-		// token.  Was previously called m_linkedParameter.
-		HumParamSet* m_parameterSet = NULL;
+				// m_linkedParameterTokens: List of Humdrum tokens which are
+				// parameters (mostly only layout parameters at the moment).
+				// Was previously called m_linkedParameters;
+				std::vector<HTp> m_linkedParameterTokens;
 
-		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
-		bool m_rhythm_analyzed = false;
+				// m_parameterSet: A single parameter encoded in the text of the
+				// token.  Was previously called m_linkedParameter.
+				HumParamSet* m_parameterSet = NULL;
+
+				// m_strophe: Starting point of a strophe that the token belongs
+				// to.  NULL means that it is not in a strophe.
+				HTp m_strophe = NULL;
+		};
+
+		// m_cold: NULL if the token does not have any ColdData.
+		ColdData* m_cold = NULL;
 
-		// m_strophe: Starting point of a strophe that the token belongs to.
-		// NULL means that it is not in a strophe.
-		HTp m_strophe = NULL;
+		ColdData& getColdData(void);
 
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
@@ -0,0 +1,111 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 18:04:12 PDT 2026
+// Last Modified: Sat Oct 17 18:04:12 PDT 2026
+// Filename:      KeyEstimator.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/KeyEstimator.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Estimate the global key and local keys of a score by
+//                correlating duration-weighted pitch-class histograms
+//                with major/minor key profiles.  Local keys use a
+//                histogram over a window of slices centered on each
+//                data line, which is updated as the window moves through
+//                the score.
+//
+
+#ifndef _KEYESTIMATOR_H_INCLUDED
+#define _KEYESTIMATOR_H_INCLUDED
+
+#include "HumNum.h"
+#include "HumdrumFile.h"
+#include "PitchHistogram.h"
+
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class KeyEstimator {
+	public:
+		                    KeyEstimator          (void);
+
+		void                clear                 (void);
+		bool                setProfile            (const std::string& name);
+		const std::string&  getProfile            (void) const { return m_profile; }
+		void                setWindow             (HumNum duration) { m_window = duration; }
+		void                setMinimumDuration    (HumNum duration) { m_minimum = duration; }
+		void                analyze               (HumdrumFile& infile);
+
+		// Key of the whole score:
+		int                 getGlobalKey          (void) const { return m_globalKey; }
+		double              getGlobalCorrelation  (void) const { return m_globalCorrelation; }
+		const std::string&  getGlobalKeyName      (void) const { return m_globalName; }
+		std::string         getGlobalKeyDesignation(void) const;
+
+		// Local key at each line of the score (the correlation is for the
+		// best key in the window before smoothing):
+		int                 getKey                (int line) const { return m_keys.at(line); }
+		double              getCorrelation        (int line) const { return m_correlations.at(line); }
+		const std::string&  getKeyName            (int line) const { return m_names.at(line); }
+		std::string         getKeyDesignation     (int line) const;
+		void                getKeyChanges         (std::vector<int>& lines) const;
+
+		// Key numbers are 0-11 for major keys and 12-23 for minor keys
+		// (C=0, C#/D-=1, ... B=11), or -1 if unknown:
+		static bool         isMinor               (int key) { return key >= 12; }
+		static int          getTonic              (int key) { return key < 0 ? -1 : key % 12; }
+
+		void                correlate             (double* correlations,
+		                                           const PitchClassHistogram& histogram) const;
+		int                 getBestKey            (const PitchClassHistogram& histogram,
+		                                           double& correlation) const;
+		static std::string  spellKey              (int key, const PitchClassHistogram& histogram);
+
+	protected:
+		void                prepareWeights        (const double* major, const double* minor);
+		void                getSliceNotes         (HumdrumFile& infile);
+		void                smoothKeys            (std::vector<int>& keys);
+		static std::string  makeDesignation       (const std::string& name);
+
+	private:
+		std::string           m_profile;
+		HumNum                m_window  = 16;  // duration of window in quarter notes
+		HumNum                m_minimum = -1;  // shortest local key region (-1 = window/2)
+
+		// m_weights: key profiles rotated to all 24 keys, centered on
+		// zero and scaled to unit length, so that the Pearson correlation
+		// with a histogram is one dot product per key.
+		double                m_weights[24][12];
+
+		// Sounding notes in each data line (slice): m_noteStart[i] is the
+		// first entry in m_notes for slice i, and each note is weighted by
+		// the duration of the slice.
+		std::vector<int>      m_slices;      // line index of each slice
+		std::vector<HumNum>   m_times;       // start time of each slice
+		std::vector<double>   m_durations;   // duration of each slice
+		std::vector<int>      m_noteStart;
+		std::vector<int>      m_notes;       // base-40 pitches
+		HumNum                m_scoreDuration;
+
+		// Results:
+		int                      m_globalKey = -1;
+		double                   m_globalCorrelation = 0.0;
+		std::string              m_globalName;
+		std::vector<int>         m_keys;
+		std::vector<double>      m_correlations;
+		std::vector<std::string> m_names;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _KEYESTIMATOR_H_INCLUDED */
+
+
+
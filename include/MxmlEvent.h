@@ -127,6 +127,7 @@ class MxmlEvent {
 		void               reportFiguredBassToOwner   (void);
 		void               reportCaesuraToOwner       (const std::string& letter = "Z") const;
 		void               reportOrnamentToOwner      (void) const;
+		int                getNextSequenceNumber      (void);
       void               makeDummyRest      (MxmlMeasure* owner,
 		                                       HumNum startime,
 		                                       HumNum duration,
@@ -160,8 +161,7 @@ class MxmlEvent {
 		MxmlMeasure*       m_owner;        // measure that contains this event
 		std::vector<MxmlEvent*> m_links;   // list of secondary chord notes
 		bool               m_linked;       // true if a secondary chord note
-		int                m_sequence;     // ordering of event in XML file
-		static int         m_counter;      // counter for sequence variable
+		int                m_sequence;     // ordering of event in XML part
 		short              m_staff;        // staff number in part for event
 		short              m_voice;        // voice number in part for event
 		int                m_voiceindex;   // voice index of item (remapping)
@@ -103,6 +103,7 @@ class MxmlPart {
 		string               m_partabbr;
 		string               m_caesura;
 		bool                 m_hasOrnaments = false;
+		int                  m_eventcount = 0;  // for MxmlEvent sequence numbers
 
 		// m_staffvoicehist: counts of staff and voice numbers.
 		// staff=0 is used for items such as measures.
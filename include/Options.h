@@ -15,15 +15,21 @@
 #ifndef _OPTIONS_H_INCLUDED
 #define _OPTIONS_H_INCLUDED
 
-#include <vector>
-#include <map>
-#include <string>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace hum {
 
 // START_MERGE
 
+// Option_register: an option definition with its value.  The Options class
+// now stores definitions in an OptionSchema and values in OptionValue.
+
 class Option_register {
 	public:
 		                 Option_register (void);
@@ -62,6 +68,57 @@ class Option_register {
 };
 
 
+// OptionSchema: an immutable list of parsed option definitions.  Schemas
+// are shared between all Options objects which define the same options
+// in the same order (such as all instances of a tool class): each schema
+// keeps the schemas made by adding one more definition to it, so a
+// definition string is only parsed the first time it is added.  At most
+// OPTION_MAX_SCHEMAS schemas are kept (in case options are defined from
+// data rather than with fixed strings); later schemas are not shared.
+
+class OptionSchema {
+	public:
+		class Entry {
+			public:
+				std::string m_definition;
+				std::string m_description;
+				std::string m_default;
+				char        m_type = 's';
+		};
+
+		int          getSize       (void) const { return (int)m_entries.size(); }
+		const Entry& getEntry      (int index) const { return *m_entries[index]; }
+		int          getIndex      (const std::string& name) const;
+		const std::unordered_map<std::string, int>& getNames(void) const
+		                                            { return m_names; }
+		std::shared_ptr<const OptionSchema> extend(const std::string& definition,
+		                                    const std::string& description,
+		                                    std::string& error) const;
+		static std::shared_ptr<const OptionSchema> getEmpty(void);
+
+	private:
+		std::vector<std::shared_ptr<const Entry>> m_entries;
+
+		// m_names: index of the entry for each option name and alias.
+		std::unordered_map<std::string, int> m_names;
+
+		// m_extensions: schemas made from this one by extend(), indexed
+		// by the added definition.
+		mutable std::unordered_multimap<std::string,
+				std::shared_ptr<const OptionSchema>> m_extensions;
+		mutable std::mutex m_mutex;
+};
+
+
+// OptionValue: the command-line value of an option.
+
+class OptionValue {
+	public:
+		std::string m_value;
+		bool        m_modifiedQ = false;
+};
+
+
 class Options {
 	public:
 		                Options           (void);
@@ -138,16 +195,18 @@ class Options {
 		// are not options, or the command (argv[0]);
 		std::vector<std::string> m_arguments;
 
-		// m_optionRegister: store for the states/values of each option.
-		std::vector<Option_register*> m_optionRegister;
+		// m_schema: the option definitions, shared with other Options
+		// objects which have the same definitions.
+		std::shared_ptr<const OptionSchema> m_schema = OptionSchema::getEmpty();
+
+		// m_values: command-line values of the options, indexed in the
+		// same way as the definitions in m_schema.
+		std::vector<OptionValue> m_values;
 
 		// m_optionFlag: the character which indicates an option.
 		// Generally a dash, but could be made a slash for Windows environments.
 		char m_optionFlag = '-';
 
-		// m_optionList:
-		std::map<std::string, int> m_optionList;
-
 		//
 		// boolern options for object:
 		//
@@ -168,10 +227,12 @@ class Options {
 		bool m_optionsArgQ = false;
 
 		// m_error: used to store errors in parsing command-line options.
-		std::stringstream m_error;
+		// It is allocated by getErrorStream() when the first error occurs.
+		std::unique_ptr<std::stringstream> m_error;
 
 	protected:
 		int     getRegIndex    (const std::string& optionName);
+		std::stringstream& getErrorStream(void);
 		bool    isOption       (const std::string& aString, int& argp);
 		int     storeOption    (int gargp, int& position, int& running);
 
@@ -185,6 +246,9 @@ class Options {
 #define OPTION_STRING_TYPE    's'
 #define OPTION_UNKNOWN_TYPE   'x'
 
+// Maximum number of option schemas which are kept for sharing:
+#define OPTION_MAX_SCHEMAS    10000
+
 
 // END_MERGE
 
@@ -0,0 +1,121 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 11:02:37 PDT 2026
+// Last Modified: Sat Oct 17 11:02:37 PDT 2026
+// Filename:      PitchHistogram.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/PitchHistogram.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Fixed-size pitch histograms shared by pitch-counting tools.
+//                PitchClassHistogram stores base-7, base-12 and base-40
+//                pitch-class bins, PitchHistogram adds absolute pitch
+//                bins for range analysis, and PitchProfile reduces range,
+//                pitch-class and per-measure histograms over a corpus.
+//
+
+#ifndef _PITCHHISTOGRAM_H_INCLUDED
+#define _PITCHHISTOGRAM_H_INCLUDED
+
+#include "HumdrumFile.h"
+#include "HumdrumFileSet.h"
+#include "HumdrumFileStream.h"
+
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class PitchClassHistogram {
+	public:
+		                     PitchClassHistogram (void);
+
+		void                 clear               (void);
+		bool                 addBase40           (int base40, double weight = 1.0);
+		bool                 addKern             (const std::string& kern, double weight = 1.0);
+		double               getBase7            (int pc) const { return m_base7[pc];  }
+		double               getBase12           (int pc) const { return m_base12[pc]; }
+		double               getBase40           (int pc) const { return m_base40[pc]; }
+		std::vector<double>  getBase7Vector      (void) const;
+		std::vector<double>  getBase12Vector     (void) const;
+		std::vector<double>  getBase40Vector     (void) const;
+		double               getTotal            (void) const;
+		double               getMaximum          (void) const;
+		bool                 isEmpty             (void) const;
+		PitchClassHistogram& operator+=          (const PitchClassHistogram& other);
+
+	protected:
+		double m_base7[7];
+		double m_base12[12];
+		double m_base40[40];
+};
+
+
+
+class PitchHistogram {
+	public:
+		// Absolute pitches are stored from octave -3 to octave 8 (middle C
+		// is in octave 4):
+		static const int MINOCTAVE = -3;
+		static const int OCTAVES   = 12;
+
+		                     PitchHistogram      (void);
+
+		void                 clear               (void);
+		bool                 addBase40           (int base40, double weight = 1.0);
+		bool                 addKern             (const std::string& kern, double weight = 1.0);
+		double               getBase40           (int base40) const;
+		double               getBase7            (int base7) const;
+		double               getDiatonic         (int base7, int acc) const;
+		double               getMidi             (int key) const;
+		int                  getLowestBase40     (void) const;
+		int                  getHighestBase40    (void) const;
+		const PitchClassHistogram& getPitchClasses (void) const { return m_pitchClasses; }
+		PitchHistogram&      operator+=          (const PitchHistogram& other);
+
+	protected:
+		PitchClassHistogram m_pitchClasses;
+		double              m_base40[OCTAVES * 40];
+		double              m_base7[OCTAVES * 7];
+		double              m_midi[128];
+};
+
+
+
+class PitchProfile {
+	public:
+		                     PitchProfile        (void);
+
+		void                 clear               (void);
+		void                 setAttacks          (bool state) { m_attacks = state; }
+		void                 analyze             (HumdrumFile& infile);
+		int                  analyze             (HumdrumFileSet& infiles, int threads = 1);
+		int                  analyze             (HumdrumFileStream& instream, int threads = 1);
+		PitchProfile&        operator+=          (const PitchProfile& other);
+
+		int                  getFileCount        (void) const { return m_files; }
+		const PitchHistogram& getRange           (void) const { return m_range; }
+		const PitchClassHistogram& getPitchClasses (void) const { return m_range.getPitchClasses(); }
+		int                  getMeasureCount     (void) const { return (int)m_measures.size(); }
+		const PitchClassHistogram& getMeasure    (int index) const { return m_measures.at(index); }
+		const std::string&   getMeasureLabel     (int index) const { return m_labels.at(index); }
+
+	protected:
+		bool                             m_attacks = false; // count attacks rather than durations
+		int                              m_files   = 0;     // number of files analyzed
+		PitchHistogram                   m_range;           // total for all files
+		std::vector<PitchClassHistogram> m_measures;        // one entry for each measure
+		std::vector<std::string>         m_labels;          // filename:measure for each measure
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _PITCHHISTOGRAM_H_INCLUDED */
+
+
+
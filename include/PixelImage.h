@@ -0,0 +1,74 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:05:48 PDT 2026
+// Last Modified: Sat Oct 17 19:05:48 PDT 2026
+// Filename:      PixelImage.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/PixelImage.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   RGB raster image for PixelColor-based image tools.
+//                Rows are stored as packed RGB bytes together with a
+//                repeat count, so images that are stretched vertically
+//                only store each distinct row once.  Images can be
+//                written as binary (P6) or ASCII (P3) PPM files, or as
+//                PNG files with uncompressed (stored) deflate blocks.
+//
+
+#ifndef _PIXELIMAGE_H_INCLUDED
+#define _PIXELIMAGE_H_INCLUDED
+
+#include "PixelColor.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class PixelImage {
+	public:
+		                PixelImage      (void);
+		                PixelImage      (int width, int height);
+
+		void            clear           (void);
+		void            setSize         (int width, int height);
+		int             getWidth        (void) const { return m_width; }
+		int             getHeight       (void) const;
+
+		// Access to the stored rows (each of which can be repeated in the
+		// image):
+		int             getRowCount     (void) const { return (int)m_repeats.size(); }
+		int             getRowRepeat    (int row) const { return m_repeats.at(row); }
+		void            setRowRepeat    (int row, int count);
+		unsigned char*  getRowData      (int row);
+		PixelColor      getPixel        (int row, int column) const;
+		void            setPixel        (int row, int column, const PixelColor& color);
+
+		int             addRow          (const std::vector<PixelColor>& pixels,
+		                                 int hrepeat = 1, int vrepeat = 1,
+		                                 int shift = 0);
+
+		void            writePpm6       (std::ostream& out) const;
+		void            writePpm3       (std::ostream& out) const;
+		void            writePng        (std::ostream& out) const;
+		bool            write           (std::ostream& out,
+		                                 const std::string& format) const;
+
+	private:
+		int                        m_width = 0;
+		std::vector<unsigned char> m_pixels;   // RGB bytes of stored rows
+		std::vector<int>           m_repeats;  // repeat count of stored rows
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _PIXELIMAGE_H_INCLUDED */
+
+
+
@@ -16,9 +16,11 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "KeyEstimator.h"
 
 #include <ostream>
 #include <string>
+#include <vector>
 
 namespace hum {
 
@@ -39,14 +41,26 @@ class Tool_addkey : public HumTool {
 		void    initialize         (void);
 		void    getLineIndexes     (HumdrumFile& infile);
 		void    insertReferenceKey (HumdrumFile& infile);
+		void    insertEstimatedKey (HumdrumFile& infile);
+		void    insertKey          (HumdrumFile& infile, const std::string& desig);
 		void    addInputKey        (HumdrumFile& infile);
 		void    insertKeyDesig     (HumdrumFile& infile, const std::string& keyDesig);
 		void    printKeyDesig      (HumdrumFile& infile, int index, const std::string& desig, int direction);
+		void    printKeyLine       (HumdrumFile& infile, int index, const std::string& desig);
+		void    printLine          (HumdrumFile& infile, int index);
 
 	private:
 		std::string m_key;
 		bool        m_keyQ           = false;
 		bool        m_addKeyRefQ     = false;
+		bool        m_estimateQ      = false;
+		bool        m_localQ         = false;
+		double      m_window         = 16.0;
+
+		// m_localKeys: estimated key designation to print before each line
+		// where the local key changes (used with -l option).
+		KeyEstimator             m_estimator;
+		std::vector<std::string> m_localKeys;
 
 		int         m_exinterpIndex  = -1;
 		int         m_refKeyIndex    = -1;
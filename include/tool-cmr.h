@@ -17,6 +17,7 @@
 #include "HumTool.h"
 #include "HumdrumFile.h"
 
+#include <cstdint>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -49,7 +50,8 @@ class cmr_note_info {
 		std::string   getPitch         (void);
 		HTp      getToken         (void);
 		int      getLineIndex     (void);
-		double   getNoteStrength  (void);
+		double   getNoteStrength  (double syncopationWeight = 1.0,
+		                           double leapWeight = 0.5);
 		bool     hasSyncopation   (void);
 		bool     hasLeapBefore    (void);
 		void     markNote         (const std::string& marker);
@@ -59,9 +61,6 @@ class cmr_note_info {
 		static bool   isSyncopated(HTp token);
 		static bool   isLeapBefore(HTp token);
 
-		static double m_syncopationWeight;
-		static double m_leapWeight;
-
 	private:
 		std::vector<HTp> m_tokens;    // List of tokens for the notes (first entry is note attack);
 
@@ -115,7 +114,8 @@ class cmr_group_info {
 		HumNum  getEndTime         (void);
 		HumNum  getGroupDuration   (void);
 		HumNum  getStartTime       (void);
-		double  getGroupStrength   (void);
+		double  getGroupStrength   (double syncopationWeight = 1.0,
+		                            double leapWeight = 0.5);
 		bool    mergeGroup         (cmr_group_info& group);
 		std::ostream& printNotes   (std::ostream& output = std::cout, const std::string& marker = "");
 
@@ -126,6 +126,30 @@ class cmr_group_info {
 };
 
 
+//////////////////////////////
+//
+// cmr_range_max -- Sparse table for constant-time maximum queries over
+//     an index range of a fixed integer sequence (such as the MIDI note
+//     numbers of a part).
+//
+
+class cmr_range_max {
+	public:
+		        cmr_range_max      (void) {};
+		void    clear              (void);
+		void    build              (const std::vector<int>& values);
+		int     getMaximum         (int index1, int index2) const;
+		int     findFirstAbove     (int index1, int index2, int threshold) const;
+		int     findLastAbove      (int index1, int index2, int threshold) const;
+
+	private:
+		// m_table[k][i] == maximum of values i through i+2^k-1.
+		std::vector<std::vector<int>> m_table;
+		// m_log2[n] == floor(log2(n)) for range lengths.
+		std::vector<int> m_log2;
+};
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 class Tool_cmr : public HumTool {
@@ -137,6 +161,7 @@ class Tool_cmr : public HumTool {
 		bool             run                     (HumdrumFile& infile);
 		bool             run                     (const std::string& indata, std::ostream& out);
 		bool             run                     (HumdrumFile& infile, std::ostream& out);
+		bool             run                     (HumdrumFileStream& instream);
 		void             finally                 (void);
 
 	protected:
@@ -189,9 +214,11 @@ class Tool_cmr : public HumTool {
 		void             getPartNames            (std::vector<std::string>& partNames, HumdrumFile& infile);
 		void             checkForCmr             (int index, int direction, HumdrumFile& infile);
 		bool             hasHigher               (int pitch, int tolerance,
-		                                          std::vector<int>& midinums,
-		                                          std::vector<std::vector<HTp>>& notelist,
 		                                          int index1, int index2);
+		void             prepareRangeQueries     (HumdrumFile& infile);
+		bool             isCorpusMode            (void);
+		void             processCorpus           (HumdrumFileSet& infiles);
+		void             mergeCorpusResults      (Tool_cmr& worker);
 		bool             hasGroupUp              (void);
 		bool             hasGroupDown            (void);
 		void             getVocalRange           (std::vector<std::string>& minpitch,
@@ -221,9 +248,12 @@ class Tool_cmr : public HumTool {
 		bool        m_notelistQ   = false;       // used with --notelist option
 		bool        m_debugQ      = false;       // used with --debug option
 		bool        m_numberQ     = false;       // used with -N option
+		int         m_threads     = 1;           // used with -j option: threads for corpus statistics
 		double      m_smallRest   = 4.0;         // Ignore rests that are 1 whole note or less
 		double      m_cmrDur      = 24.0;        // 6 whole notes maximum between m_cmrNum local maximums
 		double      m_cmrNum      = 3;           // number of local maximums in a row needed to mark in score
+		double      m_syncopationWeight = 1.0;   // strength added for syncopated notes
+		double      m_leapWeight  = 0.5;         // strength added for notes after a leap
 		int         m_noteCount   = 0;           // total number of notes in the score
 		int         m_local_count = 0;           // used for coloring local peaks
 		std::string m_colorUp     = "red";       // color to mark peak cmr notes
@@ -276,6 +306,16 @@ class Tool_cmr : public HumTool {
 		std::vector<bool>        m_syncopation;   // True if note is syncopated.
 		std::vector<bool>        m_leapbefore;    // True if note has a leap before it.
 
+		// range-query data for CMR window checks (reset for each part)
+		std::vector<int64_t>     m_onsets;        // note onset times in ticks (file tpq)
+		int64_t                  m_cmrTicks = 0;  // m_cmrDur in ticks
+		std::vector<bool>        m_strongBeat;    // True if note is on a strong beat.
+		std::vector<bool>        m_accented;      // True if note can be a CMR note other than the trigger.
+		std::vector<int>         m_nextSame;      // index of next note with same pitch (-1 if none)
+		std::vector<int>         m_prevSame;      // index of previous note with same pitch (-1 if none)
+		cmr_range_max            m_pitchMax;      // maximum pitch in a range of notes
+		cmr_range_max            m_strongMax;     // maximum pitch of strong-beat notes in a range
+
 		// Summary statistics variables:
 		std::vector<int>         m_cmrCount;       // number of CMRs in each input file
 		std::vector<int>         m_cmrNoteCount;   // number of CMR notes in each input file
@@ -16,6 +16,7 @@
 #include "HumTool.h"
 #include "HumdrumFile.h"
 
+#include <cstdint>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -24,6 +25,36 @@ namespace hum {
 
 // START_MERGE
 
+class OnsetBitmap {
+	public:
+		            OnsetBitmap          (void) {};
+		            OnsetBitmap          (int size) { resize(size); }
+		           ~OnsetBitmap          () {};
+
+		void        resize               (int size);
+		int         getSize              (void) const { return m_size; }
+		void        clear                (void);
+		void        set                  (int index);
+		void        unset                (int index);
+		bool        test                 (int index) const;
+		int         count                (void) const;
+		int         next                 (int index) const;
+		int         first                (void) const { return next(0); }
+		void        clearBefore          (int index);
+
+		OnsetBitmap& operator|=          (const OnsetBitmap& other);
+		OnsetBitmap& operator&=          (const OnsetBitmap& other);
+		OnsetBitmap& andNot              (const OnsetBitmap& other);
+		OnsetBitmap& invert              (void);
+		OnsetBitmap& shiftUp             (void);
+
+	private:
+		std::vector<uint64_t> m_words;
+		int                   m_size = 0;
+};
+
+
+
 class Tool_composite : public HumTool {
 	public:
 		            Tool_composite       (void);
@@ -50,8 +81,6 @@ class Tool_composite : public HumTool {
 		void        extractGroup              (HumdrumFile& infile, const std::string &target);
 		void        getNumericGroupStates     (std::vector<int>& states, HumdrumFile& infile, const std::string& tgroup);
 		int         getGroupNoteType          (HumdrumFile& infile, int line, const std::string& group);
-		HumNum      getLineDuration           (HumdrumFile& infile, int index,
-		                                       std::vector<int>& isNull);
 		void        backfillGroup             (std::vector<std::vector<std::string>>& curgroup,
 		                                       HumdrumFile& infile, int line, int track,
 		                                       int subtrack, const std::string& group);
@@ -69,6 +98,10 @@ class Tool_composite : public HumTool {
 		void        getGroupDurations         (std::vector<HumNum>& groupdurs,
 		                                       std::vector<int>& groupstates,
 		                                       HumdrumFile& infile);
+		void        buildOnsetBitmaps         (HumdrumFile& infile);
+		void        getStateBitmap            (OnsetBitmap& bitmap, std::vector<int>& states,
+		                                       int minstate, int maxstate);
+		HumNum      getSliceDuration          (int startslice, int endslice);
 		void        printGroupAssignments     (HumdrumFile& infile);
 		void        getGroupRhythms           (std::vector<std::vector<std::string>>& rhythms,
 		                                       std::vector<std::vector<HumNum>>& groupdurs,
@@ -93,7 +126,6 @@ class Tool_composite : public HumTool {
 		HTp         fixBadRestRhythm          (HTp token, std::string& rhythm, HumNum tstop, HumNum tsbot);
 		std::string generateSizeLine          (HumdrumFile& output, HumdrumFile& input, int line);
 		void        convertNotesToRhythms     (HumdrumFile& infile);
-		int         getEventCount             (std::vector<std::string>& data);
 		void        fixTiedNotes              (std::vector<std::string>& data, HumdrumFile& infile);
 		void        doOnsetAnalysisCoincidence(std::vector<double>& output,
 		                                       std::vector<double>& inputA, std::vector<double>& inputB);
@@ -147,6 +179,23 @@ class Tool_composite : public HumTool {
 		std::vector<std::string> m_coincidence;
 		std::vector<std::vector<std::string>> m_groups;  // Groups A and B
 
+		// Onset bitmaps: one bit for each data line (slice) in the input file.
+		// Slice times are stored as integer ticks (file tpq) so that
+		// durations are only converted to HumNum when rendering rhythms.
+		std::vector<int>         m_sliceLine;      // line index of each slice
+		std::vector<int>         m_lineSlice;      // slice index of each line (-1 = none)
+		std::vector<int64_t>     m_sliceTick;      // start time of each slice in ticks
+		std::vector<int64_t>     m_lineTick;       // start time of each line in ticks
+		int64_t                  m_endTick = 0;    // start time of last line in ticks
+		int                      m_tpq     = 1;    // ticks per quarter note
+		OnsetBitmap              m_nonNullSlices;  // slices with a non-null token
+		OnsetBitmap              m_graceSlices;    // slices with zero duration
+		std::vector<OnsetBitmap> m_voiceNotes;     // notes sounding per **kern track
+		std::vector<OnsetBitmap> m_voiceAttacks;   // note attacks per **kern track
+		OnsetBitmap              m_fullCompositeEvents;
+		OnsetBitmap              m_coincidenceEvents;
+		std::vector<OnsetBitmap> m_groupEvents;    // Groups A and B
+
 		// Numerical analysis variables:
 		bool        m_analysisOnsetsQ    = false;    // used with -P option
 		bool        m_analysisAccentsQ   = false;    // used with -A option
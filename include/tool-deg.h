@@ -18,6 +18,7 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "KeyEstimator.h"
 
 #include <ostream>
 #include <string>
@@ -35,6 +36,16 @@ class Tool_deg : public HumTool {
 	//
 
 	public: // Tool_deg class
+		// ScaleDegree rendering options, shared by the ScaleDegrees of
+		// one Tool_deg:
+		class ScaleDegreeOptions {
+			public:
+				bool        showTiesQ  = false;
+				bool        showZerosQ = false;
+				bool        octaveQ    = false;
+				std::string forcedKey;
+		};
+
 		class ScaleDegree;
 		class ScaleDegree {
 			public:  // ScaleDegree class
@@ -69,10 +80,8 @@ class Tool_deg : public HumTool {
 				int             getSubtokenCount         (void) const;
 
 				// output options:
-				static void     setShowTies    (bool state) { m_showTiesQ = state;  }
-				static void     setShowZeros   (bool state) { m_showZerosQ = state; }
-				static void     setShowOctaves (bool state) { m_octaveQ = state; }
-				static void     setForcedKey   (const std::string& key) { m_forcedKey = key; }
+				void            setOptions     (const ScaleDegreeOptions* options) { m_options = options; }
+				const ScaleDegreeOptions& getOptions (void) const;
 
 			protected:  // ScaleDegree class
 				std::string     generateDegDataToken     (void) const;
@@ -149,11 +158,8 @@ class Tool_deg : public HumTool {
 				ScaleDegree* m_prevRest = NULL;
 				ScaleDegree* m_nextRest = NULL;
 
-				// ScaleDegree rendering options:
-				static bool m_showTiesQ;
-				static bool m_showZerosQ;
-				static bool m_octaveQ;
-				static std::string m_forcedKey;
+				// m_options: rendering options (defaults if NULL).
+				const ScaleDegreeOptions* m_options = NULL;
 		};
 
 
@@ -251,6 +257,7 @@ class Tool_deg : public HumTool {
 		bool m_kernQ           = false;   // used with --kern option
 		bool m_degTiesQ        = false;   // used with -t option
 		bool m_forceKeyQ       = false;   // used with -K option
+		bool m_estimateKeyQ    = false;   // used with --estimate-key option
 
 		std::string m_defaultKey  = "";    // used with --default-key option
 		std::string m_forcedKey   = "";    // used with --forced-key option
@@ -260,6 +267,13 @@ class Tool_deg : public HumTool {
 
 		std::vector<bool> m_processTrack;  // used with -k and -s option
 
+		// m_degOptions: output options for the ScaleDegrees in m_degSpines.
+		ScaleDegreeOptions m_degOptions;
+
+		// m_keyEstimator: local keys for spines without key designations
+		// (used with --estimate-key option).
+		KeyEstimator m_keyEstimator;
+
 		class InterleavedPrintVariables {
 			public:
 				bool foundData;
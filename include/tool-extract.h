@@ -15,6 +15,12 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "HumdrumLineStream.h"
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace hum {
 
@@ -29,14 +35,21 @@ class Tool_extract : public HumTool {
 		bool     run                    (HumdrumFile& infile);
 		bool     run                    (const std::string& indata, std::ostream& out);
 		bool     run                    (HumdrumFile& infile, std::ostream& out);
+		bool     run                    (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 
-		// auto transpose functions:
-		void     initialize             (HumdrumFile& infile);
+		void     initialize             (void);
 
 		// function declarations
 		void    processFile             (HumdrumFile& infile);
+		bool    isStreamable            (void);
+		bool    processSegments         (HumdrumLineStream& instream, std::ostream& out);
+		bool    processSegment          (std::stringstream& segment,
+		                                 const std::string& filename, std::ostream& out);
+		int     getMaxFieldNumber       (const std::string& fieldstring);
+		void    extractLine             (HumdrumLineStream& line);
+		void    excludeLine             (HumdrumLineStream& line);
 		void    excludeFields           (HumdrumFile& infile, std::vector<int>& field,
 		                                 std::vector<int>& subfield, std::vector<int>& model);
 		void    extractFields           (HumdrumFile& infile, std::vector<int>& field,
@@ -52,9 +65,12 @@ class Tool_extract : public HumTool {
 		void    fillFieldData           (std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model, std::string& fieldstring,
 		                                 HumdrumFile& infile);
+		void    fillFieldData           (std::vector<int>& field, std::vector<int>& subfield,
+		                                 std::vector<int>& model, std::string& fieldstring,
+		                                 int maxtrack, HumdrumFile* infile);
 		void    processFieldEntry       (std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model, const std::string& astring,
-		                                 HumdrumFile& infile);
+		                                 int maxtrack, HumdrumFile* infile);
 		void    removeDollarsFromString (std::string& buffer, int maxtrack);
 		int     isInList                (int number, std::vector<int>& listofnum);
 		void    getTraceData            (std::vector<int>& startline,
@@ -65,6 +81,12 @@ class Tool_extract : public HumTool {
 		void    dealWithSpineManipulators(HumdrumFile& infile, int line,
 		                                 std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model);
+		void    dealWithSpineManipulators(const std::vector<std::string>& tokens,
+		                                 const std::vector<int>& tracks,
+		                                 const std::vector<std::string>& spineinfo,
+		                                 const std::string& linetext, int maxtrack,
+		                                 std::vector<int>& field, std::vector<int>& subfield,
+		                                 std::vector<int>& model);
 		void    storeToken              (std::vector<std::string>& storage,
 		                                 const std::string& string);
 		void    storeToken              (std::vector<std::string>& storage, int index,
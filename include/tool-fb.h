@@ -82,7 +82,7 @@ class Tool_fb : public HumTool {
 		vector<FiguredBassNumber*> getAbbreviatedNumbers                  (const vector<FiguredBassNumber*>& numbers);
 		string                     getNumberString                        (vector<FiguredBassNumber*> numbers);
 		string                     getKeySignature                        (HumdrumFile& infile, int lineIndex);
-		int                        getLowestBase40Pitch                   (vector<int> base40Pitches);
+		int                        getLowestBase40Pitch                   (const vector<int>& base40Pitches);
 		string                     getIntervalQuality                     (int basePitchBase40, int targetPitchBase40);
 
 
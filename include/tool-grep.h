@@ -15,6 +15,8 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "HumdrumLineStream.h"
+#include "HumRegex.h"
 
 #include <ostream>
 #include <string>
@@ -32,14 +34,17 @@ class Tool_grep : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, std::ostream& out);
 		bool     run               (HumdrumFile& infile, std::ostream& out);
+		bool     run               (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 		void      processFile         (HumdrumFile& infile);
+		bool      isPrintedLine       (const std::string& line);
 		void      initialize          (void);
 
 	private:
 		bool        m_negateQ;    // for the -v option
 		std::string m_regex;      // for the -e option
+		HumRegex    m_hre;
 
 };
 
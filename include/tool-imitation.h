@@ -17,10 +17,41 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 namespace hum {
 
 // START_MERGE
 
+class ImitationIndex {
+	public:
+		            ImitationIndex    (void) {};
+		           ~ImitationIndex    () {};
+
+		void        clear             (void) { m_positions.clear(); }
+		void        build             (const std::vector<uint64_t>& keys);
+		const std::vector<int>& find  (uint64_t key) const;
+
+		static void getSymbols        (std::vector<uint64_t>& symbols,
+		                               std::vector<NoteCell*>& attacks,
+		                               std::vector<double>& intervals,
+		                               bool negate, bool duration);
+		static void getWindowKeys     (std::vector<uint64_t>& keys,
+		                               const std::vector<uint64_t>& symbols,
+		                               int length);
+
+		static const uint64_t NoKey = 0;
+
+	private:
+		static const uint64_t RestBit = 0x8000000000000000ULL;
+		std::unordered_map<uint64_t, std::vector<int>> m_positions;
+		std::vector<int> m_empty;
+};
+
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -45,6 +76,11 @@ class Tool_imitation : public HumTool {
 		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
 		                            int i1, vector<NoteCell*>& attack2,
 		                            vector<double>& seq2, int i2);
+		bool    extendsBackward    (vector<NoteCell*>& attack1, vector<double>& seq1,
+		                            int i1, vector<NoteCell*>& attack2,
+		                            vector<double>& seq2, int i2);
+		void    prepareTargets     (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals);
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
@@ -61,7 +97,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;   // number of the current imitation
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
@@ -86,6 +122,14 @@ class Tool_imitation : public HumTool {
 		bool m_retrograde = false;
 
 		vector<int> m_barlines;
+
+		// Match search: window keys for each voice as initiator, index of
+		// window positions for each voice as target, and reversed voices
+		// for retrograde searches:
+		vector<vector<uint64_t>>  m_keys;
+		vector<ImitationIndex>    m_index;
+		vector<vector<NoteCell*>> m_retroAttacks;
+		vector<vector<double>>    m_retroIntervals;
 };
 
 // END_MERGE
@@ -14,6 +14,7 @@
 #define _TOOL_MSEARCH_H
 
 #include "HumTool.h"
+#include "HumWordIndex.h"
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 #include "Convert.h"
@@ -346,6 +347,7 @@ class Tool_msearch : public HumTool {
 		                            const std::string& input);
 		void    fillTextQuery      (vector<MSearchTextQuery>& query,
 		                            const std::string& input);
+		const HumWordIndex* getWordIndex(HumdrumFile& infile);
 		bool    checkForMusicMatch(vector<NoteCell*>& notes, int index,
 		                            vector<MSearchQueryToken>& dpcQuery,
 		                            vector<NoteCell*>& match);
@@ -382,6 +384,8 @@ class Tool_msearch : public HumTool {
 		std::vector<std::vector<NoteCell*>> m_matches;
 		std::vector<SonorityDatabase> m_sonorities;
 		std::vector<bool> m_sonoritiesChecked;
+		std::vector<HumWordIndex> m_wordIndexes;  // from --index file
+		bool        m_wordIndexesReadQ = false;
 		std::vector<pair<HTp, int>> m_tomark;
 };
 
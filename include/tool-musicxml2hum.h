@@ -26,6 +26,7 @@
 #include "MxmlEvent.h"
 #include "HumGrid.h"
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -207,6 +208,9 @@ class Tool_musicxml2hum : public HumTool {
 		std::string getHairpinString(pugi::xml_node element, int partindex);
 		std::string cleanSpaces     (const std::string& input);
 		void checkForDummyRests(MxmlMeasure* measure);
+		void attachHairpinEndings(MxmlMeasure* measure);
+		void preparePartEvents (std::vector<MxmlPart>& partdata);
+		void forEachPart       (int count, const std::function<void(int)>& process);
 		void reindexVoices     (std::vector<MxmlPart>& partdata);
 		void reindexMeasure    (MxmlMeasure* measure);
 		void setSoftwareInfo   (pugi::xml_document& doc);
@@ -230,6 +234,7 @@ class Tool_musicxml2hum : public HumTool {
 		bool VoiceDebugQ;
 		bool m_recipQ        = false;
 		bool m_stemsQ        = false;
+		int  m_threads       = 1;     // used with -j option: threads for parsing parts
 		int  m_slurabove     = 0;
 		int  m_slurbelow     = 0;
 		int  m_staffabove    = 0;
@@ -15,6 +15,7 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "PitchHistogram.h"
 
 #include <map>
 #include <ostream>
@@ -32,6 +33,7 @@ class Tool_pccount : public HumTool {
 		     ~Tool_pccount              () {};
 
 		bool  run                       (HumdrumFileSet& infiles);
+		bool  run                       (HumdrumFileStream& instream);
 		bool  run                       (HumdrumFile& infile);
 		bool  run                       (const std::string& indata, std::ostream& out);
 		bool  run                       (HumdrumFile& infile, std::ostream& out);
@@ -39,8 +41,10 @@ class Tool_pccount : public HumTool {
 	protected:
 		void   initialize               (HumdrumFile& infile);
 		void   processFile              (HumdrumFile& infile);
+		void   processCorpus            (HumdrumFileStream& instream);
 		void   initializePartInfo       (HumdrumFile& infile);
-		void   addCounts                (HTp sstart, HTp send);
+		void   addCounts                (std::vector<PitchClassHistogram>& histograms,
+		                                 HTp sstart, HTp send);
 		void   countPitches             (HumdrumFile& infile);
 		void   printHumdrumTable        (void);
 		void   printPitchClassList      (void);
@@ -15,6 +15,7 @@
 
 #include "HumTool.h"
 #include "HumdrumFileSet.h"
+#include "PitchHistogram.h"
 
 #include <map>
 #include <ostream>
@@ -31,6 +32,7 @@ class _VoiceInfo {
 	public:
 		std::vector<std::vector<double>>   diatonic;
 		std::vector<double>                midibins;
+		PitchHistogram                     histogram; // source of diatonic and midibins
 		std::string                        name;      // name for instrument name of spine
 		std::string                        abbr;      // abbreviation for instrument name of spine
 		int                                track;     // track number for spine
@@ -44,6 +46,7 @@ class _VoiceInfo {
 	public:
 		                _VoiceInfo        (void);
 		void            clear             (void);
+		void            loadHistogram     (void);
 		std::ostream&   print             (std::ostream& out);
 
 };
@@ -15,6 +15,8 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "HumdrumLineStream.h"
+#include "HumRegex.h"
 
 #include <ostream>
 #include <string>
@@ -32,9 +34,11 @@ class Tool_rid : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, std::ostream& out);
 		bool     run               (HumdrumFile& infile, std::ostream& out);
+		bool     run               (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 		void     processFile       (HumdrumFile& infile);
+		bool     isRemovedLine     (HumdrumLineStream& line);
 		void     initialize        (void);
 
 	private:
@@ -57,6 +61,8 @@ class Tool_rid : public HumTool {
 		int      option_k = 0;   // used with -k option
 		int      option_V = 0;   // used with -V option
 
+		HumRegex m_hre;          // used with -g option
+
 };
 
 // END_MERGE
@@ -42,9 +42,6 @@ class Tool_thru : public HumTool {
 		void      example             (void);
 		void      processData         (HumdrumFile& infile);
 		void      usage               (const char* command);
-		void      getLabelSequence    (std::vector<std::string>& labelsequence,
-		                               const std::string& astring);
-		int       getLabelIndex       (std::vector<std::string>& labels, std::string& key);
 		void      printLabelList      (HumdrumFile& infile);
 		void      printLabelInfo      (HumdrumFile& infile);
 		int       getBarline          (HumdrumFile& infile, int line);
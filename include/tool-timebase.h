@@ -25,6 +25,22 @@ namespace hum {
 
 // START_MERGE
 
+// Maximum number of lines that the shortest line of a file can be expanded
+// into when the timebase is the minimum time unit of the file:
+#define TIMEBASE_MAX_EXPANSION 16
+
+// TimebaseRun: a line of the input file and the number of timebase units
+// that it lasts.  Non-data lines and grace-note lines have 0 units.
+
+class TimebaseRun {
+	public:
+		int  m_line  = 0;
+		int  m_units = 0;
+		bool m_exact = true;  // false if the line duration is not a
+		                      // multiple of the timebase
+};
+
+
 class Tool_timebase : public HumTool {
 	public:
 		      Tool_timebase       (void);
@@ -35,16 +51,32 @@ class Tool_timebase : public HumTool {
 		bool  run                 (const std::string& indata, std::ostream& out);
 		bool  run                 (HumdrumFile& infile, std::ostream& out);
 
+		const std::vector<TimebaseRun>& getRuns(void) const { return m_runs; }
+
 	protected:
 		void   processFile         (HumdrumFile& infile);
 		HumNum getMinimumTime      (HumdrumFile& infile);
+		void   buildRuns           (HumdrumFile& infile, HumNum mindur);
 		void   expandScore         (HumdrumFile& infile, HumNum mindur);
+		void   collapseScore       (HumdrumFile& infile);
+		void   collapseText        (const std::string& indata);
+		void   getInputNulls       (const std::string& marker,
+		                            std::vector<bool>& output);
+		bool   isTimebaseMarker    (const char* text);
+		const std::string& getNullLine(int fieldCount);
 
 	private:
 		bool   m_grace   = false;
 		bool   m_quiet   = false;
 		HumNum m_basedur = false;
 
+		// m_runs: the input lines with their durations in timebase units.
+		std::vector<TimebaseRun> m_runs;
+
+		// m_nullLines: lines of null tokens (including the newline),
+		// indexed by field count.
+		std::vector<std::string> m_nullLines;
+
 };
 
 
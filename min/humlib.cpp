@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Mon Mar 10 11:43:34 PDT 2025
+// Last Modified: Sun Oct 18 02:22:27 UTC 2026
 // Filename:      min/humlib.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/min/humlib.cpp
 // Syntax:        C++11
@@ -38,6 +38,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "humlib.h"
 
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+using std::atomic;
+using std::fill;
+using std::get;
+using std::ios;
+using std::lock_guard;
+using std::make_unique;
+using std::max;
+using std::max_element;
+using std::min;
+using std::mutex;
+using std::next;
+using std::ofstream;
+using std::out_of_range;
+using std::thread;
+using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
+
 namespace hum {
 
 
@@ -5921,6 +5943,419 @@ int Convert::tempoNameToMm (const string& name, int bot, int top) {
 
 
 
+
+//////////////////////////////
+//
+// Window variances below this fraction of the running sum of squares
+// are rounding noise from subtracting the running sums, and the window
+// is considered to have no variation:
+//
+
+static const double corscape_tolerance = 1.0e-10;
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::CorrelationScape --
+//
+
+CorrelationScape::CorrelationScape(void) {
+	// do nothing
+}
+
+CorrelationScape::CorrelationScape(const vector<double>& x,
+		const vector<double>& y) {
+	setSequences(x, y);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::clear --
+//
+
+void CorrelationScape::clear(void) {
+	m_size = 0;
+	m_cycle = 0;
+	m_x.clear();
+	m_sumx.clear();
+	m_sumxx.clear();
+	m_y.clear();
+	m_sumy.clear();
+	m_sumyy.clear();
+	m_sumxy.clear();
+	m_combsum.clear();
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setSequences -- Store the running sums for
+//    correlating windows of x with the same windows of y.  If the
+//    sequences have different lengths, only the length of the shorter
+//    one is used.
+//
+
+void CorrelationScape::setSequences(const vector<double>& x,
+		const vector<double>& y) {
+	clear();
+	m_size = (int)min(x.size(), y.size());
+	vector<double> xx(x.begin(), x.begin() + m_size);
+	vector<double> yy(y.begin(), y.begin() + m_size);
+	prepareSums(m_sumx, m_sumxx, m_x, xx);
+	prepareSums(m_sumy, m_sumyy, m_y, yy);
+	m_sumxy.resize(m_size + 1);
+	m_sumxy[0] = 0.0;
+	for (int i=0; i<m_size; i++) {
+		m_sumxy[i+1] = m_sumxy[i] + m_x[i] * m_y[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setSequence -- Store the running sums for
+//    correlating windows of x with patterns.
+//
+
+void CorrelationScape::setSequence(const vector<double>& x) {
+	clear();
+	m_size = (int)x.size();
+	prepareSums(m_sumx, m_sumxx, m_x, x);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setCombCycle -- Set the cycle of the comb pattern
+//    used by getCombRow().  The pattern is 0, -1, -2, ..., -(cycle-1),
+//    repeated for the length of the window.  Must be called after the
+//    sequence is set.
+//
+
+void CorrelationScape::setCombCycle(int cycle) {
+	m_cycle = cycle;
+	m_combsum.clear();
+	if (m_cycle < 1) {
+		return;
+	}
+	m_combsum.resize(m_size);
+	for (int i=0; i<m_size; i++) {
+		m_combsum[i] = m_x[i];
+		if (i >= m_cycle) {
+			m_combsum[i] += m_combsum[i - m_cycle];
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCorrelation -- Return the correlation of the
+//    window of x starting at the given index with the same window of y,
+//    or of the window of x with the pattern (which has the length of the
+//    window).
+//
+
+double CorrelationScape::getCorrelation(int start, int length) const {
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	if (m_y.empty()) {
+		return NAN;
+	}
+	double xtolerance;
+	double ytolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	double yvariance = getVariance(m_sumy, m_sumyy, start, length, ytolerance);
+	int end = start + length;
+	double sumx = m_sumx[end] - m_sumx[start];
+	double sumy = m_sumy[end] - m_sumy[start];
+	double covariance = m_sumxy[end] - m_sumxy[start] - sumx * sumy / length;
+	return correlate(covariance, xvariance, xtolerance, yvariance, ytolerance);
+}
+
+
+double CorrelationScape::getCorrelation(int start,
+		const vector<double>& pattern) const {
+	int length = (int)pattern.size();
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	vector<double> centered;
+	double variance;
+	double tolerance;
+	preparePattern(centered, variance, tolerance, pattern);
+	return getPatternCorrelation(start, centered, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombCorrelation -- Return the correlation of the
+//    window of x starting at the given index with the comb pattern.
+//
+
+double CorrelationScape::getCombCorrelation(int start, int length) const {
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	if (m_cycle < 1) {
+		return NAN;
+	}
+	double sum;
+	double variance;
+	double tolerance;
+	prepareComb(sum, variance, tolerance, length);
+	return getCombCorrelation(start, length, sum, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getRow -- Calculate the correlations of all windows
+//    with the given length (or the length of the pattern) starting at
+//    indexes 0 to row.size()-1.
+//
+
+bool CorrelationScape::getRow(vector<double>& row, int length) const {
+	int count = (int)row.size();
+	if ((length < 1) || (count + length - 1 > m_size) || m_y.empty()) {
+		return false;
+	}
+	for (int i=0; i<count; i++) {
+		row[i] = getCorrelation(i, length);
+	}
+	return true;
+}
+
+
+bool CorrelationScape::getRow(vector<double>& row,
+		const vector<double>& pattern) const {
+	int count = (int)row.size();
+	int length = (int)pattern.size();
+	if ((length < 1) || (count + length - 1 > m_size)) {
+		return false;
+	}
+
+	vector<double> centered;
+	double variance;
+	double tolerance;
+	preparePattern(centered, variance, tolerance, pattern);
+	for (int i=0; i<count; i++) {
+		row[i] = getPatternCorrelation(i, centered, variance, tolerance);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombRow -- Calculate the correlations of the comb
+//    pattern with all windows of the given length starting at indexes 0
+//    to row.size()-1.
+//
+
+bool CorrelationScape::getCombRow(vector<double>& row, int length) const {
+	int count = (int)row.size();
+	if ((length < 1) || (count + length - 1 > m_size) || (m_cycle < 1)) {
+		return false;
+	}
+
+	double sum;
+	double variance;
+	double tolerance;
+	prepareComb(sum, variance, tolerance, length);
+	for (int i=0; i<count; i++) {
+		row[i] = getCombCorrelation(i, length, sum, variance, tolerance);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::prepareSums -- Subtract the mean from the input
+//    sequence and calculate the running sums of the values and their
+//    squares.  Centering the values keeps the running sums small, so
+//    that little precision is lost when subtracting them.
+//
+
+void CorrelationScape::prepareSums(vector<double>& sum, vector<double>& sumsq,
+		vector<double>& centered, const vector<double>& input) {
+	int size = (int)input.size();
+	double mean = 0.0;
+	for (int i=0; i<size; i++) {
+		mean += input[i];
+	}
+	if (size > 0) {
+		mean /= size;
+	}
+	centered.resize(size);
+	sum.resize(size + 1);
+	sumsq.resize(size + 1);
+	sum[0] = 0.0;
+	sumsq[0] = 0.0;
+	for (int i=0; i<size; i++) {
+		centered[i] = input[i] - mean;
+		sum[i+1] = sum[i] + centered[i];
+		sumsq[i+1] = sumsq[i] + centered[i] * centered[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::preparePattern -- Subtract the mean from a pattern
+//    and calculate the sum of its squared deviations.
+//
+
+void CorrelationScape::preparePattern(vector<double>& centered,
+		double& variance, double& tolerance, const vector<double>& pattern) {
+	int length = (int)pattern.size();
+	double mean = 0.0;
+	for (int i=0; i<length; i++) {
+		mean += pattern[i];
+	}
+	mean /= length;
+	centered.resize(length);
+	variance = 0.0;
+	double sumsq = 0.0;
+	for (int i=0; i<length; i++) {
+		centered[i] = pattern[i] - mean;
+		variance += centered[i] * centered[i];
+		sumsq += pattern[i] * pattern[i];
+	}
+	tolerance = sumsq * corscape_tolerance;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::prepareComb -- Calculate the sum and the sum of the
+//    squared deviations of the comb pattern for a window length.  The
+//    value -r occurs once in every cycle.
+//
+
+void CorrelationScape::prepareComb(double& sum, double& variance,
+		double& tolerance, int length) const {
+	sum = 0.0;
+	double sumsq = 0.0;
+	for (int r=1; (r<m_cycle) && (r<length); r++) {
+		int occurrences = (length - r + m_cycle - 1) / m_cycle;
+		sum -= (double)r * occurrences;
+		sumsq += (double)r * r * occurrences;
+	}
+	variance = sumsq - sum * sum / length;
+	tolerance = sumsq * corscape_tolerance;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getVariance -- Return the sum of the squared
+//    deviations from the mean in a window (the variance multiplied by
+//    the window length).  The tolerance is the largest rounding error
+//    expected for the result.
+//
+
+double CorrelationScape::getVariance(const vector<double>& sum,
+		const vector<double>& sumsq, int start, int length,
+		double& tolerance) const {
+	int end = start + length;
+	double wsum = sum[end] - sum[start];
+	tolerance = sumsq[end] * corscape_tolerance;
+	return sumsq[end] - sumsq[start] - wsum * wsum / length;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getPatternCorrelation -- Correlate the window of x
+//    starting at the given index with a pattern which has had its mean
+//    removed.
+//
+
+double CorrelationScape::getPatternCorrelation(int start,
+		const vector<double>& pattern, double variance, double tolerance) const {
+	int length = (int)pattern.size();
+	double xtolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	const double* x = m_x.data() + start;
+	double covariance = 0.0;
+	for (int i=0; i<length; i++) {
+		covariance += x[i] * pattern[i];
+	}
+	return correlate(covariance, xvariance, xtolerance, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombCorrelation -- Correlate the window of x
+//    starting at the given index with the comb pattern.  The products of
+//    the window and the pattern are summed separately for each position
+//    in the cycle using the running sums over every m_cycle-th value.
+//
+
+double CorrelationScape::getCombCorrelation(int start, int length,
+		double patternsum, double variance, double tolerance) const {
+	double xtolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	double product = 0.0;
+	for (int r=1; (r<m_cycle) && (r<length); r++) {
+		int first = start + r;
+		int last = first + ((length - 1 - r) / m_cycle) * m_cycle;
+		double total = m_combsum[last];
+		if (first >= m_cycle) {
+			total -= m_combsum[first - m_cycle];
+		}
+		product -= r * total;
+	}
+	double sumx = m_sumx[start + length] - m_sumx[start];
+	double covariance = product - sumx * patternsum / length;
+	return correlate(covariance, xvariance, xtolerance, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::correlate -- Return the correlation for the given
+//    covariance and variances, or NAN if either variance is zero.
+//
+
+double CorrelationScape::correlate(double covariance, double xvariance,
+		double xtolerance, double yvariance, double ytolerance) {
+	if ((xvariance <= xtolerance) || (yvariance <= ytolerance)) {
+		return NAN;
+	}
+	double output = covariance / sqrt(xvariance * yvariance);
+	if (output > 1.0) {
+		output = 1.0;
+	} else if (output < -1.0) {
+		output = -1.0;
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // GridMeasure::GridMeasure -- Constructor.
@@ -9540,6 +9975,7 @@ ostream& operator<<(ostream& output, GridVoice& voice) {
 //
 
 HumAddress::HumAddress(void) {
+	m_spining       = NULL;
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_subtrackcount = 0;
@@ -9553,8 +9989,9 @@ HumAddress::HumAddress(HumAddress& address) {
 	m_track         = address.m_track;
 	m_subtrack      = address.m_subtrack;
 	m_subtrackcount = address.m_subtrackcount;
-	m_spining       = address.m_spining;
+	m_spining       = NULL;
 	m_owner         = address.m_owner;
+	shareSpineInfo(address);
 }
 
 
@@ -9565,6 +10002,7 @@ HumAddress::HumAddress(HumAddress& address) {
 //
 
 HumAddress::~HumAddress() {
+	releaseSpineInfo();
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_fieldindex    = -1;
@@ -9584,8 +10022,8 @@ HumAddress& HumAddress::operator=(const HumAddress& address) {
 	m_track         = address.m_track;
 	m_subtrack      = address.m_subtrack;
 	m_subtrackcount = address.m_subtrackcount;
-	m_spining       = address.m_spining;
 	m_owner         = address.m_owner;
+	shareSpineInfo(address);
 	return *this;
 }
 
@@ -9638,7 +10076,7 @@ int HumAddress::getFieldIndex(void) const {
 //
 
 const HumdrumToken& HumAddress::getDataType(void) const {
-	static HumdrumToken null("");
+	static thread_local HumdrumToken null("");
 	if (m_owner == NULL) {
 		return null;
 	}
@@ -9658,7 +10096,7 @@ const HumdrumToken& HumAddress::getDataType(void) const {
 //
 
 HTp HumAddress::getExclusiveInterpretation(void) {
-	static HumdrumToken null("");
+	static thread_local HumdrumToken null("");
 	if (m_owner == NULL) {
 		return &null;
 	}
@@ -9683,7 +10121,11 @@ HTp HumAddress::getExclusiveInterpretation(void) {
 //
 
 const string& HumAddress::getSpineInfo(void) const {
-	return m_spining;
+	static const string empty;
+	if (m_spining == NULL) {
+		return empty;
+	}
+	return m_spining->m_text;
 }
 
 
@@ -9824,7 +10266,52 @@ void HumAddress::setFieldIndex(int index) {
 //
 
 void HumAddress::setSpineInfo(const string& spineinfo) {
-	m_spining = spineinfo;
+	if (getSpineInfo() == spineinfo) {
+		return;
+	}
+	releaseSpineInfo();
+	if (!spineinfo.empty()) {
+		m_spining = new SpineInfo;
+		m_spining->m_text = spineinfo;
+		m_spining->m_refs = 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumAddress::shareSpineInfo -- Use the same spine info string as another
+//     address.  The spine info of the tokens in a spine only changes at
+//     spine manipulators, so HumdrumFileBase::analyzeSpines() shares the
+//     string of the previous token in the spine rather than storing a
+//     copy for each token.
+//
+
+void HumAddress::shareSpineInfo(const HumAddress& address) {
+	if (address.m_spining == m_spining) {
+		return;
+	}
+	if (address.m_spining) {
+		address.m_spining->m_refs++;
+	}
+	releaseSpineInfo();
+	m_spining = address.m_spining;
+}
+
+
+
+//////////////////////////////
+//
+// HumAddress::releaseSpineInfo -- Stop using the spine info string,
+//     deleting it if no other address uses it.
+//
+
+void HumAddress::releaseSpineInfo(void) {
+	if (m_spining && (--m_spining->m_refs == 0)) {
+		delete m_spining;
+	}
+	m_spining = NULL;
 }
 
 
@@ -13259,6 +13746,36 @@ HumHash::HumHash(void) {
 
 
 
+//////////////////////////////
+//
+// HumHash::HumHash -- Copy constructor.  The parameter storage is
+//    duplicated so that the two objects do not share the same map.
+//
+
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	if (hash.parameters != NULL) {
+		parameters = new MapNNKV(*hash.parameters);
+	}
+	prefix = hash.prefix;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::HumHash -- Move constructor.  The parameter storage is
+//    transferred to the new object.
+//
+
+HumHash::HumHash(HumHash&& hash) noexcept {
+	parameters = hash.parameters;
+	hash.parameters = NULL;
+	prefix = std::move(hash.prefix);
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::~HumHash -- The HumHash deconstructor, which removed any
@@ -13274,6 +13791,42 @@ HumHash::~HumHash() {
 
 
 
+//////////////////////////////
+//
+// HumHash::operator= -- Copy and move assignment.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters != NULL) {
+		delete parameters;
+		parameters = NULL;
+	}
+	if (hash.parameters != NULL) {
+		parameters = new MapNNKV(*hash.parameters);
+	}
+	prefix = hash.prefix;
+	return *this;
+}
+
+
+HumHash& HumHash::operator=(HumHash&& hash) noexcept {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters != NULL) {
+		delete parameters;
+	}
+	parameters = hash.parameters;
+	hash.parameters = NULL;
+	prefix = std::move(hash.prefix);
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValue -- Returns the value specified by the given key.
@@ -14090,6 +14643,54 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::remapTokens -- Replace token pointers stored in the parameters
+//    (origins and values set with an HTp) with their counterparts in the
+//    given map.  Used when duplicating a HumdrumFile so that the copied
+//    parameters refer to the copied tokens.  Pointers not found in the
+//    map are left unchanged.
+//
+
+void HumHash::remapTokens(const unordered_map<HTp, HTp>& tokenmap) {
+	if (parameters == NULL) {
+		return;
+	}
+	for (auto& it1 : *parameters) {
+		for (auto& it2 : it1.second) {
+			for (auto& it3 : it2.second) {
+				HumParameter& param = it3.second;
+				if (param.origin != NULL) {
+					auto found = tokenmap.find(param.origin);
+					if (found != tokenmap.end()) {
+						param.origin = found->second;
+					}
+				}
+				if (param.compare(0, 3, "HT_") != 0) {
+					continue;
+				}
+				HTp pointer = NULL;
+				try {
+					pointer = (HTp)(stoll(param.substr(3)));
+				} catch (invalid_argument& e) {
+					continue;
+				}
+				auto found = tokenmap.find(pointer);
+				if (found == tokenmap.end()) {
+					continue;
+				}
+				stringstream ss;
+				ss << "HT_" << ((long long)found->second);
+				HTp origin = param.origin;
+				param = HumParameter(ss.str());
+				param.origin = origin;
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::initializeParameters -- Create the map structure if it does not
@@ -14342,6 +14943,74 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumHash::printJson -- Write the parameters as a member of the current
+//    JSON object, nested by namespace: {"ns1": {"ns2": {"key": "value"}}}.
+//    Parameters which have an origin token are written as
+//    {"value": "...", "idref": "..."}.  Nothing is written if there are no
+//    parameters.
+// default value: key = "parameters"
+//
+
+void HumHash::printJson(HumJsonWriter& json, const char* key) {
+	if (parameters == NULL) {
+		return;
+	}
+	bool found = false;
+	for (auto& it1 : *(parameters)) {
+		for (auto& it2 : it1.second) {
+			if (!it2.second.empty()) {
+				found = true;
+				break;
+			}
+		}
+		if (found) {
+			break;
+		}
+	}
+	if (!found) {
+		return;
+	}
+
+	HumdrumToken* ref = NULL;
+	json.writeKey(key);
+	json.beginObject();
+	for (auto& it1 : *(parameters)) {
+		if (it1.second.empty()) {
+			continue;
+		}
+		json.writeKey(it1.first);
+		json.beginObject();
+		for (auto& it2 : it1.second) {
+			if (it2.second.empty()) {
+				continue;
+			}
+			json.writeKey(it2.first);
+			json.beginObject();
+			for (auto& it3 : it2.second) {
+				json.writeKey(it3.first);
+				ref = it3.second.origin;
+				if (ref == NULL) {
+					json.writeString(it3.second);
+					continue;
+				}
+				json.beginObject();
+				json.writeKey("value");
+				json.writeString(it3.second);
+				json.writeKey("idref");
+				json.writeTokenId(ref->getLineIndex(), ref->getFieldIndex());
+				json.endObject();
+			}
+			json.endObject();
+		}
+		json.endObject();
+	}
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::printXmlAsGlobal --
@@ -14506,10 +15175,6 @@ ostream& operator<<(ostream& out, HumHash* hash) {
 
 typedef unsigned long long TEMP64BITFIX;
 
-// declare static variables
-vector<_HumInstrument> HumInstrument::m_data;
-int HumInstrument::m_classcount = 0;
-
 
 //////////////////////////////
 //
@@ -14517,10 +15182,7 @@ int HumInstrument::m_classcount = 0;
 //
 
 HumInstrument::HumInstrument(void) {
-	if (m_classcount == 0) {
-		initialize();
-	}
-	m_classcount++;
+	m_data = getDefaultData();
 	m_index = -1;
 }
 
@@ -14532,15 +15194,25 @@ HumInstrument::HumInstrument(void) {
 //
 
 HumInstrument::HumInstrument(const string& Hname) {
-	if (m_classcount == 0) {
-		initialize();
-	}
-
+	m_data = getDefaultData();
 	m_index = find(Hname);
 }
 
 
 
+//////////////////////////////
+//
+// HumInstrument::HumInstrument -- Constructor for an object which fills
+//    in the given table (used to create the default table).
+//
+
+HumInstrument::HumInstrument(std::shared_ptr<vector<_HumInstrument>> data) {
+	m_data = data;
+	m_index = -1;
+}
+
+
+
 //////////////////////////////
 //
 // HumInstrument::~HumInstrument --
@@ -14559,7 +15231,7 @@ HumInstrument::~HumInstrument() {
 
 int HumInstrument::getGM(void) {
 	if (m_index > 0) {
-		return m_data[m_index].gm;
+		return (*m_data)[m_index].gm;
 	} else {
 		return -1;
 	}
@@ -14581,7 +15253,7 @@ int HumInstrument::getGM(const string& Hname) {
 	}
 
 	if (tindex > 0) {
-		return m_data[tindex].gm;
+		return (*m_data)[tindex].gm;
 	} else {
 		return -1;
 	}
@@ -14596,7 +15268,7 @@ int HumInstrument::getGM(const string& Hname) {
 
 string HumInstrument::getName(void) {
 	if (m_index > 0) {
-		return m_data[m_index].name;
+		return (*m_data)[m_index].name;
 	} else {
 		return "";
 	}
@@ -14617,7 +15289,7 @@ string HumInstrument::getName(const string& Hname) {
 		tindex = find(Hname);
 	}
 	if (tindex > 0) {
-		return m_data[tindex].name;
+		return (*m_data)[tindex].name;
 	} else {
 		return "";
 	}
@@ -14632,7 +15304,7 @@ string HumInstrument::getName(const string& Hname) {
 
 string HumInstrument::getHumdrum(void) {
 	if (m_index > 0) {
-		return m_data[m_index].humdrum;
+		return (*m_data)[m_index].humdrum;
 	} else {
 		return "";
 	}
@@ -14649,9 +15321,13 @@ int HumInstrument::setGM(const string& Hname, int aValue) {
 	if (aValue < 0 || aValue > 127) {
 		return 0;
 	}
+	if (m_data.use_count() > 1) {
+		// Copy the shared table before changing it:
+		m_data = std::make_shared<vector<_HumInstrument>>(*m_data);
+	}
 	int rindex = find(Hname);
 	if (rindex > 0) {
-		m_data[rindex].gm = aValue;
+		(*m_data)[rindex].gm = aValue;
 	} else {
 		afi(Hname.c_str(), aValue, Hname.c_str());
 		sortData();
@@ -14682,12 +15358,30 @@ void HumInstrument::setHumdrum(const string& Hname) {
 //
 
 
+//////////////////////////////
+//
+// HumInstrument::getDefaultData -- Return the instrument table used by
+//    new objects.  The table is created once, on first use, and is not
+//    changed afterwards (static local initialization is thread-safe).
+//
+
+std::shared_ptr<vector<_HumInstrument>> HumInstrument::getDefaultData(void) {
+	static std::shared_ptr<vector<_HumInstrument>> data = []() {
+		HumInstrument builder(std::make_shared<vector<_HumInstrument>>());
+		builder.initialize();
+		return builder.m_data;
+	}();
+	return data;
+}
+
+
+
 //////////////////////////////
 //
 // HumInstrument::initialize --
 //
 void HumInstrument::initialize(void) {
-   m_data.reserve(500);
+   m_data->reserve(500);
 
 	// List has to be sorted by first parameter.  Maybe put in map.
    afi("accor",   GM_ACCORDION,             "accordion");
@@ -14919,7 +15613,7 @@ void HumInstrument::afi(const char* humdrum_name, int midinum,
 	x.humdrum = humdrum_name;
 	x.gm = midinum;
 
-	m_data.push_back(x);
+	m_data->push_back(x);
 }
 
 
@@ -14936,14 +15630,14 @@ int HumInstrument::find(const string& Hname) {
 	key.name = "";
 	key.gm = 0;
 
-	searchResult = bsearch(&key, m_data.data(),
-			m_data.size(), sizeof(_HumInstrument),
+	searchResult = bsearch(&key, m_data->data(),
+			m_data->size(), sizeof(_HumInstrument),
 			&data_compare_by_humdrum_name);
 
 	if (searchResult == NULL) {
 		return -1;
 	} else {
-		return (int)(((TEMP64BITFIX)(searchResult)) - ((TEMP64BITFIX)(m_data.data())))/
+		return (int)(((TEMP64BITFIX)(searchResult)) - ((TEMP64BITFIX)(m_data->data())))/
 			sizeof(_HumInstrument);
 	}
 }
@@ -14965,12 +15659,939 @@ int HumInstrument::data_compare_by_humdrum_name(const void* a,
 
 //////////////////////////////
 //
-// HumInstrument::sortData --
+// HumInstrument::sortData -- Sort the table by Humdrum name for find().
+//     (std::string objects cannot be moved in memory by qsort).
 //
 
 void HumInstrument::sortData(void) {
-	qsort(m_data.data(), m_data.size(), sizeof(_HumInstrument),
-		&HumInstrument::data_compare_by_humdrum_name);
+	std::stable_sort(m_data->begin(), m_data->end(),
+		[](const _HumInstrument& a, const _HumInstrument& b) {
+			return a.humdrum < b.humdrum;
+		});
+}
+
+
+
+// Size of the output buffer in bytes:
+#define HUMJSON_BUFFER_SIZE 65536
+
+
+//////////////////////////////
+//
+// HumJsonWriter::HumJsonWriter -- Constructor.
+// default value: indent = "\t"
+//
+
+HumJsonWriter::HumJsonWriter(ostream& out, const string& indent) : m_out(out) {
+	m_indent = indent;
+	m_buffer.resize(HUMJSON_BUFFER_SIZE);
+	m_empty.reserve(16);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::~HumJsonWriter -- Write any buffered output.
+//
+
+HumJsonWriter::~HumJsonWriter() {
+	flush();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::flush -- Write the buffered output to the stream.
+//
+
+void HumJsonWriter::flush(void) {
+	if (m_used > 0) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+	m_out.flush();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::beginObject -- Start a JSON object, either as an array
+//     element or as the value of the previous key.
+//
+
+void HumJsonWriter::beginObject(void) {
+	separate();
+	put('{');
+	m_empty.push_back(true);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::endObject -- Close the current object.
+//
+
+void HumJsonWriter::endObject(void) {
+	bool empty = m_empty.empty() ? true : m_empty.back();
+	if (!m_empty.empty()) {
+		m_empty.pop_back();
+	}
+	if (!empty) {
+		newline();
+	}
+	put('}');
+	if (m_empty.empty()) {
+		put('\n');
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::beginArray -- Start a JSON array.
+//
+
+void HumJsonWriter::beginArray(void) {
+	separate();
+	put('[');
+	m_empty.push_back(true);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::endArray -- Close the current array.
+//
+
+void HumJsonWriter::endArray(void) {
+	bool empty = m_empty.empty() ? true : m_empty.back();
+	if (!m_empty.empty()) {
+		m_empty.pop_back();
+	}
+	if (!empty) {
+		newline();
+	}
+	put(']');
+	if (m_empty.empty()) {
+		put('\n');
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeKey -- Write an object member name.  The next
+//     value written is the value of the member.  Key names given as
+//     char* are not escaped, so they should be plain identifiers.
+//
+
+void HumJsonWriter::writeKey(const char* key) {
+	separate();
+	put('"');
+	put(key, strlen(key));
+	put('"');
+	put(':');
+	if (!m_indent.empty()) {
+		put(' ');
+	}
+	m_afterKey = true;
+}
+
+
+void HumJsonWriter::writeKey(const string& key) {
+	separate();
+	put('"');
+	putEscaped(key.data(), key.size());
+	put('"');
+	put(':');
+	if (!m_indent.empty()) {
+		put(' ');
+	}
+	m_afterKey = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeString -- Write an escaped string value.
+//
+
+void HumJsonWriter::writeString(const string& value) {
+	separate();
+	put('"');
+	putEscaped(value.data(), value.size());
+	put('"');
+}
+
+
+void HumJsonWriter::writeString(const char* value) {
+	separate();
+	put('"');
+	putEscaped(value, strlen(value));
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeInt -- Write an integer value.
+//
+
+void HumJsonWriter::writeInt(int value) {
+	separate();
+	putInt(value);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeBool -- Write true or false.
+//
+
+void HumJsonWriter::writeBool(bool value) {
+	separate();
+	if (value) {
+		put("true", 4);
+	} else {
+		put("false", 5);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeNull -- Write null.
+//
+
+void HumJsonWriter::writeNull(void) {
+	separate();
+	put("null", 4);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeNumber -- Write a rational number as a two-element
+//     array [numerator, denominator] so that durations are exact.
+//
+
+void HumJsonWriter::writeNumber(HumNum value) {
+	separate();
+	put('[');
+	putInt(value.getNumerator());
+	put(',');
+	putInt(value.getDenominator());
+	put(']');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeLineId -- Write the ID of a line as a string.  This
+//     is the same as HumdrumLine::getXmlId(), which numbers lines from 1.
+//
+
+void HumJsonWriter::writeLineId(int line) {
+	separate();
+	put('"');
+	putEscaped(m_prefix.data(), m_prefix.size());
+	put('L');
+	putInt(line + 1);
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeTokenId -- Write the ID of a token as a string.
+//     This is the same as HumdrumToken::getXmlId().
+//
+
+void HumJsonWriter::writeTokenId(int line, int field) {
+	separate();
+	put('"');
+	putEscaped(m_prefix.data(), m_prefix.size());
+	put("loc", 3);
+	putInt(line);
+	put('_');
+	putInt(field);
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::parseFields -- Convert a comma-separated list of content
+//     names (lines, tokens, links, strands, rhythm, parameters, all) into
+//     a bitmask of FIELD_* values.  An empty list selects everything.
+//     Unknown names are ignored.
+//
+
+int HumJsonWriter::parseFields(const string& list) {
+	if (list.empty()) {
+		return FIELD_ALL;
+	}
+	int output = 0;
+	size_t start = 0;
+	while (start <= list.size()) {
+		size_t end = list.find(',', start);
+		if (end == string::npos) {
+			end = list.size();
+		}
+		// trim spaces around the name:
+		size_t a = start;
+		size_t b = end;
+		while ((a < b) && isspace((unsigned char)list[a])) {
+			a++;
+		}
+		while ((b > a) && isspace((unsigned char)list[b-1])) {
+			b--;
+		}
+		string name = list.substr(a, b - a);
+		if (name == "lines") {
+			output |= FIELD_LINES;
+		} else if (name == "tokens") {
+			output |= FIELD_TOKENS;
+		} else if (name == "links") {
+			output |= FIELD_LINKS;
+		} else if (name == "strands") {
+			output |= FIELD_STRANDS;
+		} else if (name == "rhythm") {
+			output |= FIELD_RHYTHM;
+		} else if (name == "parameters") {
+			output |= FIELD_PARAMETERS;
+		} else if (name == "all") {
+			output |= FIELD_ALL;
+		}
+		start = end + 1;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::separate -- Write the comma and indentation needed
+//     before a new value or key.
+//
+
+void HumJsonWriter::separate(void) {
+	if (m_afterKey) {
+		m_afterKey = false;
+		return;
+	}
+	if (m_empty.empty()) {
+		return;
+	}
+	if (m_empty.back()) {
+		m_empty.back() = false;
+	} else {
+		put(',');
+	}
+	newline();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::newline -- Start a new line indented to the current
+//     nesting level (nothing for compact output).
+//
+
+void HumJsonWriter::newline(void) {
+	if (m_indent.empty()) {
+		return;
+	}
+	put('\n');
+	for (int i=0; i<(int)m_empty.size(); i++) {
+		put(m_indent.data(), m_indent.size());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::put -- Append characters to the output buffer.
+//
+
+void HumJsonWriter::put(char ch) {
+	if (m_used >= m_buffer.size()) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+	m_buffer[m_used++] = ch;
+}
+
+
+void HumJsonWriter::put(const char* text, size_t count) {
+	if (m_used + count > m_buffer.size()) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+		if (count > m_buffer.size()) {
+			m_out.write(text, count);
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_used, text, count);
+	m_used += count;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::putInt -- Append an integer in decimal.
+//
+
+void HumJsonWriter::putInt(int value) {
+	char digits[16];
+	int count = 0;
+	unsigned int number = (unsigned int)value;
+	if (value < 0) {
+		put('-');
+		number = 0u - number;
+	}
+	do {
+		digits[count++] = (char)('0' + number % 10);
+		number /= 10;
+	} while (number > 0);
+	char text[16];
+	for (int i=0; i<count; i++) {
+		text[i] = digits[count - 1 - i];
+	}
+	put(text, count);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::putEscaped -- Append string contents, escaping quotes,
+//     backslashes and control characters.  Runs of characters which do not
+//     need escaping are copied in one step.  Other bytes are passed
+//     through unchanged (UTF-8 text remains UTF-8).
+//
+
+void HumJsonWriter::putEscaped(const char* text, size_t count) {
+	static const char* hex = "0123456789abcdef";
+	size_t start = 0;
+	for (size_t i=0; i<count; i++) {
+		unsigned char ch = (unsigned char)text[i];
+		if ((ch >= 0x20) && (ch != '"') && (ch != '\\')) {
+			continue;
+		}
+		if (i > start) {
+			put(text + start, i - start);
+		}
+		start = i + 1;
+		switch (ch) {
+			case '"':  put("\\\"", 2); break;
+			case '\\': put("\\\\", 2); break;
+			case '\n': put("\\n", 2);  break;
+			case '\r': put("\\r", 2);  break;
+			case '\t': put("\\t", 2);  break;
+			default:
+				{
+					char code[6] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xf]};
+					put(code, 6);
+				}
+		}
+	}
+	if (count > start) {
+		put(text + start, count - start);
+	}
+}
+
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getText -- Return the text of the subtoken for the note.
+//     The input is the token that the note was lexed from.
+//
+
+string HumKernNote::getText(const string& token) const {
+	return token.substr(m_start, m_length);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::contains -- Returns true if the pattern occurs in the
+//     subtoken for the note.  The input is the token that the note was
+//     lexed from.
+//
+
+bool HumKernNote::contains(const string& token, const string& pattern) const {
+	size_t loc = token.find(pattern, m_start);
+	if (loc == string::npos) {
+		return false;
+	}
+	return loc + pattern.size() <= (size_t)(m_start + m_length);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getOctave -- Return the octave number of the note
+//     (middle C is the start of the 4th octave), or -1000 if the note
+//     has no pitch or mixes upper and lower case pitch names.
+//
+
+int HumKernNote::getOctave(void) const {
+	if (!hasPitch() || (m_flags & FLAG_MIXED_CASE)) {
+		return -1000;
+	}
+	return m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getBase40 -- Return the base-40 pitch of the note, or
+//     -2000 if there is no pitch.
+//
+
+int HumKernNote::getBase40(void) const {
+	if (!hasPitch()) {
+		return -2000;
+	}
+	static const int pcs[7] = {0, 6, 12, 17, 23, 29, 35};
+	// +2 to make c-flat-flat bottom of octave:
+	return pcs[(int)m_diatonic] + m_accidentals + 2 + 40 * getOctave();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getBase7 -- Return the diatonic pitch of the note, or
+//     -2000 if there is no pitch.
+//
+
+int HumKernNote::getBase7(void) const {
+	if (!hasPitch()) {
+		return -2000;
+	}
+	return m_diatonic + 7 * getOctave();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isAccidentalHidden -- Returns true if the accidental is
+//     followed by 'y' (such as "#y" or "ny"), and the note is not
+//     invisible ("yy").
+//
+
+bool HumKernNote::isAccidentalHidden(void) const {
+	return (m_flags & FLAG_HIDDEN_ACCID) && !(m_flags & FLAG_INVISIBLE);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isNote -- Returns true if the note has a pitch and is
+//     not a rest.
+//
+
+bool HumKernNote::isNote(void) const {
+	return hasPitch() && !isRest();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isSecondaryTiedNote -- Returns true if the note has a
+//     pitch, is not a rest, and continues or ends a tie.
+//
+
+bool HumKernNote::isSecondaryTiedNote(void) const {
+	return isNote() && (m_flags & (FLAG_TIE_CONTINUE | FLAG_TIE_END));
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getDuration -- Return the duration of the note in
+//     quarter notes.  Grace notes and notes without a rhythm have a
+//     duration of zero.
+//
+
+HumNum HumKernNote::getDuration(void) const {
+	if (isGrace() || (m_rhythm < 0)) {
+		return 0;
+	}
+	HumNum original;
+	if (m_zeros > 0) {
+		original = 8;
+		for (int i=1; i<m_zeros; i++) {
+			original *= 2;
+		}
+	} else if (m_rhythm == 0) {
+		original = 8;
+	} else {
+		original.setValue(4 * m_rhythmDen, m_rhythm);
+	}
+	HumNum output = original;
+	HumNum dot = original;
+	for (int i=0; i<m_dots; i++) {
+		dot /= 2;
+		output += dot;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::HumKernToken --
+//
+
+HumKernToken::HumKernToken(const string& token) {
+	lex(token);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::clear --
+//
+
+void HumKernToken::clear(void) {
+	m_notes.clear();
+	m_markers.clear();
+	m_hasRest = false;
+	m_hasPitch = false;
+	m_hasTieContinuation = false;
+	m_stem = '\0';
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::lex -- Read the token in a single pass, storing a
+//     HumKernNote for each space-separated subtoken.
+//
+
+void HumKernToken::lex(const string& token) {
+	clear();
+
+	m_notes.emplace_back();
+	HumKernNote* note = &m_notes.back();
+
+	// rhythm states: 0 = before rhythm, 1 = in rhythm, 2 = after '%',
+	// 3 = in rational rhythm denominator, 4 = after rhythm.
+	int rstate = 0;
+	bool zeros = false;
+	int uc = 0;
+	int lc = 0;
+	int elision = 0;
+	char prev = '\0';
+
+	auto finishNote = [&](int end) {
+		note->m_length = end - note->m_start;
+		if (uc && lc) {
+			note->m_flags |= HumKernNote::FLAG_MIXED_CASE;
+		} else if (uc) {
+			note->m_octave = (signed char)(4 - uc);
+		} else if (lc) {
+			note->m_octave = (signed char)(3 + lc);
+		}
+		if (!zeros) {
+			note->m_zeros = 0;
+		}
+	};
+
+	for (int i=0; i<(int)token.size(); i++) {
+		char ch = token[i];
+
+		if (ch == ' ') {
+			finishNote(i);
+			m_notes.emplace_back();
+			note = &m_notes.back();
+			note->m_start = i + 1;
+			rstate = 0;
+			zeros = false;
+			uc = 0;
+			lc = 0;
+			elision = 0;
+			prev = ch;
+			continue;
+		}
+
+		if ((prev == '#') || (prev == '-') || (prev == 'n')) {
+			note->m_accidentalMark = ch;
+		}
+
+		if ((ch >= '0') && (ch <= '9')) {
+			int digit = ch - '0';
+			if (rstate == 0) {
+				rstate = 1;
+				note->m_rhythm = digit;
+				zeros = (digit == 0);
+				note->m_zeros = zeros ? 1 : 0;
+			} else if (rstate == 1) {
+				if (note->m_rhythm < 100000000) {
+					note->m_rhythm = note->m_rhythm * 10 + digit;
+				}
+				zeros = zeros && (digit == 0);
+				if (zeros && (note->m_zeros < 255)) {
+					note->m_zeros++;
+				}
+			} else if (rstate == 2) {
+				rstate = 3;
+				note->m_rhythmDen = digit;
+			} else if (rstate == 3) {
+				if (note->m_rhythmDen < 100000000) {
+					note->m_rhythmDen = note->m_rhythmDen * 10 + digit;
+				}
+			}
+			elision = 0;
+			prev = ch;
+			continue;
+		} else if (rstate == 1) {
+			rstate = (ch == '%') ? 2 : 4;
+		} else if (rstate == 2) {
+			note->m_rhythmDen = 1;
+			rstate = 4;
+		} else if (rstate == 3) {
+			rstate = 4;
+		}
+
+		switch (ch) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				if (note->m_diatonic < 0) {
+					note->m_diatonic = (signed char)((ch - 'a' + 5) % 7);
+				}
+				m_hasPitch = true;
+				lc++;
+				break;
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				if (note->m_diatonic < 0) {
+					note->m_diatonic = (signed char)((ch - 'A' + 5) % 7);
+				}
+				m_hasPitch = true;
+				uc++;
+				break;
+
+			case 'r':
+				note->m_flags |= HumKernNote::FLAG_REST;
+				m_hasRest = true;
+				break;
+			case 'R':
+				note->m_flags |= HumKernNote::FLAG_UNPITCHED;
+				break;
+
+			case '#':
+				note->m_accidentals++;
+				note->m_accidentalMark = '\0';
+				break;
+			case '-':
+				note->m_accidentals--;
+				note->m_accidentalMark = '\0';
+				break;
+			case 'n':
+				note->m_flags |= HumKernNote::FLAG_NATURAL;
+				note->m_accidentalMark = '\0';
+				break;
+			case 'y':
+				if (prev == 'y') {
+					note->m_flags |= HumKernNote::FLAG_INVISIBLE;
+				} else if ((prev == '#') || (prev == '-') || (prev == 'n')) {
+					note->m_flags |= HumKernNote::FLAG_HIDDEN_ACCID;
+				}
+				break;
+
+			case '.':
+				if (note->m_dots < 255) {
+					note->m_dots++;
+				}
+				break;
+			case 'q':
+			case 'Q':
+				note->m_flags |= HumKernNote::FLAG_GRACE;
+				break;
+
+			case '[':
+				note->m_flags |= HumKernNote::FLAG_TIE_START;
+				break;
+			case '_':
+				note->m_flags |= HumKernNote::FLAG_TIE_CONTINUE;
+				m_hasTieContinuation = true;
+				break;
+			case ']':
+				note->m_flags |= HumKernNote::FLAG_TIE_END;
+				m_hasTieContinuation = true;
+				break;
+
+			case '(':
+			case ')':
+			case '{':
+			case '}':
+			case 'L':
+			case 'J':
+				{
+					Marker marker;
+					marker.m_type = ch;
+					marker.m_elision = (unsigned char)(elision < 255 ? elision : 255);
+					marker.m_note = (short)(m_notes.size() - 1);
+					m_markers.push_back(marker);
+					unsigned char* counter = NULL;
+					switch (ch) {
+						case '(': counter = &note->m_slurStarts;   break;
+						case ')': counter = &note->m_slurEnds;     break;
+						case '{': counter = &note->m_phraseStarts; break;
+						case '}': counter = &note->m_phraseEnds;   break;
+						case 'L': counter = &note->m_beamStarts;   break;
+						case 'J': counter = &note->m_beamEnds;     break;
+					}
+					if (*counter < 255) {
+						(*counter)++;
+					}
+				}
+				break;
+			case 'k':
+			case 'K':
+				if (note->m_hooks < 255) {
+					note->m_hooks++;
+				}
+				break;
+
+			case '/':
+			case '\\':
+				if (!note->m_stem) {
+					note->m_stem = ch;
+				}
+				if (!m_stem) {
+					m_stem = ch;
+				}
+				break;
+
+			case '\'': note->m_articulations |= HumKernNote::ART_STACCATO;      break;
+			case '`':  note->m_articulations |= HumKernNote::ART_STACCATISSIMO; break;
+			case '~':  note->m_articulations |= HumKernNote::ART_TENUTO;        break;
+			case ';':  note->m_articulations |= HumKernNote::ART_FERMATA;       break;
+			case 'o':  note->m_articulations |= HumKernNote::ART_HARMONIC;      break;
+			case ':':  note->m_articulations |= HumKernNote::ART_ARPEGGIO;      break;
+			case 'v':  note->m_articulations |= HumKernNote::ART_UPBOW;         break;
+			case 'u':  note->m_articulations |= HumKernNote::ART_DOWNBOW;       break;
+			case ',':  note->m_articulations |= HumKernNote::ART_BREATH;        break;
+			case '"':  note->m_articulations |= HumKernNote::ART_PIZZICATO;     break;
+			case 'z':  note->m_articulations |= HumKernNote::ART_SFORZANDO;     break;
+			case '^':
+				if (prev == '^') {
+					note->m_articulations &= (unsigned short)~HumKernNote::ART_ACCENT;
+					note->m_articulations |= HumKernNote::ART_MARCATO;
+				} else {
+					note->m_articulations |= HumKernNote::ART_ACCENT;
+				}
+				break;
+
+			case 't': note->m_ornaments |= HumKernNote::ORN_TRILL_MINOR;   break;
+			case 'T': note->m_ornaments |= HumKernNote::ORN_TRILL_MAJOR;   break;
+			case 'm': note->m_ornaments |= HumKernNote::ORN_MORDENT_MINOR; break;
+			case 'M': note->m_ornaments |= HumKernNote::ORN_MORDENT_MAJOR; break;
+			case 'w': note->m_ornaments |= HumKernNote::ORN_LOWER_MINOR;   break;
+			case 'W': note->m_ornaments |= HumKernNote::ORN_LOWER_MAJOR;   break;
+			case 'S': note->m_ornaments |= HumKernNote::ORN_TURN;          break;
+			case '$': note->m_ornaments |= HumKernNote::ORN_INVERTED_TURN; break;
+		}
+
+		elision = (ch == '&') ? elision + 1 : 0;
+		prev = ch;
+	}
+
+	finishNote((int)token.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getNote -- Return the record for a chord note.  An empty
+//     record is returned if the index is out of range.
+//
+
+const HumKernNote& HumKernToken::getNote(int index) const {
+	static const HumKernNote empty;
+	if ((index < 0) || (index >= (int)m_notes.size())) {
+		return empty;
+	}
+	return m_notes[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getMarkerCount -- Return the number of times that a
+//     slur, phrase or beam marker occurs in the token.
+//
+
+int HumKernToken::getMarkerCount(char marker) const {
+	int output = 0;
+	for (int i=0; i<(int)m_markers.size(); i++) {
+		if (m_markers[i].m_type == marker) {
+			output++;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getElisionLevel -- Return the number of '&' characters
+//     before the (index+1)-th occurrence of the marker, or -1 if there
+//     is no such marker.
+//
+
+int HumKernToken::getElisionLevel(char marker, int index) const {
+	if (index < 0) {
+		return -1;
+	}
+	int count = 0;
+	for (int i=0; i<(int)m_markers.size(); i++) {
+		if (m_markers[i].m_type != marker) {
+			continue;
+		}
+		if (count == index) {
+			return m_markers[i].m_elision;
+		}
+		count++;
+	}
+	return -1;
 }
 
 
@@ -16675,40 +18296,18 @@ void HumRegex::unsetGlobal(void) {
 // HumRegex::search -- Search for the regular expression in the
 //    input string.  Returns the character position + 1 of the first match if any found.
 //    Search results can be accessed with .getSubmatchCount() and .getSubmatch(index).
-//
-//    Warning: a temporary string cannot be used as input to the search function
-//    if you want to call getMatch() later.  If you do a memory leak will occur.
-//    If you have a temporary string, first save it to a variable which remains
-//    in scope while accesssing a match with getMatch().
+//    A copy of the input string is kept for accessing the matches, so
+//    a temporary string can be searched.
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		// return the char+1 position of the first match
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, 0, exp, m_regexflags, m_searchflags);
 }
 
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	auto startit = input.begin() + startindex;
-	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, startindex, exp, m_regexflags, m_searchflags);
 }
 
 
@@ -16727,31 +18326,15 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, 0, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	auto startit = input.begin() + startindex;
-	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, startindex, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -16767,6 +18350,104 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 }
 
 
+
+//////////////////////////////
+//
+// HumRegex::searchText -- Search the input string starting at startindex,
+//    and store the matches.  The position of the match is relative to
+//    startindex.
+//
+
+int HumRegex::searchText(const string& input, int startindex, const string& exp,
+		std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	const regex* re = nfa ? NULL : &getRegex(exp, flags);
+	m_input = input;
+	m_begin = startindex;
+	m_captures.clear();
+	if ((startindex < 0) || (startindex > (int)m_input.size())) {
+		m_begin = 0;
+		return 0;
+	}
+
+	if (nfa) {
+		if (!nfa->search(m_input, startindex, startindex, m_captures)) {
+			return 0;
+		}
+	} else {
+		std::smatch matches;
+		auto startit = m_input.cbegin() + startindex;
+		if (!regex_search(startit, m_input.cend(), matches, *re, searchflags)) {
+			return 0;
+		}
+		m_captures.resize(2 * matches.size());
+		for (int i=0; i<(int)matches.size(); i++) {
+			if (matches[i].matched) {
+				m_captures[2*i]   = startindex + (int)matches.position(i);
+				m_captures[2*i+1] = m_captures[2*i] + (int)matches.length(i);
+			} else {
+				m_captures[2*i]   = -1;
+				m_captures[2*i+1] = -1;
+			}
+		}
+	}
+	if (m_captures.empty()) {
+		return 0;
+	}
+	// return the char+1 position of the first match
+	return m_captures[0] - startindex + 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getNfa -- Return the linear-time matcher for the expression,
+//    or NULL if std::regex has to be used for it.  Only the ECMAScript
+//    grammar (with optional icase) is handled by HumRegexNfa.
+//
+
+const HumRegexNfa* HumRegex::getNfa(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_nfaQ && (flags == m_nfaflags) && (exp == m_nfaexp)) {
+		return m_nfa.get();
+	}
+	m_nfaexp   = exp;
+	m_nfaflags = flags;
+	m_nfaQ     = true;
+	auto allowed = std::regex_constants::ECMAScript | std::regex_constants::icase
+			| std::regex_constants::optimize;
+	if (flags & ~allowed) {
+		m_nfa.reset();
+	} else {
+		bool icase = (flags & std::regex_constants::icase) ? true : false;
+		m_nfa = HumRegexNfa::getCompiled(exp, icase);
+	}
+	return m_nfa.get();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getRegex -- Return the std::regex for the expression,
+//    compiling it only if the expression or flags have changed.
+//
+
+const regex& HumRegex::getRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (!m_regexQ || (flags != m_regexexpflags) || (exp != m_regexexp)) {
+		m_regexQ = false;
+		m_regex = regex(exp, flags);
+		m_regexexp = exp;
+		m_regexexpflags = flags;
+		m_regexQ = true;
+	}
+	return m_regex;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // match-related functions
@@ -16779,7 +18460,7 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 //
 
 int HumRegex::getMatchCount(void) {
-	return (int)m_matches.size();
+	return (int)m_captures.size() / 2;
 }
 
 
@@ -16794,10 +18475,13 @@ int HumRegex::getMatchCount(void) {
 string HumRegex::getMatch(int index) {
 	if (index < 0) {
 		return "";
-	} if (index >= (int)m_matches.size()) {
+	} if (index >= getMatchCount()) {
+		return "";
+	} if (m_captures[2*index] < 0) {
 		return "";
 	}
-	string output = m_matches.str(index);
+	string output = m_input.substr(m_captures[2*index],
+			m_captures[2*index+1] - m_captures[2*index]);
 	return output;
 }
 
@@ -16810,7 +18494,7 @@ string HumRegex::getMatch(int index) {
 //
 
 int HumRegex::getMatchInt(int index) {
-	string value = m_matches.str(index);
+	string value = getMatch(index);
 	int output = 0;
 	if (value.size() > 0) {
 		if (isdigit(value[0])) {
@@ -16832,7 +18516,7 @@ int HumRegex::getMatchInt(int index) {
 //
 
 double HumRegex::getMatchDouble(int index) {
-	string value = m_matches.str(index);
+	string value = getMatch(index);
 	if (value.size() > 0) {
 		return stod(value);
 	} else {
@@ -16849,7 +18533,10 @@ double HumRegex::getMatchDouble(int index) {
 //
 
 string HumRegex::getPrefix(void) {
-	return m_matches.prefix().str();
+	if (m_captures.empty()) {
+		return "";
+	}
+	return m_input.substr(m_begin, m_captures[0] - m_begin);
 }
 
 
@@ -16861,7 +18548,10 @@ string HumRegex::getPrefix(void) {
 //
 
 string HumRegex::getSuffix(void) {
-	return m_matches.suffix().str();
+	if (m_captures.empty()) {
+		return "";
+	}
+	return m_input.substr(m_captures[1]);
 }
 
 
@@ -16869,11 +18559,15 @@ string HumRegex::getSuffix(void) {
 //////////////////////////////
 //
 // HumRegex::getMatchStartIndex -- Get starting index of match in input
-//     search string.
+//     search string.  Submatches which did not participate in the match
+//     start at the end of the search string.
 //
 
 int HumRegex::getMatchStartIndex(int index) {
-	return (int)m_matches.position(index);
+	if ((index < 0) || (index >= getMatchCount()) || (m_captures[2*index] < 0)) {
+		return (int)m_input.size() - m_begin;
+	}
+	return m_captures[2*index] - m_begin;
 }
 
 
@@ -16897,7 +18591,10 @@ int HumRegex::getMatchEndIndex(int index) {
 //
 
 int HumRegex::getMatchLength(int index) {
-	return (int)m_matches.length(index);
+	if ((index < 0) || (index >= getMatchCount()) || (m_captures[2*index] < 0)) {
+		return 0;
+	}
+	return m_captures[2*index+1] - m_captures[2*index];
 }
 
 
@@ -16913,15 +18610,14 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	return matchText(input, exp, m_regexflags, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	return matchText(input, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -16938,6 +18634,23 @@ bool HumRegex::match(const string* input, const string& exp,
 
 
 
+//////////////////////////////
+//
+// HumRegex::matchText -- Match the expression to the entire input string.
+//
+
+bool HumRegex::matchText(const string& input, const string& exp,
+		std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	if (nfa) {
+		return nfa->match(input);
+	}
+	return regex_match(input, getRegex(exp, flags), searchflags);
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // search and replace functions.  Default behavior is to only match
@@ -16952,8 +18665,7 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	input = replaceText(input, replacement, exp, m_regexflags, m_searchflags);
 	return input;
 }
 
@@ -16969,8 +18681,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	input = replaceText(input, replacement, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -16990,11 +18702,8 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	string output;
-	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
-	return output;
+	return replaceText(input, replacement, exp, m_regexflags,
+			std::regex_constants::match_default);
 }
 
 
@@ -17009,11 +18718,8 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	string output;
-	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
-	return output;
+	return replaceText(input, replacement, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -17024,6 +18730,120 @@ string HumRegex::replaceCopy(string* input, const string& exp,
 
 
 
+//////////////////////////////
+//
+// HumRegex::replaceText -- Replace the first match (if searchflags
+//    contains format_first_only) or all matches of the expression in the
+//    input string.  The matches are found in the same way as
+//    std::regex_replace: after an empty match, a non-empty match at the
+//    same position is tried before moving forward by one character.
+//
+
+string HumRegex::replaceText(const string& input, const string& replacement,
+		const string& exp, std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	if (!nfa) {
+		return regex_replace(input, getRegex(exp, flags), replacement, searchflags);
+	}
+
+	bool firstonly = (searchflags & std::regex_constants::format_first_only) ? true : false;
+	vector<int> captures;
+	if (!nfa->search(input, 0, 0, captures)) {
+		return input;
+	}
+	string output;
+	int length = (int)input.size();
+	int prefix = 0;
+	bool prevavail = false;
+	while (true) {
+		output.append(input, prefix, captures[0] - prefix);
+		appendFormat(output, replacement, input, captures, prefix);
+		prefix = captures[1];
+		if (firstonly) {
+			break;
+		}
+		int start = captures[1];
+		bool found = false;
+		if (captures[0] == captures[1]) {
+			if (start == length) {
+				break;
+			}
+			found = nfa->search(input, prevavail ? 0 : start, start, captures, true, true);
+			if (!found) {
+				start++;
+			}
+		}
+		if (!found) {
+			prevavail = true;
+			if (!nfa->search(input, 0, start, captures)) {
+				break;
+			}
+		}
+	}
+	output.append(input, prefix, string::npos);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::appendFormat -- Append the replacement text for a match.
+//    $& is the match, $n or $nn a submatch, $` the text between the
+//    previous match (starting at index prefix) and the match, $' the
+//    text after the match, and $$ a dollar sign.
+//
+
+void HumRegex::appendFormat(string& output, const string& format,
+		const string& input, const vector<int>& captures, int prefix) {
+	int count = (int)captures.size() / 2;
+	auto appendMatch = [&](int index) {
+		if (captures[2*index] >= 0) {
+			output.append(input, captures[2*index], captures[2*index+1] - captures[2*index]);
+		}
+	};
+
+	size_t i = 0;
+	while (i < format.size()) {
+		size_t next = format.find('$', i);
+		if (next == string::npos) {
+			output.append(format, i, string::npos);
+			break;
+		}
+		output.append(format, i, next - i);
+		next++;
+		if (next >= format.size()) {
+			output += '$';
+		} else if (format[next] == '$') {
+			output += '$';
+			next++;
+		} else if (format[next] == '&') {
+			appendMatch(0);
+			next++;
+		} else if (format[next] == '`') {
+			output.append(input, prefix, captures[0] - prefix);
+			next++;
+		} else if (format[next] == '\'') {
+			output.append(input, captures[1], string::npos);
+			next++;
+		} else if (isdigit(format[next])) {
+			int number = format[next++] - '0';
+			if ((next < format.size()) && isdigit(format[next])) {
+				number = number * 10 + (format[next++] - '0');
+			}
+			if (number < count) {
+				appendMatch(number);
+			}
+		} else {
+			output += '$';
+		}
+		i = next;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::tr --
@@ -17167,6 +18987,1762 @@ std::regex_constants::match_flag_type HumRegex::getTemporarySearchFlags(
 }
 
 
+// NFA program instructions:
+enum {
+	NFA_OP_CHAR,    // match character m_x
+	NFA_OP_ANY,     // match any character except \n and \r
+	NFA_OP_CLASS,   // match character in m_classes[m_x]
+	NFA_OP_SPLIT,   // continue at m_x (preferred) and at m_y
+	NFA_OP_JMP,     // continue at m_x
+	NFA_OP_SAVE,    // store position in capture slot m_x
+	NFA_OP_BOL,     // ^
+	NFA_OP_EOL,     // $
+	NFA_OP_WORDB,   // \b
+	NFA_OP_NWORDB,  // \B
+	NFA_OP_MATCH
+};
+
+// Parse tree nodes:
+enum {
+	NFA_NODE_EMPTY,
+	NFA_NODE_CHAR,
+	NFA_NODE_ANY,
+	NFA_NODE_CLASS,
+	NFA_NODE_CAT,
+	NFA_NODE_ALT,
+	NFA_NODE_GROUP,
+	NFA_NODE_REPEAT,
+	NFA_NODE_BOL,
+	NFA_NODE_EOL,
+	NFA_NODE_WORDB,
+	NFA_NODE_NWORDB
+};
+
+// Limits beyond which std::regex is used instead:
+#define NFA_MAX_PROGRAM  2000
+#define NFA_MAX_DEPTH    100
+#define NFA_MAX_REPEAT   1000
+#define NFA_MAX_CACHE    1000
+
+
+//////////////////////////////
+//
+// HumRegexNfa::ThreadList -- List of NFA states active at one input
+//     position, in priority order, with the capture positions of each.
+//
+
+class HumRegexNfa::ThreadList {
+	public:
+		std::vector<int>      m_pcs;
+		std::vector<int>      m_captures;
+		std::vector<unsigned> m_marks;
+		unsigned              m_generation = 0;
+		int                   m_count      = 0;
+
+		void prepare(int size, int slots) {
+			if ((int)m_pcs.size() < size) {
+				m_pcs.resize(size);
+				m_marks.resize(size, 0);
+			}
+			if ((int)m_captures.size() < size * slots + 1) {
+				m_captures.resize(size * slots + 1);
+			}
+			clear();
+		}
+
+		void clear(void) {
+			m_count = 0;
+			if (++m_generation == 0) {
+				std::fill(m_marks.begin(), m_marks.end(), 0);
+				m_generation = 1;
+			}
+		}
+};
+
+
+
+//////////////////////////////
+//
+// nfa_escapeClass -- Characters matched by \d, \D, \w, \W, \s and \S.
+//
+
+static std::bitset<256> nfa_escapeClass(unsigned char ch) {
+	std::bitset<256> output;
+	for (int i=0; i<128; i++) {
+		switch (tolower(ch)) {
+			case 'd':
+				output[i] = isdigit(i) ? true : false;
+				break;
+			case 'w':
+				output[i] = (isalnum(i) || (i == '_')) ? true : false;
+				break;
+			case 's':
+				output[i] = isspace(i) ? true : false;
+				break;
+		}
+	}
+	if (isupper(ch)) {
+		output.flip();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// nfa_hexValue -- Value of a hexadecimal digit, or -1.
+//
+
+static int nfa_hexValue(char ch) {
+	if ((ch >= '0') && (ch <= '9')) {
+		return ch - '0';
+	} else if ((ch >= 'a') && (ch <= 'f')) {
+		return ch - 'a' + 10;
+	} else if ((ch >= 'A') && (ch <= 'F')) {
+		return ch - 'A' + 10;
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// nfa_isWord -- True if the character is matched by \w.
+//
+
+static bool nfa_isWord(char ch) {
+	unsigned char value = (unsigned char)ch;
+	return (value < 128) && (isalnum(value) || (value == '_'));
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::HumRegexNfa -- Constructor.
+//
+
+HumRegexNfa::HumRegexNfa(void) {
+	// do nothing
+}
+
+
+HumRegexNfa::HumRegexNfa(const string& exp, bool icase) {
+	compile(exp, icase);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::clear --
+//
+
+void HumRegexNfa::clear(void) {
+	m_valid     = false;
+	m_icase     = false;
+	m_groups    = 0;
+	m_program.clear();
+	m_classes.clear();
+	m_firstQ    = false;
+	m_firstChar = -1;
+	m_first.reset();
+	m_anchored  = false;
+	m_exp.clear();
+	m_pos       = 0;
+	m_depth     = 0;
+	m_nodes.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::compile -- Compile an ECMAScript regular expression.
+//     Returns false if the expression is not supported (or is invalid),
+//     in which case std::regex has to be used for it.
+//
+
+bool HumRegexNfa::compile(const string& exp, bool icase) {
+	clear();
+	m_icase = icase;
+	m_exp   = exp;
+	int root = parseAlternation();
+	if ((root >= 0) && (m_pos == (int)m_exp.size())) {
+		addInstruction(NFA_OP_SAVE, 0);
+		if (emit(root) && ((int)m_program.size() < NFA_MAX_PROGRAM)) {
+			addInstruction(NFA_OP_SAVE, 1);
+			addInstruction(NFA_OP_MATCH);
+			m_valid = true;
+		}
+	}
+	m_exp.clear();
+	m_nodes.clear();
+	if (!m_valid) {
+		m_program.clear();
+		m_classes.clear();
+		m_groups = 0;
+		return false;
+	}
+	makeStartInfo();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::getCompiled -- Return a compiled expression which can be
+//     shared between HumRegex objects (and threads).  Returns NULL if the
+//     expression is not supported.  The result of compiling is cached
+//     for both supported and unsupported expressions.
+//
+
+std::shared_ptr<const HumRegexNfa> HumRegexNfa::getCompiled(const string& exp,
+		bool icase) {
+	static mutex cacheMutex;
+	static unordered_map<string, std::shared_ptr<const HumRegexNfa>> cache;
+
+	string key;
+	key.reserve(exp.size() + 1);
+	key += icase ? 'i' : 'c';
+	key += exp;
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		auto it = cache.find(key);
+		if (it != cache.end()) {
+			return it->second;
+		}
+	}
+
+	std::shared_ptr<HumRegexNfa> nfa = std::make_shared<HumRegexNfa>();
+	std::shared_ptr<const HumRegexNfa> output;
+	if (nfa->compile(exp, icase)) {
+		output = nfa;
+	}
+
+	lock_guard<mutex> lock(cacheMutex);
+	if (cache.size() >= NFA_MAX_CACHE) {
+		cache.clear();
+	}
+	cache[key] = output;
+	return output;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Parsing functions: each returns a node index, or -1 if the expression
+//    is not supported.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::parseAlternation -- sequence ("|" sequence)*
+//
+
+int HumRegexNfa::parseAlternation(void) {
+	int node = parseSequence();
+	if (node < 0) {
+		return -1;
+	}
+	if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != '|')) {
+		return node;
+	}
+	int alt = makeNode(NFA_NODE_ALT);
+	m_nodes[alt].m_children.push_back(node);
+	while ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '|')) {
+		m_pos++;
+		node = parseSequence();
+		if (node < 0) {
+			return -1;
+		}
+		m_nodes[alt].m_children.push_back(node);
+	}
+	return alt;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseSequence -- Quantified atoms up to "|" or ")".
+//
+
+int HumRegexNfa::parseSequence(void) {
+	int cat = makeNode(NFA_NODE_CAT);
+	while ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] != '|')
+			&& (m_exp[m_pos] != ')')) {
+		int node = parseRepeat();
+		if (node < 0) {
+			return -1;
+		}
+		m_nodes[cat].m_children.push_back(node);
+	}
+	return cat;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseRepeat -- An atom followed by an optional quantifier.
+//
+
+int HumRegexNfa::parseRepeat(void) {
+	int atom = parseAtom();
+	if ((atom < 0) || (m_pos >= (int)m_exp.size())) {
+		return atom;
+	}
+	char ch = m_exp[m_pos];
+	if ((ch != '*') && (ch != '+') && (ch != '?') && (ch != '{')) {
+		return atom;
+	}
+	switch (m_nodes[atom].m_type) {
+		case NFA_NODE_BOL:
+		case NFA_NODE_EOL:
+		case NFA_NODE_WORDB:
+		case NFA_NODE_NWORDB:
+			return -1;
+	}
+
+	int minimum = 0;
+	int maximum = -1;
+	m_pos++;
+	if (ch == '+') {
+		minimum = 1;
+	} else if (ch == '?') {
+		maximum = 1;
+	} else if (ch == '{') {
+		auto getNumber = [&](int& value) {
+			if ((m_pos >= (int)m_exp.size()) || !isdigit(m_exp[m_pos])) {
+				return false;
+			}
+			value = 0;
+			while ((m_pos < (int)m_exp.size()) && isdigit(m_exp[m_pos])) {
+				value = value * 10 + (m_exp[m_pos++] - '0');
+				if (value > NFA_MAX_REPEAT) {
+					return false;
+				}
+			}
+			return true;
+		};
+		if (!getNumber(minimum) || (m_pos >= (int)m_exp.size())) {
+			return -1;
+		}
+		if (m_exp[m_pos] == '}') {
+			maximum = minimum;
+		} else if (m_exp[m_pos] == ',') {
+			m_pos++;
+			if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] != '}')) {
+				if (!getNumber(maximum) || (maximum < minimum)) {
+					return -1;
+				}
+			}
+			if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != '}')) {
+				return -1;
+			}
+		} else {
+			return -1;
+		}
+		m_pos++;
+	}
+
+	bool greedy = true;
+	if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '?')) {
+		greedy = false;
+		m_pos++;
+	}
+	if (m_pos < (int)m_exp.size()) {
+		ch = m_exp[m_pos];
+		if ((ch == '*') || (ch == '+') || (ch == '?') || (ch == '{')) {
+			return -1;
+		}
+	}
+
+	// Optional iterations of an expression which can match an empty string
+	// are handled specially by std::regex:
+	if ((maximum != minimum) && isNullable(atom)) {
+		return -1;
+	}
+	if ((minimum == 1) && (maximum == 1)) {
+		return atom;
+	}
+	int node = makeNode(NFA_NODE_REPEAT);
+	m_nodes[node].m_min    = minimum;
+	m_nodes[node].m_max    = maximum;
+	m_nodes[node].m_greedy = greedy;
+	m_nodes[node].m_children.push_back(atom);
+	return node;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseAtom -- A character, class, group or assertion.
+//
+
+int HumRegexNfa::parseAtom(void) {
+	unsigned char ch = m_exp[m_pos];
+	switch (ch) {
+		case '(':
+			{
+				m_pos++;
+				int group = 0;
+				if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '?')) {
+					// only non-capturing groups (no lookaheads):
+					if ((m_pos + 1 >= (int)m_exp.size()) || (m_exp[m_pos+1] != ':')) {
+						return -1;
+					}
+					m_pos += 2;
+				} else {
+					group = ++m_groups;
+				}
+				// limit recursion:
+				if (m_depth >= NFA_MAX_DEPTH) {
+					return -1;
+				}
+				m_depth++;
+				int inner = parseAlternation();
+				m_depth--;
+				if ((inner < 0) || (m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != ')')) {
+					return -1;
+				}
+				m_pos++;
+				int node = makeNode(NFA_NODE_GROUP, group);
+				m_nodes[node].m_children.push_back(inner);
+				return node;
+			}
+		case '[':
+			return parseBracket();
+		case '\\':
+			return parseEscape();
+		case '.':
+			m_pos++;
+			return makeNode(NFA_NODE_ANY);
+		case '^':
+			m_pos++;
+			return makeNode(NFA_NODE_BOL);
+		case '$':
+			m_pos++;
+			return makeNode(NFA_NODE_EOL);
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			return -1;
+	}
+	m_pos++;
+	return makeCharacter(ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseEscape -- A backslash sequence outside of brackets.
+//     Backreferences and unknown letter escapes are not supported.
+//
+
+int HumRegexNfa::parseEscape(void) {
+	m_pos++;
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	unsigned char ch = m_exp[m_pos++];
+	switch (ch) {
+		case 'b': return makeNode(NFA_NODE_WORDB);
+		case 'B': return makeNode(NFA_NODE_NWORDB);
+		case 'd': case 'D':
+		case 'w': case 'W':
+		case 's': case 'S':
+			return makeClass(nfa_escapeClass(ch));
+		case 't': return makeCharacter('\t');
+		case 'n': return makeCharacter('\n');
+		case 'v': return makeCharacter('\v');
+		case 'f': return makeCharacter('\f');
+		case 'r': return makeCharacter('\r');
+		case 'x':
+			{
+				if (m_pos + 2 > (int)m_exp.size()) {
+					return -1;
+				}
+				int high = nfa_hexValue(m_exp[m_pos]);
+				int low  = nfa_hexValue(m_exp[m_pos+1]);
+				if ((high < 0) || (low < 0)) {
+					return -1;
+				}
+				m_pos += 2;
+				return makeCharacter((unsigned char)(high * 16 + low));
+			}
+	}
+	if ((ch >= 128) || isalnum(ch)) {
+		return -1;
+	}
+	return makeCharacter(ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseBracket -- A [...] or [^...] character class.
+//
+
+int HumRegexNfa::parseBracket(void) {
+	m_pos++;
+	bool negate = false;
+	if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '^')) {
+		negate = true;
+		m_pos++;
+	}
+	if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] == ']')) {
+		return -1;
+	}
+
+	std::bitset<256> set;
+	bool firstQ = true;
+	while (true) {
+		if (m_pos >= (int)m_exp.size()) {
+			return -1;
+		}
+		if (m_exp[m_pos] == ']') {
+			m_pos++;
+			break;
+		}
+		// "-" is only allowed at the start or end of the list, or in a range:
+		bool dashQ = m_exp[m_pos] == '-';
+		if (dashQ && !firstQ && (m_pos + 1 < (int)m_exp.size()) && (m_exp[m_pos+1] != ']')) {
+			return -1;
+		}
+		firstQ = false;
+		bool classQ = false;
+		int low = parseBracketTerm(set, classQ);
+		if (low < 0) {
+			return -1;
+		}
+		bool rangeQ = (m_pos + 1 < (int)m_exp.size()) && (m_exp[m_pos] == '-')
+				&& (m_exp[m_pos+1] != ']');
+		if (classQ) {
+			if (rangeQ) {
+				return -1;
+			}
+			continue;
+		}
+		if (!rangeQ) {
+			set.set(low);
+			continue;
+		}
+		if (dashQ) {
+			return -1;
+		}
+		m_pos++;
+		int high = parseBracketTerm(set, classQ);
+		if ((high < 0) || classQ || (low > high) || (high >= 128)) {
+			return -1;
+		}
+		for (int i=low; i<=high; i++) {
+			set.set(i);
+		}
+	}
+
+	if (m_icase) {
+		for (int i='a'; i<='z'; i++) {
+			if (set[i] || set[i-32]) {
+				set.set(i);
+				set.set(i-32);
+			}
+		}
+	}
+	if (negate) {
+		set.flip();
+	}
+	return makeClass(set);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseBracketTerm -- A single character (return value) or
+//     class escape (added to set, classQ = true) inside of brackets.
+//     Returns -1 if not supported.
+//
+
+int HumRegexNfa::parseBracketTerm(std::bitset<256>& set, bool& classQ) {
+	classQ = false;
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	unsigned char ch = m_exp[m_pos++];
+	if (ch == '[') {
+		// POSIX classes such as [:alpha:]:
+		if ((m_pos < (int)m_exp.size()) && ((m_exp[m_pos] == ':')
+				|| (m_exp[m_pos] == '.') || (m_exp[m_pos] == '='))) {
+			return -1;
+		}
+		return ch;
+	}
+	if (ch != '\\') {
+		return ch;
+	}
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	ch = m_exp[m_pos++];
+	switch (ch) {
+		case 'd': case 'D':
+		case 'w': case 'W':
+		case 's': case 'S':
+			set |= nfa_escapeClass(ch);
+			classQ = true;
+			return 0;
+		case 't': return '\t';
+		case 'n': return '\n';
+		case 'v': return '\v';
+		case 'f': return '\f';
+		case 'r': return '\r';
+		case 'x':
+			{
+				if (m_pos + 2 > (int)m_exp.size()) {
+					return -1;
+				}
+				int high = nfa_hexValue(m_exp[m_pos]);
+				int low  = nfa_hexValue(m_exp[m_pos+1]);
+				if ((high < 0) || (low < 0)) {
+					return -1;
+				}
+				m_pos += 2;
+				return high * 16 + low;
+			}
+	}
+	if ((ch >= 128) || isalnum(ch)) {
+		return -1;
+	}
+	return ch;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeNode -- Add a node to the parse tree.
+//
+
+int HumRegexNfa::makeNode(int type, int value) {
+	m_nodes.emplace_back();
+	m_nodes.back().m_type  = type;
+	m_nodes.back().m_value = value;
+	return (int)m_nodes.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeClass -- Add a character class node.
+//
+
+int HumRegexNfa::makeClass(const std::bitset<256>& set) {
+	m_classes.push_back(set);
+	return makeNode(NFA_NODE_CLASS, (int)m_classes.size() - 1);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeCharacter -- Add a character node (a class when
+//     ignoring the case of a letter).
+//
+
+int HumRegexNfa::makeCharacter(unsigned char ch) {
+	if (m_icase && (ch < 128) && isalpha(ch)) {
+		std::bitset<256> set;
+		set.set(tolower(ch));
+		set.set(toupper(ch));
+		return makeClass(set);
+	}
+	return makeNode(NFA_NODE_CHAR, ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::isNullable -- True if the node can match an empty string.
+//
+
+bool HumRegexNfa::isNullable(int node) const {
+	const Node& item = m_nodes[node];
+	switch (item.m_type) {
+		case NFA_NODE_CHAR:
+		case NFA_NODE_ANY:
+		case NFA_NODE_CLASS:
+			return false;
+		case NFA_NODE_CAT:
+			for (int i=0; i<(int)item.m_children.size(); i++) {
+				if (!isNullable(item.m_children[i])) {
+					return false;
+				}
+			}
+			return true;
+		case NFA_NODE_ALT:
+			for (int i=0; i<(int)item.m_children.size(); i++) {
+				if (isNullable(item.m_children[i])) {
+					return true;
+				}
+			}
+			return false;
+		case NFA_NODE_GROUP:
+			return isNullable(item.m_children[0]);
+		case NFA_NODE_REPEAT:
+			return (item.m_min == 0) || isNullable(item.m_children[0]);
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Compiling functions.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::addInstruction -- Returns the index of the instruction.
+//
+
+int HumRegexNfa::addInstruction(int op, int x, int y) {
+	Instruction inst;
+	inst.m_op = (unsigned char)op;
+	inst.m_x  = x;
+	inst.m_y  = y;
+	m_program.push_back(inst);
+	return (int)m_program.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::emit -- Generate the program for a parse tree node.
+//     Returns false if the program becomes too large.  Counted
+//     repetitions are expanded into copies of the repeated node.
+//
+
+bool HumRegexNfa::emit(int node) {
+	if ((int)m_program.size() >= NFA_MAX_PROGRAM) {
+		return false;
+	}
+	const Node& item = m_nodes[node];
+	const vector<int>& children = item.m_children;
+	switch (item.m_type) {
+		case NFA_NODE_EMPTY:
+			return true;
+		case NFA_NODE_CHAR:
+			addInstruction(NFA_OP_CHAR, item.m_value);
+			return true;
+		case NFA_NODE_ANY:
+			addInstruction(NFA_OP_ANY);
+			return true;
+		case NFA_NODE_CLASS:
+			addInstruction(NFA_OP_CLASS, item.m_value);
+			return true;
+		case NFA_NODE_BOL:
+			addInstruction(NFA_OP_BOL);
+			return true;
+		case NFA_NODE_EOL:
+			addInstruction(NFA_OP_EOL);
+			return true;
+		case NFA_NODE_WORDB:
+			addInstruction(NFA_OP_WORDB);
+			return true;
+		case NFA_NODE_NWORDB:
+			addInstruction(NFA_OP_NWORDB);
+			return true;
+
+		case NFA_NODE_CAT:
+			for (int i=0; i<(int)children.size(); i++) {
+				if (!emit(children[i])) {
+					return false;
+				}
+			}
+			return true;
+
+		case NFA_NODE_ALT:
+			{
+				vector<int> jumps;
+				for (int i=0; i<(int)children.size() - 1; i++) {
+					int split = addInstruction(NFA_OP_SPLIT, (int)m_program.size() + 1);
+					if (!emit(children[i])) {
+						return false;
+					}
+					jumps.push_back(addInstruction(NFA_OP_JMP));
+					m_program[split].m_y = (int)m_program.size();
+				}
+				if (!emit(children.back())) {
+					return false;
+				}
+				for (int i=0; i<(int)jumps.size(); i++) {
+					m_program[jumps[i]].m_x = (int)m_program.size();
+				}
+				return true;
+			}
+
+		case NFA_NODE_GROUP:
+			if (item.m_value > 0) {
+				addInstruction(NFA_OP_SAVE, 2 * item.m_value);
+			}
+			if (!emit(children[0])) {
+				return false;
+			}
+			if (item.m_value > 0) {
+				addInstruction(NFA_OP_SAVE, 2 * item.m_value + 1);
+			}
+			return true;
+
+		case NFA_NODE_REPEAT:
+			{
+				bool greedy = item.m_greedy;
+				if ((item.m_max < 0) && (item.m_min == 0)) {
+					// x*: L1: split L2, L3; L2: x; jmp L1; L3:
+					int split = addInstruction(NFA_OP_SPLIT);
+					if (!emit(children[0])) {
+						return false;
+					}
+					addInstruction(NFA_OP_JMP, split);
+					int out = (int)m_program.size();
+					m_program[split].m_x = greedy ? split + 1 : out;
+					m_program[split].m_y = greedy ? out : split + 1;
+					return true;
+				}
+				if (item.m_max < 0) {
+					// x{n,}: x{n-1} L1: x; split L1, L2; L2:
+					for (int i=0; i<item.m_min - 1; i++) {
+						if (!emit(children[0])) {
+							return false;
+						}
+					}
+					int loop = (int)m_program.size();
+					if (!emit(children[0])) {
+						return false;
+					}
+					int out = (int)m_program.size() + 1;
+					addInstruction(NFA_OP_SPLIT, greedy ? loop : out, greedy ? out : loop);
+					return true;
+				}
+				// x{n,m}: x{n} followed by (m-n) nested optional copies of x.
+				for (int i=0; i<item.m_min; i++) {
+					if (!emit(children[0])) {
+						return false;
+					}
+				}
+				vector<int> splits;
+				for (int i=item.m_min; i<item.m_max; i++) {
+					splits.push_back(addInstruction(NFA_OP_SPLIT));
+					if (!emit(children[0])) {
+						return false;
+					}
+				}
+				int out = (int)m_program.size();
+				for (int i=0; i<(int)splits.size(); i++) {
+					m_program[splits[i]].m_x = greedy ? splits[i] + 1 : out;
+					m_program[splits[i]].m_y = greedy ? out : splits[i] + 1;
+				}
+				return true;
+			}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeStartInfo -- Find the characters which can start a
+//     match, and whether matches must start at the beginning of the input.
+//
+
+void HumRegexNfa::makeStartInfo(void) {
+	int size = (int)m_program.size();
+	vector<char> visited;
+	vector<int> stack;
+
+	for (int pass=0; pass<2; pass++) {
+		// pass 0: first characters; pass 1: anchoring
+		visited.assign(size, 0);
+		stack.assign(1, 0);
+		if (pass == 0) {
+			m_first.reset();
+			m_firstQ = true;
+		} else {
+			m_anchored = true;
+		}
+		while (!stack.empty()) {
+			int pc = stack.back();
+			stack.pop_back();
+			if (visited[pc]) {
+				continue;
+			}
+			visited[pc] = 1;
+			const Instruction& inst = m_program[pc];
+			switch (inst.m_op) {
+				case NFA_OP_JMP:
+					stack.push_back(inst.m_x);
+					break;
+				case NFA_OP_SPLIT:
+					stack.push_back(inst.m_y);
+					stack.push_back(inst.m_x);
+					break;
+				case NFA_OP_BOL:
+					if (pass == 0) {
+						stack.push_back(pc + 1);
+					}
+					break;
+				case NFA_OP_SAVE:
+				case NFA_OP_EOL:
+				case NFA_OP_WORDB:
+				case NFA_OP_NWORDB:
+					stack.push_back(pc + 1);
+					break;
+				case NFA_OP_CHAR:
+					m_first.set(inst.m_x);
+					m_anchored = false;
+					break;
+				case NFA_OP_ANY:
+					{
+						std::bitset<256> any;
+						any.set();
+						any.reset('\n');
+						any.reset('\r');
+						m_first |= any;
+					}
+					m_anchored = false;
+					break;
+				case NFA_OP_CLASS:
+					m_first |= m_classes[inst.m_x];
+					m_anchored = false;
+					break;
+				case NFA_OP_MATCH:
+					m_firstQ = false;
+					m_anchored = false;
+					break;
+			}
+		}
+	}
+
+	if (m_firstQ && m_first.all()) {
+		m_firstQ = false;
+	}
+	m_firstChar = -1;
+	if (m_firstQ && (m_first.count() == 1)) {
+		for (int i=0; i<256; i++) {
+			if (m_first[i]) {
+				m_firstChar = i;
+				break;
+			}
+		}
+	}
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Matching functions.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::search -- Find the leftmost match at or after index start.
+//
+
+bool HumRegexNfa::search(const string& input, int begin, int start,
+		vector<int>& captures, bool continuous, bool notnull) const {
+	if (!m_valid || (start < begin) || (start > (int)input.size())) {
+		captures.clear();
+		return false;
+	}
+	int slots = 2 * (m_groups + 1);
+	captures.resize(slots);
+	if (!run(input, begin, start, captures.data(), slots, continuous, notnull, false)) {
+		captures.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::match -- True if the expression matches all of the input.
+//
+
+bool HumRegexNfa::match(const string& input) const {
+	if (!m_valid) {
+		return false;
+	}
+	int dummy = 0;
+	return run(input, 0, 0, &dummy, 0, true, false, true);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::run -- Pike VM: simulate all NFA threads in lockstep over
+//     the input, so each character is examined once per program
+//     instruction at most.  Threads are kept in priority order and the
+//     lower-priority threads are cut off when one reaches the match
+//     state, which gives the same match as a backtracking search.
+//     slots == 0 is used when no capture positions are needed.
+//
+
+bool HumRegexNfa::run(const string& input, int begin, int start,
+		int* captures, int slots, bool continuous, bool notnull,
+		bool fullQ) const {
+	// Working storage is kept for each thread to avoid allocations:
+	static thread_local ThreadList lists[2];
+	static thread_local vector<int> fresh;
+
+	if (m_anchored && (start != begin)) {
+		return false;
+	}
+	int size   = (int)m_program.size();
+	int length = (int)input.size();
+	ThreadList* clist = &lists[0];
+	ThreadList* nlist = &lists[1];
+	clist->prepare(size, slots);
+	nlist->prepare(size, slots);
+	if ((int)fresh.size() < slots + 1) {
+		fresh.resize(slots + 1);
+	}
+	bool anchored = continuous || m_anchored;
+	bool matched  = false;
+
+	for (int pos=start; pos<=length; pos++) {
+		if (!matched && ((pos == start) || !anchored)) {
+			// Add a thread for a match starting at pos (with the
+			// lowest priority):
+			if ((clist->m_count == 0) && !anchored) {
+				pos = findStart(input, pos);
+				if (pos > length) {
+					break;
+				}
+				clist->clear();
+			}
+			if (!m_firstQ || ((pos < length) && m_first[(unsigned char)input[pos]])) {
+				std::fill(fresh.begin(), fresh.begin() + slots, -1);
+				addThread(*clist, 0, fresh.data(), slots, input, begin, pos);
+			}
+		}
+		if (clist->m_count == 0) {
+			if (matched || anchored) {
+				break;
+			}
+			continue;
+		}
+
+		nlist->clear();
+		int ch = pos < length ? (unsigned char)input[pos] : -1;
+		for (int i=0; i<clist->m_count; i++) {
+			int pc = clist->m_pcs[i];
+			int* tcaps = clist->m_captures.data() + i * slots;
+			const Instruction& inst = m_program[pc];
+			switch (inst.m_op) {
+				case NFA_OP_CHAR:
+					if (ch == inst.m_x) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_ANY:
+					if ((ch >= 0) && (ch != '\n') && (ch != '\r')) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_CLASS:
+					if ((ch >= 0) && m_classes[inst.m_x][ch]) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_MATCH:
+					if (notnull && (slots > 0) && (tcaps[0] == pos)) {
+						break;
+					}
+					if (fullQ && (pos != length)) {
+						break;
+					}
+					matched = true;
+					std::copy(tcaps, tcaps + slots, captures);
+					// cut off lower-priority threads:
+					i = clist->m_count;
+					break;
+			}
+		}
+		std::swap(clist, nlist);
+	}
+
+	return matched;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::addThread -- Add the thread for pc to the list, following
+//     jumps, splits (in priority order), capture saves and assertions.
+//     Each program location is added once per input position.
+//
+
+void HumRegexNfa::addThread(ThreadList& list, int pc, int* captures,
+		int slots, const string& input, int begin, int pos) const {
+	if (list.m_marks[pc] == list.m_generation) {
+		return;
+	}
+	list.m_marks[pc] = list.m_generation;
+	const Instruction& inst = m_program[pc];
+	switch (inst.m_op) {
+		case NFA_OP_JMP:
+			addThread(list, inst.m_x, captures, slots, input, begin, pos);
+			return;
+		case NFA_OP_SPLIT:
+			addThread(list, inst.m_x, captures, slots, input, begin, pos);
+			addThread(list, inst.m_y, captures, slots, input, begin, pos);
+			return;
+		case NFA_OP_SAVE:
+			if (inst.m_x < slots) {
+				int old = captures[inst.m_x];
+				captures[inst.m_x] = pos;
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+				captures[inst.m_x] = old;
+			} else {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_BOL:
+			if (pos == begin) {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_EOL:
+			if (pos == (int)input.size()) {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_WORDB:
+		case NFA_OP_NWORDB:
+			{
+				bool left  = (pos > begin) && nfa_isWord(input[pos-1]);
+				bool right = (pos < (int)input.size()) && nfa_isWord(input[pos]);
+				if ((left != right) == (inst.m_op == NFA_OP_WORDB)) {
+					addThread(list, pc + 1, captures, slots, input, begin, pos);
+				}
+			}
+			return;
+	}
+	int index = list.m_count++;
+	list.m_pcs[index] = pc;
+	std::copy(captures, captures + slots, list.m_captures.data() + index * slots);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::findStart -- Return the first position at or after pos
+//     where a match can start, or input.size() + 1 if there is none.
+//
+
+int HumRegexNfa::findStart(const string& input, int pos) const {
+	if (!m_firstQ) {
+		return pos;
+	}
+	int length = (int)input.size();
+	if (m_firstChar >= 0) {
+		if (pos >= length) {
+			return length + 1;
+		}
+		const char* found = (const char*)std::memchr(input.data() + pos,
+				m_firstChar, length - pos);
+		return found ? (int)(found - input.data()) : length + 1;
+	}
+	for (int i=pos; i<length; i++) {
+		if (m_first[(unsigned char)input[i]]) {
+			return i;
+		}
+	}
+	return length + 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::HumSegmentIndex --
+//
+
+HumSegmentIndex::HumSegmentIndex(void) {
+	// do nothing
+}
+
+HumSegmentIndex::HumSegmentIndex(const string& filename) {
+	load(filename);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::clear --
+//
+
+void HumSegmentIndex::clear(void) {
+	m_filename.clear();
+	m_filesize = 0;
+	m_referencesQ = false;
+	m_segments.clear();
+	m_universals.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getIndexFilename -- Return the name of the sidecar
+//    index file for a data file.
+//
+
+string HumSegmentIndex::getIndexFilename(const string& filename) {
+	return filename + ".segidx";
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::build -- Scan a data file and store the byte offset,
+//    length and name of each segment.  Segments are split at !!!!SEGMENT:
+//    records, and at exclusive interpretation lines after the first one
+//    in a segment (for files concatenated without !!!!SEGMENT: records),
+//    in the same way as HumdrumFileStream::getFile(), which also
+//    removes universal comments at the start of a segment and prepends
+//    them to the segments that follow; the universal comments in effect
+//    at the start of each segment are stored with it.  If referencesQ is
+//    true, then the keys of the reference records in each segment are
+//    also stored.  Returns false if the file cannot be read.
+//
+
+bool HumSegmentIndex::build(const string& filename, bool referencesQ) {
+	ifstream input(filename, ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	bool status = build(input, referencesQ);
+	m_filename = filename;
+	return status;
+}
+
+
+bool HumSegmentIndex::build(istream& input, bool referencesQ) {
+	clear();
+	m_referencesQ = referencesQ;
+
+	// The first segment starts at the beginning of the file, even if
+	// there is no !!!!SEGMENT: record.
+	m_segments.emplace_back();
+
+	vector<string> universals;  // universal comments from previous segments
+	vector<string> current;     // universal comments in current segment
+	bool foundUniversalQ = false;
+	bool dataFoundQ      = false;
+	bool bufferEmptyQ    = true;
+	bool starstarFoundQ  = false;
+	bool starminusFoundQ = false;
+
+	string line;
+	long long offset = 0;
+	while (getline(input, line)) {
+		long long linestart = offset;
+		offset += line.size();
+		if (!input.eof()) {
+			offset++;
+		}
+
+		if (line.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0) {
+			if (!bufferEmptyQ) {
+				// Start a new segment.  The !!!!SEGMENT: line is not
+				// processed further in HumdrumFileStream::getFile().
+				m_segments.back().m_length = linestart - m_segments.back().m_offset;
+				if (foundUniversalQ) {
+					universals = current;
+				}
+				addSegment(linestart, line);
+				m_segments.back().m_universal = addUniversals(universals);
+				foundUniversalQ = false;
+				dataFoundQ      = false;
+				starstarFoundQ  = false;
+				starminusFoundQ = false;
+				continue;
+			}
+			// First record of the first segment.
+			long long start = m_segments.back().m_offset;
+			m_segments.pop_back();
+			addSegment(start, line);
+		}
+
+		if (line.compare(0, 2, "**") == 0) {
+			if (starstarFoundQ) {
+				// Start an unnamed segment.  The ** line is the first
+				// line of the new segment in getFile().
+				m_segments.back().m_length = linestart - m_segments.back().m_offset;
+				if (foundUniversalQ) {
+					universals = current;
+				}
+				m_segments.emplace_back();
+				m_segments.back().m_offset = linestart;
+				m_segments.back().m_universal = addUniversals(universals);
+				foundUniversalQ = false;
+				dataFoundQ      = false;
+				starminusFoundQ = false;
+				continue;
+			}
+			starstarFoundQ = true;
+		}
+
+		if ((line.size() > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !dataFoundQ &&
+				(line.compare(0, strlen("!!!!filter:"), "!!!!filter:") != 0) &&
+				(line.compare(0, strlen("!!!!SEGMENT:"), "!!!!SEGMENT:") != 0)) {
+			if (!foundUniversalQ) {
+				current.clear();
+				foundUniversalQ = true;
+			}
+			current.push_back(line);
+		} else if ((starminusFoundQ || !starstarFoundQ) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// Filename list entry (not part of the segment).
+			continue;
+		} else {
+			if (line.compare(0, 2, "*-") == 0) {
+				starminusFoundQ = true;
+			}
+			dataFoundQ = true;
+			bufferEmptyQ = false;
+		}
+
+		if (!referencesQ || (line.compare(0, 3, "!!!") != 0)) {
+			continue;
+		}
+		size_t start = line.find_first_not_of('!');
+		size_t colon = line.find(':');
+		if ((start > 4) || (colon == string::npos) || (colon <= start)) {
+			continue;
+		}
+		string key = line.substr(start, colon - start);
+		if ((key == "SEGMENT") || (key.find_first_of(" \t") != string::npos)) {
+			continue;
+		}
+		if (!hasReferenceKey(getSize() - 1, key)) {
+			m_segments.back().m_keys.push_back(key);
+		}
+	}
+
+	m_segments.back().m_length = offset - m_segments.back().m_offset;
+	m_filesize = offset;
+	if ((m_segments.size() == 1) && (offset == 0)) {
+		// empty file
+		m_segments.clear();
+	}
+	makeNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addSegment -- Add a segment starting with the given
+//    !!!!SEGMENT: line.
+//
+
+void HumSegmentIndex::addSegment(long long offset, const string& line) {
+	m_segments.emplace_back();
+	Segment& segment = m_segments.back();
+	segment.m_offset = offset;
+	HumRegex hre;
+	if (hre.search(line, R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*?)\s*$)")) {
+		if (hre.getMatchLength(1) > 0) {
+			segment.m_level = hre.getMatchInt(1);
+		}
+		segment.m_name = hre.getMatch(2);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addUniversals -- Return the index of a list of
+//    universal comments, adding it if it is different from the last one.
+//    Returns -1 for an empty list.
+//
+
+int HumSegmentIndex::addUniversals(const vector<string>& universals) {
+	if (universals.empty()) {
+		return -1;
+	}
+	if (m_universals.empty() || (m_universals.back() != universals)) {
+		m_universals.push_back(universals);
+	}
+	return (int)m_universals.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::makeNameIndex -- Map segment names to segment indexes.
+//
+
+void HumSegmentIndex::makeNameIndex(void) {
+	m_names.clear();
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if (!m_segments[i].m_name.empty()) {
+			m_names.emplace(m_segments[i].m_name, i);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::load -- Read the sidecar index file of a data file.  If
+//     there is no index file, or the data file size has changed since it
+//     was written, or it does not contain the reference keys when
+//     referencesQ is true, then the data file is scanned and a new index
+//     file is written.  Returns false if the data file cannot be read.
+//
+
+bool HumSegmentIndex::load(const string& filename, bool referencesQ) {
+	string indexname = getIndexFilename(filename);
+	ifstream input(filename, ios::binary | ios::ate);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	long long filesize = (long long)input.tellg();
+	input.close();
+
+	if (readIndex(indexname) && (m_filesize == filesize) &&
+			(m_referencesQ || !referencesQ)) {
+		m_filename = filename;
+		return true;
+	}
+
+	if (!build(filename, referencesQ)) {
+		return false;
+	}
+	// The index can be used even if the sidecar file cannot be written:
+	writeIndex(indexname);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::writeIndex -- Write the index as a sidecar file.  The
+//    file is tab-separated text:
+//
+//    humsegmentindex  1
+//    size             <data file size>
+//    references       <0 or 1>
+//    universal        <list index>  <universal comment>
+//    segment          <offset>  <length>  <level>  <universal list>  <name>  <reference keys ...>
+//
+
+bool HumSegmentIndex::writeIndex(const string& indexname) const {
+	ofstream output(indexname, ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	return writeIndex(output);
+}
+
+
+bool HumSegmentIndex::writeIndex(ostream& output) const {
+	output << "humsegmentindex\t1\n";
+	output << "size\t" << m_filesize << "\n";
+	output << "references\t" << (m_referencesQ ? 1 : 0) << "\n";
+	for (int i=0; i<(int)m_universals.size(); i++) {
+		for (int j=0; j<(int)m_universals[i].size(); j++) {
+			output << "universal\t" << i << "\t" << m_universals[i][j] << "\n";
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		const Segment& segment = m_segments[i];
+		output << "segment\t" << segment.m_offset;
+		output << "\t" << segment.m_length;
+		output << "\t" << segment.m_level;
+		output << "\t" << segment.m_universal;
+		output << "\t" << segment.m_name;
+		for (int j=0; j<(int)segment.m_keys.size(); j++) {
+			output << "\t" << segment.m_keys[j];
+		}
+		output << "\n";
+	}
+	output.flush();
+	return output.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::readIndex -- Read a sidecar index file.  Returns false
+//    if the file cannot be read or is not a segment index.
+//
+
+bool HumSegmentIndex::readIndex(const string& indexname) {
+	ifstream input(indexname, ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	bool status = readIndex(input);
+	string suffix = getIndexFilename("");
+	if (status && (indexname.size() > suffix.size()) &&
+			(indexname.compare(indexname.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+		m_filename = indexname.substr(0, indexname.size() - suffix.size());
+	}
+	return status;
+}
+
+
+bool HumSegmentIndex::readIndex(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line != "humsegmentindex\t1")) {
+		return false;
+	}
+	vector<string> fields;
+	try {
+		while (getline(input, line)) {
+			if (line.compare(0, 10, "universal\t") == 0) {
+				// The comment may contain tabs.
+				size_t tab = line.find('\t', 10);
+				if (tab == string::npos) {
+					clear();
+					return false;
+				}
+				int index = stoi(line.substr(10, tab - 10));
+				if (index < 0) {
+					clear();
+					return false;
+				} else if (index >= (int)m_universals.size()) {
+					m_universals.resize(index + 1);
+				}
+				m_universals[index].push_back(line.substr(tab + 1));
+				continue;
+			}
+
+			fields.clear();
+			stringstream ss(line);
+			string field;
+			while (getline(ss, field, '\t')) {
+				fields.push_back(field);
+			}
+			if (fields.empty()) {
+				continue;
+			} else if ((fields[0] == "size") && (fields.size() == 2)) {
+				m_filesize = stoll(fields[1]);
+			} else if ((fields[0] == "references") && (fields.size() == 2)) {
+				m_referencesQ = fields[1] == "1";
+			} else if ((fields[0] == "segment") && (fields.size() >= 5)) {
+				m_segments.emplace_back();
+				Segment& segment = m_segments.back();
+				segment.m_offset    = stoll(fields[1]);
+				segment.m_length    = stoll(fields[2]);
+				segment.m_level     = stoi(fields[3]);
+				segment.m_universal = stoi(fields[4]);
+				if (fields.size() > 5) {
+					segment.m_name = fields[5];
+				}
+				segment.m_keys.assign(fields.begin() + min((int)fields.size(), 6), fields.end());
+			} else {
+				clear();
+				return false;
+			}
+		}
+	} catch (const std::exception&) {
+		// malformed number
+		clear();
+		return false;
+	}
+
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if ((m_segments[i].m_universal < -1) ||
+				(m_segments[i].m_universal >= (int)m_universals.size())) {
+			clear();
+			return false;
+		}
+	}
+	makeNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegment -- Return the index of the first segment
+//    with the given name, or -1 if there is no such segment.
+//
+
+int HumSegmentIndex::getSegment(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getOffset -- Return the byte offset of a segment in
+//    the data file.
+//
+
+long long HumSegmentIndex::getOffset(int index) const {
+	return m_segments.at(index).m_offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getLength -- Return the number of bytes in a segment.
+//
+
+long long HumSegmentIndex::getLength(int index) const {
+	return m_segments.at(index).m_length;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getName -- Return the name of a segment from its
+//    !!!!SEGMENT: record (empty if there is no record).
+//
+
+const string& HumSegmentIndex::getName(int index) const {
+	return m_segments.at(index).m_name;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getLevel -- Return the level of a segment from its
+//    !!!!SEGMENT: record (such as 1 for !!!!SEGMENT+1:).
+//
+
+int HumSegmentIndex::getLevel(int index) const {
+	return m_segments.at(index).m_level;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getUniversals -- Return the universal comments from
+//    previous segments that apply to a segment.
+//
+
+const vector<string>& HumSegmentIndex::getUniversals(int index) const {
+	static const vector<string> empty;
+	int universal = m_segments.at(index).m_universal;
+	if (universal < 0) {
+		return empty;
+	}
+	return m_universals[universal];
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getReferenceKeys -- Return the keys of the reference
+//    records in a segment (if the index was built with reference keys).
+//
+
+const vector<string>& HumSegmentIndex::getReferenceKeys(int index) const {
+	return m_segments.at(index).m_keys;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::hasReferenceKey -- Returns true if the segment contains
+//    a reference record with the given key.
+//
+
+bool HumSegmentIndex::hasReferenceKey(int index, const string& key) const {
+	const vector<string>& keys = m_segments.at(index).m_keys;
+	for (int i=0; i<(int)keys.size(); i++) {
+		if (keys[i] == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getText -- Read the contents of a segment from the data
+//    file.  Returns false if the segment cannot be read.
+//
+
+bool HumSegmentIndex::getText(istream& input, int index, string& text) const {
+	text.clear();
+	if ((index < 0) || (index >= getSize())) {
+		return false;
+	}
+	const Segment& segment = m_segments[index];
+	input.clear();
+	input.seekg(segment.m_offset);
+	if (!input) {
+		return false;
+	}
+	text.resize((size_t)segment.m_length);
+	if (segment.m_length > 0) {
+		input.read(&text[0], segment.m_length);
+	}
+	if (input.gcount() != segment.m_length) {
+		text.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
 
 //////////////////////////////
 //
@@ -17333,6 +20909,23 @@ HumSignifiers::HumSignifiers(void) {
 
 
 
+//////////////////////////////
+//
+// HumSignifiers::HumSignifiers -- Copy constructor (the signifier
+//    list is duplicated) and move constructor (the list is transferred).
+//
+
+HumSignifiers::HumSignifiers(const HumSignifiers& signifiers) {
+	*this = signifiers;
+}
+
+
+HumSignifiers::HumSignifiers(HumSignifiers&& signifiers) noexcept {
+	*this = std::move(signifiers);
+}
+
+
+
 //////////////////////////////
 //
 // HumSignifiers::~HumSignifier --
@@ -17344,6 +20937,44 @@ HumSignifiers::~HumSignifiers() {
 
 
 
+//////////////////////////////
+//
+// HumSignifiers::operator= -- Copy and move assignment.
+//
+
+HumSignifiers& HumSignifiers::operator=(const HumSignifiers& signifiers) {
+	if (this == &signifiers) {
+		return *this;
+	}
+	clear();
+	m_signifiers.reserve(signifiers.m_signifiers.size());
+	for (int i=0; i<(int)signifiers.m_signifiers.size(); i++) {
+		m_signifiers.push_back(new HumSignifier(*signifiers.m_signifiers[i]));
+	}
+	m_kernLinkIndex  = signifiers.m_kernLinkIndex;
+	m_kernAboveIndex = signifiers.m_kernAboveIndex;
+	m_kernBelowIndex = signifiers.m_kernBelowIndex;
+	return *this;
+}
+
+
+HumSignifiers& HumSignifiers::operator=(HumSignifiers&& signifiers) noexcept {
+	if (this == &signifiers) {
+		return *this;
+	}
+	clear();
+	m_signifiers.swap(signifiers.m_signifiers);
+	m_kernLinkIndex  = signifiers.m_kernLinkIndex;
+	m_kernAboveIndex = signifiers.m_kernAboveIndex;
+	m_kernBelowIndex = signifiers.m_kernBelowIndex;
+	signifiers.m_kernLinkIndex  = -1;
+	signifiers.m_kernAboveIndex = -1;
+	signifiers.m_kernBelowIndex = -1;
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumSignifiers::clear --
@@ -17490,6 +21121,221 @@ HumSignifier* HumSignifiers::getSignifier(int index) {
 
 
 
+//////////////////////////////
+//
+// HumStringPool::HumStringPool --
+//
+
+HumStringPool::HumStringPool(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::~HumStringPool --
+//
+
+HumStringPool::~HumStringPool() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::intern -- Return a pointer to the pooled copy of the
+//    given string, adding it to the pool if it is not already there.
+//    Elements of an unordered_set are not moved when the set grows, so
+//    the pointer remains valid.
+//
+
+const string* HumStringPool::intern(const string& text) {
+	lock_guard<mutex> lock(m_mutex);
+	auto result = m_strings.insert(text);
+	if (result.second) {
+		m_textsize += text.size();
+	}
+	return &(*result.first);
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::find -- Return a pointer to the pooled copy of the
+//    given string, or NULL if it is not in the pool.
+//
+
+const string* HumStringPool::find(const string& text) const {
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_strings.find(text);
+	if (it == m_strings.end()) {
+		return NULL;
+	}
+	return &(*it);
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::getSize -- Return the number of strings in the pool.
+//
+
+int HumStringPool::getSize(void) const {
+	lock_guard<mutex> lock(m_mutex);
+	return (int)m_strings.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::getTextSize -- Return the total number of characters
+//    in the strings of the pool.
+//
+
+size_t HumStringPool::getTextSize(void) const {
+	lock_guard<mutex> lock(m_mutex);
+	return m_textsize;
+}
+
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::HumTokenLinks -- Copy constructor.
+//
+
+HumTokenLinks::HumTokenLinks(const HumTokenLinks& links) {
+	*this = links;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::~HumTokenLinks -- Deconstructor.
+//
+
+HumTokenLinks::~HumTokenLinks() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::operator= -- Copy the links of another list.
+//
+
+HumTokenLinks& HumTokenLinks::operator=(const HumTokenLinks& links) {
+	if (this == &links) {
+		return *this;
+	}
+	clear();
+	reserve(links.m_size);
+	const HTp* source = links.data();
+	HTp* target = data();
+	for (int i=0; i<links.m_size; i++) {
+		target[i] = source[i];
+	}
+	m_size = links.m_size;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::clear -- Remove all links, and free the array if the
+//    list had more than one link.
+//
+
+void HumTokenLinks::clear(void) {
+	if (m_capacity > 1) {
+		delete [] m_array;
+		m_capacity = 1;
+	}
+	m_single = NULL;
+	m_size = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::resize -- Change the number of links.  New links are
+//    set to NULL.
+//
+
+void HumTokenLinks::resize(int count) {
+	if (count < 0) {
+		count = 0;
+	}
+	reserve(count);
+	HTp* links = data();
+	for (int i=m_size; i<count; i++) {
+		links[i] = NULL;
+	}
+	m_size = count;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::push_back -- Append a link to the list.
+//
+
+void HumTokenLinks::push_back(HTp token) {
+	if (m_size == m_capacity) {
+		reserve(m_capacity * 2);
+	}
+	data()[m_size++] = token;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::toVector -- Return a copy of the links as a vector.
+//
+
+vector<HTp> HumTokenLinks::toVector(void) const {
+	return vector<HTp>(begin(), end());
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::reserve -- Make space for at least the given number
+//    of links.  Existing links are kept.
+//
+
+void HumTokenLinks::reserve(int count) {
+	if (count <= m_capacity) {
+		return;
+	}
+	HTp* newarray = new HTp[count];
+	const HTp* oldarray = data();
+	for (int i=0; i<m_size; i++) {
+		newarray[i] = oldarray[i];
+	}
+	if (m_capacity > 1) {
+		delete [] m_array;
+	}
+	m_array = newarray;
+	m_capacity = count;
+}
+
+
+
+
 //////////////////////////////
 //
 // HumTool::HumTool --
@@ -19659,6 +23505,902 @@ int main(void) {
  */
 
 
+
+//////////////////////////////
+//
+// HumWordIndex::HumWordIndex --
+//
+
+HumWordIndex::HumWordIndex(void) {
+	// do nothing
+}
+
+HumWordIndex::HumWordIndex(HumdrumFile& infile) {
+	build(infile);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::clear --
+//
+
+void HumWordIndex::clear(void) {
+	m_name.clear();
+	m_linecount = 0;
+	m_words.clear();
+	m_sorted.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::build -- Index the words in the **silbe spines of a file,
+//    or in the **text spines if there are no **silbe spines.  Returns
+//    false if the file has no lyric spines.
+//
+
+bool HumWordIndex::build(HumdrumFile& infile) {
+	clear();
+	m_name = infile.getFilename();
+	m_linecount = infile.getLineCount();
+	vector<HTp> textspines;
+	infile.getSpineStartList(textspines, "**silbe");
+	if (textspines.empty()) {
+		infile.getSpineStartList(textspines, "**text");
+	}
+	for (int i=0; i<(int)textspines.size(); i++) {
+		addSpine(textspines[i]);
+	}
+	sortKeys();
+	return !textspines.empty();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::addSpine -- Add the words in a spine.  A syllable
+//    starting with "-" continues the previous word in the spine.
+//
+
+void HumWordIndex::addSpine(HTp starttoken) {
+	int lastword = -1;
+	HTp tok = starttoken->getNextToken();
+	while (tok != NULL) {
+		if (tok->empty() || tok->isNull() || !tok->isData()) {
+			tok = tok->getNextToken();
+			continue;
+		}
+		if (tok->at(0) == '-') {
+			if (lastword >= 0) {
+				string& text = m_words[lastword].m_text;
+				text.append(*tok, 1, string::npos);
+				if (!text.empty() && (text.back() == '-')) {
+					text.pop_back();
+				}
+			}
+			tok = tok->getNextToken();
+			continue;
+		}
+		if (lastword >= 0) {
+			m_words[lastword].m_nextline  = tok->getLineIndex();
+			m_words[lastword].m_nextfield = tok->getFieldIndex();
+		}
+		m_words.emplace_back();
+		Word& word = m_words.back();
+		word.m_line  = tok->getLineIndex();
+		word.m_field = tok->getFieldIndex();
+		word.m_track = tok->getTrack();
+		word.m_text  = *tok;
+		if (!word.m_text.empty() && (word.m_text.back() == '-')) {
+			word.m_text.pop_back();
+		}
+		lastword = (int)m_words.size() - 1;
+		tok = tok->getNextToken();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::sortKeys -- Normalize the words and sort them.
+//
+
+void HumWordIndex::sortKeys(void) {
+	m_sorted.clear();
+	m_sorted.reserve(m_words.size());
+	for (int i=0; i<(int)m_words.size(); i++) {
+		if (m_words[i].m_key.empty()) {
+			m_words[i].m_key = normalize(m_words[i].m_text);
+		}
+		if (!m_words[i].m_key.empty()) {
+			m_sorted.push_back(i);
+		}
+	}
+	stable_sort(m_sorted.begin(), m_sorted.end(), [&](int a, int b) {
+		return m_words[a].m_key < m_words[b].m_key;
+	});
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::normalize -- Convert text into an index key: letters are
+//    lower case and without diacritics (Latin-1 and Latin Extended-A
+//    characters, combining marks and HTML-style entities such as &eacute;),
+//    and punctuation is removed.  Other UTF-8 characters are kept.  If
+//    wildcardsQ is true, "*" and "?" are also kept.
+//
+
+string HumWordIndex::normalize(const string& text, bool wildcardsQ) {
+	// Base letters for U+00C0 to U+00FF ('.' = remove, '1' = "ae",
+	// '2' = "th", '3' = "ss"):
+	static const char* latin1 =
+		"aaaaaa1ceeeeiiiidnooooo.ouuuuy23"
+		"aaaaaa1ceeeeiiiidnooooo.ouuuuy2y";
+	// Base letters for U+0100 to U+017F ('4' = "ij", '5' = "oe"):
+	static const char* latinA =
+		"aaaaaaccccccccddddeeeeeeeeeegggg"
+		"gggghhhhiiiiiiiiii44jjkkklllllll"
+		"lllnnnnnnnnnoooooo55rrrrrrssssss"
+		"ssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+	string output;
+	output.reserve(text.size());
+	int size = (int)text.size();
+	for (int i=0; i<size; i++) {
+		unsigned char ch = (unsigned char)text[i];
+		if (ch < 0x80) {
+			if (isalnum(ch)) {
+				output += (char)tolower(ch);
+			} else if (wildcardsQ && ((ch == '*') || (ch == '?'))) {
+				output += (char)ch;
+			} else if (ch == '&') {
+				// &eacute; style entity:
+				size_t end = text.find(';', i);
+				if ((end != string::npos) && (end - i < 10) && (end - i > 2)) {
+					string name = text.substr(i + 1, end - i - 1);
+					if (name == "szlig") {
+						output += "ss";
+						i = (int)end;
+					} else if ((name == "aelig") || (name == "AElig")) {
+						output += "ae";
+						i = (int)end;
+					} else if ((name == "oelig") || (name == "OElig")) {
+						output += "oe";
+						i = (int)end;
+					} else if (isalpha((unsigned char)name[0])) {
+						static const char* marks[] = {"acute", "grave", "uml", "circ",
+								"tilde", "cedil", "ring", "slash", "caron", "macr", NULL};
+						for (int j=0; marks[j]; j++) {
+							if (name.compare(1, string::npos, marks[j]) == 0) {
+								output += (char)tolower((unsigned char)name[0]);
+								i = (int)end;
+								break;
+							}
+						}
+					}
+				}
+			}
+			continue;
+		}
+
+		// UTF-8 character:
+		int count = 1;
+		int code = 0;
+		if ((ch & 0xe0) == 0xc0) {
+			count = 2;
+			code = ch & 0x1f;
+		} else if ((ch & 0xf0) == 0xe0) {
+			count = 3;
+			code = ch & 0x0f;
+		} else if ((ch & 0xf8) == 0xf0) {
+			count = 4;
+			code = ch & 0x07;
+		} else {
+			// invalid lead byte
+			continue;
+		}
+		if (i + count > size) {
+			break;
+		}
+		for (int j=1; j<count; j++) {
+			code = (code << 6) | ((unsigned char)text[i+j] & 0x3f);
+		}
+
+		char base = 0;
+		if ((code >= 0xc0) && (code <= 0xff)) {
+			base = latin1[code - 0xc0];
+		} else if ((code >= 0x100) && (code <= 0x17f)) {
+			base = latinA[code - 0x100];
+		} else if ((code >= 0x300) && (code <= 0x36f)) {
+			// combining diacritic
+			base = '.';
+		} else if ((code < 0xc0) || ((code >= 0x2000) && (code <= 0x206f))) {
+			// Latin-1 and general punctuation
+			base = '.';
+		}
+
+		switch (base) {
+			case 0:   output.append(text, i, count); break;
+			case '.': break;
+			case '1': output += "ae"; break;
+			case '2': output += "th"; break;
+			case '3': output += "ss"; break;
+			case '4': output += "ij"; break;
+			case '5': output += "oe"; break;
+			default:  output += base;
+		}
+		i += count - 1;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getRange -- Return the range [first, last) in the sorted
+//    word list of keys starting with the given prefix.
+//
+
+void HumWordIndex::getRange(const string& prefix, int& first, int& last) const {
+	auto begin = lower_bound(m_sorted.begin(), m_sorted.end(), prefix,
+		[&](int index, const string& value) {
+			return m_words[index].m_key < value;
+		});
+	auto end = begin;
+	while ((end != m_sorted.end()) &&
+			(m_words[*end].m_key.compare(0, prefix.size(), prefix) == 0)) {
+		end++;
+	}
+	first = (int)(begin - m_sorted.begin());
+	last  = (int)(end - m_sorted.begin());
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::find -- Look up a query word: a query ending in "*" with
+//    no other wildcards is a prefix search, a query containing "*" (any
+//    characters) or "?" (one character) is a wildcard search, and anything
+//    else is an exact search.  The query is normalized the same way as the
+//    indexed words.  Returns the number of matches.
+//
+
+int HumWordIndex::find(vector<int>& matches, const string& query) const {
+	string key = normalize(query, true);
+	size_t wild = key.find_first_of("*?");
+	if (wild == string::npos) {
+		return findExact(matches, key);
+	}
+	if ((wild == key.size() - 1) && (key.back() == '*')) {
+		key.pop_back();
+		return findPrefix(matches, key);
+	}
+	return findWildcard(matches, key);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findExact -- Find words with the given normalized form.
+//
+
+int HumWordIndex::findExact(vector<int>& matches, const string& word) const {
+	matches.clear();
+	if (word.empty()) {
+		return 0;
+	}
+	auto range = equal_range(m_sorted.begin(), m_sorted.end(), -1,
+		[&](int a, int b) {
+			const string& akey = (a < 0) ? word : m_words[a].m_key;
+			const string& bkey = (b < 0) ? word : m_words[b].m_key;
+			return akey < bkey;
+		});
+	matches.assign(range.first, range.second);
+	// Equal keys are already in file order.
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findPrefix -- Find words starting with the given
+//     normalized text.  An empty prefix matches all words.
+//
+
+int HumWordIndex::findPrefix(vector<int>& matches, const string& prefix) const {
+	matches.clear();
+	int first;
+	int last;
+	getRange(prefix, first, last);
+	matches.assign(m_sorted.begin() + first, m_sorted.begin() + last);
+	sort(matches.begin(), matches.end());
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findWildcard -- Find words matching a normalized pattern
+//     containing "*" and "?" wildcards.  Only words starting with the
+//     text before the first wildcard are checked.
+//
+
+int HumWordIndex::findWildcard(vector<int>& matches, const string& pattern) const {
+	matches.clear();
+	string prefix = pattern.substr(0, pattern.find_first_of("*?"));
+	int first;
+	int last;
+	getRange(prefix, first, last);
+	for (int i=first; i<last; i++) {
+		if (wildcardMatch(pattern.c_str(), m_words[m_sorted[i]].m_key.c_str())) {
+			matches.push_back(m_sorted[i]);
+		}
+	}
+	sort(matches.begin(), matches.end());
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::wildcardMatch -- Match text against a pattern where "*"
+//     matches any sequence of characters and "?" matches one (UTF-8)
+//     character.
+//
+
+bool HumWordIndex::wildcardMatch(const char* pattern, const char* text) {
+	const char* star = NULL;
+	const char* resume = NULL;
+	while (*text) {
+		if (*pattern == '?') {
+			pattern++;
+			text++;
+			while (((unsigned char)*text & 0xc0) == 0x80) {
+				text++;
+			}
+		} else if (*pattern == '*') {
+			star = pattern++;
+			resume = text;
+		} else if (*pattern == *text) {
+			pattern++;
+			text++;
+		} else if (star) {
+			pattern = star + 1;
+			text = ++resume;
+		} else {
+			return false;
+		}
+	}
+	while (*pattern == '*') {
+		pattern++;
+	}
+	return *pattern == '\0';
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getWord -- Return the word as written in the file, with
+//     the syllables joined.
+//
+
+const string& HumWordIndex::getWord(int index) const {
+	return m_words.at(index).m_text;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getKey -- Return the normalized word.
+//
+
+const string& HumWordIndex::getKey(int index) const {
+	return m_words.at(index).m_key;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getTrack -- Return the track of the spine containing
+//     the word.
+//
+
+int HumWordIndex::getTrack(int index) const {
+	return m_words.at(index).m_track;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getLineIndex -- Return the line index of the first
+//     syllable of the word.
+//
+
+int HumWordIndex::getLineIndex(int index) const {
+	return m_words.at(index).m_line;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getFieldIndex -- Return the field index of the first
+//     syllable of the word.
+//
+
+int HumWordIndex::getFieldIndex(int index) const {
+	return m_words.at(index).m_field;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getStartToken -- Return the token of the first syllable
+//     of the word in the indexed file, or NULL if the location is not in
+//     the file.
+//
+
+HTp HumWordIndex::getStartToken(HumdrumFile& infile, int index) const {
+	const Word& word = m_words.at(index);
+	if ((word.m_line < 0) || (word.m_line >= infile.getLineCount())) {
+		return NULL;
+	}
+	if ((word.m_field < 0) || (word.m_field >= infile[word.m_line].getFieldCount())) {
+		return NULL;
+	}
+	return infile.token(word.m_line, word.m_field);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getNextToken -- Return the token of the first syllable
+//     of the next word in the same spine, or NULL if this is the last word.
+//
+
+HTp HumWordIndex::getNextToken(HumdrumFile& infile, int index) const {
+	const Word& word = m_words.at(index);
+	if ((word.m_nextline < 0) || (word.m_nextline >= infile.getLineCount())) {
+		return NULL;
+	}
+	if ((word.m_nextfield < 0) || (word.m_nextfield >= infile[word.m_nextline].getFieldCount())) {
+		return NULL;
+	}
+	return infile.token(word.m_nextline, word.m_nextfield);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::writeIndex -- Write the index as tab-separated text.
+//     Several indexes can be written one after another into the same
+//     stream:
+//
+//    humwordindex  1
+//    name          <filename>
+//    lines         <line count>
+//    word          <line>  <field>  <next line>  <next field>  <track>  <key>  <word>
+//    end
+//
+
+bool HumWordIndex::writeIndex(ostream& output) const {
+	output << "humwordindex\t1\n";
+	output << "name\t" << m_name << "\n";
+	output << "lines\t" << m_linecount << "\n";
+	for (int i=0; i<(int)m_words.size(); i++) {
+		const Word& word = m_words[i];
+		output << "word\t" << word.m_line;
+		output << "\t" << word.m_field;
+		output << "\t" << word.m_nextline;
+		output << "\t" << word.m_nextfield;
+		output << "\t" << word.m_track;
+		output << "\t" << word.m_key;
+		output << "\t" << word.m_text;
+		output << "\n";
+	}
+	output << "end\n";
+	return output.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::readIndex -- Read the next index from a stream.  Returns
+//    false at the end of the stream or if the input is not a word index.
+//
+
+bool HumWordIndex::readIndex(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line != "humwordindex\t1")) {
+		return false;
+	}
+	vector<string> fields;
+	try {
+		while (getline(input, line)) {
+			if (line == "end") {
+				sortKeys();
+				return true;
+			}
+			fields.clear();
+			size_t start = 0;
+			while (true) {
+				size_t tab = line.find('\t', start);
+				if (tab == string::npos) {
+					fields.push_back(line.substr(start));
+					break;
+				}
+				fields.push_back(line.substr(start, tab - start));
+				start = tab + 1;
+			}
+			if ((fields[0] == "name") && (fields.size() == 2)) {
+				m_name = fields[1];
+			} else if ((fields[0] == "lines") && (fields.size() == 2)) {
+				m_linecount = stoi(fields[1]);
+			} else if ((fields[0] == "word") && (fields.size() == 8)) {
+				m_words.emplace_back();
+				Word& word = m_words.back();
+				word.m_line      = stoi(fields[1]);
+				word.m_field     = stoi(fields[2]);
+				word.m_nextline  = stoi(fields[3]);
+				word.m_nextfield = stoi(fields[4]);
+				word.m_track     = stoi(fields[5]);
+				word.m_key       = fields[6];
+				word.m_text      = fields[7];
+			} else {
+				clear();
+				return false;
+			}
+		}
+	} catch (const std::exception&) {
+		// malformed number
+		clear();
+		return false;
+	}
+	// missing "end" line
+	clear();
+	return false;
+}
+
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::HumdrumExpansionView --
+//
+
+HumdrumExpansionView::HumdrumExpansionView(void) {
+	// do nothing
+}
+
+HumdrumExpansionView::HumdrumExpansionView(HumdrumFile& infile,
+		const string& variant) {
+	analyze(infile, variant);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::clear -- Remove the view of the file.  The
+//    setting for keeping expansion lists is not changed.
+//
+
+void HumdrumExpansionView::clear(void) {
+	m_infile = NULL;
+	m_expandedQ = false;
+	m_lines.clear();
+	m_sections.clear();
+	m_shifts.clear();
+	m_scoreDuration = 0;
+	m_sequence.clear();
+	m_sequenceLine.clear();
+	m_sequenceStart.clear();
+	m_sequenceEnd.clear();
+	m_footerStart = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::analyze -- Build the expanded line order for
+//    the file.  The label sequence is taken from the realization string
+//    if it is not empty, otherwise from the first *>variant[...] line
+//    in the file.  Returns false if no label sequence was found, in
+//    which case the view contains the lines of the file in their
+//    original order.  Lines containing *thru are not included in the
+//    view, and expansion-list lines are only included in an expanded
+//    view if setKeepLists(true) was called.  Labels in the sequence
+//    that are not in the file are kept in the sequence list with no
+//    lines (see hasSequenceLabel()).
+//
+
+bool HumdrumExpansionView::analyze(HumdrumFile& infile, const string& variant,
+		const string& realization) {
+	clear();
+	m_infile = &infile;
+	int lineCount = infile.getLineCount();
+	m_lines.reserve(lineCount);
+	m_sections.reserve(lineCount);
+
+	if (!realization.empty()) {
+		getLabelSequence(m_sequence, realization);
+		m_expandedQ = true;
+	} else {
+		m_expandedQ = findLabelSequence(infile, variant) >= 0;
+	}
+
+	if (!m_expandedQ) {
+		m_shifts.push_back(0);
+		addLines(0, lineCount, 0, false);
+		m_footerStart = (int)m_lines.size();
+		m_scoreDuration = infile.getScoreDuration();
+		return false;
+	}
+
+	// Find the labeled sections and the end of the data.
+	vector<string> labels;
+	vector<int> labellines;
+	int footer = -1;
+	for (int i=0; i<lineCount; i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		HTp token = infile.token(i, 0);
+		if (*token == "*-") {
+			footer = i;
+			continue;
+		}
+		if (token->compare(0, 2, "*>") != 0) {
+			continue;
+		}
+		if (token->find('[') != string::npos) {
+			continue;
+		}
+		if (token->find(']') != string::npos) {
+			continue;
+		}
+		labels.push_back(token->substr(2));
+		labellines.push_back(i);
+	}
+	if (footer < 0) {
+		footer = lineCount;
+	}
+
+	auto timeAt = [&](int line) -> HumNum {
+		if (line >= lineCount) {
+			return infile.getScoreDuration();
+		}
+		return infile[line].getDurationFromStart();
+	};
+
+	int headerEnd = labellines.empty() ? 0 : labellines[0];
+	m_shifts.push_back(0);
+	addLines(0, headerEnd, 0, !m_keepQ);
+	HumNum current = timeAt(headerEnd);
+
+	int count = (int)m_sequence.size();
+	m_sequenceLine.resize(count, -1);
+	m_sequenceStart.resize(count, 0);
+	m_sequenceEnd.resize(count, 0);
+	for (int i=0; i<count; i++) {
+		int index = -1;
+		for (int j=0; j<(int)labels.size(); j++) {
+			if (labels[j] == m_sequence[i]) {
+				index = j;
+				break;
+			}
+		}
+		m_sequenceStart[i] = (int)m_lines.size();
+		if (index < 0) {
+			m_shifts.push_back(current);
+			m_sequenceEnd[i] = m_sequenceStart[i];
+			continue;
+		}
+		int startline = labellines[index];
+		int endline = index + 1 < (int)labellines.size() ? labellines[index+1] : footer;
+		m_sequenceLine[i] = startline;
+		HumNum starttime = timeAt(startline);
+		m_shifts.push_back(current - starttime);
+		addLines(startline, endline, i + 1, !m_keepQ);
+		m_sequenceEnd[i] = (int)m_lines.size();
+		current += timeAt(endline) - starttime;
+	}
+
+	m_footerStart = (int)m_lines.size();
+	m_shifts.push_back(current - timeAt(footer));
+	addLines(footer, lineCount, count + 1, !m_keepQ);
+	m_scoreDuration = current + infile.getScoreDuration() - timeAt(footer);
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::operator[] -- Return the line of the original
+//    file at the given position in the expanded order.
+//
+
+HumdrumLine& HumdrumExpansionView::operator[](int index) const {
+	return (*m_infile)[m_lines[index]];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getDurationFromStart -- Return the start time of
+//    the line in the expanded score.
+//
+
+HumNum HumdrumExpansionView::getDurationFromStart(int index) const {
+	return (*m_infile)[m_lines[index]].getDurationFromStart()
+			+ m_shifts[m_sections[index]];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getDuration -- Return the duration of the line,
+//    which is the same as in the original file.
+//
+
+HumNum HumdrumExpansionView::getDuration(int index) const {
+	return (*m_infile)[m_lines[index]].getDuration();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getSectionIndex -- Return the index in the label
+//    sequence for the given line in the view, or -1 if the line is in
+//    the header or footer.
+//
+
+int HumdrumExpansionView::getSectionIndex(int index) const {
+	if (!m_expandedQ) {
+		return -1;
+	}
+	int section = m_sections[index];
+	if ((section == 0) || (section == (int)m_shifts.size() - 1)) {
+		return -1;
+	}
+	return section - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::isFooter -- Return true if the line is in the
+//    footer of an expanded view (the data termination line and after).
+//
+
+bool HumdrumExpansionView::isFooter(int index) const {
+	if (!m_expandedQ) {
+		return false;
+	}
+	return m_sections[index] == (int)m_shifts.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::findLabelSequence -- Find the first
+//    *>variant[...] line in the file and store its label sequence.
+//    Returns the line index of the expansion list, or -1 if not found.
+//
+
+int HumdrumExpansionView::findLabelSequence(HumdrumFile& infile,
+		const string& variant) {
+	string labelsearch = "*>";
+	labelsearch += variant;
+	labelsearch += "[";
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		HTp token = infile.token(i, 0);
+		if (token->compare(0, labelsearch.size(), labelsearch) != 0) {
+			continue;
+		}
+		getLabelSequence(m_sequence, token->substr(labelsearch.size()));
+		return i;
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::addLines -- Add the lines from startline up to
+//    (but not including) endline to the view.  If filter is true,
+//    expansion-list lines are skipped.
+//
+
+void HumdrumExpansionView::addLines(int startline, int endline, int section,
+		bool filter) {
+	HumdrumFile& infile = *m_infile;
+	for (int i=startline; i<endline; i++) {
+		if (infile[i].isInterpretation()) {
+			HTp token = infile.token(i, 0);
+			if (*token == "*thru") {
+				continue;
+			}
+			if (filter && isExpansionList(token)) {
+				continue;
+			}
+		}
+		m_lines.push_back(i);
+		m_sections.push_back(section);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::isExpansionList -- Return true if the token
+//    is an expansion list such as *>[A,A,B] or *>norep[A,B].
+//
+
+bool HumdrumExpansionView::isExpansionList(HTp token) {
+	if (token->compare(0, 2, "*>") != 0) {
+		return false;
+	}
+	return token->find('[') != string::npos;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getLabelSequence -- Split an expansion list
+//    such as "A,A,B]" into its labels.
+//
+
+void HumdrumExpansionView::getLabelSequence(vector<string>& labelsequence,
+		const string& astring) {
+	const char* ignorecharacters = ", [] ";
+	size_t start = astring.find_first_not_of(ignorecharacters);
+	while (start != string::npos) {
+		size_t end = astring.find_first_of(ignorecharacters, start);
+		labelsequence.push_back(astring.substr(start, end - start));
+		start = astring.find_first_not_of(ignorecharacters, end);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFile::HumdrumFile -- HumdrumFile constructor.
@@ -19692,6 +24434,58 @@ HumdrumFile::~HumdrumFile() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFile::HumdrumFile -- Copy and move constructors.
+//
+
+HumdrumFile::HumdrumFile(HumdrumFile& infile) :
+		HUMDRUMFILE_PARENT(infile) {
+	// do nothing
+}
+
+
+HumdrumFile::HumdrumFile(HumdrumFile&& infile) noexcept :
+		HUMDRUMFILE_PARENT(std::move(infile)) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFile::operator= -- Copy and move assignment.
+//
+
+HumdrumFile& HumdrumFile::operator=(HumdrumFile& infile) {
+	HUMDRUMFILE_PARENT::operator=(infile);
+	return *this;
+}
+
+
+HumdrumFile& HumdrumFile::operator=(HumdrumFile&& infile) noexcept {
+	HUMDRUMFILE_PARENT::operator=(std::move(infile));
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFile::clone -- Return a duplicate of the file, including its
+//     analyzed structure, without reparsing the text of the file.  Use
+//     this to fork a parsed score so that several filters can be applied
+//     to independent copies of it.
+//
+
+HumdrumFile HumdrumFile::clone(void) const {
+	HumdrumFile output;
+	output.cloneFrom(*this);
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFile::printXml -- Print a HumdrumFile object in XML format.
@@ -19770,6 +24564,115 @@ ostream& HumdrumFile::printXml(ostream& out, int level,
 
 
 
+//////////////////////////////
+//
+// HumdrumFile::printJson -- Print the analyzed structure of a HumdrumFile
+//     object in JSON format.  The fields string is a comma-separated list
+//     of content to include: lines, tokens, links, strands, rhythm and
+//     parameters (all content if empty).  An empty indent string prints
+//     compact JSON.  Durations are [numerator, denominator] arrays, and
+//     IDs are the same as the XML IDs from printXml().
+// default value: out = cout
+// default value: fields = ""
+// default value: indent = tab character
+//
+
+ostream& HumdrumFile::printJson(ostream& out, const string& fields,
+		const string& indent) {
+	HumJsonWriter json(out, indent);
+	json.setIdPrefix(getXmlIdPrefix());
+	printJson(json, HumJsonWriter::parseFields(fields));
+	json.flush();
+	return out;
+}
+
+
+void HumdrumFile::printJson(HumJsonWriter& json, int fields) {
+	json.beginObject();
+
+	json.writeKey("lineCount");
+	json.writeInt(getLineCount());
+
+	if (fields & HumJsonWriter::FIELD_RHYTHM) {
+		json.writeKey("tpq");
+		json.writeInt(tpq());
+		json.writeKey("duration");
+		json.writeNumber(getScoreDuration());
+	}
+
+	// Spine terminators are not necessarily stored with their own
+	// track, so collect them by the track of the terminator token:
+	int maxtrack = getMaxTrack();
+	vector<vector<HTp>> trackends(maxtrack + 1);
+	HTp token;
+	for (int i=1; i<=maxtrack; i++) {
+		for (int j=0; j<getTrackEndCount(i); j++) {
+			token = getTrackEnd(i, j);
+			if ((token != NULL) && (token->getTrack() >= 1) &&
+					(token->getTrack() <= maxtrack)) {
+				trackends[token->getTrack()].push_back(token);
+			}
+		}
+	}
+
+	json.writeKey("tracks");
+	json.beginArray();
+	for (int i=1; i<=maxtrack; i++) {
+		json.beginObject();
+		json.writeKey("n");
+		json.writeInt(i);
+		token = getTrackStart(i);
+		if (token != NULL) {
+			json.writeKey("dataType");
+			json.writeString(token->getDataType());
+			json.writeKey("start");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+		}
+		json.writeKey("ends");
+		json.beginArray();
+		for (HTp end : trackends[i]) {
+			json.writeTokenId(end->getLineIndex(), end->getFieldIndex());
+		}
+		json.endArray();
+		json.endObject();
+	}
+	json.endArray();
+
+	if (fields & HumJsonWriter::FIELD_STRANDS) {
+		json.writeKey("strands");
+		json.beginArray();
+		int count = getStrandCount();
+		for (int i=0; i<count; i++) {
+			json.beginObject();
+			token = getStrandStart(i);
+			json.writeKey("start");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+			token = getStrandEnd(i);
+			json.writeKey("end");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+			json.endObject();
+		}
+		json.endArray();
+	}
+
+	if (fields & HumJsonWriter::FIELD_PARAMETERS) {
+		((HumHash*)this)->printJson(json);
+	}
+
+	if (fields & (HumJsonWriter::FIELD_LINES | HumJsonWriter::FIELD_TOKENS)) {
+		json.writeKey("lines");
+		json.beginArray();
+		for (int i=0; i<getLineCount(); i++) {
+			m_lines[i]->printJson(json, fields);
+		}
+		json.endArray();
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFile::printXmlParameterInfo -- Print contents of HumHash for HumdrumFile.
@@ -20287,6 +25190,24 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::HumdrumFileBase -- Move constructor.  The lines,
+//     tokens and analysis state of the input file are transferred without
+//     copying, and the input file is left empty.
+//
+
+HumdrumFileBase::HumdrumFileBase(HumdrumFileBase&& infile) noexcept :
+		HumHash() {
+	m_ticksperquarternote = -1;
+	m_quietParse = false;
+	m_segmentlevel = 0;
+	m_displayError = false;
+	moveFrom(infile);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::operator = -- HumdrumFileStructure::analyzeStructure()
@@ -20299,6 +25220,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 		return *this;
 	}
 
+	clear();
 	m_filename = infile.m_filename;
 	m_segmentlevel = infile.m_segmentlevel;
 	m_trackstarts.clear();
@@ -20326,6 +25248,259 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::operator = -- Move assignment.  The current contents
+//     are deleted and the contents of the input file are transferred.
+//
+
+HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase&& infile) noexcept {
+	if (this == &infile) {
+		return *this;
+	}
+	clear();
+	moveFrom(infile);
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::moveFrom -- Transfer the contents of another file into
+//     this one, which should be empty.  The other file is left empty.
+//
+
+void HumdrumFileBase::moveFrom(HumdrumFileBase& infile) noexcept {
+	HumHash::operator=(std::move(infile));
+
+	m_lines               = std::move(infile.m_lines);
+	m_filename            = std::move(infile.m_filename);
+	m_segmentlevel        = infile.m_segmentlevel;
+	m_trackstarts         = std::move(infile.m_trackstarts);
+	m_trackends           = std::move(infile.m_trackends);
+	m_trackindex          = std::move(infile.m_trackindex);
+	m_trackindexvalid     = infile.m_trackindexvalid;
+	m_barlines            = std::move(infile.m_barlines);
+	m_ticksperquarternote = infile.m_ticksperquarternote;
+	m_idprefix            = std::move(infile.m_idprefix);
+	m_strand1d            = std::move(infile.m_strand1d);
+	m_strand2d            = std::move(infile.m_strand2d);
+	m_strophes1d          = std::move(infile.m_strophes1d);
+	m_strophes2d          = std::move(infile.m_strophes2d);
+	m_quietParse          = infile.m_quietParse;
+	m_parseError          = std::move(infile.m_parseError);
+	m_displayError        = infile.m_displayError;
+	m_signifiers          = std::move(infile.m_signifiers);
+	m_analyses            = infile.m_analyses;
+
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setOwner(this);
+	}
+
+	// The lines now belong to this file, so only forget them here:
+	infile.m_lines.clear();
+	infile.m_parseError.clear();
+	infile.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::cloneFrom -- Replace the contents of this file with a
+//     duplicate of another file.  Unlike the copy constructor and
+//     assignment operator, the text is not parsed again: lines and tokens
+//     are copied along with their analysis data, and all token links
+//     (spine connections, strands, null resolutions, parameters, etc.)
+//     are redirected to the new tokens.
+//
+
+void HumdrumFileBase::cloneFrom(const HumdrumFileBase& infile) {
+	if (this == &infile) {
+		return;
+	}
+	clear();
+	HumHash::operator=(infile);
+
+	m_filename            = infile.m_filename;
+	m_segmentlevel        = infile.m_segmentlevel;
+	m_ticksperquarternote = infile.m_ticksperquarternote;
+	m_idprefix            = infile.m_idprefix;
+	m_quietParse          = infile.m_quietParse;
+	m_parseError          = infile.m_parseError;
+	m_displayError        = infile.m_displayError;
+	m_signifiers          = infile.m_signifiers;
+	m_analyses            = infile.m_analyses;
+
+	int tokencount = 0;
+	for (int i=0; i<(int)infile.m_lines.size(); i++) {
+		tokencount += (int)infile.m_lines[i]->m_tokens.size();
+	}
+	unordered_map<HTp, HTp> tokenmap;
+	tokenmap.reserve(tokencount);
+	unordered_map<HLp, HLp> linemap;
+	linemap.reserve(infile.m_lines.size());
+
+	// Duplicate the lines and tokens:
+	m_lines.resize(infile.m_lines.size());
+	for (int i=0; i<(int)infile.m_lines.size(); i++) {
+		HLp oldline = infile.m_lines[i];
+		HLp line = new HumdrumLine;
+		(string&)(*line)            = (const string&)(*oldline);
+		(HumHash&)(*line)           = (const HumHash&)(*oldline);
+		line->m_lineindex           = oldline->m_lineindex;
+		line->m_tabs                = oldline->m_tabs;
+		line->m_duration            = oldline->m_duration;
+		line->m_durationFromStart   = oldline->m_durationFromStart;
+		line->m_durationFromBarline = oldline->m_durationFromBarline;
+		line->m_durationToBarline   = oldline->m_durationToBarline;
+		line->m_linkedParameters    = oldline->m_linkedParameters;
+		line->m_rhythm_analyzed     = oldline->m_rhythm_analyzed;
+		line->m_owner               = this;
+		line->m_tokens.resize(oldline->m_tokens.size());
+		for (int j=0; j<(int)oldline->m_tokens.size(); j++) {
+			HTp oldtok = oldline->m_tokens[j];
+			HTp token = new HumdrumToken;
+			(string&)(*token)              = (const string&)(*oldtok);
+			(HumHash&)(*token)             = (const HumHash&)(*oldtok);
+			token->m_address               = oldtok->m_address;
+			token->setOwner(line);
+			token->m_duration              = oldtok->m_duration;
+			token->m_nextTokens            = oldtok->m_nextTokens;
+			token->m_previousTokens        = oldtok->m_previousTokens;
+			token->m_nextNonNullTokens     = oldtok->m_nextNonNullTokens;
+			token->m_previousNonNullTokens = oldtok->m_previousNonNullTokens;
+			token->m_rhycheck              = oldtok->m_rhycheck;
+			token->m_strand                = oldtok->m_strand;
+			token->m_nullresolve           = oldtok->m_nullresolve;
+			token->m_rhythm_analyzed       = oldtok->m_rhythm_analyzed;
+			if (oldtok->m_cold) {
+				HumdrumToken::ColdData& cold = token->getColdData();
+				cold.m_linkedParameterTokens = oldtok->m_cold->m_linkedParameterTokens;
+				cold.m_strophe               = oldtok->m_cold->m_strophe;
+			}
+			line->m_tokens[j] = token;
+			tokenmap[oldtok] = token;
+		}
+		m_lines[i] = line;
+		linemap[oldline] = line;
+	}
+
+	// Redirect token links to the new tokens:
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HLp line = m_lines[i];
+		line->remapTokens(tokenmap);
+		remapTokenList(line->m_linkedParameters, tokenmap);
+		for (int j=0; j<(int)line->m_tokens.size(); j++) {
+			HTp token = line->m_tokens[j];
+			HTp oldtok = infile.m_lines[i]->m_tokens[j];
+			token->HumHash::remapTokens(tokenmap);
+			remapTokenList(token->m_nextTokens, tokenmap);
+			remapTokenList(token->m_previousTokens, tokenmap);
+			remapTokenList(token->m_nextNonNullTokens, tokenmap);
+			remapTokenList(token->m_previousNonNullTokens, tokenmap);
+			token->m_nullresolve = remapToken(token->m_nullresolve, tokenmap);
+			if (token->m_cold) {
+				HumdrumToken::ColdData& cold = *token->m_cold;
+				remapTokenList(cold.m_linkedParameterTokens, tokenmap);
+				cold.m_strophe = remapToken(cold.m_strophe, tokenmap);
+				if (oldtok->m_cold->m_parameterSet) {
+					cold.m_parameterSet = new HumParamSet(token);
+				}
+			}
+		}
+	}
+
+	// Redirect file-level token and line lists:
+	HumHash::remapTokens(tokenmap);
+	m_trackstarts = infile.m_trackstarts;
+	remapTokenList(m_trackstarts, tokenmap);
+	m_trackends = infile.m_trackends;
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		remapTokenList(m_trackends[i], tokenmap);
+	}
+	m_barlines = infile.m_barlines;
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		auto found = linemap.find(m_barlines[i]);
+		if (found != linemap.end()) {
+			m_barlines[i] = found->second;
+		}
+	}
+	m_strand1d = infile.m_strand1d;
+	remapTokenPairs(m_strand1d, tokenmap);
+	m_strand2d = infile.m_strand2d;
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		remapTokenPairs(m_strand2d[i], tokenmap);
+	}
+	m_strophes1d = infile.m_strophes1d;
+	remapTokenPairs(m_strophes1d, tokenmap);
+	m_strophes2d = infile.m_strophes2d;
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		remapTokenPairs(m_strophes2d[i], tokenmap);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapToken -- Return the counterpart of a token in the
+//     given map, or the token itself if it is not in the map.
+//
+
+HTp HumdrumFileBase::remapToken(HTp token,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	if (token == NULL) {
+		return token;
+	}
+	auto found = tokenmap.find(token);
+	if (found == tokenmap.end()) {
+		return token;
+	}
+	return found->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapTokenList -- Apply remapToken to a list of tokens.
+//
+
+void HumdrumFileBase::remapTokenList(vector<HTp>& tokens,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<(int)tokens.size(); i++) {
+		tokens[i] = remapToken(tokens[i], tokenmap);
+	}
+}
+
+
+void HumdrumFileBase::remapTokenList(HumTokenLinks& tokens,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<tokens.size(); i++) {
+		tokens[i] = remapToken(tokens[i], tokenmap);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapTokenPairs -- Apply remapToken to both ends of
+//     a list of token pairs.
+//
+
+void HumdrumFileBase::remapTokenPairs(vector<TokenPair>& pairs,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<(int)pairs.size(); i++) {
+		pairs[i].first = remapToken(pairs[i].first, tokenmap);
+		pairs[i].last  = remapToken(pairs[i].last, tokenmap);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::~HumdrumFileBase -- HumdrumFileBase deconstructor.
@@ -20355,6 +25530,8 @@ void HumdrumFileBase::clear(void) {
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
 	m_trackends.clear();
+	m_trackindex.clear();
+	m_trackindexvalid = false;
 	m_barlines.clear();
 	m_ticksperquarternote = -1;
 	m_idprefix.clear();
@@ -21049,12 +26226,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 void HumdrumFileBase::appendLine(const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
+	m_trackindexvalid = false;
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
 	// deletion will be handled by class.
 	m_lines.push_back(line);
+	m_trackindexvalid = false;
 }
 
 
@@ -21068,6 +26247,7 @@ void HumdrumFileBase::appendLine(HLp line) {
 void HumdrumFileBase::insertLine(int index, const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.insert(m_lines.begin() + index, s);
+	m_trackindexvalid = false;
 
 	// Update the line indexes for this line and the following ones:
 	for (int i=index; i<(int)m_lines.size(); i++) {
@@ -21079,6 +26259,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 void HumdrumFileBase::insertLine(int index, HLp line) {
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
+	m_trackindexvalid = false;
 
 	// Update the line indexes for this line and the following ones:
 	for (int i=index; i<(int)m_lines.size(); i++) {
@@ -21108,6 +26289,7 @@ void HumdrumFileBase::deleteLine(int index) {
 		m_lines[i-1] = m_lines[i];
 	}
 	m_lines.resize(m_lines.size() - 1);
+	m_trackindexvalid = false;
 }
 
 
@@ -21334,19 +26516,10 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts) {
 
 void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 		const string& exinterp) {
-	string newexinterp;
-	if (exinterp.compare(0, 2, "**") == 0) {
-		newexinterp = exinterp;
-	} else {
-		newexinterp = "**";
-		newexinterp += exinterp;
-	}
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
-	for (int i=1; i<(int)m_trackstarts.size(); i++) {
-		if (newexinterp == *m_trackstarts[i]) {
-			spinestarts.push_back(m_trackstarts[i]);
-		}
+	for (HTp start : getSpineStartView(exinterp)) {
+		spinestarts.push_back(start);
 	}
 }
 
@@ -21374,6 +26547,34 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::getSpineStartView -- Return a view of the starting
+//     exclusive interpretations of the spines, optionally only those
+//     for the given data type ("**" is added to the data type if needed,
+//     so an empty data type gives no spines, as in getSpineStartList()).
+//     The view does not copy the list of spine starts.
+//
+
+HumSpineStartView HumdrumFileBase::getSpineStartView(void) {
+	if (m_trackstarts.size() < 2) {
+		return HumSpineStartView();
+	}
+	return HumSpineStartView(m_trackstarts.data() + 1,
+			m_trackstarts.data() + m_trackstarts.size());
+}
+
+
+HumSpineStartView HumdrumFileBase::getSpineStartView(const string& exinterp) {
+	if (m_trackstarts.size() < 2) {
+		return HumSpineStartView();
+	}
+	return HumSpineStartView(m_trackstarts.data() + 1,
+			m_trackstarts.data() + m_trackstarts.size(), exinterp);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::getKernSpineStartList -- return only the spines that are **kern.
@@ -21489,11 +26690,9 @@ void HumdrumFileBase::getSpineSequence(vector<vector<HTp> >& sequence,
 
 void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 		int options) {
-	vector<vector<HTp> > tempseq;
-	getTrackSequence(tempseq, track, options | OPT_PRIMARY);
-	sequence.resize(tempseq.size());
-	for (int i=0; i<(int)tempseq.size(); i++) {
-		sequence[i] = tempseq[i][0];
+	sequence.resize(0);
+	for (auto row : getPrimaryTrackView(track, options)) {
+		sequence.push_back(row.front());
 	}
 }
 
@@ -21504,7 +26703,8 @@ void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 // HumdrumFileBase::getTrackSequence -- Extract a sequence of tokens
 //    for the given spine.  All subspine tokens will be included.
 //    See getPrimaryTrackSequence() if you only want the first subspine for
-//    a track on all lines.
+//    a track on all lines, and getTrackView() to iterate over the tokens
+//    without copying them.
 //
 // The following options are used for the getPrimaryTrackTokens:
 // * OPT_PRIMARY    => only extract primary subspine/subtrack.
@@ -21521,6 +26721,9 @@ void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 //                        a list of tokens from lines which hasSpines() it true.
 // * OPT_NOREST     => don't include **kern rests.
 // * OPT_NOTIE      => don't include **kern secondary tied notes.
+// * OPT_NOBARLINE  => don't include barlines.
+// * OPT_NODATA     => don't include data tokens (other than barlines).
+// * OPT_NOTANDEM   => don't include any interpretation tokens.
 // Compound options:
 // * OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 //     Only data tokens (including barlines)
@@ -21537,90 +26740,105 @@ void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 
 void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 		int track, int options) {
-	bool primaryQ   = (options & OPT_PRIMARY) ? true : false;
-	bool nonullQ    = (options & OPT_NONULL) ? true : false;
-	bool noemptyQ   = (options & OPT_NOEMPTY) ? true : false;
-	bool nointerpQ  = (options & OPT_NOINTERP) ? true : false;
-	bool nomanipQ   = (options & OPT_NOMANIP) ? true : false;
-	bool nocommentQ = (options & OPT_NOCOMMENT) ? true : false;
-	bool noglobalQ  = (options & OPT_NOGLOBAL) ? true : false;
-	bool norestQ    = (options & OPT_NOREST) ? true : false;
-	bool notieQ     = (options & OPT_NOTIE) ? true : false;
-
-	vector<vector<HTp> >& output = sequence;
-	output.reserve(getLineCount());
-	output.resize(0);
-
-	vector<HTp> tempout;
-	auto& infile = *this;
-	int i, j;
-	bool allNull;
-	HTp token;
-	bool foundTrack;
+	sequence.reserve(getLineCount());
+	sequence.resize(0);
+	for (auto row : getTrackView(track, options)) {
+		sequence.emplace_back(row.begin(), row.end());
+	}
+}
 
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isEmpty()) {
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTrackView -- Return a view of the tokens in a track
+//     (indexed from 1 to getMaxTrack()), filtered by the same options as
+//     getTrackSequence().  The view reads the track index which is built
+//     when the track structure is analyzed, and it is rebuilt here if
+//     lines or tokens have been added or removed since then.  An empty
+//     view is returned for invalid tracks.
+//
+
+HumTrackView HumdrumFileBase::getTrackView(int track, int options) {
+	if (!m_trackindexvalid) {
+		buildTrackIndex();
+	}
+	if ((track < 1) || (track >= (int)m_trackindex.size())) {
+		return HumTrackView();
+	}
+	return HumTrackView(&m_trackindex[track], options);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::buildTrackIndex -- Store the tokens of each track in
+//     line order for use by HumTrackView.  Empty lines are skipped, and
+//     global lines are added to the index of every track.
+//
+
+void HumdrumFileBase::buildTrackIndex(void) {
+	int maxtrack = getMaxTrack();
+	m_trackindex.resize(maxtrack + 1);
+	for (int i=0; i<(int)m_trackindex.size(); i++) {
+		m_trackindex[i].clear();
+	}
+
+	int rowcount = 0;
+	int globalcount = 0;
+	vector<int> tokencount(maxtrack + 1, 0);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.isEmpty()) {
 			continue;
 		}
-		tempout.resize(0);
-		if (!noglobalQ && (infile[i].isGlobal())) {
-			tempout.push_back(infile[i].token(0));
-			output.push_back(tempout);
+		rowcount++;
+		if (line.isGlobal()) {
+			globalcount++;
 			continue;
 		}
-		if (noemptyQ) {
-			allNull = true;
-			for (j=0; j<infile[i].getFieldCount(); j++) {
-				if (infile[i].token(j)->getTrack() != track) {
-					continue;
-				}
-				if (!infile[i].token(j)->isNull()) {
-					allNull = false;
-					break;
-				}
-			}
-			if (allNull) {
-				continue;
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			int track = line.m_tokens[j]->getTrack();
+			if ((track > 0) && (track <= maxtrack)) {
+				tokencount[track]++;
 			}
 		}
+	}
+	for (int t=1; t<=maxtrack; t++) {
+		m_trackindex[t].m_tokens.reserve(tokencount[t] + globalcount);
+		m_trackindex[t].m_rows.reserve(rowcount + 1);
+		m_trackindex[t].m_global.reserve(rowcount);
+	}
 
-		foundTrack = false;
-		for (j=0; j<infile[i].getFieldCount(); j++) {
-			token = infile[i].token(j);
-			if (token->getTrack() != track) {
-				continue;
-			}
-			if (primaryQ && foundTrack) {
-				continue;
-			}
-			foundTrack = true;
-			if (nointerpQ && (infile[i].token(j)->isManipulator() ||
-					infile[i].token(j)->isTerminator() ||
-					infile[i].token(j)->isExclusive())) {
-				continue;
-			}
-			if (nomanipQ && infile[i].token(j)->isManipulator()) {
-				continue;
-			}
-			if (nonullQ && infile[i].token(j)->isNull()) {
-				continue;
-			}
-			if (nocommentQ && infile[i].token(j)->isComment()) {
-				continue;
-			}
-			if (norestQ && infile[i].token(j)->isRest()) {
-				continue;
-			}
-			if (notieQ && infile[i].token(j)->isSecondaryTiedNote()) {
-				continue;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.isEmpty()) {
+			continue;
+		}
+		bool globalQ = line.isGlobal();
+		for (int t=1; t<=maxtrack; t++) {
+			HumTrackIndex& index = m_trackindex[t];
+			index.m_rows.push_back((int)index.m_tokens.size());
+			index.m_global.push_back(globalQ);
+			if (globalQ && !line.m_tokens.empty()) {
+				index.m_tokens.push_back(line.m_tokens[0]);
 			}
-
-			tempout.push_back(infile[i].token(j));
 		}
-		if (tempout.size() > 0) {
-			output.push_back(tempout);
+		if (globalQ) {
+			continue;
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			int track = line.m_tokens[j]->getTrack();
+			if ((track > 0) && (track <= maxtrack)) {
+				m_trackindex[track].m_tokens.push_back(line.m_tokens[j]);
+			}
 		}
 	}
+	for (int t=1; t<=maxtrack; t++) {
+		m_trackindex[t].m_rows.push_back((int)m_trackindex[t].m_tokens.size());
+	}
+	m_trackindexvalid = true;
 }
 
 
@@ -21717,7 +26935,8 @@ bool HumdrumFileBase::analyzeLines(void) {
 //////////////////////////////
 //
 // HumdrumFileBase::analyzeTracks -- Analyze the track structure of the
-//     data.  Returns false if there was a parse error.
+//     data and build the track index used by HumTrackView.  Returns false
+//     if there was a parse error.
 //
 
 bool HumdrumFileBase::analyzeTracks(void) {
@@ -21727,6 +26946,7 @@ bool HumdrumFileBase::analyzeTracks(void) {
 			return false;
 		}
 	}
+	buildTrackIndex();
 	return isValid();
 }
 
@@ -21902,6 +27122,7 @@ bool HumdrumFileBase::stitchLinesTogether(HumdrumLine& previous,
 bool HumdrumFileBase::analyzeSpines(void) {
 	vector<string> datatype;
 	vector<string> sinfo;
+	vector<HTp> sinfotokens;  // previous token with the same spine info
 	vector<vector<HTp> > lastspine;
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
@@ -21927,11 +27148,13 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			datatype.resize(m_lines[i]->getTokenCount());
 			sinfo.resize(m_lines[i]->getTokenCount());
 			lastspine.resize(m_lines[i]->getTokenCount());
+			sinfotokens.resize(m_lines[i]->getTokenCount());
 			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
 				datatype[j] = m_lines[i]->getTokenString(j);
 				addToTrackStarts(m_lines[i]->token(j));
 				sinfo[j]    = to_string(j+1);
 				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+				sinfotokens[j] = m_lines[i]->token(j);
 				m_lines[i]->token(j)->setFieldIndex(j);
 				lastspine[j].push_back(m_lines[i]->token(j));
 			}
@@ -21949,13 +27172,21 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			return setParseError(err);
 		}
 		for (j=0; j<m_lines[i]->getTokenCount(); j++) {
-			m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			// The spine info only changes after manipulators, so
+			// share the string with the previous token in the spine:
+			if (sinfotokens[j]) {
+				m_lines[i]->token(j)->shareSpineInfo(sinfotokens[j]);
+			} else {
+				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			}
+			sinfotokens[j] = m_lines[i]->token(j);
 			m_lines[i]->token(j)->setFieldIndex(j);
 		}
 		if (!m_lines[i]->isManipulator()) {
 			continue;
 		}
 		if (!adjustSpines(*m_lines[i], datatype, sinfo)) { return isValid(); }
+		sinfotokens.assign(sinfo.size(), NULL);
 	}
 	return isValid();
 }
@@ -22374,14 +27605,14 @@ bool HumdrumFileBase::processNonNullDataTokensForTrackForward(HTp starttoken,
 //    variable in HumdrumTokens)
 //
 
-void HumdrumFileBase::addUniqueTokens(vector<HTp>& target,
+void HumdrumFileBase::addUniqueTokens(HumTokenLinks& target,
 		vector<HTp>& source) {
 	int i, j;
 	bool found;
 	for (i=0; i<(int)source.size(); i++) {
 		found = false;
-		for (j=0; j<(int)target.size(); j++) {
-			if (source[i] == target[i]) {
+		for (j=0; j<target.size(); j++) {
+			if (source[i] == target[j]) {
 				found = true;
 			}
 		}
@@ -23072,6 +28303,334 @@ void HumdrumFileBase::clearTokenLinkInfo(void) {
 
 
 
+//////////////////////////////
+//
+// HumTrackView::isAccepted -- Return true if the token is not removed
+//     by the OPT_* filters in the options (OPT_PRIMARY, OPT_NOEMPTY and
+//     OPT_NOGLOBAL apply to whole rows and are ignored here).
+//
+
+bool HumTrackView::isAccepted(HTp token, int options) {
+	if ((options & OPT_NOINTERP) && (token->isManipulator() ||
+			token->isTerminator() || token->isExclusive())) {
+		return false;
+	}
+	if ((options & OPT_NOMANIP) && token->isManipulator()) {
+		return false;
+	}
+	if ((options & OPT_NONULL) && token->isNull()) {
+		return false;
+	}
+	if ((options & OPT_NOCOMMENT) && token->isComment()) {
+		return false;
+	}
+	if ((options & OPT_NOREST) && token->isRest()) {
+		return false;
+	}
+	if ((options & OPT_NOTIE) && token->isSecondaryTiedNote()) {
+		return false;
+	}
+	if ((options & OPT_NOBARLINE) && token->isBarline()) {
+		return false;
+	}
+	if ((options & OPT_NODATA) && token->isData()) {
+		return false;
+	}
+	if ((options & OPT_NOTANDEM) && token->isInterpretation()) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::getRowCount -- Return the number of rows in the track
+//     index, before filtering.
+//
+
+int HumTrackView::getRowCount(const HumTrackIndex* index) {
+	if ((index == NULL) || index->m_rows.empty()) {
+		return 0;
+	}
+	return (int)index->m_rows.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::makeRow -- Set the output to the given row of the track
+//     index.  Returns false if the row is filtered out by the options or
+//     if none of its tokens pass the filters.  Global rows are only
+//     filtered by OPT_NOGLOBAL.
+//
+
+bool HumTrackView::makeRow(const HumTrackIndex* index, int options, int row,
+		Row& output) {
+	const HTp* first = index->m_tokens.data() + index->m_rows[row];
+	const HTp* last  = index->m_tokens.data() + index->m_rows[row+1];
+	if (first == last) {
+		return false;
+	}
+	if (index->m_global[row]) {
+		if (options & OPT_NOGLOBAL) {
+			return false;
+		}
+		output = Row(first, last, 0);
+		return true;
+	}
+	if (options & OPT_NOEMPTY) {
+		const HTp* ptr = first;
+		while ((ptr < last) && (*ptr)->isNull()) {
+			ptr++;
+		}
+		if (ptr == last) {
+			return false;
+		}
+	}
+	if (options & OPT_PRIMARY) {
+		last = first + 1;
+	}
+	output = Row(first, last, options);
+	return !output.empty();
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::size -- Return the number of rows in the view.
+//
+
+int HumTrackView::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::iterator -- Iterate over the rows of a view which are
+//     not empty after filtering.
+//
+
+HumTrackView::iterator::iterator(const HumTrackIndex* index, int options, int row)
+		: m_index(index), m_options(options), m_row(row) {
+	skip();
+}
+
+
+HumTrackView::iterator& HumTrackView::iterator::operator++(void) {
+	m_row++;
+	skip();
+	return *this;
+}
+
+
+void HumTrackView::iterator::skip(void) {
+	int count = HumTrackView::getRowCount(m_index);
+	while ((m_row < count) && !HumTrackView::makeRow(m_index, m_options, m_row, m_current)) {
+		m_row++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::token_iterator -- Iterate over the tokens of all rows in
+//     a view.
+//
+
+HumTrackView::token_iterator::token_iterator(iterator row, iterator last)
+		: m_row(row), m_last(last) {
+	if (m_row != m_last) {
+		m_token = m_row->begin();
+	}
+}
+
+
+HumTrackView::token_iterator& HumTrackView::token_iterator::operator++(void) {
+	++m_token;
+	if (m_token == m_row->end()) {
+		++m_row;
+		m_token = (m_row != m_last) ? m_row->begin() : Row::iterator();
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::Row -- The row starts at the first token which
+//     passes the filters.
+//
+
+HumTrackView::Row::Row(const HTp* first, const HTp* last, int options)
+		: m_first(first), m_last(last), m_options(options) {
+	while ((m_first < m_last) && !HumTrackView::isAccepted(*m_first, m_options)) {
+		m_first++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::size -- Return the number of tokens in the row
+//     which pass the filters.
+//
+
+int HumTrackView::Row::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::operator[] -- Return the given token in the row
+//     (counting only tokens which pass the filters), or NULL if the index
+//     is out of range.
+//
+
+HTp HumTrackView::Row::operator[](int index) const {
+	if (index < 0) {
+		return NULL;
+	}
+	for (iterator it = begin(); it != end(); ++it) {
+		if (index-- == 0) {
+			return *it;
+		}
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::getLineIndex -- Return the line index of the row.
+//
+
+int HumTrackView::Row::getLineIndex(void) const {
+	if (m_first == m_last) {
+		return -1;
+	}
+	return (*m_first)->getLineIndex();
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::iterator -- Iterate over the tokens of a row which
+//     pass the filters.  The starting token has already been checked
+//     by the Row constructor.
+//
+
+HumTrackView::Row::iterator::iterator(const HTp* current, const HTp* last,
+		int options) : m_current(current), m_last(last), m_options(options) {
+	// do nothing
+}
+
+
+HumTrackView::Row::iterator& HumTrackView::Row::iterator::operator++(void) {
+	m_current++;
+	skip();
+	return *this;
+}
+
+
+void HumTrackView::Row::iterator::skip(void) {
+	while ((m_current < m_last) && !HumTrackView::isAccepted(*m_current, m_options)) {
+		m_current++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::HumSpineStartView -- The exclusive interpretation
+//     is optional; "**" is added to it if needed.
+//
+
+HumSpineStartView::HumSpineStartView(const HTp* first, const HTp* last)
+		: m_first(first), m_last(last) {
+	// all spines
+}
+
+
+HumSpineStartView::HumSpineStartView(const HTp* first, const HTp* last,
+		const string& exinterp) : m_first(first), m_last(last) {
+	if (exinterp.compare(0, 2, "**") == 0) {
+		m_exinterp = exinterp;
+	} else {
+		m_exinterp = "**";
+		m_exinterp += exinterp;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::size -- Return the number of spines in the view.
+//
+
+int HumSpineStartView::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::iterator -- Iterate over the spine starts which
+//     match the exclusive interpretation of the view.
+//
+
+HumSpineStartView::iterator::iterator(const HTp* current, const HTp* last,
+		const string& exinterp) : m_current(current), m_last(last),
+		m_exinterp(exinterp) {
+	skip();
+}
+
+
+HumSpineStartView::iterator& HumSpineStartView::iterator::operator++(void) {
+	m_current++;
+	skip();
+	return *this;
+}
+
+
+void HumSpineStartView::iterator::skip(void) {
+	if (m_exinterp.empty()) {
+		return;
+	}
+	while ((m_current < m_last) && (**m_current != m_exinterp)) {
+		m_current++;
+	}
+}
+
+
+
 
 
 //////////////////////////////
@@ -23177,6 +28736,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 
 	int lasttrack = -1;
 	vector<int> concurrentstate(70, 0);
+	HumKernToken info;  // lexed **kern data of the current token
 
 	for (i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].hasSpines()) {
@@ -23234,7 +28794,8 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 				continue;
 			}
 
-			int subcount = token->getSubtokenCount();
+			info.lex(*token);
+			int subcount = info.getNoteCount();
 			track = token->getTrack();
 
 			if (lasttrack != track) {
@@ -23242,41 +28803,27 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 			}
 			lasttrack = track;
 			int rindex = rtracks[track];
+			int octaveadjust = token->getValueInt("auto", "ottava");
+			int graceQ = token->isGrace();
 			for (k=0; k<subcount; k++) {
 				// bool tienote = false;
-				string subtok = token->getSubtoken(k);
-				if (subcount > 1) {
-					// Rests in chords represent unsounding notes.
-					// Rests can have pitch, but this is treated as
-					// Diatonic pitch which does not involve accidentals,
-					// so convert to pitch-like so that accidentals are
-					// processed on these notes.
-					for (int m=0; m<(int)subtok.size(); m++) {
-						if (subtok[m] == 'r') {
-							subtok[m] = 'R';
-						}
-					}
-				}
-				int b40 = Convert::kernToBase40(subtok);
-				int diatonic = Convert::kernToBase7(subtok);
-				int octaveadjust = token->getValueInt("auto", "ottava");
+				// Rests in chords represent unsounding notes.  Rests can
+				// have pitch, but this is treated as Diatonic pitch which
+				// does not involve accidentals, so the lexed note pitch
+				// (which ignores 'r') is used so that accidentals are
+				// processed on these notes.
+				const HumKernNote& note = info.getNote(k);
+				int b40 = note.getBase40();
+				int diatonic = note.getBase7();
 				diatonic -= octaveadjust * 7;
 				if (diatonic < 0) {
 					// Deal with extra-low notes later.
 					continue;
 				}
-				int graceQ = token->isGrace();
-				int accid = Convert::kernToAccidentalCount(subtok);
-				int hiddenQ = 0;
-				if (subtok.find("yy") == string::npos) {
-					if ((subtok.find("ny") != string::npos) ||
-					    (subtok.find("#y") != string::npos) ||
-					    (subtok.find("-y") != string::npos)) {
-						hiddenQ = 1;
-					}
-				}
+				int accid = note.getAccidentalCount();
+				int hiddenQ = note.isAccidentalHidden() ? 1 : 0;
 
-				if (((subtok.find("_") != string::npos) || (subtok.find("]") != string::npos))) {
+				if (note.isTieContinue() || note.isTieEnd()) {
 					// tienote = true;
 					// tied notes do not have accidentals, so skip them
 					if ((accid != keysigs[rindex][diatonic % 7]) && firstinbar[rindex]) {
@@ -23286,10 +28833,12 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						dstates[rindex][diatonic] = -1000 + accid;
 						gdstates[rindex][diatonic] = -1000 + accid;
 					}
-					auto loc = subtok.find('X');
-					if (loc == string::npos) {
+					if (!note.contains(*token, "X")) {
 						continue;
-					} else if (loc == 0) {
+					}
+					string subtok = note.getText(*token);
+					auto loc = subtok.find('X');
+					if (loc == 0) {
 						continue;
 					} else {
 						if (!((subtok[loc-1] == '#') || (subtok[loc-1] == '-') ||
@@ -23302,8 +28851,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 				}
 
 				size_t loc;
+				string subtok;
 				// check for accidentals on trills, mordents and turns.
-				if (subtok.find("t") != string::npos) {
+				if (note.hasOrnament(HumKernNote::ORN_TRILL_MINOR)) {
 					// minor second trill
 					int trillnote     = b40 + 5;
 					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
@@ -23313,7 +28863,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"trillAccidental", to_string(trillaccid));
 						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
 					}
-				} else if (subtok.find("T") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_TRILL_MAJOR)) {
 					// major second trill
 					int trillnote     = b40 + 6;
 					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
@@ -23322,7 +28872,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "trillAccidental", to_string(trillaccid));
 						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
 					}
-				} else if (subtok.find("M") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_MORDENT_MAJOR)) {
 					// major second upper mordent
 					int auxnote     = b40 + 6;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -23331,7 +28881,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "mordentUpperAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("m") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_MORDENT_MINOR)) {
 					// minor second upper mordent
 					int auxnote     = b40 + 5;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -23340,7 +28890,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "mordentUpperAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("W") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_LOWER_MAJOR)) {
 					// major second upper mordent
 					int auxnote     = b40 - 6;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -23350,7 +28900,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"mordentLowerAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("w") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_LOWER_MINOR)) {
 					// minor second upper mordent
 					int auxnote     = b40 - 5;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -23361,7 +28911,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
 
-				} else if ((loc = subtok.find("$")) != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_INVERTED_TURN)) {
+					subtok = note.getText(*token);
+					loc = subtok.find("$");
 					int turndiatonic = Convert::base40ToDiatonic(b40);
 					// int turnaccid = Convert::base40ToAccidental(b40);
 					// inverted turn
@@ -23415,7 +28967,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"turnLowerAccidental", to_string(bacc));
 						dstates[rindex][lowerdiatonic] = -1000 + bacc;
 					}
-				} else if ((loc = subtok.find("S")) != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_TURN)) {
+					subtok = note.getText(*token);
+					loc = subtok.find("S");
 					int turndiatonic = Convert::base40ToDiatonic(b40);
 					// int turnaccid = Convert::base40ToAccidental(b40);
 					// regular turn
@@ -23509,13 +29063,14 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 					dstates[rindex][diatonic] = accid;
 					gdstates[rindex][diatonic] = accid;
 
-				} else if ((accid == 0) && (subtok.find("n") != string::npos) && !hiddenQ) {
+				} else if ((accid == 0) && note.hasExplicitNatural() && !hiddenQ) {
 					token->setValue("auto", to_string(k), "cautionaryAccidental", "true");
 					token->setValue("auto", to_string(k), "visualAccidental", "true");
-				} else if (subtok.find("XX") == string::npos) {
+				} else if (note.contains(*token, "X") && !note.contains(*token, "XX")) {
 					// The accidental is not necessary. See if there is a single "X"
 					// immediately after the accidental which means to force it to
 					// display.
+					subtok = note.getText(*token);
 					auto loc = subtok.find("X");
 					if ((loc != string::npos) && (loc > 0)) {
 						if (subtok[loc-1] == '#') {
@@ -23918,11 +29473,9 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 	string ignorebegin = linksig + "L";
 	string ignoreend = linksig + "J";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// beamopens == list of beam openings for each track and elision level
 	// first dimension: elision level
@@ -23937,18 +29490,20 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), 'L');
-			closecount = (int)count(token->begin(), token->end(), 'J');
+			info.lex(*token);
+			opencount = info.getBeamStartCount();
+			closecount = info.getBeamEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedBeamEnd(token, i, ignoreend);
@@ -23956,7 +29511,7 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getBeamEndElisionLevel(i);
+				elision = info.getBeamEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -24019,7 +29574,7 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getBeamStartElisionLevel(i);
+				elision = info.getBeamStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -24372,7 +29927,7 @@ vector<int> HumdrumFileContent::getTrackToKernIndex(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::getMetricLevels -- Each line in the output
+// HumdrumFileContent::getMetricLevels -- Each line in the output
 //     vector matches to the line of the metric analysis data.
 //     undefined is the value to represent undefined analysis data
 //     (for non-data spines).
@@ -24386,76 +29941,211 @@ vector<int> HumdrumFileContent::getTrackToKernIndex(void) {
 
 void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		int track, double undefined) {
-
-	HumdrumFileStructure& infile = *this;
+	HumdrumFileContent& infile = *this;
 	int lineCount = infile.getLineCount();
 	output.resize(lineCount);
 	fill(output.begin(), output.end(), undefined);
-	vector<HTp> kernspines = infile.getKernSpineStartList();
-	if ((track == 0) && (kernspines.size() > 0)) {
-		track = kernspines[0]->getTrack();
+	if (lineCount == 0) {
+		return;
 	}
-	if (track == 0) {
-		track = 1;
+	track = getMetricTrack(track);
+	analyzeMetricIndex(track);
+	vector<HumMetricInfo>& index = m_metricIndex[track];
+	for (int i=0; i<lineCount; i++) {
+		if (infile[i].isData()) {
+			output[i] = index[i].m_level;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricInfo -- Return the prevailing meter, the
+//     position from the barline in ticks, the measure ordinal and the
+//     metric level for a line in the given track (see getMetricLevels()
+//     for the meaning of track 0).  The metric index for the track is
+//     built the first time that it is needed.
+//
+
+const HumMetricInfo& HumdrumFileContent::getMetricInfo(int line, int track) {
+	track = getMetricTrack(track);
+	analyzeMetricIndex(track);
+	return m_metricIndex[track].at(line);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricLevel -- Return the metric level of a line
+//     (see getMetricLevels()).  Non-data lines return NAN.
+//
+
+double HumdrumFileContent::getMetricLevel(int line, int track) {
+	return getMetricInfo(line, track).m_level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricTpq -- Return the ticks per quarter note
+//     used for the positions in the metric index.
+//
+
+int HumdrumFileContent::getMetricTpq(void) {
+	if (!m_analyses.m_metric_analyzed) {
+		analyzeMetricIndex(getMetricTrack(0));
 	}
+	return m_metricTpq;
+}
+
+
 
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricTrack -- Convert track 0 into the track of
+//     the first **kern spine (or track 1 if there are no **kern spines).
+//
+
+int HumdrumFileContent::getMetricTrack(int track) {
+	if (track > 0) {
+		return track;
+	}
+	vector<HTp> kernspines = getKernSpineStartList();
+	if (kernspines.size() > 0) {
+		return kernspines[0]->getTrack();
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeMetricIndex -- Fill in the metric index for
+//     the given track if it has not already been done.  Time signatures
+//     are read from the given track, and metric levels are calculated
+//     from integer tick positions in the measure:
+//     Beat levels are log2 based, with 0 being the beat.  In compound
+//     meters (such as 6/8), the first level is log3 based, and then log2
+//     for the smaller levels.
+//
+
+void HumdrumFileContent::analyzeMetricIndex(int track) {
+	if (!m_analyses.m_metric_analyzed) {
+		m_metricIndex.clear();
+		m_metricTpq = tpq();
+		m_analyses.m_metric_analyzed = true;
+	}
+	if (track >= (int)m_metricIndex.size()) {
+		m_metricIndex.resize(track + 1);
+	}
+	vector<HumMetricInfo>& index = m_metricIndex[track];
+	HumdrumFileContent& infile = *this;
+	int lineCount = infile.getLineCount();
+	if ((int)index.size() == lineCount) {
+		return;
+	}
+	index.resize(lineCount);
+
+	long long tpq = m_metricTpq;
 	int top = 1;                // top number of time signature (0 for no meter)
 	int bot = 4;                // bottom number of time signature
 	bool compoundQ = false;     // test for compound meters, such as 6/8
-	HumNum beatdur(1 * 4, bot); // duration of a beat in the measure
-	HumNum measurepos;          // quarter notes from the start of barline
-	HumNum combeatdur;          // for adjusting beat level in compound meters
-	HumNum commeasurepos;       // for adjusting beat level in compound meters
+	int measure = 0;
 
 	for (int i=0; i<lineCount; i++) {
-		if (infile[i].isInterpretation()) {
+		HumdrumLine& line = infile[i];
+		if (line.isInterpretation()) {
 			// check for time signature:
-			HumdrumLine& line = *infile.getLine(i);
 			for (int j=0; j<line.getFieldCount(); j++) {
-				int ttrack = line.token(j)->getTrack();
-				if (ttrack != track) {
+				HTp token = line.token(j);
+				if (token->getTrack() != track) {
 					continue;
 				}
-				if (sscanf(infile.token(i,j)->c_str(), "*M%d/%d", &top, &bot)) {
-					beatdur.setValue(1*4, bot); // converted to quarter-note units
-					if ((top % 3 == 0) && (top != 3)) {
-						// if meter top is a multiple of 3 but not 3, then compound
-						// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
-						compoundQ = true;
-						beatdur *= 3;
-					} else {
-						compoundQ = false;
-					}
+				if (getMeter(token, top, bot)) {
+					// if meter top is a multiple of 3 but not 3, then compound
+					// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
+					compoundQ = (top % 3 == 0) && (top != 3);
 					break;
 				}
 			}
+		} else if (line.isBarline()) {
+			measure++;
 		}
-		if (!infile[i].isData()) {
-				continue;
+
+		HumMetricInfo& info = index[i];
+		info.m_top     = top;
+		info.m_bottom  = bot;
+		info.m_measure = measure;
+		info.m_level   = NAN;
+		HumNum position = line.getDurationFromBarline() * (int)tpq;
+		info.m_tick = position.getNumerator() / position.getDenominator();
+		if (!line.isData()) {
+			continue;
 		}
 
-		measurepos = infile[i].getDurationFromBarline();
+		// Position in beats is tick * bot / (tpq * 4 [* 3 if compound]).
 		// Might want to handle cases where the time signature changes in
 		// the middle or a measure...
-		measurepos /= beatdur;
-		int denominator = measurepos.getDenominator();
+		long long tick = info.m_tick;
+		long long beatticks = tpq * 4 * (compoundQ ? 3 : 1);
+		long long denominator = beatticks / std::gcd(tick * bot, beatticks);
 		if (compoundQ) {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
-			if ((output[i] != 0.0) && (output[i] != 1.0)) {
+			info.m_level = Convert::nearIntQuantize(log(denominator) / log(3.0));
+			if ((info.m_level != 0.0) && (info.m_level != 1.0)) {
 				// if not the beat or first level, then calculate
 				// levels above level 1.  In 6/8 this means
 				// to move the 8th note level to be the "beat"
 				// and then use binary levels for rhythmic levels
 				// smaller than a beat.
-				combeatdur.setValue(4,bot);
-				commeasurepos = infile[i].getDurationFromBarline() / combeatdur;
-				denominator = commeasurepos.getDenominator();
-				output[i] = 1.0 + log(denominator)/log(2.0);
+				denominator = (tpq * 4) / std::gcd(tick * bot, tpq * 4);
+				info.m_level = 1.0 + log(denominator)/log(2.0);
 			}
 		} else {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
+			info.m_level = Convert::nearIntQuantize(log(denominator) / log(2.0));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMeter -- Read the top and bottom numbers of a
+//     time signature interpretation, such as "*M6/8".  The bottom is
+//     not changed if the time signature only has a top number.  Returns
+//     false if the token is not a time signature.
+//
+
+bool HumdrumFileContent::getMeter(HTp token, int& top, int& bot) {
+	const string& text = *token;
+	if ((text.size() < 3) || (text[0] != '*') || (text[1] != 'M')) {
+		return false;
+	}
+	if (!isdigit(text[2]) && (text[2] != '-') && (text[2] != '+')) {
+		return false;
+	}
+	int value = atoi(text.c_str() + 2);
+	top = value;
+	size_t slash = text.find('/', 3);
+	if (slash == string::npos) {
+		return true;
+	}
+	bool digits = true;
+	for (size_t k=3; k<slash; k++) {
+		if (!isdigit(text[k])) {
+			digits = false;
+			break;
 		}
 	}
+	if (digits && (slash + 1 < text.size()) && isdigit(text[slash+1])) {
+		bot = atoi(text.c_str() + slash + 1);
+	}
+	return true;
 }
 
 
@@ -24516,22 +30206,21 @@ void HumdrumFileContent::processStrandNotesForMidi(HTp sstart, HTp send, vector<
 			current = current->getNextToken();
 			continue;
 		}
-		vector<string> subtokens = current->getSubtokens();
-		for (int i=0; i<(int)subtokens.size(); i++) {
-			if (subtokens[i] == ".") {
+		for (const HumSubtoken& subtoken : current->getSubtokenView()) {
+			if (subtoken == ".") {
 				// something strange happened (no null tokens expected)
 				continue;
 			}
-			if (subtokens[i].find("r") != string::npos) {
+			if (subtoken.contains('r')) {
 				// rest, so store in MIDI[0]
 				trackInfo.at(0).emplace_back(current, 0);
-			} else if (subtokens[i].find("R") != string::npos) {
+			} else if (subtoken.contains('R')) {
 				// unpitched or quasi-pitched note, so store in MIDI[0]
 				trackInfo.at(0).emplace_back(current, 0);
 			} else {
-				int keyno = Convert::kernToMidiNoteNumber(subtokens[i]);
+				int keyno = subtoken.getMidiNoteNumber();
 				if ((keyno >= 0) && (keyno < 128)) {
-					trackInfo.at(keyno).emplace_back(current, i);
+					trackInfo.at(keyno).emplace_back(current, subtoken.getIndex());
 				}
 			}
 		}
@@ -24637,13 +30326,8 @@ void HumdrumFileContent::checkDataForCrossStaffStems(HTp token, string& above, s
 		return;
 	}
 
-	if (token->find('/') != std::string::npos) {
-		// has a stem-up marker, so do not try to adjust stems;
-		return;
-	}
-
-	if (token->find('\\') != std::string::npos) {
-		// has a stem-down marker, so do not try to adjust stems;
+	if (token->hasStemDirection()) {
+		// has a stem-up or stem-down marker, so do not try to adjust stems;
 		return;
 	}
 
@@ -24744,7 +30428,7 @@ void HumdrumFileContent::prepareStaffAboveNoteStems(HTp token) {
 			curr2 = curr2->getNextToken();
 			continue;
 		}
-		if ((curr2->find('/') != std::string::npos) || (curr2->find('\\') != std::string::npos)) {
+		if (curr2->hasStemDirection()) {
 			// the note/chord has a stem direction, so ignore it
 			curr2 = curr2->getNextToken();
 			continue;
@@ -24839,7 +30523,7 @@ void HumdrumFileContent::prepareStaffBelowNoteStems(HTp token) {
 			curr2 = curr2->getNextToken();
 			continue;
 		}
-		if ((curr2->find('/') != std::string::npos) || (curr2->find('\\') != std::string::npos)) {
+		if (curr2->hasStemDirection()) {
 			// the note/chord has a stem direction, so ignore it
 			curr2 = curr2->getNextToken();
 			continue;
@@ -24869,6 +30553,7 @@ int HumdrumFileContent::getNoteCount(void) {
 	HumdrumFileContent& infile = *this;
 	int counter = 0;
 
+	HumKernToken info;  // lexed **kern data of the current token
 	int scount = infile.getStrandCount();
 	for (int i=0; i<scount; i++) {
 		HTp sstart = infile.getStrandStart(i);
@@ -24890,21 +30575,19 @@ int HumdrumFileContent::getNoteCount(void) {
 				current = current->getNextToken();
 				continue;
 			}
-			int subcount = current->getSubtokenCount();
+			info.lex(*current);
+			int subcount = info.getNoteCount();
 			if (subcount == 1) {
 				if (!current->isSecondaryTiedNote()) {
 					counter++;
 				}
 			} else {
-				vector<string> subtokens = current->getSubtokens();
-				for (int i=0; i<(int)subtokens.size(); i++) {
-					if (subtokens[i].find("_") != string::npos) {
-						continue;
-					}
-					if (subtokens[i].find("]") != string::npos) {
+				for (int i=0; i<subcount; i++) {
+					const HumKernNote& note = info.getNote(i);
+					if (note.isTieContinue() || note.isTieEnd()) {
 						continue;
 					}
-					if (subtokens[i].find("r") != string::npos) {
+					if (note.isRest()) {
 						continue;
 					}
 					counter++;
@@ -25094,11 +30777,9 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 	string ignorebegin = linksig + "{";
 	string ignoreend = linksig + "}";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// phraseopens == list of phrase openings for each track and elision level
 	// first dimension: elision level
@@ -25113,18 +30794,20 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), '{');
-			closecount = (int)count(token->begin(), token->end(), '}');
+			info.lex(*token);
+			opencount = info.getPhraseStartCount();
+			closecount = info.getPhraseEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedPhraseEnd(token, i, ignoreend);
@@ -25132,7 +30815,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getPhraseEndElisionLevel(i);
+				elision = info.getPhraseEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -25195,7 +30878,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getPhraseStartElisionLevel(i);
+				elision = info.getPhraseStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -25631,9 +31314,8 @@ void HumdrumFileContent::assignVerticalRestPosition(HTp first, HTp second, int b
 		return;
 	}
 
-	int count = notes->getSubtokenCount();
-	for (int i=0; i<count; i++) {
-		vpos.push_back(Convert::kernToBase7(notes->getSubtoken(i)) - baseline);
+	for (const HumSubtoken& subtoken : notes->getSubtokenView()) {
+		vpos.push_back(subtoken.getBase7() - baseline);
 	}
 
 	int rpos = 0;
@@ -26231,11 +31913,9 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 	string ignorebegin = linksig + "(";
 	string ignoreend = linksig + ")";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// sluropens == list of slur openings for each track and elision level
 	// first dimension: elision level
@@ -26250,18 +31930,20 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), '(');
-			closecount = (int)count(token->begin(), token->end(), ')');
+			info.lex(*token);
+			opencount = info.getSlurStartCount();
+			closecount = info.getSlurEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedSlurEnd(token, i, ignoreend);
@@ -26269,7 +31951,7 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getSlurEndElisionLevel(i);
+				elision = info.getSlurEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -26332,7 +32014,7 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getSlurStartElisionLevel(i);
+				elision = info.getSlurStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -26762,6 +32444,7 @@ bool HumdrumFileContent::analyzeKernTies(
 		startdatabase[i].second = -1;
 	}
 
+	HumKernToken info;  // lexed **kern data of the current token
 	HumdrumFileContent& infile = *this;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
@@ -26781,22 +32464,25 @@ bool HumdrumFileContent::analyzeKernTies(
 			if (tok->isRest()) {
 				continue;
 			}
-			int scount = tok->getSubtokenCount();
+			info.lex(*tok);
+			int scount = info.getNoteCount();
 			int b40;
 			for (int k=0; k<scount; k++) {
 				int index = k;
 				if (scount == 1) {
 					index = -1;
 				}
-				std::string tstring = tok->getSubtoken(k);
-				if (tstring.find(lstart) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				const HumKernNote& note = info.getNote(k);
+				if (!(note.isTieStart() || note.isTieContinue() || note.isTieEnd())) {
+					continue;
+				}
+				b40 = note.getBase40();
+				if (note.isTieStart() && note.contains(*tok, lstart)) {
 					startdatabase[b40].first  = tok;
 					startdatabase[b40].second = index;
 					// linkedtiestarts.push_back(std::make_pair(tok, index));
 				}
-				if (tstring.find(lend) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				if (note.isTieEnd() && note.contains(*tok, lend)) {
 					if (startdatabase.at(b40).first) {
 						linkedtiestarts.push_back(startdatabase[b40]);
 						linkedtieends.push_back(std::make_pair(tok, index));
@@ -26804,8 +32490,7 @@ bool HumdrumFileContent::analyzeKernTies(
 						startdatabase[b40].second = -1;
 					}
 				}
-				if (tstring.find(lmiddle) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				if (note.isTieContinue() && note.contains(*tok, lmiddle)) {
 					if (startdatabase[b40].first) {
 						linkedtiestarts.push_back(startdatabase[b40]);
 						linkedtieends.push_back(std::make_pair(tok, index));
@@ -27028,6 +32713,54 @@ HumdrumFileContent::~HumdrumFileContent() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::HumdrumFileContent -- Copy and move constructors.
+//
+
+HumdrumFileContent::HumdrumFileContent(HumdrumFileContent& infile) :
+		HumdrumFileStructure(infile) {
+	m_metricIndex = infile.m_metricIndex;
+	m_metricTpq   = infile.m_metricTpq;
+}
+
+
+HumdrumFileContent::HumdrumFileContent(HumdrumFileContent&& infile) noexcept :
+		HumdrumFileStructure(std::move(infile)) {
+	m_metricIndex = std::move(infile.m_metricIndex);
+	m_metricTpq   = infile.m_metricTpq;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::operator= -- Copy and move assignment.
+//
+
+HumdrumFileContent& HumdrumFileContent::operator=(HumdrumFileContent& infile) {
+	if (this == &infile) {
+		return *this;
+	}
+	HumdrumFileStructure::operator=(infile);
+	m_metricIndex = infile.m_metricIndex;
+	m_metricTpq   = infile.m_metricTpq;
+	return *this;
+}
+
+
+HumdrumFileContent& HumdrumFileContent::operator=(HumdrumFileContent&& infile) noexcept {
+	if (this == &infile) {
+		return *this;
+	}
+	HumdrumFileStructure::operator=(std::move(infile));
+	m_metricIndex = std::move(infile.m_metricIndex);
+	m_metricTpq   = infile.m_metricTpq;
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::analyzeRScale --
@@ -27367,6 +33100,94 @@ int HumdrumFileSet::readAppendHumdrum(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileSet::readSegments -- Read segments from a concatenated
+//    Humdrum file with a segment index, seeking directly to each segment
+//    instead of reading the whole file.  The segments are given by their
+//    indexes or their !!!!SEGMENT: names (all segments if no list is given).
+//    Unknown names and segments that cannot be read are skipped.  The
+//    segments can be read and parsed in parallel by several threads, each
+//    with its own stream to the data file, and are stored in the order
+//    given.  Returns the total number of segments in the set.
+//
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index, int threads) {
+	vector<int> segments(index.getSize());
+	for (int i=0; i<(int)segments.size(); i++) {
+		segments[i] = i;
+	}
+	return readSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index,
+		const vector<int>& segments, int threads) {
+	clear();
+	return readAppendSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index,
+		const vector<string>& names, int threads) {
+	vector<int> segments;
+	segments.reserve(names.size());
+	for (int i=0; i<(int)names.size(); i++) {
+		int segment = index.getSegment(names[i]);
+		if (segment >= 0) {
+			segments.push_back(segment);
+		}
+	}
+	return readSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readAppendSegments(const HumSegmentIndex& index,
+		const vector<int>& segments, int threads) {
+	int count = (int)segments.size();
+	if (count == 0) {
+		return (int)m_data.size();
+	}
+
+	vector<HumdrumFile*> files(count, NULL);
+	atomic<int> next(0);
+	auto readFiles = [&]() {
+		ifstream input(index.getFilename(), ios::binary);
+		if (!input.is_open()) {
+			return;
+		}
+		int i;
+		while ((i = next++) < count) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (HumdrumFileStream::readSegment(*infile, input, index, segments[i])) {
+				files[i] = infile;
+			} else {
+				delete infile;
+			}
+		}
+	};
+
+	int threadcount = min(max(threads, 1), count);
+	vector<thread> workers;
+	workers.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		workers.emplace_back(readFiles);
+	}
+	readFiles();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		if (files[i]) {
+			m_data.push_back(files[i]);
+		}
+	}
+	return (int)m_data.size();
+}
+
+
+
 //////////////////////////////
 //
 // appendHumdrumPointer --  The infile will be deleted by the object
@@ -27616,6 +33437,89 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::loadSegmentIndex -- Load the segment index of a
+//    concatenated Humdrum file for use with readSegment() (see
+//    HumSegmentIndex::load()).  Returns false if the file cannot be read.
+//
+
+bool HumdrumFileStream::loadSegmentIndex(const string& filename,
+		bool referencesQ) {
+	if (m_segmentstream.is_open()) {
+		m_segmentstream.close();
+	}
+	if (!m_segmentindex.load(filename, referencesQ)) {
+		return false;
+	}
+	m_segmentstream.open(filename, ios::binary);
+	return m_segmentstream.is_open();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a segment from a concatenated
+//    Humdrum file by seeking directly to it, either by its index in the
+//    file or by the name in its !!!!SEGMENT: record.  The result is the
+//    same as reading the file from the start with getFile() until the
+//    segment is reached.  The static version reads from the given data
+//    file stream, and can be used by several threads at once with separate
+//    streams.  Returns 0 if the segment cannot be read.
+//
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, int index) {
+	if (!m_segmentstream.is_open()) {
+		infile.clear();
+		return 0;
+	}
+	return readSegment(infile, m_segmentstream, m_segmentindex, index);
+}
+
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, const string& name) {
+	return readSegment(infile, m_segmentindex.getSegment(name));
+}
+
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, istream& input,
+		const HumSegmentIndex& segmentindex, int index) {
+	infile.clear();
+	string text;
+	if (!segmentindex.getText(input, index, text)) {
+		return 0;
+	}
+
+	// Set up a stream in the state that getFile() would be in when
+	// reaching the segment: the universal comments of the previous
+	// segments are stored, and after the first segment, the !!!!SEGMENT:
+	// or ** line which starts the segment has already been read.
+	HumdrumFileStream instream;
+	instream.m_curfile = 0;  // do not read from standard input
+	instream.m_universals = segmentindex.getUniversals(index);
+	if (index > 0) {
+		size_t newline = text.find('\n');
+		instream.m_newfilebuffer = text.substr(0, newline);
+		if (newline != string::npos) {
+			instream.m_stringbuffer.write(text.data() + newline + 1,
+					text.size() - newline - 1);
+		}
+	} else {
+		instream.m_stringbuffer << text;
+	}
+	if (!instream.getFile(infile)) {
+		return 0;
+	}
+	if ((index == 0) && infile.getFilename().empty()) {
+		// getFile() only uses the data filename for the first segment.
+		infile.setFilename(segmentindex.getFilename());
+	}
+	return 1;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::eof -- returns true if there is no more segements
@@ -27802,10 +33706,9 @@ restarting:
 	istream& input = *newinput;
 
 	// if the previous line from the last read starts with "**"
-	// then treat it as part of the current file.
-	if ((m_newfilebuffer.size() > 1) && (m_newfilebuffer.compare(0, 2, "**") == 0)) {
-		buffer << m_newfilebuffer << "\n";
-		m_newfilebuffer = "";
+	// then it is already the first line of the current file (the
+	// m_newfilebuffer line was moved into the buffer above).
+	if (buffer.str().compare(0, 2, "**") == 0) {
 		starstarFoundQ = 1;
 	}
 
@@ -28227,6 +34130,42 @@ HumdrumFileStructure::~HumdrumFileStructure() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::HumdrumFileStructure -- Copy and move constructors.
+//
+
+HumdrumFileStructure::HumdrumFileStructure(HumdrumFileStructure& infile) :
+		HumdrumFileBase(infile) {
+	// do nothing
+}
+
+
+HumdrumFileStructure::HumdrumFileStructure(HumdrumFileStructure&& infile) noexcept :
+		HumdrumFileBase(std::move(infile)) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::operator= -- Copy and move assignment.
+//
+
+HumdrumFileStructure& HumdrumFileStructure::operator=(HumdrumFileStructure& infile) {
+	HumdrumFileBase::operator=(infile);
+	return *this;
+}
+
+
+HumdrumFileStructure& HumdrumFileStructure::operator=(HumdrumFileStructure&& infile) noexcept {
+	HumdrumFileBase::operator=(std::move(infile));
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::read --  Read the contents of a file from a file or
@@ -28775,51 +34714,195 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 	if (getMaxTrack() == 0) {
 		return true;
 	}
-	int startline = getTrackStart(1)->getLineIndex();
-	int testline;
-	HumNum zero(0);
 
-	int i;
-	for (int i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
+	if (!assignDurationsFromStart()) { return false; }
+	if (!analyzeNullLineRhythms()) { return false; }
+	fillInNegativeStartTimes();
+	assignLineDurations();
+	if (!analyzeMeter()) { return false; }
+	if (!analyzeNonNullDataTokens()) { return false; }
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::assignDurationsFromStart -- Assign the
+//     durationFromStart of lines which contain the start of a note (or
+//     a spine terminator) in a rhythmic spine, in a single pass over
+//     the lines of the file.  For each token the running sum of note
+//     durations in its spine is taken from the token that precedes it on
+//     the previous line with spines (the sum is not increased by null
+//     tokens, so it is the start time of the next note in the spine).
+//     Spines which start after the first line of data (floating spines)
+//     are timed relative to their own start until they reach a line which
+//     already has a durationFromStart from the other spines, and then the
+//     tokens seen so far in the floating spine are assigned their times.
+//     Inconsistencies are reported by setLineDurationFromStart().
+//
+
+bool HumdrumFileStructure::assignDurationsFromStart(void) {
+	int maxtrack = getMaxTrack();
+	vector<bool> rhythmic(maxtrack + 1, false);
+	int maxfields = 0;
+	for (int i=1; i<=maxtrack; i++) {
+		HTp start = getTrackStart(i);
+		rhythmic[i] = start && start->hasRhythm();
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->getFieldCount() > maxfields) {
+			maxfields = m_lines[i]->getFieldCount();
+		}
+	}
+
+	// Running sums at the start and end of each token on the current line
+	// and at the end of each token on the previous line with spines.  The
+	// sums are absolute when the matching origin is 0, relative to the
+	// start of floating spine n-1 when the origin is n > 0, and unknown
+	// when the origin is negative (not rhythmic, or not connected to the
+	// previous line).
+	vector<HumNum> starts(maxfields);
+	vector<HumNum> ends(maxfields);
+	vector<HumNum> lastends(maxfields);
+	vector<int> endorigins(maxfields, -1);
+	vector<int> lastorigins(maxfields, -1);
+
+	// Start time of each floating spine (negative until known), and the
+	// tokens in the spine which are waiting for it:
+	vector<HumNum> offsets;
+	vector<vector<pair<HTp, HumNum>>> pending;
+
+	int startline = getTrackStart(1)->getLineIndex();
+	int lastline = -1;
+	HLp line;
+	HTp token;
+	HTp previous;
+	int track;
+	int origin;
+	HumNum duration;
+	for (int i=startline; i<(int)m_lines.size(); i++) {
+		line = m_lines[i];
+		if (!line->hasSpines()) {
 			continue;
 		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline == startline) {
-			if (!assignDurationsToTrack(getTrackStart(i), zero)) {
-				return false;
+		int fcount = line->getFieldCount();
+
+		// Lines which are not linked to the previous line (such as ones
+		// added by insertNullInterpretationLineAboveIndex()) are not in
+		// the path of any spine, so they keep their current time:
+		if (i > startline) {
+			bool linkedQ = false;
+			for (int j=0; j<fcount; j++) {
+				token = line->token(j);
+				if ((token->getPreviousTokenCount() > 0) ||
+						token->isExclusiveInterpretation()) {
+					linkedQ = true;
+					break;
+				}
+			}
+			if (!linkedQ) {
+				continue;
 			}
-		} else {
-			// Spine does not start at beginning of data, so
-			// the starting position of the spine has to be
-			// determined before continuing.  Search for a token
-			// which is on a line with assigned duration, then work
-			// outwards from that position.
-			continue;
 		}
-	}
 
-	// Go back and analyze spines that do not start at the
-	// beginning of the data stream.
-	for (i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
+		bool floatingQ = false;
+		for (int j=0; j<fcount; j++) {
+			endorigins[j] = -1;
+			token = line->token(j);
+			track = token->getTrack();
+			if ((track < 1) || (track > maxtrack) || !rhythmic[track]) {
+				continue;
+			}
+			if (token->getPreviousTokenCount() == 0) {
+				if (i == startline) {
+					starts[j] = 0;
+					origin = 0;
+				} else {
+					offsets.push_back(-1);
+					pending.resize(offsets.size());
+					starts[j] = 0;
+					origin = (int)offsets.size();
+				}
+			} else {
+				previous = token->getPreviousToken(0);
+				if (previous->getLineIndex() != lastline) {
+					continue;
+				}
+				int k = previous->getFieldIndex();
+				origin = lastorigins[k];
+				if (origin < 0) {
+					continue;
+				}
+				starts[j] = lastends[k];
+				if ((origin > 0) && offsets[origin-1].isNonNegative()) {
+					starts[j] += offsets[origin-1];
+					origin = 0;
+				}
+			}
+			endorigins[j] = origin;
+			if (origin > 0) {
+				// Floating spines are done after the line time is known.
+				floatingQ = true;
+				continue;
+			}
+			if (!setLineDurationFromStart(token, starts[j])) { return isValid(); }
+			ends[j] = starts[j];
+			duration = token->getDuration();
+			if (duration.isPositive()) {
+				ends[j] += duration;
+			}
 		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline > startline) {
-			if (!analyzeRhythmOfFloatingSpine(getTrackStart(i))) { return false; }
+
+		// Tokens in floating spines either use the line time to find the
+		// start of their spine, or wait for a later line:
+		for (int j=0; floatingQ && (j<fcount); j++) {
+			origin = endorigins[j];
+			if (origin <= 0) {
+				continue;
+			}
+			token = line->token(j);
+			ends[j] = starts[j];
+			duration = token->getDuration();
+			if (duration.isPositive()) {
+				ends[j] += duration;
+			}
+			if (offsets[origin-1].isNegative()) {
+				HumNum linestart = line->getDurationFromStart();
+				bool timedQ = token->isTerminateInterpretation()
+						|| duration.isNonNegative();
+				if (!(timedQ && linestart.isNonNegative())) {
+					pending[origin-1].emplace_back(token, starts[j]);
+					continue;
+				}
+				offsets[origin-1] = linestart - starts[j];
+				for (auto& item : pending[origin-1]) {
+					if (!setLineDurationFromStart(item.first,
+							item.second + offsets[origin-1])) {
+						return isValid();
+					}
+				}
+				pending[origin-1].clear();
+			}
+			starts[j] += offsets[origin-1];
+			ends[j] += offsets[origin-1];
+			endorigins[j] = 0;
+			if (!setLineDurationFromStart(token, starts[j])) { return isValid(); }
 		}
+
+		lastends.swap(ends);
+		lastorigins.swap(endorigins);
+		lastline = i;
 	}
 
-	if (!analyzeNullLineRhythms()) { return false; }
-	fillInNegativeStartTimes();
-	assignLineDurations();
-	if (!analyzeMeter()) { return false; }
-	if (!analyzeNonNullDataTokens()) { return false; }
+	for (int i=0; i<(int)offsets.size(); i++) {
+		if (offsets[i].isNegative()) {
+			return setParseError("Error cannot link floating spine to score.");
+		}
+	}
 
-	return true;
+	return isValid();
 }
 
 
@@ -29163,90 +35246,6 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
-//
-
-bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
-		HumNum startdur) {
-	if (!starttoken->hasRhythm()) {
-		return isValid();
-	}
-	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
-	}
-	return isValid();
-}
-
-
-
-//////////////////////////////
-//
-// HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
-//
-
-bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
-	if (state != token->getState()) {
-		return isValid();
-	}
-
-	HumNum dursum = startdur;
-	token->incrementState();
-
-	if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	if (token->getDuration().isPositive()) {
-		dursum += token->getDuration();
-	}
-	int tcount = token->getNextTokenCount();
-
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
-
-	// Assign line durationFromStarts for primary track first.
-	while (tcount > 0) {
-		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
-		}
-		token = token->getNextToken(0);
-		if (state != token->getState()) {
-			break;
-		}
-		token->incrementState();
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-		if (token->getDuration().isPositive()) {
-			dursum += token->getDuration();
-		}
-		tcount = token->getNextTokenCount();
-	}
-
-	if ((tcount == 0) && (token->isTerminateInterpretation())) {
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	}
-
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::setLineDurationFromStart -- Set the duration of
@@ -29278,54 +35277,6 @@ bool HumdrumFileStructure::setLineDurationFromStart(HTp token,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::analyzeRhythmOfFloatingSpine --  This analysis
-//    function is used to analyze the rhythm of spines which do not start at
-//    the beginning of the data.  The function searches for the first line
-//    which has an assigned durationFromStart value, and then uses that
-//    as the basis for assigning the initial durationFromStart position
-//    for the spine.
-//
-
-bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
-		HTp spinestart) {
-	HumNum dursum = 0;
-	HumNum founddur = 0;
-	HTp token = spinestart;
-	int tcount = token->getNextTokenCount();
-
-	// Find a known durationFromStart for a line in the Humdrum file, then
-	// use that to calculate the starting duration of the floating spine.
-	if (token->getDurationFromStart().isNonNegative()) {
-		founddur = token->getLine()->getDurationFromStart();
-	} else {
-		tcount = token->getNextTokenCount();
-		while (tcount > 0) {
-			if (token->getDurationFromStart().isNonNegative()) {
-				founddur = token->getLine()->getDurationFromStart();
-				break;
-			}
-			if (token->getDuration().isPositive()) {
-				dursum += token->getDuration();
-			}
-			token = token->getNextToken(0);
-		}
-	}
-
-	if (founddur.isZero()) {
-		return setParseError("Error cannot link floating spine to score.");
-	}
-
-	if (!assignDurationsToTrack(spinestart, founddur - dursum)) {
-		return isValid();
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeNullLineRhythms -- When a series of null-token
@@ -31361,6 +37312,7 @@ int HumdrumLine::createTokensFromLine(void) {
 	}
 	m_tokens.clear();
 	m_tabs.clear();
+	invalidateTrackIndex();
 	HTp token;
 	char ch = 0;
 	char lastch = 0;
@@ -31423,6 +37375,7 @@ int HumdrumLine::createTokensFromLine(void) {
 
 void HumdrumLine::createLineFromTokens(void) {
 	string& iline = *this;
+	bool emptyQ = iline.empty();
 	iline = "";
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
@@ -31446,6 +37399,10 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	if (iline.empty() != emptyQ) {
+		// empty lines are not in the owner's track index:
+		invalidateTrackIndex();
+	}
 }
 
 
@@ -31827,22 +37784,22 @@ ostream& HumdrumLine::printXml(ostream& out, int level, const string& indent) {
 		bool bend   = isKernBoundaryEnd();
 		if (bstart || bend) {
 			out << Convert::repeatString(indent, level);
-			cout << "<kernBoundary";
-			cout << " start=\"";
+			out << "<kernBoundary";
+			out << " start=\"";
 			if (bstart) {
-				cout << "true";
+				out << "true";
 			} else {
-				cout << "false";
+				out << "false";
 			}
-			cout << "\"";
-			cout << " end=\"";
+			out << "\"";
+			out << " end=\"";
 			if (bend) {
-				cout << "true";
+				out << "true";
 			} else {
-				cout << "false";
+				out << "false";
 			}
-			cout << "\"";
-			cout << "/>\n";
+			out << "\"";
+			out << "/>\n";
 		}
 
 		level--;
@@ -31944,6 +37901,139 @@ ostream& HumdrumLine::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::printJson -- Write the line as a JSON object.  Lines with
+//    spines contain a "tokens" array (if FIELD_TOKENS is selected); other
+//    lines contain the text of the line and reference record information.
+//
+
+void HumdrumLine::printJson(HumJsonWriter& json, int fields) {
+	bool linesQ  = fields & HumJsonWriter::FIELD_LINES;
+	bool tokensQ = fields & HumJsonWriter::FIELD_TOKENS;
+	bool rhythmQ = fields & HumJsonWriter::FIELD_RHYTHM;
+	bool paramQ  = fields & HumJsonWriter::FIELD_PARAMETERS;
+
+	json.beginObject();
+	json.writeKey("n");
+	json.writeInt(getLineIndex());
+	json.writeKey("id");
+	json.writeLineId(getLineIndex());
+
+	if (hasSpines()) {
+		if (linesQ) {
+			json.writeKey("type");
+			if (isData()) {
+				json.writeString("data");
+			} else if (isBarline()) {
+				json.writeString("barline");
+			} else if (isInterpretation()) {
+				json.writeString("interpretation");
+			} else if (isLocalComment()) {
+				json.writeString("local-comment");
+			}
+			json.writeKey("fieldCount");
+			json.writeInt(getFieldCount());
+			if (!tokensQ) {
+				json.writeKey("text");
+				json.writeString(*this);
+			}
+			bool bstart = isKernBoundaryStart();
+			bool bend   = isKernBoundaryEnd();
+			if (bstart || bend) {
+				json.writeKey("kernBoundary");
+				json.beginObject();
+				json.writeKey("start");
+				json.writeBool(bstart);
+				json.writeKey("end");
+				json.writeBool(bend);
+				json.endObject();
+			}
+		}
+		if (rhythmQ) {
+			json.writeKey("start");
+			json.writeNumber(getDurationFromStart());
+			json.writeKey("duration");
+			json.writeNumber(getDuration());
+			if (isBarline()) {
+				json.writeKey("barlineDuration");
+				json.writeNumber(getBarlineDuration());
+			}
+		}
+		if (paramQ) {
+			((HumHash*)this)->printJson(json);
+		}
+		if (tokensQ) {
+			json.writeKey("tokens");
+			json.beginArray();
+			for (int i=0; i<getFieldCount(); i++) {
+				token(i)->printJson(json, fields);
+			}
+			json.endArray();
+		}
+	} else {
+		if (linesQ) {
+			json.writeKey("type");
+			if (isGlobalReference()) {
+				json.writeString("reference");
+			} else if (isUniversalReference()) {
+				json.writeString("ureference");
+			} else if (isBlank()) {
+				json.writeString("empty");
+			} else {
+				json.writeString("global-comment");
+			}
+			json.writeKey("text");
+			json.writeString(*this);
+
+			if (isReference()) {
+				string key = getReferenceKey();
+				string language;
+				bool primaryQ = false;
+				auto loc = key.find("@@");
+				if (loc != string::npos) {
+					language = key.substr(loc+2);
+					key = key.substr(0, loc);
+					primaryQ = true;
+				} else {
+					loc = key.find("@");
+					if (loc != string::npos) {
+						language = key.substr(loc+1);
+						key = key.substr(0, loc);
+					}
+				}
+				json.writeKey("referenceKey");
+				json.writeString(key);
+				if (!language.empty()) {
+					json.writeKey("language");
+					json.writeString(language);
+				}
+				if (primaryQ) {
+					json.writeKey("primary");
+					json.writeBool(true);
+				}
+				json.writeKey("referenceValue");
+				json.writeString(getGlobalReferenceValue());
+			}
+		}
+		if (rhythmQ) {
+			json.writeKey("start");
+			json.writeNumber(getDurationFromStart());
+		}
+		if (paramQ) {
+			((HumHash*)this)->printJson(json);
+			if (getTokenCount() > 0) {
+				// global comment parameters are stored in the only token:
+				((HumHash*)token(0))->printJson(json, "globalParameters");
+			}
+		}
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getXmlId -- Return a unique ID for the current line.
@@ -32027,6 +38117,21 @@ void HumdrumLine::setOwner(void* hfile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::invalidateTrackIndex -- Tell the owning file that the
+//    tokens of the line have changed, so that its track index (used by
+//    HumTrackView) needs to be rebuilt.
+//
+
+void HumdrumLine::invalidateTrackIndex(void) {
+	if (m_owner) {
+		((HumdrumFileBase*)m_owner)->invalidateTrackIndex();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getOwner -- Return the HumdrumFile which manages
@@ -32119,6 +38224,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32126,6 +38232,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32133,6 +38240,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32140,6 +38248,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32175,6 +38284,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32182,6 +38292,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32189,6 +38300,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32196,6 +38308,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -32544,6 +38657,720 @@ ostream& operator<< (ostream& out, HLp line) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLineStream::HumdrumLineStream --
+//
+
+HumdrumLineStream::HumdrumLineStream(void) {
+	// do nothing
+}
+
+HumdrumLineStream::HumdrumLineStream(const vector<string>& list) {
+	setFileList(list);
+}
+
+HumdrumLineStream::HumdrumLineStream(Options& options) {
+	vector<string> list;
+	options.getArgList(list);
+	setFileList(list);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::setFileList -- Set the list of files to read.  If
+//    the list is empty, then standard input will be read.
+//
+
+int HumdrumLineStream::setFileList(const vector<string>& list) {
+	m_filelist = list;
+	m_curfile = -1;
+	m_input = NULL;
+	m_stringQ = false;
+	return (int)m_filelist.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::loadString -- Read the data from a string rather
+//    than from files or standard input.
+//
+
+void HumdrumLineStream::loadString(const string& data) {
+	m_filelist.clear();
+	m_curfile = -1;
+	m_stringbuffer.str(data);
+	m_stringbuffer.clear();
+	m_input = NULL;
+	m_stringQ = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::readLine -- Read the next line of the input and
+//    analyze its spine structure.  Returns false when there is no more
+//    input.  Segments are split in the same manner as HumdrumFileStream:
+//    at the start of each file, at !!!!SEGMENT records and when a second
+//    exclusive interpretation line is found.  Universal comments at the
+//    start of a segment are demoted to global comments and repeated at
+//    the start of each following segment.  Lines which do not start with
+//    "*" or "!" outside of the spine data are considered to be the names
+//    of additional files to read.
+//
+
+bool HumdrumLineStream::readLine(void) {
+	string line;
+	while (true) {
+		if (!m_output.empty()) {
+			line = m_output.front();
+			m_output.erase(m_output.begin());
+			bool valid = isValid();
+			if (!analyzeLine(line) && valid) {
+				// Report the first spine error in the segment.
+				cerr << m_parseError << endl;
+			}
+			return true;
+		}
+
+		if (!getRawLine(line)) {
+			return false;
+		}
+
+		if ((line.compare(0, 11, "!!!!SEGMENT") == 0) && m_dataFound) {
+			startSegment();
+		}
+		if (line.compare(0, 2, "**") == 0) {
+			if (m_starstarFound) {
+				startSegment();
+			}
+			m_starstarFound = true;
+		}
+
+		int len = (int)line.size();
+		if ((len > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !m_dataFound &&
+				(line.compare(0, 11, "!!!!filter:") != 0) &&
+				(line.compare(0, 12, "!!!!SEGMENT:") != 0)) {
+			// Universal comment which replaces any universal comments
+			// from previous segments.
+			if (!m_newUniversals) {
+				m_universals.clear();
+				m_newUniversals = true;
+			}
+			m_universals.push_back(line);
+			continue;
+		}
+
+		if (line.compare(0, 2, "*-") == 0) {
+			m_starminusFound = true;
+		}
+
+		if ((m_starminusFound || !m_starstarFound) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// Filename to add to the input list.
+			if (find(m_filelist.begin(), m_filelist.end(), line) == m_filelist.end()) {
+				m_filelist.push_back(line);
+			}
+			continue;
+		}
+
+		if (!m_dataFound) {
+			m_dataFound = true;
+			for (int i=0; i<(int)m_universals.size(); i++) {
+				if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
+					continue;
+				}
+				m_output.push_back(m_universals[i].substr(1));
+			}
+		}
+		m_output.push_back(line);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getRawLine -- Read the next line from the current
+//    input, opening the next input file if necessary.  The empty line
+//    after the last newline of an input is not returned.
+//
+
+bool HumdrumLineStream::getRawLine(string& line) {
+	while (true) {
+		if (m_input == NULL) {
+			if (!openNextInput()) {
+				return false;
+			}
+			startSegment();
+		}
+		if (getline(*m_input, line)) {
+			if (m_input->eof() && line.empty()) {
+				m_input = NULL;
+				continue;
+			}
+			return true;
+		}
+		m_input = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::openNextInput -- Returns false if there is no more
+//    input to read.
+//
+
+bool HumdrumLineStream::openNextInput(void) {
+	if (m_stringQ) {
+		if (m_curfile >= 0) {
+			return false;
+		}
+		m_curfile = 0;
+		m_filename = "";
+		m_input = &m_stringbuffer;
+		return true;
+	}
+
+	if (m_filelist.empty()) {
+		if (m_curfile >= 0) {
+			return false;
+		}
+		m_curfile = 0;
+		m_filename = "";
+		m_input = &cin;
+		return true;
+	}
+
+	while (m_curfile < (int)m_filelist.size() - 1) {
+		m_curfile++;
+		if (m_instream.is_open()) {
+			m_instream.close();
+		}
+		m_filename = m_filelist[m_curfile];
+		if (m_filename.find("://") != string::npos) {
+			#ifdef USING_URI
+				m_stringbuffer.str("");
+				m_stringbuffer.clear();
+				string webaddress = HumdrumFileBase::getUriToUrlMapping(m_filename);
+				HumdrumFileBase::readStringFromHttpUri(m_stringbuffer, webaddress);
+				m_input = &m_stringbuffer;
+				return true;
+			#else
+				continue;
+			#endif
+		}
+		m_instream.clear();
+		m_instream.open(m_filename);
+		if (!m_instream.is_open()) {
+			// Silently skip files which cannot be opened.
+			continue;
+		}
+		m_input = &m_instream;
+		return true;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::startSegment -- Prepare for reading a new segment.
+//
+
+void HumdrumLineStream::startSegment(void) {
+	m_dataFound      = false;
+	m_starstarFound  = false;
+	m_starminusFound = false;
+	m_newUniversals  = false;
+	m_segmentPending = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::reset -- Clear the spine structure in preparation
+//    for a new segment.
+//
+
+void HumdrumLineStream::reset(void) {
+	m_datatype.clear();
+	m_sinfo.clear();
+	m_strack.clear();
+	m_init        = false;
+	m_manipulator = false;
+	m_exclusiveStart = false;
+	m_maxtrack    = 0;
+	m_lineindex   = -1;
+	m_addOpen     = false;
+	m_parseError.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeLine -- Set the contents of the current line
+//    and calculate its track information from the spine manipulators
+//    on previous lines.  Returns false if there is a spine structure error.
+//    This function can be used directly (without readLine) to analyze
+//    lines from another source one at a time.
+//
+
+bool HumdrumLineStream::analyzeLine(const string& line) {
+	if (m_segmentPending) {
+		reset();
+		m_segment++;
+		m_segmentStart = true;
+		m_segmentPending = false;
+	} else {
+		m_segmentStart = false;
+		if (m_manipulator && !m_exclusiveStart && isValid()) {
+			// Spine manipulators on the previous line change the spine
+			// structure of this line.
+			adjustSpines();
+		}
+	}
+
+	m_line = line;
+	if (!m_line.empty() && (m_line.back() == 0x0d)) {
+		m_line.resize(m_line.size() - 1);
+	}
+	m_lineindex++;
+	tokenizeLine();
+	analyzeSpines();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::tokenizeLine -- Split the current line into tokens
+//    in the same manner as HumdrumLine::createTokensFromLine().
+//
+
+void HumdrumLineStream::tokenizeLine(void) {
+	m_tokens.clear();
+	if (m_line.empty() || (m_line.compare(0, 2, "!!") == 0)) {
+		m_tokens.push_back(m_line);
+		return;
+	}
+	size_t start = 0;
+	while (true) {
+		size_t tab = m_line.find('\t', start);
+		if (tab == string::npos) {
+			if (start < m_line.size()) {
+				m_tokens.emplace_back(m_line, start);
+			}
+			break;
+		}
+		m_tokens.emplace_back(m_line, start, tab - start);
+		start = m_line.find_first_not_of('\t', tab);
+		if (start == string::npos) {
+			break;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeSpines -- Assign spine information to the
+//    tokens on the current line.
+//
+
+void HumdrumLineStream::analyzeSpines(void) {
+	int count = (int)m_tokens.size();
+	m_manipulator = false;
+	m_exclusiveStart = false;
+	if (isInterpretation()) {
+		for (int i=0; i<count; i++) {
+			if (isManipulator(m_tokens[i])) {
+				m_manipulator = true;
+				break;
+			}
+		}
+	}
+	m_linetracks.assign(count, 0);
+	m_linesubtracks.assign(count, 0);
+	if (!hasSpines() || !isValid()) {
+		return;
+	}
+
+	if (!m_init) {
+		if (!isExclusive()) {
+			stringstream err;
+			err << "Error on line: " << (m_lineindex+1) << ':' << endl;
+			err << "   Data found before exclusive interpretation" << endl;
+			err << "   LINE: " << m_line;
+			setParseError(err.str());
+			return;
+		}
+		// The starting exclusive interpretations define the spines
+		// rather than manipulating them.
+		m_init = true;
+		m_exclusiveStart = true;
+		m_datatype = m_tokens;
+		m_sinfo.resize(count);
+		m_strack.resize(count);
+		for (int i=0; i<count; i++) {
+			m_sinfo[i] = to_string(i+1);
+			m_strack[i] = i+1;
+		}
+		m_maxtrack = count;
+		analyzeTracks();
+		return;
+	}
+
+	if ((int)m_sinfo.size() != count) {
+		stringstream err;
+		err << "Error on line " << (m_lineindex+1) << ':' << endl;
+		err << "   Expected " << m_sinfo.size() << " fields,"
+		    << "    but found " << count;
+		err << "\nLine is: " << m_line << endl;
+		setParseError(err.str());
+		return;
+	}
+
+	analyzeTracks();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeTracks -- Calculate the track and subtrack of
+//    each token on the line.  Subtracks index subspines from left to right
+//    on the line, and are 0 if a track is not split.
+//
+
+void HumdrumLineStream::analyzeTracks(void) {
+	int count = (int)m_tokens.size();
+	m_subtrackcount.assign(m_maxtrack + 1, 0);
+	m_subtrackindex.assign(m_maxtrack + 1, 0);
+	for (int i=0; i<count; i++) {
+		m_linetracks[i] = m_strack[i];
+		m_subtrackcount[m_strack[i]]++;
+	}
+	for (int i=0; i<count; i++) {
+		int track = m_linetracks[i];
+		if (m_subtrackcount[track] > 1) {
+			m_linesubtracks[i] = ++m_subtrackindex[track];
+		} else {
+			m_linesubtracks[i] = 0;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::adjustSpines -- Update the spine structure for the
+//    manipulators on the current line (in the same manner as
+//    HumdrumFileBase::adjustSpines()).
+//
+
+bool HumdrumLineStream::adjustSpines(void) {
+	vector<string> newtype;
+	vector<string> newinfo;
+	int count = (int)m_tokens.size();
+	newtype.reserve(count + 1);
+	newinfo.reserve(count + 1);
+	for (int i=0; i<count; i++) {
+		const string& token = m_tokens[i];
+		if (token == "*^") {
+			newtype.push_back(m_datatype[i]);
+			newtype.push_back(m_datatype[i]);
+			newinfo.push_back('(' + m_sinfo[i] + ")a");
+			newinfo.push_back('(' + m_sinfo[i] + ")b");
+		} else if (token == "*v") {
+			int mergecount = 0;
+			for (int j=i+1; j<count; j++) {
+				if (m_tokens[j] == "*v") {
+					mergecount++;
+				} else {
+					break;
+				}
+			}
+			newinfo.push_back(HumdrumFileBase::getMergedSpineInfo(m_sinfo, i, mergecount));
+			newtype.push_back(m_datatype[i]);
+			i += mergecount;
+		} else if (token == "*+") {
+			newtype.push_back(m_datatype[i]);
+			newtype.push_back("");
+			newinfo.push_back(m_sinfo[i]);
+			newinfo.push_back(to_string(++m_maxtrack));
+			m_addOpen = true;
+		} else if (token == "*x") {
+			if (i < count - 1) {
+				newtype.push_back(m_datatype[i+1]);
+				newtype.push_back(m_datatype[i]);
+				newinfo.push_back(m_sinfo[i+1]);
+				newinfo.push_back(m_sinfo[i]);
+				i++;
+			} else {
+				stringstream err;
+				err << "ERROR2 in *x calculation" << endl;
+				err << "Index " << i << " larger than allowed: " << count - 1;
+				return setParseError(err.str());
+			}
+		} else if (token == "*-") {
+			// spine is terminated
+		} else if (token.compare(0, 2, "**") == 0) {
+			if (!m_addOpen) {
+				stringstream err;
+				err << "Error: Exclusive interpretation with no preparation "
+				    << "on line " << m_lineindex << " spine index " << i << endl;
+				err << "Line: " << m_line;
+				return setParseError(err.str());
+			}
+			m_addOpen = false;
+			newtype.push_back(token);
+			newinfo.push_back(m_sinfo[i]);
+		} else {
+			newtype.push_back(m_datatype[i]);
+			newinfo.push_back(m_sinfo[i]);
+		}
+	}
+
+	m_datatype.swap(newtype);
+	m_sinfo.swap(newinfo);
+	m_strack.resize(m_sinfo.size());
+	for (int i=0; i<(int)m_sinfo.size(); i++) {
+		m_strack[i] = getTrackFromSpineInfo(m_sinfo[i]);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getTrackFromSpineInfo -- The track is the first
+//    number in the spine info string.
+//
+
+int HumdrumLineStream::getTrackFromSpineInfo(const string& info) {
+	int track = 0;
+	size_t i = info.find_first_of("0123456789");
+	if (i == string::npos) {
+		return 0;
+	}
+	while ((i < info.size()) && isdigit(info[i])) {
+		track = track * 10 + (info[i] - '0');
+		i++;
+	}
+	return track;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::setParseError -- Store the first error found in the
+//    spine structure of the current segment.  Tracks are not calculated
+//    for the rest of the segment after an error.
+//
+
+bool HumdrumLineStream::setParseError(const string& err) {
+	if (m_parseError.empty()) {
+		m_parseError = err;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getTrack -- Return the track number of the given
+//    token on the current line.
+//
+
+int HumdrumLineStream::getTrack(int index) const {
+	return m_linetracks.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getSubtrack -- Return the subtrack number of the
+//    given token on the current line (0 if the track is not split).
+//
+
+int HumdrumLineStream::getSubtrack(int index) const {
+	return m_linesubtracks.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getSpineInfo -- Return the spine info string of the
+//    given token on the current line, such as "1" or "(2)a".
+//
+
+const string& HumdrumLineStream::getSpineInfo(int index) const {
+	static const string empty;
+	if (!hasSpines() || !isValid() || (index >= (int)m_sinfo.size())) {
+		return empty;
+	}
+	return m_sinfo[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getDataType -- Return the exclusive interpretation
+//    of the spine for the given token on the current line.
+//
+
+const string& HumdrumLineStream::getDataType(int index) const {
+	static const string empty;
+	if (!hasSpines() || !isValid() || (index >= (int)m_datatype.size())) {
+		return empty;
+	}
+	return m_datatype[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isData -- Returns true if data (but not measure).
+//
+
+bool HumdrumLineStream::isData(void) const {
+	return !(isComment() || isInterpretation() || isBarline() || isEmpty());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isReference -- Returns true if a global or universal
+//    reference record (!!!KEY: VALUE or !!!!KEY: VALUE).
+//
+
+bool HumdrumLineStream::isReference(void) const {
+	if (m_line.size() < 5) {
+		return false;
+	}
+	if (m_line.compare(0, 3, "!!!") != 0) {
+		return false;
+	}
+	if ((m_line[3] == '!') && (m_line[4] == '!')) {
+		return false;
+	}
+	size_t spaceloc = m_line.find(" ");
+	size_t tabloc = m_line.find("\t");
+	size_t colloc = m_line.find(":");
+	if (colloc == string::npos) {
+		return false;
+	}
+	if ((spaceloc != string::npos) && (spaceloc < colloc)) {
+		return false;
+	}
+	if ((tabloc != string::npos) && (tabloc < colloc)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isAllNull -- Returns true if all tokens on the line
+//    are null ("." if a data line, "*" if an interpretation line, "!"
+//    if a local comment line).
+//
+
+bool HumdrumLineStream::isAllNull(void) const {
+	if (!hasSpines()) {
+		return false;
+	}
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		const string& token = m_tokens[i];
+		if ((token != ".") && (token != "*") && (token != "!")) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::equalFieldsQ -- Returns true if all tokens on the
+//    line are in spines of the given exclusive interpretation and are
+//    equal to the given value.
+//
+
+bool HumdrumLineStream::equalFieldsQ(const string& exinterp,
+		const string& value) const {
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		const string& datatype = getDataType(i);
+		if (exinterp.compare(0, 2, "**") == 0) {
+			if (datatype != exinterp) {
+				return false;
+			}
+		} else if ((datatype.size() < 2) || (datatype.compare(2, string::npos, exinterp) != 0)) {
+			return false;
+		}
+		if (m_tokens[i] != value) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isManipulator -- Returns true if the token is a
+//    spine manipulator (*^, *v, *x, *+, *- or an exclusive interpretation).
+//
+
+bool HumdrumLineStream::isManipulator(const string& token) {
+	if (token.compare(0, 2, "**") == 0) {
+		return true;
+	}
+	if ((token.size() != 2) || (token[0] != '*')) {
+		return false;
+	}
+	switch (token[1]) {
+		case '^':
+		case 'v':
+		case 'x':
+		case '+':
+		case '-':
+			return true;
+	}
+	return false;
+}
+
+
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getBase40Pitches -- Returns 0 if a rest.
@@ -32553,22 +39380,27 @@ ostream& operator<< (ostream& out, HLp line) {
 //
 
 void HumdrumToken::getBase40Pitches(vector<int>& output) {
-	if (*this == ".") {
+	if ((*this == ".") || empty()) {
 		// Not resolving null tokens in this function.
 		output.clear();
 		return;
 	}
-	vector<string> pieces = this->getSubtokens();
+	HumSubtokenView pieces = this->getSubtokenView();
 	output.resize(pieces.size());
-	for (int i=0; i<(int)pieces.size(); i++) {
-		if (pieces[i].find("r") != string::npos) {
+	for (const HumSubtoken& piece : pieces) {
+		int i = piece.getIndex();
+		if (piece.contains('r')) {
 			output[i] = 0;
 		} else {
-			output[i] = Convert::kernToBase40(pieces[i]);
+			if (pieces.isKern()) {
+				output[i] = piece.getBase40();
+			} else {
+				output[i] = Convert::kernToBase40(piece.getString());
+			}
 			// sustained notes are negative values:
-			if (pieces[i].find("_") != string::npos) {
+			if (piece.contains('_')) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("]") != string::npos) {
+			} else if (piece.contains(']')) {
 				output[i] = -output[i];
 			}
 		}
@@ -32670,22 +39502,27 @@ void HumdrumToken::getBase40PitchesResolveNull(vector<int>& output) {
 	if (token == NULL) {
 		return;
 	}
-	if (*token == ".") {
+	if ((*token == ".") || token->empty()) {
 		return;
 	}
-	vector<string> pieces = token->getSubtokens();
+	HumSubtokenView pieces = token->getSubtokenView();
 	output.resize(pieces.size());
-	for (int i=0; i<(int)pieces.size(); i++) {
-		if (pieces[i].find("r") != string::npos) {
+	for (const HumSubtoken& piece : pieces) {
+		int i = piece.getIndex();
+		if (piece.contains('r')) {
 			output[i] = 0;
 		} else {
-			output[i] = Convert::kernToBase40(pieces[i]);
+			if (pieces.isKern()) {
+				output[i] = piece.getBase40();
+			} else {
+				output[i] = Convert::kernToBase40(piece.getString());
+			}
 			// sustained notes are negative values:
 			if (nullQ) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("_") != string::npos) {
+			} else if (piece.contains('_')) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("]") != string::npos) {
+			} else if (piece.contains(']')) {
 				output[i] = -output[i];
 			}
 		}
@@ -32987,7 +39824,6 @@ HumdrumToken::HumdrumToken(void) : string() {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -32996,7 +39832,6 @@ HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -33005,7 +39840,6 @@ HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -33021,7 +39855,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token.getPrefix());
 }
 
@@ -33038,7 +39871,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token) :
 	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token->getPrefix());
 }
 
@@ -33056,7 +39888,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token, HLp owner) :
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token.getPrefix());
 }
 
@@ -33073,7 +39904,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token, HLp owner) :
 	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token->getPrefix());
 }
 
@@ -33101,7 +39931,7 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix(token.getPrefix());
 
 	return *this;
@@ -33120,7 +39950,7 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix("!");
 
 	return *this;
@@ -33139,7 +39969,7 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix("!");
 
 	return *this;
@@ -33153,13 +39983,28 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 //
 
 HumdrumToken::~HumdrumToken() {
-	if (m_parameterSet) {
-		delete m_parameterSet;
-		m_parameterSet = NULL;
+	if (m_cold) {
+		delete m_cold;
+		m_cold = NULL;
 	}
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumToken::getColdData -- Return the rarely used data for the token,
+//     allocating it if necessary.
+//
+
+HumdrumToken::ColdData& HumdrumToken::getColdData(void) {
+	if (!m_cold) {
+		m_cold = new ColdData;
+	}
+	return *m_cold;
+}
+
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -33470,6 +40315,19 @@ void HumdrumToken::setSpineInfo(const string& spineinfo) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::shareSpineInfo -- Use the spine info string of another
+//    token (which has the same spine info) rather than a copy of it.
+// @SEEALTO: setSpineInfo
+//
+
+void HumdrumToken::shareSpineInfo(HTp token) {
+	m_address.shareSpineInfo(token->m_address);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getSpineInfo -- Returns the spine split/merge history
@@ -33709,7 +40567,7 @@ HTp HumdrumToken::getNextToken(int index) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
-	return m_nextTokens;
+	return m_nextTokens.toVector();
 }
 
 
@@ -33721,7 +40579,7 @@ vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
-	return m_previousTokens;
+	return m_previousTokens.toVector();
 }
 
 
@@ -34282,9 +41140,9 @@ bool HumdrumToken::isRest(void) {
 			// token is a chord (rests in chords are used for non-sounding
 			// notes in artificial harmonics).
 			return false;
-		} else if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
+		} else if (isNull() && Convert::isKernRest(*resolveNull())) {
 			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
+		} else if (Convert::isKernRest(*this)) {
 			return true;
 		}
 	} else if (isMensLike()) {
@@ -34313,7 +41171,7 @@ bool HumdrumToken::isNote(void) {
 		return false;
 	}
 	if (isKernLike()) {
-		if (Convert::isKernNote((string)(*this))) {
+		if (Convert::isKernNote(*this)) {
 			return true;
 		}
 	} else if (isMensLike()) {
@@ -34941,7 +41799,7 @@ string HumdrumToken::getInstrumentAbbreviation(void) {
 
 bool HumdrumToken::hasSlurStart(void) {
 	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
+		if (Convert::hasKernSlurStart(*this)) {
 			return true;
 		}
 	}
@@ -34958,7 +41816,7 @@ bool HumdrumToken::hasSlurStart(void) {
 
 bool HumdrumToken::hasSlurEnd(void) {
 	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
+		if (Convert::hasKernSlurEnd(*this)) {
 			return true;
 		}
 	}
@@ -35174,7 +42032,7 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
 	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
+		if (Convert::isKernSecondaryTiedNote(*this)) {
 			return true;
 		}
 	}
@@ -35460,7 +42318,7 @@ bool HumdrumToken::isAddInterpretation(void) const {
 //
 
 bool HumdrumToken::isNull(void) const {
-	const string& tok = (string)(*this);
+	const string& tok = *this;
 	if (tok == NULL_DATA)           { return true; }
 	if (tok == NULL_INTERPRETATION) { return true; }
 	if (tok == NULL_COMMENT_LOCAL)  { return true; }
@@ -35618,6 +42476,28 @@ std::vector<std::string> HumdrumToken::getSubtokens (const std::string& separato
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getSubtokenView -- Return a view of the subtokens in the
+//     token which can be iterated without allocating strings.  Subtokens
+//     separated by spaces include the **kern record of each note:
+//
+//        for (auto& note : token->getSubtokenView()) {
+//           if (note.isNote()) {
+//              int b40 = note.getBase40();
+//              ...
+//           }
+//        }
+//
+//     default value: separator = " "
+//
+
+HumSubtokenView HumdrumToken::getSubtokenView(const string& separator) const {
+	return HumSubtokenView(*this, separator);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::replaceSubtoken --
@@ -35732,23 +42612,24 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 		// will also be suppressed by this if statement.
 		return -1;
 	}
-	for (int i=0; i<(int)m_linkedParameterTokens.size(); i++) {
-		if (m_linkedParameterTokens[i] == token) {
+	vector<HTp>& linkedParameterTokens = getColdData().m_linkedParameterTokens;
+	for (int i=0; i<(int)linkedParameterTokens.size(); i++) {
+		if (linkedParameterTokens[i] == token) {
 			return i;
 		}
 	}
 
-	if (m_linkedParameterTokens.empty()) {
-		m_linkedParameterTokens.push_back(token);
+	if (linkedParameterTokens.empty()) {
+		linkedParameterTokens.push_back(token);
 	} else {
 		int lineindex = token->getLineIndex();
-		if (lineindex >= m_linkedParameterTokens.back()->getLineIndex()) {
-			m_linkedParameterTokens.push_back(token);
+		if (lineindex >= linkedParameterTokens.back()->getLineIndex()) {
+			linkedParameterTokens.push_back(token);
 		} else {
 			// Store sorted by line number
-			for (auto it = m_linkedParameterTokens.begin(); it != m_linkedParameterTokens.end(); it++) {
+			for (auto it = linkedParameterTokens.begin(); it != linkedParameterTokens.end(); it++) {
 				if (lineindex < (*it)->getLineIndex()) {
-					m_linkedParameterTokens.insert(it, token);
+					linkedParameterTokens.insert(it, token);
 					break;
 				}
 			}
@@ -35756,7 +42637,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 
 	}
 
-	return (int)m_linkedParameterTokens.size() - 1;
+	return (int)linkedParameterTokens.size() - 1;
 }
 
 
@@ -35767,7 +42648,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
-	return m_linkedParameterTokens.at(index)->isCommentGlobal();
+	return getLinkedParameterToken(index)->isCommentGlobal();
 }
 
 
@@ -35778,7 +42659,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
-	return (int)m_linkedParameterTokens.size();
+	return m_cold ? (int)m_cold->m_linkedParameterTokens.size() : 0;
 }
 
 
@@ -35789,7 +42670,7 @@ int HumdrumToken::getLinkedParameterSetCount(void) {
 //
 
 HumParamSet* HumdrumToken::getParameterSet(void) {
-	return m_parameterSet;
+	return m_cold ? m_cold->m_parameterSet : NULL;
 }
 
 
@@ -35800,7 +42681,22 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
-	return m_linkedParameterTokens.at(index)->getParameterSet();
+	return getLinkedParameterToken(index)->getParameterSet();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getLinkedParameterToken -- Return the token containing
+//     the given linked parameter.
+//
+
+HTp HumdrumToken::getLinkedParameterToken(int index) {
+	if (!m_cold) {
+		throw out_of_range("HumdrumToken::getLinkedParameterToken: no linked parameters");
+	}
+	return m_cold->m_linkedParameterTokens.at(index);
 }
 
 
@@ -35812,14 +42708,14 @@ HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
 //
 
 void HumdrumToken::storeParameterSet(void) {
-	if (m_parameterSet) {
-		delete m_parameterSet;
-		m_parameterSet = NULL;
+	if (m_cold && m_cold->m_parameterSet) {
+		delete m_cold->m_parameterSet;
+		m_cold->m_parameterSet = NULL;
 	}
 	if (this->isCommentLocal() && (this->find(':') != string::npos)) {
-		m_parameterSet = new HumParamSet(this);
+		getColdData().m_parameterSet = new HumParamSet(this);
 	} else if (this->isCommentGlobal() && (this->find(':') != string::npos)) {
-		m_parameterSet = new HumParamSet(this);
+		getColdData().m_parameterSet = new HumParamSet(this);
 	}
 }
 
@@ -35841,7 +42737,9 @@ void HumdrumToken::clearLinkInfo(void) {
 	// }
 
 	// also clear linked parameters
-	m_linkedParameterTokens.clear();
+	if (m_cold) {
+		m_cold->m_linkedParameterTokens.clear();
+	}
 
 	// clear pointers to adjacent tokens
 	m_nextTokens.clear();
@@ -36346,7 +43244,10 @@ int  HumdrumToken::getStrandIndex(void) const {
 
 int HumdrumToken::getBeamStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernBeamStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernBeamStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36364,7 +43265,10 @@ int HumdrumToken::getBeamStartElisionLevel(int index) const {
 
 int HumdrumToken::getSlurStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernSlurStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernSlurStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36382,7 +43286,10 @@ int HumdrumToken::getSlurStartElisionLevel(int index) const {
 
 int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernPhraseStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernPhraseStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36400,7 +43307,10 @@ int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 
 int HumdrumToken::getBeamEndElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernBeamEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernBeamEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36418,7 +43328,10 @@ int HumdrumToken::getBeamEndElisionLevel(int index) const {
 
 int HumdrumToken::getSlurEndElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernSlurEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernSlurEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36436,7 +43349,10 @@ int HumdrumToken::getSlurEndElisionLevel(int index) const {
 
 int HumdrumToken::getPhraseEndElisionLevel(int index) const {
 	if (isDataType("**kern")) {
-		return Convert::getKernPhraseEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernPhraseEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -36444,6 +43360,34 @@ int HumdrumToken::getPhraseEndElisionLevel(int index) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getKernInfo -- Return the lexed **kern information for
+//    the token (chord note records, and slur, phrase and beam markers).
+//    The token is lexed each time this function is called, so analyses
+//    that read many tokens should instead reuse one HumKernToken and call
+//    HumKernToken::lex() for each token.
+//
+
+HumKernToken HumdrumToken::getKernInfo(void) const {
+	return HumKernToken(*this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNote -- Return the lexed **kern record for a
+//    chord note in the token.
+//    Default value: index = 0
+//
+
+HumKernNote HumdrumToken::getKernNote(int index) const {
+	return getKernInfo().getNote(index);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::setStrandIndex -- Sets the 1-D strand index
@@ -36572,14 +43516,141 @@ ostream& HumdrumToken::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::printJson -- Write the token as a JSON object.  The
+//    fields bitmask selects optional content (see HumJsonWriter::FIELD_*).
+//    IDs are the same as the XML IDs, using the prefix stored in the
+//    writer.
+//
+
+void HumdrumToken::printJson(HumJsonWriter& json, int fields) {
+	int line = getLineIndex();
+	json.beginObject();
+
+	json.writeKey("n");
+	json.writeInt(getFieldIndex());
+	json.writeKey("id");
+	json.writeTokenId(line, getFieldIndex());
+	json.writeKey("track");
+	json.writeInt(getTrack());
+	if (getSubtrack() > 0) {
+		json.writeKey("subtrack");
+		json.writeInt(getSubtrack());
+	}
+	json.writeKey("text");
+	json.writeString(*this);
+
+	json.writeKey("type");
+	if (isNull()) {
+		json.writeString("null");
+	} else if (isManipulator()) {
+		json.writeString("manipulator");
+	} else if (isCommentLocal()) {
+		json.writeString("local-comment");
+	} else if (isBarline()) {
+		json.writeString("barline");
+	} else if (isData()) {
+		json.writeString("data");
+	} else {
+		json.writeString("interpretation");
+	}
+
+	if (fields & HumJsonWriter::FIELD_RHYTHM) {
+		if (getDuration().isNonNegative()) {
+			json.writeKey("duration");
+			json.writeNumber(getDuration());
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_STRANDS) {
+		if (getStrandIndex() >= 0) {
+			json.writeKey("strand");
+			json.writeInt(getStrandIndex());
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_LINKS) {
+		HTp tok;
+		int count = getNextTokenCount();
+		if (count > 0) {
+			json.writeKey("next");
+			json.beginArray();
+			for (int i=0; i<count; i++) {
+				tok = getNextToken(i);
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+			json.endArray();
+		}
+		count = getPreviousTokenCount();
+		if (count > 0) {
+			json.writeKey("previous");
+			json.beginArray();
+			for (int i=0; i<count; i++) {
+				tok = getPreviousToken(i);
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+			json.endArray();
+		}
+		if (isNull()) {
+			tok = getPreviousNonNullDataToken(0);
+			if (tok != NULL) {
+				json.writeKey("nullResolve");
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_PARAMETERS) {
+		((HumHash*)this)->printJson(json);
+
+		if (m_cold && !m_cold->m_linkedParameterTokens.empty()) {
+			json.writeKey("linkedParameters");
+			json.beginArray();
+			for (HTp tok : m_cold->m_linkedParameterTokens) {
+				HLp owner = tok->getOwner();
+				if (owner && owner->isGlobalComment()) {
+					json.writeLineId(owner->getLineIndex());
+				} else {
+					json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+				}
+			}
+			json.endArray();
+		}
+
+		HumParamSet* parameterSet = getParameterSet();
+		if (parameterSet && (parameterSet->getCount() > 0)) {
+			json.writeKey("parameterSet");
+			json.beginObject();
+			json.writeKey("ns1");
+			json.writeString(parameterSet->getNamespace1());
+			json.writeKey("ns2");
+			json.writeString(parameterSet->getNamespace2());
+			json.writeKey("parameters");
+			json.beginObject();
+			for (int i=0; i<parameterSet->getCount(); i++) {
+				json.writeKey(parameterSet->getParameterName(i));
+				json.writeString(parameterSet->getParameterValue(i));
+			}
+			json.endObject();
+			json.endObject();
+		}
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::printXmlLinkedParameters --
 //
 
 ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const string& indent) {
-	if (m_parameterSet) {
-		m_parameterSet->printXml(out, level, indent);
+	HumParamSet* parameterSet = getParameterSet();
+	if (parameterSet) {
+		parameterSet->printXml(out, level, indent);
 	}
 	return out;
 }
@@ -36592,23 +43663,24 @@ ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const s
 //
 
 ostream& HumdrumToken::printXmlLinkedParameterInfo(ostream& out, int level, const string& indent) {
-	if (m_linkedParameterTokens.empty()) {
+	if (!m_cold || m_cold->m_linkedParameterTokens.empty()) {
 		return out;
 	}
+	vector<HTp>& linkedParameterTokens = m_cold->m_linkedParameterTokens;
 
 	out << Convert::repeatString(indent, level);
 	out << "<parameters-linked>\n";
 
 	level++;
-	for (int i=0; i<(int)m_linkedParameterTokens.size(); i++) {
+	for (int i=0; i<(int)linkedParameterTokens.size(); i++) {
 		out << Convert::repeatString(indent, level);
 		out << "<linked-parameter";
 		out << " idref=\"";
-		HLp owner = m_linkedParameterTokens[i]->getOwner();
+		HLp owner = linkedParameterTokens[i]->getOwner();
 		if (owner && owner->isGlobalComment()) {
 			out << owner->getXmlId();
 		} else {
-			out << m_linkedParameterTokens[i]->getXmlId();
+			out << linkedParameterTokens[i]->getXmlId();
 		}
 		out << "\"";
 		out << ">\n";
@@ -37016,7 +44088,7 @@ void HumdrumToken::copyStructure(HTp token) {
 //
 
 HTp HumdrumToken::getStrophe(void) {
-	return m_strophe;
+	return m_cold ? m_cold->m_strophe : NULL;
 }
 
 
@@ -37037,7 +44109,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 		clearStrophe();
 		return;
 	}
-	m_strophe = strophe;
+	getColdData().m_strophe = strophe;
 }
 
 
@@ -37049,7 +44121,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 //
 
 bool HumdrumToken::hasStrophe(void) {
-	return m_strophe ? true : false;
+	return getStrophe() ? true : false;
 }
 
 
@@ -37061,7 +44133,9 @@ bool HumdrumToken::hasStrophe(void) {
 //
 
 void HumdrumToken::clearStrophe(void) {
-	m_strophe = NULL;
+	if (m_cold) {
+		m_cold->m_strophe = NULL;
+	}
 }
 
 
@@ -37073,10 +44147,11 @@ void HumdrumToken::clearStrophe(void) {
 //
 
 int HumdrumToken::getStropheStartIndex(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return -1;
 	}
-	return m_strophe->getLineIndex();
+	return strophe->getLineIndex();
 }
 
 
@@ -37088,14 +44163,15 @@ int HumdrumToken::getStropheStartIndex(void) {
 //
 
 bool HumdrumToken::isFirstStrophe(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return true;
 	}
-	HTp toleft = m_strophe->getPreviousField();
+	HTp toleft = strophe->getPreviousField();
 	if (!toleft) {
 		return true;
 	}
-	int track = m_strophe->getTrack();
+	int track = strophe->getTrack();
 	int ltrack = toleft->getTrack();
 	return track != ltrack;
 }
@@ -37114,16 +44190,17 @@ bool HumdrumToken::isPrimaryStrophe(void) {
 //
 
 bool HumdrumToken::isStrophe(const string& label) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return false;
 	}
 	if (label.empty()) {
-		return *m_strophe == "*S/";
+		return *strophe == "*S/";
 	}
 	if (label[0] == '*') {
-		return *m_strophe == label;
+		return *strophe == label;
 	}
-	return m_strophe->substr(3) == label;
+	return strophe->substr(3) == label;
 }
 
 
@@ -37135,17 +44212,698 @@ bool HumdrumToken::isStrophe(const string& label) {
 //
 
 string HumdrumToken::getStropheLabel(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return "";
 	}
-	if (*m_strophe == "*S/") {
+	if (*strophe == "*S/") {
 		return "";
 	}
-	return m_strophe->substr(3);
+	return strophe->substr(3);
 }
 
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtoken class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtoken::getKernNote -- Return the **kern record for the subtoken.
+//    An empty record (no pitch or rhythm) is returned if the token is not
+//    **kern or the subtokens are not separated by spaces.
+//
+
+const HumKernNote& HumSubtoken::getKernNote(void) const {
+	static const HumKernNote empty;
+	return m_note ? *m_note : empty;
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtoken::getMidiNoteNumber -- Return the MIDI key number of the
+//    note (the same as Convert::kernToMidiNoteNumber() for the subtoken),
+//    or -1000 if the subtoken does not have a pitch.
+//
+
+int HumSubtoken::getMidiNoteNumber(void) const {
+	const HumKernNote& note = getKernNote();
+	if (!note.hasPitch()) {
+		return -1000;
+	}
+	static const int pcs[7] = {0, 2, 4, 5, 7, 9, 11};
+	return pcs[note.getDiatonicPC()] + note.getAccidentalCount()
+			+ 12 * (note.getOctave() + 1);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtokenView class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtokenView::HumSubtokenView -- The number of subtokens is the same
+//     as HumdrumToken::getSubtokenCount().  An empty separator gives one
+//     subtoken for each character, as in HumdrumToken::getSubtoken().
+//     Only **kern tokens separated by spaces are lexed for their notes.
+//     default value: separator = " "
+//
+
+HumSubtokenView::HumSubtokenView(const HumdrumToken& token,
+		const string& separator) {
+	m_text = std::string_view(token);
+	m_separator = separator;
+	if ((separator == " ") && token.isKern()) {
+		m_kern.lex(token);
+		m_kernQ = true;
+		m_size = m_kern.getNoteCount();
+	} else if (separator.empty()) {
+		m_size = (int)m_text.size();
+	} else {
+		m_size = 1;
+		size_t start = 0;
+		while ((start = m_text.find(m_separator, start)) != std::string_view::npos) {
+			m_size++;
+			start += m_separator.size();
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::operator[] -- Return a subtoken by index.  An empty
+//     subtoken is returned if the index is out of range.
+//
+
+HumSubtoken HumSubtokenView::operator[](int index) const {
+	if ((index < 0) || (index >= m_size)) {
+		HumSubtoken output;
+		output.m_index = index;
+		return output;
+	}
+	if (m_kernQ) {
+		return *iterator(this, index);
+	}
+	iterator it = begin();
+	for (int i=0; i<index; i++) {
+		++it;
+	}
+	return *it;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtokenView::iterator class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::iterator -- Only the first subtoken and
+//     the end position (index == size) can be accessed directly for
+//     separators other than spaces.
+//
+
+HumSubtokenView::iterator::iterator(const HumSubtokenView* view, int index) {
+	m_view = view;
+	m_current.m_index = index;
+	if (index < view->m_size) {
+		load(0);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::operator++ -- Move to the next subtoken.
+//
+
+HumSubtokenView::iterator& HumSubtokenView::iterator::operator++(void) {
+	int start = m_current.m_start + (int)m_current.m_text.size()
+			+ (int)m_view->m_separator.size();
+	m_current.m_index++;
+	if (m_current.m_index < m_view->m_size) {
+		load(start);
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::load -- Set the text of the current subtoken,
+//     which starts at the given position in the token (ignored for
+//     space-separated subtokens, which are read from the **kern record).
+//
+
+void HumSubtokenView::iterator::load(int start) {
+	const std::string_view& text = m_view->m_text;
+	if (m_view->m_kernQ) {
+		m_current.m_note  = &m_view->m_kern.getNote(m_current.m_index);
+		m_current.m_start = m_current.m_note->getStart();
+		m_current.m_text  = text.substr(m_current.m_start, m_current.m_note->getLength());
+	} else if (m_view->m_separator.empty()) {
+		m_current.m_start = m_current.m_index;
+		m_current.m_text  = text.substr(m_current.m_start, 1);
+	} else {
+		size_t loc = text.find(m_view->m_separator, start);
+		if (loc == std::string_view::npos) {
+			loc = text.size();
+		}
+		m_current.m_start = start;
+		m_current.m_text  = text.substr(start, loc - start);
+	}
+}
+
+
+
+
+
+//////////////////////////////
+//
+// Key profiles for C major and C minor.
+//
+
+// Bret Aarden: Essen Folksong Collection
+static const double keyestimator_aardenMajor[12] = {
+	17.7661, 0.145624, 14.9265, 0.160186, 19.8049, 11.3587,
+	0.291248, 22.062, 0.145624, 8.15494, 0.232998, 4.95122
+};
+static const double keyestimator_aardenMinor[12] = {
+	18.2648, 0.737619, 14.0499, 16.8599, 0.702494, 14.4362,
+	0.702494, 18.6161, 4.56621, 1.93186, 7.37619, 1.75623
+};
+
+// Helen Bellman and Helen Budge
+static const double keyestimator_bellmanMajor[12] = {
+	16.80, 0.86, 12.95, 1.41, 13.49, 11.93,
+	1.25, 20.28, 1.80, 8.04, 0.62, 10.57
+};
+static const double keyestimator_bellmanMinor[12] = {
+	18.16, 0.69, 12.99, 13.34, 1.07, 11.15,
+	1.38, 21.07, 7.49, 1.53, 0.92, 10.21
+};
+
+// Carol Krumhansl and Edward Kessler
+static const double keyestimator_krumhanslMajor[12] = {
+	6.35, 2.23, 3.48, 2.33, 4.38, 4.09,
+	2.52, 5.19, 2.39, 3.66, 2.29, 2.88
+};
+static const double keyestimator_krumhanslMinor[12] = {
+	6.33, 2.68, 3.52, 5.38, 2.60, 3.53,
+	2.54, 4.75, 3.98, 2.69, 3.34, 3.17
+};
+
+// David Temperley: Kostka-Payne corpus (Music and Probability 2006)
+static const double keyestimator_temperleyMajor[12] = {
+	0.748, 0.060, 0.488, 0.082, 0.670, 0.460,
+	0.096, 0.715, 0.104, 0.366, 0.057, 0.400
+};
+static const double keyestimator_temperleyMinor[12] = {
+	0.712, 0.084, 0.474, 0.618, 0.049, 0.460,
+	0.105, 0.747, 0.404, 0.067, 0.133, 0.330
+};
+
+// Craig Sapp: simple weights
+static const double keyestimator_simpleMajor[12] = {
+	2.0, 0.0, 1.0, 0.0, 1.0, 1.0,
+	0.0, 2.0, 0.0, 1.0, 0.0, 1.0
+};
+static const double keyestimator_simpleMinor[12] = {
+	2.0, 0.0, 1.0, 1.0, 0.0, 1.0,
+	0.0, 2.0, 1.0, 0.0, 0.5, 0.5
+};
+
+// Default base-40 spelling of the tonic for each major and minor key:
+static const int keyestimator_majorTonics[12] = {
+	2, 7, 8, 13, 14, 19, 20, 25, 30, 31, 36, 37
+};
+static const int keyestimator_minorTonics[12] = {
+	2, 3, 8, 13, 14, 19, 20, 25, 26, 31, 36, 37
+};
+
+static const int keyestimator_b7ToB12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+static const int keyestimator_b7ToB40[7] = { 2, 8, 14, 19, 25, 31, 37 };
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::KeyEstimator --
+//
+
+KeyEstimator::KeyEstimator(void) {
+	setProfile("aarden");
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::clear -- Remove the analysis of the previous score.  The
+//    profile and window settings are not changed.
+//
+
+void KeyEstimator::clear(void) {
+	m_slices.clear();
+	m_times.clear();
+	m_durations.clear();
+	m_noteStart.clear();
+	m_notes.clear();
+	m_scoreDuration = 0;
+	m_globalKey = -1;
+	m_globalCorrelation = 0.0;
+	m_globalName.clear();
+	m_keys.clear();
+	m_correlations.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::setProfile -- Choose the key profiles used for
+//    correlation: "aarden" (default), "bellman", "krumhansl",
+//    "temperley" or "simple".  Returns false if the name is not known,
+//    in which case the profile is not changed.
+//
+
+bool KeyEstimator::setProfile(const string& name) {
+	if (name == "aarden") {
+		prepareWeights(keyestimator_aardenMajor, keyestimator_aardenMinor);
+	} else if (name == "bellman") {
+		prepareWeights(keyestimator_bellmanMajor, keyestimator_bellmanMinor);
+	} else if (name == "krumhansl") {
+		prepareWeights(keyestimator_krumhanslMajor, keyestimator_krumhanslMinor);
+	} else if (name == "temperley") {
+		prepareWeights(keyestimator_temperleyMajor, keyestimator_temperleyMinor);
+	} else if (name == "simple") {
+		prepareWeights(keyestimator_simpleMajor, keyestimator_simpleMinor);
+	} else {
+		return false;
+	}
+	m_profile = name;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::prepareWeights -- Rotate the C major and C minor
+//    profiles to all tonics, then center each one on zero and scale it
+//    to unit length.  The Pearson correlation of a histogram with a key
+//    is then the dot product of the centered histogram with the key
+//    weights, divided by the length of the centered histogram.
+//
+
+void KeyEstimator::prepareWeights(const double* major, const double* minor) {
+	for (int mode=0; mode<2; mode++) {
+		const double* profile = mode ? minor : major;
+		double mean = 0.0;
+		for (int i=0; i<12; i++) {
+			mean += profile[i];
+		}
+		mean /= 12.0;
+		double length = 0.0;
+		for (int i=0; i<12; i++) {
+			length += (profile[i] - mean) * (profile[i] - mean);
+		}
+		length = sqrt(length);
+		for (int tonic=0; tonic<12; tonic++) {
+			double* weights = m_weights[mode * 12 + tonic];
+			for (int pc=0; pc<12; pc++) {
+				weights[pc] = (profile[(pc - tonic + 12) % 12] - mean) / length;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::correlate -- Calculate the correlation of the histogram
+//    with all 24 keys.  The correlations array must have 24 elements.
+//    All correlations are zero if the histogram is empty or flat.
+//
+
+void KeyEstimator::correlate(double* correlations,
+		const PitchClassHistogram& histogram) const {
+	double centered[12];
+	double mean = 0.0;
+	for (int i=0; i<12; i++) {
+		centered[i] = histogram.getBase12(i);
+		mean += centered[i];
+	}
+	mean /= 12.0;
+	double length = 0.0;
+	for (int i=0; i<12; i++) {
+		centered[i] -= mean;
+		length += centered[i] * centered[i];
+	}
+	if (length <= 0.0) {
+		fill(correlations, correlations + 24, 0.0);
+		return;
+	}
+	length = sqrt(length);
+	for (int k=0; k<24; k++) {
+		const double* weights = m_weights[k];
+		double sum = 0.0;
+		for (int i=0; i<12; i++) {
+			sum += weights[i] * centered[i];
+		}
+		correlations[k] = sum / length;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getBestKey -- Return the key with the highest correlation
+//    to the histogram, or -1 if the histogram is empty.
+//
+
+int KeyEstimator::getBestKey(const PitchClassHistogram& histogram,
+		double& correlation) const {
+	correlation = 0.0;
+	if (histogram.getTotal() <= 1.0e-9) {
+		return -1;
+	}
+	double correlations[24];
+	correlate(correlations, histogram);
+	int best = 0;
+	for (int k=1; k<24; k++) {
+		if (correlations[k] > correlations[best]) {
+			best = k;
+		}
+	}
+	correlation = correlations[best];
+	return best;
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::spellKey -- Return the **kern name of the tonic of a key,
+//    such as "E-" for E-flat major or "g#" for G-sharp minor.  Enharmonic
+//    tonics are spelled by the base-40 bins of the histogram, so that a
+//    score in C-sharp major is not called D-flat major.
+//
+
+string KeyEstimator::spellKey(int key, const PitchClassHistogram& histogram) {
+	if (key < 0) {
+		return "";
+	}
+	bool minor = isMinor(key);
+	int tonic = getTonic(key);
+	int best = minor ? keyestimator_minorTonics[tonic] : keyestimator_majorTonics[tonic];
+	for (int b7=0; b7<7; b7++) {
+		for (int acc=-1; acc<=1; acc++) {
+			if ((keyestimator_b7ToB12[b7] + acc + 12) % 12 != tonic) {
+				continue;
+			}
+			int pc40 = keyestimator_b7ToB40[b7] + acc;
+			if (histogram.getBase40(pc40) > histogram.getBase40(best)) {
+				best = pc40;
+			}
+		}
+	}
+	// Minor keys are lower case (octave 4), major keys upper case (octave 3):
+	return Convert::base40ToKern(best + (minor ? 4 : 3) * 40);
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::analyze -- Estimate the global key of the score and the
+//    local key at each line.  For each data line, the pitch-class
+//    histogram of all slices starting within half of the window
+//    duration before or after the line is correlated with the key
+//    profiles.  The window histogram is updated by adding the slices
+//    that enter the window and subtracting the ones that leave it, so
+//    each slice is only visited twice.  Local key regions shorter than
+//    the minimum duration are merged with the previous region.  A
+//    window duration of zero or less gives the global key to all lines.
+//
+
+void KeyEstimator::analyze(HumdrumFile& infile) {
+	clear();
+	getSliceNotes(infile);
+	int lineCount = infile.getLineCount();
+	int sliceCount = (int)m_slices.size();
+
+	PitchClassHistogram total;
+	for (int i=0; i<sliceCount; i++) {
+		for (int j=m_noteStart[i]; j<m_noteStart[i+1]; j++) {
+			total.addBase40(m_notes[j], m_durations[i]);
+		}
+	}
+	m_globalKey = getBestKey(total, m_globalCorrelation);
+	m_globalName = spellKey(m_globalKey, total);
+
+	vector<int> keys(sliceCount, m_globalKey);
+	vector<double> correlations(sliceCount, m_globalCorrelation);
+
+	if ((m_window > 0) && (sliceCount > 0)) {
+		HumNum half = m_window / 2;
+		PitchClassHistogram window;
+		int lo = 0;
+		int hi = 0;
+		for (int i=0; i<sliceCount; i++) {
+			while ((hi < sliceCount) && (m_times[hi] < m_times[i] + half)) {
+				for (int j=m_noteStart[hi]; j<m_noteStart[hi+1]; j++) {
+					window.addBase40(m_notes[j], m_durations[hi]);
+				}
+				hi++;
+			}
+			while ((lo < hi) && (m_times[lo] < m_times[i] - half)) {
+				for (int j=m_noteStart[lo]; j<m_noteStart[lo+1]; j++) {
+					window.addBase40(m_notes[j], -m_durations[lo]);
+				}
+				lo++;
+			}
+			keys[i] = getBestKey(window, correlations[i]);
+		}
+		smoothKeys(keys);
+	}
+
+	// Spell each key region from the notes in the region:
+	vector<string> names(sliceCount);
+	int start = 0;
+	while (start < sliceCount) {
+		int end = start + 1;
+		while ((end < sliceCount) && (keys[end] == keys[start])) {
+			end++;
+		}
+		PitchClassHistogram region;
+		for (int i=start; i<end; i++) {
+			for (int j=m_noteStart[i]; j<m_noteStart[i+1]; j++) {
+				region.addBase40(m_notes[j], m_durations[i]);
+			}
+		}
+		string name = spellKey(keys[start], region);
+		for (int i=start; i<end; i++) {
+			names[i] = name;
+		}
+		start = end;
+	}
+
+	// Store the results for each line: lines between slices get the key
+	// of the previous slice, and lines before the first slice the key of
+	// the first slice.
+	m_keys.assign(lineCount, -1);
+	m_correlations.assign(lineCount, 0.0);
+	m_names.assign(lineCount, "");
+	int slice = 0;
+	for (int i=0; i<lineCount; i++) {
+		while ((slice + 1 < sliceCount) && (m_slices[slice + 1] <= i)) {
+			slice++;
+		}
+		if (sliceCount == 0) {
+			break;
+		}
+		m_keys[i] = keys[slice];
+		m_correlations[i] = correlations[slice];
+		m_names[i] = names[slice];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getSliceNotes -- Store the pitches sounding in each
+//    data line (including notes sustained from previous lines), and
+//    the start time and duration of the line.  Lines with no duration
+//    (grace notes) are skipped.
+//
+
+void KeyEstimator::getSliceNotes(HumdrumFile& infile) {
+	m_scoreDuration = infile.getScoreDuration();
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			continue;
+		}
+		HumNum duration = infile[i].getDuration();
+		if (duration <= 0) {
+			continue;
+		}
+		m_slices.push_back(i);
+		m_times.push_back(infile[i].getDurationFromStart());
+		m_durations.push_back(duration.getFloat());
+		m_noteStart.push_back((int)m_notes.size());
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			if (token->isNull()) {
+				token = token->resolveNull();
+				if ((token == NULL) || token->isNull()) {
+					continue;
+				}
+			}
+			if (token->isRest()) {
+				continue;
+			}
+			int count = token->getSubtokenCount();
+			for (int k=0; k<count; k++) {
+				int base40 = Convert::kernToBase40(token->getSubtoken(k));
+				if (base40 < 0) {
+					continue;
+				}
+				m_notes.push_back(base40);
+			}
+		}
+	}
+	m_noteStart.push_back((int)m_notes.size());
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::smoothKeys -- Merge key regions shorter than the minimum
+//    duration into the previous region (or the next region if there is
+//    no previous one).  Slices with no key (empty windows) are given the
+//    key of the surrounding slices.
+//
+
+void KeyEstimator::smoothKeys(vector<int>& keys) {
+	int count = (int)keys.size();
+	for (int i=1; i<count; i++) {
+		if (keys[i] < 0) {
+			keys[i] = keys[i-1];
+		}
+	}
+	for (int i=count-2; i>=0; i--) {
+		if (keys[i] < 0) {
+			keys[i] = keys[i+1];
+		}
+	}
+
+	HumNum minimum = m_minimum;
+	if (minimum < 0) {
+		minimum = m_window / 2;
+	}
+	if (minimum <= 0) {
+		return;
+	}
+
+	int start = 0;
+	while (start < count) {
+		int end = start + 1;
+		while ((end < count) && (keys[end] == keys[start])) {
+			end++;
+		}
+		HumNum endtime = end < count ? m_times[end] : m_scoreDuration;
+		if (endtime - m_times[start] < minimum) {
+			int newkey = -1;
+			if (start > 0) {
+				newkey = keys[start - 1];
+			} else if (end < count) {
+				newkey = keys[end];
+			}
+			if (newkey >= 0) {
+				for (int i=start; i<end; i++) {
+					keys[i] = newkey;
+				}
+				// check again from the start of the merged region:
+				while ((start > 0) && (keys[start - 1] == newkey)) {
+					start--;
+				}
+				continue;
+			}
+		}
+		start = end;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getKeyChanges -- Return the line indexes of the data lines
+//    where the local key changes (not including the first key).
+//
+
+void KeyEstimator::getKeyChanges(vector<int>& lines) const {
+	lines.clear();
+	for (int i=1; i<(int)m_slices.size(); i++) {
+		int line = m_slices[i];
+		if (m_keys[line] != m_keys[m_slices[i-1]]) {
+			lines.push_back(line);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getKeyDesignation -- Return the local key at the line as
+//    a key designation interpretation, such as "*E-:", or an empty string
+//    if the key is not known.
+//
+
+string KeyEstimator::getKeyDesignation(int line) const {
+	return makeDesignation(m_names.at(line));
+}
+
+
+string KeyEstimator::getGlobalKeyDesignation(void) const {
+	return makeDesignation(m_globalName);
+}
+
+
+string KeyEstimator::makeDesignation(const string& name) {
+	if (name.empty()) {
+		return "";
+	}
+	return "*" + name + ":";
+}
+
+
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -45501,7 +53259,7 @@ char& MuseRecordBasic::getColumn(int columnNumber) {
 		cerr << "Error trying to access column: " << columnNumber  << endl;
 		cerr << "CURRENT DATA: ===============================" << endl;
 		cerr << (*this);
-		static char x = ' ';
+		static thread_local char x = ' ';
 		return x;
 	} else if (realindex >= (int)m_recordString.size()) {
 		m_recordString.resize(realindex+1);
@@ -46476,8 +54234,6 @@ ostream& operator<<(ostream& out, MuseRecordBasic* aRecord) {
 class MxmlMeasure;
 class MxmlPart;
 
-int MxmlEvent::m_counter = 0;
-
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -46489,7 +54245,7 @@ int MxmlEvent::m_counter = 0;
 MxmlEvent::MxmlEvent(MxmlMeasure* measure) {
 	clear();
 	m_owner = measure;
-	m_sequence = m_counter++;
+	m_sequence = getNextSequenceNumber();
 	m_stems = false;
 }
 
@@ -46558,8 +54314,7 @@ void MxmlEvent::makeDummyRest(MxmlMeasure* owner, HumNum starttime,
 	// m_node remains null
 	// m_links remains empty
 	m_linked = false;
-	m_sequence = -m_counter;
-	m_counter++;
+	m_sequence = -getNextSequenceNumber();
 	m_voice = 1;  // don't know what the original voice number is
 	m_voiceindex = voiceindex;
 	m_staff = staffindex + 1;
@@ -47262,6 +55017,27 @@ int MxmlEvent::getSequenceNumber(void) const {
 
 
 
+//////////////////////////////
+//
+// MxmlEvent::getNextSequenceNumber -- Return the next unused event
+//     sequence number of the part which owns the event (or 0 if the event
+//     is not in a part).  The numbers are kept in the part rather than in
+//     a global counter so that separate scores can be parsed in parallel.
+//
+
+int MxmlEvent::getNextSequenceNumber(void) {
+	if (!m_owner) {
+		return 0;
+	}
+	MxmlPart* part = m_owner->getOwner();
+	if (!part) {
+		return 0;
+	}
+	return part->m_eventcount++;
+}
+
+
+
 //////////////////////////////
 //
 // MxmlEvent::getVoiceNumber -- Return the voice number of the event.
@@ -47366,8 +55142,9 @@ bool MxmlEvent::isInvisible(void) {
 int MxmlEvent::getStaffIndex(void) const {
 	if (m_staff > 0) {
 		vector<pair<int, int>> mapping = getOwner()->getOwner()->getVoiceMapping();
-		if (getVoiceNumber() < (int)mapping.size()) {
-			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[getVoiceNumber()];
+		int voicenumber = getVoiceNumber();
+		if ((voicenumber >= 0) && (voicenumber < (int)mapping.size())) {
+			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[voicenumber];
 			if (m_staff - 1 != mappingStaffIndex) {
 				return mappingStaffIndex;
 			}
@@ -47399,8 +55176,9 @@ int MxmlEvent::getStaffIndex(void) const {
 int MxmlEvent::getCrossStaffOffset(void) const {
 	if (m_staff > 0) {
 		vector<pair<int, int>> mapping = getOwner()->getOwner()->getVoiceMapping();
-		if (getVoiceNumber() < (int)mapping.size()) {
-			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[getVoiceNumber()];
+		int voicenumber = getVoiceNumber();
+		if ((voicenumber >= 0) && (voicenumber < (int)mapping.size())) {
+			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[voicenumber];
 			return m_staff - 1 - mappingStaffIndex;
 		}
 	}
@@ -49614,6 +57392,7 @@ void MxmlPart::clear(void) {
 	m_verseCount.resize(0);
 	m_harmonyCount = 0;
 	m_editorialAccidental = false;
+	m_eventcount = 0;
 }
 
 
@@ -51352,14 +59131,8 @@ double NoteGrid::getMetricLevel(int sindex) {
 	if ((getSliceCount() == 0) || (getVoiceCount() == 0)) {
 		return NAN;
 	}
-	if (m_metriclevels.empty()) {
-		int track = 0;
-		if ((getVoiceCount() > 0) && (getSliceCount() > 0)) {
-			track = cell(0, 0)->getToken()->getTrack();
-		}
-		m_infile->getMetricLevels(m_metriclevels, track, NAN);
-	}
-	return m_metriclevels[sindex];
+	int track = cell(0, 0)->getToken()->getTrack();
+	return m_infile->getMetricLevel(sindex, track);
 }
 
 
@@ -51683,6 +59456,174 @@ ostream& Option_register::print(ostream& out) {
 
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// OptionSchema class function definitions.
+//
+
+
+//////////////////////////////
+//
+// OptionSchema::getEmpty -- Return the schema with no definitions, which
+//     is the starting point for all other schemas.
+//
+
+std::shared_ptr<const OptionSchema> OptionSchema::getEmpty(void) {
+	static const std::shared_ptr<const OptionSchema> empty = std::make_shared<OptionSchema>();
+	return empty;
+}
+
+
+
+//////////////////////////////
+//
+// OptionSchema::getIndex -- Return the entry index for an option name
+//     or alias, or -1 if the name is not defined.
+//
+
+int OptionSchema::getIndex(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// OptionSchema::extend -- Return the schema with the given definition
+//     added after the definitions in this one.  Option definitions have
+//     this sructure:
+//        option-name|alias-name1|alias-name2=option-type:option-default
+// option-name :: name of the option (one or more character, not including
+//      spaces or equal signs.
+// alias-name  :: equivalent name(s) of the option.
+// option-type :: single charater indicating the option data type.
+// option-default :: default value for option if no given on the command-line.
+//
+// The new schema is stored, so adding the same definition and description
+// again returns the same schema without parsing the definition.  After
+// OPTION_MAX_SCHEMAS schemas have been stored, new schemas are returned
+// without being stored.  If the definition is invalid, NULL is returned
+// and the error message is placed in the error string.
+//
+
+std::shared_ptr<const OptionSchema> OptionSchema::extend(const string& definition,
+		const string& description, string& error) const {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto range = m_extensions.equal_range(definition);
+		for (auto it = range.first; it != range.second; it++) {
+			if (it->second->m_entries.back()->m_description == description) {
+				return it->second;
+			}
+		}
+	}
+
+	stringstream err;
+
+	// Error if definition string doesn't contain an equals sign
+	auto location = definition.find("=");
+	if (location == string::npos) {
+		err << "Error: no \"=\" in option definition: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	string aliases = definition.substr(0, location);
+	string rest    = definition.substr(location+1);
+	string otype   = rest;
+	string ovalue  = "";
+
+	location = rest.find(":");
+	if (location != string::npos) {
+		otype  = rest.substr(0, location);
+		ovalue = rest.substr(location+1);
+	}
+
+	// Remove anyspaces in the option type field
+	otype.erase(remove_if(otype.begin(), otype.end(), ::isspace), otype.end());
+
+	// Option types are only a single charater (b, i, d, c or s)
+	if (otype.size() != 1) {
+		err << "Error: option type is invalid: " << otype
+			  << " in option definition: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	// Check to make sure that the type is known
+	if (otype[0] != OPTION_STRING_TYPE  &&
+		 otype[0] != OPTION_INT_TYPE     &&
+		 otype[0] != OPTION_FLOAT_TYPE   &&
+		 otype[0] != OPTION_DOUBLE_TYPE  &&
+		 otype[0] != OPTION_BOOLEAN_TYPE &&
+		 otype[0] != OPTION_CHAR_TYPE ) {
+		err << "Error: unknown option type \'" << otype[0]
+			  << "\' in defintion: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	entry->m_definition  = definition;
+	entry->m_description = description;
+	entry->m_default     = ovalue;
+	entry->m_type        = otype[0];
+
+	std::shared_ptr<OptionSchema> output = std::make_shared<OptionSchema>();
+	output->m_entries.reserve(m_entries.size() + 1);
+	output->m_entries = m_entries;
+	output->m_entries.push_back(entry);
+	output->m_names = m_names;
+	int definitionIndex = (int)m_entries.size();
+
+	// Store option aliases
+	string optionName;
+	aliases += '|';
+	for (int i=0; i<(int)aliases.size(); i++) {
+		if (::isspace(aliases[i])) {
+			continue;
+		} else if (aliases[i] == '|') {
+			int index = output->getIndex(optionName);
+			if (index >= 0) {
+				err << "Option \"" << optionName << "\" from definition:" << endl;
+				err << "\t" << definition << endl;
+				err << "is already defined in: " << endl;
+				err << "\t" << output->getEntry(index).m_definition << endl;
+				error = err.str();
+				return NULL;
+			}
+			if (optionName.size() > 0) {
+				output->m_names[optionName] = definitionIndex;
+			}
+			optionName.clear();
+		} else {
+			optionName += aliases[i];
+		}
+	}
+
+	// Store the new schema, unless another thread has just done so:
+	static std::atomic<int> storedCount(0);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto range = m_extensions.equal_range(definition);
+	for (auto it = range.first; it != range.second; it++) {
+		if (it->second->m_entries.back()->m_description == description) {
+			return it->second;
+		}
+	}
+	if (storedCount.fetch_add(1) >= OPTION_MAX_SCHEMAS) {
+		storedCount--;
+		return output;
+	}
+	m_extensions.emplace(definition, output);
+	return output;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Options class function definitions.
@@ -51707,16 +59648,12 @@ Options::Options(const Options& options) {
 	m_argv = options.m_argv;
 	m_arguments = options.m_arguments;
 	m_optionFlag = options.m_optionFlag;
-	m_optionList = options.m_optionList;
+	m_schema = options.m_schema;
+	m_values = options.m_values;
 	m_options_error_checkQ = options.m_options_error_checkQ;
 	m_processedQ = options.m_processedQ;
 	m_suppressQ = options.m_suppressQ;
 	m_optionsArgQ = options.m_optionsArgQ;
-	for (int i=0; i<(int)options.m_optionRegister.size(); i++) {
-		Option_register* orr = new Option_register(*options.m_optionRegister[i]);
-		m_optionRegister.push_back(orr);
-	}
-
 }
 
 
@@ -51744,24 +59681,13 @@ Options& Options::operator=(const Options& options) {
 	m_argv = options.m_argv;
 	m_arguments = options.m_arguments;
 	m_optionFlag = options.m_optionFlag;
-	m_optionList = options.m_optionList;
+	m_schema = options.m_schema;
+	m_values = options.m_values;
 	m_options_error_checkQ = options.m_options_error_checkQ;
 	m_processedQ = options.m_processedQ;
 	m_suppressQ = options.m_suppressQ;
 	m_optionsArgQ = options.m_optionsArgQ;
-
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		delete m_optionRegister[i];
-		m_optionRegister[i] = NULL;
-	}
-	m_optionRegister.clear();
-
-	for (int i=0; i<(int)options.m_optionRegister.size(); i++) {
-		Option_register* orr = new Option_register(*options.m_optionRegister[i]);
-		m_optionRegister.push_back(orr);
-	}
-
-	m_error.str("");
+	m_error.reset();
 	return *this;
 }
 
@@ -51791,99 +59717,27 @@ const vector<string>& Options::argv(void) const {
 
 //////////////////////////////
 //
-// Options::define -- store an option definition in the registry.  Option
-//     definitions have this sructure:
-//        option-name|alias-name1|alias-name2=option-type:option-default
-// option-name :: name of the option (one or more character, not including
-//      spaces or equal signs.
-// alias-name  :: equivalent name(s) of the option.
-// option-type :: single charater indicating the option data type.
-// option-default :: default value for option if no given on the command-line.
+// Options::define -- store an option definition in the registry.  See
+//     OptionSchema::extend() for the structure of option definitions.
+//     Returns the index of the option, or -1 if the definition is invalid.
 //
 
 int Options::define(const string& aDefinition) {
-	Option_register* definitionEntry = NULL;
-
-	// Error if definition string doesn't contain an equals sign
-	auto location = aDefinition.find("=");
-	if (location == string::npos) {
-		m_error << "Error: no \"=\" in option definition: " << aDefinition << endl;
-		return -1;
-	}
-
-	string aliases = aDefinition.substr(0, location);
-	string rest    = aDefinition.substr(location+1);
-	string otype   = rest;
-	string ovalue  = "";
-
-	location = rest.find(":");
-	if (location != string::npos) {
-		otype  = rest.substr(0, location);
-		ovalue = rest.substr(location+1);
-	}
-
-	// Remove anyspaces in the option type field
-	otype.erase(remove_if(otype.begin(), otype.end(), ::isspace), otype.end());
-
-	// Option types are only a single charater (b, i, d, c or s)
-	if (otype.size() != 1) {
-		m_error << "Error: option type is invalid: " << otype
-			  << " in option definition: " << aDefinition << endl;
-		return -1;
-	}
-
-	// Check to make sure that the type is known
-	if (otype[0] != OPTION_STRING_TYPE  &&
-		 otype[0] != OPTION_INT_TYPE     &&
-		 otype[0] != OPTION_FLOAT_TYPE   &&
-		 otype[0] != OPTION_DOUBLE_TYPE  &&
-		 otype[0] != OPTION_BOOLEAN_TYPE &&
-		 otype[0] != OPTION_CHAR_TYPE ) {
-		m_error << "Error: unknown option type \'" << otype[0]
-			  << "\' in defintion: " << aDefinition << endl;
-		return -1;
-	}
-
-	// Set up space for a option entry in the registry
-	definitionEntry = new Option_register(aDefinition, otype[0], ovalue);
-
-	int definitionIndex = (int)m_optionRegister.size();
-
-	// Store option aliases
-	string optionName;
-	aliases += '|';
-	for (int i=0; i<(int)aliases.size(); i++) {
-		if (::isspace(aliases[i])) {
-			continue;
-		} else if (aliases[i] == '|') {
-			if (isDefined(optionName)) {
-				m_error << "Option \"" << optionName << "\" from definition:" << endl;
-				m_error << "\t" << aDefinition << endl;
-				m_error << "is already defined in: " << endl;
-				m_error << "\t" << getDefinition(optionName) << endl;
-				return -1;
-			}
-			if (optionName.size() > 0) {
-				m_optionList[optionName] = definitionIndex;
-			}
-			optionName.clear();
-		} else {
-			optionName += aliases[i];
-		}
-	}
-
-	// Store definition in registry and return its indexed location.
-	// This location will be used to link option aliases to the main
-	// command name.
-	m_optionRegister.push_back(definitionEntry);
-	return definitionIndex;
+	return define(aDefinition, "");
 }
 
 
 int Options::define(const string& aDefinition, const string& aDescription) {
-	int index = define(aDefinition);
-	m_optionRegister[index]->setDescription(aDescription);
-	return index;
+	string error;
+	std::shared_ptr<const OptionSchema> schema = m_schema->extend(aDefinition,
+			aDescription, error);
+	if (!schema) {
+		getErrorStream() << error;
+		return -1;
+	}
+	m_schema = std::move(schema);
+	m_values.resize(m_schema->getSize());
+	return m_schema->getSize() - 1;
 }
 
 
@@ -51894,11 +59748,7 @@ int Options::define(const string& aDefinition, const string& aDescription) {
 //
 
 int Options::isDefined(const string& name) {
-	if (m_optionList.find(name) == m_optionList.end()) {
-		return 0;
-	} else {
-		return 1;
-	}
+	return (m_schema->getIndex(name) < 0) ? 0 : 1;
 }
 
 
@@ -51918,7 +59768,7 @@ string Options::getArg(int index) {
 		}
 	}
 	if (index < 1 || index > (int)m_arguments.size()) {
-		m_error << "Error: argument " << index << " does not exist." << endl;
+		getErrorStream() << "Error: argument " << index << " does not exist." << endl;
 		return "";
 	}
 	return m_arguments[index - 1];
@@ -51978,10 +59828,10 @@ vector<string>& Options::getArgumentList(vector<string>& output) {
 
 bool Options::getBoolean(const string& optionName) {
 	int index = getRegIndex(optionName);
-	if (index < 0) {
+	if ((index < 0) || (index >= (int)m_values.size())) {
 		return 0;
 	}
-	return m_optionRegister[index]->isModified();
+	return m_values[index].m_modifiedQ;
 }
 
 
@@ -52031,11 +59881,11 @@ string Options::getCommandLine(void) {
 //
 
 string Options::getDefinition(const string& optionName) {
-	auto it = m_optionList.find(optionName);
-	if (it == m_optionList.end()) {
+	int index = m_schema->getIndex(optionName);
+	if (index < 0) {
 		return "";
 	} else {
-		return m_optionRegister[it->second]->getDefinition();
+		return m_schema->getEntry(index).m_definition;
 	}
 }
 
@@ -52102,10 +59952,12 @@ int Options::getInteger(const string& optionName) {
 
 string Options::getString(const string& optionName) {
 	int index = getRegIndex(optionName);
-	if (index < 0) {
+	if ((index < 0) || (index >= (int)m_values.size())) {
 		return "UNKNOWN OPTION";
+	} else if (m_values[index].m_modifiedQ) {
+		return m_values[index].m_value;
 	} else {
-		return m_optionRegister[index]->getOption();
+		return m_schema->getEntry(index).m_default;
 	}
 }
 
@@ -52132,12 +59984,12 @@ ostream& Options::print(ostream& out) {
 	vector<string> declarations;
 	vector<string> descriptions;
 	int maxlen = 0;
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		declarations.push_back(m_optionRegister[i]->getDefinition());
+	for (int i=0; i<m_schema->getSize(); i++) {
+		declarations.push_back(m_schema->getEntry(i).m_definition);
 		if (maxlen < (int)declarations.back().size()) {
 			maxlen = (int)declarations.back().size();
 		}
-		descriptions.push_back(m_optionRegister[i]->getDescription());
+		descriptions.push_back(m_schema->getEntry(i).m_description);
 	}
 	int separation = 3;
 
@@ -52169,10 +60021,10 @@ ostream& Options::printEmscripten(ostream& out) {
 	out << "!!      <th>Option</th><th>Type</th><th>Default</th><th>Description</th>" << endl;
 	out << "!!   </tr>" << endl;
 	HumRegex hre;
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
+	for (int i=0; i<m_schema->getSize(); i++) {
 		out << "!!   <tr>" << endl;
-		string definition = m_optionRegister[i]->getDefinition();
-		string description = m_optionRegister[i]->getDescription();
+		string definition = m_schema->getEntry(i).m_definition;
+		string description = m_schema->getEntry(i).m_description;
 		string option = "";
 		string optionType = "";
 		string defaultValue = "";
@@ -52227,12 +60079,8 @@ ostream& Options::printEmscripten(ostream& out) {
 void Options::reset(void) {
 	m_argv.clear();
 	m_arguments.clear();
-
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		delete m_optionRegister[i];
-		m_optionRegister[i] = NULL;
-	}
-	m_optionRegister.clear();
+	m_schema = OptionSchema::getEmpty();
+	m_values.clear();
 }
 
 
@@ -52272,8 +60120,8 @@ void Options::setModified(const string& optionName, const string& aString) {
 	if (index < 0) {
 		return;
 	}
-
-	m_optionRegister[getRegIndex(optionName)]->setModified(aString);
+	m_values[index].m_value = aString;
+	m_values[index].m_modifiedQ = true;
 }
 
 
@@ -52432,7 +60280,7 @@ char Options::getType(const string& optionName) {
 	if (index < 0) {
 		return -1;
 	} else {
-		return m_optionRegister[getRegIndex(optionName)]->getType();
+		return m_schema->getEntry(index).m_type;
 	}
 }
 
@@ -52505,10 +60353,11 @@ void Options::xverify(int error_check, int suppress) {
 	while ((i < (int)m_argv.size()) && !optionend) {
 		tcount++;
 		if (tcount > terminate) {
-			m_error << "Error: missing option argument" << endl;
-			m_error << "ARGV count: " << m_argv.size()  << endl;
-			m_error << "terminate: "  << terminate      << endl;
-			m_error << "tcount: "     << tcount         << endl;
+			stringstream& error = getErrorStream();
+			error << "Error: missing option argument" << endl;
+			error << "ARGV count: " << m_argv.size()  << endl;
+			error << "terminate: "  << terminate      << endl;
+			error << "tcount: "     << tcount         << endl;
 			break;
 		}
 		if (isOption(m_argv[i], i)) {
@@ -52564,10 +60413,10 @@ int Options::getRegIndex(const string& optionName) {
 		return -1;
 	}
 
-	auto it = m_optionList.find(optionName);
-	if (it == m_optionList.end()) {
+	int index = m_schema->getIndex(optionName);
+	if (index < 0) {
 		if (m_options_error_checkQ) {
-			m_error << "Error: unknown option \"" << optionName << "\"." << endl;
+			getErrorStream() << "Error: unknown option \"" << optionName << "\"." << endl;
 			#ifndef __EMSCRIPTEN__
 				cerr << "Error: unknown option \"" << optionName << "\"." << endl;
 			#endif
@@ -52580,7 +60429,7 @@ int Options::getRegIndex(const string& optionName) {
 			return -1;
 		}
 	} else {
-		return it->second;
+		return index;
 	}
 }
 
@@ -52672,7 +60521,7 @@ int Options::storeOption(int index, int& position, int& running) {
 			}
 			if (m_argv[index][position] == '=') {
 				if (optionType == OPTION_BOOLEAN_TYPE) {
-					m_error << "Error: boolean variable cannot have any options: "
+					getErrorStream() << "Error: boolean variable cannot have any options: "
 						  << tempname << endl;
 					return -1;
 				}
@@ -52703,7 +60552,7 @@ int Options::storeOption(int index, int& position, int& running) {
 	}
 
 	if (index >= (int)m_argv.size()) {
-		m_error << "Error: last option requires a parameter" << endl;
+		getErrorStream() << "Error: last option requires a parameter" << endl;
 		return -1;
 	}
 	setModified(tempname, &m_argv[index][position]);
@@ -52718,12 +60567,16 @@ int Options::storeOption(int index, int& position, int& running) {
 
 //////////////////////////////
 //
-// Options::printOptionList --
+// Options::printOptionList -- Print the option names (sorted) with the
+//    index of their definitions.
 //
 
 ostream& Options::printOptionList(ostream& out) {
-	for (auto it = m_optionList.begin(); it != m_optionList.end(); it++) {
-		out << it->first << "\t" << it->second << endl;
+	vector<std::pair<string, int>> names(m_schema->getNames().begin(),
+			m_schema->getNames().end());
+	sort(names.begin(), names.end());
+	for (auto& name : names) {
+		out << name.first << "\t" << name.second << endl;
 	}
 	return out;
 }
@@ -52736,9 +60589,11 @@ ostream& Options::printOptionList(ostream& out) {
 //
 
 ostream& Options::printOptionListBooleanState(ostream& out) {
-	for (auto it = m_optionList.begin(); it != m_optionList.end(); it++) {
-		out << it->first << "\t"
-			 << m_optionRegister[it->second]->isModified() << endl;
+	vector<std::pair<string, int>> names(m_schema->getNames().begin(),
+			m_schema->getNames().end());
+	sort(names.begin(), names.end());
+	for (auto& name : names) {
+		out << name.first << "\t" << m_values[name.second].m_modifiedQ << endl;
 	}
 	return out;
 }
@@ -52751,8 +60606,14 @@ ostream& Options::printOptionListBooleanState(ostream& out) {
 //
 
 ostream& Options::printRegister(ostream& out) {
-	for (auto it = m_optionRegister.begin(); it != m_optionRegister.end(); it++) {
-		(*it)->print(out);
+	for (int i=0; i<m_schema->getSize(); i++) {
+		const OptionSchema::Entry& entry = m_schema->getEntry(i);
+		out << "definition:\t"     << entry.m_definition      << endl;
+		out << "description:\t"    << entry.m_description     << endl;
+		out << "defaultOption:\t"  << entry.m_default         << endl;
+		out << "modifiedOption:\t" << m_values[i].m_value     << endl;
+		out << "modifiedQ:\t\t"    << m_values[i].m_modifiedQ << endl;
+		out << "type:\t\t"         << entry.m_type            << endl;
 	}
 	return out;
 }
@@ -52766,7 +60627,7 @@ ostream& Options::printRegister(ostream& out) {
 //
 
 bool Options::hasParseError(void) {
-	return !m_error.str().empty();
+	return m_error && !m_error->str().empty();
 }
 
 
@@ -52777,13 +60638,593 @@ bool Options::hasParseError(void) {
 //
 
 string Options::getParseError(void) {
-	return m_error.str();
+	return m_error ? m_error->str() : "";
 }
 
 
 ostream& Options::getParseError(ostream& out) {
-	out << m_error.str();
-	return m_error;
+	out << getParseError();
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// Options::getErrorStream -- Return the stream for error messages,
+//    which is only allocated when there is an error.
+//
+
+stringstream& Options::getErrorStream(void) {
+	if (!m_error) {
+		m_error.reset(new stringstream);
+	}
+	return *m_error;
+}
+
+
+
+
+//////////////////////////////
+//
+// Base-40 pitch-class lookup tables (-1 = unused base-40 slot):
+//
+
+static const int histogram_b40ToB7[40] = {
+	 0,  0,  0,  0,  0, -1,
+	 1,  1,  1,  1,  1, -1,
+	 2,  2,  2,  2,  2,
+	 3,  3,  3,  3,  3, -1,
+	 4,  4,  4,  4,  4, -1,
+	 5,  5,  5,  5,  5, -1,
+	 6,  6,  6,  6,  6
+};
+
+static const int histogram_b40ToAcc[40] = {
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2
+};
+
+static const int histogram_b7ToB12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+static const int histogram_b7ToB40[7] = { 2, 8, 14, 19, 25, 31, 37 };
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::PitchClassHistogram --
+//
+
+PitchClassHistogram::PitchClassHistogram(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::clear -- Set all bins to zero.
+//
+
+void PitchClassHistogram::clear(void) {
+	fill(m_base7, m_base7 + 7, 0.0);
+	fill(m_base12, m_base12 + 12, 0.0);
+	fill(m_base40, m_base40 + 40, 0.0);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::addBase40 -- Add a weight to the bins for the
+//    given base-40 pitch.  Returns false if the pitch is a rest or an
+//    invalid base-40 value.  Pitches are allowed down to three octaves
+//    below octave 0.
+//
+
+bool PitchClassHistogram::addBase40(int base40, double weight) {
+	if (base40 < -120) {
+		return false;
+	}
+	int pc40 = (base40 + 120) % 40;
+	int pc7 = histogram_b40ToB7[pc40];
+	if (pc7 < 0) {
+		return false;
+	}
+	int pc12 = (histogram_b7ToB12[pc7] + histogram_b40ToAcc[pc40] + 12) % 12;
+	m_base7[pc7]   += weight;
+	m_base12[pc12] += weight;
+	m_base40[pc40] += weight;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::addKern -- Add a weight for the first pitch in
+//    a **kern token.
+//
+
+bool PitchClassHistogram::addKern(const string& kern, double weight) {
+	return addBase40(Convert::kernToBase40(kern), weight);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase7Vector -- Copy the diatonic pitch-class
+//    bins into a vector, such as for Convert::pearsonCorrelation().
+//
+
+vector<double> PitchClassHistogram::getBase7Vector(void) const {
+	return vector<double>(m_base7, m_base7 + 7);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase12Vector -- Copy the chromatic pitch-class
+//    bins into a vector.
+//
+
+vector<double> PitchClassHistogram::getBase12Vector(void) const {
+	return vector<double>(m_base12, m_base12 + 12);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase40Vector -- Copy the base-40 pitch-class
+//    bins into a vector.
+//
+
+vector<double> PitchClassHistogram::getBase40Vector(void) const {
+	return vector<double>(m_base40, m_base40 + 40);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getTotal -- Return the sum of all bins.
+//
+
+double PitchClassHistogram::getTotal(void) const {
+	double sum = 0.0;
+	for (int i=0; i<7; i++) {
+		sum += m_base7[i];
+	}
+	return sum;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getMaximum -- Return the largest base-40 bin.
+//
+
+double PitchClassHistogram::getMaximum(void) const {
+	return *max_element(m_base40, m_base40 + 40);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::isEmpty -- Returns true if nothing has been added.
+//
+
+bool PitchClassHistogram::isEmpty(void) const {
+	for (int i=0; i<7; i++) {
+		if (m_base7[i] != 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::operator+= -- Add the bins of another histogram.
+//
+
+PitchClassHistogram& PitchClassHistogram::operator+=(const PitchClassHistogram& other) {
+	for (int i=0; i<7; i++) {
+		m_base7[i] += other.m_base7[i];
+	}
+	for (int i=0; i<12; i++) {
+		m_base12[i] += other.m_base12[i];
+	}
+	for (int i=0; i<40; i++) {
+		m_base40[i] += other.m_base40[i];
+	}
+	return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// PitchHistogram::PitchHistogram --
+//
+
+PitchHistogram::PitchHistogram(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::clear -- Set all bins to zero.
+//
+
+void PitchHistogram::clear(void) {
+	m_pitchClasses.clear();
+	fill(m_base40, m_base40 + OCTAVES * 40, 0.0);
+	fill(m_base7, m_base7 + OCTAVES * 7, 0.0);
+	fill(m_midi, m_midi + 128, 0.0);
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::addBase40 -- Add a weight to the absolute pitch bins
+//    and to the pitch-class bins.  Returns false if the pitch is a rest,
+//    an invalid base-40 value, or outside of the storage range.
+//
+
+bool PitchHistogram::addBase40(int base40, double weight) {
+	int index = base40 - MINOCTAVE * 40;
+	if ((index < 0) || (index >= OCTAVES * 40)) {
+		return false;
+	}
+	int pc40 = index % 40;
+	int pc7 = histogram_b40ToB7[pc40];
+	if (pc7 < 0) {
+		return false;
+	}
+	int octave = index / 40;
+	int midi = (octave + MINOCTAVE + 1) * 12 + histogram_b7ToB12[pc7]
+			+ histogram_b40ToAcc[pc40];
+	m_pitchClasses.addBase40(base40, weight);
+	m_base40[index] += weight;
+	m_base7[pc7 + 7 * octave] += weight;
+	if ((midi >= 0) && (midi < 128)) {
+		m_midi[midi] += weight;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::addKern -- Add a weight for the first pitch in a
+//    **kern token.
+//
+
+bool PitchHistogram::addKern(const string& kern, double weight) {
+	return addBase40(Convert::kernToBase40(kern), weight);
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getBase40 -- Return the bin for an absolute base-40
+//    pitch (middle C = 162).
+//
+
+double PitchHistogram::getBase40(int base40) const {
+	int index = base40 - MINOCTAVE * 40;
+	if ((index < 0) || (index >= OCTAVES * 40)) {
+		return 0.0;
+	}
+	return m_base40[index];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getBase7 -- Return the bin for an absolute diatonic
+//    pitch, regardless of accidental (middle C = 28).
+//
+
+double PitchHistogram::getBase7(int base7) const {
+	int index = base7 - MINOCTAVE * 7;
+	if ((index < 0) || (index >= OCTAVES * 7)) {
+		return 0.0;
+	}
+	return m_base7[index];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getDiatonic -- Return the bin for an absolute diatonic
+//    pitch with the given chromatic alteration (-2 to +2).
+//
+
+double PitchHistogram::getDiatonic(int base7, int acc) const {
+	if ((acc < -2) || (acc > 2)) {
+		return 0.0;
+	}
+	int index = base7 - MINOCTAVE * 7;
+	if ((index < 0) || (index >= OCTAVES * 7)) {
+		return 0.0;
+	}
+	return m_base40[(index / 7) * 40 + histogram_b7ToB40[index % 7] + acc];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getMidi -- Return the bin for a MIDI key number.
+//
+
+double PitchHistogram::getMidi(int key) const {
+	if ((key < 0) || (key > 127)) {
+		return 0.0;
+	}
+	return m_midi[key];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getLowestBase40 -- Return the lowest pitch that has
+//    a non-zero bin, or -1000 if the histogram is empty.
+//
+
+int PitchHistogram::getLowestBase40(void) const {
+	for (int i=0; i<OCTAVES * 40; i++) {
+		if (m_base40[i] != 0.0) {
+			return i + MINOCTAVE * 40;
+		}
+	}
+	return -1000;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getHighestBase40 -- Return the highest pitch that has
+//    a non-zero bin, or -1000 if the histogram is empty.
+//
+
+int PitchHistogram::getHighestBase40(void) const {
+	for (int i=OCTAVES * 40 - 1; i>=0; i--) {
+		if (m_base40[i] != 0.0) {
+			return i + MINOCTAVE * 40;
+		}
+	}
+	return -1000;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::operator+= -- Add the bins of another histogram.
+//
+
+PitchHistogram& PitchHistogram::operator+=(const PitchHistogram& other) {
+	m_pitchClasses += other.m_pitchClasses;
+	for (int i=0; i<OCTAVES * 40; i++) {
+		m_base40[i] += other.m_base40[i];
+	}
+	for (int i=0; i<OCTAVES * 7; i++) {
+		m_base7[i] += other.m_base7[i];
+	}
+	for (int i=0; i<128; i++) {
+		m_midi[i] += other.m_midi[i];
+	}
+	return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// PitchProfile::PitchProfile --
+//
+
+PitchProfile::PitchProfile(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::clear -- Remove all analysis data (but keep the
+//    attack setting).
+//
+
+void PitchProfile::clear(void) {
+	m_files = 0;
+	m_range.clear();
+	m_measures.clear();
+	m_labels.clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::analyze -- Add the notes of a file to the profile.
+//    Notes are weighted by duration, or by 1 for each attack if
+//    setAttacks(true) was called.  Each measure gets its own pitch-class
+//    histogram, labeled by filename and measure number; notes before
+//    the first barline are placed in measure 0.
+//
+
+void PitchProfile::analyze(HumdrumFile& infile) {
+	string filename = infile.getFilename();
+	m_files++;
+	bool inmeasure = false;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			int barnum = infile[i].getBarNumber();
+			if (barnum < 0) {
+				continue;
+			}
+			m_measures.emplace_back();
+			m_labels.push_back(filename + ":" + to_string(barnum));
+			inmeasure = true;
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			if (token->isNull() || token->isRest()) {
+				continue;
+			}
+			int count = token->getSubtokenCount();
+			for (int k=0; k<count; k++) {
+				string subtok = token->getSubtoken(k);
+				double weight = 1.0;
+				if (m_attacks) {
+					if (subtok.find("_") != string::npos) {
+						continue;
+					}
+					if (subtok.find("]") != string::npos) {
+						continue;
+					}
+				} else {
+					weight = Convert::recipToDuration(subtok).getFloat();
+				}
+				int base40 = Convert::kernToBase40(subtok);
+				if (!m_range.addBase40(base40, weight)) {
+					continue;
+				}
+				if (!inmeasure) {
+					m_measures.emplace_back();
+					m_labels.push_back(filename + ":0");
+					inmeasure = true;
+				}
+				m_measures.back().addBase40(base40, weight);
+			}
+		}
+	}
+}
+
+
+//
+// Analyze a set of files in parallel.  Each file gets its own profile
+// and the profiles are merged in input order, so the measure list is
+// the same as when analyzing the files one at a time.  Returns the
+// number of files analyzed.
+//
+
+int PitchProfile::analyze(HumdrumFileSet& infiles, int threads) {
+	int count = infiles.getCount();
+	if (count == 0) {
+		return 0;
+	}
+
+	vector<PitchProfile> profiles(count);
+	for (int i=0; i<count; i++) {
+		profiles[i].setAttacks(m_attacks);
+	}
+
+	atomic<int> next(0);
+	auto analyzeFiles = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			profiles[index].analyze(infiles[index]);
+		}
+	};
+
+	int threadcount = min(max(threads, 1), count);
+	vector<thread> workers;
+	workers.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		workers.emplace_back(analyzeFiles);
+	}
+	analyzeFiles();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		*this += profiles[i];
+	}
+	return count;
+}
+
+
+//
+// Analyze all files in a stream, reading them in batches so that only
+// a limited number of files are in memory at a time.
+//
+
+int PitchProfile::analyze(HumdrumFileStream& instream, int threads) {
+	int batchsize = max(threads, 1) * 16;
+	int total = 0;
+	bool done = false;
+	while (!done) {
+		HumdrumFileSet infiles;
+		while (infiles.getCount() < batchsize) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (!instream.getFile(*infile)) {
+				delete infile;
+				done = true;
+				break;
+			}
+			infiles.appendHumdrumPointer(infile);
+		}
+		total += analyze(infiles, threads);
+	}
+	return total;
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::operator+= -- Merge another profile into this one.  The
+//    range and pitch-class histograms are summed, and the measures of
+//    the other profile are appended.
+//
+
+PitchProfile& PitchProfile::operator+=(const PitchProfile& other) {
+	m_files += other.m_files;
+	m_range += other.m_range;
+	m_measures.insert(m_measures.end(), other.m_measures.begin(), other.m_measures.end());
+	m_labels.insert(m_labels.end(), other.m_labels.begin(), other.m_labels.end());
+	return *this;
 }
 
 
@@ -53301,24 +61742,17 @@ PixelColor PixelColor::getColor(const string& colorstring) {
 	// check for decimal strings with spaces around numbers: "255 255 255"
 	if ((colorstring.find(' ') != string::npos) ||
 		 (colorstring.find('\t') != string::npos)) {
-		char buffer[256] = {0};
-		strcpy(buffer, colorstring.c_str());
-		char* ptr = strtok(buffer, " \t\n:;");
-		int tred   = -1;
-		int tgreen = -1;
-		int tblue  = -1;
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tred);
-			ptr = strtok(NULL, " \t\n;:");
-		}
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tgreen);
-			ptr = strtok(NULL, " \t\n;:");
-		}
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tblue);
-			ptr = strtok(NULL, " \t\n;:");
-		}
+		const char* separators = " \t\n:;";
+		int values[3] = {-1, -1, -1};
+		size_t start = colorstring.find_first_not_of(separators);
+		for (int i=0; (i<3) && (start != string::npos); i++) {
+			size_t end = colorstring.find_first_of(separators, start);
+			sscanf(colorstring.substr(start, end - start).c_str(), "%d", &values[i]);
+			start = colorstring.find_first_not_of(separators, end);
+		}
+		int tred   = values[0];
+		int tgreen = values[1];
+		int tblue  = values[2];
 		if (tred > 0 && tgreen > 0 && tblue > 0) {
 			output.setColor(tred, tgreen, tblue);
 			return output;
@@ -53905,6 +62339,415 @@ ostream& operator<<(ostream& out, PixelColor apixel) {
 
 
 
+//////////////////////////////
+//
+// PixelImage::PixelImage --
+//
+
+PixelImage::PixelImage(void) {
+	// do nothing
+}
+
+PixelImage::PixelImage(int width, int height) {
+	setSize(width, height);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::clear -- Remove all rows from the image.
+//
+
+void PixelImage::clear(void) {
+	m_width = 0;
+	m_pixels.clear();
+	m_repeats.clear();
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setSize -- Set the image to the given number of black
+//    rows, each of which is stored separately.
+//
+
+void PixelImage::setSize(int width, int height) {
+	clear();
+	if ((width <= 0) || (height <= 0)) {
+		return;
+	}
+	m_width = width;
+	m_pixels.resize((size_t)width * height * 3, 0);
+	m_repeats.resize(height, 1);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getHeight -- Return the number of rows in the image,
+//    including repeated rows.
+//
+
+int PixelImage::getHeight(void) const {
+	int output = 0;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		output += m_repeats[i];
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setRowRepeat -- Set the number of times a stored row is
+//    repeated in the image (0 to remove it from the image).
+//
+
+void PixelImage::setRowRepeat(int row, int count) {
+	m_repeats.at(row) = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getRowData -- Return the RGB bytes of a stored row.
+//
+
+unsigned char* PixelImage::getRowData(int row) {
+	return m_pixels.data() + (size_t)row * m_width * 3;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getPixel -- Return the color of a pixel in a stored row.
+//
+
+PixelColor PixelImage::getPixel(int row, int column) const {
+	const unsigned char* pixel = m_pixels.data()
+			+ ((size_t)row * m_width + column) * 3;
+	return PixelColor((int)pixel[0], (int)pixel[1], (int)pixel[2]);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setPixel -- Set the color of a pixel in a stored row.
+//
+
+void PixelImage::setPixel(int row, int column, const PixelColor& color) {
+	unsigned char* pixel = m_pixels.data() + ((size_t)row * m_width + column) * 3;
+	pixel[0] = color.Red;
+	pixel[1] = color.Green;
+	pixel[2] = color.Blue;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::addRow -- Add a row to the bottom of the image.  Each
+//    pixel is repeated hrepeat times horizontally, and the row is
+//    repeated vrepeat times vertically.  A positive shift moves the row
+//    to the right by that many pixels, repeating the first pixel and
+//    dropping pixels at the end.  The first row sets the width of the
+//    image; later rows are cut off or padded with black to fit.
+//    Returns the index of the stored row.
+//
+
+int PixelImage::addRow(const vector<PixelColor>& pixels, int hrepeat,
+		int vrepeat, int shift) {
+	if (hrepeat < 1) {
+		hrepeat = 1;
+	}
+	if (m_repeats.empty()) {
+		m_width = (int)pixels.size() * hrepeat;
+	}
+	size_t start = m_pixels.size();
+	m_pixels.resize(start + (size_t)m_width * 3, 0);
+	m_repeats.push_back(vrepeat < 0 ? 0 : vrepeat);
+	unsigned char* rowdata = m_pixels.data() + start;
+
+	int available = (int)pixels.size() * hrepeat;
+	for (int i=0; i<m_width; i++) {
+		int source = i - shift;
+		if (source < 0) {
+			source = 0;
+		}
+		if (source >= available) {
+			break;
+		}
+		const PixelColor& color = pixels[source / hrepeat];
+		rowdata[3*i]   = color.Red;
+		rowdata[3*i+1] = color.Green;
+		rowdata[3*i+2] = color.Blue;
+	}
+	return (int)m_repeats.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePpm6 -- Write the image as a binary PPM file.
+//
+
+void PixelImage::writePpm6(ostream& out) const {
+	out << "P6\n" << m_width << " " << getHeight() << "\n255\n";
+	size_t rowsize = (size_t)m_width * 3;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		const char* rowdata = (const char*)m_pixels.data() + i * rowsize;
+		for (int j=0; j<m_repeats[i]; j++) {
+			out.write(rowdata, rowsize);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePpm3 -- Write the image as an ASCII PPM file, one
+//    image row per line.
+//
+
+void PixelImage::writePpm3(ostream& out) const {
+	out << "P3\n" << m_width << " " << getHeight() << "\n255\n";
+	string line;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		if (m_repeats[i] == 0) {
+			continue;
+		}
+		line.clear();
+		const unsigned char* rowdata = m_pixels.data() + (size_t)i * m_width * 3;
+		for (int j=0; j<m_width * 3; j++) {
+			line += to_string((int)rowdata[j]);
+			line += ' ';
+		}
+		line += '\n';
+		for (int j=0; j<m_repeats[i]; j++) {
+			out << line;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// PNG encoding helper functions:
+//
+
+//
+// pixelimage_crc -- Update the CRC-32 of a PNG chunk.
+//
+
+static unsigned int pixelimage_crc(unsigned int crc, const unsigned char* data,
+		size_t length) {
+	static const vector<unsigned int> table = []() {
+		vector<unsigned int> output(256);
+		for (unsigned int n=0; n<256; n++) {
+			unsigned int c = n;
+			for (int k=0; k<8; k++) {
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			output[n] = c;
+		}
+		return output;
+	}();
+	for (size_t i=0; i<length; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+
+//
+// pixelimage_adler -- Update the Adler-32 checksum of a zlib stream.
+//
+
+static void pixelimage_adler(unsigned int& a, unsigned int& b,
+		const unsigned char* data, size_t length) {
+	while (length > 0) {
+		// 5552 bytes can be added before the sums can overflow:
+		size_t count = length < 5552 ? length : 5552;
+		for (size_t i=0; i<count; i++) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += count;
+		length -= count;
+	}
+}
+
+
+//
+// pixelimage_writeInt -- Write a four-byte big-endian integer.
+//
+
+static void pixelimage_writeInt(unsigned char* output, unsigned int value) {
+	output[0] = (unsigned char)(value >> 24);
+	output[1] = (unsigned char)(value >> 16);
+	output[2] = (unsigned char)(value >> 8);
+	output[3] = (unsigned char)value;
+}
+
+
+//
+// pixelimage_writeChunk -- Write a PNG chunk with its length and CRC.
+//
+
+static void pixelimage_writeChunk(ostream& out, const char* type,
+		const unsigned char* data, size_t length) {
+	unsigned char buffer[4];
+	pixelimage_writeInt(buffer, (unsigned int)length);
+	out.write((const char*)buffer, 4);
+	out.write(type, 4);
+	if (length > 0) {
+		out.write((const char*)data, length);
+	}
+	unsigned int crc = 0xffffffffu;
+	crc = pixelimage_crc(crc, (const unsigned char*)type, 4);
+	crc = pixelimage_crc(crc, data, length);
+	pixelimage_writeInt(buffer, crc ^ 0xffffffffu);
+	out.write((const char*)buffer, 4);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePng -- Write the image as a PNG file.  The image
+//    data is not compressed: it is written in stored deflate blocks, so
+//    no compression library is needed.  Nothing is written for an empty
+//    image, since PNG files must contain at least one pixel.
+//
+
+void PixelImage::writePng(ostream& out) const {
+	int height = getHeight();
+	if ((m_width <= 0) || (height <= 0)) {
+		return;
+	}
+
+	static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	out.write((const char*)signature, 8);
+
+	unsigned char header[13];
+	pixelimage_writeInt(header, (unsigned int)m_width);
+	pixelimage_writeInt(header + 4, (unsigned int)height);
+	header[8]  = 8;  // bits per sample
+	header[9]  = 2;  // RGB color
+	header[10] = 0;  // deflate compression
+	header[11] = 0;  // adaptive filtering (only filter type 0 is used)
+	header[12] = 0;  // no interlacing
+	pixelimage_writeChunk(out, "IHDR", header, 13);
+
+	// The zlib stream is split into IDAT chunks of about 1 MB:
+	const size_t chunksize = 1 << 20;
+	vector<unsigned char> idat;
+	idat.reserve(chunksize + 8);
+	auto append = [&](const unsigned char* data, size_t length) {
+		while (length > 0) {
+			size_t count = chunksize - idat.size();
+			if (count > length) {
+				count = length;
+			}
+			idat.insert(idat.end(), data, data + count);
+			data += count;
+			length -= count;
+			if (idat.size() >= chunksize) {
+				pixelimage_writeChunk(out, "IDAT", idat.data(), idat.size());
+				idat.clear();
+			}
+		}
+	};
+
+	// zlib header: deflate with a 32K window and no compression:
+	static const unsigned char zlibheader[2] = {0x78, 0x01};
+	append(zlibheader, 2);
+
+	// Each image row is preceded by its filter type (0 = none).  The
+	// rows are written in stored blocks of up to 65535 bytes:
+	size_t rowsize = (size_t)m_width * 3;
+	size_t remaining = (size_t)height * (rowsize + 1);
+	size_t blockleft = 0;
+	unsigned int a = 1;
+	unsigned int b = 0;
+	auto deflate = [&](const unsigned char* data, size_t length) {
+		pixelimage_adler(a, b, data, length);
+		while (length > 0) {
+			if (blockleft == 0) {
+				blockleft = remaining < 65535 ? remaining : 65535;
+				remaining -= blockleft;
+				unsigned char blockheader[5];
+				blockheader[0] = remaining == 0 ? 1 : 0;
+				blockheader[1] = (unsigned char)(blockleft & 0xff);
+				blockheader[2] = (unsigned char)(blockleft >> 8);
+				blockheader[3] = (unsigned char)(~blockleft & 0xff);
+				blockheader[4] = (unsigned char)((~blockleft >> 8) & 0xff);
+				append(blockheader, 5);
+			}
+			size_t count = length < blockleft ? length : blockleft;
+			append(data, count);
+			data += count;
+			length -= count;
+			blockleft -= count;
+		}
+	};
+
+	static const unsigned char filter = 0;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		const unsigned char* rowdata = m_pixels.data() + i * rowsize;
+		for (int j=0; j<m_repeats[i]; j++) {
+			deflate(&filter, 1);
+			deflate(rowdata, rowsize);
+		}
+	}
+
+	unsigned char checksum[4];
+	pixelimage_writeInt(checksum, (b << 16) | a);
+	append(checksum, 4);
+	if (!idat.empty()) {
+		pixelimage_writeChunk(out, "IDAT", idat.data(), idat.size());
+	}
+
+	pixelimage_writeChunk(out, "IEND", NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::write -- Write the image in the given format: "ppm" or
+//    "p6" for binary PPM, "p3" for ASCII PPM, or "png".  Returns false
+//    if the format is not known.
+//
+
+bool PixelImage::write(ostream& out, const string& format) const {
+	if ((format == "ppm") || (format == "p6") || (format == "P6")) {
+		writePpm6(out);
+	} else if ((format == "p3") || (format == "P3")) {
+		writePpm3(out);
+	} else if ((format == "png") || (format == "PNG")) {
+		writePng(out);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+
+
 /////////////////////////////////
 //
 // Tool_1520ify::Tool_1520ify -- Set the recognized options for the tool.
@@ -54797,10 +63640,15 @@ void Tool_1520ify::clearStates(void) {
 string Tool_1520ify::getDate(void) {
 	auto now = std::chrono::system_clock::now();
 	std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-	std::tm* local_time = std::localtime(&now_time);
-	int year = local_time->tm_year + 1900;
-	int month = local_time->tm_mon + 1; 
-	int day = local_time->tm_mday;
+	std::tm local_time;
+#ifdef _WIN32
+	localtime_s(&local_time, &now_time);
+#else
+	localtime_r(&now_time, &local_time);
+#endif
+	int year = local_time.tm_year + 1900;
+	int month = local_time.tm_mon + 1;
+	int day = local_time.tm_mday;
 	stringstream ss;
 	ss << year << "/";
 	ss << std::setw(2) << std::setfill('0') << month << "/";
@@ -54818,8 +63666,13 @@ string Tool_1520ify::getDate(void) {
 int Tool_1520ify::getYear(void) {
 	auto now = std::chrono::system_clock::now();
 	std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-	std::tm* local_time = std::localtime(&now_time);
-	int year = local_time->tm_year + 1900;
+	std::tm local_time;
+#ifdef _WIN32
+	localtime_s(&local_time, &now_time);
+#else
+	localtime_r(&now_time, &local_time);
+#endif
+	int year = local_time.tm_year + 1900;
 	return year;
 }
 
@@ -55139,6 +63992,9 @@ string Tool_addic::getInstrumentClass(const string& code) {
 Tool_addkey::Tool_addkey(void) {
 	define("k|key=s",           "Add given key designtation to data");
 	define("K|reference-key=b", "Update or add !!!key: designation, used with -k");
+	define("e|estimate=b",      "Add key designation estimated from the notes");
+	define("l|local=b",         "Also add estimated local key changes in the data");
+	define("w|window=d:16",     "Duration of window for local keys, in quarter notes");
 }
 
 
@@ -55197,6 +64053,9 @@ void Tool_addkey::initialize(void) {
 	m_addKeyRefQ = getBoolean("reference-key");
 	m_keyQ       = getBoolean("key");
 	m_key        = getString("key");
+	m_localQ     = getBoolean("local");
+	m_estimateQ  = getBoolean("estimate") || m_localQ;
+	m_window     = getDouble("window");
 	HumRegex hre;
 	hre.replaceDestructive(m_key, "", ":$");
 	hre.replaceDestructive(m_key, "", "^\\*");
@@ -55211,8 +64070,11 @@ void Tool_addkey::initialize(void) {
 
 void Tool_addkey::processFile(HumdrumFile& infile) {
 	initialize();
+	m_localKeys.clear();
 	if (m_keyQ) {
 		addInputKey(infile);
+	} else if (m_estimateQ) {
+		insertEstimatedKey(infile);
 	} else {
 		insertReferenceKey(infile);
 	}
@@ -55307,6 +64169,63 @@ void Tool_addkey::insertReferenceKey(HumdrumFile& infile) {
 	if (!hre.search(keyValue, "^\\*")) {
 		hre.replaceDestructive(keyValue, "*", "^");
 	}
+	insertKey(infile, keyValue);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::insertEstimatedKey -- Insert the key estimated from the
+//    notes in the score.  With the -l option, the initial key is the local
+//    key at the start of the music, and a key designation is also added
+//    before each data line where the local key changes.
+//
+
+void Tool_addkey::insertEstimatedKey(HumdrumFile& infile) {
+	getLineIndexes(infile);
+
+	m_estimator.setWindow(HumNum(int(m_window * 1000.0 + 0.5), 1000));
+	m_estimator.analyze(infile);
+
+	string desig = m_estimator.getGlobalKeyDesignation();
+	if (m_localQ) {
+		int startIndex = -1;
+		for (int i=0; i<infile.getLineCount(); i++) {
+			if (infile[i].isData()) {
+				startIndex = i;
+				break;
+			}
+		}
+		if (startIndex >= 0) {
+			desig = m_estimator.getKeyDesignation(startIndex);
+		}
+		vector<int> changes;
+		m_estimator.getKeyChanges(changes);
+		m_localKeys.resize(infile.getLineCount());
+		for (int i=0; i<(int)changes.size(); i++) {
+			m_localKeys.at(changes[i]) = m_estimator.getKeyDesignation(changes[i]);
+		}
+	}
+
+	if (desig.empty()) {
+		// No notes in the score.
+		return;
+	}
+	insertKey(infile, desig);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::insertKey -- Replace the key designations in the header
+//    with the given one, or add a key designation line after the key
+//    signature line (or before the first data line if there is no key
+//    signature).
+//
+
+void Tool_addkey::insertKey(HumdrumFile& infile, const string& desig) {
 	if (m_keyDesigIndex > 0) {
 		for (int i=m_exinterpIndex+1; i<=m_keyDesigIndex; i++) {
 			if (!infile[i].isInterpretation()) {
@@ -55317,16 +64236,17 @@ void Tool_addkey::insertReferenceKey(HumdrumFile& infile) {
 				if (!token->isKeyDesignation()) {
 					continue;
 				}
-				string text = "*" + keyValue;
-				token->setText(text);
+				token->setText(desig);
 			}
 		}
 		infile.generateLinesFromTokens();
-		m_humdrum_text << infile;
+		for (int i=0; i<infile.getLineCount(); i++) {
+			printLine(infile, i);
+		}
 	} else if (m_keySigIndex > 0) {
-		printKeyDesig(infile, m_keySigIndex, keyValue, +1);
+		printKeyDesig(infile, m_keySigIndex, desig, +1);
 	} else if (m_dataStartIndex > 0) {
-		printKeyDesig(infile, m_dataStartIndex, keyValue, -1);
+		printKeyDesig(infile, m_dataStartIndex, desig, -1);
 	}
 }
 
@@ -55341,25 +64261,14 @@ void Tool_addkey::printKeyDesig(HumdrumFile& infile, int index, const string& de
 	int index2 = index + direction;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (i != index2) {
-			m_humdrum_text << infile[i] << endl;
+			printLine(infile, i);
 		} else {
 			if (index > index2) {
-				m_humdrum_text << infile[i] << endl;
-			}
-			for (int j=0; j<infile[index].getFieldCount(); j++) {
-				HTp token = infile.token(index, j);
-				if (j > 0) {
-					m_humdrum_text << "\t";
-				}
-				if (token->isKern()) {
-					m_humdrum_text << desig;
-				} else {
-					m_humdrum_text << "*";
-				}
+				printLine(infile, i);
 			}
-			m_humdrum_text << endl;
+			printKeyLine(infile, index, desig);
 			if (index < index2) {
-				m_humdrum_text << infile[i] << endl;
+				printLine(infile, i);
 			}
 		}
 	}
@@ -55367,6 +64276,45 @@ void Tool_addkey::printKeyDesig(HumdrumFile& infile, int index, const string& de
 
 
 
+//////////////////////////////
+//
+// Tool_addkey::printKeyLine -- Print an interpretation line with the
+//    key designation in each **kern spine, using the spine layout of
+//    the given line.
+//
+
+void Tool_addkey::printKeyLine(HumdrumFile& infile, int index, const string& desig) {
+	for (int j=0; j<infile[index].getFieldCount(); j++) {
+		HTp token = infile.token(index, j);
+		if (j > 0) {
+			m_humdrum_text << "\t";
+		}
+		if (token->isKern()) {
+			m_humdrum_text << desig;
+		} else {
+			m_humdrum_text << "*";
+		}
+	}
+	m_humdrum_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::printLine -- Print a line of the input file, preceded by
+//    a local key designation line if the local key changes there.
+//
+
+void Tool_addkey::printLine(HumdrumFile& infile, int index) {
+	if ((index < (int)m_localKeys.size()) && !m_localKeys[index].empty()) {
+		printKeyLine(infile, index, m_localKeys[index]);
+	}
+	m_humdrum_text << infile[index] << endl;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_addkey::getLineIndexes --
@@ -62062,7 +71010,13 @@ void Tool_chantize::clearStates(void) {
 
 string Tool_chantize::getDate(void) {
 	time_t t = time(NULL);
-	tm* timeptr = localtime(&t);
+	tm localtm;
+#ifdef _WIN32
+	localtime_s(&localtm, &t);
+#else
+	localtime_r(&t, &localtm);
+#endif
+	tm* timeptr = &localtm;
 	stringstream ss;
 	int year = timeptr->tm_year + 1900;
 	int month = timeptr->tm_mon + 1;
@@ -63017,26 +71971,32 @@ void Tool_chord::processFile(HumdrumFile& infile, int direction) {
 //
 
 void Tool_chord::processChord(HTp tok, int direction) {
-	vector<string> notes;
-	int count = (int)tok->getSubtokenCount();
-	for (int i=0; i<count; i++) {
-		notes.emplace_back(tok->getSubtoken(i));
-	}
-
-	if (notes.size() <= 1) {
+	HumSubtokenView subtokens = tok->getSubtokenView();
+	int count = subtokens.size();
+	if (count <= 1) {
 		// nothing to do
 		return;
 	}
 
 	bool ismin = false;
 	HumRegex hre;
-	if (!hre.search(notes[1], "[0-9]")) {
+	if (subtokens[1].getText().find_first_of("0123456789") == std::string_view::npos) {
 		ismin = true;
 	}
 
+	vector<string> notes;
+	notes.reserve(count);
 	vector<pair<int, int>> pitches(count);
-	for (int i=0; i<(int)pitches.size(); i++) {
-		pitches[i].first = Convert::kernToBase40(notes[i]);
+	for (const HumSubtoken& subtoken : subtokens) {
+		int i = subtoken.getIndex();
+		notes.emplace_back(subtoken.getText());
+		if (subtoken.hasPitch()) {
+			pitches[i].first = subtoken.getBase40();
+		} else {
+			// same as Convert::kernToBase40() for rests and subtokens
+			// without pitches:
+			pitches[i].first = subtoken.contains('r') ? -1000 : -2000;
+		}
 		pitches[i].second = i;
 	}
 
@@ -65937,10 +74897,6 @@ void Tool_cint::usage(const string& command) {
 
 
 
-double cmr_note_info::m_syncopationWeight = 1.0;
-double cmr_note_info::m_leapWeight = 0.5;
-
-
 ///////////////////////////////////////////////////////////////////////////
 //
 // cmr_note_info -- Helper class describing a conspicuous repetition note.
@@ -66195,12 +75151,16 @@ bool cmr_note_info::isLeapBefore(HTp token) {
 //
 
 double cmr_note_info::getMetricLevel(HTp token) {
-	HumNum beat = token->getDurationFromBarline();
-	if (!beat.isInteger()) { // anything less than quarter note level
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	if (tick % tpq != 0) { // anything less than quarter note level
 		return -1;
-	} else if (beat.getNumerator() % 4 == 0) { // whole note level
+	}
+	int quarters = tick / tpq;
+	if (quarters % 4 == 0) { // whole note level
 		return 2;
-	} else if (beat.getNumerator() % 2 == 0) { // half note level
+	} else if (quarters % 2 == 0) { // half note level
 		return 1;
 	} else { // quarter note level
 		return 0;
@@ -66214,15 +75174,17 @@ double cmr_note_info::getMetricLevel(HTp token) {
 // cmr_note_info::getNoteStrength -- Calculate a strength value for the
 //     note.  This is based on if the note is syncopated and/or if it
 //     is preceded by a melodic leap.
+// default value: syncopationWeight = 1.0
+// default value: leapWeight = 0.5
 //
 
-double cmr_note_info::getNoteStrength(void) {
+double cmr_note_info::getNoteStrength(double syncopationWeight, double leapWeight) {
 	double output = 1.0;
 	if (hasSyncopation()) {
-		output += m_syncopationWeight;
+		output += syncopationWeight;
 	}
 	if (hasLeapBefore()) {
-		output += m_leapWeight;
+		output += leapWeight;
 	}
 	return output;
 }
@@ -66671,12 +75633,14 @@ int cmr_group_info::getStartFieldNumber(void) {
 //////////////////////////////
 //
 // cmr_group_info::getGroupStrength -- Return the strength value for the CMR.
+// default value: syncopationWeight = 1.0
+// default value: leapWeight = 0.5
 //
 
-double cmr_group_info::getGroupStrength(void) {
+double cmr_group_info::getGroupStrength(double syncopationWeight, double leapWeight) {
 	double output = 0.0;
 	for (int i=0; i<(int)m_notes.size(); i++) {
-		output += m_notes[i].getNoteStrength();
+		output += m_notes[i].getNoteStrength(syncopationWeight, leapWeight);
 	}
 	return output;
 }
@@ -66863,6 +75827,116 @@ string cmr_group_info::getPitch(void) {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// cmr_range_max::clear -- Remove the contents of the table.
+//
+
+void cmr_range_max::clear(void) {
+	m_table.clear();
+	m_log2.clear();
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::build -- Prepare the sparse table for the given values.
+//    Each level k stores the maximum of the 2^k values starting at each
+//    index, so any range is covered by two (overlapping) table entries.
+//
+
+void cmr_range_max::build(const vector<int>& values) {
+	int size = (int)values.size();
+	m_log2.resize(size + 1);
+	m_log2[0] = 0;
+	if (size > 0) {
+		m_log2[1] = 0;
+	}
+	for (int i=2; i<=size; i++) {
+		m_log2[i] = m_log2[i/2] + 1;
+	}
+	int levels = size > 0 ? m_log2[size] + 1 : 0;
+	m_table.resize(levels);
+	if (levels == 0) {
+		return;
+	}
+	m_table[0] = values;
+	for (int k=1; k<levels; k++) {
+		int width = 1 << k;
+		int half = width / 2;
+		vector<int>& previous = m_table[k-1];
+		vector<int>& current = m_table[k];
+		current.resize(size - width + 1);
+		for (int i=0; i<(int)current.size(); i++) {
+			current[i] = max(previous[i], previous[i+half]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::getMaximum -- Return the maximum value in the inclusive
+//    index range.
+//
+
+int cmr_range_max::getMaximum(int index1, int index2) const {
+	int k = m_log2[index2 - index1 + 1];
+	return max(m_table[k][index1], m_table[k][index2 - (1 << k) + 1]);
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::findFirstAbove -- Return the first index in the inclusive
+//    range which has a value greater than the threshold, or -1 if none.
+//
+
+int cmr_range_max::findFirstAbove(int index1, int index2, int threshold) const {
+	if ((index1 > index2) || (getMaximum(index1, index2) <= threshold)) {
+		return -1;
+	}
+	while (index1 < index2) {
+		int middle = (index1 + index2) / 2;
+		if (getMaximum(index1, middle) > threshold) {
+			index2 = middle;
+		} else {
+			index1 = middle + 1;
+		}
+	}
+	return index1;
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::findLastAbove -- Return the last index in the inclusive
+//    range which has a value greater than the threshold, or -1 if none.
+//
+
+int cmr_range_max::findLastAbove(int index1, int index2, int threshold) const {
+	if ((index1 > index2) || (getMaximum(index1, index2) <= threshold)) {
+		return -1;
+	}
+	while (index1 < index2) {
+		int middle = (index1 + index2 + 1) / 2;
+		if (getMaximum(middle, index2) > threshold) {
+			index1 = middle;
+		} else {
+			index2 = middle - 1;
+		}
+	}
+	return index1;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 /////////////////////////////////
@@ -66896,6 +75970,7 @@ Tool_cmr::Tool_cmr(void) {
 	define("strengthplot=b",              "output Vega-lite plot with strength scores");
 	define("h|half=b",                    "durations given in half notes (mimims)");
 	define("D|debug=b",                   "print debug information");
+	define("j|jobs|threads=i:1",          "number of threads for corpus statistics (-S, -v)");
 }
 
 
@@ -66906,6 +75981,11 @@ Tool_cmr::Tool_cmr(void) {
 //
 
 bool Tool_cmr::run(HumdrumFileSet& infiles) {
+	initialize();
+	if (isCorpusMode() && (infiles.getCount() > 1)) {
+		processCorpus(infiles);
+		return true;
+	}
 	bool status = true;
 	for (int i=0; i<infiles.getCount(); i++) {
 		status &= run(infiles[i]);
@@ -66944,6 +76024,41 @@ bool Tool_cmr::run(HumdrumFile& infile) {
 }
 
 
+//
+// Input files are read in batches when doing corpus statistics with
+// multiple threads, otherwise one at a time.
+//
+
+bool Tool_cmr::run(HumdrumFileStream& instream) {
+	initialize();
+	if (!isCorpusMode()) {
+		HumdrumFileSet infiles;
+		bool status = true;
+		while (instream.readSingleSegment(infiles)) {
+			status &= run(infiles);
+		}
+		return status;
+	}
+
+	int batchsize = m_threads * 16;
+	bool done = false;
+	while (!done) {
+		HumdrumFileSet infiles;
+		while (infiles.getCount() < batchsize) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (!instream.getFile(*infile)) {
+				delete infile;
+				done = true;
+				break;
+			}
+			infiles.appendHumdrumPointer(infile);
+		}
+		processCorpus(infiles);
+	}
+	return true;
+}
+
+
 
 //////////////////////////////
 //
@@ -66981,14 +76096,110 @@ void Tool_cmr::initialize(void) {
 	m_infoQ        = getBoolean("info");
 	m_halfQ        = getBoolean("half");
 
-	cmr_note_info::m_syncopationWeight = getDouble("syncopation-weight");
-	cmr_note_info::m_leapWeight        = getDouble("leap-weight");
+	m_syncopationWeight = getDouble("syncopation-weight");
+	m_leapWeight        = getDouble("leap-weight");
+
+	m_threads = getInteger("threads");
+	if (m_threads < 1) {
+		m_threads = 1;
+	}
 
 	m_noteGroups.clear();
 }
 
 
 
+//////////////////////////////
+//
+// Tool_cmr::isCorpusMode -- True if only statistics are output for each
+//    file, so that the files can be analyzed in parallel.  Raw data
+//    and debugging output are printed directly and so are excluded.
+//
+
+bool Tool_cmr::isCorpusMode(void) {
+	if (m_threads <= 1) {
+		return false;
+	}
+	if (m_rawQ || m_debugQ || m_infoQ || m_localOnlyQ) {
+		return false;
+	}
+	return m_summaryQ || m_vegaQ || m_vegaCountQ || m_vegaStrengthQ;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cmr::processCorpus -- Analyze a set of files in parallel, with
+//    a separate Tool_cmr for each file.  The results are merged in input
+//    order, so the output is the same as processing the files one at a
+//    time.
+//
+
+void Tool_cmr::processCorpus(HumdrumFileSet& infiles) {
+	int count = infiles.getCount();
+	if (count == 0) {
+		return;
+	}
+
+	// Workers are configured before any thread starts so that option
+	// errors are reported in order.
+	vector<unique_ptr<Tool_cmr>> workers(count);
+	for (int i=0; i<count; i++) {
+		workers[i] = make_unique<Tool_cmr>();
+		workers[i]->process(m_argv);
+		workers[i]->initialize();
+	}
+
+	atomic<int> next(0);
+	auto analyze = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			workers[index]->processFile(infiles[index]);
+		}
+	};
+
+	int threadcount = min(m_threads, count);
+	vector<thread> threads;
+	threads.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		threads.emplace_back(analyze);
+	}
+	analyze();
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		mergeCorpusResults(*workers[i]);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cmr::mergeCorpusResults -- Append the statistics and text output
+//    of a worker to the totals.
+//
+
+void Tool_cmr::mergeCorpusResults(Tool_cmr& worker) {
+	m_humdrum_text << worker.m_humdrum_text.str();
+	m_free_text    << worker.m_free_text.str();
+	m_warning_text << worker.m_warning_text.str();
+	m_error_text   << worker.m_error_text.str();
+	m_vegaData     << worker.m_vegaData.str();
+	m_cmrCount.insert(m_cmrCount.end(),
+			worker.m_cmrCount.begin(), worker.m_cmrCount.end());
+	m_cmrNoteCount.insert(m_cmrNoteCount.end(),
+			worker.m_cmrNoteCount.begin(), worker.m_cmrNoteCount.end());
+	m_scoreNoteCount.insert(m_scoreNoteCount.end(),
+			worker.m_scoreNoteCount.begin(), worker.m_scoreNoteCount.end());
+	m_noteCount += worker.m_noteCount;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cmr::processFile -- Do CMR analysis on score.
@@ -67114,6 +76325,7 @@ void Tool_cmr::processSpine(HTp startok, HumdrumFile&  infile) {
 	getMetlev(m_metlevs, m_notelist);
 	getSyncopation(m_syncopation, m_notelist);
 	getLeapBefore(m_leapbefore, m_midinums);
+	prepareRangeQueries(infile);
 
 	if (m_localQ) {
 		markNotes(m_notelist, m_localpeaks, m_local_marker);
@@ -67161,6 +76373,7 @@ void Tool_cmr::processSpineFlipped(HTp startok, HumdrumFile& infile) {
 	getMetlev(m_metlevs, m_notelist);
 	getSyncopation(m_syncopation, m_notelist);
 	getLeapBefore(m_leapbefore, m_midinums);
+	prepareRangeQueries(infile);
 
 
 	if (m_rawQ) {
@@ -67209,64 +76422,43 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 	}
 
 	int pitch = m_midinums.at(index);
+	int64_t onset = m_onsets.at(index);
 
 	// Create list of notes with same pitch within target duration after target note.
 	vector<int> candidates;
 	candidates.push_back(index);
 
-	int i = index+1;
-	HumNum duration = 0;
-	if (i < (int)m_notelist.size()) {
-		duration = m_notelist.at(i).at(0)->getDurationFromStart() - m_notelist.at(index).at(0)->getDurationFromStart();
+	// Check for matching peaks after target note.  The search stops at
+	// the end of the time window or before the first note that is more
+	// than a major second above the peak note:
+	int last = (int)(upper_bound(m_onsets.begin() + index + 1, m_onsets.end(),
+			onset + m_cmrTicks) - m_onsets.begin()) - 1;
+	int blocker = m_pitchMax.findFirstAbove(index + 1, last, pitch + 2);
+	if (blocker >= 0) {
+		last = blocker - 1;
 	}
-
-	// Check for matching peaks after target note:
-	while ((i < (int)m_notelist.size()) && (duration.getFloat() <= m_cmrDur)) {
-		if (m_midinums.at(i) > pitch + 2) {
-			// Cannot exceed a major second above peak note
-			// maybe check if adjacent to a peak note
-			break;
-		}
-		if (m_midinums.at(i) == pitch) {
-			double metlev = m_metlevs.at(i);
-			if (metlev > 1) { // has to be on whole-note level (metlev == 2)
-				candidates.push_back(i);
-			} else if (isMelodicallyAccented(i)) {
-				candidates.push_back(i);
-			}
+	for (int i=m_nextSame.at(index); (i >= 0) && (i <= last); i = m_nextSame.at(i)) {
+		if (m_accented.at(i)) {
+			candidates.push_back(i);
 		}
-		i++;
-		if (i < (int)m_notelist.size()) {
-			duration = m_notelist.at(i).at(0)->getDurationFromStart() - m_notelist.at(index).at(0)->getDurationFromStart();
-		}
-	}
-
-	i = index-1;
-	duration = 0;
-	if (i < (int)m_notelist.size()) {
-		duration = m_notelist.at(index).at(0)->getDurationFromStart() - m_notelist.at(i).at(0)->getDurationFromStart();
 	}
 
 	// Check for matching peaks before target note:
-	while ((i >= 0) && (duration.getFloat() <= m_cmrDur)) {
-		if (m_midinums.at(i) > pitch + 2) {
-			// Cannot exceed a major second above peak note
-			// maybe check if adjacent to a peak note
-			break;
-		}
-		if (m_midinums.at(i) == pitch) {
-			double metlev = m_metlevs.at(i);
-			if (metlev > 1) { // has to be on whole-note level (metlev == 2)
-				candidates.insert(candidates.begin(), i);
-			} else if (isMelodicallyAccented(i)) {
-				candidates.insert(candidates.begin(), i);
-			}
-		}
-		i--;
-		if (i >= 0) {
-			duration = m_notelist.at(index).at(0)->getDurationFromStart() - m_notelist.at(i).at(0)->getDurationFromStart();
+	int first = (int)(lower_bound(m_onsets.begin(), m_onsets.begin() + index,
+			onset - m_cmrTicks) - m_onsets.begin());
+	blocker = m_pitchMax.findLastAbove(first, index - 1, pitch + 2);
+	if (blocker >= 0) {
+		first = blocker + 1;
+	}
+	vector<int> before;
+	for (int i=m_prevSame.at(index); (i >= 0) && (i >= first); i = m_prevSame.at(i)) {
+		if (m_accented.at(i)) {
+			before.push_back(i);
 		}
 	}
+	if (!before.empty()) {
+		candidates.insert(candidates.begin(), before.rbegin(), before.rend());
+	}
 
 	if ((int)candidates.size() < m_cmrNum) {
 		// Not enough notes to consider a CMR.
@@ -67276,13 +76468,10 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 	for (int i=0; i<=(int)candidates.size() - m_cmrNum; i++) {
 		int index1 = candidates.at(i);
 		int index2 = candidates.at(i+m_cmrNum-1);
-		HumNum dur1 = m_notelist.at(index1).at(0)->getDurationFromStart();
-		HumNum dur2 = m_notelist.at(index2).at(0)->getDurationFromStart();
-		HumNum duration = dur2 - dur1;
-		if (duration > m_cmrDur) {
+		if (m_onsets.at(index2) - m_onsets.at(index1) > m_cmrTicks) {
 			continue;
 		}
-		if (hasHigher(pitch, 2, m_midinums, m_notelist, index1, index2)) {
+		if (hasHigher(pitch, 2, index1, index2)) {
 			continue;
 		}
 
@@ -67302,14 +76491,16 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 		}
 	}
 
+	if (m_noteGroups.empty()) {
+		return;
+	}
+
 	int leapcount = m_noteGroups.back().getLeapCount();
 	int syncocount  = m_noteGroups.back().getSyncopationCount();
 	if (syncocount == 0) {
 		if (leapcount < 3) {
 			// Delete groups since it has less than three leaps and no syncopations
-			if (m_noteGroups.size() > 0) {
-				m_noteGroups.resize(m_noteGroups.size() - 1);
-			}
+			m_noteGroups.resize(m_noteGroups.size() - 1);
 		}
 	}
 
@@ -67345,28 +76536,69 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 // Tool_cmr::hasHigher -- There may be a note a step higher
 //     (or lower) between any two notes of the CMR provided
 //     that that higher note is not on a strong beat.
-//     True = invalid CMR case.
+//     True = invalid CMR case.  Uses the range-maximum tables
+//     prepared in prepareRangeQueries().
 //
 
-bool Tool_cmr::hasHigher(int pitch, int tolerance, vector<int>& midinums, vector<vector<HTp>>& notelist, int index1, int index2) {
+bool Tool_cmr::hasHigher(int pitch, int tolerance, int index1, int index2) {
+	// Only a step above (major or minor second) is allowed.
+	// Input tolerance is 2.
+	if (m_pitchMax.getMaximum(index1, index2) > pitch + tolerance) {
+		return true;
+	}
+	// If a higher note is accented, then invalidate the cmr.
+	if (m_strongMax.getMaximum(index1, index2) > pitch) {
+		return true;
+	}
+	return false;
+}
 
-	for (int i=index1; i<=index2; i++) {
-		// Only a step above (major or minor second) is allowed.
-		// Input tolerance is 2.
-		if (midinums.at(i) > pitch + tolerance) {
-			return true;
-		}
 
-		if (midinums.at(i) > pitch) {
-			// If the higher note is accented, then invalidate the cmr.
-			if (isOnStrongBeat(notelist.at(i).at(0))) {
-				return true;
-			}
-		}
 
+//////////////////////////////
+//
+// Tool_cmr::prepareRangeQueries -- Store integer onset times, strong-beat
+//     and accent flags, same-pitch links and range-maximum tables for
+//     the current part so that checkForCmr() does not need to rescan
+//     notes for each candidate.  Must be called after m_midinums,
+//     m_metlevs, m_syncopation and m_leapbefore are prepared.
+//
+
+void Tool_cmr::prepareRangeQueries(HumdrumFile& infile) {
+	int count = (int)m_notelist.size();
+	int tpq = infile.tpq();
+	m_cmrTicks = (int64_t)floor(m_cmrDur * tpq);
+
+	m_onsets.resize(count);
+	m_strongBeat.resize(count);
+	m_accented.resize(count);
+	vector<int> strongpitches(count);
+	for (int i=0; i<count; i++) {
+		HTp token = m_notelist.at(i).at(0);
+		HumNum onset = token->getDurationFromStart() * tpq;
+		m_onsets[i] = (int64_t)onset.getNumerator() / onset.getDenominator();
+		m_strongBeat[i] = isOnStrongBeat(token);
+		// has to be on whole-note level (metlev == 2) or melodically accented:
+		m_accented[i] = (m_metlevs.at(i) > 1) || isMelodicallyAccented(i);
+		strongpitches[i] = m_strongBeat[i] ? m_midinums.at(i) : INT_MIN;
+	}
+
+	m_nextSame.assign(count, -1);
+	m_prevSame.assign(count, -1);
+	map<int, int> lastindex;
+	for (int i=0; i<count; i++) {
+		auto it = lastindex.find(m_midinums.at(i));
+		if (it != lastindex.end()) {
+			m_prevSame[i] = it->second;
+			m_nextSame[it->second] = i;
+			it->second = i;
+		} else {
+			lastindex[m_midinums.at(i)] = i;
+		}
 	}
 
-	return false;
+	m_pitchMax.build(m_midinums);
+	m_strongMax.build(strongpitches);
 }
 
 
@@ -67674,7 +76906,7 @@ void Tool_cmr::printGroupStatistics(HumdrumFile& infile) {
 		m_humdrum_text << "!!!cmr_end_measure: "   << m_noteGroups[i].getMeasureEnd()       << endl;
 		// Durations are in units of whole notes (semibreves):
 		m_humdrum_text << "!!!cmr_duration: "      << groupDuration << m_durUnit            << endl;
-		m_humdrum_text << "!!!cmr_strength: "      << m_noteGroups[i].getGroupStrength()    << endl;
+		m_humdrum_text << "!!!cmr_strength: "      << m_noteGroups[i].getGroupStrength(m_syncopationWeight, m_leapWeight) << endl;
 		m_humdrum_text << "!!!cmr_direction: "     << m_noteGroups[i].getDirection()        << endl;
 		m_humdrum_text << "!!!cmr_note_count: "    << m_noteGroups[i].getNoteCount()        << endl;
 		m_humdrum_text << "!!!cmr_pitch: "         << m_noteGroups[i].getPitch()            << endl;
@@ -68426,14 +77658,10 @@ void Tool_cmr::getBeat(vector<bool>& metpos, vector<vector<HTp>>& notelist) {
 //
 
 bool Tool_cmr::isOnStrongBeat(HTp token) {
-	HumNum position = token->getDurationFromBarline();
-	if (position.getDenominator() != 1) {
-		return false;
-	} if (position.getNumerator() % 4 == 0) {
-		return true;
-	} else {
-		return false;
-	}
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	return tick % (tpq * 4) == 0;
 }
 
 
@@ -68538,7 +77766,7 @@ int Tool_cmr::getStrengthScore(void) {
 	int output = 0;
 	for (int i=0; i<(int)m_noteGroups.size(); i++) {
 		if (m_noteGroups[i].isValid()) {
-			output += m_noteGroups[i].getGroupStrength();
+			output += m_noteGroups[i].getGroupStrength(m_syncopationWeight, m_leapWeight);
 		}
 	}
 	return output;
@@ -69091,6 +78319,223 @@ void Tool_colortriads::processFile(HumdrumFile& infile) {
 #define COMPOSITE_TREMOLO_MARKER "||"
 
 
+
+//////////////////////////////
+//
+// OnsetBitmap::resize -- Set the number of bits in the bitmap.  All
+//    bits are cleared.
+//
+
+void OnsetBitmap::resize(int size) {
+	m_size = size < 0 ? 0 : size;
+	m_words.resize((m_size + 63) / 64);
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::clear -- Set all bits to zero.
+//
+
+void OnsetBitmap::clear(void) {
+	fill(m_words.begin(), m_words.end(), 0);
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::set -- Turn on a bit.
+//
+
+void OnsetBitmap::set(int index) {
+	m_words.at(index >> 6) |= ((uint64_t)1) << (index & 63);
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::unset -- Turn off a bit.
+//
+
+void OnsetBitmap::unset(int index) {
+	m_words.at(index >> 6) &= ~(((uint64_t)1) << (index & 63));
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::test -- Returns true if the bit is on.
+//
+
+bool OnsetBitmap::test(int index) const {
+	if ((index < 0) || (index >= m_size)) {
+		return false;
+	}
+	return (m_words[index >> 6] >> (index & 63)) & 1;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::count -- Returns the number of bits that are on.
+//
+
+int OnsetBitmap::count(void) const {
+	int output = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		output += (int)std::bitset<64>(m_words[i]).count();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::next -- Returns the index of the first bit that is on
+//    starting at the given index.  Returns -1 if there are no more
+//    bits that are on.
+//
+
+int OnsetBitmap::next(int index) const {
+	if (index < 0) {
+		index = 0;
+	}
+	if (index >= m_size) {
+		return -1;
+	}
+	int w = index >> 6;
+	uint64_t word = m_words[w] & (~((uint64_t)0) << (index & 63));
+	while (true) {
+		if (word) {
+			int bit = 0;
+			while (!(word & 1)) {
+				word >>= 1;
+				bit++;
+			}
+			int output = (w << 6) + bit;
+			return output < m_size ? output : -1;
+		}
+		w++;
+		if (w >= (int)m_words.size()) {
+			return -1;
+		}
+		word = m_words[w];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::clearBefore -- Turn off all bits before the given index.
+//
+
+void OnsetBitmap::clearBefore(int index) {
+	if (index >= m_size) {
+		clear();
+		return;
+	}
+	for (int i=0; i<(index >> 6); i++) {
+		m_words[i] = 0;
+	}
+	if (index > 0) {
+		m_words[index >> 6] &= ~((uint64_t)0) << (index & 63);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::shiftUp -- Move all bits to the next higher index.
+//
+
+OnsetBitmap& OnsetBitmap::shiftUp(void) {
+	uint64_t carry = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		uint64_t newcarry = m_words[i] >> 63;
+		m_words[i] = (m_words[i] << 1) | carry;
+		carry = newcarry;
+	}
+	if (m_size & 63) {
+		m_words.back() &= (((uint64_t)1) << (m_size & 63)) - 1;
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::operator|= -- Union of two bitmaps.
+//
+
+OnsetBitmap& OnsetBitmap::operator|=(const OnsetBitmap& other) {
+	int count = (int)std::min(m_words.size(), other.m_words.size());
+	for (int i=0; i<count; i++) {
+		m_words[i] |= other.m_words[i];
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::operator&= -- Intersection of two bitmaps.
+//
+
+OnsetBitmap& OnsetBitmap::operator&=(const OnsetBitmap& other) {
+	for (int i=0; i<(int)m_words.size(); i++) {
+		if (i < (int)other.m_words.size()) {
+			m_words[i] &= other.m_words[i];
+		} else {
+			m_words[i] = 0;
+		}
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::andNot -- Turn off bits that are on in the other bitmap.
+//
+
+OnsetBitmap& OnsetBitmap::andNot(const OnsetBitmap& other) {
+	int count = (int)std::min(m_words.size(), other.m_words.size());
+	for (int i=0; i<count; i++) {
+		m_words[i] &= ~other.m_words[i];
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::invert -- Toggle all bits.
+//
+
+OnsetBitmap& OnsetBitmap::invert(void) {
+	for (int i=0; i<(int)m_words.size(); i++) {
+		m_words[i] = ~m_words[i];
+	}
+	if (m_size & 63) {
+		m_words.back() &= (((uint64_t)1) << (m_size & 63)) - 1;
+	}
+	return *this;
+}
+
+
 /////////////////////////////////
 //
 // Tool_composite::Tool_composite -- Set the recognized options for the tool.
@@ -69334,6 +78779,8 @@ void Tool_composite::processFile(HumdrumFile& infile) {
 	if (m_groupsQ) {
 		checkForAutomaticGrouping(infile);
 	}
+	// Build the bitmaps after any grouping lines are inserted into the file:
+	buildOnsetBitmaps(infile);
 
 	if (m_coincidenceQ) {
 		analyzeCoincidenceRhythms(infile);
@@ -70054,7 +79501,7 @@ string Tool_composite::getCoincidenceToken(HumdrumFile& infile, int line) {
 		} else if (line == m_instrumentNameIndex) {
 			string output = "*I\"Coincidence";
 			if (m_eventQ) {
-				m_coincidenceEventCount = getEventCount(m_coincidence);
+				m_coincidenceEventCount = m_coincidenceEvents.count();
 				stringstream value;
 				value.str("");
 				value << "\\n(" << m_coincidenceEventCount << " event";
@@ -70116,7 +79563,7 @@ string Tool_composite::getFullCompositeToken(HumdrumFile& infile, int line) {
 		} else if (line == m_instrumentNameIndex) {
 			string output = "*I\"Composite";
 			if (m_eventQ) {
-				m_fullCompositeEventCount = getEventCount(m_fullComposite);
+				m_fullCompositeEventCount = m_fullCompositeEvents.count();
 				stringstream value;
 				value.str("");
 				value << "\\n(" << m_fullCompositeEventCount << " event";
@@ -70269,7 +79716,7 @@ string Tool_composite::getGroupCompositeToken(HumdrumFile& infile, int line, int
 			if (group == 0) {
 				string output = "*I\"Group A";
 				if (m_eventQ) {
-					m_groupAEventCount = getEventCount(m_groups.at(0));
+					m_groupAEventCount = m_groupEvents.at(0).count();
 					stringstream value;
 					value.str("");
 					value << "\\n(" << m_groupAEventCount << " event";
@@ -70283,7 +79730,7 @@ string Tool_composite::getGroupCompositeToken(HumdrumFile& infile, int line, int
 			} else {
 				string output = "*I\"Group B";
 				if (m_eventQ) {
-					m_groupBEventCount = getEventCount(m_groups.at(1));
+					m_groupBEventCount = m_groupEvents.at(1).count();
 					stringstream value;
 					value.str("");
 					value << "\\n(" << m_groupBEventCount << " event";
@@ -70395,69 +79842,146 @@ string Tool_composite::getMetricSymbol(HumdrumFile& infile, int line, const stri
 
 //////////////////////////////
 //
-// Tool_composite::analyzeFullCompositeRhythm --
+// Tool_composite::buildOnsetBitmaps -- Store the note states of each **kern
+//    track as bitmaps with one bit for each data line (slice) in the file.
+//    Slice start times are stored as integer ticks based on the tpq of the
+//    file, so rhythm durations can be calculated without HumNum arithmetic
+//    until they are rendered as **recip values.
 //
 
-void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
-
-	vector<HumNum> durations(infile.getLineCount());
+void Tool_composite::buildOnsetBitmaps(HumdrumFile& infile) {
+	m_tpq = infile.tpq();
+	m_sliceLine.clear();
+	m_sliceTick.clear();
+	m_lineSlice.resize(infile.getLineCount());
+	fill(m_lineSlice.begin(), m_lineSlice.end(), -1);
+	m_lineTick.resize(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
+		HumNum start = infile[i].getDurationFromStart();
+		m_lineTick[i] = (int64_t)start.getNumerator() * (m_tpq / start.getDenominator());
+		if (!infile[i].isData()) {
+			continue;
+		}
+		m_lineSlice[i] = (int)m_sliceLine.size();
+		m_sliceLine.push_back(i);
+		m_sliceTick.push_back(m_lineTick[i]);
 	}
+	// Rhythms end at the last line of the file (which is usually the same
+	// as the duration of the score).
+	m_endTick = m_lineTick.empty() ? 0 : m_lineTick.back();
 
-	vector<int> isRest(infile.getLineCount(), false);
-	vector<int> isNull(infile.getLineCount(), false);
-	vector<int> isSustain(infile.getLineCount(), false);
+	int slicecount = (int)m_sliceLine.size();
+	m_nonNullSlices.resize(slicecount);
+	m_graceSlices.resize(slicecount);
+	m_fullCompositeEvents.resize(slicecount);
+	m_coincidenceEvents.resize(slicecount);
+	m_groupEvents.resize(2);
+	m_groupEvents[0].resize(slicecount);
+	m_groupEvents[1].resize(slicecount);
+	m_voiceNotes.resize(infile.getMaxTrack() + 1);
+	m_voiceAttacks.resize(infile.getMaxTrack() + 1);
+	for (int i=0; i<(int)m_voiceNotes.size(); i++) {
+		m_voiceNotes[i].resize(slicecount);
+		m_voiceAttacks[i].resize(slicecount);
+	}
 
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (durations[i] == 0) {
-			continue;
+	for (int s=0; s<slicecount; s++) {
+		int i = m_sliceLine[s];
+		if (infile[i].getDuration() == 0) {
+			m_graceSlices.set(s);
 		}
-		bool allnull = true;
-		bool allrest = true;
-		bool allsustain = true;
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp tok = infile.token(i, j);
-			if (tok->isNull()) {
+			HTp token = infile.token(i, j);
+			if (token->isNull()) {
 				continue;
 			}
-			allnull = false;
-			if (!tok->isKern()) {
+			m_nonNullSlices.set(s);
+			if (!token->isKern()) {
 				continue;
 			}
-			if (tok->isNote()) {
-				allrest = false;
-				allnull = false;
-				if ((tok->find("_") == string::npos) &&
-				    (tok->find("]") == string::npos)) {
-					allsustain = false;
-				} else {
-				// 	cerr << "NOTE THAT IS SUSTAIN: " << tok << endl;
-				}
-			} else {
-				// cerr << "TOKEN IS NOT NOTE " << tok << endl;
+			if (!token->isNote()) {
+				continue;
 			}
-			if (tok->isRest()) {
-				allnull = false;
+			int track = token->getTrack();
+			m_voiceNotes[track].set(s);
+			if ((token->find('_') == string::npos) && (token->find(']') == string::npos)) {
+				m_voiceAttacks[track].set(s);
 			}
 		}
-		isRest[i]    = allrest    ? true : false;
-		isNull[i]    = allnull    ? true : false;
-		isSustain[i] = allsustain ? true : false;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::getStateBitmap -- Convert a list of note states for each
+//    line in the file into a bitmap of the slices that have a state in the
+//    range from minstate to maxstate (inclusive).
+//
+
+void Tool_composite::getStateBitmap(OnsetBitmap& bitmap, vector<int>& states,
+		int minstate, int maxstate) {
+	bitmap.resize((int)m_sliceLine.size());
+	for (int s=0; s<(int)m_sliceLine.size(); s++) {
+		int value = states.at(m_sliceLine[s]);
+		if ((value >= minstate) && (value <= maxstate)) {
+			bitmap.set(s);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::getSliceDuration -- Return the duration between the
+//    start of two slices.  If the ending slice is invalid, then the
+//    duration extends to the last line of the file.
+//
+
+HumNum Tool_composite::getSliceDuration(int startslice, int endslice) {
+	int64_t endtick = m_endTick;
+	if ((endslice >= 0) && (endslice < (int)m_sliceTick.size())) {
+		endtick = m_sliceTick[endslice];
+	}
+	return HumNum((int)(endtick - m_sliceTick.at(startslice)), m_tpq);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::analyzeFullCompositeRhythm -- The full composite rhythm
+//     is the union of the note states of each **kern track.  A composite
+//     note is sustained if there are no note attacks in any track, and a rest
+//     if no tracks contain notes.  The duration of a composite note extends
+//     to the next slice that is not null.
+//
+
+void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
+	int slicecount = (int)m_sliceLine.size();
+	OnsetBitmap notes(slicecount);
+	OnsetBitmap attacks(slicecount);
+	for (int i=0; i<(int)m_voiceNotes.size(); i++) {
+		notes   |= m_voiceNotes[i];
+		attacks |= m_voiceAttacks[i];
 	}
 
+	// Grace-note slices are not null, so they also end the previous rhythm:
+	OnsetBitmap stops = m_nonNullSlices;
+	stops |= m_graceSlices;
+
 	string pstring = m_pitch;
 	if (m_upstemQ) {
 		pstring += "/";
 	}
 
 	HumRegex hre;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
+	for (int s=0; s<slicecount; s++) {
+		int i = m_sliceLine[s];
 
-		if (infile[i].getDuration() == 0) {
+		if (m_graceSlices.test(s)) {
 			// Grace note data line (most likely)
 			if (!m_graceQ) {
 				continue;
@@ -70491,40 +80015,40 @@ void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
 					full += pstring;
 					full += beam;
 					m_fullComposite[i] = full;
+					m_fullCompositeEvents.set(s);
 					break;
 				}
 			}
 			continue;
 		}
 
-		HumNum duration = getLineDuration(infile, i, isNull);
-		string output;
-		if (isNull[i]) {
+		if (!m_nonNullSlices.test(s)) {
 			m_fullComposite[i] = ".";
 			continue;
-		} else {
-			output = Convert::durationToRecip(duration);
 		}
 
+		HumNum duration = getSliceDuration(s, stops.next(s+1));
+		string output = Convert::durationToRecip(duration);
+
 //		if (onlyAuxTremoloNotes(infile, i)) {
 //			// mark auxiliary notes so that they can be merged
 //			// with a preceding note later.
 //			output += COMPOSITE_TREMOLO_MARKER;
 //		}
 
-		if (isRest[i]) {
+		if (!notes.test(s)) {
 			output += "r";
 		} else {
 			output += pstring;
-			if (isSustain.at(i)) {
+			if (attacks.test(s)) {
+				m_fullCompositeEvents.set(s);
+			} else {
 				output += "]";
 			}
 		}
 		m_fullComposite[i] = output;
-		// cerr << output << "\tS:" << isSustain[i] << "\tR:" << isRest[i] << "\tN:" << isNull[i] << endl;
 	}
 
-
 	fixTiedNotes(m_fullComposite, infile);
 
 //	removeAuxTremolosFromCompositeRhythm(infile);
@@ -70580,7 +80104,13 @@ void Tool_composite::fixTiedNotes(vector<string>& data, HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_composite::analyzeCoincidenceRhythms --
+// Tool_composite::analyzeCoincidenceRhythms -- Coincidence rhythms are the
+//     intersection of the group A and B note states.  The state of each
+//     group is split into bitmaps:
+//        attack  = note attack in the group.
+//        tie     = sustained note that is printed (tied note).
+//        rest    = group is resting (or non-data).
+//     and then merged with bitwise operations.
 //
 
 void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
@@ -70594,87 +80124,67 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 	getNumericGroupStates(groupAstates, infile, "A");
 	getNumericGroupStates(groupBstates, infile, "B");
 
-	vector<HumNum> timestamps(infile.getLineCount(), 0);
-	for (int i=0; i<infile.getLineCount(); i++) {
-		timestamps[i] = infile[i].getDurationFromStart();
-	}
-
-	vector<int> merged(infile.getLineCount(), 0);
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (groupAstates.at(i) == groupBstates.at(i)) {
-			merged[i] = groupAstates.at(i);
-		} else if (groupAstates[i] == 0 || (groupBstates[i] == 0)) {
-			merged[i] = 0;
-		} else if ((groupAstates[i] > 0) && (groupBstates[i] < 0)) {
-			merged[i] = groupBstates[i];
-		} else if ((groupAstates[i] < 0) && (groupBstates[i] > 0)) {
-			merged[i] = groupAstates[i];
-		} else {
-			merged[i] = -1;
-		}
-	}
-
-	bool foundFirstAttackA = false;
-	bool foundFirstAttackB = false;
+	int slicecount = (int)m_sliceLine.size();
+	OnsetBitmap attackA;
+	OnsetBitmap attackB;
+	OnsetBitmap tieA;
+	OnsetBitmap tieB;
+	OnsetBitmap restA;
+	OnsetBitmap restB;
+	getStateBitmap(attackA, groupAstates, 1, 1);
+	getStateBitmap(attackB, groupBstates, 1, 1);
+	getStateBitmap(tieA, groupAstates, -2, -2);
+	getStateBitmap(tieB, groupBstates, -2, -2);
+	getStateBitmap(restA, groupAstates, 0, 0);
+	getStateBitmap(restB, groupBstates, 0, 0);
+
+	// Coincidences start only after both groups have had a note attack:
+	int startA = attackA.first();
+	int startB = attackB.first();
+	int start = slicecount;
+	if ((startA >= 0) && (startB >= 0)) {
+		start = startA > startB ? startA : startB;
+	}
+
+	// Merged attack: both groups have an attack.
+	OnsetBitmap attacks = attackA;
+	attacks &= attackB;
+	attacks.clearBefore(start);
+
+	// Merged tie: one group has a tied note and the other an attack or tied note.
+	OnsetBitmap ties = tieB;
+	ties |= attackB;
+	ties &= tieA;
+	OnsetBitmap tiesB = attackA;
+	tiesB &= tieB;
+	ties |= tiesB;
+	ties.clearBefore(start);
+
+	// Merged rest: either group is resting.
+	OnsetBitmap rests = restA;
+	rests |= restB;
+	rests.invert();
+	rests.clearBefore(start);
+	rests.invert();
+
+	// Rest onsets are rests that are not preceded by another rest.
+	OnsetBitmap restAttacks = rests;
+	OnsetBitmap prevRests = rests;
+	prevRests.shiftUp();
+	restAttacks.andNot(prevRests);
+
+	OnsetBitmap onsets = attacks;
+	onsets |= ties;
+	onsets |= restAttacks;
 
 	m_coincidence.resize(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
 		m_coincidence[i] = "";
 	}
 
-	vector<int> noteAttack(infile.getLineCount(), 0);
-	int currValue = -1000;
-	int lastValue = -1000;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		lastValue = currValue;
-		if (groupAstates[i] > 0) {
-			foundFirstAttackA = true;
-		}
-		if (groupBstates[i] > 0) {
-			foundFirstAttackB = true;
-		}
-		int value = merged[i];
-		if (!foundFirstAttackA) {
-			value = 0;
-		}
-		if (!foundFirstAttackB) {
-			value = 0;
-		}
-		currValue = value;
-
-		if (currValue == 1) {
-			noteAttack[i] = 1;
-		} else if (currValue == -2) {
-			// sustained note attack
-			noteAttack[i] = -2;
-		} else if ((currValue == 0) && (lastValue != 0)) {
-			noteAttack[i] = 2; // 2 means a "rest" note.
-		}
-	}
-
 	// Need to split rests across barlines (at least non-invisible ones).
 	// Also split rests if they generate an unprintable rhythm...
 
-	vector<int> nextAttackIndex(infile.getLineCount(), -1);
-	vector<int> prevAttackIndex(infile.getLineCount(), -1);
-	int lasti = 0;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (noteAttack[i] != 0) {
-			prevAttackIndex[i] = lasti;
-			lasti = i;
-		}
-	}
-	int nexti = infile.getLineCount() - 1;
-	for (int i=infile.getLineCount()-1; i>=0; i--) {
-		if (noteAttack[i] != 0) {
-			nextAttackIndex[i] = nexti;
-			nexti = i;
-		}
-	}
-
 	string lastnote = "";
 	HumNum remainder;
 	bool barline = false;
@@ -70705,59 +80215,64 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 				}
 			}
 		}
-		if (noteAttack[i]) {
-			HumNum duration = infile[nextAttackIndex[i]].getDurationFromStart() -
-				infile[i].getDurationFromStart();
-			HumNum durtobar = infile[i].getDurationToBarline();
-			if (duration > durtobar) {
-				// clip the duration to the duration of the rest of the measure
-				remainder = duration - durtobar;
-				duration = durtobar;
-			}
+		int s = m_lineSlice[i];
+		if ((s < 0) || !onsets.test(s)) {
+			continue;
+		}
+		int nexts = onsets.next(s+1);
+		HumNum duration = getSliceDuration(s, nexts);
+		HumNum durtobar = infile[i].getDurationToBarline();
+		if (duration > durtobar) {
+			// clip the duration to the duration of the rest of the measure
+			remainder = duration - durtobar;
+			duration = durtobar;
+		}
+		bool nextAttack = (nexts >= 0) && !ties.test(nexts);
+		bool nextTie = (nexts >= 0) && ties.test(nexts);
 
-			string recip = Convert::durationToRecip(duration);
-			string text;
-			if (noteAttack[i] == -2) {
-				text = recip + "eR";
-				// this is either a middle tie if next note is also a tie
-				// or is a tie end if the next note is an attack (1) or rest (2)
-				if (noteAttack[nextAttackIndex[i]] > 0) {
-					// tie end
-					if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
-						m_coincidence[i] = recip + "r";
-						// previous note is not a tie, so switch this note to a rest from
-						// a sustained tied note
+		string recip = Convert::durationToRecip(duration);
+		string text;
+		if (ties.test(s)) {
+			text = recip + "eR";
+			// this is either a middle tie if next note is also a tie
+			// or is a tie end if the next note is an attack or rest
+			if (nextAttack) {
+				// tie end
+				if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
+					m_coincidence[i] = recip + "r";
+					// previous note is not a tie, so switch this note to a rest from
+					// a sustained tied note
 
-					} else {
-						m_coincidence[i] = text;
-						m_coincidence[i] += "]";
-					}
-					lastnote = m_coincidence[i];
-				} else {
-					// tie middle
-					if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
-						m_coincidence[i] = text + "[";
-					} else {
-						m_coincidence[i] = text + "_";
-					}
-					lastnote = m_coincidence[i];
-				}
-			} else if (noteAttack[i] == 1) {
-				text = recip + "eR";
-				// Start a tie if the next note is a tied note
-				if (noteAttack[nextAttackIndex[i]] == -2) {
-					m_coincidence[i] = "[" + text;
-					lastnote = m_coincidence[i];
 				} else {
 					m_coincidence[i] = text;
-					lastnote = m_coincidence[i];
+					m_coincidence[i] += "]";
+				}
+				lastnote = m_coincidence[i];
+			} else {
+				// tie middle
+				if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
+					m_coincidence[i] = text + "[";
+					m_coincidenceEvents.set(s);
+				} else {
+					m_coincidence[i] = text + "_";
 				}
-			} else if (noteAttack[i] == 2) {
-				// rest
-				text = recip + "r";
-				m_coincidence[i] = text;
 				lastnote = m_coincidence[i];
 			}
+		} else if (attacks.test(s)) {
+			text = recip + "eR";
+			// Start a tie if the next note is a tied note
+			if (nextTie) {
+				m_coincidence[i] = "[" + text;
+			} else {
+				m_coincidence[i] = text;
+			}
+			m_coincidenceEvents.set(s);
+			lastnote = m_coincidence[i];
+		} else {
+			// rest
+			text = recip + "r";
+			m_coincidence[i] = text;
+			lastnote = m_coincidence[i];
 		}
 	}
 
@@ -70765,13 +80280,15 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 
 	if (m_debugQ) {
 		cerr << "MERGED Coincidence states:" << endl;
-		cerr << "TS\tA\tB\tMerged\tAttack\tIndex\tNext\tPrev\tCoin\tInput\n";
-		for (int i=0; i<(int)merged.size(); i++) {
-			cerr << timestamps[i] << "\t";
+		cerr << "TS\tA\tB\tAttack\tTie\tRest\tIndex\tCoin\tInput\n";
+		for (int i=0; i<infile.getLineCount(); i++) {
+			int s = m_lineSlice[i];
+			cerr << infile[i].getDurationFromStart() << "\t";
 			cerr << groupAstates[i] << "\t" << groupBstates[i];
-			cerr << "\t" << merged[i] << "\t" << noteAttack[i];
+			cerr << "\t" << ((s >= 0) && attacks.test(s));
+			cerr << "\t" << ((s >= 0) && ties.test(s));
+			cerr << "\t" << ((s >= 0) && restAttacks.test(s));
 			cerr << "\t" << i;
-			cerr << "\t" << nextAttackIndex[i] << "\t" << prevAttackIndex[i];
 			cerr << "\t" << m_coincidence[i];
 			cerr << "\t" << infile[i] << endl;
 		}
@@ -70900,45 +80417,6 @@ void Tool_composite::getNumericGroupStates(vector<int>& states,
 //
 
 void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
-	vector<HumNum> durations(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
-	}
-
-	vector<int> isRest(infile.getLineCount(), false);
-	vector<int> isNull(infile.getLineCount(), false);
-
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (durations[i] == 0) {
-			continue;
-		}
-		bool allnull = true;
-		bool allrest = true;
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp tok = infile.token(i, j);
-			string value = tok->getValue("auto", "ignoreTremoloNote");
-			if (value == "1") {
-				continue;
-			}
-			if (tok->isNull()) {
-				continue;
-			}
-			allnull = false;
-			if (!tok->isKern()) {
-				continue;
-			}
-			if (tok->isNote()) {
-				allrest = false;
-				break;
-			}
-			if (tok->isRest()) {
-				allnull = false;
-			}
-		}
-		isRest[i] = allrest ? true : false;
-		isNull[i] = allnull ? true : false;
-	}
-
 	string pstring = m_pitch;
 	if (m_upstemQ) {
 		pstring += "/";
@@ -70956,6 +80434,11 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 
 	vector<vector<int>> groupstates;
 	getGroupStates(groupstates, infile);
+	for (int i=0; i<(int)m_groupEvents.size(); i++) {
+		// Grace notes are added as events below if they are displayed:
+		getStateBitmap(m_groupEvents[i], groupstates[i], TYPE_NoteAttack, TYPE_NoteAttack);
+		m_groupEvents[i].andNot(m_graceSlices);
+	}
 
 	vector<vector<HumNum>> groupdurs;
 	getGroupDurations(groupdurs, groupstates, infile);
@@ -71021,8 +80504,10 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 					string group = infile.token(i, j)->getValue("auto", "group");
 					if (group == "A") {
 						m_groups[0][i] = full;
+						m_groupEvents[0].set(m_lineSlice[i]);
 					} else if (group == "B") {
 						m_groups[1][i] = full;
+						m_groupEvents[1].set(m_lineSlice[i]);
 					}
 					break;
 				}
@@ -71031,7 +80516,6 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 		}
 
 		// dealing with a non-zero data line:
-		HumNum duration = getLineDuration(infile, i, isNull);
 		string recip = rhythms[0][i];
 		string recip2 = rhythms[1][i];
 		if (recip.empty()) {
@@ -71141,7 +80625,11 @@ void Tool_composite::getGroupRhythms(vector<string>& rhythms, vector<HumNum>& du
 
 //////////////////////////////
 //
-// Tool_composite::getGroupDurations --
+// Tool_composite::getGroupDurations -- Calculate the durations of
+//    group events (lines that have a positive group state).  Each event
+//    lasts until the next event, or to the end of the score for the last
+//    event.  Non-data lines do not have a group state, so they are also
+//    events (TYPE_UNDEFINED) that end the previous event.
 //
 
 void Tool_composite::getGroupDurations(vector<vector<HumNum>>& groupdurs,
@@ -71154,28 +80642,23 @@ void Tool_composite::getGroupDurations(vector<vector<HumNum>>& groupdurs,
 
 void Tool_composite::getGroupDurations(vector<HumNum>& groupdurs,
 		vector<int>& groupstates, HumdrumFile& infile) {
-	HumNum enddur = infile.getScoreDuration();
 	groupdurs.resize(groupstates.size());
 	fill(groupdurs.begin(), groupdurs.end(), -1);
 	int eventi = -1;
-	HumNum lasttime = 0;
+	int64_t lasttick = 0;
 	for (int i=0; i<(int)groupdurs.size(); i++) {
-		if (groupstates[i] > 0) {
-			if (eventi >= 0) {
-				HumNum eventtime = infile[i].getDurationFromStart();
-				HumNum duration = eventtime - lasttime;
-				groupdurs[eventi] = duration;
-				lasttime = eventtime;
-				eventi = i;
-				continue;
-			} else {
-				eventi = i;
-			}
+		if (groupstates[i] <= 0) {
+			continue;
+		}
+		if (eventi >= 0) {
+			groupdurs[eventi] = HumNum((int)(m_lineTick[i] - lasttick), m_tpq);
+			lasttick = m_lineTick[i];
 		}
+		eventi = i;
 	}
 	if (eventi >= 0) {
-		HumNum duration = enddur - lasttime;
-		groupdurs[eventi] = duration;
+		HumNum enddur = infile.getScoreDuration();
+		groupdurs[eventi] = enddur - HumNum((int)lasttick, m_tpq);
 	}
 }
 
@@ -71227,35 +80710,6 @@ void Tool_composite::getGroupStates(vector<vector<int>>& groupstates, HumdrumFil
 
 
 
-//////////////////////////////
-//
-// Tool_composite::getLineDuration -- Return the duration of the line, but return
-//    0 if the line only contains nulls.  Also add the duration of any subsequent
-//    lines that are null lines before any data content lines.
-
-HumNum Tool_composite::getLineDuration(HumdrumFile& infile, int index, vector<int>& isNull) {
-	if (isNull[index]) {
-		return 0;
-	}
-	if (!infile[index].isData()) {
-		return 0;
-	}
-	HumNum output = infile[index].getDuration();
-	for (int i=index+1; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		if (isNull[i]) {
-			output += infile[i].getDuration();
-		} else {
-			break;
-		}
-	}
-	return output;
-}
-
-
-
 //////////////////////////////
 //
 // Tool_composite::assignGroups -- Add a parameter
@@ -72390,42 +81844,6 @@ void Tool_composite::convertNotesToRhythms(HumdrumFile& infile) {
 
 
 
-//////////////////////////////
-//
-// getEventCount -- Return the number of note attacks.
-//
-
-int Tool_composite::getEventCount(vector<string>& data) {
-	int output = 0;
-	for (int i=0; i<(int)data.size(); i++) {
-		if (data[i] == "") {
-			continue;
-		}
-		if (data[i] == ".") {
-			continue;
-		}
-		if (data[i].find("*") != string::npos) {
-			continue;
-		}
-		if (data[i].find("!") != string::npos) {
-			continue;
-		}
-		if (data[i].find("r") != string::npos) {
-			continue;
-		}
-		if (data[i].find("_") != string::npos) {
-			continue;
-		}
-		if (data[i].find("]") != string::npos) {
-			continue;
-		}
-		output++;
-	}
-	return output;
-}
-
-
-
 
 
 // Note state variables for grouping:
@@ -76114,18 +85532,6 @@ void Tool_compositeold::addVerseLabels2(HumdrumFile& infile, HTp spinestart) {
 
 
 
-/////////////////////////////////
-//
-// Tool_deg::ScaleDegree static member variables:
-//
-
-bool Tool_deg::ScaleDegree::m_showTiesQ  = false;
-bool Tool_deg::ScaleDegree::m_showZerosQ = false;
-bool Tool_deg::ScaleDegree::m_octaveQ = false;
-string Tool_deg::ScaleDegree::m_forcedKey = "";
-
-
-
 /////////////////////////////////
 //
 // Tool_deg::Tool_deg -- Set the recognized options for the tool.
@@ -76144,6 +85550,7 @@ Tool_deg::Tool_deg(void) {
 	define("k|kern-tracks=s",                            "process only the specified kern spines");
 	define("kd|dk|key-default|default-key=s",            "default (initial) key if none specified in data");
 	define("kf|fk|key-force|force-key|forced-key=s",     "use the given key for analysing deg data (ignore modulations)");
+	define("ke|ek|key-estimate|estimate-key=b",          "estimate local keys from the notes where no key designation is given");
 	define("o|octave|octaves|degree=b",                  "encode octave information int **degree spines");
 	define("r|recip=b",                                  "prefix output data with **recip spine with -I option");
 	define("t|ties=b",                                   "include scale degrees for tied notes");
@@ -76224,7 +85631,7 @@ void Tool_deg::initialize(void) {
 		m_recipQ = true;
 	}
 	m_degTiesQ = getBoolean("ties");
-	Tool_deg::ScaleDegree::setShowOctaves(getBoolean("octave"));
+	m_degOptions.octaveQ = getBoolean("octave");
 
 	if (getBoolean("spine-tracks")) {
 		m_spineTracks = getString("spine-tracks");
@@ -76232,6 +85639,9 @@ void Tool_deg::initialize(void) {
 		m_kernTracks = getString("kern-tracks");
 	}
 
+	m_estimateKeyQ = getBoolean("estimate-key");
+
+	m_defaultKey.clear();
 	if (getBoolean("default-key")) {
 		m_defaultKey = getString("default-key");
 		if (!m_defaultKey.empty()) {
@@ -76255,12 +85665,12 @@ void Tool_deg::initialize(void) {
 			if (m_forcedKey.find(":") == string::npos) {
 				m_forcedKey += ":";
 			}
-			Tool_deg::ScaleDegree::setForcedKey(m_forcedKey);
 		}
 	}
 
-	Tool_deg::ScaleDegree::setShowTies(m_degTiesQ);
-	Tool_deg::ScaleDegree::setShowZeros(getBoolean("zeros"));
+	m_degOptions.forcedKey  = m_forcedKey;
+	m_degOptions.showTiesQ  = m_degTiesQ;
+	m_degOptions.showZerosQ = getBoolean("zeros");
 }
 
 
@@ -76276,6 +85686,18 @@ void Tool_deg::processFile(HumdrumFile& infile) {
 		return;
 	}
 
+	if (m_estimateKeyQ && m_forcedKey.empty()) {
+		m_keyEstimator.analyze(infile);
+		if (m_defaultKey.empty()) {
+			for (int i=0; i<infile.getLineCount(); i++) {
+				if (infile[i].isData()) {
+					m_defaultKey = m_keyEstimator.getKeyDesignation(i);
+					break;
+				}
+			}
+		}
+	}
+
 	// Create storage space for scale degree analyses:
 	int kernCount = (int)m_selectedKernSpines.size();
 	m_degSpines.resize(kernCount);
@@ -77578,17 +87000,28 @@ void Tool_deg::prepareDegSpine(vector<vector<ScaleDegree>>& degspine, HTp kernst
 
 	bool isUnpitched = false;
 
+	// Follow the estimated local key until the spine gives its own key:
+	bool estimateQ = m_estimateKeyQ && m_forcedKey.empty();
+	string estimate = m_defaultKey;
+
 	while (current) {
 		int line = current->getLineIndex();
 		if (!current->getOwner()->hasSpines()) {
 			degspine.at(line).resize(1);
 			degspine.at(line).back().setLinkedKernToken(current, mode, b40tonic, isUnpitched);
+			degspine.at(line).back().setOptions(&m_degOptions);
 			current = current->getNextToken();
 			continue;
 		}
 		if (current->isKeyDesignation()) {
 			getModeAndTonic(mode, b40tonic, *current);
-
+			estimateQ = false;
+		} else if (estimateQ && current->isData()) {
+			string key = m_keyEstimator.getKeyDesignation(line);
+			if (!key.empty() && (key != estimate)) {
+				getModeAndTonic(mode, b40tonic, key);
+				estimate = key;
+			}
 		}
 		if (current->isClef()) {
 			if (*current == "*clefX") {
@@ -77606,6 +87039,7 @@ void Tool_deg::prepareDegSpine(vector<vector<ScaleDegree>>& degspine, HTp kernst
 			}
 			degspine.at(line).resize((int)degspine.at(line).size() + 1);
 			degspine.at(line).back().setLinkedKernToken(curr, mode, b40tonic, isUnpitched);
+			degspine.at(line).back().setOptions(&m_degOptions);
 			curr = curr->getNextFieldToken();
 		}
 		current = current->getNextToken();
@@ -77911,6 +87345,22 @@ HTp Tool_deg::ScaleDegree::getLinkedKernToken(void) const {
 
 
 
+//////////////////////////////
+//
+// Tool_deg::ScaleDegree::getOptions -- Return the rendering options set by
+//     the owning Tool_deg, or the default options if none were given.
+//
+
+const Tool_deg::ScaleDegreeOptions& Tool_deg::ScaleDegree::getOptions(void) const {
+	static const ScaleDegreeOptions defaults;
+	if (m_options) {
+		return *m_options;
+	}
+	return defaults;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_deg::ScaleDegree:getDegToken -- Convert the ScaleDegre
@@ -77928,7 +87378,7 @@ string Tool_deg::ScaleDegree::getDegToken(void) const {
 	}
 
 	if (isExclusiveInterpretation()) {
-		if (m_octaveQ) {
+		if (getOptions().octaveQ) {
 			return "**degree";
 		} else {
 			return "**deg";
@@ -77937,7 +87387,7 @@ string Tool_deg::ScaleDegree::getDegToken(void) const {
 		return getManipulator();
 	} else if (isInterpretation()) {
 		if (isKeyDesignation()) {
-			if (m_forcedKey.empty()) {
+			if (getOptions().forcedKey.empty()) {
 				return *token;
 			} else{
 				return "*";
@@ -77994,7 +87444,7 @@ string Tool_deg::ScaleDegree::generateDegDataToken(void) const {
 
 	// Include tied notes or suppress them:
 
-	if (m_showTiesQ)  {
+	if (getOptions().showTiesQ)  {
 		// Secondary tied notes scale degrees should be shown.
 		string output;
 		for (int i=0; i<subtokenCount; i++) {
@@ -78061,7 +87511,7 @@ string Tool_deg::ScaleDegree::generateDegDataSubtoken(int index) const {
 	int degree = m_degrees.at(index);
 	if (degree == 0) {
 		output += "r";
-		if (m_showZerosQ) {
+		if (getOptions().showZerosQ) {
 			output += "0";
 		}
    } else if ((degree > 0) && (degree <= 7)) {
@@ -78082,7 +87532,7 @@ string Tool_deg::ScaleDegree::generateDegDataSubtoken(int index) const {
 	}
 
 	// Add octave information if requested:
-	if (m_octaveQ && (degree != 0)) {
+	if (getOptions().octaveQ && (degree != 0)) {
 		output += "/";
 		output += to_string(m_octaves.at(index));
 	}
@@ -83592,9 +93042,14 @@ void Tool_esac2hum::printPdfLinks(ostream& output) {
 
 void Tool_esac2hum::printConversionDate(ostream& output) {
 	std::time_t t = std::time(nullptr);
-	std::tm* now = std::localtime(&t);
+	std::tm now;
+#ifdef _WIN32
+	localtime_s(&now, &t);
+#else
+	localtime_r(&t, &now);
+#endif
 	output << "!!!ONB: Converted on ";
-	output << std::put_time(now, "%Y/%m/%d");
+	output << std::put_time(&now, "%Y/%m/%d");
 	output << " with esac2hum" << endl;
 }
 
@@ -85982,7 +95437,10 @@ bool Tool_extract::run(HumdrumFile& infile, ostream& out) {
 //
 
 bool Tool_extract::run(HumdrumFile& infile) {
-	initialize(infile);
+	initialize();
+	if (rkernQ) {
+		fieldstring = reverseFieldString(getString("K"), infile.getMaxTrack());
+	}
 	processFile(infile);
 	// Re-load the text for each line from their tokens.
 	// infile.createLinesFromTokens();
@@ -85991,6 +95449,285 @@ bool Tool_extract::run(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_extract::run -- Process the input one line at a time.  Spine
+//    selections which only depend on track numbers are extracted directly
+//    from the line stream.  Other options need a complete segment, so the
+//    input is processed one segment at a time for them.
+//
+
+bool Tool_extract::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	if (hasAnyText() || !isStreamable()) {
+		clearOutput();
+		return processSegments(instream, out);
+	}
+
+	// A segment which does not start with all of the tracks in the field
+	// list is read into a HumdrumFile so that invalid field entries are
+	// handled in the same way as when extracting from a file.
+	int maxfield = getMaxFieldNumber(fieldstring);
+	bool status = true;
+	bool active = false;
+	bool checked = false;
+	bool buffered = false;
+	int maxtrack = 0;
+	string filename;
+	stringstream segment;
+	while (true) {
+		bool found = instream.readLine();
+		if ((!found || instream.isSegmentStart()) && active) {
+			if (countQ) {
+				out << maxtrack << endl;
+			} else if (buffered) {
+				status &= processSegment(segment, filename, out);
+			}
+		}
+		if (!found) {
+			break;
+		}
+		if (instream.isSegmentStart()) {
+			filename = instream.getFilename();
+			checked = false;
+			buffered = false;
+		}
+		active = true;
+		maxtrack = instream.getMaxTrack();
+		if (countQ) {
+			continue;
+		}
+		if (!checked && instream.hasSpines()) {
+			checked = true;
+			if (fieldQ || excludeQ) {
+				if (maxfield > maxtrack) {
+					buffered = true;
+				} else {
+					fillFieldData(field, subfield, model, fieldstring, maxtrack, NULL);
+				}
+			}
+		}
+		if (buffered) {
+			segment << instream.getLine() << '\n';
+			continue;
+		}
+		if (fieldQ) {
+			extractLine(instream);
+		} else if (excludeQ) {
+			excludeLine(instream);
+		} else {
+			m_humdrum_text << instream.getLine() << '\n';
+		}
+		out << m_humdrum_text.str();
+		m_humdrum_text.str("");
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::isStreamable -- Returns true if the options only
+//    need the track numbers of each line.
+//
+
+bool Tool_extract::isStreamable(void) {
+	if (expandQ || interpQ || reverseQ || removerestQ || grepQ || emptyQ ||
+			noEmptyQ || kernQ || rkernQ || traceQ || spineListQ || debugQ ||
+			addRestsQ) {
+		return false;
+	}
+	if (countQ) {
+		return true;
+	}
+	if (fieldQ || excludeQ) {
+		// Only plain track numbers and ranges (no $, subspines or models).
+		for (int i=0; i<(int)fieldstring.size(); i++) {
+			char ch = fieldstring[i];
+			if (!(isdigit(ch) || isspace(ch) || (ch == ',') || (ch == '-'))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::getMaxFieldNumber -- Return the largest number in a field
+//     list string.
+//
+
+int Tool_extract::getMaxFieldNumber(const string& fieldstring) {
+	int output = 0;
+	int value = 0;
+	for (int i=0; i<(int)fieldstring.size(); i++) {
+		if (isdigit(fieldstring[i])) {
+			value = value * 10 + (fieldstring[i] - '0');
+			if (value > output) {
+				output = value;
+			}
+		} else {
+			value = 0;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::processSegments -- Read each segment of the line stream
+//    into a HumdrumFile for options which need the full file.
+//
+
+bool Tool_extract::processSegments(HumdrumLineStream& instream, ostream& out) {
+	bool status = true;
+	bool active = false;
+	string filename;
+	stringstream segment;
+	while (true) {
+		bool found = instream.readLine();
+		if ((!found || instream.isSegmentStart()) && active) {
+			status &= processSegment(segment, filename, out);
+		}
+		if (!found) {
+			break;
+		}
+		if (instream.isSegmentStart()) {
+			filename = instream.getFilename();
+		}
+		active = true;
+		segment << instream.getLine() << '\n';
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::processSegment -- Process the lines of a segment as a
+//    HumdrumFile, print the results and clear the segment contents.
+//
+
+bool Tool_extract::processSegment(stringstream& segment, const string& filename,
+		ostream& out) {
+	HumdrumFile infile;
+	infile.readNoRhythm(segment);
+	infile.setFilename(filename);
+	infile.setFilenameFromSegment();
+	bool status = run(infile);
+	getAllText(out);
+	m_humdrum_text.str("");
+	m_json_text.str("");
+	m_free_text.str("");
+	segment.str("");
+	segment.clear();
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::extractLine -- Print the listed tracks of a line from a
+//    line stream.
+//
+
+void Tool_extract::extractLine(HumdrumLineStream& line) {
+	if (!line.hasSpines()) {
+		m_humdrum_text << line.getLine() << '\n';
+		return;
+	}
+
+	if (line.isManipulator()) {
+		int count = line.getFieldCount();
+		vector<string> spineinfo(count);
+		for (int j=0; j<count; j++) {
+			spineinfo[j] = line.getSpineInfo(j);
+		}
+		dealWithSpineManipulators(line.getTokens(), line.getTracks(), spineinfo,
+				line.getLine(), line.getMaxTrack(), field, subfield, model);
+		return;
+	}
+
+	int start = 0;
+	for (int t=0; t<(int)field.size(); t++) {
+		int target = field[t];
+		if (target == 0) {
+			if (start != 0) {
+				m_humdrum_text << '\t';
+			}
+			start = 1;
+			if (line.isLocalComment()) {
+				m_humdrum_text << "!";
+			} else if (line.isBarline()) {
+				m_humdrum_text << line.getToken(0);
+			} else if (line.isData()) {
+				m_humdrum_text << ".";
+			} else if (line.isInterpretation()) {
+				HumdrumToken token(line.getToken(0));
+				if (token.isExpansionLabel() || token.isExpansionList()) {
+					m_humdrum_text << token;
+				} else {
+					m_humdrum_text << "*";
+				}
+			}
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			if (line.getTrack(j) != target) {
+				continue;
+			}
+			if (start != 0) {
+				m_humdrum_text << '\t';
+			}
+			start = 1;
+			m_humdrum_text << line.getToken(j);
+		}
+	}
+
+	if (start != 0) {
+		m_humdrum_text << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::excludeLine -- Print all tracks of a line from a line
+//    stream except the ones in the list of fields.
+//
+
+void Tool_extract::excludeLine(HumdrumLineStream& line) {
+	if (!line.hasSpines()) {
+		m_humdrum_text << line.getLine() << '\n';
+		return;
+	}
+	int start = 0;
+	for (int j=0; j<line.getFieldCount(); j++) {
+		if (isInList(line.getTrack(j), field)) {
+			continue;
+		}
+		if (start != 0) {
+			m_humdrum_text << '\t';
+		}
+		start = 1;
+		m_humdrum_text << line.getToken(j);
+	}
+	if (start != 0) {
+		m_humdrum_text << endl;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_extract::processFile --
@@ -86589,8 +96326,17 @@ void Tool_extract::reverseSpines(vector<int>& field, vector<int>& subfield,
 
 void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 		vector<int>& model, string& fieldstring, HumdrumFile& infile) {
+	fillFieldData(field, subfield, model, fieldstring, infile.getMaxTrack(), &infile);
+}
 
-	int maxtrack = infile.getMaxTrack();
+
+//
+// Field list for a given maximum track number (infile is only needed
+// for -k and -K extraction).
+//
+
+void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
+		vector<int>& model, string& fieldstring, int maxtrack, HumdrumFile* infile) {
 
 	field.reserve(maxtrack);
 	field.resize(0);
@@ -86613,7 +96359,8 @@ void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 		tempfield.clear();
 		tempsubfield.clear();
 		tempmodel.clear();
-		processFieldEntry(tempfield, tempsubfield, tempmodel, hre.getMatch(1), infile);
+		processFieldEntry(tempfield, tempsubfield, tempmodel, hre.getMatch(1),
+				maxtrack, infile);
 		start += hre.getMatchEndIndex(1);
 		field.insert(field.end(), tempfield.begin(), tempfield.end());
 		subfield.insert(subfield.end(), tempsubfield.begin(), tempsubfield.end());
@@ -86633,13 +96380,14 @@ void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 
 void Tool_extract::processFieldEntry(vector<int>& field,
 		vector<int>& subfield, vector<int>& model, const string& astring,
-		HumdrumFile& infile) {
+		int maxtrack, HumdrumFile* infile) {
 
 	int finitsize = (int)field.size();
-	int maxtrack = infile.getMaxTrack();
 
 	vector<HTp> ktracks;
-	infile.getKernSpineStartList(ktracks);
+	if (infile) {
+		infile->getKernSpineStartList(ktracks);
+	}
 	int maxkerntrack = (int)ktracks.size();
 
 	int modletter;
@@ -86746,7 +96494,7 @@ void Tool_extract::processFieldEntry(vector<int>& field,
 		}
 	}
 
-	if (!kernQ) {
+	if (!kernQ || !infile) {
 		return;
 	}
 
@@ -86756,7 +96504,7 @@ void Tool_extract::processFieldEntry(vector<int>& field,
 	vector<int> newmodel;
 
 	vector<HTp> trackstarts;
-	infile.getTrackStartList(trackstarts);
+	infile->getTrackStartList(trackstarts);
 	int spine;
 
 	// convert kern tracks into spine tracks:
@@ -87330,22 +97078,46 @@ void Tool_extract::getSearchPat(string& spat, int target, const string& modifier
 
 void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 		vector<int>& field, vector<int>& subfield, vector<int>& model) {
+	int count = infile[line].getFieldCount();
+	vector<string> tokens(count);
+	vector<int> tracks(count);
+	vector<string> spineinfo(count);
+	for (int j=0; j<count; j++) {
+		HTp token = infile.token(line, j);
+		tokens[j] = *token;
+		tracks[j] = token->getTrack();
+		spineinfo[j] = token->getSpineInfo();
+	}
+	dealWithSpineManipulators(tokens, tracks, spineinfo, infile[line],
+			infile.getMaxTrack(), field, subfield, model);
+}
+
+
+//
+// Spine manipulator processing on the contents of a line (also used
+// when reading from a HumdrumLineStream).
+//
+
+void Tool_extract::dealWithSpineManipulators(const vector<string>& tokens,
+		const vector<int>& tracks, const vector<string>& spineinfo,
+		const string& linetext, int maxtrack, vector<int>& field,
+		vector<int>& subfield, vector<int>& model) {
 
 	vector<int> vmanip;  // counter for *v records on line
-	vmanip.resize(infile[line].getFieldCount());
+	vmanip.resize((int)tokens.size());
 	fill(vmanip.begin(), vmanip.end(), 0);
 
 	vector<int> xmanip; // counter for *x record on line
-	xmanip.resize(infile[line].getFieldCount());
+	xmanip.resize((int)tokens.size());
 	fill(xmanip.begin(), xmanip.end(), 0);
 
 	int i = 0;
 	int j;
 	for (j=0; j<(int)vmanip.size(); j++) {
-		if (*infile.token(line, j) == "*v") {
+		if (tokens[j] == "*v") {
 			vmanip[j] = 1;
 		}
-		if (*infile.token(line, j) == "*x") {
+		if (tokens[j] == "*x") {
 			xmanip[j] = 1;
 		}
 	}
@@ -87377,11 +97149,15 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 	fill(fieldoccur.begin(), fieldoccur.end(), 0);
 
 	vector<int> trackcounter; // counter of input spines occurances in output
-	trackcounter.resize(infile.getMaxTrack()+1);
+	trackcounter.resize(maxtrack+1);
 	fill(trackcounter.begin(), trackcounter.end(), 0);
 
 	for (i=0; i<(int)field.size(); i++) {
 		if (field[i] != 0) {
+			if (field[i] >= (int)trackcounter.size()) {
+				// track not yet present in a streamed segment
+				trackcounter.resize(field[i]+1, 0);
+			}
 			trackcounter[field[i]]++;
 			fieldoccur[i] = trackcounter[field[i]];
 		}
@@ -87430,13 +97206,13 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 		}
 		suppress = 0;
 		if (target == 0) {
-			if (infile.token(line, 0)->compare(0, 2, "**") == 0) {
+			if (tokens[0].compare(0, 2, "**") == 0) {
 				storeToken(tempout, blankName);
 				tval = 0;
 				vserial.push_back(tval);
 				xserial.push_back(tval);
 				fpos.push_back(tval);
-			} else if (*infile.token(line, 0) == "*-") {
+			} else if (tokens[0] == "*-") {
 				storeToken(tempout, "*-");
 				tval = 0;
 				vserial.push_back(tval);
@@ -87450,19 +97226,19 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 				fpos.push_back(tval);
 			}
 		} else {
-			for (j=0; j<infile[line].getFieldCount(); j++) {
-				if (infile[line].token(j)->getTrack() != target) {
+			for (j=0; j<(int)tokens.size(); j++) {
+				if (tracks[j] != target) {
 					continue;
 				}
 		// filter by subfield
 		if (subtarget == 'a') {
 			getSearchPat(spat, target, "b");
-			if (hre.search(infile.token(line, j)->getSpineInfo(), spat)) {
+			if (hre.search(spineinfo[j], spat)) {
 						continue;
 			}
 		} else if (subtarget == 'b') {
 			getSearchPat(spat, target, "a");
-			if (hre.search(infile.token(line, j)->getSpineInfo(), spat)) {
+			if (hre.search(spineinfo[j], spat)) {
 				continue;
 			}
 		}
@@ -87470,29 +97246,29 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 				switch (subtarget) {
 				case 'a':
 
-					if (!hre.search(infile.token(line, j)->getSpineInfo(), "\\(")) {
-						if (*infile.token(line, j)  == "*^") {
+					if (!hre.search(spineinfo[j], "\\(")) {
+						if (tokens[j]  == "*^") {
 							 storeToken(tempout, "*");
 						} else {
-							 storeToken(tempout, *infile.token(line, j));
+							 storeToken(tempout, tokens[j]);
 						}
 					} else {
 						getSearchPat(spat, target, "a");
-						spinepat =  infile.token(line, j)->getSpineInfo();
+						spinepat =  spineinfo[j];
 						hre.replaceDestructive(spinepat, "\\(", "\\(", "g");
 						hre.replaceDestructive(spinepat, "\\)", "\\)", "g");
 
-						if ((*infile.token(line, j) == "*v") &&
+						if ((tokens[j] == "*v") &&
 							    (spinepat == spat)) {
 							 storeToken(tempout, "*");
 						} else {
 							getSearchPat(spat, target, "b");
 							if ((spinepat == spat) &&
-									(*infile.token(line, j) ==  "*v")) {
+									(tokens[j] ==  "*v")) {
 								// do nothing
 								suppress = 1;
 							} else {
-								storeToken(tempout, *infile.token(line, j));
+								storeToken(tempout, tokens[j]);
 							}
 						}
 					}
@@ -87500,29 +97276,29 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 					break;
 				case 'b':
 
-					if (!hre.search(infile.token(line, j)->getSpineInfo(), "\\(")) {
-						if (*infile.token(line, j) == "*^") {
+					if (!hre.search(spineinfo[j], "\\(")) {
+						if (tokens[j] == "*^") {
 							storeToken(tempout, "*");
 						} else {
-							storeToken(tempout, *infile.token(line, j));
+							storeToken(tempout, tokens[j]);
 						}
 					} else {
 						getSearchPat(spat, target, "b");
-						spinepat = infile.token(line, j)->getSpineInfo();
+						spinepat = spineinfo[j];
 						hre.replaceDestructive(spinepat, "\\(", "\\(", "g");
 						hre.replaceDestructive(spinepat, "\\)", "\\)", "g");
 
-						if ((*infile.token(line, j) ==  "*v") &&
+						if ((tokens[j] ==  "*v") &&
 								(spinepat == spat)) {
 							storeToken(tempout, "*");
 						} else {
 							getSearchPat(spat, target, "a");
 							if ((spinepat == spat) &&
-									(*infile.token(line, j) == "*v")) {
+									(tokens[j] == "*v")) {
 								// do nothing
 								suppress = 1;
 							} else {
-								storeToken(tempout, *infile.token(line, j));
+								storeToken(tempout, tokens[j]);
 							}
 						}
 					}
@@ -87530,10 +97306,10 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 					break;
 				case 'c':
 					// work on later
-					storeToken(tempout, *infile.token(line, j));
+					storeToken(tempout, tokens[j]);
 					break;
 				default:
-					storeToken(tempout, *infile.token(line, j));
+					storeToken(tempout, tokens[j]);
 				}
 
 				if (suppress) {
@@ -87573,7 +97349,7 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 	}
 
 	if (debugQ && vdebug) {
-		m_humdrum_text << "!!LINE: " << infile[line] << endl;
+		m_humdrum_text << "!!LINE: " << linetext << endl;
 		m_humdrum_text << "!! *v serials = ";
 		for (int ii=0; ii<(int)vserial.size(); ii++) {
 			m_humdrum_text << vserial[ii] << " ";
@@ -87969,7 +97745,7 @@ void Tool_extract::usage(const string& command) {
 // Tool_extract::initialize --
 //
 
-void Tool_extract::initialize(HumdrumFile& infile) {
+void Tool_extract::initialize(void) {
 	// handle basic options:
 	if (getBoolean("author")) {
 		m_free_text << "Written by Craig Stuart Sapp, "
@@ -88055,15 +97831,18 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 
 	if (excludeQ) {
 		fieldstring = getString("x");
+		rkernQ = false;
 	} else if (fieldQ) {
 		fieldstring = getString("f");
+		rkernQ = false;
 	} else if (kernQ) {
 		fieldstring = getString("k");
 		fieldQ = true;
+		rkernQ = false;
 	} else if (rkernQ) {
+		// field numbers are reversed for each file in run()
 		fieldstring = getString("K");
 		fieldQ = true;
-		fieldstring = reverseFieldString(fieldstring, infile.getMaxTrack());
 	}
 
 	spineListQ = getBoolean("spine-list");
@@ -88291,6 +98070,9 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 	lastNumbers.resize((int)grid.getVoiceCount());
 	vector<vector<int>> currentNumbers = {};
 
+	// Base-40 pitches of the current token (reused for each token):
+	vector<int> base40Pitches;
+
 	// Interate through the NoteGrid and fill the numbers vector with
 	// all generated FiguredBassNumbers
 	for (int i=0; i<(int)grid.getSliceCount(); i++) {
@@ -88311,7 +98093,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 				// Handle spine splits
 				do {
 					HTp resolvedToken = currentToken->resolveNull();
-					int lowest = getLowestBase40Pitch(resolvedToken->getBase40Pitches());
+					resolvedToken->getBase40Pitches(base40Pitches);
+					int lowest = getLowestBase40Pitch(base40Pitches);
 
 					if (abs(lowest) < lowestNotePitch) {
 						lowestNotePitch = abs(lowest);
@@ -88357,7 +98140,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 		// Handle spine splits
 		do {
 			HTp resolvedToken = currentToken->resolveNull();
-			int lowest = getLowestBase40Pitch(resolvedToken->getBase40Pitches());
+			resolvedToken->getBase40Pitches(base40Pitches);
+			int lowest = getLowestBase40Pitch(base40Pitches);
 
 			// Ignore if base is a rest or silent note
 			if ((lowest != 0) && (lowest != -1000) && (lowest != -2000)) {
@@ -88396,7 +98180,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 			// Handle spine splits
 			do {
 				HTp resolvedToken = currentToken->resolveNull();
-				for (int subtokenBase40: resolvedToken->getBase40Pitches()) {
+				resolvedToken->getBase40Pitches(base40Pitches);
+				for (int subtokenBase40: base40Pitches) {
 
 					// Ignore if target is a rest or silent note
 					if ((subtokenBase40 == 0) || (subtokenBase40 == -1000) || (subtokenBase40 == -2000)) {
@@ -88876,18 +98661,20 @@ string Tool_fb::getKeySignature(HumdrumFile& infile, int lineIndex) {
 //    TODO: Handle negative values and sustained notes
 //
 
-int Tool_fb::getLowestBase40Pitch(vector<int> base40Pitches) {
-	vector<int> filteredBase40Pitches;
-	copy_if(base40Pitches.begin(), base40Pitches.end(), std::back_inserter(filteredBase40Pitches), [](int base40Pitch) {
+int Tool_fb::getLowestBase40Pitch(const vector<int>& base40Pitches) {
+	int lowest = -2000;
+	bool foundQ = false;
+	for (int base40Pitch : base40Pitches) {
 		// Ignore if base is a rest or silent note
-		return (base40Pitch != -1000) && (base40Pitch != -2000) && (base40Pitch != 0);
-	});
-
-	if (filteredBase40Pitches.size() == 0) {
-		return -2000;
+		if ((base40Pitch == -1000) || (base40Pitch == -2000) || (base40Pitch == 0)) {
+			continue;
+		}
+		if (!foundQ || (base40Pitch < lowest)) {
+			lowest = base40Pitch;
+			foundQ = true;
+		}
 	}
-
-	return *min_element(begin(filteredBase40Pitches), end(filteredBase40Pitches));
+	return lowest;
 }
 
 
@@ -91306,7 +101093,13 @@ void Tool_gasparize::clearStates(void) {
 
 string Tool_gasparize::getDate(void) {
 	time_t t = time(NULL);
-	tm* timeptr = localtime(&t);
+	tm localtm;
+#ifdef _WIN32
+	localtime_s(&localtm, &t);
+#else
+	localtime_r(&t, &localtm);
+#endif
+	tm* timeptr = &localtm;
 	stringstream ss;
 	int year = timeptr->tm_year + 1900;
 	int month = timeptr->tm_mon + 1;
@@ -92015,31 +101808,51 @@ void Tool_grep::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_grep::run -- Process the input one line at a time.
+//
+
+bool Tool_grep::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	while (instream.readLine()) {
+		if (isPrintedLine(instream.getLine())) {
+			out << instream.getLine() << "\n";
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_grep::processFile --
 //
 
 void Tool_grep::processFile(HumdrumFile& infile) {
-	HumRegex hre;
-	bool match;
 	for (int i=0; i<infile.getLineCount(); i++) {
-		match = hre.search(infile[i], m_regex);
-		if (m_negateQ) {
-			if (match) {
-				continue;
-			}
-		} else {
-			if (!match) {
-				continue;
-			}
+		if (isPrintedLine(infile[i])) {
+			m_humdrum_text << infile[i] << "\n";
 		}
-		m_humdrum_text << infile[i] << "\n";
 	}
 }
 
 
 
+//////////////////////////////
+//
+// Tool_grep::isPrintedLine -- Returns true if the line matches the
+//     regular expression (or does not match when using -v).
+//
+
+bool Tool_grep::isPrintedLine(const string& line) {
+	bool match = m_hre.search(line, m_regex);
+	return m_negateQ ? !match : match;
+}
+
+
+
 
 /////////////////////////////////
 //
@@ -92870,22 +102683,20 @@ void Tool_homorhythm::analyzeLine(HumdrumFile& infile, int line) {
 			nullQ = 0;
 		}
 		int track = token->getTrack();
-		vector<string> subtokens = token->getSubtokens();
-		for (int j=0; j<(int)subtokens.size(); j++) {
+		for (const HumSubtoken& subtoken : token->getSubtokenView()) {
 			note.track = track;
 			note.line = token->getLineIndex();
 			note.field = token->getFieldIndex();
-			note.subfield = j;
+			note.subfield = subtoken.getIndex();
 			note.token = token;
-			note.text = subtokens[j];
-			note.duration = Convert::recipToDuration(note.text);
+			note.text.assign(subtoken.getText());
+			note.duration = subtoken.getDuration();
 			if (nullQ) {
 				note.attack = false;
 				note.nullQ = true;
 			} else {
 				note.nullQ = false;
-				if ((note.text.find("_") != string::npos) ||
-				    (note.text.find("]") != string::npos)) {
+				if (subtoken.contains('_') || subtoken.contains(']')) {
 					note.attack = false;
 				} else {
 					note.attack = true;
@@ -95892,7 +105703,124 @@ string Tool_humtr::transliterateTextOverlapping(const string& input) {
 
 
 
-int Tool_imitation::Enumerator = 0;
+const uint64_t ImitationIndex::NoKey;
+const uint64_t ImitationIndex::RestBit;
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::build -- Store the positions of each window key in a
+//    voice.  Positions with no key (windows starting on a rest interval
+//    or running past the end of the voice) are not stored.  Positions
+//    for each key are in ascending order.
+//
+
+void ImitationIndex::build(const vector<uint64_t>& keys) {
+	m_positions.clear();
+	m_positions.reserve(keys.size());
+	for (int i=0; i<(int)keys.size(); i++) {
+		if (keys[i] == NoKey) {
+			continue;
+		}
+		m_positions[keys[i]].push_back(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::find -- Return the positions in the voice which have
+//    the given window key.
+//
+
+const vector<int>& ImitationIndex::find(uint64_t key) const {
+	auto it = m_positions.find(key);
+	if (it == m_positions.end()) {
+		return m_empty;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::getSymbols -- Convert the interval sequence of a voice
+//    into one number for each position, combining the diatonic interval
+//    to the next note and (optionally) the duration of the note.  Two
+//    positions match in Tool_imitation::compareSequences() only if they
+//    have the same symbol.  Intervals to/from rests all share one value
+//    and are marked with RestBit.  If negate is true, the intervals are
+//    inverted so that inversions can be found with the same index.
+//
+
+void ImitationIndex::getSymbols(vector<uint64_t>& symbols,
+		vector<NoteCell*>& attacks, vector<double>& intervals, bool negate,
+		bool duration) {
+	symbols.resize(intervals.size());
+	for (int i=0; i<(int)intervals.size(); i++) {
+		bool rest = Convert::isNaN(intervals[i]);
+		uint64_t value = 0x9e3779b97f4a7c15ULL;
+		if (!rest) {
+			int64_t interval = (int64_t)intervals[i];
+			if (negate) {
+				interval = -interval;
+			}
+			value = (uint64_t)interval;
+		}
+		if (duration) {
+			HumNum dur = attacks[i]->getDuration();
+			value = (value * 1000003) ^ (uint64_t)dur.getNumerator();
+			value = (value * 1000003) ^ (uint64_t)dur.getDenominator();
+		}
+		// mix bits so that keys of nearby values are spread out:
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		if (rest) {
+			value |= RestBit;
+		} else {
+			value &= ~RestBit;
+		}
+		symbols[i] = value;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::getWindowKeys -- Calculate a rolling hash of length
+//    symbols starting at each position in the sequence.  Positions where
+//    the window starts on a rest or does not fit are given NoKey.
+//
+
+void ImitationIndex::getWindowKeys(vector<uint64_t>& keys,
+		const vector<uint64_t>& symbols, int length) {
+	int size = (int)symbols.size();
+	keys.assign(size, 0);
+	if ((length < 1) || (size < length)) {
+		return;
+	}
+	const uint64_t base = 0x100000001b3ULL;
+	uint64_t power = 1;
+	uint64_t hash = 0;
+	for (int i=0; i<length; i++) {
+		power *= base;
+		hash = hash * base + symbols[i];
+	}
+	for (int i=0; i+length<=size; i++) {
+		if (!(symbols[i] & RestBit)) {
+			keys[i] = (hash == NoKey) ? 1 : hash;
+		}
+		if (i + length < size) {
+			hash = hash * base + symbols[i+length] - power * symbols[i];
+		}
+	}
+}
+
 
 
 /////////////////////////////////
@@ -95978,7 +105906,7 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
+	m_enumerator = 0;
 
 	NoteGrid grid(infile);
 
@@ -95987,7 +105915,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -96074,7 +106002,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 	}
 	m_marker = originalMarker;
 
-	if (!getBoolean("no-info")) {
+	if (!getBoolean("no-info") && !results.empty()) {
 		string exinterp = getString("exinterp");
 		vector<HTp> kernspines = infile.getKernSpineStartList();
 		infile.appendDataSpine(results.back(), "", exinterp);
@@ -96083,7 +106011,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -96129,6 +106057,8 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
+	prepareTargets(attacks, intervals);
+
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=i+1; j<(int)attacks.size(); j++) {
 			analyzeImitation(results, attacks, intervals, i, j);
@@ -96138,6 +106068,62 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::prepareTargets -- Calculate the window keys of each
+//    voice and index the window positions of each voice as a target of
+//    imitation.  Windows are m_threshold - 2 intervals long, which is
+//    the minimum number of matching intervals for a match to be
+//    reported, so each voice pair only needs to compare the positions
+//    that share a key.  Inversion searches index the inverted intervals
+//    of the target voice, and retrograde searches index the target
+//    voice in reverse order.
+//
+
+void Tool_imitation::prepareTargets(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals) {
+	int voices = (int)attacks.size();
+	int length = m_threshold - 2;
+
+	m_retroAttacks.clear();
+	m_retroIntervals.clear();
+	if (m_retrograde) {
+		m_retroAttacks.resize(voices);
+		m_retroIntervals.resize(voices);
+		for (int i=0; i<voices; i++) {
+			m_retroAttacks[i].assign(attacks[i].rbegin(), attacks[i].rend());
+			vector<NoteCell*>& retro = m_retroAttacks[i];
+			m_retroIntervals[i].resize(retro.size());
+			for (int j=0; j<(int)retro.size() - 1; j++) {
+				m_retroIntervals[i][j] = *retro[j+1] - *retro[j];
+			}
+			if (!retro.empty()) {
+				m_retroIntervals[i].back() = NAN;
+			}
+		}
+	}
+
+	m_keys.resize(voices);
+	m_index.resize(voices);
+	vector<uint64_t> symbols;
+	vector<uint64_t> targetkeys;
+	for (int i=0; i<voices; i++) {
+		ImitationIndex::getSymbols(symbols, attacks[i], intervals[i], false, m_duration);
+		ImitationIndex::getWindowKeys(m_keys[i], symbols, length);
+		if (!(m_inversion || m_retrograde)) {
+			m_index[i].build(m_keys[i]);
+			continue;
+		}
+		vector<NoteCell*>& tattacks = m_retrograde ? m_retroAttacks[i] : attacks[i];
+		vector<double>& tintervals = m_retrograde ? m_retroIntervals[i] : intervals[i];
+		ImitationIndex::getSymbols(symbols, tattacks, tintervals, m_inversion, m_duration);
+		ImitationIndex::getWindowKeys(targetkeys, symbols, length);
+		m_index[i].build(targetkeys);
+	}
+}
+
+
+
 ///////////////////////////////
 //
 // Tool_imitation::getIntervals --
@@ -96148,7 +106134,9 @@ void Tool_imitation::getIntervals(vector<double>& intervals,
 	for (int i=0; i<(int)attacks.size() - 1; i++) {
 		intervals.at(i) = *attacks.at(i+1) - *attacks.at(i);
 	}
-	intervals.back() = NAN;
+	if (!intervals.empty()) {
+		intervals.back() = NAN;
+	}
 
 	if (getBoolean("debug")) {
 		cout << endl;
@@ -96172,33 +106160,45 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 		int v1, int v2) {
 
 	vector<NoteCell*>& v1a = attacks.at(v1);
-	vector<NoteCell*>& v2a = attacks.at(v2);
+	vector<NoteCell*>& v2a = m_retrograde ? m_retroAttacks.at(v2) : attacks.at(v2);
 	vector<double>& v1i = intervals.at(v1);
-	vector<double>& v2i = intervals.at(v2);
+	vector<double>& v2i = m_retrograde ? m_retroIntervals.at(v2) : intervals.at(v2);
+	vector<uint64_t>& keys = m_keys.at(v1);
+	ImitationIndex& index = m_index.at(v2);
 
 	int min = m_threshold - 1;
 	int count;
 
-	vector<int> enum1(v1a.size(), 0);
-	vector<int> enum2(v2a.size(), 0);
-
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
-		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
+		if (m_rest || m_rest2) {
+			if ((i > 0) && (!Convert::isNaN(v1a.at(i-1)->getSgnDiatonicPitch()))) {
+				// match initiator must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		if (keys.at(i) == ImitationIndex::NoKey) {
+			continue;
+		}
+		// Only positions in the second voice that share the window key
+		// can match at least min-1 intervals:
+		const vector<int>& positions = index.find(keys.at(i));
+		int skip = -1;
+		for (int p=0; p<(int)positions.size(); p++) {
+			int j = positions[p];
+			if (j >= (int)v2i.size() - 1) {
+				break;
+			}
+			if (j <= skip) {
+				continue;
 			}
 			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				if ((j > 0) && (!Convert::isNaN(v2a.at(j-1)->getSgnDiatonicPitch()))) {
 					// match target must be preceded by a rest (or start of music)
 					continue;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
-				// avoid re-matching an existing match as a submatch
+			if (extendsBackward(v1a, v1i, i, v2a, v2i, j)) {
+				// only report maximal matches, not their suffixes
 				continue;
 			}
 			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
@@ -96206,30 +106206,29 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
 				continue;
 			}
 
+			// Index of the first note of the match in the second voice
+			// (the match runs backwards in the score for retrograde):
+			int j2 = m_retrograde ? (int)v2a.size() - j - count : j;
+
 			// cout << "Match length count " << count << endl;
 			HTp token1 = attacks.at(v1).at(i)->getToken();
-			HTp token2 = attacks.at(v2).at(j)->getToken();
+			HTp token2 = attacks.at(v2).at(j2)->getToken();
 			HumNum time1 = token1->getDurationFromStart();
 			HumNum time2 = token2->getDurationFromStart();
 			HumNum distance1 = time2 - time1;
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				skip = j + count;
 				continue;
 			}
 
-			Enumerator++;
-			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
-			}
+			m_enumerator++;
 
-			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
+			int interval = int(*v2a.at(j) - *attacks.at(v1).at(i));
 
 			if (!m_noInfo) {
 				if (!(m_first && (distance1 < 0))) {
@@ -96249,7 +106248,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -96339,7 +106338,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				}
 
 				if (!(m_first && (distance2 <= 0))) {
-					int line2 = attacks.at(v2).at(j)->getLineIndex();
+					int line2 = attacks.at(v2).at(j2)->getLineIndex();
 
 					if (!results.at(v2).at(line2).empty()) {
 						results.at(v2).at(line2) += " ";
@@ -96356,7 +106355,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -96365,7 +106364,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						}
 						data2 = true;
 						results.at(v2).at(line2) += "m";
-						int line = attacks.at(v2).at(j)->getToken()->getLineIndex();
+						int line = attacks.at(v2).at(j2)->getToken()->getLineIndex();
 						results.at(v2).at(line2) += to_string(m_barlines[line]);
 					}
 
@@ -96375,7 +106374,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						}
 						data2 = true;
 						results.at(v2).at(line2) += "b";
-						HLp humline = attacks.at(v2).at(j)->getToken()->getOwner();
+						HLp humline = attacks.at(v2).at(j2)->getToken()->getOwner();
 						stringstream ss;
 						ss.str("");
 						ss << humline->getBeat().getFloat();
@@ -96391,8 +106390,8 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						// time1 is the starttime
 						HumNum endtime;
 						HTp endtoken = NULL;
-						if (j+count < (int)attacks.at(v2).size()) {
-							endtoken = attacks.at(v2).at(j+count)->getToken();
+						if (j2+count < (int)attacks.at(v2).size()) {
+							endtoken = attacks.at(v2).at(j2+count)->getToken();
 							endtime = endtoken->getDurationFromStart();
 						} else {
 							endtime = token2->getOwner()->getOwner()->getScoreDuration();
@@ -96451,10 +106450,10 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						break;
 					}
 					token1 = attacks.at(v1).at(i+z)->getToken();
-					if (j+z >= (int)attacks.at(v2).size()) {
+					if (j+z >= (int)v2a.size()) {
 						break;
 					}
-					token2 = attacks.at(v2).at(j+z)->getToken();
+					token2 = v2a.at(j+z)->getToken();
 					if (m_single) {
 						if (token1->find(m_marker) == string::npos) {
 							token1->setText(*token1 + m_marker);
@@ -96473,17 +106472,17 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					}
 
-               if (attacks.at(v2).at(j+z)->isRest() && (z < count - 1) ) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
-					} else if (!attacks.at(v2).at(j+z)->isRest()) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
+               if (v2a.at(j+z)->isRest() && (z < count - 1) ) {
+						markedTiedNotes(v2a.at(j+z)->m_tiedtokens);
+					} else if (!v2a.at(j+z)->isRest()) {
+						markedTiedNotes(v2a.at(j+z)->m_tiedtokens);
 					}
 
 				}
 			}
 
-			// skip over match (need to do in i as well somehow)
-			j += count;
+			// skip over match
+			skip = j + count;
 		} // j loop
 	} // i loop
 }
@@ -96536,6 +106535,41 @@ int Tool_imitation::checkForIntervalSequence(vector<int>& m_intervals,
 
 
 
+///////////////////////////////
+//
+// Tool_imitation::extendsBackward -- Returns true if the notes before
+//     i1 and i2 also match, in which case a match starting at i1/i2
+//     is the continuation of a longer match.
+//
+
+bool Tool_imitation::extendsBackward(vector<NoteCell*>& attack1,
+		vector<double>& seq1, int i1, vector<NoteCell*>& attack2,
+		vector<double>& seq2, int i2) {
+	if ((i1 == 0) || (i2 == 0)) {
+		return false;
+	}
+	double interval1 = seq1.at(i1-1);
+	double interval2 = seq2.at(i2-1);
+	// matches cannot start with rests
+	if (Convert::isNaN(interval1) || Convert::isNaN(interval2)) {
+		return false;
+	}
+	if (m_inversion) {
+		interval2 = -interval2;
+	}
+	if (interval1 != interval2) {
+		return false;
+	}
+	if (m_duration) {
+		if (attack1.at(i1-1)->getDuration() != attack2.at(i2-1)->getDuration()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
 ///////////////////////////////
 //
 // Tool_imitation::compareSequences -- Returns the number of notes that
@@ -106985,6 +117019,9 @@ Tool_msearch::Tool_msearch(void) {
 	define("i|interval=s:2222",           "interval query string");
 	define("r|d|rhythm|duration=s:44444", "rhythm query string");
 	define("t|text=s:",                   "lyrical text query string");
+	define("w|words=b",                   "look up text query words in a word index");
+	define("index=s",                     "word index file for -w (made with --make-index)");
+	define("make-index=b",                "print word index of input instead of searching");
 	define("O|no-overlap=b",              "do not allow matches to overlap");
 	define("x|cross=b",                   "search across parts");
 	define("c|color=s",                   "highlight color");
@@ -107046,6 +117083,12 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 	}
 	initialize();
 
+	if (getBoolean("make-index")) {
+		HumWordIndex index(infile);
+		index.writeIndex(m_free_text);
+		return true;
+	}
+
 	if (getBoolean("text")) {
 		m_text = getString("text");
 	}
@@ -107163,22 +117206,51 @@ void Tool_msearch::fillWordsForTrack(vector<TextInfo*>& words,
 //////////////////////////////
 //
 // Tool_msearch::doTextSearch -- do a basic text search of all parts.
+//     Each query word is a regular expression which is searched for
+//     (without case) in every word.  With the -w option, query words
+//     are instead looked up in a HumWordIndex of the file: whole words
+//     are compared without case, diacritics or punctuation, "*" matches
+//     any characters and "?" matches one character.
 //
 
 void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		vector<MSearchTextQuery>& query) {
 
-	vector<TextInfo*> words;
-	words.reserve(10000);
-	fillWords(infile, words);
 	int tcount = 0;
 
-	HumRegex hre;
-	for (int i=0; i<(int)query.size(); i++) {
-		for (int j=0; j<(int)words.size(); j++) {
-			if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
+	if (!(getBoolean("words") || getBoolean("index"))) {
+		vector<TextInfo*> words;
+		words.reserve(10000);
+		fillWords(infile, words);
+		HumRegex hre;
+		for (int i=0; i<(int)query.size(); i++) {
+			for (int j=0; j<(int)words.size(); j++) {
+				if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
+					tcount++;
+					markTextMatch(infile, *words[j]);
+				}
+			}
+		}
+		for (int i=0; i<(int)words.size(); i++) {
+			delete words[i];
+			words[i] = NULL;
+		}
+	} else {
+		HumWordIndex built;
+		const HumWordIndex* index = getWordIndex(infile);
+		if (!index) {
+			built.build(infile);
+			index = &built;
+		}
+		vector<int> matches;
+		TextInfo word;
+		for (int i=0; i<(int)query.size(); i++) {
+			index->find(matches, query[i].word);
+			for (int j=0; j<(int)matches.size(); j++) {
+				word.starttoken = index->getStartToken(infile, matches[j]);
+				word.nexttoken = index->getNextToken(infile, matches[j]);
 				tcount++;
-				markTextMatch(infile, *words[j]);
+				markTextMatch(infile, word);
 			}
 		}
 	}
@@ -107214,11 +117286,6 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		infile.createLinesFromTokens();
 	}
 
-	for (int i=0; i<(int)words.size(); i++) {
-		delete words[i];
-		words[i] = NULL;
-	}
-
 	if (!m_quietQ) {
 		addTextSearchSummary(infile, tcount, m_marker);
 	}
@@ -107226,6 +117293,42 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::getWordIndex -- Return the index for the file from the
+//     word index file given with the --index option, or NULL if there is
+//     no index for the file.  The index file is read the first time that
+//     it is needed.  An index is used only if it has the same filename and
+//     line count as the input file.
+//
+
+const HumWordIndex* Tool_msearch::getWordIndex(HumdrumFile& infile) {
+	if (!getBoolean("index")) {
+		return NULL;
+	}
+	if (!m_wordIndexesReadQ) {
+		m_wordIndexesReadQ = true;
+		ifstream input(getString("index"));
+		if (!input.is_open()) {
+			cerr << "Warning: cannot read word index file " << getString("index") << endl;
+			return NULL;
+		}
+		HumWordIndex index;
+		while (index.readIndex(input)) {
+			m_wordIndexes.push_back(index);
+		}
+	}
+	for (int i=0; i<(int)m_wordIndexes.size(); i++) {
+		if ((m_wordIndexes[i].getName() == infile.getFilename()) &&
+				(m_wordIndexes[i].getLineCount() == infile.getLineCount())) {
+			return &m_wordIndexes[i];
+		}
+	}
+	return NULL;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::printQuery --
@@ -109848,6 +119951,7 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("j|jobs|threads=i:1", "number of threads for parsing parts");
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -109924,10 +120028,13 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	// for debugging:
 	//printPartInfo(partids, partinfo, partcontent, partdata);
 
+	forEachPart((int)partdata.size(), [&](int i) {
+		partdata[i].prepareVoiceMapping();
+	});
+
 	m_maxstaff = 0;
 	// check the voice info
 	for (int i=0; i<(int)partdata.size(); i++) {
-		partdata[i].prepareVoiceMapping();
 		m_maxstaff += partdata[i].getStaffCount();
 		// for debugging:
 		if (VoiceDebugQ) {
@@ -109937,6 +120044,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 
 	// re-index voices to disallow empty intermediate voices.
 	reindexVoices(partdata);
+	preparePartEvents(partdata);
 
 	HumGrid outdata;
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
@@ -110043,7 +120151,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		HumdrumFile outfile2;
 		outfile2.readString(sstream.str());
 		gracebeam.run(outfile2);
-		outfile = outfile2;
+		outfile = std::move(outfile2);
 	}
 
 	if (m_hasTransposition) {
@@ -110467,18 +120575,56 @@ void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::initialize(void) {
 	m_recipQ = getBoolean("recip");
 	m_stemsQ = getBoolean("stems");
+	m_threads = getInteger("threads");
+	if (m_threads < 1) {
+		m_threads = 1;
+	}
 	m_hasOrnamentsQ = false;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::forEachPart -- Call a function for each part index.
+//     With more than one thread (-j option), the parts are handed out to
+//     the threads as they become free, so the function must only modify
+//     the data for the given part.
+//
+
+void Tool_musicxml2hum::forEachPart(int count, const std::function<void(int)>& process) {
+	if (count <= 0) {
+		return;
+	}
+	atomic<int> next(0);
+	auto work = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			process(index);
+		}
+	};
+
+	int threadcount = min(m_threads, count);
+	vector<thread> threads;
+	threads.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::reindexVoices --
 //
 
 void Tool_musicxml2hum::reindexVoices(vector<MxmlPart>& partdata) {
-	for (int p=0; p<(int)partdata.size(); p++) {
+	forEachPart((int)partdata.size(), [&](int p) {
 		for (int m=0; m<(int)partdata[p].getMeasureCount(); m++) {
 			MxmlMeasure* measure = partdata[p].getMeasure(m);
 			if (!measure) {
@@ -110486,7 +120632,30 @@ void Tool_musicxml2hum::reindexVoices(vector<MxmlPart>& partdata) {
 			}
 			reindexMeasure(measure);
 		}
-	}
+	});
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePartEvents -- Add dummy rests for empty
+//     voices and attach hairpin endings to notes in each measure before
+//     the parts are merged into the grid.  This only depends on the
+//     events within each part, so parts are prepared in parallel.
+//
+
+void Tool_musicxml2hum::preparePartEvents(vector<MxmlPart>& partdata) {
+	forEachPart((int)partdata.size(), [&](int p) {
+		for (int m=0; m<(int)partdata[p].getMeasureCount(); m++) {
+			MxmlMeasure* measure = partdata[p].getMeasure(m);
+			if (!measure) {
+				continue;
+			}
+			checkForDummyRests(measure);
+			attachHairpinEndings(measure);
+		}
+	});
 }
 
 
@@ -110644,11 +120813,25 @@ bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
 		const vector<string>& partids, map<string, xml_node>& partinfo,
 		map<string, xml_node>& partcontent) {
 
-	bool output = true;
-	for (int i=0; i<(int)partinfo.size(); i++) {
+	// Look up the nodes before any threads start, since map::operator[]
+	// may insert into the maps:
+	int count = (int)partinfo.size();
+	vector<xml_node> declarations(count);
+	vector<xml_node> contents(count);
+	for (int i=0; i<count; i++) {
+		declarations[i] = partinfo[partids[i]];
+		contents[i] = partcontent[partids[i]];
+	}
+
+	vector<char> status(count, true);
+	forEachPart(count, [&](int i) {
 		partdata[i].setPartNumber(i+1);
-		output &= fillPartData(partdata[i], partids[i], partinfo[partids[i]],
-				partcontent[partids[i]]);
+		status[i] = fillPartData(partdata[i], partids[i], declarations[i], contents[i]);
+	});
+
+	bool output = true;
+	for (int i=0; i<count; i++) {
+		output &= (bool)status[i];
 	}
 	return output;
 }
@@ -111000,7 +121183,6 @@ bool Tool_musicxml2hum::insertMeasure(HumGrid& outdata, int mnum,
 			gm->setTimestamp(partdata[i].getMeasure(mnum)->getTimestamp());
 			gm->setTimeSigDur(partdata[i].getMeasure(mnum)->getTimeSigDur());
 		}
-		checkForDummyRests(xmeasure);
 		sevents.push_back(xmeasure->getSortedEvents());
 		if (i == 0) {
 			// only checking measure style of first barline
@@ -111023,32 +121205,8 @@ bool Tool_musicxml2hum::insertMeasure(HumGrid& outdata, int mnum,
 			measuredata[i]->setTimeSigDur(tsdur);
 		}
 
-		// Keep track of hairpin endings that should be attached
-		// the the previous note (and doubling the ending marker
-		// to indicate that the timestamp of the ending is at the
-		// end rather than the start of the note.
-		vector<MxmlEvent*>& events = measuredata[i]->getEventList();
-		xml_node hairpin = xml_node(NULL);
-		for (int j=(int)events.size() - 1; j >= 0; j--) {
-			if (events[j]->getElementName() == "note") {
-				if (hairpin) {
-					events[j]->setHairpinEnding(hairpin);
-					hairpin = xml_node(NULL);
-				}
-				break;
-			} else if (events[j]->getElementName() == "direction") {
-				stringstream ss;
-				ss.str("");
-				events[j]->getNode().print(ss);
-				if (ss.str().find("wedge") != string::npos) {
-					if (ss.str().find("stop") != string::npos) {
-						hairpin = events[j]->getNode();
-					}
-				}
-			}
-		}
-
 		if (VoiceDebugQ) {
+			vector<MxmlEvent*>& events = measuredata[i]->getEventList();
 			for (int j=0; j<(int)events.size(); j++) {
 				cerr << "!!ELEMENT: ";
 				cerr << "\tTIME:  " << events[j]->getStartTime();
@@ -111349,6 +121507,39 @@ void Tool_musicxml2hum::checkForDummyRests(MxmlMeasure* measure) {
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::attachHairpinEndings -- Keep track of hairpin endings
+//     that should be attached the the previous note (and doubling the
+//     ending marker to indicate that the timestamp of the ending is at the
+//     end rather than the start of the note.
+//
+
+void Tool_musicxml2hum::attachHairpinEndings(MxmlMeasure* measure) {
+	vector<MxmlEvent*>& events = measure->getEventList();
+	xml_node hairpin = xml_node(NULL);
+	for (int j=(int)events.size() - 1; j >= 0; j--) {
+		if (events[j]->getElementName() == "note") {
+			if (hairpin) {
+				events[j]->setHairpinEnding(hairpin);
+				hairpin = xml_node(NULL);
+			}
+			break;
+		} else if (events[j]->getElementName() == "direction") {
+			stringstream ss;
+			ss.str("");
+			events[j]->getNode().print(ss);
+			if (ss.str().find("wedge") != string::npos) {
+				if (ss.str().find("stop") != string::npos) {
+					hairpin = events[j]->getNode();
+				}
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::convertNowEvents --
@@ -119233,11 +129424,13 @@ void Tool_pbar::addBarLineToFollowingNoteOrRest(HTp token) {
 
 Tool_pccount::Tool_pccount(void) {
 	define("a|attacks=b",                 "count attacks instead of durations");
+	define("C|corpus=b",                  "count pitch classes for all input files together");
 	define("d|data|vega-data=b",          "display the vega-lite template.");
 	define("f|full=b",                    "full count attacks all single sharps and flats.");
 	define("ff|double-full=b",            "full count attacks all double sharps and flats.");
 	define("h|html=b",                    "generate vega-lite HTML content");
 	define("i|id=s:id",                   "ID for use as variable and in plot title");
+	define("j|jobs|threads=i:1",          "number of threads for --corpus analysis");
 	define("K|no-key|no-final=b",         "do not label key tonic or final");
 	define("m|maximum=b",                 "normalize by maximum count");
 	define("n|normalize=b",               "normalize counts");
@@ -119265,6 +129458,20 @@ bool Tool_pccount::run(HumdrumFileSet& infiles) {
 }
 
 
+bool Tool_pccount::run(HumdrumFileStream& instream) {
+	if (!getBoolean("corpus")) {
+		HumdrumFileSet infiles;
+		bool status = true;
+		while (instream.readSingleSegment(infiles)) {
+			status &= run(infiles);
+		}
+		return status;
+	}
+	processCorpus(instream);
+	return true;
+}
+
+
 bool Tool_pccount::run(const string& indata, ostream& out) {
 	HumdrumFile infile(indata);
 	return run(infile, out);
@@ -119408,6 +129615,37 @@ string Tool_pccount::getFinal(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_pccount::processCorpus -- Sum the pitch classes of all files
+//     in the input stream into a single "all" column.  Files are
+//     analyzed in parallel with the --threads option.
+//
+
+void Tool_pccount::processCorpus(HumdrumFileStream& instream) {
+	m_attack    = getBoolean("attacks");
+	m_normalize = getBoolean("normalize");
+	m_maximum   = getBoolean("maximum");
+
+	PitchProfile profile;
+	profile.setAttacks(m_attack);
+	profile.analyze(instream, getInteger("threads"));
+
+	m_names.assign(1, "all");
+	m_abbreviations.assign(1, "all");
+	m_counts.assign(1, profile.getPitchClasses().getBase40Vector());
+
+	m_free_text << "!!!files: " << profile.getFileCount() << endl;
+	const PitchHistogram& range = profile.getRange();
+	if (!profile.getPitchClasses().isEmpty()) {
+		m_free_text << "!!!range: " << Convert::base40ToKern(range.getLowestBase40());
+		m_free_text << "-" << Convert::base40ToKern(range.getHighestBase40()) << endl;
+	}
+	printHumdrumTable();
+}
+
+
+
 //////////////////////////////
 //
 // Tool_pccount::processFile --
@@ -119686,25 +129924,22 @@ void Tool_pccount::countPitches(HumdrumFile& infile) {
 	if (m_parttracks.size() == 0) {
 		return;
 	}
-	m_counts.clear();
-	m_counts.resize(m_parttracks.size());
-	for (int i=0; i<(int)m_parttracks.size(); i++) {
-		m_counts[i].resize(40);
-		fill(m_counts[i].begin(), m_counts[i].end(), 0.0);
-	}
+	vector<PitchClassHistogram> histograms(m_parttracks.size());
 	for (int i=0; i<infile.getStrandCount(); i++) {
 		HTp sstart = infile.getStrandStart(i);
 		HTp send = infile.getStrandEnd(i);
-		addCounts(sstart, send);
+		addCounts(histograms, sstart, send);
 	}
 
 	// fill in sum for all parts
-	for (int i=0; i<(int)m_counts[0].size(); i++) {
-		for (int j=1; j<(int)m_counts.size(); j++) {
-			m_counts[0][i] += m_counts[j][i];
-		}
+	for (int i=1; i<(int)histograms.size(); i++) {
+		histograms[0] += histograms[i];
 	}
 
+	m_counts.resize(histograms.size());
+	for (int i=0; i<(int)histograms.size(); i++) {
+		m_counts[i] = histograms[i].getBase40Vector();
+	}
 }
 
 
@@ -119713,7 +129948,8 @@ void Tool_pccount::countPitches(HumdrumFile& infile) {
 // Tool_pccount::addCounts --
 //
 
-void Tool_pccount::addCounts(HTp sstart, HTp send) {
+void Tool_pccount::addCounts(vector<PitchClassHistogram>& histograms,
+		HTp sstart, HTp send) {
 	if (!sstart) {
 		return;
 	}
@@ -119743,12 +129979,11 @@ void Tool_pccount::addCounts(HTp sstart, HTp send) {
 					continue;
 				}
 			}
-			int b40 = Convert::kernToBase40(subtokens[i]);
 			if (m_attack) {
-				m_counts[kindex][b40%40]++;
+				histograms[kindex].addKern(subtokens[i]);
 			} else {
 				double duration = Convert::recipToDuration(subtokens[i]).getFloat();
-				m_counts[kindex][b40%40] += duration;
+				histograms[kindex].addKern(subtokens[i], duration);
 			}
 		}
 		current = current->getNextToken();
@@ -121431,6 +131666,7 @@ _VoiceInfo::_VoiceInfo(void) {
 void _VoiceInfo::clear(void) {
 	name = "";
 	abbr = "";
+	histogram.clear();
 	midibins.resize(128);
 	fill(midibins.begin(), midibins.end(), 0.0);
 	diatonic.resize(7 * 12);
@@ -121447,6 +131683,29 @@ void _VoiceInfo::clear(void) {
 }
 
 
+//////////////////////////////
+//
+// _VoiceInfo::loadHistogram -- Copy the pitch histogram into the
+//    midibins and diatonic arrays used for printing.  Diatonic index 0
+//    is three octaves below octave 0, and the second dimension is the
+//    sum for all accidentals followed by double-flat to double-sharp.
+//
+
+void _VoiceInfo::loadHistogram(void) {
+	for (int i=0; i<(int)midibins.size(); i++) {
+		midibins[i] = histogram.getMidi(i);
+	}
+	for (int i=0; i<(int)diatonic.size(); i++) {
+		int base7 = i - 3 * 7;
+		diatonic[i][0] = histogram.getBase7(base7);
+		for (int j=1; j<(int)diatonic[i].size(); j++) {
+			diatonic[i][j] = histogram.getDiatonic(base7, j - 3);
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // _VoiceInfo::print --
@@ -121835,15 +132094,11 @@ void Tool_prange::mergeAllVoiceInfo(vector<_VoiceInfo>& voiceInfo) {
 			voiceInfo.at(0).namfinal.push_back(voiceInfo.at(i).name);
 		}
 
-		for (int j=0; j<(int)voiceInfo[i].midibins.size(); j++) {
-			voiceInfo[0].midibins[j] += voiceInfo[i].midibins[j];
-		}
+		voiceInfo[0].histogram += voiceInfo[i].histogram;
+	}
 
-		for (int j=0; j<(int)voiceInfo.at(i).diatonic.size(); j++) {
-			for (int k=0; k<(int)voiceInfo.at(i).diatonic.at(k).size(); k++) {
-				voiceInfo[0].diatonic.at(j).at(k) += voiceInfo.at(i).diatonic.at(j).at(k);
-			}
-		}
+	for (int i=0; i<(int)voiceInfo.size(); i++) {
+		voiceInfo[i].loadHistogram();
 	}
 }
 
@@ -122074,13 +132329,11 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 					cerr << "Accidental too sharp: " << tokens[k] << endl;
 					continue;
 				}
-				int diatonic = dpc + 7 * octave;
 				int realdiatonic = dpc + 7 * (octave-3);
 
 				diafinal.at(track).push_back(realdiatonic);
 				accfinal.at(track).push_back(acc);
 
-				acc += 3;
 				int midi = Convert::kernToMidiNoteNumber(tokens[k]);
 				if (midi < 0) {
 					cerr << "MIDI pitch too low: " << tokens[k] << endl;
@@ -122088,11 +132341,10 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 				if (midi > 127) {
 					cerr << "MIDI pitch too high: " << tokens[k] << endl;
 				}
+				int base40 = Convert::kernToBase40(tokens[k]);
 				if (m_durationQ) {
 					double duration = Convert::kernToDuration(tokens[k]).getFloat();
-					voiceInfo[track].diatonic.at(diatonic).at(0) += duration;
-					voiceInfo[track].diatonic.at(diatonic).at(acc) += duration;
-					voiceInfo[track].midibins.at(midi) += duration;
+					voiceInfo[track].histogram.addBase40(base40, duration);
 				} else {
 					if (tokens[k].find("]") != string::npos) {
 						continue;
@@ -122100,9 +132352,7 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 					if (tokens[k].find("_") != string::npos) {
 						continue;
 					}
-					voiceInfo[track].diatonic.at(diatonic).at(0)++;
-					voiceInfo[track].diatonic.at(diatonic).at(acc)++;
-					voiceInfo[track].midibins.at(midi)++;
+					voiceInfo[track].histogram.addBase40(base40);
 				}
 			}
 		}
@@ -124114,6 +134364,24 @@ void Tool_rid::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_rid::run -- Process the input one line at a time.
+//
+
+bool Tool_rid::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	bool revQ = option_V;
+	while (instream.readLine()) {
+		if (isRemovedLine(instream) == revQ) {
+			out << instream.getLine() << "\n";
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_rid::processFile --
@@ -124249,6 +134517,81 @@ void Tool_rid::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_rid::isRemovedLine -- Returns true if the line should be removed
+//     (or printed when the -V option is used).  This is the same test as
+//     in processFile(), for input read one line at a time.
+//
+
+bool Tool_rid::isRemovedLine(HumdrumLineStream& line) {
+   if (option_D && (line.isBarline() || line.isData())) {
+      // remove data lines if -D is specified
+      return true;
+   }
+   if (option_d) {
+      // remove null data lines if -d is specified
+      if (option_k && line.isData() && line.equalFieldsQ("**kern", ".")) {
+         // remove if only all **kern spines are null.
+         return true;
+      } else if (!option_k && line.isData() && line.isAllNull()) {
+         // remove null data lines if all spines are null.
+         return true;
+      }
+   }
+   if (option_G && (line.isGlobalComment() || line.isReference())) {
+      // remove global comments if -G is specified
+      return true;
+   }
+   if (option_g && m_hre.search(line.getToken(0), "^!!+\\s*$")) {
+      // remove empty global comments if -g is specified
+      return true;
+   }
+   if (option_I && line.isInterpretation()) {
+      // remove all interpretation records
+      return true;
+   }
+   if (option_i && line.isInterpretation() && line.isAllNull()) {
+      // remove null interpretation records
+      return true;
+   }
+   if (option_L && line.isLocalComment()) {
+      // remove all local comments
+      return true;
+   }
+   if (option_l && line.isLocalComment() && line.isAllNull()) {
+      // remove null local comments
+      return true;
+   }
+   if (option_T && (line.isInterpretation() && !line.isManipulator())) {
+      // remove tandem (non-manipulator) interpretations
+      return true;
+   }
+   if (option_U) {
+      // remove unnecessary (duplicate exclusive) interpretations
+      // HumdrumFile class does not allow duplicate ex. interps.
+   }
+
+   // non-classical options:
+
+   if (option_M && line.isBarline()) {
+      // remove all measure lines
+      return true;
+   }
+   if (option_C && line.isComment()) {
+      // remove all comments (local & global)
+      return true;
+   }
+   if (option_c && (line.isLocalComment() || line.isGlobalComment())) {
+      // remove all comments (local & global)
+      return true;
+   }
+
+   return false;
+}
+
+
+
 
 
 /////////////////////////////////
@@ -129652,6 +139995,7 @@ void MeasureData::generateNoteHistogram(void) {
 		return;
 	}
 
+	PitchClassHistogram histogram;
 	HumdrumFile& infile = *m_owner;
 	for (int i=m_startline; i<m_stopline; i++) {
 		if (!infile[i].isData()) {
@@ -129672,18 +140016,12 @@ void MeasureData::generateNoteHistogram(void) {
 			int subtokcount = token->getSubtokenCount();
 			for (int k=0; k<subtokcount; k++) {
 				string subtok = token->getSubtoken(k);
-				int pc = Convert::kernToBase7PC(subtok);
-				if (pc < 0) {
-					continue;
-				}
-				m_hist7pc.at(pc) += duration;
+				histogram.addKern(subtok, duration);
 			}
 		}
 	}
-	m_sum7pc = 0.0;
-	for (int i=0; i<(int)m_hist7pc.size(); i++) {
-		m_sum7pc += m_hist7pc[i];
-	}
+	m_hist7pc = histogram.getBase7Vector();
+	m_sum7pc = histogram.getTotal();
 }
 
 
@@ -131078,14 +141416,17 @@ bool Tool_synco::isSyncopated(HTp token) {
 //
 
 double Tool_synco::getMetricLevel(HTp token) {
-	HumNum durbar = token->getDurationFromBarline();
-	if (!durbar.isInteger()) {
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	if (tick % tpq != 0) {
 		return -1.0;
 	}
-	if (durbar.getNumerator() % 4 == 0) {
+	int quarters = tick / tpq;
+	if (quarters % 4 == 0) {
 		return 2.0;
 	}
-	if (durbar.getNumerator() % 2 == 0) {
+	if (quarters % 2 == 0) {
 		return 1.0;
 	}
 	return 0.0;
@@ -134341,7 +144682,13 @@ void Tool_tassoize::clearStates(void) {
 
 string Tool_tassoize::getDate(void) {
 	time_t t = time(NULL);
-	tm* timeptr = localtime(&t);
+	tm localtm;
+#ifdef _WIN32
+	localtime_s(&localtm, &t);
+#else
+	localtime_r(&t, &localtm);
+#endif
+	tm* timeptr = &localtm;
 	stringstream ss;
 	int year = timeptr->tm_year + 1900;
 	int month = timeptr->tm_mon + 1;
@@ -135438,238 +145785,45 @@ int Tool_thru::getBarline(HumdrumFile& infile, int line) {
 
 //////////////////////////////
 //
-// Tool_thru::processData --
+// Tool_thru::processData -- Print the lines of the file in the order
+//    given by the expansion list.  If there is no expansion list, the
+//    file is echoed with a *thru line added after the exclusive
+//    interpretations.
 //
 
 void Tool_thru::processData(HumdrumFile& infile) {
-	vector<string> labelsequence;
-	labelsequence.reserve(1000);
-
-	vector<string> labels;
-	labels.reserve(1000);
-
-	vector<int> startline;
-	startline.reserve(1000);
-
-	vector<int> stopline;
-	stopline.reserve(1000);
-
-	int header = -1;
-	int footer = -1;
-	string labelsearch;
-	labelsearch = "*>";
-	labelsearch += m_variation;
-	labelsearch += "[";
-
-	// check for label to expand
-	int foundlabel = 0;
-	string tempseq;
-	if (m_realization.size()  == 0) {
-		for (int i=0; i<infile.getLineCount(); i++) {
-			if (!infile[i].isInterpretation()) {
-				continue;
-			}
-			HTp token = infile.token(i, 0);
-			if (token->compare(0, labelsearch.size(), labelsearch) != 0) {
-				continue;
-			}
-
-			tempseq = token->substr(labelsearch.size());
-			getLabelSequence(labelsequence, tempseq);
-			foundlabel = 1;
-			break;
-		}
-	} else {
-		foundlabel = 1;
-		getLabelSequence(labelsequence, m_realization);
-	}
-
-	if (foundlabel == 0) {
-		// did not find the label to expand, so echo the data back
-		for (int i=0; i<infile.getLineCount(); i++) {
-			HTp token = infile.token(i, 0);
-			if (*token == "*thru") {
-				continue;
-			}
-			m_humdrum_text << infile[i] << "\n";
-			if (token->compare(0, 2, "**") == 0) {
-				for (int j=0; j<infile[i].getFieldCount(); j++) {
-					m_humdrum_text << "*thru";
-					if (j < infile[i].getFieldCount() - 1) {
-						m_humdrum_text << "\t";
-					}
-				}
-				m_humdrum_text << "\n";
-			}
-		}
-		return;
-	}
-
-	// for (i=0; i<(int)labelsequence.size(); i++) {
-	//    m_humdrum_text << i+1 << "\t=\t" << labelsequence[i] << endl;
-	// }
-
-	// search for the labeled sections in the music
-	string label;
-	int location;
-	int index;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		HTp token = infile.token(i, 0);
-		if (*token == "*-") {
-			location = i-1;
-			footer = i;
-			stopline.push_back(location);
-		}
-		if (token->compare(0, 2, "*>") != 0) {
-			continue;
-		}
-		if (token->find('[') != string::npos) {
-			continue;
-		}
-		if (token->find(']') != string::npos) {
-			continue;
-		}
-
-		if (labels.size() == 0) {
-			header = i-1;
-		}
-
-		label = token->substr(2);
-		index = (int)labels.size();
-		location = i-1;
-		if (startline.size() > 0) {
-			stopline.push_back(location);
-		}
-		labels.resize(index+1);
-		labels[index] = label;
-		startline.push_back(i);
-	}
-
-	// m_humdrum_text << "FOOTER = " << footer << endl;
-	// m_humdrum_text << "HEADER = " << header << endl;
-	// for (i=0; i<(int)labels.size(); i++) {
-	//    m_humdrum_text << "\t" << i << "\t=\t" << labels[i]
-	//         << "\t" << startline[i] << "\t" << stopline[i]
-	//         << endl;
-	// }
-
-	// now ready to copy the labeled segements into a final file.
-
-
-	// print header:
-	for (int i=0; i<=header; i++) {
-		HTp token = infile.token(i, 0);
-		if (*token == "*thru") {
-			continue;
-		}
-
-		if (!m_keepQ) {
-			if (infile[i].isInterpretation()) {
-				if (token->compare(0, 2, "*>") == 0) {
-					if (token->find('[') != string::npos) {
-						continue;
-					}
-				}
-			}
-		}
-
-		m_humdrum_text << infile[i] << "\n";
-		if (token->compare(0, 2, "**") == 0) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
+	HumdrumExpansionView view;
+	view.setKeepLists(m_keepQ);
+	view.analyze(infile, m_variation, m_realization);
+
+	int sequence = 0;
+	int sequenceCount = view.getSequenceCount();
+	for (int i=0; i<view.getLineCount(); i++) {
+		while ((sequence < sequenceCount) && (view.getSequenceStart(sequence) <= i)) {
+			if (!view.hasSequenceLabel(sequence)) {
+				m_humdrum_text << "!! THRU ERROR: label " << view.getSequenceLabel(sequence)
+				               << " does not exist, skipping.\n";
+			}
+			sequence++;
+		}
+		HumdrumLine& line = view[i];
+		m_humdrum_text << line << "\n";
+		if (view.isHeader(i) && line.isExclusiveInterpretation()) {
+			for (int j=0; j<line.getFieldCount(); j++) {
 				m_humdrum_text << "*thru";
-				if (j < infile[i].getFieldCount() - 1) {
+				if (j < line.getFieldCount() - 1) {
 					m_humdrum_text << "\t";
 				}
 			}
 			m_humdrum_text << "\n";
 		}
 	}
-
-	int start;
-	int stop;
-	for (int i=0; i<(int)labelsequence.size(); i++) {
-		index = getLabelIndex(labels, labelsequence[i]);
-		if (index < 0) {
-			m_humdrum_text << "!! THRU ERROR: label " << labelsequence[i]
-				  << " does not exist, skipping.\n";
-		}
-		start = startline[index];
-		stop  = stopline[index];
-		for (int j=start; j<=stop; j++) {
-			if (!m_keepQ) {
-				if (infile[j].isInterpretation()) {
-					HTp token = infile.token(j, 0);
-					if (token->compare(0, 2, "*>") == 0) {
-						if (token->find('[') != string::npos) {
-							continue;
-						}
-					}
-				}
-			}
-			m_humdrum_text << infile[j] << "\n";
-		}
-	}
-
-	// print footer:
-	for (int i=footer; i<infile.getLineCount(); i++) {
-		if (!m_keepQ) {
-			if (infile[i].isInterpretation()) {
-				HTp token = infile.token(i, 0);
-				if (token->compare(0, 2, "*>") == 0) {
-					if (token->find('[') != string::npos) {
-						continue;
-					}
-				}
-			}
-		}
-		m_humdrum_text << infile[i] << "\n";
-	}
-
-}
-
-
-
-//////////////////////////////
-//
-// Tool_thru::getLabelIndex --
-//
-
-int Tool_thru::getLabelIndex(vector<string>& labels, string& key) {
-	for (int i=0; i<(int)labels.size(); i++) {
-		if (key == labels[i]) {
-			return i;
+	for (; sequence<sequenceCount; sequence++) {
+		if (!view.hasSequenceLabel(sequence)) {
+			m_humdrum_text << "!! THRU ERROR: label " << view.getSequenceLabel(sequence)
+			               << " does not exist, skipping.\n";
 		}
 	}
-	return -1;
-}
-
-
-
-//////////////////////////////
-//
-// Tool_thru::getLabelSequence --
-//
-
-void Tool_thru::getLabelSequence(vector<string>& labelsequence,
-		const string& astring) {
-	int slength = (int)astring.size();
-	char* sdata = new char[slength+1];
-	strcpy(sdata, astring.c_str());
-	const char* ignorecharacters = ", [] ";
-	int index;
-
-	char* strptr = strtok(sdata, ignorecharacters);
-	while (strptr != NULL) {
-		labelsequence.resize((int)labelsequence.size() + 1);
-		index = (int)labelsequence.size() - 1;
-		labelsequence[index] = strptr;
-		strptr = strtok(NULL, ignorecharacters);
-	}
-
-	delete [] sdata;
 }
 
 
@@ -136241,6 +146395,7 @@ Tool_timebase::Tool_timebase(void) {
 	define("m|min=b",         "use minimum time in score for timebase");
 	define("t|timebase=s:16", "timebase rhythm");
 	define("q|quiet=b",       "quiet mode: Do not output warnings");
+	define("c|collapse=b",    "remove null data lines added by timebase");
 }
 
 
@@ -136259,6 +146414,12 @@ bool Tool_timebase::run(HumdrumFileSet& infiles) {
 }
 
 bool Tool_timebase::run(const string& indata, ostream& out) {
+	if (getBoolean("collapse")) {
+		// Collapsing does not need a parsed file:
+		collapseText(indata);
+		getAllText(out);
+		return true;
+	}
 	HumdrumFile infile(indata);
 	return run(infile, out);
 }
@@ -136266,6 +146427,11 @@ bool Tool_timebase::run(const string& indata, ostream& out) {
 
 bool Tool_timebase::run(HumdrumFile& infile, ostream& out) {
 	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	} else {
+		out << infile;
+	}
 	return status;
 }
 
@@ -136285,6 +146451,10 @@ bool Tool_timebase::run(HumdrumFile& infile) {
 void Tool_timebase::processFile(HumdrumFile& infile) {
 	m_grace   = getBoolean("grace");
 	m_quiet   = getBoolean("quiet");
+	if (getBoolean("collapse")) {
+		collapseScore(infile);
+		return;
+	}
 	if (!getBoolean("timebase")) {
 		m_basedur = getMinimumTime(infile);
 	} else {
@@ -136300,79 +146470,296 @@ void Tool_timebase::processFile(HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_timebase::expandScore --
+// Tool_timebase::buildRuns -- Store the duration of each line in the
+//    file as a count of timebase units (mindur).  The counts are
+//    calculated with integer arithmetic rather than by dividing HumNums.
 //
 
-void Tool_timebase::expandScore(HumdrumFile& infile, HumNum mindur) {
+void Tool_timebase::buildRuns(HumdrumFile& infile, HumNum mindur) {
+	m_runs.clear();
+	m_runs.reserve(infile.getLineCount());
+	long long basenum = mindur.getNumerator();
+	long long baseden = mindur.getDenominator();
 	for (int i=0; i<infile.getLineCount(); i++) {
+		m_runs.emplace_back();
+		TimebaseRun& run = m_runs.back();
+		run.m_line = i;
 		if (!infile[i].isData()) {
-			m_humdrum_text << infile[i] << endl;
 			continue;
 		}
 		HumNum duration = infile[i].getDuration();
-		if (duration == 0) {
+		// duration / mindur = num / den:
+		long long num = duration.getNumerator() * baseden;
+		long long den = duration.getDenominator() * basenum;
+		run.m_units = (int)(num / den);
+		run.m_exact = (num % den) == 0;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::expandScore -- Print each data line followed by enough
+//     lines of null tokens so that every data line has the timebase
+//     duration.  The null lines are copied from templates for each
+//     field count.
+//
+
+void Tool_timebase::expandScore(HumdrumFile& infile, HumNum mindur) {
+	buildRuns(infile, mindur);
+	// Null data lines in the output, and the ones which are from the input:
+	int nullcount = 0;
+	vector<int> inputnulls;
+	for (const TimebaseRun& run : m_runs) {
+		HumdrumLine& line = infile[run.m_line];
+		if (!line.isData()) {
+			m_humdrum_text << line << '\n';
+			continue;
+		}
+		if ((run.m_units == 0) && run.m_exact) {
+			// grace-note line
 			if (m_grace) {
-				m_humdrum_text << infile[i] << endl;
+				m_humdrum_text << line << '\n';
+				if (line.isAllNull()) {
+					inputnulls.push_back(++nullcount);
+				}
 			}
 			continue;
 		}
-		HumNum count = duration / mindur;
-		if (count < 1) {
+		if (run.m_units == 0) {
 			if (!m_quiet) {
 				m_humdrum_text << "!!Warning: following commented line was too short to be included in timebase output:\n";
-				m_humdrum_text << "!! " << infile[i] << endl;
+				m_humdrum_text << "!! " << line << '\n';
 			}
 			continue;
-		} else if (count.getDenominator() != 1) {
+		} else if (!run.m_exact) {
 			if (!m_quiet) {
+				HumNum count = line.getDuration() / mindur;
 				m_humdrum_text << "!!Warning: next line does not have proper duration for representing with timebase: " << count.getFloat() << endl;
 			}
 		}
-		m_humdrum_text << infile[i] << endl;
-		int repeats = int(count.getFloat()) - 1;
-		for (int j=0; j<repeats; j++) {
-			for (int k=0; k<infile[i].getFieldCount(); k++) {
-				m_humdrum_text << ".";
-				if (k < infile[i].getFieldCount() - 1) {
-					m_humdrum_text << "\t";
-				}
-			}
-			m_humdrum_text << endl;
+		m_humdrum_text << line << '\n';
+		if (line.isAllNull()) {
+			inputnulls.push_back(++nullcount);
 		}
+		const string& nullline = getNullLine(line.getFieldCount());
+		for (int j=1; j<run.m_units; j++) {
+			m_humdrum_text << nullline;
+		}
+		nullcount += run.m_units - 1;
 	}
 	if (!m_quiet) {
 		HumNum rhythm = Convert::durationToRecip(mindur);
 		m_humdrum_text << "!!timebased: " << rhythm << endl;
 	}
+	if (!inputnulls.empty()) {
+		// Needed by collapseScore() to keep the null lines of the input:
+		m_humdrum_text << "!!timebased-nulls:";
+		for (int number : inputnulls) {
+			m_humdrum_text << ' ' << number;
+		}
+		m_humdrum_text << '\n';
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::getNullLine -- Return a line of null data tokens (with
+//    a newline at the end) for the given number of fields.
+//
 
+const string& Tool_timebase::getNullLine(int fieldCount) {
+	if (fieldCount >= (int)m_nullLines.size()) {
+		m_nullLines.resize(fieldCount + 1);
+	}
+	string& output = m_nullLines[fieldCount];
+	if (output.empty()) {
+		for (int i=0; i<fieldCount; i++) {
+			output += (i == 0) ? "." : "\t.";
+		}
+		output += '\n';
+	}
+	return output;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_timebase::collapseScore -- Remove the null data lines added by
+//     expandScore(), and its timebase markers, so that each data line
+//     lasts until the next line with a note, rest or other data.  Null
+//     data lines from the input of expandScore() are listed in its
+//     "!!timebased-nulls:" marker and are kept.  Lines which expandScore()
+//     left out (grace-note lines without -g and lines shorter than the
+//     timebase) cannot be restored.
+//
+
+void Tool_timebase::collapseScore(HumdrumFile& infile) {
+	vector<bool> inputnulls;
+	for (int i=infile.getLineCount()-1; i>=0; i--) {
+		if (infile[i].compare(0, 18, "!!timebased-nulls:") == 0) {
+			getInputNulls(infile[i], inputnulls);
+			break;
+		}
+	}
+	int nullcount = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		if (line.isData() && line.isAllNull()) {
+			nullcount++;
+			if ((nullcount >= (int)inputnulls.size()) || !inputnulls[nullcount]) {
+				continue;
+			}
+		}
+		if (line.isCommentGlobal() && isTimebaseMarker(line.c_str())) {
+			continue;
+		}
+		m_humdrum_text << line << '\n';
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::isTimebaseMarker -- Returns true if the text starts with
+//     one of the global comments added by expandScore().
+//
+
+bool Tool_timebase::isTimebaseMarker(const char* text) {
+	return (strncmp(text, "!!timebased:", 12) == 0)
+			|| (strncmp(text, "!!timebased-nulls:", 18) == 0);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::getInputNulls -- Read the "!!timebased-nulls:" marker
+//     of expandScore(), which lists the null data lines (counting only
+//     null data lines, starting at 1) which are from its input.  The
+//     output is indexed by that count.
+//
+
+void Tool_timebase::getInputNulls(const string& marker, vector<bool>& output) {
+	output.clear();
+	stringstream input(marker.substr(18));
+	int number;
+	while (input >> number) {
+		if (number < 1) {
+			continue;
+		}
+		if (number >= (int)output.size()) {
+			output.resize(number + 1, false);
+		}
+		output[number] = true;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::collapseText -- Same as collapseScore(), but for Humdrum
+//     data which has not been parsed.  Lines which only contain null data
+//     tokens ("." separated by tabs) are checked, which is much faster
+//     than reading a timebased file into a HumdrumFile.  Lines may end
+//     in "\r\n", which is kept in the output.
+//
+
+void Tool_timebase::collapseText(const string& indata) {
+	vector<bool> inputnulls;
+	size_t marker = indata.rfind("!!timebased-nulls:");
+	if ((marker != string::npos) && ((marker == 0) || (indata[marker-1] == '\n'))) {
+		size_t end = indata.find('\n', marker);
+		if (end == string::npos) {
+			end = indata.size();
+		}
+		getInputNulls(indata.substr(marker, end - marker), inputnulls);
+	}
+
+	int nullcount = 0;
+	size_t start = 0;
+	while (start < indata.size()) {
+		size_t end = indata.find('\n', start);
+		if (end == string::npos) {
+			end = indata.size();
+		}
+		size_t stop = end;
+		if ((stop > start) && (indata[stop-1] == '\r')) {
+			stop--;
+		}
+		bool nullQ = (stop - start) % 2 == 1;
+		for (size_t i=start; nullQ && (i<stop); i++) {
+			nullQ = indata[i] == (((i - start) % 2) ? '\t' : '.');
+		}
+		if (nullQ) {
+			nullcount++;
+			nullQ = (nullcount >= (int)inputnulls.size()) || !inputnulls[nullcount];
+		}
+		if (!nullQ && !isTimebaseMarker(indata.c_str() + start)) {
+			m_humdrum_text.write(indata.data() + start, end - start);
+			m_humdrum_text << '\n';
+		}
+		start = end + 1;
+	}
+}
+
+
 
 ///////////////////////////////
 //
 // Tool_timebase::getMinimumTime -- Get the minimum time unit
-//    in the file.  This is the smallest non-zero line duration.
+//    in the file.  This is the largest duration which all non-zero
+//    line durations are a multiple of (the greatest common divisor
+//    of the durations), which is the smallest line duration for most
+//    files.  Mixed tuplets can make the divisor much smaller than any
+//    line, so if it would give more than TIMEBASE_MAX_EXPANSION lines
+//    for the smallest line duration, the smallest line duration is used
+//    instead (with a warning), as lines which are not a multiple of it
+//    are handled by expandScore().
 //
 
 HumNum Tool_timebase::getMinimumTime(HumdrumFile& infile) {
-	HumNum minimum(0, 1);
+	long long numerator = 0;
+	long long denominator = 1;
+	HumNum smallest = 0;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
 		HumNum duration = infile[i].getDuration();
-		if (minimum == 0) {
-			minimum = duration;
+		if (duration.getNumerator() <= 0) {
 			continue;
 		}
-		if (minimum > duration) {
-			minimum = duration;
+		if ((smallest == 0) || (duration < smallest)) {
+			smallest = duration;
 		}
+		if (denominator <= INT_MAX) {
+			numerator = std::gcd(numerator, (long long)duration.getNumerator());
+			denominator = std::lcm(denominator, (long long)duration.getDenominator());
+		}
+	}
+	if (numerator == 0) {
+		return 0;
 	}
 	// minimum is in units of quarter notes.
-	return minimum;
+	if (denominator <= INT_MAX) {
+		HumNum divisor((int)numerator, (int)denominator);
+		if (smallest / divisor <= TIMEBASE_MAX_EXPANSION) {
+			return divisor;
+		}
+	}
+	if (!m_quiet) {
+		m_humdrum_text << "!!Warning: line durations have no common timebase which is at least 1/"
+		               << TIMEBASE_MAX_EXPANSION << " of the shortest line, so using the shortest line duration"
+		               << endl;
+	}
+	return smallest;
 }
 
 
@@ -140535,14 +150922,14 @@ void Tool_vcross::getMidiInfo(vector<int>& midis, HTp token) {
 			return;
 		}
 	}
-	vector<string> subtokens = token->getSubtokens();
+	HumSubtokenView subtokens = token->getSubtokenView();
 	midis.resize(subtokens.size());
-	for (int i=0; i<(int)subtokens.size(); i++) {
-		if (subtokens[i].find("r") != string::npos) {
-			midis.at(i) = -1;
+	for (const HumSubtoken& subtoken : subtokens) {
+		if (subtoken.contains('r')) {
+			midis.at(subtoken.getIndex()) = -1;
 			continue;
 		}
-		midis.at(i) = Convert::kernToMidiNoteNumber(subtokens.at(i));
+		midis.at(subtoken.getIndex()) = subtoken.getMidiNoteNumber();
 	}
 }
 
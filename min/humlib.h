@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Mon Mar 10 11:43:34 PDT 2025
+// Last Modified: Sun Oct 18 02:22:27 UTC 2026
 // Filename:      min/humlib.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/min/humlib.h
 // Syntax:        C++11
@@ -40,10 +40,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _HUMLIB_H_INCLUDED
 
 #include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cctype>
 #include <chrono>
+#include <climits>
 #include <cmath>
 #include <cstdarg>
+#include <cstdint>
 #include <cstring>
 #include <cstring>
 #include <ctime>
@@ -54,12 +58,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <list>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -109,6 +118,7 @@ namespace hum {
 
 class Convert;
 class HumNum;
+class HumJsonWriter;
 class HumAddress;
 class HumdrumToken;
 typedef HumdrumToken* HTp;
@@ -139,8 +149,13 @@ typedef std::map<std::string, HumParameter> MapKV;
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
+		               HumHash             (HumHash&& hash) noexcept;
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+		HumHash&       operator=           (HumHash&& hash) noexcept;
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -243,6 +258,8 @@ class HumHash {
 		                                    const std::string& indent = "\t");
 		std::ostream&  printXmlAsGlobal    (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
+		void           printJson           (HumJsonWriter& json,
+		                                    const char* key = "parameters");
 
 		void           setOrigin           (const std::string& key,
 		                                    HumdrumToken* tok);
@@ -266,6 +283,8 @@ class HumHash {
 		                                    const std::string& ns2,
 		                                    const std::string& parameter) const;
 
+		void           remapTokens         (const std::unordered_map<HTp, HTp>& tokenmap);
+
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
@@ -377,6 +396,71 @@ std::ostream& operator<<(std::ostream& out, const std::vector<A>& v);
 
 
 
+class HumJsonWriter {
+	public:
+		// Selectable content for HumdrumFile::printJson():
+		enum {
+			FIELD_LINES      = 1 << 0,  // line type, text and references
+			FIELD_TOKENS     = 1 << 1,  // tokens on each line
+			FIELD_LINKS      = 1 << 2,  // next/previous token IDs
+			FIELD_STRANDS    = 1 << 3,  // strand list and token strand index
+			FIELD_RHYTHM     = 1 << 4,  // durations and timestamps
+			FIELD_PARAMETERS = 1 << 5,  // HumHash and linked parameters
+			FIELD_ALL        = (1 << 6) - 1
+		};
+
+		                HumJsonWriter   (std::ostream& out,
+		                                 const std::string& indent = "\t");
+		               ~HumJsonWriter   ();
+
+		void            beginObject     (void);
+		void            endObject       (void);
+		void            beginArray      (void);
+		void            endArray        (void);
+
+		void            writeKey        (const char* key);
+		void            writeKey        (const std::string& key);
+		void            writeString     (const std::string& value);
+		void            writeString     (const char* value);
+		void            writeInt        (int value);
+		void            writeBool       (bool value);
+		void            writeNull       (void);
+		void            writeNumber     (HumNum value);
+		void            writeLineId     (int line);
+		void            writeTokenId    (int line, int field);
+		void            flush           (void);
+
+		// Prefix for line and token IDs (see HumdrumFileBase::getXmlIdPrefix):
+		void            setIdPrefix     (const std::string& prefix) { m_prefix = prefix; }
+		const std::string& getIdPrefix  (void) const { return m_prefix; }
+
+		static int      parseFields     (const std::string& list);
+
+	protected:
+		void            separate        (void);
+		void            newline         (void);
+		void            put             (char ch);
+		void            put             (const char* text, size_t count);
+		void            putInt          (int value);
+		void            putEscaped      (const char* text, size_t count);
+
+	private:
+		std::ostream&     m_out;
+		std::string       m_indent;
+		std::string       m_prefix;
+		std::vector<char> m_buffer;
+		size_t            m_used    = 0;
+
+		// One entry for each open object/array: true if nothing has been
+		// written in it yet.
+		std::vector<bool> m_empty;
+
+		// true if the next value follows a key on the same line:
+		bool              m_afterKey = false;
+};
+
+
+
 #define INVALID_INTERVAL_CLASS -123456789
 
 // Diatonic pitch class integers:
@@ -594,6 +678,108 @@ class HumTransposer {
 
 
 
+class HumRegexNfa {
+	public:
+		                HumRegexNfa     (void);
+		                HumRegexNfa     (const std::string& exp, bool icase = false);
+
+		bool            compile         (const std::string& exp, bool icase = false);
+		void            clear           (void);
+		bool            isValid         (void) const { return m_valid; }
+		int             getGroupCount   (void) const { return m_groups; }
+		int             getProgramSize  (void) const { return (int)m_program.size(); }
+
+		// Search input starting at index start.  The searched range begins
+		// at index begin (for ^ and \b).  On success captures contains the
+		// start/end index pairs of the match and each group (-1 when a
+		// group did not participate).  continuous: match only at start;
+		// notnull: do not accept an empty match.
+		bool            search          (const std::string& input, int begin,
+		                                 int start, std::vector<int>& captures,
+		                                 bool continuous = false,
+		                                 bool notnull = false) const;
+
+		// Match the entire input string:
+		bool            match           (const std::string& input) const;
+
+		// Shared compiled expressions (NULL if the expression is not
+		// supported):
+		static std::shared_ptr<const HumRegexNfa> getCompiled(
+		                                 const std::string& exp, bool icase);
+
+	protected:
+		class Instruction {
+			public:
+				unsigned char m_op;
+				int           m_x;
+				int           m_y;
+		};
+
+		class Node {
+			public:
+				int              m_type;
+				int              m_value = 0;  // character, class or group
+				int              m_min   = 0;
+				int              m_max   = 0;   // -1 for unbounded
+				bool             m_greedy = true;
+				std::vector<int> m_children;
+		};
+
+		class ThreadList;
+
+		// parsing:
+		int             parseAlternation(void);
+		int             parseSequence   (void);
+		int             parseRepeat     (void);
+		int             parseAtom       (void);
+		int             parseEscape     (void);
+		int             parseBracket    (void);
+		int             parseBracketTerm(std::bitset<256>& set, bool& classQ);
+		int             makeNode        (int type, int value = 0);
+		int             makeClass       (const std::bitset<256>& set);
+		int             makeCharacter   (unsigned char ch);
+		bool            isNullable      (int node) const;
+
+		// compiling:
+		bool            emit            (int node);
+		int             addInstruction  (int op, int x = 0, int y = 0);
+		void            makeStartInfo   (void);
+
+		// matching:
+		bool            run             (const std::string& input, int begin,
+		                                 int start, int* captures, int slots,
+		                                 bool continuous, bool notnull,
+		                                 bool fullQ) const;
+		void            addThread       (ThreadList& list, int pc, int* captures,
+		                                 int slots, const std::string& input,
+		                                 int begin, int pos) const;
+		int             findStart       (const std::string& input, int pos) const;
+
+	private:
+		bool                          m_valid     = false;
+		bool                          m_icase     = false;
+		int                           m_groups    = 0;
+		std::vector<Instruction>      m_program;
+		std::vector<std::bitset<256>> m_classes;
+
+		// Characters which can start a match (when the expression cannot
+		// match an empty string), used to skip to candidate positions:
+		bool                          m_firstQ    = false;
+		int                           m_firstChar = -1;
+		std::bitset<256>              m_first;
+
+		// true if all matches must start at the beginning of the input:
+		bool                          m_anchored  = false;
+
+		// temporary parsing state:
+		std::string                   m_exp;
+		int                           m_pos       = 0;
+		int                           m_depth     = 0;
+		std::vector<Node>             m_nodes;
+};
+
+
+
 class HumRegex {
 	public:
 		            HumRegex           (void);
@@ -690,31 +876,60 @@ class HumRegex {
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
 
+		int         searchText         (const std::string& input, int startindex,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		bool        matchText          (const std::string& input,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		std::string replaceText        (const std::string& input,
+		                                const std::string& replacement,
+		                                const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags,
+		                                std::regex_constants::match_flag_type searchflags);
+		void        appendFormat       (std::string& output, const std::string& format,
+		                                const std::string& input,
+		                                const std::vector<int>& captures, int prefix);
+		const HumRegexNfa* getNfa      (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+		const std::regex&  getRegex    (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
 
 	private:
 
 		// m_regex: stores the regular expression to use as a default.
+		// It is only used for expressions which cannot be handled by
+		// m_nfa, and it is recompiled only when the expression changes.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
 		// .assign(string) == set the regular expression.
 		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
 		std::regex m_regex;
-
-		// m_matches: stores the matches from a search:
-		//
-		// http://en.cppreference.com/w/cpp/regex/match_results
-		// .empty()     == check if match was successful.
-		// .size()      == number of matches.
-		// .length(i)   == return length of a submatch.
-		// .position(i) == return start index of submatch in search string.
-		// .str(i)      == return string of submatch.
-		// operator[i]  == return submatch.
-		// .prefix
-		// .suffix
-		// .begin()     == start of submatch list.
-		// .end()       == end of submatch list.
-		std::smatch m_matches;
+		std::string m_regexexp;
+		std::regex_constants::syntax_option_type m_regexexpflags;
+		bool m_regexQ = false;
+
+		// m_nfa: linear-time matcher for m_nfaexp, or NULL if the expression
+		// needs std::regex (see HumRegexNfa).  Compiled expressions are
+		// shared between HumRegex objects.
+		std::shared_ptr<const HumRegexNfa> m_nfa;
+		std::string m_nfaexp;
+		std::regex_constants::syntax_option_type m_nfaflags;
+		bool m_nfaQ = false;
+
+		// m_input: copy of the string from the last search, which is
+		// searched starting at index m_begin.
+		std::string m_input;
+		int m_begin = 0;
+
+		// m_captures: stores the matches from the last search as start/end
+		// index pairs in m_input: [0..1] is the complete match and the
+		// following pairs are the submatches (-1 if a submatch did not
+		// participate in the match).  Empty if the search failed.
+		std::vector<int> m_captures;
 
 		// m_regexflags: store default settings for regex processing
 		// http://en.cppreference.com/w/cpp/regex/syntax_option_type
@@ -791,8 +1006,13 @@ class HumSignifier {
 class HumSignifiers {
 	public:
 		              HumSignifiers    (void);
+		              HumSignifiers    (const HumSignifiers& signifiers);
+		              HumSignifiers    (HumSignifiers&& signifiers) noexcept;
 		             ~HumSignifiers    ();
 
+		HumSignifiers& operator=       (const HumSignifiers& signifiers);
+		HumSignifiers& operator=       (HumSignifiers&& signifiers) noexcept;
+
 		void          clear            (void);
 		bool          addSignifier     (const std::string& rdfline);
 		bool          hasKernLinkSignifier (void);
@@ -845,16 +1065,29 @@ class HumAddress {
 		void                setOwner          (HLp aLine);
 		void                setFieldIndex     (int fieldlindex);
 		void                setSpineInfo      (const std::string& spineinfo);
+		void                shareSpineInfo    (const HumAddress& address);
 		void                setTrack          (int aTrack, int aSubtrack);
 		void                setTrack          (int aTrack);
 		void                setSubtrack       (int aSubtrack);
 		void                setSubtrackCount  (int aSubtrack);
+		void                releaseSpineInfo  (void);
 
 	private:
 
-		// fieldindex: This is the index of the token in the HumdrumLine
-		// which owns this token.
-		int m_fieldindex;
+		// SpineInfo: A spine info string which is shared by the addresses
+		// of the tokens in a spine between spine manipulators (see
+		// shareSpineInfo()).  It is deleted with the last address using it.
+		struct SpineInfo {
+			std::string      m_text;
+			std::atomic<int> m_refs;
+		};
+
+		// The address is stored in every token, so the fields are packed:
+		// the owner and spine info pointers first, then the field index,
+		// and then the track numbers (which are limited to 1000).
+
+		// owner: This is the line which manages the given token.
+		HLp          m_owner;
 
 		// spining: This is the spine position of the token. A simple spine
 		// position is an integer, starting with "1" for the first spine
@@ -866,18 +1099,24 @@ class HumAddress {
 		// But in this case there is a spine info simplification which will
 		// convert "(#)a (#)b" into "#" where # is the original spine number.
 		// Other more complicated mergers may be simplified in the future.
-		std::string m_spining;
+		// The string is shared by the tokens in the same part of a spine,
+		// and m_spining is NULL if the spine info is empty.
+		SpineInfo* m_spining;
+
+		// fieldindex: This is the index of the token in the HumdrumLine
+		// which owns this token.
+		int m_fieldindex;
 
 		// track: This is the track number of the spine.  It is the first
 		// number found in the spineinfo string.
-		int m_track;
+		int16_t m_track;
 
 		// subtrack: This is the subtrack number for the spine.  When a spine
 		// is not split, it will be 0, if the spine has been split with *^,
 		// then the left-subspine will be in subtrack 1 and the right-spine
 		// will be subtrack 2.  If subspines are exchanged with *x, then their
 		// subtrack assignments will also change.
-		int m_subtrack;
+		int16_t m_subtrack;
 
 		// subtrackcount: The number of currently active subtracks tokens
 		// on the owning HumdrumLine (in the same track).  The subtrack range
@@ -886,9 +1125,6 @@ class HumAddress {
 		// no tokens in the track (such as for global comments).
 		int m_subtrackcount;
 
-		// owner: This is the line which manages the given token.
-		HLp          m_owner;
-
 	friend class HumdrumToken;
 	friend class HumdrumLine;
 	friend class HumdrumFile;
@@ -938,6 +1174,328 @@ std::ostream& operator<<(std::ostream& out, HumParamSet& hps);
 
 
 
+class HumStringPool {
+	public:
+		                   HumStringPool     (void);
+		                  ~HumStringPool     ();
+
+		const std::string* intern            (const std::string& text);
+		const std::string* find              (const std::string& text) const;
+		int                getSize           (void) const;
+		size_t             getTextSize       (void) const;
+
+	private:
+		                   HumStringPool     (const HumStringPool& pool) = delete;
+		HumStringPool&     operator=         (const HumStringPool& pool) = delete;
+
+		mutable std::mutex              m_mutex;
+		std::unordered_set<std::string> m_strings;
+		size_t                          m_textsize = 0;  // characters in m_strings
+};
+
+
+
+class HumTokenLinks {
+	public:
+		                 HumTokenLinks  (void) {}
+		                 HumTokenLinks  (const HumTokenLinks& links);
+		                ~HumTokenLinks  ();
+
+		HumTokenLinks&   operator=      (const HumTokenLinks& links);
+
+		int              size           (void) const { return m_size; }
+		bool             empty          (void) const { return m_size == 0; }
+		void             clear          (void);
+		void             resize         (int count);
+		void             push_back      (HTp token);
+
+		HTp*             data           (void) { return m_capacity > 1 ? m_array : &m_single; }
+		const HTp*       data           (void) const { return m_capacity > 1 ? m_array : &m_single; }
+		HTp&             operator[]     (int index) { return data()[index]; }
+		HTp              operator[]     (int index) const { return data()[index]; }
+		HTp&             back           (void) { return data()[m_size - 1]; }
+		HTp*             begin          (void) { return data(); }
+		HTp*             end            (void) { return data() + m_size; }
+		const HTp*       begin          (void) const { return data(); }
+		const HTp*       end            (void) const { return data() + m_size; }
+		std::vector<HTp> toVector       (void) const;
+
+	protected:
+		void             reserve        (int count);
+
+	private:
+		// m_single is used when m_capacity is 1, otherwise m_array points
+		// to an allocated array of m_capacity links.
+		union {
+			HTp          m_single = NULL;
+			HTp*         m_array;
+		};
+		int              m_size     = 0;
+		int              m_capacity = 1;
+};
+
+
+
+class HumKernNote {
+	public:
+		// Articulation bitmasks (see getArticulations()):
+		enum {
+			ART_STACCATO      = 0x0001,  // '
+			ART_STACCATISSIMO = 0x0002,  // `
+			ART_ACCENT        = 0x0004,  // ^
+			ART_MARCATO       = 0x0008,  // ^^
+			ART_TENUTO        = 0x0010,  // ~
+			ART_FERMATA       = 0x0020,  // ;
+			ART_HARMONIC      = 0x0040,  // o
+			ART_ARPEGGIO      = 0x0080,  // :
+			ART_UPBOW         = 0x0100,  // v
+			ART_DOWNBOW       = 0x0200,  // u
+			ART_BREATH        = 0x0400,  // ,
+			ART_PIZZICATO     = 0x0800,  // "
+			ART_SFORZANDO     = 0x1000   // z
+		};
+
+		// Ornament bitmasks (see getOrnaments()):
+		enum {
+			ORN_TRILL_MINOR   = 0x01,  // t
+			ORN_TRILL_MAJOR   = 0x02,  // T
+			ORN_MORDENT_MINOR = 0x04,  // m
+			ORN_MORDENT_MAJOR = 0x08,  // M
+			ORN_LOWER_MINOR   = 0x10,  // w (inverted mordent)
+			ORN_LOWER_MAJOR   = 0x20,  // W (inverted mordent)
+			ORN_TURN          = 0x40,  // S
+			ORN_INVERTED_TURN = 0x80   // $
+		};
+
+		                HumKernNote         (void) {}
+
+		// Location of the subtoken in the token text:
+		int             getStart            (void) const { return m_start; }
+		int             getLength           (void) const { return m_length; }
+		std::string     getText             (const std::string& token) const;
+		bool            contains            (const std::string& token,
+		                                     const std::string& pattern) const;
+
+		// Pitch: a rest marker ('r') is ignored, so pitched rests and
+		// unsounding notes in chords have a pitch.  The values are the
+		// same as Convert::kernToBase40() and Convert::kernToBase7() for
+		// the subtoken (with 'r' removed).
+		bool            hasPitch            (void) const { return m_diatonic >= 0; }
+		int             getBase40           (void) const;
+		int             getBase7            (void) const;
+		int             getDiatonicPC       (void) const { return m_diatonic; }
+		int             getOctave           (void) const;
+		int             getAccidentalCount  (void) const { return m_accidentals; }
+		char            getAccidentalMark   (void) const { return m_accidentalMark; }
+		bool            hasExplicitNatural  (void) const { return m_flags & FLAG_NATURAL; }
+		bool            isAccidentalHidden  (void) const;
+
+		bool            isRest              (void) const { return m_flags & FLAG_REST; }
+		bool            isUnpitched         (void) const { return m_flags & FLAG_UNPITCHED; }
+		bool            isNote              (void) const;
+		bool            isInvisible         (void) const { return m_flags & FLAG_INVISIBLE; }
+
+		// Rhythm:
+		HumNum          getDuration         (void) const;
+		int             getRhythm           (void) const { return m_rhythm; }
+		int             getRhythmDenominator(void) const { return m_rhythmDen; }
+		int             getDots             (void) const { return m_dots; }
+		bool            isGrace             (void) const { return m_flags & FLAG_GRACE; }
+
+		// Ties:
+		bool            isTieStart          (void) const { return m_flags & FLAG_TIE_START; }
+		bool            isTieContinue       (void) const { return m_flags & FLAG_TIE_CONTINUE; }
+		bool            isTieEnd            (void) const { return m_flags & FLAG_TIE_END; }
+		bool            isSecondaryTiedNote (void) const;
+
+		// Slurs, phrases and beams:
+		int             getSlurStartCount   (void) const { return m_slurStarts; }
+		int             getSlurEndCount     (void) const { return m_slurEnds; }
+		int             getPhraseStartCount (void) const { return m_phraseStarts; }
+		int             getPhraseEndCount   (void) const { return m_phraseEnds; }
+		int             getBeamStartCount   (void) const { return m_beamStarts; }
+		int             getBeamEndCount     (void) const { return m_beamEnds; }
+		int             getHookCount        (void) const { return m_hooks; }
+
+		char            getStemDirection    (void) const { return m_stem; }
+		int             getArticulations    (void) const { return m_articulations; }
+		bool            hasArticulation     (int mask) const { return (m_articulations & mask) != 0; }
+		int             getOrnaments        (void) const { return m_ornaments; }
+		bool            hasOrnament         (int mask) const { return (m_ornaments & mask) != 0; }
+
+	protected:
+		enum {
+			FLAG_REST         = 0x0001,
+			FLAG_UNPITCHED    = 0x0002,
+			FLAG_GRACE        = 0x0004,
+			FLAG_TIE_START    = 0x0008,
+			FLAG_TIE_CONTINUE = 0x0010,
+			FLAG_TIE_END      = 0x0020,
+			FLAG_NATURAL      = 0x0040,
+			FLAG_INVISIBLE    = 0x0080,
+			FLAG_HIDDEN_ACCID = 0x0100,
+			FLAG_MIXED_CASE   = 0x0200
+		};
+
+	private:
+		int            m_start          = 0;
+		int            m_length         = 0;
+		int            m_rhythm         = -1;  // -1 = no rhythm, 0 = breve or longer
+		int            m_rhythmDen      = 1;   // for rational rhythms (3%2)
+		unsigned short m_flags          = 0;
+		unsigned short m_articulations  = 0;
+		signed char    m_diatonic       = -1;  // 0=C ... 6=B; -1 = no pitch
+		signed char    m_octave         = 0;
+		signed char    m_accidentals    = 0;
+		char           m_accidentalMark = '\0';
+		unsigned char  m_ornaments      = 0;
+		unsigned char  m_dots           = 0;
+		unsigned char  m_zeros          = 0;   // 1 = breve, 2 = long, 3 = maxima
+		unsigned char  m_slurStarts     = 0;
+		unsigned char  m_slurEnds       = 0;
+		unsigned char  m_phraseStarts   = 0;
+		unsigned char  m_phraseEnds     = 0;
+		unsigned char  m_beamStarts     = 0;
+		unsigned char  m_beamEnds       = 0;
+		unsigned char  m_hooks          = 0;
+		char           m_stem           = '\0';
+
+	friend class HumKernToken;
+};
+
+
+
+class HumKernToken {
+	public:
+		                   HumKernToken     (void) {}
+		                   HumKernToken     (const std::string& token);
+
+		void               clear            (void);
+		void               lex              (const std::string& token);
+
+		// Chord notes (one for each subtoken, including empty subtokens
+		// caused by extra spaces, as in HumdrumToken::getSubtokenCount()):
+		int                getNoteCount     (void) const { return (int)m_notes.size(); }
+		const HumKernNote& getNote          (int index) const;
+
+		// Token-level information, matching the Convert::isKern*() and
+		// Convert::hasKern*() functions for the whole token:
+		bool               hasRest          (void) const { return m_hasRest; }
+		bool               hasPitch         (void) const { return m_hasPitch; }
+		bool               isNote           (void) const { return m_hasPitch && !m_hasRest; }
+		bool               isSecondaryTiedNote(void) const { return isNote() && m_hasTieContinuation; }
+		bool               isNoteAttack     (void) const { return isNote() && !m_hasTieContinuation; }
+		char               getStemDirection (void) const { return m_stem; }
+
+		int                getSlurStartCount  (void) const { return getMarkerCount('('); }
+		int                getSlurEndCount    (void) const { return getMarkerCount(')'); }
+		int                getPhraseStartCount(void) const { return getMarkerCount('{'); }
+		int                getPhraseEndCount  (void) const { return getMarkerCount('}'); }
+		int                getBeamStartCount  (void) const { return getMarkerCount('L'); }
+		int                getBeamEndCount    (void) const { return getMarkerCount('J'); }
+
+		// Number of '&' characters before the (index+1)-th marker in the
+		// token, or -1 if there is no such marker:
+		int                getSlurStartElisionLevel  (int index = 0) const { return getElisionLevel('(', index); }
+		int                getSlurEndElisionLevel    (int index = 0) const { return getElisionLevel(')', index); }
+		int                getPhraseStartElisionLevel(int index = 0) const { return getElisionLevel('{', index); }
+		int                getPhraseEndElisionLevel  (int index = 0) const { return getElisionLevel('}', index); }
+		int                getBeamStartElisionLevel  (int index = 0) const { return getElisionLevel('L', index); }
+		int                getBeamEndElisionLevel    (int index = 0) const { return getElisionLevel('J', index); }
+
+		int                getMarkerCount   (char marker) const;
+		int                getElisionLevel  (char marker, int index) const;
+
+	private:
+		// Slur, phrase and beam markers in the order that they occur
+		// in the token:
+		class Marker {
+			public:
+				char          m_type;     // ( ) { } L or J
+				unsigned char m_elision;  // number of '&' before the marker
+				short         m_note;     // index of the chord note
+		};
+
+		std::vector<HumKernNote> m_notes;
+		std::vector<Marker>      m_markers;
+		bool                     m_hasRest            = false;
+		bool                     m_hasPitch           = false;
+		bool                     m_hasTieContinuation = false;
+		char                     m_stem               = '\0';
+};
+
+
+
+class HumSegmentIndex {
+	public:
+		                   HumSegmentIndex     (void);
+		                   HumSegmentIndex     (const std::string& filename);
+
+		void               clear               (void);
+		int                getSize             (void) const { return (int)m_segments.size(); }
+		int                getCount            (void) const { return getSize(); }
+		const std::string& getFilename         (void) const { return m_filename; }
+
+		// Create the index by scanning a data file:
+		bool               build               (const std::string& filename,
+		                                        bool referencesQ = false);
+		bool               build               (std::istream& input,
+		                                        bool referencesQ = false);
+
+		// Sidecar index files:
+		bool               load                (const std::string& filename,
+		                                        bool referencesQ = false);
+		bool               readIndex           (const std::string& indexname);
+		bool               readIndex           (std::istream& input);
+		bool               writeIndex          (const std::string& indexname) const;
+		bool               writeIndex          (std::ostream& output) const;
+		static std::string getIndexFilename    (const std::string& filename);
+
+		// Segment information:
+		int                getSegment          (const std::string& name) const;
+		long long          getOffset           (int index) const;
+		long long          getLength           (int index) const;
+		const std::string& getName             (int index) const;
+		int                getLevel            (int index) const;
+		const std::vector<std::string>& getUniversals(int index) const;
+		const std::vector<std::string>& getReferenceKeys(int index) const;
+		bool               hasReferenceKey     (int index, const std::string& key) const;
+		bool               hasReferenceKeys    (void) const { return m_referencesQ; }
+
+		bool               getText             (std::istream& input, int index,
+		                                        std::string& text) const;
+
+	protected:
+		void               addSegment          (long long offset, const std::string& line);
+		int                addUniversals       (const std::vector<std::string>& universals);
+		void               makeNameIndex       (void);
+
+	private:
+		class Segment {
+			public:
+				long long                m_offset    = 0;
+				long long                m_length    = 0;
+				int                      m_level     = 0;
+				int                      m_universal = -1;  // index into m_universals
+				std::string              m_name;
+				std::vector<std::string> m_keys;
+		};
+
+		std::string                           m_filename;
+		long long                             m_filesize   = 0;
+		bool                                  m_referencesQ = false;
+		std::vector<Segment>                  m_segments;
+
+		// Universal comments from earlier segments that are prepended to a
+		// segment when it is read (see HumdrumFileStream::getFile()):
+		std::vector<std::vector<std::string>> m_universals;
+
+		// Segment index for each name (first segment with a given name):
+		std::unordered_map<std::string, int>  m_names;
+};
+
+
+
 class _HumInstrument {
 	public:
 		_HumInstrument    (void) { humdrum = ""; name = ""; gm = 0; }
@@ -965,10 +1523,15 @@ class HumInstrument {
 
 	private:
 		int                            m_index;
-		static std::vector<_HumInstrument>  m_data;
-		static int                     m_classcount;
+
+		// m_data: instrument table, shared with other objects until it
+		// is changed with setGM().
+		std::shared_ptr<std::vector<_HumInstrument>> m_data;
+
+		explicit    HumInstrument       (std::shared_ptr<std::vector<_HumInstrument>> data);
 
 	protected:
+		static std::shared_ptr<std::vector<_HumInstrument>> getDefaultData(void);
 		void       initialize          (void);
 		void       afi                 (const char* humdrum_name, int midinum,
 		                                const char* EN_name);
@@ -1290,6 +1853,7 @@ class HumdrumLine : public std::string, public HumHash {
 		                                    const std::string& indent);
 		std::ostream& printGlobalXmlParameterInfo(std::ostream& out, int level,
 		                                    const std::string& indent);
+		void          printJson            (HumJsonWriter& json, int fields);
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void          clearTokenLinkInfo   (void);
@@ -1379,6 +1943,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     setLineIndex           (int index);
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
+		void     invalidateTrackIndex   (void);
 		int      createTokensFromLine   (void);
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
@@ -1469,6 +2034,90 @@ std::ostream& operator<< (std::ostream& out, HLp line);
 
 typedef HumdrumToken* HTp;
 
+
+// HumSubtoken: a subtoken (such as a chord note) in the text of a token,
+// without a copy of the text.  For space-separated subtokens of a **kern
+// token the **kern record of the note (pitch, rhythm, ties) is also
+// available.
+
+class HumSubtoken {
+	public:
+		std::string_view   getText             (void) const { return m_text; }
+		std::string        getString           (void) const { return std::string(m_text); }
+		int                getIndex            (void) const { return m_index; }
+		int                getStart            (void) const { return m_start; }
+		bool               contains            (char ch) const
+		                      { return m_text.find(ch) != std::string_view::npos; }
+		bool               operator==          (std::string_view text) const
+		                      { return m_text == text; }
+		bool               operator!=          (std::string_view text) const
+		                      { return m_text != text; }
+
+		// **kern information (an empty record if the token is not **kern
+		// or the subtokens are not separated by spaces):
+		const HumKernNote& getKernNote         (void) const;
+		bool               hasPitch            (void) const { return getKernNote().hasPitch(); }
+		bool               isRest              (void) const { return getKernNote().isRest(); }
+		bool               isNote              (void) const { return getKernNote().isNote(); }
+		bool               isSecondaryTiedNote (void) const { return getKernNote().isSecondaryTiedNote(); }
+		int                getBase40           (void) const { return getKernNote().getBase40(); }
+		int                getBase7            (void) const { return getKernNote().getBase7(); }
+		int                getMidiNoteNumber   (void) const;
+		HumNum             getDuration         (void) const { return getKernNote().getDuration(); }
+
+	private:
+		std::string_view   m_text;
+		int                m_index = 0;
+		int                m_start = 0;
+		const HumKernNote* m_note  = NULL;
+
+	friend class HumSubtokenView;
+};
+
+
+// HumSubtokenView: iterate over the subtokens of a token without allocating
+// strings.  Space-separated subtokens of a **kern token are read from a
+// **kern record which is lexed when the view is created (see HumKernToken);
+// other subtokens are found by searching the token text.  The view is
+// invalid after the token text is changed.
+
+class HumSubtokenView {
+	public:
+		class iterator {
+			public:
+				                   iterator    (void) {}
+				                   iterator    (const HumSubtokenView* view, int index);
+				const HumSubtoken& operator*   (void) const { return m_current; }
+				const HumSubtoken* operator->  (void) const { return &m_current; }
+				iterator&          operator++  (void);
+				bool               operator==  (const iterator& other) const
+				                      { return m_current.m_index == other.m_current.m_index; }
+				bool               operator!=  (const iterator& other) const
+				                      { return m_current.m_index != other.m_current.m_index; }
+			private:
+				void               load        (int start);
+				const HumSubtokenView* m_view = NULL;
+				HumSubtoken        m_current;
+		};
+
+		                   HumSubtokenView     (const HumdrumToken& token,
+		                                        const std::string& separator = " ");
+		int                size                (void) const { return m_size; }
+		bool               isKern              (void) const { return m_kernQ; }
+		HumSubtoken        operator[]          (int index) const;
+		iterator           begin               (void) const { return iterator(this, 0); }
+		iterator           end                 (void) const { return iterator(this, m_size); }
+
+	private:
+		std::string_view    m_text;
+		std::string         m_separator;
+		HumKernToken        m_kern;
+		bool                m_kernQ = false;
+		int                 m_size = 0;
+};
+
+
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -1689,6 +2338,7 @@ class HumdrumToken : public std::string, public HumHash {
 		std::string   getSubtoken          (int index,
 		                                    const std::string& separator = " ") const;
 		std::vector<std::string> getSubtokens (const std::string& separator = " ") const;
+		HumSubtokenView getSubtokenView    (const std::string& separator = " ") const;
 		void     replaceSubtoken           (int index, const std::string& newsubtok,
 		                                    const std::string& separator = " ");
 		void     setParameters             (HTp ptok);
@@ -1704,6 +2354,9 @@ class HumdrumToken : public std::string, public HumHash {
 		int      getPhraseStartElisionLevel(int index) const;
 		int      getPhraseEndElisionLevel  (int index = 0) const;
 
+		HumKernToken getKernInfo           (void) const;
+		HumKernNote  getKernNote           (int index = 0) const;
+
 		HTp      getSlurStartToken         (int number = 1);
 		int      getSlurStartNumber        (int endnumber);
 		HTp      getSlurEndToken           (int number = 1);
@@ -1716,6 +2369,7 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 		std::ostream& printGlobalXmlParameterInfo(std::ostream& out = std::cout, int level = 0,
 		                                   const std::string& indent = "\t");
+		void          printJson            (HumJsonWriter& json, int fields);
 		std::string   getXmlId             (const std::string& prefix = "") const;
 		std::string   getXmlIdPrefix       (void) const;
 		void     setText                   (const std::string& text);
@@ -1724,6 +2378,7 @@ class HumdrumToken : public std::string, public HumHash {
 		int      addLinkedParameterSet     (HTp token);
 		int      getLinkedParameterSetCount(void);
 		HumParamSet* getLinkedParameterSet (int index);
+		HTp      getLinkedParameterToken   (int index);
 		HumParamSet* getParameterSet       (void);
 		void         clearLinkInfo         (void);
 		std::string getSlurLayoutParameter (const std::string& keyname, int subtokenindex = -1);
@@ -1795,6 +2450,7 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setLineIndex              (int lineindex);
 		void     setFieldIndex             (int fieldlindex);
 		void     setSpineInfo              (const std::string& spineinfo);
+		void     shareSpineInfo            (HTp token);
 		void     setSubtrack               (int aSubtrack);
 		void     setSubtrackCount          (int count);
 		void     setPreviousToken          (HTp aToken);
@@ -1837,22 +2493,26 @@ class HumdrumToken : public std::string, public HumHash {
 		// following token, but there can be two tokens if the current
 		// token is *^, and there will be zero following tokens after a
 		// spine terminating token (*-).
-		std::vector<HTp> m_nextTokens;     // link to next token(s) in spine
+		HumTokenLinks m_nextTokens;     // link to next token(s) in spine
 
 		// previousTokens: Simiar to nextTokens, but for the immediately
 		// follow token(s) in the data.  Typically there will be one
 		// preceding token, but there can be multiple tokens when the previous
 		// line has *v merge tokens for the spine.  Exclusive interpretations
 		// have no tokens preceding them.
-		std::vector<HTp> m_previousTokens; // link to last token(s) in spine
+		HumTokenLinks m_previousTokens; // link to last token(s) in spine
 
 		// nextNonNullTokens: This is a list of non-tokens in the spine
 		// that follow this one.
-		std::vector<HTp> m_nextNonNullTokens;
+		HumTokenLinks m_nextNonNullTokens;
 
 		// previousNonNullTokens: This is a list of non-tokens in the spine
 		// that preced this one.
-		std::vector<HTp> m_previousNonNullTokens;
+		HumTokenLinks m_previousNonNullTokens;
+
+		// m_nullresolve: used to point to the token that a null token
+		// refers to.
+		HTp m_nullresolve;
 
 		// rhycheck: Used to perfrom HumdrumFileStructure::analyzeRhythm
 		// recursively.
@@ -1863,25 +2523,33 @@ class HumdrumToken : public std::string, public HumHash {
 		// (not the 2-d one).
 		int m_strand;
 
-		// m_nullresolve: used to point to the token that a null token
-		// refers to.
-		HTp m_nullresolve;
+		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
+		bool m_rhythm_analyzed = false;
 
-		// m_linkedParameterTokens: List of Humdrum tokens which are parameters
-		// (mostly only layout parameters at the moment).
-		// Was previously called m_linkedParameters;
-		std::vector<HTp> m_linkedParameterTokens;
+		// ColdData: Data which only a few tokens in a file use.  It is
+		// allocated the first time that one of the values is set.
+		class ColdData {
+			public:
+				~ColdData() { delete m_parameterSet; }
 
-		// m_parameterSet: A single parameter encoded in the text of the
-		// token.  Was previously called m_linkedParameter.
-		HumParamSet* m_parameterSet = NULL;
+				// m_linkedParameterTokens: List of Humdrum tokens which are
+				// parameters (mostly only layout parameters at the moment).
+				// Was previously called m_linkedParameters;
+				std::vector<HTp> m_linkedParameterTokens;
 
-		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
-		bool m_rhythm_analyzed = false;
+				// m_parameterSet: A single parameter encoded in the text of the
+				// token.  Was previously called m_linkedParameter.
+				HumParamSet* m_parameterSet = NULL;
+
+				// m_strophe: Starting point of a strophe that the token belongs
+				// to.  NULL means that it is not in a strophe.
+				HTp m_strophe = NULL;
+		};
 
-		// m_strophe: Starting point of a strophe that the token belongs to.
-		// NULL means that it is not in a strophe.
-		HTp m_strophe = NULL;
+		// m_cold: NULL if the token does not have any ColdData.
+		ColdData* m_cold = NULL;
+
+		ColdData& getColdData(void);
 
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
@@ -1914,6 +2582,11 @@ std::ostream& printSequence(std::vector<HTp>& sequence, std::ostream& out = std:
 //                        a list of tokens from lines which hasSpines() it true.
 // * OPT_NOREST     => don't include **kern rests.
 // * OPT_NOTIE      => don't include **kern secondary tied notes.
+// * OPT_NOBARLINE  => don't include barlines.
+// * OPT_NODATA     => don't include data tokens (other than barlines).
+// * OPT_NOTANDEM   => don't include any interpretation tokens (OPT_NOINTERP
+//                        only removes manipulators, exclusive interpretations
+//                        and terminators).
 //
 // Compound options:
 // * OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
@@ -1930,6 +2603,9 @@ std::ostream& printSequence(std::vector<HTp>& sequence, std::ostream& out = std:
 #define OPT_NOGLOBAL  0x040
 #define OPT_NOREST    0x080
 #define OPT_NOTIE     0x100
+#define OPT_NOBARLINE 0x200
+#define OPT_NODATA    0x400
+#define OPT_NOTANDEM  0x800
 #define OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
@@ -1947,6 +2623,235 @@ class TokenPair {
 };
 
 
+// HumTrackIndex: the tokens of a track in line order, which are stored by
+// HumdrumFileBase::analyzeTracks() for use by HumTrackView.  Each non-empty
+// line of the file is a row: global lines have a single token in each
+// track's index (the global comment or reference record), and other lines
+// have the tokens of the track in field order.
+
+class HumTrackIndex {
+	public:
+		void clear(void) {
+			m_tokens.clear();
+			m_rows.clear();
+			m_global.clear();
+		}
+
+		// m_tokens: the tokens of the track, row by row.
+		std::vector<HTp> m_tokens;
+
+		// m_rows: index of the first token of each row in m_tokens, followed
+		// by the size of m_tokens.
+		std::vector<int> m_rows;
+
+		// m_global: true for rows which are global lines.
+		std::vector<char> m_global;
+};
+
+
+// HumTrackView: non-owning view of the tokens in a track (or spine) which
+// is read from the file's track index, so iterating it does not allocate
+// memory.  Create views with HumdrumFileBase::getTrackView(), getSpineView()
+// or getPrimaryTrackView().  The options are the OPT_* flags also used by
+// getTrackSequence(), and the rows of the view are the same as the lists
+// returned by getTrackSequence().  A view should not be used after lines
+// or tokens are added to or removed from the file.
+//
+// Example:
+//    for (auto row : infile.getTrackView(track, OPT_DATA)) {
+//       for (HTp token : row) { ... }   // all subspines on a line
+//    }
+//    for (HTp token : infile.getPrimaryTrackView(track, OPT_ATTACKS).tokens()) {
+//       ...
+//    }
+
+class HumTrackView {
+	public:
+		// Row: the tokens of the track on one line which pass the filters.
+		class Row {
+			public:
+				class iterator {
+					public:
+						typedef std::forward_iterator_tag iterator_category;
+						typedef HTp                       value_type;
+						typedef std::ptrdiff_t            difference_type;
+						typedef const HTp*                pointer;
+						typedef HTp                       reference;
+
+						iterator(void) {}
+						iterator(const HTp* current, const HTp* last, int options);
+						HTp       operator*   (void) const { return *m_current; }
+						iterator& operator++  (void);
+						iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+						bool      operator==  (const iterator& other) const
+						                         { return m_current == other.m_current; }
+						bool      operator!=  (const iterator& other) const
+						                         { return m_current != other.m_current; }
+					private:
+						void      skip        (void);
+						const HTp* m_current = NULL;
+						const HTp* m_last    = NULL;
+						int        m_options = 0;
+				};
+
+				Row(void) {}
+				Row(const HTp* first, const HTp* last, int options);
+				iterator  begin       (void) const
+				                         { return iterator(m_first, m_last, m_options); }
+				iterator  end         (void) const
+				                         { return iterator(m_last, m_last, m_options); }
+				bool      empty       (void) const { return m_first == m_last; }
+				int       size        (void) const;
+				HTp       front       (void) const { return *begin(); }
+				HTp       operator[]  (int index) const;
+				int       getLineIndex(void) const;
+
+			private:
+				const HTp* m_first   = NULL;
+				const HTp* m_last    = NULL;
+				int        m_options = 0;
+		};
+
+		// iterator: rows of the view.
+		class iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef Row                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const Row*                pointer;
+				typedef Row                       reference;
+
+				iterator(void) {}
+				iterator(const HumTrackIndex* index, int options, int row);
+				Row       operator*   (void) const { return m_current; }
+				const Row* operator-> (void) const { return &m_current; }
+				iterator& operator++  (void);
+				iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+				bool      operator==  (const iterator& other) const
+				                         { return m_row == other.m_row; }
+				bool      operator!=  (const iterator& other) const
+				                         { return m_row != other.m_row; }
+			private:
+				void      skip        (void);
+				const HumTrackIndex* m_index = NULL;
+				int       m_options = 0;
+				int       m_row = 0;
+				Row       m_current;
+		};
+
+		// token_iterator: tokens of all rows of the view.
+		class token_iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef HTp                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const HTp*                pointer;
+				typedef HTp                       reference;
+
+				token_iterator(void) {}
+				token_iterator(iterator row, iterator last);
+				HTp       operator*   (void) const { return *m_token; }
+				token_iterator& operator++ (void);
+				token_iterator  operator++ (int)
+				              { token_iterator old = *this; ++*this; return old; }
+				bool      operator==  (const token_iterator& other) const
+				            { return (m_row == other.m_row) && (m_token == other.m_token); }
+				bool      operator!=  (const token_iterator& other) const
+				            { return !(*this == other); }
+			private:
+				iterator      m_row;
+				iterator      m_last;
+				Row::iterator m_token;
+		};
+
+		class TokenRange {
+			public:
+				TokenRange(iterator first, iterator last) : m_first(first), m_last(last) {}
+				token_iterator begin(void) const
+				                   { return token_iterator(m_first, m_last); }
+				token_iterator end(void) const
+				                   { return token_iterator(m_last, m_last); }
+			private:
+				iterator m_first;
+				iterator m_last;
+		};
+
+		              HumTrackView  (void) {}
+		              HumTrackView  (const HumTrackIndex* index, int options)
+		                               : m_index(index), m_options(options) {}
+		iterator      begin         (void) const
+		                               { return iterator(m_index, m_options, 0); }
+		iterator      end           (void) const
+		                { return iterator(m_index, m_options, getRowCount(m_index)); }
+		bool          empty         (void) const { return begin() == end(); }
+		int           size          (void) const;
+		TokenRange    tokens        (void) const { return TokenRange(begin(), end()); }
+		int           getOptions    (void) const { return m_options; }
+
+		static bool   isAccepted    (HTp token, int options);
+
+	protected:
+		static int    getRowCount   (const HumTrackIndex* index);
+		static bool   makeRow       (const HumTrackIndex* index, int options,
+		                             int row, Row& output);
+
+	private:
+		const HumTrackIndex* m_index = NULL;
+		int                  m_options = 0;
+};
+
+
+// HumSpineStartView: non-owning view of the starting exclusive
+// interpretations of the spines in a file (optionally only those of
+// a given data type), from HumdrumFileBase::getSpineStartView().
+// Iterators keep their own copy of the data type, so they remain valid
+// after the view is copied or destroyed (but not after the spines of
+// the file are analyzed again).
+
+class HumSpineStartView {
+	public:
+		class iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef HTp                       value_type;
+				typedef std::ptrdiff_t            difference_type;
+				typedef const HTp*                pointer;
+				typedef HTp                       reference;
+
+				iterator(void) {}
+				iterator(const HTp* current, const HTp* last, const std::string& exinterp);
+				HTp       operator*   (void) const { return *m_current; }
+				iterator& operator++  (void);
+				iterator  operator++  (int) { iterator old = *this; ++*this; return old; }
+				bool      operator==  (const iterator& other) const
+				                         { return m_current == other.m_current; }
+				bool      operator!=  (const iterator& other) const
+				                         { return m_current != other.m_current; }
+			private:
+				void      skip        (void);
+				const HTp*  m_current = NULL;
+				const HTp*  m_last    = NULL;
+				std::string m_exinterp;   // empty for all spines
+		};
+
+		              HumSpineStartView(void) {}
+		              HumSpineStartView(const HTp* first, const HTp* last);
+		              HumSpineStartView(const HTp* first, const HTp* last,
+		                                const std::string& exinterp);
+		iterator      begin         (void) const
+		                               { return iterator(m_first, m_last, m_exinterp); }
+		iterator      end           (void) const
+		                               { return iterator(m_last, m_last, m_exinterp); }
+		bool          empty         (void) const { return begin() == end(); }
+		int           size          (void) const;
+
+	private:
+		const HTp*  m_first = NULL;
+		const HTp*  m_last  = NULL;
+		std::string m_exinterp;   // empty for all spines
+};
+
+
 // HumFileAnalysis: class used to manage analysis states for a Humdrum file.
 
 class HumFileAnalysis {
@@ -1962,6 +2867,7 @@ class HumFileAnalysis {
 			m_phrases_analyzed   = false;
 			m_nulls_analyzed     = false;
 			m_strophes_analyzed  = false;
+			m_metric_analyzed    = false;
 
 			m_barlines_analyzed  = false;
 			m_barlines_different = false;
@@ -1999,6 +2905,10 @@ class HumFileAnalysis {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_metric_analyzed: Used to keep track of whether or not the
+		// metric index is valid (see HumdrumFileContent::getMetricInfo()).
+		bool m_metric_analyzed = false;
+
 		// m_barlines_analyzed: Used to keep track of wheter or not
 		// barlines have beena analyzed yet.
 		bool m_barlines_analyzed = false;
@@ -2015,11 +2925,14 @@ class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
 		              HumdrumFileBase          (HumdrumFileBase& infile);
+		              HumdrumFileBase          (HumdrumFileBase&& infile) noexcept;
 		              HumdrumFileBase          (const std::string& contents);
 		              HumdrumFileBase          (std::istream& contents);
 		             ~HumdrumFileBase          ();
 
 		HumdrumFileBase& operator=             (HumdrumFileBase& infile);
+		HumdrumFileBase& operator=             (HumdrumFileBase&& infile) noexcept;
+		void          cloneFrom                (const HumdrumFileBase& infile);
 		bool          read                     (std::istream& contents);
 		bool          read                     (const char* filename);
 		bool          read                     (const std::string& filename);
@@ -2119,6 +3032,10 @@ class HumdrumFileBase : public HumHash {
 		std::vector<HTp> getKernLikeSpineStartList(void);
 		void          getStaffLikeSpineStartList(std::vector<HTp>& spinestarts);
 		std::vector<HTp> getStaffLikeSpineStartList(void);
+		HumSpineStartView getSpineStartView    (void);
+		HumSpineStartView getSpineStartView    (const std::string& exinterp);
+		HumSpineStartView getKernSpineStartView(void)
+		                                { return getSpineStartView("**kern"); }
 		int           getExinterpCount         (const std::string& exinterp);
 		void          getTrackStartList        (std::vector<HTp>& spinestarts)
 		                               { return getSpineStartList(spinestarts); }
@@ -2183,6 +3100,17 @@ class HumdrumFileBase : public HumHash {
 		void          getPrimarySpineSequence  (std::vector<HTp>& sequence,
 		                                        int spine, int options);
 
+		HumTrackView  getTrackView             (int track, int options = 0);
+		HumTrackView  getTrackView             (HTp starttoken, int options = 0)
+		                   { return getTrackView(starttoken->getTrack(), options); }
+		HumTrackView  getPrimaryTrackView      (int track, int options = 0)
+		                     { return getTrackView(track, options | OPT_PRIMARY); }
+		HumTrackView  getSpineView             (int spine, int options = 0)
+		                              { return getTrackView(spine+1, options); }
+		HumTrackView  getPrimarySpineView      (int spine, int options = 0)
+		                   { return getTrackView(spine+1, options | OPT_PRIMARY); }
+		void          invalidateTrackIndex     (void) { m_trackindexvalid = false; }
+
 		void          getTrackSeq              (std::vector<std::vector<HTp> >& sequence,
 		                                        HTp starttoken, int options)
 		                     { getTrackSequence(sequence, starttoken, options); }
@@ -2210,6 +3138,9 @@ class HumdrumFileBase : public HumHash {
 		bool          analyzeTracks             (void);
 		bool          analyzeLines              (void);
 
+		static std::string getMergedSpineInfo   (std::vector<std::string>& info,
+		                                         int starti, int extra);
+
 	protected:
 		static int    getChunk                  (int socket_id,
 		                                         std::stringstream& inputdata,
@@ -2228,12 +3159,11 @@ class HumdrumFileBase : public HumHash {
 		bool          adjustSpines              (HumdrumLine& line,
 		                                         std::vector<std::string>& datatype,
 		                                         std::vector<std::string>& sinfo);
-		std::string   getMergedSpineInfo        (std::vector<std::string>& info,
-		                                         int starti, int extra);
 		bool          stitchLinesTogether       (HumdrumLine& previous,
 		                                         HumdrumLine& next);
 		void          addToTrackStarts          (HTp token);
-		void          addUniqueTokens           (std::vector<HTp>& target,
+		void          buildTrackIndex           (void);
+		void          addUniqueTokens           (HumTokenLinks& target,
 		                                         std::vector<HTp>& source);
 		bool          processNonNullDataTokensForTrackForward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
@@ -2243,6 +3173,15 @@ class HumdrumFileBase : public HumHash {
 		bool          setParseError             (const std::string& err);
 		bool          setParseError             (const char* format, ...);
 //		void          fixMerges                 (int linei);
+		void          moveFrom                  (HumdrumFileBase& infile) noexcept;
+		static HTp    remapToken                (HTp token,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenList            (std::vector<HTp>& tokens,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenList            (HumTokenLinks& tokens,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
+		static void   remapTokenPairs           (std::vector<TokenPair>& pairs,
+		                                         const std::unordered_map<HTp, HTp>& tokenmap);
 
 	protected:
 
@@ -2269,6 +3208,14 @@ class HumdrumFileBase : public HumHash {
 		// dimension is the list of terminators.
 		std::vector<std::vector<HTp> > m_trackends;
 
+		// m_trackindex: tokens of each track in line order, used by
+		// HumTrackView.  The first element is reserved as in m_trackstarts.
+		std::vector<HumTrackIndex> m_trackindex;
+
+		// m_trackindexvalid: false when lines or tokens have been added
+		// or removed since m_trackindex was built.
+		bool m_trackindexvalid = false;
+
 		// m_barlines: list of barlines in the data.  If the first measures is
 		// a pickup measure, then the first entry will not point to the first
 		// starting exclusive interpretation line rather than to a barline.
@@ -2367,7 +3314,13 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		              HumdrumFileStructure         (void);
 		              HumdrumFileStructure         (const std::string& filename);
 		              HumdrumFileStructure         (std::istream& contents);
+		              HumdrumFileStructure         (HumdrumFileStructure& infile);
+		              HumdrumFileStructure         (HumdrumFileStructure&& infile) noexcept;
 		             ~HumdrumFileStructure         ();
+
+		HumdrumFileStructure& operator=            (HumdrumFileStructure& infile);
+		HumdrumFileStructure& operator=            (HumdrumFileStructure&& infile) noexcept;
+
 		bool          hasFilters                   (void);
 		bool          hasGlobalFilters             (void);
 		bool          hasUniversalFilters          (void);
@@ -2487,12 +3440,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            int line);
 		bool          decrementDurStates           (std::vector<HumNum>& durs,
 		                                            HumNum linedur, int line);
-		bool          assignDurationsToTrack       (HTp starttoken,
-		                                            HumNum startdur);
-		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		bool          assignDurationsFromStart     (void);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
-		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
@@ -2512,13 +3461,41 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 
 
+class HumMetricInfo {
+	public:
+		// m_top: Top number of the prevailing time signature (the default
+		// meter before any time signature is 1/4).
+		int m_top = 1;
+
+		// m_bottom: Bottom number of the prevailing time signature.
+		int m_bottom = 4;
+
+		// m_tick: Position of the line from the previous barline in ticks
+		// (see HumdrumFileContent::getMetricTpq()).
+		int m_tick = 0;
+
+		// m_measure: Measure ordinal of the line: the number of barlines
+		// at or before the line (0 for a pickup measure).
+		int m_measure = 0;
+
+		// m_level: Metric level of the line (see getMetricLevels()), or NAN
+		// for non-data lines.
+		double m_level = NAN;
+};
+
+
 class HumdrumFileContent : public HumdrumFileStructure {
 	public:
 		       HumdrumFileContent         (void);
 		       HumdrumFileContent         (const std::string& filename);
 		       HumdrumFileContent         (std::istream& contents);
+		       HumdrumFileContent         (HumdrumFileContent& infile);
+		       HumdrumFileContent         (HumdrumFileContent&& infile) noexcept;
 		      ~HumdrumFileContent         ();
 
+		HumdrumFileContent& operator=     (HumdrumFileContent& infile);
+		HumdrumFileContent& operator=     (HumdrumFileContent&& infile) noexcept;
+
 		bool   analyzeSlurs               (void);  // in src/HumdrumFileContents-slur.cpp
 		bool   analyzeBeams               (void);  // in src/HumdrumFileContents-beam.cpp
 		bool   analyzePhrasings           (void);
@@ -2551,6 +3528,9 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		// in HumdrumFileContent-metlev.cpp
 		void  getMetricLevels             (std::vector<double>& output, int track = 0,
 		                                   double undefined = NAN);
+		const HumMetricInfo& getMetricInfo(int line, int track = 0);
+		double getMetricLevel             (int line, int track = 0);
+		int   getMetricTpq                (void);
 		// in HumdrumFileContent-timesig.cpp
 		void  getTimeSigs                 (std::vector<std::pair<int, HumNum> >& output,
 		                                   int track = 0);
@@ -2665,6 +3645,19 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		void    getBaselines              (std::vector<std::vector<int>>& centerlines);
 		void    createLinkedTies          (std::vector<std::pair<HTp, int>>& starts,
 		                                   std::vector<std::pair<HTp, int>>& ends);
+
+		// Metric index:
+		int     getMetricTrack            (int track);
+		void    analyzeMetricIndex        (int track);
+		static bool getMeter              (HTp token, int& top, int& bot);
+
+	private:
+		// m_metricIndex: Metric information for each line of the file,
+		// indexed by track and then by line.  A track is analyzed the
+		// first time that it is queried, and the index is rebuilt after
+		// the file analyses are cleared (such as when reading a new file).
+		std::vector<std::vector<HumMetricInfo>> m_metricIndex;
+		int m_metricTpq = 0;
 };
 
 
@@ -3024,12 +4017,158 @@ class HumdrumFile : public HUMDRUMFILE_PARENT {
 		              HumdrumFile          (void);
 		              HumdrumFile          (const std::string& filename);
 		              HumdrumFile          (std::istream& filename);
+		              HumdrumFile          (HumdrumFile& infile);
+		              HumdrumFile          (HumdrumFile&& infile) noexcept;
 		             ~HumdrumFile          ();
 
+		HumdrumFile& operator=             (HumdrumFile& infile);
+		HumdrumFile& operator=             (HumdrumFile&& infile) noexcept;
+		HumdrumFile   clone                (void) const;
+
 		std::ostream& printXml             (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlParameterInfo(std::ostream& out, int level,
 		                                    const std::string& indent);
+		std::ostream& printJson            (std::ostream& out = std::cout,
+		                                    const std::string& fields = "",
+		                                    const std::string& indent = "\t");
+		void          printJson            (HumJsonWriter& json, int fields);
+};
+
+
+
+class HumdrumExpansionView {
+	public:
+		                    HumdrumExpansionView  (void);
+		                    HumdrumExpansionView  (HumdrumFile& infile,
+		                                           const std::string& variant = "");
+		                   ~HumdrumExpansionView  () {}
+
+		void                clear                 (void);
+		void                setKeepLists          (bool state) { m_keepQ = state; }
+		bool                analyze               (HumdrumFile& infile,
+		                                           const std::string& variant = "",
+		                                           const std::string& realization = "");
+
+		bool                isExpanded            (void) const { return m_expandedQ; }
+		HumdrumFile*        getFile               (void) const { return m_infile; }
+		int                 getLineCount          (void) const { return (int)m_lines.size(); }
+		HumdrumLine&        operator[]            (int index) const;
+		HumdrumLine&        getLine               (int index) const { return (*this)[index]; }
+		int                 getLineIndex          (int index) const { return m_lines[index]; }
+		HumNum              getDurationFromStart  (int index) const;
+		HumNum              getDuration           (int index) const;
+		HumNum              getScoreDuration      (void) const { return m_scoreDuration; }
+		int                 getSectionIndex       (int index) const;
+		bool                isHeader              (int index) const { return m_sections[index] == 0; }
+		bool                isFooter              (int index) const;
+
+		// Expansion list information:
+		int                 getSequenceCount      (void) const { return (int)m_sequence.size(); }
+		const std::string&  getSequenceLabel      (int index) const { return m_sequence[index]; }
+		bool                hasSequenceLabel      (int index) const { return m_sequenceLine[index] >= 0; }
+		int                 getSequenceStart      (int index) const { return m_sequenceStart[index]; }
+		int                 getSequenceEnd        (int index) const { return m_sequenceEnd[index]; }
+		int                 getFooterStart        (void) const { return m_footerStart; }
+
+		static void         getLabelSequence      (std::vector<std::string>& labelsequence,
+		                                           const std::string& astring);
+		static bool         isExpansionList       (HTp token);
+
+	protected:
+		int                 findLabelSequence     (HumdrumFile& infile,
+		                                           const std::string& variant);
+		void                addLines              (int startline, int endline,
+		                                           int section, bool filter);
+
+	private:
+		HumdrumFile*              m_infile = NULL;
+		bool                      m_keepQ = false;     // keep *>[...] lines
+		bool                      m_expandedQ = false; // label sequence found
+
+		// Expanded line order (one entry per line in the view):
+		std::vector<int>          m_lines;     // line index in original file
+		std::vector<int>          m_sections;  // index into m_shifts
+
+		// Time shift for each section: [0] = header, [1..n] = sequence
+		// entries, [n+1] = footer:
+		std::vector<HumNum>       m_shifts;
+		HumNum                    m_scoreDuration;
+
+		// Label sequence of the expansion list:
+		std::vector<std::string>  m_sequence;
+		std::vector<int>          m_sequenceLine;  // label line in file or -1
+		std::vector<int>          m_sequenceStart; // first index in view
+		std::vector<int>          m_sequenceEnd;   // one past last index in view
+		int                       m_footerStart = 0;
+};
+
+
+
+class HumWordIndex {
+	public:
+		                   HumWordIndex      (void);
+		                   HumWordIndex      (HumdrumFile& infile);
+
+		void               clear             (void);
+		bool               build             (HumdrumFile& infile);
+		int                getSize           (void) const { return (int)m_words.size(); }
+		int                getCount          (void) const { return getSize(); }
+		const std::string& getName           (void) const { return m_name; }
+		void               setName           (const std::string& name) { m_name = name; }
+		int                getLineCount      (void) const { return m_linecount; }
+
+		// Word information:
+		const std::string& getWord           (int index) const;
+		const std::string& getKey            (int index) const;
+		int                getTrack          (int index) const;
+		int                getLineIndex      (int index) const;
+		int                getFieldIndex     (int index) const;
+		HTp                getStartToken     (HumdrumFile& infile, int index) const;
+		HTp                getNextToken      (HumdrumFile& infile, int index) const;
+
+		// Lookups (results are word indexes in file order):
+		int                find              (std::vector<int>& matches,
+		                                      const std::string& query) const;
+		int                findExact         (std::vector<int>& matches,
+		                                      const std::string& word) const;
+		int                findPrefix        (std::vector<int>& matches,
+		                                      const std::string& prefix) const;
+		int                findWildcard      (std::vector<int>& matches,
+		                                      const std::string& pattern) const;
+
+		static std::string normalize         (const std::string& text,
+		                                      bool wildcardsQ = false);
+		static bool        wildcardMatch     (const char* pattern, const char* text);
+
+		// Serialization:
+		bool               writeIndex        (std::ostream& output) const;
+		bool               readIndex         (std::istream& input);
+
+	protected:
+		void               addSpine          (HTp starttoken);
+		void               sortKeys          (void);
+		void               getRange          (const std::string& prefix,
+		                                      int& first, int& last) const;
+
+	private:
+		class Word {
+			public:
+				int         m_line      = -1;
+				int         m_field     = -1;
+				int         m_nextline  = -1;  // start of next word in spine
+				int         m_nextfield = -1;
+				int         m_track     = 0;
+				std::string m_text;            // word as written (syllables joined)
+				std::string m_key;             // normalized word
+		};
+
+		std::string       m_name;
+		int               m_linecount = 0;
+		std::vector<Word> m_words;
+
+		// Word indexes sorted by normalized word (then by file order):
+		std::vector<int>  m_sorted;
 };
 
 
@@ -4015,7 +5154,6 @@ class NoteGrid {
 	private:
 		vector<vector<NoteCell*> > m_grid;
 		vector<HTp>                m_kernspines;
-		vector<double>             m_metriclevels;
 		HumdrumFile*               m_infile;
 };
 
@@ -4348,6 +5486,116 @@ std::ostream& operator<<(std::ostream& out, PixelColor apixel);
 
 
 
+class PixelImage {
+	public:
+		                PixelImage      (void);
+		                PixelImage      (int width, int height);
+
+		void            clear           (void);
+		void            setSize         (int width, int height);
+		int             getWidth        (void) const { return m_width; }
+		int             getHeight       (void) const;
+
+		// Access to the stored rows (each of which can be repeated in the
+		// image):
+		int             getRowCount     (void) const { return (int)m_repeats.size(); }
+		int             getRowRepeat    (int row) const { return m_repeats.at(row); }
+		void            setRowRepeat    (int row, int count);
+		unsigned char*  getRowData      (int row);
+		PixelColor      getPixel        (int row, int column) const;
+		void            setPixel        (int row, int column, const PixelColor& color);
+
+		int             addRow          (const std::vector<PixelColor>& pixels,
+		                                 int hrepeat = 1, int vrepeat = 1,
+		                                 int shift = 0);
+
+		void            writePpm6       (std::ostream& out) const;
+		void            writePpm3       (std::ostream& out) const;
+		void            writePng        (std::ostream& out) const;
+		bool            write           (std::ostream& out,
+		                                 const std::string& format) const;
+
+	private:
+		int                        m_width = 0;
+		std::vector<unsigned char> m_pixels;   // RGB bytes of stored rows
+		std::vector<int>           m_repeats;  // repeat count of stored rows
+};
+
+
+
+class CorrelationScape {
+	public:
+		              CorrelationScape  (void);
+		              CorrelationScape  (const std::vector<double>& x,
+		                                 const std::vector<double>& y);
+
+		void          clear             (void);
+		void          setSequences      (const std::vector<double>& x,
+		                                 const std::vector<double>& y);
+		void          setSequence       (const std::vector<double>& x);
+		void          setCombCycle      (int cycle);
+		int           getSize           (void) const { return m_size; }
+		int           getCombCycle      (void) const { return m_cycle; }
+
+		// The correlation functions return NAN if either window has no
+		// variation (the 0/0 case of Convert::pearsonCorrelation).
+		double        getCorrelation    (int start, int length) const;
+		double        getCorrelation    (int start, const std::vector<double>& pattern) const;
+		double        getCombCorrelation(int start, int length) const;
+
+		// Fill a row of the scape: row[i] is the correlation of the window
+		// starting at i.  Returns false if the windows do not fit into the
+		// sequences.  Rows can be calculated in separate threads once the
+		// sequences (and comb cycle) have been set.
+		bool          getRow            (std::vector<double>& row, int length) const;
+		bool          getRow            (std::vector<double>& row,
+		                                 const std::vector<double>& pattern) const;
+		bool          getCombRow        (std::vector<double>& row, int length) const;
+
+	protected:
+		static void   prepareSums       (std::vector<double>& sum,
+		                                 std::vector<double>& sumsq,
+		                                 std::vector<double>& centered,
+		                                 const std::vector<double>& input);
+		static void   preparePattern    (std::vector<double>& centered,
+		                                 double& variance, double& tolerance,
+		                                 const std::vector<double>& pattern);
+		void          prepareComb       (double& sum, double& variance,
+		                                 double& tolerance, int length) const;
+		double        getVariance       (const std::vector<double>& sum,
+		                                 const std::vector<double>& sumsq,
+		                                 int start, int length,
+		                                 double& tolerance) const;
+		double        getPatternCorrelation(int start,
+		                                 const std::vector<double>& pattern,
+		                                 double variance, double tolerance) const;
+		double        getCombCorrelation(int start, int length, double patternsum,
+		                                 double variance, double tolerance) const;
+		static double correlate         (double covariance,
+		                                 double xvariance, double xtolerance,
+		                                 double yvariance, double ytolerance);
+
+	private:
+		int                 m_size  = 0;
+		int                 m_cycle = 0;
+
+		// Input sequences minus their means, and their running sums
+		// (m_sumx[i] is the sum of the first i values):
+		std::vector<double> m_x;
+		std::vector<double> m_sumx;
+		std::vector<double> m_sumxx;
+		std::vector<double> m_y;
+		std::vector<double> m_sumy;
+		std::vector<double> m_sumyy;
+		std::vector<double> m_sumxy;
+
+		// Running sums of every m_cycle-th value of m_x for comb patterns
+		// (m_combsum[i] = m_x[i] + m_combsum[i-m_cycle]):
+		std::vector<double> m_combsum;
+};
+
+
+
 // SliceType is a list of various Humdrum line types.  Groupings are
 // segmented by categories which are prefixed with an underscore.
 // For example Notes are in the _Duration group, since they have
@@ -4476,6 +5724,7 @@ class MxmlPart {
 		string               m_partabbr;
 		string               m_caesura;
 		bool                 m_hasOrnaments = false;
+		int                  m_eventcount = 0;  // for MxmlEvent sequence numbers
 
 		// m_staffvoicehist: counts of staff and voice numbers.
 		// staff=0 is used for items such as measures.
@@ -5023,6 +6272,7 @@ class MxmlEvent {
 		void               reportFiguredBassToOwner   (void);
 		void               reportCaesuraToOwner       (const std::string& letter = "Z") const;
 		void               reportOrnamentToOwner      (void) const;
+		int                getNextSequenceNumber      (void);
       void               makeDummyRest      (MxmlMeasure* owner,
 		                                       HumNum startime,
 		                                       HumNum duration,
@@ -5056,8 +6306,7 @@ class MxmlEvent {
 		MxmlMeasure*       m_owner;        // measure that contains this event
 		std::vector<MxmlEvent*> m_links;   // list of secondary chord notes
 		bool               m_linked;       // true if a secondary chord note
-		int                m_sequence;     // ordering of event in XML file
-		static int         m_counter;      // counter for sequence variable
+		int                m_sequence;     // ordering of event in XML part
 		short              m_staff;        // staff number in part for event
 		short              m_voice;        // voice number in part for event
 		int                m_voiceindex;   // voice index of item (remapping)
@@ -5195,6 +6444,9 @@ class MxmlMeasure {
 
 
 
+// Option_register: an option definition with its value.  The Options class
+// now stores definitions in an OptionSchema and values in OptionValue.
+
 class Option_register {
 	public:
 		                 Option_register (void);
@@ -5233,6 +6485,57 @@ class Option_register {
 };
 
 
+// OptionSchema: an immutable list of parsed option definitions.  Schemas
+// are shared between all Options objects which define the same options
+// in the same order (such as all instances of a tool class): each schema
+// keeps the schemas made by adding one more definition to it, so a
+// definition string is only parsed the first time it is added.  At most
+// OPTION_MAX_SCHEMAS schemas are kept (in case options are defined from
+// data rather than with fixed strings); later schemas are not shared.
+
+class OptionSchema {
+	public:
+		class Entry {
+			public:
+				std::string m_definition;
+				std::string m_description;
+				std::string m_default;
+				char        m_type = 's';
+		};
+
+		int          getSize       (void) const { return (int)m_entries.size(); }
+		const Entry& getEntry      (int index) const { return *m_entries[index]; }
+		int          getIndex      (const std::string& name) const;
+		const std::unordered_map<std::string, int>& getNames(void) const
+		                                            { return m_names; }
+		std::shared_ptr<const OptionSchema> extend(const std::string& definition,
+		                                    const std::string& description,
+		                                    std::string& error) const;
+		static std::shared_ptr<const OptionSchema> getEmpty(void);
+
+	private:
+		std::vector<std::shared_ptr<const Entry>> m_entries;
+
+		// m_names: index of the entry for each option name and alias.
+		std::unordered_map<std::string, int> m_names;
+
+		// m_extensions: schemas made from this one by extend(), indexed
+		// by the added definition.
+		mutable std::unordered_multimap<std::string,
+				std::shared_ptr<const OptionSchema>> m_extensions;
+		mutable std::mutex m_mutex;
+};
+
+
+// OptionValue: the command-line value of an option.
+
+class OptionValue {
+	public:
+		std::string m_value;
+		bool        m_modifiedQ = false;
+};
+
+
 class Options {
 	public:
 		                Options           (void);
@@ -5309,16 +6612,18 @@ class Options {
 		// are not options, or the command (argv[0]);
 		std::vector<std::string> m_arguments;
 
-		// m_optionRegister: store for the states/values of each option.
-		std::vector<Option_register*> m_optionRegister;
+		// m_schema: the option definitions, shared with other Options
+		// objects which have the same definitions.
+		std::shared_ptr<const OptionSchema> m_schema = OptionSchema::getEmpty();
+
+		// m_values: command-line values of the options, indexed in the
+		// same way as the definitions in m_schema.
+		std::vector<OptionValue> m_values;
 
 		// m_optionFlag: the character which indicates an option.
 		// Generally a dash, but could be made a slash for Windows environments.
 		char m_optionFlag = '-';
 
-		// m_optionList:
-		std::map<std::string, int> m_optionList;
-
 		//
 		// boolern options for object:
 		//
@@ -5339,10 +6644,12 @@ class Options {
 		bool m_optionsArgQ = false;
 
 		// m_error: used to store errors in parsing command-line options.
-		std::stringstream m_error;
+		// It is allocated by getErrorStream() when the first error occurs.
+		std::unique_ptr<std::stringstream> m_error;
 
 	protected:
 		int     getRegIndex    (const std::string& optionName);
+		std::stringstream& getErrorStream(void);
 		bool    isOption       (const std::string& aString, int& argp);
 		int     storeOption    (int gargp, int& position, int& running);
 
@@ -5356,6 +6663,9 @@ class Options {
 #define OPTION_STRING_TYPE    's'
 #define OPTION_UNKNOWN_TYPE   'x'
 
+// Maximum number of option schemas which are kept for sharing:
+#define OPTION_MAX_SCHEMAS    10000
+
 
 
 class HumTool : public Options {
@@ -5523,6 +6833,39 @@ int main(int argc, char** argv) {                                          \
 
 
 
+//////////////////////////////
+//
+// LINE_STREAM_INTERFACE -- Use HumdrumLineStream to send the input one
+//    line at a time to the filter, which prints its results directly
+//    (constant-memory implementation for line-based filters).
+//
+
+#define LINE_STREAM_INTERFACE(CLASS)                                       \
+int main(int argc, char** argv) {                                          \
+	hum::CLASS interface;                                                   \
+	if (!interface.process(argc, argv)) {                                   \
+		interface.getError(std::cerr);                                       \
+		return -1;                                                           \
+	}                                                                       \
+	hum::HumdrumLineStream instream(static_cast<hum::Options&>(interface)); \
+	bool status = interface.run(instream, std::cout);                       \
+	interface.finally();                                                    \
+	if (interface.hasWarning()) {                                           \
+		interface.getWarning(std::cerr);                                     \
+	}                                                                       \
+	if (interface.hasAnyText()) {                                           \
+	   interface.getAllText(std::cout);                                     \
+	}                                                                       \
+	if (interface.hasError()) {                                             \
+		interface.getError(std::cerr);                                       \
+        return -1;                                                         \
+	}                                                                       \
+	interface.clearOutput();                                                \
+	return !status;                                                         \
+}
+
+
+
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
@@ -5585,6 +6928,18 @@ class HumdrumFileStream {
 		int             read               (HumdrumFileSet& infiles);
 		int             readSingleSegment  (HumdrumFileSet& infiles);
 
+		// Random access to segments with a HumSegmentIndex:
+		bool            loadSegmentIndex   (const std::string& filename,
+		                                    bool referencesQ = false);
+		const HumSegmentIndex& getSegmentIndex(void) const { return m_segmentindex; }
+		int             readSegment        (HumdrumFile& infile, int index);
+		int             readSegment        (HumdrumFile& infile,
+		                                    const std::string& name);
+		static int      readSegment        (HumdrumFile& infile,
+		                                    std::istream& input,
+		                                    const HumSegmentIndex& segmentindex,
+		                                    int index);
+
 	protected:
 		std::stringstream m_stringbuffer;   // used to read files from a string
 		std::ifstream     m_instream;       // used to read from list of files
@@ -5597,6 +6952,9 @@ class HumdrumFileStream {
 
 		std::vector<std::string>  m_universals;     // storage for universal comments
 
+		HumSegmentIndex   m_segmentindex;   // used by readSegment()
+		std::ifstream     m_segmentstream;  // data file for m_segmentindex
+
 		// Automatic URL downloading of data from internet in read():
 		void     fillUrlBuffer            (std::stringstream& uribuffer,
 		                                   const std::string& uriname);
@@ -5605,6 +6963,115 @@ class HumdrumFileStream {
 
 
 
+class HumdrumLineStream {
+	public:
+		                    HumdrumLineStream   (void);
+		                    HumdrumLineStream   (const std::vector<std::string>& list);
+		                    HumdrumLineStream   (Options& options);
+
+		int                 setFileList         (const std::vector<std::string>& list);
+		void                loadString          (const std::string& data);
+
+		bool                readLine            (void);
+		bool                analyzeLine         (const std::string& line);
+		void                reset               (void);
+
+		// Information about the current input segment:
+		bool                isSegmentStart      (void) const { return m_segmentStart; }
+		int                 getSegmentIndex     (void) const { return m_segment; }
+		const std::string&  getFilename         (void) const { return m_filename; }
+		int                 getLineIndex        (void) const { return m_lineindex; }
+		int                 getMaxTrack         (void) const { return m_maxtrack; }
+		bool                isValid             (void) const { return m_parseError.empty(); }
+		const std::string&  getParseError       (void) const { return m_parseError; }
+
+		// Information about the current line:
+		const std::string&  getLine             (void) const { return m_line; }
+		int                 getFieldCount       (void) const { return (int)m_tokens.size(); }
+		int                 getTokenCount       (void) const { return (int)m_tokens.size(); }
+		const std::string&  getToken            (int index) const { return m_tokens[index]; }
+		const std::vector<std::string>& getTokens (void) const { return m_tokens; }
+		int                 getTrack            (int index) const;
+		int                 getSubtrack         (int index) const;
+		const std::string&  getSpineInfo        (int index) const;
+		const std::string&  getDataType         (int index) const;
+		const std::vector<int>& getTracks       (void) const { return m_linetracks; }
+
+		bool                isEmpty             (void) const { return m_line.empty(); }
+		bool                isComment           (void) const { return equalChar(0, '!'); }
+		bool                isGlobalComment     (void) const { return equalChar(0, '!') && equalChar(1, '!'); }
+		bool                isLocalComment      (void) const { return equalChar(0, '!') && !equalChar(1, '!'); }
+		bool                isReference         (void) const;
+		bool                isInterpretation    (void) const { return equalChar(0, '*'); }
+		bool                isExclusive         (void) const { return equalChar(0, '*') && equalChar(1, '*'); }
+		bool                isBarline           (void) const { return equalChar(0, '='); }
+		bool                isData              (void) const;
+		bool                hasSpines           (void) const { return !(isEmpty() || isGlobalComment()); }
+		bool                isManipulator       (void) const { return m_manipulator; }
+		bool                isAllNull           (void) const;
+		bool                equalFieldsQ        (const std::string& exinterp,
+		                                         const std::string& value) const;
+
+		static bool         isManipulator       (const std::string& token);
+
+	protected:
+		bool                getRawLine          (std::string& line);
+		bool                openNextInput       (void);
+		void                startSegment        (void);
+		void                tokenizeLine        (void);
+		void                analyzeSpines       (void);
+		bool                adjustSpines        (void);
+		void                analyzeTracks       (void);
+		bool                setParseError       (const std::string& err);
+		bool                equalChar           (int index, char ch) const {
+		                       return ((int)m_line.size() > index) && (m_line[index] == ch);
+		                    }
+		static int          getTrackFromSpineInfo(const std::string& info);
+
+	private:
+		// input sources:
+		std::stringstream         m_stringbuffer; // used to read from a string
+		std::ifstream             m_instream;     // used to read from list of files
+		std::istream*             m_input = NULL; // current input stream
+		std::vector<std::string>  m_filelist;     // used when not using cin
+		int                       m_curfile = -1; // index into filelist
+		bool                      m_stringQ = false; // reading from m_stringbuffer
+
+		// segment splitting (same rules as HumdrumFileStream):
+		std::vector<std::string>  m_universals;   // universal comments of segment
+		std::vector<std::string>  m_output;       // lines waiting to be analyzed
+		std::string               m_filename;     // filename of current segment
+		int                       m_segment = -1; // index of current segment
+		bool                      m_segmentStart = false; // first line of segment
+		bool                      m_dataFound = false;
+		bool                      m_starstarFound = false;
+		bool                      m_starminusFound = false;
+		bool                      m_newUniversals = false;
+		bool                      m_segmentPending = true;
+
+		// spine tracking:
+		std::vector<std::string>  m_datatype;     // exclusive interp. of each spine
+		std::vector<std::string>  m_sinfo;        // spine info of each spine
+		std::vector<int>          m_strack;       // track of each spine
+		bool                      m_init = false; // first ** line was found
+		bool                      m_manipulator = false;
+		bool                      m_exclusiveStart = false; // line defines spines
+		bool                      m_addOpen = false; // *+ waiting for **
+		int                       m_maxtrack = 0;
+		int                       m_lineindex = -1;
+		std::string               m_parseError;
+
+		// current line:
+		std::string               m_line;
+		std::vector<std::string>  m_tokens;
+		std::vector<int>          m_linetracks;
+		std::vector<int>          m_linesubtracks;
+		std::vector<int>          m_subtrackcount;
+		std::vector<int>          m_subtrackindex;
+};
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 class HumdrumFileSet {
@@ -5639,6 +7106,18 @@ class HumdrumFileSet {
       int                   readAppend       (Options& options);
       int                   readAppend       (HumdrumFileStream& instream);
       int                   readAppendHumdrum(HumdrumFile& infile);
+
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              int threads = 1);
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              const std::vector<int>& segments,
+                                              int threads = 1);
+      int                   readSegments     (const HumSegmentIndex& index,
+                                              const std::vector<std::string>& names,
+                                              int threads = 1);
+      int                   readAppendSegments(const HumSegmentIndex& index,
+                                              const std::vector<int>& segments,
+                                              int threads = 1);
 		int                   appendHumdrumPointer(HumdrumFile* infile);
 
    protected:
@@ -5650,6 +7129,163 @@ class HumdrumFileSet {
 
 
 
+class PitchClassHistogram {
+	public:
+		                     PitchClassHistogram (void);
+
+		void                 clear               (void);
+		bool                 addBase40           (int base40, double weight = 1.0);
+		bool                 addKern             (const std::string& kern, double weight = 1.0);
+		double               getBase7            (int pc) const { return m_base7[pc];  }
+		double               getBase12           (int pc) const { return m_base12[pc]; }
+		double               getBase40           (int pc) const { return m_base40[pc]; }
+		std::vector<double>  getBase7Vector      (void) const;
+		std::vector<double>  getBase12Vector     (void) const;
+		std::vector<double>  getBase40Vector     (void) const;
+		double               getTotal            (void) const;
+		double               getMaximum          (void) const;
+		bool                 isEmpty             (void) const;
+		PitchClassHistogram& operator+=          (const PitchClassHistogram& other);
+
+	protected:
+		double m_base7[7];
+		double m_base12[12];
+		double m_base40[40];
+};
+
+
+
+class PitchHistogram {
+	public:
+		// Absolute pitches are stored from octave -3 to octave 8 (middle C
+		// is in octave 4):
+		static const int MINOCTAVE = -3;
+		static const int OCTAVES   = 12;
+
+		                     PitchHistogram      (void);
+
+		void                 clear               (void);
+		bool                 addBase40           (int base40, double weight = 1.0);
+		bool                 addKern             (const std::string& kern, double weight = 1.0);
+		double               getBase40           (int base40) const;
+		double               getBase7            (int base7) const;
+		double               getDiatonic         (int base7, int acc) const;
+		double               getMidi             (int key) const;
+		int                  getLowestBase40     (void) const;
+		int                  getHighestBase40    (void) const;
+		const PitchClassHistogram& getPitchClasses (void) const { return m_pitchClasses; }
+		PitchHistogram&      operator+=          (const PitchHistogram& other);
+
+	protected:
+		PitchClassHistogram m_pitchClasses;
+		double              m_base40[OCTAVES * 40];
+		double              m_base7[OCTAVES * 7];
+		double              m_midi[128];
+};
+
+
+
+class PitchProfile {
+	public:
+		                     PitchProfile        (void);
+
+		void                 clear               (void);
+		void                 setAttacks          (bool state) { m_attacks = state; }
+		void                 analyze             (HumdrumFile& infile);
+		int                  analyze             (HumdrumFileSet& infiles, int threads = 1);
+		int                  analyze             (HumdrumFileStream& instream, int threads = 1);
+		PitchProfile&        operator+=          (const PitchProfile& other);
+
+		int                  getFileCount        (void) const { return m_files; }
+		const PitchHistogram& getRange           (void) const { return m_range; }
+		const PitchClassHistogram& getPitchClasses (void) const { return m_range.getPitchClasses(); }
+		int                  getMeasureCount     (void) const { return (int)m_measures.size(); }
+		const PitchClassHistogram& getMeasure    (int index) const { return m_measures.at(index); }
+		const std::string&   getMeasureLabel     (int index) const { return m_labels.at(index); }
+
+	protected:
+		bool                             m_attacks = false; // count attacks rather than durations
+		int                              m_files   = 0;     // number of files analyzed
+		PitchHistogram                   m_range;           // total for all files
+		std::vector<PitchClassHistogram> m_measures;        // one entry for each measure
+		std::vector<std::string>         m_labels;          // filename:measure for each measure
+};
+
+
+
+class KeyEstimator {
+	public:
+		                    KeyEstimator          (void);
+
+		void                clear                 (void);
+		bool                setProfile            (const std::string& name);
+		const std::string&  getProfile            (void) const { return m_profile; }
+		void                setWindow             (HumNum duration) { m_window = duration; }
+		void                setMinimumDuration    (HumNum duration) { m_minimum = duration; }
+		void                analyze               (HumdrumFile& infile);
+
+		// Key of the whole score:
+		int                 getGlobalKey          (void) const { return m_globalKey; }
+		double              getGlobalCorrelation  (void) const { return m_globalCorrelation; }
+		const std::string&  getGlobalKeyName      (void) const { return m_globalName; }
+		std::string         getGlobalKeyDesignation(void) const;
+
+		// Local key at each line of the score (the correlation is for the
+		// best key in the window before smoothing):
+		int                 getKey                (int line) const { return m_keys.at(line); }
+		double              getCorrelation        (int line) const { return m_correlations.at(line); }
+		const std::string&  getKeyName            (int line) const { return m_names.at(line); }
+		std::string         getKeyDesignation     (int line) const;
+		void                getKeyChanges         (std::vector<int>& lines) const;
+
+		// Key numbers are 0-11 for major keys and 12-23 for minor keys
+		// (C=0, C#/D-=1, ... B=11), or -1 if unknown:
+		static bool         isMinor               (int key) { return key >= 12; }
+		static int          getTonic              (int key) { return key < 0 ? -1 : key % 12; }
+
+		void                correlate             (double* correlations,
+		                                           const PitchClassHistogram& histogram) const;
+		int                 getBestKey            (const PitchClassHistogram& histogram,
+		                                           double& correlation) const;
+		static std::string  spellKey              (int key, const PitchClassHistogram& histogram);
+
+	protected:
+		void                prepareWeights        (const double* major, const double* minor);
+		void                getSliceNotes         (HumdrumFile& infile);
+		void                smoothKeys            (std::vector<int>& keys);
+		static std::string  makeDesignation       (const std::string& name);
+
+	private:
+		std::string           m_profile;
+		HumNum                m_window  = 16;  // duration of window in quarter notes
+		HumNum                m_minimum = -1;  // shortest local key region (-1 = window/2)
+
+		// m_weights: key profiles rotated to all 24 keys, centered on
+		// zero and scaled to unit length, so that the Pearson correlation
+		// with a histogram is one dot product per key.
+		double                m_weights[24][12];
+
+		// Sounding notes in each data line (slice): m_noteStart[i] is the
+		// first entry in m_notes for slice i, and each note is weighted by
+		// the duration of the slice.
+		std::vector<int>      m_slices;      // line index of each slice
+		std::vector<HumNum>   m_times;       // start time of each slice
+		std::vector<double>   m_durations;   // duration of each slice
+		std::vector<int>      m_noteStart;
+		std::vector<int>      m_notes;       // base-40 pitches
+		HumNum                m_scoreDuration;
+
+		// Results:
+		int                      m_globalKey = -1;
+		double                   m_globalCorrelation = 0.0;
+		std::string              m_globalName;
+		std::vector<int>         m_keys;
+		std::vector<double>      m_correlations;
+		std::vector<std::string> m_names;
+};
+
+
+
 class Tool_1520ify : public HumTool {
 	public:
 		            Tool_1520ify       (void);
@@ -5728,14 +7364,26 @@ class Tool_addkey : public HumTool {
 		void    initialize         (void);
 		void    getLineIndexes     (HumdrumFile& infile);
 		void    insertReferenceKey (HumdrumFile& infile);
+		void    insertEstimatedKey (HumdrumFile& infile);
+		void    insertKey          (HumdrumFile& infile, const std::string& desig);
 		void    addInputKey        (HumdrumFile& infile);
 		void    insertKeyDesig     (HumdrumFile& infile, const std::string& keyDesig);
 		void    printKeyDesig      (HumdrumFile& infile, int index, const std::string& desig, int direction);
+		void    printKeyLine       (HumdrumFile& infile, int index, const std::string& desig);
+		void    printLine          (HumdrumFile& infile, int index);
 
 	private:
 		std::string m_key;
 		bool        m_keyQ           = false;
 		bool        m_addKeyRefQ     = false;
+		bool        m_estimateQ      = false;
+		bool        m_localQ         = false;
+		double      m_window         = 16.0;
+
+		// m_localKeys: estimated key designation to print before each line
+		// where the local key changes (used with -l option).
+		KeyEstimator             m_estimator;
+		std::vector<std::string> m_localKeys;
 
 		int         m_exinterpIndex  = -1;
 		int         m_refKeyIndex    = -1;
@@ -6511,7 +8159,8 @@ class cmr_note_info {
 		std::string   getPitch         (void);
 		HTp      getToken         (void);
 		int      getLineIndex     (void);
-		double   getNoteStrength  (void);
+		double   getNoteStrength  (double syncopationWeight = 1.0,
+		                           double leapWeight = 0.5);
 		bool     hasSyncopation   (void);
 		bool     hasLeapBefore    (void);
 		void     markNote         (const std::string& marker);
@@ -6521,9 +8170,6 @@ class cmr_note_info {
 		static bool   isSyncopated(HTp token);
 		static bool   isLeapBefore(HTp token);
 
-		static double m_syncopationWeight;
-		static double m_leapWeight;
-
 	private:
 		std::vector<HTp> m_tokens;    // List of tokens for the notes (first entry is note attack);
 
@@ -6577,7 +8223,8 @@ class cmr_group_info {
 		HumNum  getEndTime         (void);
 		HumNum  getGroupDuration   (void);
 		HumNum  getStartTime       (void);
-		double  getGroupStrength   (void);
+		double  getGroupStrength   (double syncopationWeight = 1.0,
+		                            double leapWeight = 0.5);
 		bool    mergeGroup         (cmr_group_info& group);
 		std::ostream& printNotes   (std::ostream& output = std::cout, const std::string& marker = "");
 
@@ -6588,6 +8235,30 @@ class cmr_group_info {
 };
 
 
+//////////////////////////////
+//
+// cmr_range_max -- Sparse table for constant-time maximum queries over
+//     an index range of a fixed integer sequence (such as the MIDI note
+//     numbers of a part).
+//
+
+class cmr_range_max {
+	public:
+		        cmr_range_max      (void) {};
+		void    clear              (void);
+		void    build              (const std::vector<int>& values);
+		int     getMaximum         (int index1, int index2) const;
+		int     findFirstAbove     (int index1, int index2, int threshold) const;
+		int     findLastAbove      (int index1, int index2, int threshold) const;
+
+	private:
+		// m_table[k][i] == maximum of values i through i+2^k-1.
+		std::vector<std::vector<int>> m_table;
+		// m_log2[n] == floor(log2(n)) for range lengths.
+		std::vector<int> m_log2;
+};
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 class Tool_cmr : public HumTool {
@@ -6599,6 +8270,7 @@ class Tool_cmr : public HumTool {
 		bool             run                     (HumdrumFile& infile);
 		bool             run                     (const std::string& indata, std::ostream& out);
 		bool             run                     (HumdrumFile& infile, std::ostream& out);
+		bool             run                     (HumdrumFileStream& instream);
 		void             finally                 (void);
 
 	protected:
@@ -6651,9 +8323,11 @@ class Tool_cmr : public HumTool {
 		void             getPartNames            (std::vector<std::string>& partNames, HumdrumFile& infile);
 		void             checkForCmr             (int index, int direction, HumdrumFile& infile);
 		bool             hasHigher               (int pitch, int tolerance,
-		                                          std::vector<int>& midinums,
-		                                          std::vector<std::vector<HTp>>& notelist,
 		                                          int index1, int index2);
+		void             prepareRangeQueries     (HumdrumFile& infile);
+		bool             isCorpusMode            (void);
+		void             processCorpus           (HumdrumFileSet& infiles);
+		void             mergeCorpusResults      (Tool_cmr& worker);
 		bool             hasGroupUp              (void);
 		bool             hasGroupDown            (void);
 		void             getVocalRange           (std::vector<std::string>& minpitch,
@@ -6683,9 +8357,12 @@ class Tool_cmr : public HumTool {
 		bool        m_notelistQ   = false;       // used with --notelist option
 		bool        m_debugQ      = false;       // used with --debug option
 		bool        m_numberQ     = false;       // used with -N option
+		int         m_threads     = 1;           // used with -j option: threads for corpus statistics
 		double      m_smallRest   = 4.0;         // Ignore rests that are 1 whole note or less
 		double      m_cmrDur      = 24.0;        // 6 whole notes maximum between m_cmrNum local maximums
 		double      m_cmrNum      = 3;           // number of local maximums in a row needed to mark in score
+		double      m_syncopationWeight = 1.0;   // strength added for syncopated notes
+		double      m_leapWeight  = 0.5;         // strength added for notes after a leap
 		int         m_noteCount   = 0;           // total number of notes in the score
 		int         m_local_count = 0;           // used for coloring local peaks
 		std::string m_colorUp     = "red";       // color to mark peak cmr notes
@@ -6738,6 +8415,16 @@ class Tool_cmr : public HumTool {
 		std::vector<bool>        m_syncopation;   // True if note is syncopated.
 		std::vector<bool>        m_leapbefore;    // True if note has a leap before it.
 
+		// range-query data for CMR window checks (reset for each part)
+		std::vector<int64_t>     m_onsets;        // note onset times in ticks (file tpq)
+		int64_t                  m_cmrTicks = 0;  // m_cmrDur in ticks
+		std::vector<bool>        m_strongBeat;    // True if note is on a strong beat.
+		std::vector<bool>        m_accented;      // True if note can be a CMR note other than the trigger.
+		std::vector<int>         m_nextSame;      // index of next note with same pitch (-1 if none)
+		std::vector<int>         m_prevSame;      // index of previous note with same pitch (-1 if none)
+		cmr_range_max            m_pitchMax;      // maximum pitch in a range of notes
+		cmr_range_max            m_strongMax;     // maximum pitch of strong-beat notes in a range
+
 		// Summary statistics variables:
 		std::vector<int>         m_cmrCount;       // number of CMRs in each input file
 		std::vector<int>         m_cmrNoteCount;   // number of CMR notes in each input file
@@ -6793,6 +8480,36 @@ class Tool_colortriads : public HumTool {
 };
 
 
+class OnsetBitmap {
+	public:
+		            OnsetBitmap          (void) {};
+		            OnsetBitmap          (int size) { resize(size); }
+		           ~OnsetBitmap          () {};
+
+		void        resize               (int size);
+		int         getSize              (void) const { return m_size; }
+		void        clear                (void);
+		void        set                  (int index);
+		void        unset                (int index);
+		bool        test                 (int index) const;
+		int         count                (void) const;
+		int         next                 (int index) const;
+		int         first                (void) const { return next(0); }
+		void        clearBefore          (int index);
+
+		OnsetBitmap& operator|=          (const OnsetBitmap& other);
+		OnsetBitmap& operator&=          (const OnsetBitmap& other);
+		OnsetBitmap& andNot              (const OnsetBitmap& other);
+		OnsetBitmap& invert              (void);
+		OnsetBitmap& shiftUp             (void);
+
+	private:
+		std::vector<uint64_t> m_words;
+		int                   m_size = 0;
+};
+
+
+
 class Tool_composite : public HumTool {
 	public:
 		            Tool_composite       (void);
@@ -6819,8 +8536,6 @@ class Tool_composite : public HumTool {
 		void        extractGroup              (HumdrumFile& infile, const std::string &target);
 		void        getNumericGroupStates     (std::vector<int>& states, HumdrumFile& infile, const std::string& tgroup);
 		int         getGroupNoteType          (HumdrumFile& infile, int line, const std::string& group);
-		HumNum      getLineDuration           (HumdrumFile& infile, int index,
-		                                       std::vector<int>& isNull);
 		void        backfillGroup             (std::vector<std::vector<std::string>>& curgroup,
 		                                       HumdrumFile& infile, int line, int track,
 		                                       int subtrack, const std::string& group);
@@ -6838,6 +8553,10 @@ class Tool_composite : public HumTool {
 		void        getGroupDurations         (std::vector<HumNum>& groupdurs,
 		                                       std::vector<int>& groupstates,
 		                                       HumdrumFile& infile);
+		void        buildOnsetBitmaps         (HumdrumFile& infile);
+		void        getStateBitmap            (OnsetBitmap& bitmap, std::vector<int>& states,
+		                                       int minstate, int maxstate);
+		HumNum      getSliceDuration          (int startslice, int endslice);
 		void        printGroupAssignments     (HumdrumFile& infile);
 		void        getGroupRhythms           (std::vector<std::vector<std::string>>& rhythms,
 		                                       std::vector<std::vector<HumNum>>& groupdurs,
@@ -6862,7 +8581,6 @@ class Tool_composite : public HumTool {
 		HTp         fixBadRestRhythm          (HTp token, std::string& rhythm, HumNum tstop, HumNum tsbot);
 		std::string generateSizeLine          (HumdrumFile& output, HumdrumFile& input, int line);
 		void        convertNotesToRhythms     (HumdrumFile& infile);
-		int         getEventCount             (std::vector<std::string>& data);
 		void        fixTiedNotes              (std::vector<std::string>& data, HumdrumFile& infile);
 		void        doOnsetAnalysisCoincidence(std::vector<double>& output,
 		                                       std::vector<double>& inputA, std::vector<double>& inputB);
@@ -6916,6 +8634,23 @@ class Tool_composite : public HumTool {
 		std::vector<std::string> m_coincidence;
 		std::vector<std::vector<std::string>> m_groups;  // Groups A and B
 
+		// Onset bitmaps: one bit for each data line (slice) in the input file.
+		// Slice times are stored as integer ticks (file tpq) so that
+		// durations are only converted to HumNum when rendering rhythms.
+		std::vector<int>         m_sliceLine;      // line index of each slice
+		std::vector<int>         m_lineSlice;      // slice index of each line (-1 = none)
+		std::vector<int64_t>     m_sliceTick;      // start time of each slice in ticks
+		std::vector<int64_t>     m_lineTick;       // start time of each line in ticks
+		int64_t                  m_endTick = 0;    // start time of last line in ticks
+		int                      m_tpq     = 1;    // ticks per quarter note
+		OnsetBitmap              m_nonNullSlices;  // slices with a non-null token
+		OnsetBitmap              m_graceSlices;    // slices with zero duration
+		std::vector<OnsetBitmap> m_voiceNotes;     // notes sounding per **kern track
+		std::vector<OnsetBitmap> m_voiceAttacks;   // note attacks per **kern track
+		OnsetBitmap              m_fullCompositeEvents;
+		OnsetBitmap              m_coincidenceEvents;
+		std::vector<OnsetBitmap> m_groupEvents;    // Groups A and B
+
 		// Numerical analysis variables:
 		bool        m_analysisOnsetsQ    = false;    // used with -P option
 		bool        m_analysisAccentsQ   = false;    // used with -A option
@@ -7144,6 +8879,16 @@ class Tool_deg : public HumTool {
 	//
 
 	public: // Tool_deg class
+		// ScaleDegree rendering options, shared by the ScaleDegrees of
+		// one Tool_deg:
+		class ScaleDegreeOptions {
+			public:
+				bool        showTiesQ  = false;
+				bool        showZerosQ = false;
+				bool        octaveQ    = false;
+				std::string forcedKey;
+		};
+
 		class ScaleDegree;
 		class ScaleDegree {
 			public:  // ScaleDegree class
@@ -7178,10 +8923,8 @@ class Tool_deg : public HumTool {
 				int             getSubtokenCount         (void) const;
 
 				// output options:
-				static void     setShowTies    (bool state) { m_showTiesQ = state;  }
-				static void     setShowZeros   (bool state) { m_showZerosQ = state; }
-				static void     setShowOctaves (bool state) { m_octaveQ = state; }
-				static void     setForcedKey   (const std::string& key) { m_forcedKey = key; }
+				void            setOptions     (const ScaleDegreeOptions* options) { m_options = options; }
+				const ScaleDegreeOptions& getOptions (void) const;
 
 			protected:  // ScaleDegree class
 				std::string     generateDegDataToken     (void) const;
@@ -7258,11 +9001,8 @@ class Tool_deg : public HumTool {
 				ScaleDegree* m_prevRest = NULL;
 				ScaleDegree* m_nextRest = NULL;
 
-				// ScaleDegree rendering options:
-				static bool m_showTiesQ;
-				static bool m_showZerosQ;
-				static bool m_octaveQ;
-				static std::string m_forcedKey;
+				// m_options: rendering options (defaults if NULL).
+				const ScaleDegreeOptions* m_options = NULL;
 		};
 
 
@@ -7360,6 +9100,7 @@ class Tool_deg : public HumTool {
 		bool m_kernQ           = false;   // used with --kern option
 		bool m_degTiesQ        = false;   // used with -t option
 		bool m_forceKeyQ       = false;   // used with -K option
+		bool m_estimateKeyQ    = false;   // used with --estimate-key option
 
 		std::string m_defaultKey  = "";    // used with --default-key option
 		std::string m_forcedKey   = "";    // used with --forced-key option
@@ -7369,6 +9110,13 @@ class Tool_deg : public HumTool {
 
 		std::vector<bool> m_processTrack;  // used with -k and -s option
 
+		// m_degOptions: output options for the ScaleDegrees in m_degSpines.
+		ScaleDegreeOptions m_degOptions;
+
+		// m_keyEstimator: local keys for spines without key designations
+		// (used with --estimate-key option).
+		KeyEstimator m_keyEstimator;
+
 		class InterleavedPrintVariables {
 			public:
 				bool foundData;
@@ -7875,14 +9623,21 @@ class Tool_extract : public HumTool {
 		bool     run                    (HumdrumFile& infile);
 		bool     run                    (const std::string& indata, std::ostream& out);
 		bool     run                    (HumdrumFile& infile, std::ostream& out);
+		bool     run                    (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 
-		// auto transpose functions:
-		void     initialize             (HumdrumFile& infile);
+		void     initialize             (void);
 
 		// function declarations
 		void    processFile             (HumdrumFile& infile);
+		bool    isStreamable            (void);
+		bool    processSegments         (HumdrumLineStream& instream, std::ostream& out);
+		bool    processSegment          (std::stringstream& segment,
+		                                 const std::string& filename, std::ostream& out);
+		int     getMaxFieldNumber       (const std::string& fieldstring);
+		void    extractLine             (HumdrumLineStream& line);
+		void    excludeLine             (HumdrumLineStream& line);
 		void    excludeFields           (HumdrumFile& infile, std::vector<int>& field,
 		                                 std::vector<int>& subfield, std::vector<int>& model);
 		void    extractFields           (HumdrumFile& infile, std::vector<int>& field,
@@ -7898,9 +9653,12 @@ class Tool_extract : public HumTool {
 		void    fillFieldData           (std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model, std::string& fieldstring,
 		                                 HumdrumFile& infile);
+		void    fillFieldData           (std::vector<int>& field, std::vector<int>& subfield,
+		                                 std::vector<int>& model, std::string& fieldstring,
+		                                 int maxtrack, HumdrumFile* infile);
 		void    processFieldEntry       (std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model, const std::string& astring,
-		                                 HumdrumFile& infile);
+		                                 int maxtrack, HumdrumFile* infile);
 		void    removeDollarsFromString (std::string& buffer, int maxtrack);
 		int     isInList                (int number, std::vector<int>& listofnum);
 		void    getTraceData            (std::vector<int>& startline,
@@ -7911,6 +9669,12 @@ class Tool_extract : public HumTool {
 		void    dealWithSpineManipulators(HumdrumFile& infile, int line,
 		                                 std::vector<int>& field, std::vector<int>& subfield,
 		                                 std::vector<int>& model);
+		void    dealWithSpineManipulators(const std::vector<std::string>& tokens,
+		                                 const std::vector<int>& tracks,
+		                                 const std::vector<std::string>& spineinfo,
+		                                 const std::string& linetext, int maxtrack,
+		                                 std::vector<int>& field, std::vector<int>& subfield,
+		                                 std::vector<int>& model);
 		void    storeToken              (std::vector<std::string>& storage,
 		                                 const std::string& string);
 		void    storeToken              (std::vector<std::string>& storage, int index,
@@ -8059,7 +9823,7 @@ class Tool_fb : public HumTool {
 		vector<FiguredBassNumber*> getAbbreviatedNumbers                  (const vector<FiguredBassNumber*>& numbers);
 		string                     getNumberString                        (vector<FiguredBassNumber*> numbers);
 		string                     getKeySignature                        (HumdrumFile& infile, int lineIndex);
-		int                        getLowestBase40Pitch                   (vector<int> base40Pitches);
+		int                        getLowestBase40Pitch                   (const vector<int>& base40Pitches);
 		string                     getIntervalQuality                     (int basePitchBase40, int targetPitchBase40);
 
 
@@ -8237,14 +10001,17 @@ class Tool_grep : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, std::ostream& out);
 		bool     run               (HumdrumFile& infile, std::ostream& out);
+		bool     run               (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 		void      processFile         (HumdrumFile& infile);
+		bool      isPrintedLine       (const std::string& line);
 		void      initialize          (void);
 
 	private:
 		bool        m_negateQ;    // for the -v option
 		std::string m_regex;      // for the -e option
+		HumRegex    m_hre;
 
 };
 
@@ -8640,6 +10407,33 @@ class Tool_humtr : public HumTool {
 };
 
 
+class ImitationIndex {
+	public:
+		            ImitationIndex    (void) {};
+		           ~ImitationIndex    () {};
+
+		void        clear             (void) { m_positions.clear(); }
+		void        build             (const std::vector<uint64_t>& keys);
+		const std::vector<int>& find  (uint64_t key) const;
+
+		static void getSymbols        (std::vector<uint64_t>& symbols,
+		                               std::vector<NoteCell*>& attacks,
+		                               std::vector<double>& intervals,
+		                               bool negate, bool duration);
+		static void getWindowKeys     (std::vector<uint64_t>& keys,
+		                               const std::vector<uint64_t>& symbols,
+		                               int length);
+
+		static const uint64_t NoKey = 0;
+
+	private:
+		static const uint64_t RestBit = 0x8000000000000000ULL;
+		std::unordered_map<uint64_t, std::vector<int>> m_positions;
+		std::vector<int> m_empty;
+};
+
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -8664,6 +10458,11 @@ class Tool_imitation : public HumTool {
 		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
 		                            int i1, vector<NoteCell*>& attack2,
 		                            vector<double>& seq2, int i2);
+		bool    extendsBackward    (vector<NoteCell*>& attack1, vector<double>& seq1,
+		                            int i1, vector<NoteCell*>& attack2,
+		                            vector<double>& seq2, int i2);
+		void    prepareTargets     (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals);
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
@@ -8680,7 +10479,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;   // number of the current imitation
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
@@ -8705,6 +10504,14 @@ class Tool_imitation : public HumTool {
 		bool m_retrograde = false;
 
 		vector<int> m_barlines;
+
+		// Match search: window keys for each voice as initiator, index of
+		// window positions for each voice as target, and reversed voices
+		// for retrograde searches:
+		vector<vector<uint64_t>>  m_keys;
+		vector<ImitationIndex>    m_index;
+		vector<vector<NoteCell*>> m_retroAttacks;
+		vector<vector<double>>    m_retroIntervals;
 };
 
 
@@ -9691,6 +11498,7 @@ class Tool_msearch : public HumTool {
 		                            const std::string& input);
 		void    fillTextQuery      (vector<MSearchTextQuery>& query,
 		                            const std::string& input);
+		const HumWordIndex* getWordIndex(HumdrumFile& infile);
 		bool    checkForMusicMatch(vector<NoteCell*>& notes, int index,
 		                            vector<MSearchQueryToken>& dpcQuery,
 		                            vector<NoteCell*>& match);
@@ -9727,6 +11535,8 @@ class Tool_msearch : public HumTool {
 		std::vector<std::vector<NoteCell*>> m_matches;
 		std::vector<SonorityDatabase> m_sonorities;
 		std::vector<bool> m_sonoritiesChecked;
+		std::vector<HumWordIndex> m_wordIndexes;  // from --index file
+		bool        m_wordIndexesReadQ = false;
 		std::vector<pair<HTp, int>> m_tomark;
 };
 
@@ -9979,6 +11789,9 @@ class Tool_musicxml2hum : public HumTool {
 		std::string getHairpinString(pugi::xml_node element, int partindex);
 		std::string cleanSpaces     (const std::string& input);
 		void checkForDummyRests(MxmlMeasure* measure);
+		void attachHairpinEndings(MxmlMeasure* measure);
+		void preparePartEvents (std::vector<MxmlPart>& partdata);
+		void forEachPart       (int count, const std::function<void(int)>& process);
 		void reindexVoices     (std::vector<MxmlPart>& partdata);
 		void reindexMeasure    (MxmlMeasure* measure);
 		void setSoftwareInfo   (pugi::xml_document& doc);
@@ -10002,6 +11815,7 @@ class Tool_musicxml2hum : public HumTool {
 		bool VoiceDebugQ;
 		bool m_recipQ        = false;
 		bool m_stemsQ        = false;
+		int  m_threads       = 1;     // used with -j option: threads for parsing parts
 		int  m_slurabove     = 0;
 		int  m_slurbelow     = 0;
 		int  m_staffabove    = 0;
@@ -10320,6 +12134,7 @@ class Tool_pccount : public HumTool {
 		     ~Tool_pccount              () {};
 
 		bool  run                       (HumdrumFileSet& infiles);
+		bool  run                       (HumdrumFileStream& instream);
 		bool  run                       (HumdrumFile& infile);
 		bool  run                       (const std::string& indata, std::ostream& out);
 		bool  run                       (HumdrumFile& infile, std::ostream& out);
@@ -10327,8 +12142,10 @@ class Tool_pccount : public HumTool {
 	protected:
 		void   initialize               (HumdrumFile& infile);
 		void   processFile              (HumdrumFile& infile);
+		void   processCorpus            (HumdrumFileStream& instream);
 		void   initializePartInfo       (HumdrumFile& infile);
-		void   addCounts                (HTp sstart, HTp send);
+		void   addCounts                (std::vector<PitchClassHistogram>& histograms,
+		                                 HTp sstart, HTp send);
 		void   countPitches             (HumdrumFile& infile);
 		void   printHumdrumTable        (void);
 		void   printPitchClassList      (void);
@@ -10515,6 +12332,7 @@ class _VoiceInfo {
 	public:
 		std::vector<std::vector<double>>   diatonic;
 		std::vector<double>                midibins;
+		PitchHistogram                     histogram; // source of diatonic and midibins
 		std::string                        name;      // name for instrument name of spine
 		std::string                        abbr;      // abbreviation for instrument name of spine
 		int                                track;     // track number for spine
@@ -10528,6 +12346,7 @@ class _VoiceInfo {
 	public:
 		                _VoiceInfo        (void);
 		void            clear             (void);
+		void            loadHistogram     (void);
 		std::ostream&   print             (std::ostream& out);
 
 };
@@ -10709,9 +12528,11 @@ class Tool_rid : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, std::ostream& out);
 		bool     run               (HumdrumFile& infile, std::ostream& out);
+		bool     run               (HumdrumLineStream& instream, std::ostream& out);
 
 	protected:
 		void     processFile       (HumdrumFile& infile);
+		bool     isRemovedLine     (HumdrumLineStream& line);
 		void     initialize        (void);
 
 	private:
@@ -10734,6 +12555,8 @@ class Tool_rid : public HumTool {
 		int      option_k = 0;   // used with -k option
 		int      option_V = 0;   // used with -V option
 
+		HumRegex m_hre;          // used with -g option
+
 };
 
 
@@ -11544,9 +13367,6 @@ class Tool_thru : public HumTool {
 		void      example             (void);
 		void      processData         (HumdrumFile& infile);
 		void      usage               (const char* command);
-		void      getLabelSequence    (std::vector<std::string>& labelsequence,
-		                               const std::string& astring);
-		int       getLabelIndex       (std::vector<std::string>& labels, std::string& key);
 		void      printLabelList      (HumdrumFile& infile);
 		void      printLabelInfo      (HumdrumFile& infile);
 		int       getBarline          (HumdrumFile& infile, int line);
@@ -11600,6 +13420,22 @@ class Tool_tie : public HumTool {
 };
 
 
+// Maximum number of lines that the shortest line of a file can be expanded
+// into when the timebase is the minimum time unit of the file:
+#define TIMEBASE_MAX_EXPANSION 16
+
+// TimebaseRun: a line of the input file and the number of timebase units
+// that it lasts.  Non-data lines and grace-note lines have 0 units.
+
+class TimebaseRun {
+	public:
+		int  m_line  = 0;
+		int  m_units = 0;
+		bool m_exact = true;  // false if the line duration is not a
+		                      // multiple of the timebase
+};
+
+
 class Tool_timebase : public HumTool {
 	public:
 		      Tool_timebase       (void);
@@ -11610,16 +13446,32 @@ class Tool_timebase : public HumTool {
 		bool  run                 (const std::string& indata, std::ostream& out);
 		bool  run                 (HumdrumFile& infile, std::ostream& out);
 
+		const std::vector<TimebaseRun>& getRuns(void) const { return m_runs; }
+
 	protected:
 		void   processFile         (HumdrumFile& infile);
 		HumNum getMinimumTime      (HumdrumFile& infile);
+		void   buildRuns           (HumdrumFile& infile, HumNum mindur);
 		void   expandScore         (HumdrumFile& infile, HumNum mindur);
+		void   collapseScore       (HumdrumFile& infile);
+		void   collapseText        (const std::string& indata);
+		void   getInputNulls       (const std::string& marker,
+		                            std::vector<bool>& output);
+		bool   isTimebaseMarker    (const char* text);
+		const std::string& getNullLine(int fieldCount);
 
 	private:
 		bool   m_grace   = false;
 		bool   m_quiet   = false;
 		HumNum m_basedur = false;
 
+		// m_runs: the input lines with their durations in timebase units.
+		std::vector<TimebaseRun> m_runs;
+
+		// m_nullLines: lines of null tokens (including the newline),
+		// indexed by field count.
+		std::vector<std::string> m_nullLines;
+
 };
 
 
@@ -0,0 +1,440 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 18:41:26 PDT 2026
+// Last Modified: Sat Oct 17 18:41:26 PDT 2026
+// Filename:      CorrelationScape.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/CorrelationScape.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Windowed Pearson correlations for correlation scapes.
+//
+
+#include "CorrelationScape.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// Window variances below this fraction of the running sum of squares
+// are rounding noise from subtracting the running sums, and the window
+// is considered to have no variation:
+//
+
+static const double corscape_tolerance = 1.0e-10;
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::CorrelationScape --
+//
+
+CorrelationScape::CorrelationScape(void) {
+	// do nothing
+}
+
+CorrelationScape::CorrelationScape(const vector<double>& x,
+		const vector<double>& y) {
+	setSequences(x, y);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::clear --
+//
+
+void CorrelationScape::clear(void) {
+	m_size = 0;
+	m_cycle = 0;
+	m_x.clear();
+	m_sumx.clear();
+	m_sumxx.clear();
+	m_y.clear();
+	m_sumy.clear();
+	m_sumyy.clear();
+	m_sumxy.clear();
+	m_combsum.clear();
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setSequences -- Store the running sums for
+//    correlating windows of x with the same windows of y.  If the
+//    sequences have different lengths, only the length of the shorter
+//    one is used.
+//
+
+void CorrelationScape::setSequences(const vector<double>& x,
+		const vector<double>& y) {
+	clear();
+	m_size = (int)min(x.size(), y.size());
+	vector<double> xx(x.begin(), x.begin() + m_size);
+	vector<double> yy(y.begin(), y.begin() + m_size);
+	prepareSums(m_sumx, m_sumxx, m_x, xx);
+	prepareSums(m_sumy, m_sumyy, m_y, yy);
+	m_sumxy.resize(m_size + 1);
+	m_sumxy[0] = 0.0;
+	for (int i=0; i<m_size; i++) {
+		m_sumxy[i+1] = m_sumxy[i] + m_x[i] * m_y[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setSequence -- Store the running sums for
+//    correlating windows of x with patterns.
+//
+
+void CorrelationScape::setSequence(const vector<double>& x) {
+	clear();
+	m_size = (int)x.size();
+	prepareSums(m_sumx, m_sumxx, m_x, x);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::setCombCycle -- Set the cycle of the comb pattern
+//    used by getCombRow().  The pattern is 0, -1, -2, ..., -(cycle-1),
+//    repeated for the length of the window.  Must be called after the
+//    sequence is set.
+//
+
+void CorrelationScape::setCombCycle(int cycle) {
+	m_cycle = cycle;
+	m_combsum.clear();
+	if (m_cycle < 1) {
+		return;
+	}
+	m_combsum.resize(m_size);
+	for (int i=0; i<m_size; i++) {
+		m_combsum[i] = m_x[i];
+		if (i >= m_cycle) {
+			m_combsum[i] += m_combsum[i - m_cycle];
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCorrelation -- Return the correlation of the
+//    window of x starting at the given index with the same window of y,
+//    or of the window of x with the pattern (which has the length of the
+//    window).
+//
+
+double CorrelationScape::getCorrelation(int start, int length) const {
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	if (m_y.empty()) {
+		return NAN;
+	}
+	double xtolerance;
+	double ytolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	double yvariance = getVariance(m_sumy, m_sumyy, start, length, ytolerance);
+	int end = start + length;
+	double sumx = m_sumx[end] - m_sumx[start];
+	double sumy = m_sumy[end] - m_sumy[start];
+	double covariance = m_sumxy[end] - m_sumxy[start] - sumx * sumy / length;
+	return correlate(covariance, xvariance, xtolerance, yvariance, ytolerance);
+}
+
+
+double CorrelationScape::getCorrelation(int start,
+		const vector<double>& pattern) const {
+	int length = (int)pattern.size();
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	vector<double> centered;
+	double variance;
+	double tolerance;
+	preparePattern(centered, variance, tolerance, pattern);
+	return getPatternCorrelation(start, centered, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombCorrelation -- Return the correlation of the
+//    window of x starting at the given index with the comb pattern.
+//
+
+double CorrelationScape::getCombCorrelation(int start, int length) const {
+	if ((start < 0) || (length < 1) || (start + length > m_size)) {
+		return NAN;
+	}
+	if (m_cycle < 1) {
+		return NAN;
+	}
+	double sum;
+	double variance;
+	double tolerance;
+	prepareComb(sum, variance, tolerance, length);
+	return getCombCorrelation(start, length, sum, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getRow -- Calculate the correlations of all windows
+//    with the given length (or the length of the pattern) starting at
+//    indexes 0 to row.size()-1.
+//
+
+bool CorrelationScape::getRow(vector<double>& row, int length) const {
+	int count = (int)row.size();
+	if ((length < 1) || (count + length - 1 > m_size) || m_y.empty()) {
+		return false;
+	}
+	for (int i=0; i<count; i++) {
+		row[i] = getCorrelation(i, length);
+	}
+	return true;
+}
+
+
+bool CorrelationScape::getRow(vector<double>& row,
+		const vector<double>& pattern) const {
+	int count = (int)row.size();
+	int length = (int)pattern.size();
+	if ((length < 1) || (count + length - 1 > m_size)) {
+		return false;
+	}
+
+	vector<double> centered;
+	double variance;
+	double tolerance;
+	preparePattern(centered, variance, tolerance, pattern);
+	for (int i=0; i<count; i++) {
+		row[i] = getPatternCorrelation(i, centered, variance, tolerance);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombRow -- Calculate the correlations of the comb
+//    pattern with all windows of the given length starting at indexes 0
+//    to row.size()-1.
+//
+
+bool CorrelationScape::getCombRow(vector<double>& row, int length) const {
+	int count = (int)row.size();
+	if ((length < 1) || (count + length - 1 > m_size) || (m_cycle < 1)) {
+		return false;
+	}
+
+	double sum;
+	double variance;
+	double tolerance;
+	prepareComb(sum, variance, tolerance, length);
+	for (int i=0; i<count; i++) {
+		row[i] = getCombCorrelation(i, length, sum, variance, tolerance);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::prepareSums -- Subtract the mean from the input
+//    sequence and calculate the running sums of the values and their
+//    squares.  Centering the values keeps the running sums small, so
+//    that little precision is lost when subtracting them.
+//
+
+void CorrelationScape::prepareSums(vector<double>& sum, vector<double>& sumsq,
+		vector<double>& centered, const vector<double>& input) {
+	int size = (int)input.size();
+	double mean = 0.0;
+	for (int i=0; i<size; i++) {
+		mean += input[i];
+	}
+	if (size > 0) {
+		mean /= size;
+	}
+	centered.resize(size);
+	sum.resize(size + 1);
+	sumsq.resize(size + 1);
+	sum[0] = 0.0;
+	sumsq[0] = 0.0;
+	for (int i=0; i<size; i++) {
+		centered[i] = input[i] - mean;
+		sum[i+1] = sum[i] + centered[i];
+		sumsq[i+1] = sumsq[i] + centered[i] * centered[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::preparePattern -- Subtract the mean from a pattern
+//    and calculate the sum of its squared deviations.
+//
+
+void CorrelationScape::preparePattern(vector<double>& centered,
+		double& variance, double& tolerance, const vector<double>& pattern) {
+	int length = (int)pattern.size();
+	double mean = 0.0;
+	for (int i=0; i<length; i++) {
+		mean += pattern[i];
+	}
+	mean /= length;
+	centered.resize(length);
+	variance = 0.0;
+	double sumsq = 0.0;
+	for (int i=0; i<length; i++) {
+		centered[i] = pattern[i] - mean;
+		variance += centered[i] * centered[i];
+		sumsq += pattern[i] * pattern[i];
+	}
+	tolerance = sumsq * corscape_tolerance;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::prepareComb -- Calculate the sum and the sum of the
+//    squared deviations of the comb pattern for a window length.  The
+//    value -r occurs once in every cycle.
+//
+
+void CorrelationScape::prepareComb(double& sum, double& variance,
+		double& tolerance, int length) const {
+	sum = 0.0;
+	double sumsq = 0.0;
+	for (int r=1; (r<m_cycle) && (r<length); r++) {
+		int occurrences = (length - r + m_cycle - 1) / m_cycle;
+		sum -= (double)r * occurrences;
+		sumsq += (double)r * r * occurrences;
+	}
+	variance = sumsq - sum * sum / length;
+	tolerance = sumsq * corscape_tolerance;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getVariance -- Return the sum of the squared
+//    deviations from the mean in a window (the variance multiplied by
+//    the window length).  The tolerance is the largest rounding error
+//    expected for the result.
+//
+
+double CorrelationScape::getVariance(const vector<double>& sum,
+		const vector<double>& sumsq, int start, int length,
+		double& tolerance) const {
+	int end = start + length;
+	double wsum = sum[end] - sum[start];
+	tolerance = sumsq[end] * corscape_tolerance;
+	return sumsq[end] - sumsq[start] - wsum * wsum / length;
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getPatternCorrelation -- Correlate the window of x
+//    starting at the given index with a pattern which has had its mean
+//    removed.
+//
+
+double CorrelationScape::getPatternCorrelation(int start,
+		const vector<double>& pattern, double variance, double tolerance) const {
+	int length = (int)pattern.size();
+	double xtolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	const double* x = m_x.data() + start;
+	double covariance = 0.0;
+	for (int i=0; i<length; i++) {
+		covariance += x[i] * pattern[i];
+	}
+	return correlate(covariance, xvariance, xtolerance, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::getCombCorrelation -- Correlate the window of x
+//    starting at the given index with the comb pattern.  The products of
+//    the window and the pattern are summed separately for each position
+//    in the cycle using the running sums over every m_cycle-th value.
+//
+
+double CorrelationScape::getCombCorrelation(int start, int length,
+		double patternsum, double variance, double tolerance) const {
+	double xtolerance;
+	double xvariance = getVariance(m_sumx, m_sumxx, start, length, xtolerance);
+	double product = 0.0;
+	for (int r=1; (r<m_cycle) && (r<length); r++) {
+		int first = start + r;
+		int last = first + ((length - 1 - r) / m_cycle) * m_cycle;
+		double total = m_combsum[last];
+		if (first >= m_cycle) {
+			total -= m_combsum[first - m_cycle];
+		}
+		product -= r * total;
+	}
+	double sumx = m_sumx[start + length] - m_sumx[start];
+	double covariance = product - sumx * patternsum / length;
+	return correlate(covariance, xvariance, xtolerance, variance, tolerance);
+}
+
+
+
+//////////////////////////////
+//
+// CorrelationScape::correlate -- Return the correlation for the given
+//    covariance and variances, or NAN if either variance is zero.
+//
+
+double CorrelationScape::correlate(double covariance, double xvariance,
+		double xtolerance, double yvariance, double ytolerance) {
+	if ((xvariance <= xtolerance) || (yvariance <= ytolerance)) {
+		return NAN;
+	}
+	double output = covariance / sqrt(xvariance * yvariance);
+	if (output > 1.0) {
+		output = 1.0;
+	} else if (output < -1.0) {
+		output = -1.0;
+	}
+	return output;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
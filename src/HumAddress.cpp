@@ -26,6 +26,7 @@ namespace hum {
 //
 
 HumAddress::HumAddress(void) {
+	m_spining       = NULL;
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_subtrackcount = 0;
@@ -39,8 +40,9 @@ HumAddress::HumAddress(HumAddress& address) {
 	m_track         = address.m_track;
 	m_subtrack      = address.m_subtrack;
 	m_subtrackcount = address.m_subtrackcount;
-	m_spining       = address.m_spining;
+	m_spining       = NULL;
 	m_owner         = address.m_owner;
+	shareSpineInfo(address);
 }
 
 
@@ -51,6 +53,7 @@ HumAddress::HumAddress(HumAddress& address) {
 //
 
 HumAddress::~HumAddress() {
+	releaseSpineInfo();
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_fieldindex    = -1;
@@ -70,8 +73,8 @@ HumAddress& HumAddress::operator=(const HumAddress& address) {
 	m_track         = address.m_track;
 	m_subtrack      = address.m_subtrack;
 	m_subtrackcount = address.m_subtrackcount;
-	m_spining       = address.m_spining;
 	m_owner         = address.m_owner;
+	shareSpineInfo(address);
 	return *this;
 }
 
@@ -124,7 +127,7 @@ int HumAddress::getFieldIndex(void) const {
 //
 
 const HumdrumToken& HumAddress::getDataType(void) const {
-	static HumdrumToken null("");
+	static thread_local HumdrumToken null("");
 	if (m_owner == NULL) {
 		return null;
 	}
@@ -144,7 +147,7 @@ const HumdrumToken& HumAddress::getDataType(void) const {
 //
 
 HTp HumAddress::getExclusiveInterpretation(void) {
-	static HumdrumToken null("");
+	static thread_local HumdrumToken null("");
 	if (m_owner == NULL) {
 		return &null;
 	}
@@ -169,7 +172,11 @@ HTp HumAddress::getExclusiveInterpretation(void) {
 //
 
 const string& HumAddress::getSpineInfo(void) const {
-	return m_spining;
+	static const string empty;
+	if (m_spining == NULL) {
+		return empty;
+	}
+	return m_spining->m_text;
 }
 
 
@@ -310,7 +317,52 @@ void HumAddress::setFieldIndex(int index) {
 //
 
 void HumAddress::setSpineInfo(const string& spineinfo) {
-	m_spining = spineinfo;
+	if (getSpineInfo() == spineinfo) {
+		return;
+	}
+	releaseSpineInfo();
+	if (!spineinfo.empty()) {
+		m_spining = new SpineInfo;
+		m_spining->m_text = spineinfo;
+		m_spining->m_refs = 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumAddress::shareSpineInfo -- Use the same spine info string as another
+//     address.  The spine info of the tokens in a spine only changes at
+//     spine manipulators, so HumdrumFileBase::analyzeSpines() shares the
+//     string of the previous token in the spine rather than storing a
+//     copy for each token.
+//
+
+void HumAddress::shareSpineInfo(const HumAddress& address) {
+	if (address.m_spining == m_spining) {
+		return;
+	}
+	if (address.m_spining) {
+		address.m_spining->m_refs++;
+	}
+	releaseSpineInfo();
+	m_spining = address.m_spining;
+}
+
+
+
+//////////////////////////////
+//
+// HumAddress::releaseSpineInfo -- Stop using the spine info string,
+//     deleting it if no other address uses it.
+//
+
+void HumAddress::releaseSpineInfo(void) {
+	if (m_spining && (--m_spining->m_refs == 0)) {
+		delete m_spining;
+	}
+	m_spining = NULL;
 }
 
 
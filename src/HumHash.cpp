@@ -101,6 +101,7 @@
 
 #include "Convert.h"
 #include "HumHash.h"
+#include "HumJsonWriter.h"
 #include "HumNum.h"
 #include "HumdrumToken.h"
 
@@ -143,6 +144,36 @@ HumHash::HumHash(void) {
 
 
 
+//////////////////////////////
+//
+// HumHash::HumHash -- Copy constructor.  The parameter storage is
+//    duplicated so that the two objects do not share the same map.
+//
+
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	if (hash.parameters != NULL) {
+		parameters = new MapNNKV(*hash.parameters);
+	}
+	prefix = hash.prefix;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::HumHash -- Move constructor.  The parameter storage is
+//    transferred to the new object.
+//
+
+HumHash::HumHash(HumHash&& hash) noexcept {
+	parameters = hash.parameters;
+	hash.parameters = NULL;
+	prefix = std::move(hash.prefix);
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::~HumHash -- The HumHash deconstructor, which removed any
@@ -158,6 +189,42 @@ HumHash::~HumHash() {
 
 
 
+//////////////////////////////
+//
+// HumHash::operator= -- Copy and move assignment.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters != NULL) {
+		delete parameters;
+		parameters = NULL;
+	}
+	if (hash.parameters != NULL) {
+		parameters = new MapNNKV(*hash.parameters);
+	}
+	prefix = hash.prefix;
+	return *this;
+}
+
+
+HumHash& HumHash::operator=(HumHash&& hash) noexcept {
+	if (this == &hash) {
+		return *this;
+	}
+	if (parameters != NULL) {
+		delete parameters;
+	}
+	parameters = hash.parameters;
+	hash.parameters = NULL;
+	prefix = std::move(hash.prefix);
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValue -- Returns the value specified by the given key.
@@ -974,6 +1041,54 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::remapTokens -- Replace token pointers stored in the parameters
+//    (origins and values set with an HTp) with their counterparts in the
+//    given map.  Used when duplicating a HumdrumFile so that the copied
+//    parameters refer to the copied tokens.  Pointers not found in the
+//    map are left unchanged.
+//
+
+void HumHash::remapTokens(const unordered_map<HTp, HTp>& tokenmap) {
+	if (parameters == NULL) {
+		return;
+	}
+	for (auto& it1 : *parameters) {
+		for (auto& it2 : it1.second) {
+			for (auto& it3 : it2.second) {
+				HumParameter& param = it3.second;
+				if (param.origin != NULL) {
+					auto found = tokenmap.find(param.origin);
+					if (found != tokenmap.end()) {
+						param.origin = found->second;
+					}
+				}
+				if (param.compare(0, 3, "HT_") != 0) {
+					continue;
+				}
+				HTp pointer = NULL;
+				try {
+					pointer = (HTp)(stoll(param.substr(3)));
+				} catch (invalid_argument& e) {
+					continue;
+				}
+				auto found = tokenmap.find(pointer);
+				if (found == tokenmap.end()) {
+					continue;
+				}
+				stringstream ss;
+				ss << "HT_" << ((long long)found->second);
+				HTp origin = param.origin;
+				param = HumParameter(ss.str());
+				param.origin = origin;
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::initializeParameters -- Create the map structure if it does not
@@ -1226,6 +1341,74 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumHash::printJson -- Write the parameters as a member of the current
+//    JSON object, nested by namespace: {"ns1": {"ns2": {"key": "value"}}}.
+//    Parameters which have an origin token are written as
+//    {"value": "...", "idref": "..."}.  Nothing is written if there are no
+//    parameters.
+// default value: key = "parameters"
+//
+
+void HumHash::printJson(HumJsonWriter& json, const char* key) {
+	if (parameters == NULL) {
+		return;
+	}
+	bool found = false;
+	for (auto& it1 : *(parameters)) {
+		for (auto& it2 : it1.second) {
+			if (!it2.second.empty()) {
+				found = true;
+				break;
+			}
+		}
+		if (found) {
+			break;
+		}
+	}
+	if (!found) {
+		return;
+	}
+
+	HumdrumToken* ref = NULL;
+	json.writeKey(key);
+	json.beginObject();
+	for (auto& it1 : *(parameters)) {
+		if (it1.second.empty()) {
+			continue;
+		}
+		json.writeKey(it1.first);
+		json.beginObject();
+		for (auto& it2 : it1.second) {
+			if (it2.second.empty()) {
+				continue;
+			}
+			json.writeKey(it2.first);
+			json.beginObject();
+			for (auto& it3 : it2.second) {
+				json.writeKey(it3.first);
+				ref = it3.second.origin;
+				if (ref == NULL) {
+					json.writeString(it3.second);
+					continue;
+				}
+				json.beginObject();
+				json.writeKey("value");
+				json.writeString(it3.second);
+				json.writeKey("idref");
+				json.writeTokenId(ref->getLineIndex(), ref->getFieldIndex());
+				json.endObject();
+			}
+			json.endObject();
+		}
+		json.endObject();
+	}
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::printXmlAsGlobal --
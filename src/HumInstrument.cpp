@@ -13,7 +13,9 @@
 
 #include "HumInstrument.h"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 
 using namespace std;
 
@@ -23,10 +25,6 @@ namespace hum {
 
 typedef unsigned long long TEMP64BITFIX;
 
-// declare static variables
-vector<_HumInstrument> HumInstrument::m_data;
-int HumInstrument::m_classcount = 0;
-
 
 //////////////////////////////
 //
@@ -34,10 +32,7 @@ int HumInstrument::m_classcount = 0;
 //
 
 HumInstrument::HumInstrument(void) {
-	if (m_classcount == 0) {
-		initialize();
-	}
-	m_classcount++;
+	m_data = getDefaultData();
 	m_index = -1;
 }
 
@@ -49,15 +44,25 @@ HumInstrument::HumInstrument(void) {
 //
 
 HumInstrument::HumInstrument(const string& Hname) {
-	if (m_classcount == 0) {
-		initialize();
-	}
-
+	m_data = getDefaultData();
 	m_index = find(Hname);
 }
 
 
 
+//////////////////////////////
+//
+// HumInstrument::HumInstrument -- Constructor for an object which fills
+//    in the given table (used to create the default table).
+//
+
+HumInstrument::HumInstrument(std::shared_ptr<vector<_HumInstrument>> data) {
+	m_data = data;
+	m_index = -1;
+}
+
+
+
 //////////////////////////////
 //
 // HumInstrument::~HumInstrument --
@@ -76,7 +81,7 @@ HumInstrument::~HumInstrument() {
 
 int HumInstrument::getGM(void) {
 	if (m_index > 0) {
-		return m_data[m_index].gm;
+		return (*m_data)[m_index].gm;
 	} else {
 		return -1;
 	}
@@ -98,7 +103,7 @@ int HumInstrument::getGM(const string& Hname) {
 	}
 
 	if (tindex > 0) {
-		return m_data[tindex].gm;
+		return (*m_data)[tindex].gm;
 	} else {
 		return -1;
 	}
@@ -113,7 +118,7 @@ int HumInstrument::getGM(const string& Hname) {
 
 string HumInstrument::getName(void) {
 	if (m_index > 0) {
-		return m_data[m_index].name;
+		return (*m_data)[m_index].name;
 	} else {
 		return "";
 	}
@@ -134,7 +139,7 @@ string HumInstrument::getName(const string& Hname) {
 		tindex = find(Hname);
 	}
 	if (tindex > 0) {
-		return m_data[tindex].name;
+		return (*m_data)[tindex].name;
 	} else {
 		return "";
 	}
@@ -149,7 +154,7 @@ string HumInstrument::getName(const string& Hname) {
 
 string HumInstrument::getHumdrum(void) {
 	if (m_index > 0) {
-		return m_data[m_index].humdrum;
+		return (*m_data)[m_index].humdrum;
 	} else {
 		return "";
 	}
@@ -166,9 +171,13 @@ int HumInstrument::setGM(const string& Hname, int aValue) {
 	if (aValue < 0 || aValue > 127) {
 		return 0;
 	}
+	if (m_data.use_count() > 1) {
+		// Copy the shared table before changing it:
+		m_data = std::make_shared<vector<_HumInstrument>>(*m_data);
+	}
 	int rindex = find(Hname);
 	if (rindex > 0) {
-		m_data[rindex].gm = aValue;
+		(*m_data)[rindex].gm = aValue;
 	} else {
 		afi(Hname.c_str(), aValue, Hname.c_str());
 		sortData();
@@ -199,12 +208,30 @@ void HumInstrument::setHumdrum(const string& Hname) {
 //
 
 
+//////////////////////////////
+//
+// HumInstrument::getDefaultData -- Return the instrument table used by
+//    new objects.  The table is created once, on first use, and is not
+//    changed afterwards (static local initialization is thread-safe).
+//
+
+std::shared_ptr<vector<_HumInstrument>> HumInstrument::getDefaultData(void) {
+	static std::shared_ptr<vector<_HumInstrument>> data = []() {
+		HumInstrument builder(std::make_shared<vector<_HumInstrument>>());
+		builder.initialize();
+		return builder.m_data;
+	}();
+	return data;
+}
+
+
+
 //////////////////////////////
 //
 // HumInstrument::initialize --
 //
 void HumInstrument::initialize(void) {
-   m_data.reserve(500);
+   m_data->reserve(500);
 
 	// List has to be sorted by first parameter.  Maybe put in map.
    afi("accor",   GM_ACCORDION,             "accordion");
@@ -436,7 +463,7 @@ void HumInstrument::afi(const char* humdrum_name, int midinum,
 	x.humdrum = humdrum_name;
 	x.gm = midinum;
 
-	m_data.push_back(x);
+	m_data->push_back(x);
 }
 
 
@@ -453,14 +480,14 @@ int HumInstrument::find(const string& Hname) {
 	key.name = "";
 	key.gm = 0;
 
-	searchResult = bsearch(&key, m_data.data(),
-			m_data.size(), sizeof(_HumInstrument),
+	searchResult = bsearch(&key, m_data->data(),
+			m_data->size(), sizeof(_HumInstrument),
 			&data_compare_by_humdrum_name);
 
 	if (searchResult == NULL) {
 		return -1;
 	} else {
-		return (int)(((TEMP64BITFIX)(searchResult)) - ((TEMP64BITFIX)(m_data.data())))/
+		return (int)(((TEMP64BITFIX)(searchResult)) - ((TEMP64BITFIX)(m_data->data())))/
 			sizeof(_HumInstrument);
 	}
 }
@@ -482,12 +509,15 @@ int HumInstrument::data_compare_by_humdrum_name(const void* a,
 
 //////////////////////////////
 //
-// HumInstrument::sortData --
+// HumInstrument::sortData -- Sort the table by Humdrum name for find().
+//     (std::string objects cannot be moved in memory by qsort).
 //
 
 void HumInstrument::sortData(void) {
-	qsort(m_data.data(), m_data.size(), sizeof(_HumInstrument),
-		&HumInstrument::data_compare_by_humdrum_name);
+	std::stable_sort(m_data->begin(), m_data->end(),
+		[](const _HumInstrument& a, const _HumInstrument& b) {
+			return a.humdrum < b.humdrum;
+		});
 }
 
 
@@ -0,0 +1,478 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 23:12:04 PDT 2026
+// Last Modified: Sat Oct 17 23:12:04 PDT 2026
+// Filename:      HumJsonWriter.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumJsonWriter.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Streaming JSON writer used by HumdrumFile::printJson().
+//
+
+#include "HumJsonWriter.h"
+
+#include <cctype>
+#include <cstring>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+// Size of the output buffer in bytes:
+#define HUMJSON_BUFFER_SIZE 65536
+
+
+//////////////////////////////
+//
+// HumJsonWriter::HumJsonWriter -- Constructor.
+// default value: indent = "\t"
+//
+
+HumJsonWriter::HumJsonWriter(ostream& out, const string& indent) : m_out(out) {
+	m_indent = indent;
+	m_buffer.resize(HUMJSON_BUFFER_SIZE);
+	m_empty.reserve(16);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::~HumJsonWriter -- Write any buffered output.
+//
+
+HumJsonWriter::~HumJsonWriter() {
+	flush();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::flush -- Write the buffered output to the stream.
+//
+
+void HumJsonWriter::flush(void) {
+	if (m_used > 0) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+	m_out.flush();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::beginObject -- Start a JSON object, either as an array
+//     element or as the value of the previous key.
+//
+
+void HumJsonWriter::beginObject(void) {
+	separate();
+	put('{');
+	m_empty.push_back(true);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::endObject -- Close the current object.
+//
+
+void HumJsonWriter::endObject(void) {
+	bool empty = m_empty.empty() ? true : m_empty.back();
+	if (!m_empty.empty()) {
+		m_empty.pop_back();
+	}
+	if (!empty) {
+		newline();
+	}
+	put('}');
+	if (m_empty.empty()) {
+		put('\n');
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::beginArray -- Start a JSON array.
+//
+
+void HumJsonWriter::beginArray(void) {
+	separate();
+	put('[');
+	m_empty.push_back(true);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::endArray -- Close the current array.
+//
+
+void HumJsonWriter::endArray(void) {
+	bool empty = m_empty.empty() ? true : m_empty.back();
+	if (!m_empty.empty()) {
+		m_empty.pop_back();
+	}
+	if (!empty) {
+		newline();
+	}
+	put(']');
+	if (m_empty.empty()) {
+		put('\n');
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeKey -- Write an object member name.  The next
+//     value written is the value of the member.  Key names given as
+//     char* are not escaped, so they should be plain identifiers.
+//
+
+void HumJsonWriter::writeKey(const char* key) {
+	separate();
+	put('"');
+	put(key, strlen(key));
+	put('"');
+	put(':');
+	if (!m_indent.empty()) {
+		put(' ');
+	}
+	m_afterKey = true;
+}
+
+
+void HumJsonWriter::writeKey(const string& key) {
+	separate();
+	put('"');
+	putEscaped(key.data(), key.size());
+	put('"');
+	put(':');
+	if (!m_indent.empty()) {
+		put(' ');
+	}
+	m_afterKey = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeString -- Write an escaped string value.
+//
+
+void HumJsonWriter::writeString(const string& value) {
+	separate();
+	put('"');
+	putEscaped(value.data(), value.size());
+	put('"');
+}
+
+
+void HumJsonWriter::writeString(const char* value) {
+	separate();
+	put('"');
+	putEscaped(value, strlen(value));
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeInt -- Write an integer value.
+//
+
+void HumJsonWriter::writeInt(int value) {
+	separate();
+	putInt(value);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeBool -- Write true or false.
+//
+
+void HumJsonWriter::writeBool(bool value) {
+	separate();
+	if (value) {
+		put("true", 4);
+	} else {
+		put("false", 5);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeNull -- Write null.
+//
+
+void HumJsonWriter::writeNull(void) {
+	separate();
+	put("null", 4);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeNumber -- Write a rational number as a two-element
+//     array [numerator, denominator] so that durations are exact.
+//
+
+void HumJsonWriter::writeNumber(HumNum value) {
+	separate();
+	put('[');
+	putInt(value.getNumerator());
+	put(',');
+	putInt(value.getDenominator());
+	put(']');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeLineId -- Write the ID of a line as a string.  This
+//     is the same as HumdrumLine::getXmlId(), which numbers lines from 1.
+//
+
+void HumJsonWriter::writeLineId(int line) {
+	separate();
+	put('"');
+	putEscaped(m_prefix.data(), m_prefix.size());
+	put('L');
+	putInt(line + 1);
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::writeTokenId -- Write the ID of a token as a string.
+//     This is the same as HumdrumToken::getXmlId().
+//
+
+void HumJsonWriter::writeTokenId(int line, int field) {
+	separate();
+	put('"');
+	putEscaped(m_prefix.data(), m_prefix.size());
+	put("loc", 3);
+	putInt(line);
+	put('_');
+	putInt(field);
+	put('"');
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::parseFields -- Convert a comma-separated list of content
+//     names (lines, tokens, links, strands, rhythm, parameters, all) into
+//     a bitmask of FIELD_* values.  An empty list selects everything.
+//     Unknown names are ignored.
+//
+
+int HumJsonWriter::parseFields(const string& list) {
+	if (list.empty()) {
+		return FIELD_ALL;
+	}
+	int output = 0;
+	size_t start = 0;
+	while (start <= list.size()) {
+		size_t end = list.find(',', start);
+		if (end == string::npos) {
+			end = list.size();
+		}
+		// trim spaces around the name:
+		size_t a = start;
+		size_t b = end;
+		while ((a < b) && isspace((unsigned char)list[a])) {
+			a++;
+		}
+		while ((b > a) && isspace((unsigned char)list[b-1])) {
+			b--;
+		}
+		string name = list.substr(a, b - a);
+		if (name == "lines") {
+			output |= FIELD_LINES;
+		} else if (name == "tokens") {
+			output |= FIELD_TOKENS;
+		} else if (name == "links") {
+			output |= FIELD_LINKS;
+		} else if (name == "strands") {
+			output |= FIELD_STRANDS;
+		} else if (name == "rhythm") {
+			output |= FIELD_RHYTHM;
+		} else if (name == "parameters") {
+			output |= FIELD_PARAMETERS;
+		} else if (name == "all") {
+			output |= FIELD_ALL;
+		}
+		start = end + 1;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::separate -- Write the comma and indentation needed
+//     before a new value or key.
+//
+
+void HumJsonWriter::separate(void) {
+	if (m_afterKey) {
+		m_afterKey = false;
+		return;
+	}
+	if (m_empty.empty()) {
+		return;
+	}
+	if (m_empty.back()) {
+		m_empty.back() = false;
+	} else {
+		put(',');
+	}
+	newline();
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::newline -- Start a new line indented to the current
+//     nesting level (nothing for compact output).
+//
+
+void HumJsonWriter::newline(void) {
+	if (m_indent.empty()) {
+		return;
+	}
+	put('\n');
+	for (int i=0; i<(int)m_empty.size(); i++) {
+		put(m_indent.data(), m_indent.size());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::put -- Append characters to the output buffer.
+//
+
+void HumJsonWriter::put(char ch) {
+	if (m_used >= m_buffer.size()) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+	}
+	m_buffer[m_used++] = ch;
+}
+
+
+void HumJsonWriter::put(const char* text, size_t count) {
+	if (m_used + count > m_buffer.size()) {
+		m_out.write(m_buffer.data(), m_used);
+		m_used = 0;
+		if (count > m_buffer.size()) {
+			m_out.write(text, count);
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_used, text, count);
+	m_used += count;
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::putInt -- Append an integer in decimal.
+//
+
+void HumJsonWriter::putInt(int value) {
+	char digits[16];
+	int count = 0;
+	unsigned int number = (unsigned int)value;
+	if (value < 0) {
+		put('-');
+		number = 0u - number;
+	}
+	do {
+		digits[count++] = (char)('0' + number % 10);
+		number /= 10;
+	} while (number > 0);
+	char text[16];
+	for (int i=0; i<count; i++) {
+		text[i] = digits[count - 1 - i];
+	}
+	put(text, count);
+}
+
+
+
+//////////////////////////////
+//
+// HumJsonWriter::putEscaped -- Append string contents, escaping quotes,
+//     backslashes and control characters.  Runs of characters which do not
+//     need escaping are copied in one step.  Other bytes are passed
+//     through unchanged (UTF-8 text remains UTF-8).
+//
+
+void HumJsonWriter::putEscaped(const char* text, size_t count) {
+	static const char* hex = "0123456789abcdef";
+	size_t start = 0;
+	for (size_t i=0; i<count; i++) {
+		unsigned char ch = (unsigned char)text[i];
+		if ((ch >= 0x20) && (ch != '"') && (ch != '\\')) {
+			continue;
+		}
+		if (i > start) {
+			put(text + start, i - start);
+		}
+		start = i + 1;
+		switch (ch) {
+			case '"':  put("\\\"", 2); break;
+			case '\\': put("\\\\", 2); break;
+			case '\n': put("\\n", 2);  break;
+			case '\r': put("\\r", 2);  break;
+			case '\t': put("\\t", 2);  break;
+			default:
+				{
+					char code[6] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xf]};
+					put(code, 6);
+				}
+		}
+	}
+	if (count > start) {
+		put(text + start, count - start);
+	}
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
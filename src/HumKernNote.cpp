@@ -0,0 +1,499 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:48:03 PDT 2026
+// Last Modified: Sat Oct 17 19:48:03 PDT 2026
+// Filename:      HumKernNote.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumKernNote.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Single-pass lexer for **kern tokens.
+//
+
+#include "HumKernNote.h"
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumKernNote::getText -- Return the text of the subtoken for the note.
+//     The input is the token that the note was lexed from.
+//
+
+string HumKernNote::getText(const string& token) const {
+	return token.substr(m_start, m_length);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::contains -- Returns true if the pattern occurs in the
+//     subtoken for the note.  The input is the token that the note was
+//     lexed from.
+//
+
+bool HumKernNote::contains(const string& token, const string& pattern) const {
+	size_t loc = token.find(pattern, m_start);
+	if (loc == string::npos) {
+		return false;
+	}
+	return loc + pattern.size() <= (size_t)(m_start + m_length);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getOctave -- Return the octave number of the note
+//     (middle C is the start of the 4th octave), or -1000 if the note
+//     has no pitch or mixes upper and lower case pitch names.
+//
+
+int HumKernNote::getOctave(void) const {
+	if (!hasPitch() || (m_flags & FLAG_MIXED_CASE)) {
+		return -1000;
+	}
+	return m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getBase40 -- Return the base-40 pitch of the note, or
+//     -2000 if there is no pitch.
+//
+
+int HumKernNote::getBase40(void) const {
+	if (!hasPitch()) {
+		return -2000;
+	}
+	static const int pcs[7] = {0, 6, 12, 17, 23, 29, 35};
+	// +2 to make c-flat-flat bottom of octave:
+	return pcs[(int)m_diatonic] + m_accidentals + 2 + 40 * getOctave();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getBase7 -- Return the diatonic pitch of the note, or
+//     -2000 if there is no pitch.
+//
+
+int HumKernNote::getBase7(void) const {
+	if (!hasPitch()) {
+		return -2000;
+	}
+	return m_diatonic + 7 * getOctave();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isAccidentalHidden -- Returns true if the accidental is
+//     followed by 'y' (such as "#y" or "ny"), and the note is not
+//     invisible ("yy").
+//
+
+bool HumKernNote::isAccidentalHidden(void) const {
+	return (m_flags & FLAG_HIDDEN_ACCID) && !(m_flags & FLAG_INVISIBLE);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isNote -- Returns true if the note has a pitch and is
+//     not a rest.
+//
+
+bool HumKernNote::isNote(void) const {
+	return hasPitch() && !isRest();
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::isSecondaryTiedNote -- Returns true if the note has a
+//     pitch, is not a rest, and continues or ends a tie.
+//
+
+bool HumKernNote::isSecondaryTiedNote(void) const {
+	return isNote() && (m_flags & (FLAG_TIE_CONTINUE | FLAG_TIE_END));
+}
+
+
+
+//////////////////////////////
+//
+// HumKernNote::getDuration -- Return the duration of the note in
+//     quarter notes.  Grace notes and notes without a rhythm have a
+//     duration of zero.
+//
+
+HumNum HumKernNote::getDuration(void) const {
+	if (isGrace() || (m_rhythm < 0)) {
+		return 0;
+	}
+	HumNum original;
+	if (m_zeros > 0) {
+		original = 8;
+		for (int i=1; i<m_zeros; i++) {
+			original *= 2;
+		}
+	} else if (m_rhythm == 0) {
+		original = 8;
+	} else {
+		original.setValue(4 * m_rhythmDen, m_rhythm);
+	}
+	HumNum output = original;
+	HumNum dot = original;
+	for (int i=0; i<m_dots; i++) {
+		dot /= 2;
+		output += dot;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::HumKernToken --
+//
+
+HumKernToken::HumKernToken(const string& token) {
+	lex(token);
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::clear --
+//
+
+void HumKernToken::clear(void) {
+	m_notes.clear();
+	m_markers.clear();
+	m_hasRest = false;
+	m_hasPitch = false;
+	m_hasTieContinuation = false;
+	m_stem = '\0';
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::lex -- Read the token in a single pass, storing a
+//     HumKernNote for each space-separated subtoken.
+//
+
+void HumKernToken::lex(const string& token) {
+	clear();
+
+	m_notes.emplace_back();
+	HumKernNote* note = &m_notes.back();
+
+	// rhythm states: 0 = before rhythm, 1 = in rhythm, 2 = after '%',
+	// 3 = in rational rhythm denominator, 4 = after rhythm.
+	int rstate = 0;
+	bool zeros = false;
+	int uc = 0;
+	int lc = 0;
+	int elision = 0;
+	char prev = '\0';
+
+	auto finishNote = [&](int end) {
+		note->m_length = end - note->m_start;
+		if (uc && lc) {
+			note->m_flags |= HumKernNote::FLAG_MIXED_CASE;
+		} else if (uc) {
+			note->m_octave = (signed char)(4 - uc);
+		} else if (lc) {
+			note->m_octave = (signed char)(3 + lc);
+		}
+		if (!zeros) {
+			note->m_zeros = 0;
+		}
+	};
+
+	for (int i=0; i<(int)token.size(); i++) {
+		char ch = token[i];
+
+		if (ch == ' ') {
+			finishNote(i);
+			m_notes.emplace_back();
+			note = &m_notes.back();
+			note->m_start = i + 1;
+			rstate = 0;
+			zeros = false;
+			uc = 0;
+			lc = 0;
+			elision = 0;
+			prev = ch;
+			continue;
+		}
+
+		if ((prev == '#') || (prev == '-') || (prev == 'n')) {
+			note->m_accidentalMark = ch;
+		}
+
+		if ((ch >= '0') && (ch <= '9')) {
+			int digit = ch - '0';
+			if (rstate == 0) {
+				rstate = 1;
+				note->m_rhythm = digit;
+				zeros = (digit == 0);
+				note->m_zeros = zeros ? 1 : 0;
+			} else if (rstate == 1) {
+				if (note->m_rhythm < 100000000) {
+					note->m_rhythm = note->m_rhythm * 10 + digit;
+				}
+				zeros = zeros && (digit == 0);
+				if (zeros && (note->m_zeros < 255)) {
+					note->m_zeros++;
+				}
+			} else if (rstate == 2) {
+				rstate = 3;
+				note->m_rhythmDen = digit;
+			} else if (rstate == 3) {
+				if (note->m_rhythmDen < 100000000) {
+					note->m_rhythmDen = note->m_rhythmDen * 10 + digit;
+				}
+			}
+			elision = 0;
+			prev = ch;
+			continue;
+		} else if (rstate == 1) {
+			rstate = (ch == '%') ? 2 : 4;
+		} else if (rstate == 2) {
+			note->m_rhythmDen = 1;
+			rstate = 4;
+		} else if (rstate == 3) {
+			rstate = 4;
+		}
+
+		switch (ch) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				if (note->m_diatonic < 0) {
+					note->m_diatonic = (signed char)((ch - 'a' + 5) % 7);
+				}
+				m_hasPitch = true;
+				lc++;
+				break;
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				if (note->m_diatonic < 0) {
+					note->m_diatonic = (signed char)((ch - 'A' + 5) % 7);
+				}
+				m_hasPitch = true;
+				uc++;
+				break;
+
+			case 'r':
+				note->m_flags |= HumKernNote::FLAG_REST;
+				m_hasRest = true;
+				break;
+			case 'R':
+				note->m_flags |= HumKernNote::FLAG_UNPITCHED;
+				break;
+
+			case '#':
+				note->m_accidentals++;
+				note->m_accidentalMark = '\0';
+				break;
+			case '-':
+				note->m_accidentals--;
+				note->m_accidentalMark = '\0';
+				break;
+			case 'n':
+				note->m_flags |= HumKernNote::FLAG_NATURAL;
+				note->m_accidentalMark = '\0';
+				break;
+			case 'y':
+				if (prev == 'y') {
+					note->m_flags |= HumKernNote::FLAG_INVISIBLE;
+				} else if ((prev == '#') || (prev == '-') || (prev == 'n')) {
+					note->m_flags |= HumKernNote::FLAG_HIDDEN_ACCID;
+				}
+				break;
+
+			case '.':
+				if (note->m_dots < 255) {
+					note->m_dots++;
+				}
+				break;
+			case 'q':
+			case 'Q':
+				note->m_flags |= HumKernNote::FLAG_GRACE;
+				break;
+
+			case '[':
+				note->m_flags |= HumKernNote::FLAG_TIE_START;
+				break;
+			case '_':
+				note->m_flags |= HumKernNote::FLAG_TIE_CONTINUE;
+				m_hasTieContinuation = true;
+				break;
+			case ']':
+				note->m_flags |= HumKernNote::FLAG_TIE_END;
+				m_hasTieContinuation = true;
+				break;
+
+			case '(':
+			case ')':
+			case '{':
+			case '}':
+			case 'L':
+			case 'J':
+				{
+					Marker marker;
+					marker.m_type = ch;
+					marker.m_elision = (unsigned char)(elision < 255 ? elision : 255);
+					marker.m_note = (short)(m_notes.size() - 1);
+					m_markers.push_back(marker);
+					unsigned char* counter = NULL;
+					switch (ch) {
+						case '(': counter = &note->m_slurStarts;   break;
+						case ')': counter = &note->m_slurEnds;     break;
+						case '{': counter = &note->m_phraseStarts; break;
+						case '}': counter = &note->m_phraseEnds;   break;
+						case 'L': counter = &note->m_beamStarts;   break;
+						case 'J': counter = &note->m_beamEnds;     break;
+					}
+					if (*counter < 255) {
+						(*counter)++;
+					}
+				}
+				break;
+			case 'k':
+			case 'K':
+				if (note->m_hooks < 255) {
+					note->m_hooks++;
+				}
+				break;
+
+			case '/':
+			case '\\':
+				if (!note->m_stem) {
+					note->m_stem = ch;
+				}
+				if (!m_stem) {
+					m_stem = ch;
+				}
+				break;
+
+			case '\'': note->m_articulations |= HumKernNote::ART_STACCATO;      break;
+			case '`':  note->m_articulations |= HumKernNote::ART_STACCATISSIMO; break;
+			case '~':  note->m_articulations |= HumKernNote::ART_TENUTO;        break;
+			case ';':  note->m_articulations |= HumKernNote::ART_FERMATA;       break;
+			case 'o':  note->m_articulations |= HumKernNote::ART_HARMONIC;      break;
+			case ':':  note->m_articulations |= HumKernNote::ART_ARPEGGIO;      break;
+			case 'v':  note->m_articulations |= HumKernNote::ART_UPBOW;         break;
+			case 'u':  note->m_articulations |= HumKernNote::ART_DOWNBOW;       break;
+			case ',':  note->m_articulations |= HumKernNote::ART_BREATH;        break;
+			case '"':  note->m_articulations |= HumKernNote::ART_PIZZICATO;     break;
+			case 'z':  note->m_articulations |= HumKernNote::ART_SFORZANDO;     break;
+			case '^':
+				if (prev == '^') {
+					note->m_articulations &= (unsigned short)~HumKernNote::ART_ACCENT;
+					note->m_articulations |= HumKernNote::ART_MARCATO;
+				} else {
+					note->m_articulations |= HumKernNote::ART_ACCENT;
+				}
+				break;
+
+			case 't': note->m_ornaments |= HumKernNote::ORN_TRILL_MINOR;   break;
+			case 'T': note->m_ornaments |= HumKernNote::ORN_TRILL_MAJOR;   break;
+			case 'm': note->m_ornaments |= HumKernNote::ORN_MORDENT_MINOR; break;
+			case 'M': note->m_ornaments |= HumKernNote::ORN_MORDENT_MAJOR; break;
+			case 'w': note->m_ornaments |= HumKernNote::ORN_LOWER_MINOR;   break;
+			case 'W': note->m_ornaments |= HumKernNote::ORN_LOWER_MAJOR;   break;
+			case 'S': note->m_ornaments |= HumKernNote::ORN_TURN;          break;
+			case '$': note->m_ornaments |= HumKernNote::ORN_INVERTED_TURN; break;
+		}
+
+		elision = (ch == '&') ? elision + 1 : 0;
+		prev = ch;
+	}
+
+	finishNote((int)token.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getNote -- Return the record for a chord note.  An empty
+//     record is returned if the index is out of range.
+//
+
+const HumKernNote& HumKernToken::getNote(int index) const {
+	static const HumKernNote empty;
+	if ((index < 0) || (index >= (int)m_notes.size())) {
+		return empty;
+	}
+	return m_notes[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getMarkerCount -- Return the number of times that a
+//     slur, phrase or beam marker occurs in the token.
+//
+
+int HumKernToken::getMarkerCount(char marker) const {
+	int output = 0;
+	for (int i=0; i<(int)m_markers.size(); i++) {
+		if (m_markers[i].m_type == marker) {
+			output++;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumKernToken::getElisionLevel -- Return the number of '&' characters
+//     before the (index+1)-th occurrence of the marker, or -1 if there
+//     is no such marker.
+//
+
+int HumKernToken::getElisionLevel(char marker, int index) const {
+	if (index < 0) {
+		return -1;
+	}
+	int count = 0;
+	for (int i=0; i<(int)m_markers.size(); i++) {
+		if (m_markers[i].m_type != marker) {
+			continue;
+		}
+		if (count == index) {
+			return m_markers[i].m_elision;
+		}
+		count++;
+	}
+	return -1;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
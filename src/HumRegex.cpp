@@ -147,40 +147,18 @@ void HumRegex::unsetGlobal(void) {
 // HumRegex::search -- Search for the regular expression in the
 //    input string.  Returns the character position + 1 of the first match if any found.
 //    Search results can be accessed with .getSubmatchCount() and .getSubmatch(index).
-//
-//    Warning: a temporary string cannot be used as input to the search function
-//    if you want to call getMatch() later.  If you do a memory leak will occur.
-//    If you have a temporary string, first save it to a variable which remains
-//    in scope while accesssing a match with getMatch().
+//    A copy of the input string is kept for accessing the matches, so
+//    a temporary string can be searched.
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		// return the char+1 position of the first match
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, 0, exp, m_regexflags, m_searchflags);
 }
 
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	auto startit = input.begin() + startindex;
-	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, startindex, exp, m_regexflags, m_searchflags);
 }
 
 
@@ -199,31 +177,15 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, 0, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	auto startit = input.begin() + startindex;
-	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
-	if (!result) {
-		return 0;
-	} else if (m_matches.size() < 1) {
-		return 0;
-	} else {
-		return (int)m_matches.position(0) + 1;
-	}
+	return searchText(input, startindex, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -239,6 +201,104 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 }
 
 
+
+//////////////////////////////
+//
+// HumRegex::searchText -- Search the input string starting at startindex,
+//    and store the matches.  The position of the match is relative to
+//    startindex.
+//
+
+int HumRegex::searchText(const string& input, int startindex, const string& exp,
+		std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	const regex* re = nfa ? NULL : &getRegex(exp, flags);
+	m_input = input;
+	m_begin = startindex;
+	m_captures.clear();
+	if ((startindex < 0) || (startindex > (int)m_input.size())) {
+		m_begin = 0;
+		return 0;
+	}
+
+	if (nfa) {
+		if (!nfa->search(m_input, startindex, startindex, m_captures)) {
+			return 0;
+		}
+	} else {
+		std::smatch matches;
+		auto startit = m_input.cbegin() + startindex;
+		if (!regex_search(startit, m_input.cend(), matches, *re, searchflags)) {
+			return 0;
+		}
+		m_captures.resize(2 * matches.size());
+		for (int i=0; i<(int)matches.size(); i++) {
+			if (matches[i].matched) {
+				m_captures[2*i]   = startindex + (int)matches.position(i);
+				m_captures[2*i+1] = m_captures[2*i] + (int)matches.length(i);
+			} else {
+				m_captures[2*i]   = -1;
+				m_captures[2*i+1] = -1;
+			}
+		}
+	}
+	if (m_captures.empty()) {
+		return 0;
+	}
+	// return the char+1 position of the first match
+	return m_captures[0] - startindex + 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getNfa -- Return the linear-time matcher for the expression,
+//    or NULL if std::regex has to be used for it.  Only the ECMAScript
+//    grammar (with optional icase) is handled by HumRegexNfa.
+//
+
+const HumRegexNfa* HumRegex::getNfa(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_nfaQ && (flags == m_nfaflags) && (exp == m_nfaexp)) {
+		return m_nfa.get();
+	}
+	m_nfaexp   = exp;
+	m_nfaflags = flags;
+	m_nfaQ     = true;
+	auto allowed = std::regex_constants::ECMAScript | std::regex_constants::icase
+			| std::regex_constants::optimize;
+	if (flags & ~allowed) {
+		m_nfa.reset();
+	} else {
+		bool icase = (flags & std::regex_constants::icase) ? true : false;
+		m_nfa = HumRegexNfa::getCompiled(exp, icase);
+	}
+	return m_nfa.get();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getRegex -- Return the std::regex for the expression,
+//    compiling it only if the expression or flags have changed.
+//
+
+const regex& HumRegex::getRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (!m_regexQ || (flags != m_regexexpflags) || (exp != m_regexexp)) {
+		m_regexQ = false;
+		m_regex = regex(exp, flags);
+		m_regexexp = exp;
+		m_regexexpflags = flags;
+		m_regexQ = true;
+	}
+	return m_regex;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // match-related functions
@@ -251,7 +311,7 @@ int HumRegex::search(string* input, int startindex, const string& exp,
 //
 
 int HumRegex::getMatchCount(void) {
-	return (int)m_matches.size();
+	return (int)m_captures.size() / 2;
 }
 
 
@@ -266,10 +326,13 @@ int HumRegex::getMatchCount(void) {
 string HumRegex::getMatch(int index) {
 	if (index < 0) {
 		return "";
-	} if (index >= (int)m_matches.size()) {
+	} if (index >= getMatchCount()) {
+		return "";
+	} if (m_captures[2*index] < 0) {
 		return "";
 	}
-	string output = m_matches.str(index);
+	string output = m_input.substr(m_captures[2*index],
+			m_captures[2*index+1] - m_captures[2*index]);
 	return output;
 }
 
@@ -282,7 +345,7 @@ string HumRegex::getMatch(int index) {
 //
 
 int HumRegex::getMatchInt(int index) {
-	string value = m_matches.str(index);
+	string value = getMatch(index);
 	int output = 0;
 	if (value.size() > 0) {
 		if (isdigit(value[0])) {
@@ -304,7 +367,7 @@ int HumRegex::getMatchInt(int index) {
 //
 
 double HumRegex::getMatchDouble(int index) {
-	string value = m_matches.str(index);
+	string value = getMatch(index);
 	if (value.size() > 0) {
 		return stod(value);
 	} else {
@@ -321,7 +384,10 @@ double HumRegex::getMatchDouble(int index) {
 //
 
 string HumRegex::getPrefix(void) {
-	return m_matches.prefix().str();
+	if (m_captures.empty()) {
+		return "";
+	}
+	return m_input.substr(m_begin, m_captures[0] - m_begin);
 }
 
 
@@ -333,7 +399,10 @@ string HumRegex::getPrefix(void) {
 //
 
 string HumRegex::getSuffix(void) {
-	return m_matches.suffix().str();
+	if (m_captures.empty()) {
+		return "";
+	}
+	return m_input.substr(m_captures[1]);
 }
 
 
@@ -341,11 +410,15 @@ string HumRegex::getSuffix(void) {
 //////////////////////////////
 //
 // HumRegex::getMatchStartIndex -- Get starting index of match in input
-//     search string.
+//     search string.  Submatches which did not participate in the match
+//     start at the end of the search string.
 //
 
 int HumRegex::getMatchStartIndex(int index) {
-	return (int)m_matches.position(index);
+	if ((index < 0) || (index >= getMatchCount()) || (m_captures[2*index] < 0)) {
+		return (int)m_input.size() - m_begin;
+	}
+	return m_captures[2*index] - m_begin;
 }
 
 
@@ -369,7 +442,10 @@ int HumRegex::getMatchEndIndex(int index) {
 //
 
 int HumRegex::getMatchLength(int index) {
-	return (int)m_matches.length(index);
+	if ((index < 0) || (index >= getMatchCount()) || (m_captures[2*index] < 0)) {
+		return 0;
+	}
+	return m_captures[2*index+1] - m_captures[2*index];
 }
 
 
@@ -385,15 +461,14 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	return matchText(input, exp, m_regexflags, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	return matchText(input, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -410,6 +485,23 @@ bool HumRegex::match(const string* input, const string& exp,
 
 
 
+//////////////////////////////
+//
+// HumRegex::matchText -- Match the expression to the entire input string.
+//
+
+bool HumRegex::matchText(const string& input, const string& exp,
+		std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	if (nfa) {
+		return nfa->match(input);
+	}
+	return regex_match(input, getRegex(exp, flags), searchflags);
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // search and replace functions.  Default behavior is to only match
@@ -424,8 +516,7 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	input = replaceText(input, replacement, exp, m_regexflags, m_searchflags);
 	return input;
 }
 
@@ -441,8 +532,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	input = replaceText(input, replacement, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -462,11 +553,8 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	string output;
-	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
-	return output;
+	return replaceText(input, replacement, exp, m_regexflags,
+			std::regex_constants::match_default);
 }
 
 
@@ -481,11 +569,8 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	string output;
-	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
-	return output;
+	return replaceText(input, replacement, exp, getTemporaryRegexFlags(options),
+			getTemporarySearchFlags(options));
 }
 
 
@@ -496,6 +581,120 @@ string HumRegex::replaceCopy(string* input, const string& exp,
 
 
 
+//////////////////////////////
+//
+// HumRegex::replaceText -- Replace the first match (if searchflags
+//    contains format_first_only) or all matches of the expression in the
+//    input string.  The matches are found in the same way as
+//    std::regex_replace: after an empty match, a non-empty match at the
+//    same position is tried before moving forward by one character.
+//
+
+string HumRegex::replaceText(const string& input, const string& replacement,
+		const string& exp, std::regex_constants::syntax_option_type flags,
+		std::regex_constants::match_flag_type searchflags) {
+	const HumRegexNfa* nfa = getNfa(exp, flags);
+	if (!nfa) {
+		return regex_replace(input, getRegex(exp, flags), replacement, searchflags);
+	}
+
+	bool firstonly = (searchflags & std::regex_constants::format_first_only) ? true : false;
+	vector<int> captures;
+	if (!nfa->search(input, 0, 0, captures)) {
+		return input;
+	}
+	string output;
+	int length = (int)input.size();
+	int prefix = 0;
+	bool prevavail = false;
+	while (true) {
+		output.append(input, prefix, captures[0] - prefix);
+		appendFormat(output, replacement, input, captures, prefix);
+		prefix = captures[1];
+		if (firstonly) {
+			break;
+		}
+		int start = captures[1];
+		bool found = false;
+		if (captures[0] == captures[1]) {
+			if (start == length) {
+				break;
+			}
+			found = nfa->search(input, prevavail ? 0 : start, start, captures, true, true);
+			if (!found) {
+				start++;
+			}
+		}
+		if (!found) {
+			prevavail = true;
+			if (!nfa->search(input, 0, start, captures)) {
+				break;
+			}
+		}
+	}
+	output.append(input, prefix, string::npos);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::appendFormat -- Append the replacement text for a match.
+//    $& is the match, $n or $nn a submatch, $` the text between the
+//    previous match (starting at index prefix) and the match, $' the
+//    text after the match, and $$ a dollar sign.
+//
+
+void HumRegex::appendFormat(string& output, const string& format,
+		const string& input, const vector<int>& captures, int prefix) {
+	int count = (int)captures.size() / 2;
+	auto appendMatch = [&](int index) {
+		if (captures[2*index] >= 0) {
+			output.append(input, captures[2*index], captures[2*index+1] - captures[2*index]);
+		}
+	};
+
+	size_t i = 0;
+	while (i < format.size()) {
+		size_t next = format.find('$', i);
+		if (next == string::npos) {
+			output.append(format, i, string::npos);
+			break;
+		}
+		output.append(format, i, next - i);
+		next++;
+		if (next >= format.size()) {
+			output += '$';
+		} else if (format[next] == '$') {
+			output += '$';
+			next++;
+		} else if (format[next] == '&') {
+			appendMatch(0);
+			next++;
+		} else if (format[next] == '`') {
+			output.append(input, prefix, captures[0] - prefix);
+			next++;
+		} else if (format[next] == '\'') {
+			output.append(input, captures[1], string::npos);
+			next++;
+		} else if (isdigit(format[next])) {
+			int number = format[next++] - '0';
+			if ((next < format.size()) && isdigit(format[next])) {
+				number = number * 10 + (format[next++] - '0');
+			}
+			if (number < count) {
+				appendMatch(number);
+			}
+		} else {
+			output += '$';
+		}
+		i = next;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::tr --
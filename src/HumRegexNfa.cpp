@@ -0,0 +1,1228 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 22:05:48 PDT 2026
+// Last Modified: Sat Oct 17 22:05:48 PDT 2026
+// Filename:      HumRegexNfa.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumRegexNfa.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Linear-time regular expression matcher used by HumRegex.
+//
+// References:
+//     https://swtch.com/~rsc/regexp/regexp2.html
+//
+
+#include "HumRegexNfa.h"
+
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+// NFA program instructions:
+enum {
+	NFA_OP_CHAR,    // match character m_x
+	NFA_OP_ANY,     // match any character except \n and \r
+	NFA_OP_CLASS,   // match character in m_classes[m_x]
+	NFA_OP_SPLIT,   // continue at m_x (preferred) and at m_y
+	NFA_OP_JMP,     // continue at m_x
+	NFA_OP_SAVE,    // store position in capture slot m_x
+	NFA_OP_BOL,     // ^
+	NFA_OP_EOL,     // $
+	NFA_OP_WORDB,   // \b
+	NFA_OP_NWORDB,  // \B
+	NFA_OP_MATCH
+};
+
+// Parse tree nodes:
+enum {
+	NFA_NODE_EMPTY,
+	NFA_NODE_CHAR,
+	NFA_NODE_ANY,
+	NFA_NODE_CLASS,
+	NFA_NODE_CAT,
+	NFA_NODE_ALT,
+	NFA_NODE_GROUP,
+	NFA_NODE_REPEAT,
+	NFA_NODE_BOL,
+	NFA_NODE_EOL,
+	NFA_NODE_WORDB,
+	NFA_NODE_NWORDB
+};
+
+// Limits beyond which std::regex is used instead:
+#define NFA_MAX_PROGRAM  2000
+#define NFA_MAX_DEPTH    100
+#define NFA_MAX_REPEAT   1000
+#define NFA_MAX_CACHE    1000
+
+
+//////////////////////////////
+//
+// HumRegexNfa::ThreadList -- List of NFA states active at one input
+//     position, in priority order, with the capture positions of each.
+//
+
+class HumRegexNfa::ThreadList {
+	public:
+		std::vector<int>      m_pcs;
+		std::vector<int>      m_captures;
+		std::vector<unsigned> m_marks;
+		unsigned              m_generation = 0;
+		int                   m_count      = 0;
+
+		void prepare(int size, int slots) {
+			if ((int)m_pcs.size() < size) {
+				m_pcs.resize(size);
+				m_marks.resize(size, 0);
+			}
+			if ((int)m_captures.size() < size * slots + 1) {
+				m_captures.resize(size * slots + 1);
+			}
+			clear();
+		}
+
+		void clear(void) {
+			m_count = 0;
+			if (++m_generation == 0) {
+				std::fill(m_marks.begin(), m_marks.end(), 0);
+				m_generation = 1;
+			}
+		}
+};
+
+
+
+//////////////////////////////
+//
+// nfa_escapeClass -- Characters matched by \d, \D, \w, \W, \s and \S.
+//
+
+static std::bitset<256> nfa_escapeClass(unsigned char ch) {
+	std::bitset<256> output;
+	for (int i=0; i<128; i++) {
+		switch (tolower(ch)) {
+			case 'd':
+				output[i] = isdigit(i) ? true : false;
+				break;
+			case 'w':
+				output[i] = (isalnum(i) || (i == '_')) ? true : false;
+				break;
+			case 's':
+				output[i] = isspace(i) ? true : false;
+				break;
+		}
+	}
+	if (isupper(ch)) {
+		output.flip();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// nfa_hexValue -- Value of a hexadecimal digit, or -1.
+//
+
+static int nfa_hexValue(char ch) {
+	if ((ch >= '0') && (ch <= '9')) {
+		return ch - '0';
+	} else if ((ch >= 'a') && (ch <= 'f')) {
+		return ch - 'a' + 10;
+	} else if ((ch >= 'A') && (ch <= 'F')) {
+		return ch - 'A' + 10;
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// nfa_isWord -- True if the character is matched by \w.
+//
+
+static bool nfa_isWord(char ch) {
+	unsigned char value = (unsigned char)ch;
+	return (value < 128) && (isalnum(value) || (value == '_'));
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::HumRegexNfa -- Constructor.
+//
+
+HumRegexNfa::HumRegexNfa(void) {
+	// do nothing
+}
+
+
+HumRegexNfa::HumRegexNfa(const string& exp, bool icase) {
+	compile(exp, icase);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::clear --
+//
+
+void HumRegexNfa::clear(void) {
+	m_valid     = false;
+	m_icase     = false;
+	m_groups    = 0;
+	m_program.clear();
+	m_classes.clear();
+	m_firstQ    = false;
+	m_firstChar = -1;
+	m_first.reset();
+	m_anchored  = false;
+	m_exp.clear();
+	m_pos       = 0;
+	m_depth     = 0;
+	m_nodes.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::compile -- Compile an ECMAScript regular expression.
+//     Returns false if the expression is not supported (or is invalid),
+//     in which case std::regex has to be used for it.
+//
+
+bool HumRegexNfa::compile(const string& exp, bool icase) {
+	clear();
+	m_icase = icase;
+	m_exp   = exp;
+	int root = parseAlternation();
+	if ((root >= 0) && (m_pos == (int)m_exp.size())) {
+		addInstruction(NFA_OP_SAVE, 0);
+		if (emit(root) && ((int)m_program.size() < NFA_MAX_PROGRAM)) {
+			addInstruction(NFA_OP_SAVE, 1);
+			addInstruction(NFA_OP_MATCH);
+			m_valid = true;
+		}
+	}
+	m_exp.clear();
+	m_nodes.clear();
+	if (!m_valid) {
+		m_program.clear();
+		m_classes.clear();
+		m_groups = 0;
+		return false;
+	}
+	makeStartInfo();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::getCompiled -- Return a compiled expression which can be
+//     shared between HumRegex objects (and threads).  Returns NULL if the
+//     expression is not supported.  The result of compiling is cached
+//     for both supported and unsupported expressions.
+//
+
+std::shared_ptr<const HumRegexNfa> HumRegexNfa::getCompiled(const string& exp,
+		bool icase) {
+	static mutex cacheMutex;
+	static unordered_map<string, std::shared_ptr<const HumRegexNfa>> cache;
+
+	string key;
+	key.reserve(exp.size() + 1);
+	key += icase ? 'i' : 'c';
+	key += exp;
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		auto it = cache.find(key);
+		if (it != cache.end()) {
+			return it->second;
+		}
+	}
+
+	std::shared_ptr<HumRegexNfa> nfa = std::make_shared<HumRegexNfa>();
+	std::shared_ptr<const HumRegexNfa> output;
+	if (nfa->compile(exp, icase)) {
+		output = nfa;
+	}
+
+	lock_guard<mutex> lock(cacheMutex);
+	if (cache.size() >= NFA_MAX_CACHE) {
+		cache.clear();
+	}
+	cache[key] = output;
+	return output;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Parsing functions: each returns a node index, or -1 if the expression
+//    is not supported.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::parseAlternation -- sequence ("|" sequence)*
+//
+
+int HumRegexNfa::parseAlternation(void) {
+	int node = parseSequence();
+	if (node < 0) {
+		return -1;
+	}
+	if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != '|')) {
+		return node;
+	}
+	int alt = makeNode(NFA_NODE_ALT);
+	m_nodes[alt].m_children.push_back(node);
+	while ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '|')) {
+		m_pos++;
+		node = parseSequence();
+		if (node < 0) {
+			return -1;
+		}
+		m_nodes[alt].m_children.push_back(node);
+	}
+	return alt;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseSequence -- Quantified atoms up to "|" or ")".
+//
+
+int HumRegexNfa::parseSequence(void) {
+	int cat = makeNode(NFA_NODE_CAT);
+	while ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] != '|')
+			&& (m_exp[m_pos] != ')')) {
+		int node = parseRepeat();
+		if (node < 0) {
+			return -1;
+		}
+		m_nodes[cat].m_children.push_back(node);
+	}
+	return cat;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseRepeat -- An atom followed by an optional quantifier.
+//
+
+int HumRegexNfa::parseRepeat(void) {
+	int atom = parseAtom();
+	if ((atom < 0) || (m_pos >= (int)m_exp.size())) {
+		return atom;
+	}
+	char ch = m_exp[m_pos];
+	if ((ch != '*') && (ch != '+') && (ch != '?') && (ch != '{')) {
+		return atom;
+	}
+	switch (m_nodes[atom].m_type) {
+		case NFA_NODE_BOL:
+		case NFA_NODE_EOL:
+		case NFA_NODE_WORDB:
+		case NFA_NODE_NWORDB:
+			return -1;
+	}
+
+	int minimum = 0;
+	int maximum = -1;
+	m_pos++;
+	if (ch == '+') {
+		minimum = 1;
+	} else if (ch == '?') {
+		maximum = 1;
+	} else if (ch == '{') {
+		auto getNumber = [&](int& value) {
+			if ((m_pos >= (int)m_exp.size()) || !isdigit(m_exp[m_pos])) {
+				return false;
+			}
+			value = 0;
+			while ((m_pos < (int)m_exp.size()) && isdigit(m_exp[m_pos])) {
+				value = value * 10 + (m_exp[m_pos++] - '0');
+				if (value > NFA_MAX_REPEAT) {
+					return false;
+				}
+			}
+			return true;
+		};
+		if (!getNumber(minimum) || (m_pos >= (int)m_exp.size())) {
+			return -1;
+		}
+		if (m_exp[m_pos] == '}') {
+			maximum = minimum;
+		} else if (m_exp[m_pos] == ',') {
+			m_pos++;
+			if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] != '}')) {
+				if (!getNumber(maximum) || (maximum < minimum)) {
+					return -1;
+				}
+			}
+			if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != '}')) {
+				return -1;
+			}
+		} else {
+			return -1;
+		}
+		m_pos++;
+	}
+
+	bool greedy = true;
+	if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '?')) {
+		greedy = false;
+		m_pos++;
+	}
+	if (m_pos < (int)m_exp.size()) {
+		ch = m_exp[m_pos];
+		if ((ch == '*') || (ch == '+') || (ch == '?') || (ch == '{')) {
+			return -1;
+		}
+	}
+
+	// Optional iterations of an expression which can match an empty string
+	// are handled specially by std::regex:
+	if ((maximum != minimum) && isNullable(atom)) {
+		return -1;
+	}
+	if ((minimum == 1) && (maximum == 1)) {
+		return atom;
+	}
+	int node = makeNode(NFA_NODE_REPEAT);
+	m_nodes[node].m_min    = minimum;
+	m_nodes[node].m_max    = maximum;
+	m_nodes[node].m_greedy = greedy;
+	m_nodes[node].m_children.push_back(atom);
+	return node;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseAtom -- A character, class, group or assertion.
+//
+
+int HumRegexNfa::parseAtom(void) {
+	unsigned char ch = m_exp[m_pos];
+	switch (ch) {
+		case '(':
+			{
+				m_pos++;
+				int group = 0;
+				if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '?')) {
+					// only non-capturing groups (no lookaheads):
+					if ((m_pos + 1 >= (int)m_exp.size()) || (m_exp[m_pos+1] != ':')) {
+						return -1;
+					}
+					m_pos += 2;
+				} else {
+					group = ++m_groups;
+				}
+				// limit recursion:
+				if (m_depth >= NFA_MAX_DEPTH) {
+					return -1;
+				}
+				m_depth++;
+				int inner = parseAlternation();
+				m_depth--;
+				if ((inner < 0) || (m_pos >= (int)m_exp.size()) || (m_exp[m_pos] != ')')) {
+					return -1;
+				}
+				m_pos++;
+				int node = makeNode(NFA_NODE_GROUP, group);
+				m_nodes[node].m_children.push_back(inner);
+				return node;
+			}
+		case '[':
+			return parseBracket();
+		case '\\':
+			return parseEscape();
+		case '.':
+			m_pos++;
+			return makeNode(NFA_NODE_ANY);
+		case '^':
+			m_pos++;
+			return makeNode(NFA_NODE_BOL);
+		case '$':
+			m_pos++;
+			return makeNode(NFA_NODE_EOL);
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+			return -1;
+	}
+	m_pos++;
+	return makeCharacter(ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseEscape -- A backslash sequence outside of brackets.
+//     Backreferences and unknown letter escapes are not supported.
+//
+
+int HumRegexNfa::parseEscape(void) {
+	m_pos++;
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	unsigned char ch = m_exp[m_pos++];
+	switch (ch) {
+		case 'b': return makeNode(NFA_NODE_WORDB);
+		case 'B': return makeNode(NFA_NODE_NWORDB);
+		case 'd': case 'D':
+		case 'w': case 'W':
+		case 's': case 'S':
+			return makeClass(nfa_escapeClass(ch));
+		case 't': return makeCharacter('\t');
+		case 'n': return makeCharacter('\n');
+		case 'v': return makeCharacter('\v');
+		case 'f': return makeCharacter('\f');
+		case 'r': return makeCharacter('\r');
+		case 'x':
+			{
+				if (m_pos + 2 > (int)m_exp.size()) {
+					return -1;
+				}
+				int high = nfa_hexValue(m_exp[m_pos]);
+				int low  = nfa_hexValue(m_exp[m_pos+1]);
+				if ((high < 0) || (low < 0)) {
+					return -1;
+				}
+				m_pos += 2;
+				return makeCharacter((unsigned char)(high * 16 + low));
+			}
+	}
+	if ((ch >= 128) || isalnum(ch)) {
+		return -1;
+	}
+	return makeCharacter(ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseBracket -- A [...] or [^...] character class.
+//
+
+int HumRegexNfa::parseBracket(void) {
+	m_pos++;
+	bool negate = false;
+	if ((m_pos < (int)m_exp.size()) && (m_exp[m_pos] == '^')) {
+		negate = true;
+		m_pos++;
+	}
+	if ((m_pos >= (int)m_exp.size()) || (m_exp[m_pos] == ']')) {
+		return -1;
+	}
+
+	std::bitset<256> set;
+	bool firstQ = true;
+	while (true) {
+		if (m_pos >= (int)m_exp.size()) {
+			return -1;
+		}
+		if (m_exp[m_pos] == ']') {
+			m_pos++;
+			break;
+		}
+		// "-" is only allowed at the start or end of the list, or in a range:
+		bool dashQ = m_exp[m_pos] == '-';
+		if (dashQ && !firstQ && (m_pos + 1 < (int)m_exp.size()) && (m_exp[m_pos+1] != ']')) {
+			return -1;
+		}
+		firstQ = false;
+		bool classQ = false;
+		int low = parseBracketTerm(set, classQ);
+		if (low < 0) {
+			return -1;
+		}
+		bool rangeQ = (m_pos + 1 < (int)m_exp.size()) && (m_exp[m_pos] == '-')
+				&& (m_exp[m_pos+1] != ']');
+		if (classQ) {
+			if (rangeQ) {
+				return -1;
+			}
+			continue;
+		}
+		if (!rangeQ) {
+			set.set(low);
+			continue;
+		}
+		if (dashQ) {
+			return -1;
+		}
+		m_pos++;
+		int high = parseBracketTerm(set, classQ);
+		if ((high < 0) || classQ || (low > high) || (high >= 128)) {
+			return -1;
+		}
+		for (int i=low; i<=high; i++) {
+			set.set(i);
+		}
+	}
+
+	if (m_icase) {
+		for (int i='a'; i<='z'; i++) {
+			if (set[i] || set[i-32]) {
+				set.set(i);
+				set.set(i-32);
+			}
+		}
+	}
+	if (negate) {
+		set.flip();
+	}
+	return makeClass(set);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::parseBracketTerm -- A single character (return value) or
+//     class escape (added to set, classQ = true) inside of brackets.
+//     Returns -1 if not supported.
+//
+
+int HumRegexNfa::parseBracketTerm(std::bitset<256>& set, bool& classQ) {
+	classQ = false;
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	unsigned char ch = m_exp[m_pos++];
+	if (ch == '[') {
+		// POSIX classes such as [:alpha:]:
+		if ((m_pos < (int)m_exp.size()) && ((m_exp[m_pos] == ':')
+				|| (m_exp[m_pos] == '.') || (m_exp[m_pos] == '='))) {
+			return -1;
+		}
+		return ch;
+	}
+	if (ch != '\\') {
+		return ch;
+	}
+	if (m_pos >= (int)m_exp.size()) {
+		return -1;
+	}
+	ch = m_exp[m_pos++];
+	switch (ch) {
+		case 'd': case 'D':
+		case 'w': case 'W':
+		case 's': case 'S':
+			set |= nfa_escapeClass(ch);
+			classQ = true;
+			return 0;
+		case 't': return '\t';
+		case 'n': return '\n';
+		case 'v': return '\v';
+		case 'f': return '\f';
+		case 'r': return '\r';
+		case 'x':
+			{
+				if (m_pos + 2 > (int)m_exp.size()) {
+					return -1;
+				}
+				int high = nfa_hexValue(m_exp[m_pos]);
+				int low  = nfa_hexValue(m_exp[m_pos+1]);
+				if ((high < 0) || (low < 0)) {
+					return -1;
+				}
+				m_pos += 2;
+				return high * 16 + low;
+			}
+	}
+	if ((ch >= 128) || isalnum(ch)) {
+		return -1;
+	}
+	return ch;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeNode -- Add a node to the parse tree.
+//
+
+int HumRegexNfa::makeNode(int type, int value) {
+	m_nodes.emplace_back();
+	m_nodes.back().m_type  = type;
+	m_nodes.back().m_value = value;
+	return (int)m_nodes.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeClass -- Add a character class node.
+//
+
+int HumRegexNfa::makeClass(const std::bitset<256>& set) {
+	m_classes.push_back(set);
+	return makeNode(NFA_NODE_CLASS, (int)m_classes.size() - 1);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeCharacter -- Add a character node (a class when
+//     ignoring the case of a letter).
+//
+
+int HumRegexNfa::makeCharacter(unsigned char ch) {
+	if (m_icase && (ch < 128) && isalpha(ch)) {
+		std::bitset<256> set;
+		set.set(tolower(ch));
+		set.set(toupper(ch));
+		return makeClass(set);
+	}
+	return makeNode(NFA_NODE_CHAR, ch);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::isNullable -- True if the node can match an empty string.
+//
+
+bool HumRegexNfa::isNullable(int node) const {
+	const Node& item = m_nodes[node];
+	switch (item.m_type) {
+		case NFA_NODE_CHAR:
+		case NFA_NODE_ANY:
+		case NFA_NODE_CLASS:
+			return false;
+		case NFA_NODE_CAT:
+			for (int i=0; i<(int)item.m_children.size(); i++) {
+				if (!isNullable(item.m_children[i])) {
+					return false;
+				}
+			}
+			return true;
+		case NFA_NODE_ALT:
+			for (int i=0; i<(int)item.m_children.size(); i++) {
+				if (isNullable(item.m_children[i])) {
+					return true;
+				}
+			}
+			return false;
+		case NFA_NODE_GROUP:
+			return isNullable(item.m_children[0]);
+		case NFA_NODE_REPEAT:
+			return (item.m_min == 0) || isNullable(item.m_children[0]);
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Compiling functions.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::addInstruction -- Returns the index of the instruction.
+//
+
+int HumRegexNfa::addInstruction(int op, int x, int y) {
+	Instruction inst;
+	inst.m_op = (unsigned char)op;
+	inst.m_x  = x;
+	inst.m_y  = y;
+	m_program.push_back(inst);
+	return (int)m_program.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::emit -- Generate the program for a parse tree node.
+//     Returns false if the program becomes too large.  Counted
+//     repetitions are expanded into copies of the repeated node.
+//
+
+bool HumRegexNfa::emit(int node) {
+	if ((int)m_program.size() >= NFA_MAX_PROGRAM) {
+		return false;
+	}
+	const Node& item = m_nodes[node];
+	const vector<int>& children = item.m_children;
+	switch (item.m_type) {
+		case NFA_NODE_EMPTY:
+			return true;
+		case NFA_NODE_CHAR:
+			addInstruction(NFA_OP_CHAR, item.m_value);
+			return true;
+		case NFA_NODE_ANY:
+			addInstruction(NFA_OP_ANY);
+			return true;
+		case NFA_NODE_CLASS:
+			addInstruction(NFA_OP_CLASS, item.m_value);
+			return true;
+		case NFA_NODE_BOL:
+			addInstruction(NFA_OP_BOL);
+			return true;
+		case NFA_NODE_EOL:
+			addInstruction(NFA_OP_EOL);
+			return true;
+		case NFA_NODE_WORDB:
+			addInstruction(NFA_OP_WORDB);
+			return true;
+		case NFA_NODE_NWORDB:
+			addInstruction(NFA_OP_NWORDB);
+			return true;
+
+		case NFA_NODE_CAT:
+			for (int i=0; i<(int)children.size(); i++) {
+				if (!emit(children[i])) {
+					return false;
+				}
+			}
+			return true;
+
+		case NFA_NODE_ALT:
+			{
+				vector<int> jumps;
+				for (int i=0; i<(int)children.size() - 1; i++) {
+					int split = addInstruction(NFA_OP_SPLIT, (int)m_program.size() + 1);
+					if (!emit(children[i])) {
+						return false;
+					}
+					jumps.push_back(addInstruction(NFA_OP_JMP));
+					m_program[split].m_y = (int)m_program.size();
+				}
+				if (!emit(children.back())) {
+					return false;
+				}
+				for (int i=0; i<(int)jumps.size(); i++) {
+					m_program[jumps[i]].m_x = (int)m_program.size();
+				}
+				return true;
+			}
+
+		case NFA_NODE_GROUP:
+			if (item.m_value > 0) {
+				addInstruction(NFA_OP_SAVE, 2 * item.m_value);
+			}
+			if (!emit(children[0])) {
+				return false;
+			}
+			if (item.m_value > 0) {
+				addInstruction(NFA_OP_SAVE, 2 * item.m_value + 1);
+			}
+			return true;
+
+		case NFA_NODE_REPEAT:
+			{
+				bool greedy = item.m_greedy;
+				if ((item.m_max < 0) && (item.m_min == 0)) {
+					// x*: L1: split L2, L3; L2: x; jmp L1; L3:
+					int split = addInstruction(NFA_OP_SPLIT);
+					if (!emit(children[0])) {
+						return false;
+					}
+					addInstruction(NFA_OP_JMP, split);
+					int out = (int)m_program.size();
+					m_program[split].m_x = greedy ? split + 1 : out;
+					m_program[split].m_y = greedy ? out : split + 1;
+					return true;
+				}
+				if (item.m_max < 0) {
+					// x{n,}: x{n-1} L1: x; split L1, L2; L2:
+					for (int i=0; i<item.m_min - 1; i++) {
+						if (!emit(children[0])) {
+							return false;
+						}
+					}
+					int loop = (int)m_program.size();
+					if (!emit(children[0])) {
+						return false;
+					}
+					int out = (int)m_program.size() + 1;
+					addInstruction(NFA_OP_SPLIT, greedy ? loop : out, greedy ? out : loop);
+					return true;
+				}
+				// x{n,m}: x{n} followed by (m-n) nested optional copies of x.
+				for (int i=0; i<item.m_min; i++) {
+					if (!emit(children[0])) {
+						return false;
+					}
+				}
+				vector<int> splits;
+				for (int i=item.m_min; i<item.m_max; i++) {
+					splits.push_back(addInstruction(NFA_OP_SPLIT));
+					if (!emit(children[0])) {
+						return false;
+					}
+				}
+				int out = (int)m_program.size();
+				for (int i=0; i<(int)splits.size(); i++) {
+					m_program[splits[i]].m_x = greedy ? splits[i] + 1 : out;
+					m_program[splits[i]].m_y = greedy ? out : splits[i] + 1;
+				}
+				return true;
+			}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::makeStartInfo -- Find the characters which can start a
+//     match, and whether matches must start at the beginning of the input.
+//
+
+void HumRegexNfa::makeStartInfo(void) {
+	int size = (int)m_program.size();
+	vector<char> visited;
+	vector<int> stack;
+
+	for (int pass=0; pass<2; pass++) {
+		// pass 0: first characters; pass 1: anchoring
+		visited.assign(size, 0);
+		stack.assign(1, 0);
+		if (pass == 0) {
+			m_first.reset();
+			m_firstQ = true;
+		} else {
+			m_anchored = true;
+		}
+		while (!stack.empty()) {
+			int pc = stack.back();
+			stack.pop_back();
+			if (visited[pc]) {
+				continue;
+			}
+			visited[pc] = 1;
+			const Instruction& inst = m_program[pc];
+			switch (inst.m_op) {
+				case NFA_OP_JMP:
+					stack.push_back(inst.m_x);
+					break;
+				case NFA_OP_SPLIT:
+					stack.push_back(inst.m_y);
+					stack.push_back(inst.m_x);
+					break;
+				case NFA_OP_BOL:
+					if (pass == 0) {
+						stack.push_back(pc + 1);
+					}
+					break;
+				case NFA_OP_SAVE:
+				case NFA_OP_EOL:
+				case NFA_OP_WORDB:
+				case NFA_OP_NWORDB:
+					stack.push_back(pc + 1);
+					break;
+				case NFA_OP_CHAR:
+					m_first.set(inst.m_x);
+					m_anchored = false;
+					break;
+				case NFA_OP_ANY:
+					{
+						std::bitset<256> any;
+						any.set();
+						any.reset('\n');
+						any.reset('\r');
+						m_first |= any;
+					}
+					m_anchored = false;
+					break;
+				case NFA_OP_CLASS:
+					m_first |= m_classes[inst.m_x];
+					m_anchored = false;
+					break;
+				case NFA_OP_MATCH:
+					m_firstQ = false;
+					m_anchored = false;
+					break;
+			}
+		}
+	}
+
+	if (m_firstQ && m_first.all()) {
+		m_firstQ = false;
+	}
+	m_firstChar = -1;
+	if (m_firstQ && (m_first.count() == 1)) {
+		for (int i=0; i<256; i++) {
+			if (m_first[i]) {
+				m_firstChar = i;
+				break;
+			}
+		}
+	}
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Matching functions.
+//
+
+//////////////////////////////
+//
+// HumRegexNfa::search -- Find the leftmost match at or after index start.
+//
+
+bool HumRegexNfa::search(const string& input, int begin, int start,
+		vector<int>& captures, bool continuous, bool notnull) const {
+	if (!m_valid || (start < begin) || (start > (int)input.size())) {
+		captures.clear();
+		return false;
+	}
+	int slots = 2 * (m_groups + 1);
+	captures.resize(slots);
+	if (!run(input, begin, start, captures.data(), slots, continuous, notnull, false)) {
+		captures.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::match -- True if the expression matches all of the input.
+//
+
+bool HumRegexNfa::match(const string& input) const {
+	if (!m_valid) {
+		return false;
+	}
+	int dummy = 0;
+	return run(input, 0, 0, &dummy, 0, true, false, true);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::run -- Pike VM: simulate all NFA threads in lockstep over
+//     the input, so each character is examined once per program
+//     instruction at most.  Threads are kept in priority order and the
+//     lower-priority threads are cut off when one reaches the match
+//     state, which gives the same match as a backtracking search.
+//     slots == 0 is used when no capture positions are needed.
+//
+
+bool HumRegexNfa::run(const string& input, int begin, int start,
+		int* captures, int slots, bool continuous, bool notnull,
+		bool fullQ) const {
+	// Working storage is kept for each thread to avoid allocations:
+	static thread_local ThreadList lists[2];
+	static thread_local vector<int> fresh;
+
+	if (m_anchored && (start != begin)) {
+		return false;
+	}
+	int size   = (int)m_program.size();
+	int length = (int)input.size();
+	ThreadList* clist = &lists[0];
+	ThreadList* nlist = &lists[1];
+	clist->prepare(size, slots);
+	nlist->prepare(size, slots);
+	if ((int)fresh.size() < slots + 1) {
+		fresh.resize(slots + 1);
+	}
+	bool anchored = continuous || m_anchored;
+	bool matched  = false;
+
+	for (int pos=start; pos<=length; pos++) {
+		if (!matched && ((pos == start) || !anchored)) {
+			// Add a thread for a match starting at pos (with the
+			// lowest priority):
+			if ((clist->m_count == 0) && !anchored) {
+				pos = findStart(input, pos);
+				if (pos > length) {
+					break;
+				}
+				clist->clear();
+			}
+			if (!m_firstQ || ((pos < length) && m_first[(unsigned char)input[pos]])) {
+				std::fill(fresh.begin(), fresh.begin() + slots, -1);
+				addThread(*clist, 0, fresh.data(), slots, input, begin, pos);
+			}
+		}
+		if (clist->m_count == 0) {
+			if (matched || anchored) {
+				break;
+			}
+			continue;
+		}
+
+		nlist->clear();
+		int ch = pos < length ? (unsigned char)input[pos] : -1;
+		for (int i=0; i<clist->m_count; i++) {
+			int pc = clist->m_pcs[i];
+			int* tcaps = clist->m_captures.data() + i * slots;
+			const Instruction& inst = m_program[pc];
+			switch (inst.m_op) {
+				case NFA_OP_CHAR:
+					if (ch == inst.m_x) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_ANY:
+					if ((ch >= 0) && (ch != '\n') && (ch != '\r')) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_CLASS:
+					if ((ch >= 0) && m_classes[inst.m_x][ch]) {
+						addThread(*nlist, pc + 1, tcaps, slots, input, begin, pos + 1);
+					}
+					break;
+				case NFA_OP_MATCH:
+					if (notnull && (slots > 0) && (tcaps[0] == pos)) {
+						break;
+					}
+					if (fullQ && (pos != length)) {
+						break;
+					}
+					matched = true;
+					std::copy(tcaps, tcaps + slots, captures);
+					// cut off lower-priority threads:
+					i = clist->m_count;
+					break;
+			}
+		}
+		std::swap(clist, nlist);
+	}
+
+	return matched;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::addThread -- Add the thread for pc to the list, following
+//     jumps, splits (in priority order), capture saves and assertions.
+//     Each program location is added once per input position.
+//
+
+void HumRegexNfa::addThread(ThreadList& list, int pc, int* captures,
+		int slots, const string& input, int begin, int pos) const {
+	if (list.m_marks[pc] == list.m_generation) {
+		return;
+	}
+	list.m_marks[pc] = list.m_generation;
+	const Instruction& inst = m_program[pc];
+	switch (inst.m_op) {
+		case NFA_OP_JMP:
+			addThread(list, inst.m_x, captures, slots, input, begin, pos);
+			return;
+		case NFA_OP_SPLIT:
+			addThread(list, inst.m_x, captures, slots, input, begin, pos);
+			addThread(list, inst.m_y, captures, slots, input, begin, pos);
+			return;
+		case NFA_OP_SAVE:
+			if (inst.m_x < slots) {
+				int old = captures[inst.m_x];
+				captures[inst.m_x] = pos;
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+				captures[inst.m_x] = old;
+			} else {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_BOL:
+			if (pos == begin) {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_EOL:
+			if (pos == (int)input.size()) {
+				addThread(list, pc + 1, captures, slots, input, begin, pos);
+			}
+			return;
+		case NFA_OP_WORDB:
+		case NFA_OP_NWORDB:
+			{
+				bool left  = (pos > begin) && nfa_isWord(input[pos-1]);
+				bool right = (pos < (int)input.size()) && nfa_isWord(input[pos]);
+				if ((left != right) == (inst.m_op == NFA_OP_WORDB)) {
+					addThread(list, pc + 1, captures, slots, input, begin, pos);
+				}
+			}
+			return;
+	}
+	int index = list.m_count++;
+	list.m_pcs[index] = pc;
+	std::copy(captures, captures + slots, list.m_captures.data() + index * slots);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegexNfa::findStart -- Return the first position at or after pos
+//     where a match can start, or input.size() + 1 if there is none.
+//
+
+int HumRegexNfa::findStart(const string& input, int pos) const {
+	if (!m_firstQ) {
+		return pos;
+	}
+	int length = (int)input.size();
+	if (m_firstChar >= 0) {
+		if (pos >= length) {
+			return length + 1;
+		}
+		const char* found = (const char*)std::memchr(input.data() + pos,
+				m_firstChar, length - pos);
+		return found ? (int)(found - input.data()) : length + 1;
+	}
+	for (int i=pos; i<length; i++) {
+		if (m_first[(unsigned char)input[i]]) {
+			return i;
+		}
+	}
+	return length + 1;
+}
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -0,0 +1,592 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 21:12:36 PDT 2026
+// Last Modified: Sat Oct 17 21:12:36 PDT 2026
+// Filename:      HumSegmentIndex.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumSegmentIndex.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Byte-offset index of the segments in a concatenated
+//                Humdrum file.
+//
+
+#include "HumRegex.h"
+#include "HumSegmentIndex.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::HumSegmentIndex --
+//
+
+HumSegmentIndex::HumSegmentIndex(void) {
+	// do nothing
+}
+
+HumSegmentIndex::HumSegmentIndex(const string& filename) {
+	load(filename);
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::clear --
+//
+
+void HumSegmentIndex::clear(void) {
+	m_filename.clear();
+	m_filesize = 0;
+	m_referencesQ = false;
+	m_segments.clear();
+	m_universals.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getIndexFilename -- Return the name of the sidecar
+//    index file for a data file.
+//
+
+string HumSegmentIndex::getIndexFilename(const string& filename) {
+	return filename + ".segidx";
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::build -- Scan a data file and store the byte offset,
+//    length and name of each segment.  Segments are split at !!!!SEGMENT:
+//    records, and at exclusive interpretation lines after the first one
+//    in a segment (for files concatenated without !!!!SEGMENT: records),
+//    in the same way as HumdrumFileStream::getFile(), which also
+//    removes universal comments at the start of a segment and prepends
+//    them to the segments that follow; the universal comments in effect
+//    at the start of each segment are stored with it.  If referencesQ is
+//    true, then the keys of the reference records in each segment are
+//    also stored.  Returns false if the file cannot be read.
+//
+
+bool HumSegmentIndex::build(const string& filename, bool referencesQ) {
+	ifstream input(filename, ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	bool status = build(input, referencesQ);
+	m_filename = filename;
+	return status;
+}
+
+
+bool HumSegmentIndex::build(istream& input, bool referencesQ) {
+	clear();
+	m_referencesQ = referencesQ;
+
+	// The first segment starts at the beginning of the file, even if
+	// there is no !!!!SEGMENT: record.
+	m_segments.emplace_back();
+
+	vector<string> universals;  // universal comments from previous segments
+	vector<string> current;     // universal comments in current segment
+	bool foundUniversalQ = false;
+	bool dataFoundQ      = false;
+	bool bufferEmptyQ    = true;
+	bool starstarFoundQ  = false;
+	bool starminusFoundQ = false;
+
+	string line;
+	long long offset = 0;
+	while (getline(input, line)) {
+		long long linestart = offset;
+		offset += line.size();
+		if (!input.eof()) {
+			offset++;
+		}
+
+		if (line.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0) {
+			if (!bufferEmptyQ) {
+				// Start a new segment.  The !!!!SEGMENT: line is not
+				// processed further in HumdrumFileStream::getFile().
+				m_segments.back().m_length = linestart - m_segments.back().m_offset;
+				if (foundUniversalQ) {
+					universals = current;
+				}
+				addSegment(linestart, line);
+				m_segments.back().m_universal = addUniversals(universals);
+				foundUniversalQ = false;
+				dataFoundQ      = false;
+				starstarFoundQ  = false;
+				starminusFoundQ = false;
+				continue;
+			}
+			// First record of the first segment.
+			long long start = m_segments.back().m_offset;
+			m_segments.pop_back();
+			addSegment(start, line);
+		}
+
+		if (line.compare(0, 2, "**") == 0) {
+			if (starstarFoundQ) {
+				// Start an unnamed segment.  The ** line is the first
+				// line of the new segment in getFile().
+				m_segments.back().m_length = linestart - m_segments.back().m_offset;
+				if (foundUniversalQ) {
+					universals = current;
+				}
+				m_segments.emplace_back();
+				m_segments.back().m_offset = linestart;
+				m_segments.back().m_universal = addUniversals(universals);
+				foundUniversalQ = false;
+				dataFoundQ      = false;
+				starminusFoundQ = false;
+				continue;
+			}
+			starstarFoundQ = true;
+		}
+
+		if ((line.size() > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !dataFoundQ &&
+				(line.compare(0, strlen("!!!!filter:"), "!!!!filter:") != 0) &&
+				(line.compare(0, strlen("!!!!SEGMENT:"), "!!!!SEGMENT:") != 0)) {
+			if (!foundUniversalQ) {
+				current.clear();
+				foundUniversalQ = true;
+			}
+			current.push_back(line);
+		} else if ((starminusFoundQ || !starstarFoundQ) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// Filename list entry (not part of the segment).
+			continue;
+		} else {
+			if (line.compare(0, 2, "*-") == 0) {
+				starminusFoundQ = true;
+			}
+			dataFoundQ = true;
+			bufferEmptyQ = false;
+		}
+
+		if (!referencesQ || (line.compare(0, 3, "!!!") != 0)) {
+			continue;
+		}
+		size_t start = line.find_first_not_of('!');
+		size_t colon = line.find(':');
+		if ((start > 4) || (colon == string::npos) || (colon <= start)) {
+			continue;
+		}
+		string key = line.substr(start, colon - start);
+		if ((key == "SEGMENT") || (key.find_first_of(" \t") != string::npos)) {
+			continue;
+		}
+		if (!hasReferenceKey(getSize() - 1, key)) {
+			m_segments.back().m_keys.push_back(key);
+		}
+	}
+
+	m_segments.back().m_length = offset - m_segments.back().m_offset;
+	m_filesize = offset;
+	if ((m_segments.size() == 1) && (offset == 0)) {
+		// empty file
+		m_segments.clear();
+	}
+	makeNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addSegment -- Add a segment starting with the given
+//    !!!!SEGMENT: line.
+//
+
+void HumSegmentIndex::addSegment(long long offset, const string& line) {
+	m_segments.emplace_back();
+	Segment& segment = m_segments.back();
+	segment.m_offset = offset;
+	HumRegex hre;
+	if (hre.search(line, R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*?)\s*$)")) {
+		if (hre.getMatchLength(1) > 0) {
+			segment.m_level = hre.getMatchInt(1);
+		}
+		segment.m_name = hre.getMatch(2);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::addUniversals -- Return the index of a list of
+//    universal comments, adding it if it is different from the last one.
+//    Returns -1 for an empty list.
+//
+
+int HumSegmentIndex::addUniversals(const vector<string>& universals) {
+	if (universals.empty()) {
+		return -1;
+	}
+	if (m_universals.empty() || (m_universals.back() != universals)) {
+		m_universals.push_back(universals);
+	}
+	return (int)m_universals.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::makeNameIndex -- Map segment names to segment indexes.
+//
+
+void HumSegmentIndex::makeNameIndex(void) {
+	m_names.clear();
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if (!m_segments[i].m_name.empty()) {
+			m_names.emplace(m_segments[i].m_name, i);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::load -- Read the sidecar index file of a data file.  If
+//     there is no index file, or the data file size has changed since it
+//     was written, or it does not contain the reference keys when
+//     referencesQ is true, then the data file is scanned and a new index
+//     file is written.  Returns false if the data file cannot be read.
+//
+
+bool HumSegmentIndex::load(const string& filename, bool referencesQ) {
+	string indexname = getIndexFilename(filename);
+	ifstream input(filename, ios::binary | ios::ate);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	long long filesize = (long long)input.tellg();
+	input.close();
+
+	if (readIndex(indexname) && (m_filesize == filesize) &&
+			(m_referencesQ || !referencesQ)) {
+		m_filename = filename;
+		return true;
+	}
+
+	if (!build(filename, referencesQ)) {
+		return false;
+	}
+	// The index can be used even if the sidecar file cannot be written:
+	writeIndex(indexname);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::writeIndex -- Write the index as a sidecar file.  The
+//    file is tab-separated text:
+//
+//    humsegmentindex  1
+//    size             <data file size>
+//    references       <0 or 1>
+//    universal        <list index>  <universal comment>
+//    segment          <offset>  <length>  <level>  <universal list>  <name>  <reference keys ...>
+//
+
+bool HumSegmentIndex::writeIndex(const string& indexname) const {
+	ofstream output(indexname, ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	return writeIndex(output);
+}
+
+
+bool HumSegmentIndex::writeIndex(ostream& output) const {
+	output << "humsegmentindex\t1\n";
+	output << "size\t" << m_filesize << "\n";
+	output << "references\t" << (m_referencesQ ? 1 : 0) << "\n";
+	for (int i=0; i<(int)m_universals.size(); i++) {
+		for (int j=0; j<(int)m_universals[i].size(); j++) {
+			output << "universal\t" << i << "\t" << m_universals[i][j] << "\n";
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		const Segment& segment = m_segments[i];
+		output << "segment\t" << segment.m_offset;
+		output << "\t" << segment.m_length;
+		output << "\t" << segment.m_level;
+		output << "\t" << segment.m_universal;
+		output << "\t" << segment.m_name;
+		for (int j=0; j<(int)segment.m_keys.size(); j++) {
+			output << "\t" << segment.m_keys[j];
+		}
+		output << "\n";
+	}
+	output.flush();
+	return output.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::readIndex -- Read a sidecar index file.  Returns false
+//    if the file cannot be read or is not a segment index.
+//
+
+bool HumSegmentIndex::readIndex(const string& indexname) {
+	ifstream input(indexname, ios::binary);
+	if (!input.is_open()) {
+		clear();
+		return false;
+	}
+	bool status = readIndex(input);
+	string suffix = getIndexFilename("");
+	if (status && (indexname.size() > suffix.size()) &&
+			(indexname.compare(indexname.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+		m_filename = indexname.substr(0, indexname.size() - suffix.size());
+	}
+	return status;
+}
+
+
+bool HumSegmentIndex::readIndex(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line != "humsegmentindex\t1")) {
+		return false;
+	}
+	vector<string> fields;
+	try {
+		while (getline(input, line)) {
+			if (line.compare(0, 10, "universal\t") == 0) {
+				// The comment may contain tabs.
+				size_t tab = line.find('\t', 10);
+				if (tab == string::npos) {
+					clear();
+					return false;
+				}
+				int index = stoi(line.substr(10, tab - 10));
+				if (index < 0) {
+					clear();
+					return false;
+				} else if (index >= (int)m_universals.size()) {
+					m_universals.resize(index + 1);
+				}
+				m_universals[index].push_back(line.substr(tab + 1));
+				continue;
+			}
+
+			fields.clear();
+			stringstream ss(line);
+			string field;
+			while (getline(ss, field, '\t')) {
+				fields.push_back(field);
+			}
+			if (fields.empty()) {
+				continue;
+			} else if ((fields[0] == "size") && (fields.size() == 2)) {
+				m_filesize = stoll(fields[1]);
+			} else if ((fields[0] == "references") && (fields.size() == 2)) {
+				m_referencesQ = fields[1] == "1";
+			} else if ((fields[0] == "segment") && (fields.size() >= 5)) {
+				m_segments.emplace_back();
+				Segment& segment = m_segments.back();
+				segment.m_offset    = stoll(fields[1]);
+				segment.m_length    = stoll(fields[2]);
+				segment.m_level     = stoi(fields[3]);
+				segment.m_universal = stoi(fields[4]);
+				if (fields.size() > 5) {
+					segment.m_name = fields[5];
+				}
+				segment.m_keys.assign(fields.begin() + min((int)fields.size(), 6), fields.end());
+			} else {
+				clear();
+				return false;
+			}
+		}
+	} catch (const std::exception&) {
+		// malformed number
+		clear();
+		return false;
+	}
+
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if ((m_segments[i].m_universal < -1) ||
+				(m_segments[i].m_universal >= (int)m_universals.size())) {
+			clear();
+			return false;
+		}
+	}
+	makeNameIndex();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getSegment -- Return the index of the first segment
+//    with the given name, or -1 if there is no such segment.
+//
+
+int HumSegmentIndex::getSegment(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getOffset -- Return the byte offset of a segment in
+//    the data file.
+//
+
+long long HumSegmentIndex::getOffset(int index) const {
+	return m_segments.at(index).m_offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getLength -- Return the number of bytes in a segment.
+//
+
+long long HumSegmentIndex::getLength(int index) const {
+	return m_segments.at(index).m_length;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getName -- Return the name of a segment from its
+//    !!!!SEGMENT: record (empty if there is no record).
+//
+
+const string& HumSegmentIndex::getName(int index) const {
+	return m_segments.at(index).m_name;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getLevel -- Return the level of a segment from its
+//    !!!!SEGMENT: record (such as 1 for !!!!SEGMENT+1:).
+//
+
+int HumSegmentIndex::getLevel(int index) const {
+	return m_segments.at(index).m_level;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getUniversals -- Return the universal comments from
+//    previous segments that apply to a segment.
+//
+
+const vector<string>& HumSegmentIndex::getUniversals(int index) const {
+	static const vector<string> empty;
+	int universal = m_segments.at(index).m_universal;
+	if (universal < 0) {
+		return empty;
+	}
+	return m_universals[universal];
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getReferenceKeys -- Return the keys of the reference
+//    records in a segment (if the index was built with reference keys).
+//
+
+const vector<string>& HumSegmentIndex::getReferenceKeys(int index) const {
+	return m_segments.at(index).m_keys;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::hasReferenceKey -- Returns true if the segment contains
+//    a reference record with the given key.
+//
+
+bool HumSegmentIndex::hasReferenceKey(int index, const string& key) const {
+	const vector<string>& keys = m_segments.at(index).m_keys;
+	for (int i=0; i<(int)keys.size(); i++) {
+		if (keys[i] == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumSegmentIndex::getText -- Read the contents of a segment from the data
+//    file.  Returns false if the segment cannot be read.
+//
+
+bool HumSegmentIndex::getText(istream& input, int index, string& text) const {
+	text.clear();
+	if ((index < 0) || (index >= getSize())) {
+		return false;
+	}
+	const Segment& segment = m_segments[index];
+	input.clear();
+	input.seekg(segment.m_offset);
+	if (!input) {
+		return false;
+	}
+	text.resize((size_t)segment.m_length);
+	if (segment.m_length > 0) {
+		input.read(&text[0], segment.m_length);
+	}
+	if (input.gcount() != segment.m_length) {
+		text.clear();
+		return false;
+	}
+	return true;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
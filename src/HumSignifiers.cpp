@@ -12,6 +12,10 @@
 
 #include "HumSignifiers.h"
 
+#include <utility>
+
+using namespace std;
+
 namespace hum {
 
 // START_MERGE
@@ -28,6 +32,23 @@ HumSignifiers::HumSignifiers(void) {
 
 
 
+//////////////////////////////
+//
+// HumSignifiers::HumSignifiers -- Copy constructor (the signifier
+//    list is duplicated) and move constructor (the list is transferred).
+//
+
+HumSignifiers::HumSignifiers(const HumSignifiers& signifiers) {
+	*this = signifiers;
+}
+
+
+HumSignifiers::HumSignifiers(HumSignifiers&& signifiers) noexcept {
+	*this = std::move(signifiers);
+}
+
+
+
 //////////////////////////////
 //
 // HumSignifiers::~HumSignifier --
@@ -39,6 +60,44 @@ HumSignifiers::~HumSignifiers() {
 
 
 
+//////////////////////////////
+//
+// HumSignifiers::operator= -- Copy and move assignment.
+//
+
+HumSignifiers& HumSignifiers::operator=(const HumSignifiers& signifiers) {
+	if (this == &signifiers) {
+		return *this;
+	}
+	clear();
+	m_signifiers.reserve(signifiers.m_signifiers.size());
+	for (int i=0; i<(int)signifiers.m_signifiers.size(); i++) {
+		m_signifiers.push_back(new HumSignifier(*signifiers.m_signifiers[i]));
+	}
+	m_kernLinkIndex  = signifiers.m_kernLinkIndex;
+	m_kernAboveIndex = signifiers.m_kernAboveIndex;
+	m_kernBelowIndex = signifiers.m_kernBelowIndex;
+	return *this;
+}
+
+
+HumSignifiers& HumSignifiers::operator=(HumSignifiers&& signifiers) noexcept {
+	if (this == &signifiers) {
+		return *this;
+	}
+	clear();
+	m_signifiers.swap(signifiers.m_signifiers);
+	m_kernLinkIndex  = signifiers.m_kernLinkIndex;
+	m_kernAboveIndex = signifiers.m_kernAboveIndex;
+	m_kernBelowIndex = signifiers.m_kernBelowIndex;
+	signifiers.m_kernLinkIndex  = -1;
+	signifiers.m_kernAboveIndex = -1;
+	signifiers.m_kernBelowIndex = -1;
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumSignifiers::clear --
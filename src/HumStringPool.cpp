@@ -0,0 +1,109 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 22:05:19 PDT 2026
+// Last Modified: Sat Oct 17 22:05:19 PDT 2026
+// Filename:      HumStringPool.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumStringPool.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Thread-safe pool of shared immutable strings.
+//
+
+#include "HumStringPool.h"
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumStringPool::HumStringPool --
+//
+
+HumStringPool::HumStringPool(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::~HumStringPool --
+//
+
+HumStringPool::~HumStringPool() {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::intern -- Return a pointer to the pooled copy of the
+//    given string, adding it to the pool if it is not already there.
+//    Elements of an unordered_set are not moved when the set grows, so
+//    the pointer remains valid.
+//
+
+const string* HumStringPool::intern(const string& text) {
+	lock_guard<mutex> lock(m_mutex);
+	auto result = m_strings.insert(text);
+	if (result.second) {
+		m_textsize += text.size();
+	}
+	return &(*result.first);
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::find -- Return a pointer to the pooled copy of the
+//    given string, or NULL if it is not in the pool.
+//
+
+const string* HumStringPool::find(const string& text) const {
+	lock_guard<mutex> lock(m_mutex);
+	auto it = m_strings.find(text);
+	if (it == m_strings.end()) {
+		return NULL;
+	}
+	return &(*it);
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::getSize -- Return the number of strings in the pool.
+//
+
+int HumStringPool::getSize(void) const {
+	lock_guard<mutex> lock(m_mutex);
+	return (int)m_strings.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumStringPool::getTextSize -- Return the total number of characters
+//    in the strings of the pool.
+//
+
+size_t HumStringPool::getTextSize(void) const {
+	lock_guard<mutex> lock(m_mutex);
+	return m_textsize;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
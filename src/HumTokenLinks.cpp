@@ -0,0 +1,157 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:12:40 PDT 2026
+// Last Modified: Sat Oct 17 19:12:40 PDT 2026
+// Filename:      HumTokenLinks.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumTokenLinks.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   List of links from a token to the next or previous tokens
+//                in its spine, with inline storage for a single link.
+//
+
+#include "HumTokenLinks.h"
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumTokenLinks::HumTokenLinks -- Copy constructor.
+//
+
+HumTokenLinks::HumTokenLinks(const HumTokenLinks& links) {
+	*this = links;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::~HumTokenLinks -- Deconstructor.
+//
+
+HumTokenLinks::~HumTokenLinks() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::operator= -- Copy the links of another list.
+//
+
+HumTokenLinks& HumTokenLinks::operator=(const HumTokenLinks& links) {
+	if (this == &links) {
+		return *this;
+	}
+	clear();
+	reserve(links.m_size);
+	const HTp* source = links.data();
+	HTp* target = data();
+	for (int i=0; i<links.m_size; i++) {
+		target[i] = source[i];
+	}
+	m_size = links.m_size;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::clear -- Remove all links, and free the array if the
+//    list had more than one link.
+//
+
+void HumTokenLinks::clear(void) {
+	if (m_capacity > 1) {
+		delete [] m_array;
+		m_capacity = 1;
+	}
+	m_single = NULL;
+	m_size = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::resize -- Change the number of links.  New links are
+//    set to NULL.
+//
+
+void HumTokenLinks::resize(int count) {
+	if (count < 0) {
+		count = 0;
+	}
+	reserve(count);
+	HTp* links = data();
+	for (int i=m_size; i<count; i++) {
+		links[i] = NULL;
+	}
+	m_size = count;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::push_back -- Append a link to the list.
+//
+
+void HumTokenLinks::push_back(HTp token) {
+	if (m_size == m_capacity) {
+		reserve(m_capacity * 2);
+	}
+	data()[m_size++] = token;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::toVector -- Return a copy of the links as a vector.
+//
+
+vector<HTp> HumTokenLinks::toVector(void) const {
+	return vector<HTp>(begin(), end());
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::reserve -- Make space for at least the given number
+//    of links.  Existing links are kept.
+//
+
+void HumTokenLinks::reserve(int count) {
+	if (count <= m_capacity) {
+		return;
+	}
+	HTp* newarray = new HTp[count];
+	const HTp* oldarray = data();
+	for (int i=0; i<m_size; i++) {
+		newarray[i] = oldarray[i];
+	}
+	if (m_capacity > 1) {
+		delete [] m_array;
+	}
+	m_array = newarray;
+	m_capacity = count;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -0,0 +1,608 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 02:41:17 PDT 2026
+// Last Modified: Sun Oct 18 02:41:17 PDT 2026
+// Filename:      HumWordIndex.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumWordIndex.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Index of the lyric words in a Humdrum file.
+//
+
+#include "HumWordIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumWordIndex::HumWordIndex --
+//
+
+HumWordIndex::HumWordIndex(void) {
+	// do nothing
+}
+
+HumWordIndex::HumWordIndex(HumdrumFile& infile) {
+	build(infile);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::clear --
+//
+
+void HumWordIndex::clear(void) {
+	m_name.clear();
+	m_linecount = 0;
+	m_words.clear();
+	m_sorted.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::build -- Index the words in the **silbe spines of a file,
+//    or in the **text spines if there are no **silbe spines.  Returns
+//    false if the file has no lyric spines.
+//
+
+bool HumWordIndex::build(HumdrumFile& infile) {
+	clear();
+	m_name = infile.getFilename();
+	m_linecount = infile.getLineCount();
+	vector<HTp> textspines;
+	infile.getSpineStartList(textspines, "**silbe");
+	if (textspines.empty()) {
+		infile.getSpineStartList(textspines, "**text");
+	}
+	for (int i=0; i<(int)textspines.size(); i++) {
+		addSpine(textspines[i]);
+	}
+	sortKeys();
+	return !textspines.empty();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::addSpine -- Add the words in a spine.  A syllable
+//    starting with "-" continues the previous word in the spine.
+//
+
+void HumWordIndex::addSpine(HTp starttoken) {
+	int lastword = -1;
+	HTp tok = starttoken->getNextToken();
+	while (tok != NULL) {
+		if (tok->empty() || tok->isNull() || !tok->isData()) {
+			tok = tok->getNextToken();
+			continue;
+		}
+		if (tok->at(0) == '-') {
+			if (lastword >= 0) {
+				string& text = m_words[lastword].m_text;
+				text.append(*tok, 1, string::npos);
+				if (!text.empty() && (text.back() == '-')) {
+					text.pop_back();
+				}
+			}
+			tok = tok->getNextToken();
+			continue;
+		}
+		if (lastword >= 0) {
+			m_words[lastword].m_nextline  = tok->getLineIndex();
+			m_words[lastword].m_nextfield = tok->getFieldIndex();
+		}
+		m_words.emplace_back();
+		Word& word = m_words.back();
+		word.m_line  = tok->getLineIndex();
+		word.m_field = tok->getFieldIndex();
+		word.m_track = tok->getTrack();
+		word.m_text  = *tok;
+		if (!word.m_text.empty() && (word.m_text.back() == '-')) {
+			word.m_text.pop_back();
+		}
+		lastword = (int)m_words.size() - 1;
+		tok = tok->getNextToken();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::sortKeys -- Normalize the words and sort them.
+//
+
+void HumWordIndex::sortKeys(void) {
+	m_sorted.clear();
+	m_sorted.reserve(m_words.size());
+	for (int i=0; i<(int)m_words.size(); i++) {
+		if (m_words[i].m_key.empty()) {
+			m_words[i].m_key = normalize(m_words[i].m_text);
+		}
+		if (!m_words[i].m_key.empty()) {
+			m_sorted.push_back(i);
+		}
+	}
+	stable_sort(m_sorted.begin(), m_sorted.end(), [&](int a, int b) {
+		return m_words[a].m_key < m_words[b].m_key;
+	});
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::normalize -- Convert text into an index key: letters are
+//    lower case and without diacritics (Latin-1 and Latin Extended-A
+//    characters, combining marks and HTML-style entities such as &eacute;),
+//    and punctuation is removed.  Other UTF-8 characters are kept.  If
+//    wildcardsQ is true, "*" and "?" are also kept.
+//
+
+string HumWordIndex::normalize(const string& text, bool wildcardsQ) {
+	// Base letters for U+00C0 to U+00FF ('.' = remove, '1' = "ae",
+	// '2' = "th", '3' = "ss"):
+	static const char* latin1 =
+		"aaaaaa1ceeeeiiiidnooooo.ouuuuy23"
+		"aaaaaa1ceeeeiiiidnooooo.ouuuuy2y";
+	// Base letters for U+0100 to U+017F ('4' = "ij", '5' = "oe"):
+	static const char* latinA =
+		"aaaaaaccccccccddddeeeeeeeeeegggg"
+		"gggghhhhiiiiiiiiii44jjkkklllllll"
+		"lllnnnnnnnnnoooooo55rrrrrrssssss"
+		"ssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+	string output;
+	output.reserve(text.size());
+	int size = (int)text.size();
+	for (int i=0; i<size; i++) {
+		unsigned char ch = (unsigned char)text[i];
+		if (ch < 0x80) {
+			if (isalnum(ch)) {
+				output += (char)tolower(ch);
+			} else if (wildcardsQ && ((ch == '*') || (ch == '?'))) {
+				output += (char)ch;
+			} else if (ch == '&') {
+				// &eacute; style entity:
+				size_t end = text.find(';', i);
+				if ((end != string::npos) && (end - i < 10) && (end - i > 2)) {
+					string name = text.substr(i + 1, end - i - 1);
+					if (name == "szlig") {
+						output += "ss";
+						i = (int)end;
+					} else if ((name == "aelig") || (name == "AElig")) {
+						output += "ae";
+						i = (int)end;
+					} else if ((name == "oelig") || (name == "OElig")) {
+						output += "oe";
+						i = (int)end;
+					} else if (isalpha((unsigned char)name[0])) {
+						static const char* marks[] = {"acute", "grave", "uml", "circ",
+								"tilde", "cedil", "ring", "slash", "caron", "macr", NULL};
+						for (int j=0; marks[j]; j++) {
+							if (name.compare(1, string::npos, marks[j]) == 0) {
+								output += (char)tolower((unsigned char)name[0]);
+								i = (int)end;
+								break;
+							}
+						}
+					}
+				}
+			}
+			continue;
+		}
+
+		// UTF-8 character:
+		int count = 1;
+		int code = 0;
+		if ((ch & 0xe0) == 0xc0) {
+			count = 2;
+			code = ch & 0x1f;
+		} else if ((ch & 0xf0) == 0xe0) {
+			count = 3;
+			code = ch & 0x0f;
+		} else if ((ch & 0xf8) == 0xf0) {
+			count = 4;
+			code = ch & 0x07;
+		} else {
+			// invalid lead byte
+			continue;
+		}
+		if (i + count > size) {
+			break;
+		}
+		for (int j=1; j<count; j++) {
+			code = (code << 6) | ((unsigned char)text[i+j] & 0x3f);
+		}
+
+		char base = 0;
+		if ((code >= 0xc0) && (code <= 0xff)) {
+			base = latin1[code - 0xc0];
+		} else if ((code >= 0x100) && (code <= 0x17f)) {
+			base = latinA[code - 0x100];
+		} else if ((code >= 0x300) && (code <= 0x36f)) {
+			// combining diacritic
+			base = '.';
+		} else if ((code < 0xc0) || ((code >= 0x2000) && (code <= 0x206f))) {
+			// Latin-1 and general punctuation
+			base = '.';
+		}
+
+		switch (base) {
+			case 0:   output.append(text, i, count); break;
+			case '.': break;
+			case '1': output += "ae"; break;
+			case '2': output += "th"; break;
+			case '3': output += "ss"; break;
+			case '4': output += "ij"; break;
+			case '5': output += "oe"; break;
+			default:  output += base;
+		}
+		i += count - 1;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getRange -- Return the range [first, last) in the sorted
+//    word list of keys starting with the given prefix.
+//
+
+void HumWordIndex::getRange(const string& prefix, int& first, int& last) const {
+	auto begin = lower_bound(m_sorted.begin(), m_sorted.end(), prefix,
+		[&](int index, const string& value) {
+			return m_words[index].m_key < value;
+		});
+	auto end = begin;
+	while ((end != m_sorted.end()) &&
+			(m_words[*end].m_key.compare(0, prefix.size(), prefix) == 0)) {
+		end++;
+	}
+	first = (int)(begin - m_sorted.begin());
+	last  = (int)(end - m_sorted.begin());
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::find -- Look up a query word: a query ending in "*" with
+//    no other wildcards is a prefix search, a query containing "*" (any
+//    characters) or "?" (one character) is a wildcard search, and anything
+//    else is an exact search.  The query is normalized the same way as the
+//    indexed words.  Returns the number of matches.
+//
+
+int HumWordIndex::find(vector<int>& matches, const string& query) const {
+	string key = normalize(query, true);
+	size_t wild = key.find_first_of("*?");
+	if (wild == string::npos) {
+		return findExact(matches, key);
+	}
+	if ((wild == key.size() - 1) && (key.back() == '*')) {
+		key.pop_back();
+		return findPrefix(matches, key);
+	}
+	return findWildcard(matches, key);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findExact -- Find words with the given normalized form.
+//
+
+int HumWordIndex::findExact(vector<int>& matches, const string& word) const {
+	matches.clear();
+	if (word.empty()) {
+		return 0;
+	}
+	auto range = equal_range(m_sorted.begin(), m_sorted.end(), -1,
+		[&](int a, int b) {
+			const string& akey = (a < 0) ? word : m_words[a].m_key;
+			const string& bkey = (b < 0) ? word : m_words[b].m_key;
+			return akey < bkey;
+		});
+	matches.assign(range.first, range.second);
+	// Equal keys are already in file order.
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findPrefix -- Find words starting with the given
+//     normalized text.  An empty prefix matches all words.
+//
+
+int HumWordIndex::findPrefix(vector<int>& matches, const string& prefix) const {
+	matches.clear();
+	int first;
+	int last;
+	getRange(prefix, first, last);
+	matches.assign(m_sorted.begin() + first, m_sorted.begin() + last);
+	sort(matches.begin(), matches.end());
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::findWildcard -- Find words matching a normalized pattern
+//     containing "*" and "?" wildcards.  Only words starting with the
+//     text before the first wildcard are checked.
+//
+
+int HumWordIndex::findWildcard(vector<int>& matches, const string& pattern) const {
+	matches.clear();
+	string prefix = pattern.substr(0, pattern.find_first_of("*?"));
+	int first;
+	int last;
+	getRange(prefix, first, last);
+	for (int i=first; i<last; i++) {
+		if (wildcardMatch(pattern.c_str(), m_words[m_sorted[i]].m_key.c_str())) {
+			matches.push_back(m_sorted[i]);
+		}
+	}
+	sort(matches.begin(), matches.end());
+	return (int)matches.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::wildcardMatch -- Match text against a pattern where "*"
+//     matches any sequence of characters and "?" matches one (UTF-8)
+//     character.
+//
+
+bool HumWordIndex::wildcardMatch(const char* pattern, const char* text) {
+	const char* star = NULL;
+	const char* resume = NULL;
+	while (*text) {
+		if (*pattern == '?') {
+			pattern++;
+			text++;
+			while (((unsigned char)*text & 0xc0) == 0x80) {
+				text++;
+			}
+		} else if (*pattern == '*') {
+			star = pattern++;
+			resume = text;
+		} else if (*pattern == *text) {
+			pattern++;
+			text++;
+		} else if (star) {
+			pattern = star + 1;
+			text = ++resume;
+		} else {
+			return false;
+		}
+	}
+	while (*pattern == '*') {
+		pattern++;
+	}
+	return *pattern == '\0';
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getWord -- Return the word as written in the file, with
+//     the syllables joined.
+//
+
+const string& HumWordIndex::getWord(int index) const {
+	return m_words.at(index).m_text;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getKey -- Return the normalized word.
+//
+
+const string& HumWordIndex::getKey(int index) const {
+	return m_words.at(index).m_key;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getTrack -- Return the track of the spine containing
+//     the word.
+//
+
+int HumWordIndex::getTrack(int index) const {
+	return m_words.at(index).m_track;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getLineIndex -- Return the line index of the first
+//     syllable of the word.
+//
+
+int HumWordIndex::getLineIndex(int index) const {
+	return m_words.at(index).m_line;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getFieldIndex -- Return the field index of the first
+//     syllable of the word.
+//
+
+int HumWordIndex::getFieldIndex(int index) const {
+	return m_words.at(index).m_field;
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getStartToken -- Return the token of the first syllable
+//     of the word in the indexed file, or NULL if the location is not in
+//     the file.
+//
+
+HTp HumWordIndex::getStartToken(HumdrumFile& infile, int index) const {
+	const Word& word = m_words.at(index);
+	if ((word.m_line < 0) || (word.m_line >= infile.getLineCount())) {
+		return NULL;
+	}
+	if ((word.m_field < 0) || (word.m_field >= infile[word.m_line].getFieldCount())) {
+		return NULL;
+	}
+	return infile.token(word.m_line, word.m_field);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::getNextToken -- Return the token of the first syllable
+//     of the next word in the same spine, or NULL if this is the last word.
+//
+
+HTp HumWordIndex::getNextToken(HumdrumFile& infile, int index) const {
+	const Word& word = m_words.at(index);
+	if ((word.m_nextline < 0) || (word.m_nextline >= infile.getLineCount())) {
+		return NULL;
+	}
+	if ((word.m_nextfield < 0) || (word.m_nextfield >= infile[word.m_nextline].getFieldCount())) {
+		return NULL;
+	}
+	return infile.token(word.m_nextline, word.m_nextfield);
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::writeIndex -- Write the index as tab-separated text.
+//     Several indexes can be written one after another into the same
+//     stream:
+//
+//    humwordindex  1
+//    name          <filename>
+//    lines         <line count>
+//    word          <line>  <field>  <next line>  <next field>  <track>  <key>  <word>
+//    end
+//
+
+bool HumWordIndex::writeIndex(ostream& output) const {
+	output << "humwordindex\t1\n";
+	output << "name\t" << m_name << "\n";
+	output << "lines\t" << m_linecount << "\n";
+	for (int i=0; i<(int)m_words.size(); i++) {
+		const Word& word = m_words[i];
+		output << "word\t" << word.m_line;
+		output << "\t" << word.m_field;
+		output << "\t" << word.m_nextline;
+		output << "\t" << word.m_nextfield;
+		output << "\t" << word.m_track;
+		output << "\t" << word.m_key;
+		output << "\t" << word.m_text;
+		output << "\n";
+	}
+	output << "end\n";
+	return output.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumWordIndex::readIndex -- Read the next index from a stream.  Returns
+//    false at the end of the stream or if the input is not a word index.
+//
+
+bool HumWordIndex::readIndex(istream& input) {
+	clear();
+	string line;
+	if (!getline(input, line) || (line != "humwordindex\t1")) {
+		return false;
+	}
+	vector<string> fields;
+	try {
+		while (getline(input, line)) {
+			if (line == "end") {
+				sortKeys();
+				return true;
+			}
+			fields.clear();
+			size_t start = 0;
+			while (true) {
+				size_t tab = line.find('\t', start);
+				if (tab == string::npos) {
+					fields.push_back(line.substr(start));
+					break;
+				}
+				fields.push_back(line.substr(start, tab - start));
+				start = tab + 1;
+			}
+			if ((fields[0] == "name") && (fields.size() == 2)) {
+				m_name = fields[1];
+			} else if ((fields[0] == "lines") && (fields.size() == 2)) {
+				m_linecount = stoi(fields[1]);
+			} else if ((fields[0] == "word") && (fields.size() == 8)) {
+				m_words.emplace_back();
+				Word& word = m_words.back();
+				word.m_line      = stoi(fields[1]);
+				word.m_field     = stoi(fields[2]);
+				word.m_nextline  = stoi(fields[3]);
+				word.m_nextfield = stoi(fields[4]);
+				word.m_track     = stoi(fields[5]);
+				word.m_key       = fields[6];
+				word.m_text      = fields[7];
+			} else {
+				clear();
+				return false;
+			}
+		}
+	} catch (const std::exception&) {
+		// malformed number
+		clear();
+		return false;
+	}
+	// missing "end" line
+	clear();
+	return false;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
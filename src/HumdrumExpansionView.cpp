@@ -0,0 +1,344 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 17:20:31 PDT 2026
+// Last Modified: Sat Oct 17 17:20:31 PDT 2026
+// Filename:      HumdrumExpansionView.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumExpansionView.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read-only view of a HumdrumFile in the order given by
+//                an expansion list such as *>[A,A,B].
+//
+
+#include "HumdrumExpansionView.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::HumdrumExpansionView --
+//
+
+HumdrumExpansionView::HumdrumExpansionView(void) {
+	// do nothing
+}
+
+HumdrumExpansionView::HumdrumExpansionView(HumdrumFile& infile,
+		const string& variant) {
+	analyze(infile, variant);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::clear -- Remove the view of the file.  The
+//    setting for keeping expansion lists is not changed.
+//
+
+void HumdrumExpansionView::clear(void) {
+	m_infile = NULL;
+	m_expandedQ = false;
+	m_lines.clear();
+	m_sections.clear();
+	m_shifts.clear();
+	m_scoreDuration = 0;
+	m_sequence.clear();
+	m_sequenceLine.clear();
+	m_sequenceStart.clear();
+	m_sequenceEnd.clear();
+	m_footerStart = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::analyze -- Build the expanded line order for
+//    the file.  The label sequence is taken from the realization string
+//    if it is not empty, otherwise from the first *>variant[...] line
+//    in the file.  Returns false if no label sequence was found, in
+//    which case the view contains the lines of the file in their
+//    original order.  Lines containing *thru are not included in the
+//    view, and expansion-list lines are only included in an expanded
+//    view if setKeepLists(true) was called.  Labels in the sequence
+//    that are not in the file are kept in the sequence list with no
+//    lines (see hasSequenceLabel()).
+//
+
+bool HumdrumExpansionView::analyze(HumdrumFile& infile, const string& variant,
+		const string& realization) {
+	clear();
+	m_infile = &infile;
+	int lineCount = infile.getLineCount();
+	m_lines.reserve(lineCount);
+	m_sections.reserve(lineCount);
+
+	if (!realization.empty()) {
+		getLabelSequence(m_sequence, realization);
+		m_expandedQ = true;
+	} else {
+		m_expandedQ = findLabelSequence(infile, variant) >= 0;
+	}
+
+	if (!m_expandedQ) {
+		m_shifts.push_back(0);
+		addLines(0, lineCount, 0, false);
+		m_footerStart = (int)m_lines.size();
+		m_scoreDuration = infile.getScoreDuration();
+		return false;
+	}
+
+	// Find the labeled sections and the end of the data.
+	vector<string> labels;
+	vector<int> labellines;
+	int footer = -1;
+	for (int i=0; i<lineCount; i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		HTp token = infile.token(i, 0);
+		if (*token == "*-") {
+			footer = i;
+			continue;
+		}
+		if (token->compare(0, 2, "*>") != 0) {
+			continue;
+		}
+		if (token->find('[') != string::npos) {
+			continue;
+		}
+		if (token->find(']') != string::npos) {
+			continue;
+		}
+		labels.push_back(token->substr(2));
+		labellines.push_back(i);
+	}
+	if (footer < 0) {
+		footer = lineCount;
+	}
+
+	auto timeAt = [&](int line) -> HumNum {
+		if (line >= lineCount) {
+			return infile.getScoreDuration();
+		}
+		return infile[line].getDurationFromStart();
+	};
+
+	int headerEnd = labellines.empty() ? 0 : labellines[0];
+	m_shifts.push_back(0);
+	addLines(0, headerEnd, 0, !m_keepQ);
+	HumNum current = timeAt(headerEnd);
+
+	int count = (int)m_sequence.size();
+	m_sequenceLine.resize(count, -1);
+	m_sequenceStart.resize(count, 0);
+	m_sequenceEnd.resize(count, 0);
+	for (int i=0; i<count; i++) {
+		int index = -1;
+		for (int j=0; j<(int)labels.size(); j++) {
+			if (labels[j] == m_sequence[i]) {
+				index = j;
+				break;
+			}
+		}
+		m_sequenceStart[i] = (int)m_lines.size();
+		if (index < 0) {
+			m_shifts.push_back(current);
+			m_sequenceEnd[i] = m_sequenceStart[i];
+			continue;
+		}
+		int startline = labellines[index];
+		int endline = index + 1 < (int)labellines.size() ? labellines[index+1] : footer;
+		m_sequenceLine[i] = startline;
+		HumNum starttime = timeAt(startline);
+		m_shifts.push_back(current - starttime);
+		addLines(startline, endline, i + 1, !m_keepQ);
+		m_sequenceEnd[i] = (int)m_lines.size();
+		current += timeAt(endline) - starttime;
+	}
+
+	m_footerStart = (int)m_lines.size();
+	m_shifts.push_back(current - timeAt(footer));
+	addLines(footer, lineCount, count + 1, !m_keepQ);
+	m_scoreDuration = current + infile.getScoreDuration() - timeAt(footer);
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::operator[] -- Return the line of the original
+//    file at the given position in the expanded order.
+//
+
+HumdrumLine& HumdrumExpansionView::operator[](int index) const {
+	return (*m_infile)[m_lines[index]];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getDurationFromStart -- Return the start time of
+//    the line in the expanded score.
+//
+
+HumNum HumdrumExpansionView::getDurationFromStart(int index) const {
+	return (*m_infile)[m_lines[index]].getDurationFromStart()
+			+ m_shifts[m_sections[index]];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getDuration -- Return the duration of the line,
+//    which is the same as in the original file.
+//
+
+HumNum HumdrumExpansionView::getDuration(int index) const {
+	return (*m_infile)[m_lines[index]].getDuration();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getSectionIndex -- Return the index in the label
+//    sequence for the given line in the view, or -1 if the line is in
+//    the header or footer.
+//
+
+int HumdrumExpansionView::getSectionIndex(int index) const {
+	if (!m_expandedQ) {
+		return -1;
+	}
+	int section = m_sections[index];
+	if ((section == 0) || (section == (int)m_shifts.size() - 1)) {
+		return -1;
+	}
+	return section - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::isFooter -- Return true if the line is in the
+//    footer of an expanded view (the data termination line and after).
+//
+
+bool HumdrumExpansionView::isFooter(int index) const {
+	if (!m_expandedQ) {
+		return false;
+	}
+	return m_sections[index] == (int)m_shifts.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::findLabelSequence -- Find the first
+//    *>variant[...] line in the file and store its label sequence.
+//    Returns the line index of the expansion list, or -1 if not found.
+//
+
+int HumdrumExpansionView::findLabelSequence(HumdrumFile& infile,
+		const string& variant) {
+	string labelsearch = "*>";
+	labelsearch += variant;
+	labelsearch += "[";
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		HTp token = infile.token(i, 0);
+		if (token->compare(0, labelsearch.size(), labelsearch) != 0) {
+			continue;
+		}
+		getLabelSequence(m_sequence, token->substr(labelsearch.size()));
+		return i;
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::addLines -- Add the lines from startline up to
+//    (but not including) endline to the view.  If filter is true,
+//    expansion-list lines are skipped.
+//
+
+void HumdrumExpansionView::addLines(int startline, int endline, int section,
+		bool filter) {
+	HumdrumFile& infile = *m_infile;
+	for (int i=startline; i<endline; i++) {
+		if (infile[i].isInterpretation()) {
+			HTp token = infile.token(i, 0);
+			if (*token == "*thru") {
+				continue;
+			}
+			if (filter && isExpansionList(token)) {
+				continue;
+			}
+		}
+		m_lines.push_back(i);
+		m_sections.push_back(section);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::isExpansionList -- Return true if the token
+//    is an expansion list such as *>[A,A,B] or *>norep[A,B].
+//
+
+bool HumdrumExpansionView::isExpansionList(HTp token) {
+	if (token->compare(0, 2, "*>") != 0) {
+		return false;
+	}
+	return token->find('[') != string::npos;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumExpansionView::getLabelSequence -- Split an expansion list
+//    such as "A,A,B]" into its labels.
+//
+
+void HumdrumExpansionView::getLabelSequence(vector<string>& labelsequence,
+		const string& astring) {
+	const char* ignorecharacters = ", [] ";
+	size_t start = astring.find_first_not_of(ignorecharacters);
+	while (start != string::npos) {
+		size_t end = astring.find_first_of(ignorecharacters, start);
+		labelsequence.push_back(astring.substr(start, end - start));
+		start = astring.find_first_not_of(ignorecharacters, end);
+	}
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -13,6 +13,9 @@
 
 #include "HumdrumFile.h"
 #include "Convert.h"
+#include "HumJsonWriter.h"
+
+#include <utility>
 
 using namespace std;
 
@@ -53,6 +56,58 @@ HumdrumFile::~HumdrumFile() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFile::HumdrumFile -- Copy and move constructors.
+//
+
+HumdrumFile::HumdrumFile(HumdrumFile& infile) :
+		HUMDRUMFILE_PARENT(infile) {
+	// do nothing
+}
+
+
+HumdrumFile::HumdrumFile(HumdrumFile&& infile) noexcept :
+		HUMDRUMFILE_PARENT(std::move(infile)) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFile::operator= -- Copy and move assignment.
+//
+
+HumdrumFile& HumdrumFile::operator=(HumdrumFile& infile) {
+	HUMDRUMFILE_PARENT::operator=(infile);
+	return *this;
+}
+
+
+HumdrumFile& HumdrumFile::operator=(HumdrumFile&& infile) noexcept {
+	HUMDRUMFILE_PARENT::operator=(std::move(infile));
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFile::clone -- Return a duplicate of the file, including its
+//     analyzed structure, without reparsing the text of the file.  Use
+//     this to fork a parsed score so that several filters can be applied
+//     to independent copies of it.
+//
+
+HumdrumFile HumdrumFile::clone(void) const {
+	HumdrumFile output;
+	output.cloneFrom(*this);
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFile::printXml -- Print a HumdrumFile object in XML format.
@@ -131,6 +186,115 @@ ostream& HumdrumFile::printXml(ostream& out, int level,
 
 
 
+//////////////////////////////
+//
+// HumdrumFile::printJson -- Print the analyzed structure of a HumdrumFile
+//     object in JSON format.  The fields string is a comma-separated list
+//     of content to include: lines, tokens, links, strands, rhythm and
+//     parameters (all content if empty).  An empty indent string prints
+//     compact JSON.  Durations are [numerator, denominator] arrays, and
+//     IDs are the same as the XML IDs from printXml().
+// default value: out = cout
+// default value: fields = ""
+// default value: indent = tab character
+//
+
+ostream& HumdrumFile::printJson(ostream& out, const string& fields,
+		const string& indent) {
+	HumJsonWriter json(out, indent);
+	json.setIdPrefix(getXmlIdPrefix());
+	printJson(json, HumJsonWriter::parseFields(fields));
+	json.flush();
+	return out;
+}
+
+
+void HumdrumFile::printJson(HumJsonWriter& json, int fields) {
+	json.beginObject();
+
+	json.writeKey("lineCount");
+	json.writeInt(getLineCount());
+
+	if (fields & HumJsonWriter::FIELD_RHYTHM) {
+		json.writeKey("tpq");
+		json.writeInt(tpq());
+		json.writeKey("duration");
+		json.writeNumber(getScoreDuration());
+	}
+
+	// Spine terminators are not necessarily stored with their own
+	// track, so collect them by the track of the terminator token:
+	int maxtrack = getMaxTrack();
+	vector<vector<HTp>> trackends(maxtrack + 1);
+	HTp token;
+	for (int i=1; i<=maxtrack; i++) {
+		for (int j=0; j<getTrackEndCount(i); j++) {
+			token = getTrackEnd(i, j);
+			if ((token != NULL) && (token->getTrack() >= 1) &&
+					(token->getTrack() <= maxtrack)) {
+				trackends[token->getTrack()].push_back(token);
+			}
+		}
+	}
+
+	json.writeKey("tracks");
+	json.beginArray();
+	for (int i=1; i<=maxtrack; i++) {
+		json.beginObject();
+		json.writeKey("n");
+		json.writeInt(i);
+		token = getTrackStart(i);
+		if (token != NULL) {
+			json.writeKey("dataType");
+			json.writeString(token->getDataType());
+			json.writeKey("start");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+		}
+		json.writeKey("ends");
+		json.beginArray();
+		for (HTp end : trackends[i]) {
+			json.writeTokenId(end->getLineIndex(), end->getFieldIndex());
+		}
+		json.endArray();
+		json.endObject();
+	}
+	json.endArray();
+
+	if (fields & HumJsonWriter::FIELD_STRANDS) {
+		json.writeKey("strands");
+		json.beginArray();
+		int count = getStrandCount();
+		for (int i=0; i<count; i++) {
+			json.beginObject();
+			token = getStrandStart(i);
+			json.writeKey("start");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+			token = getStrandEnd(i);
+			json.writeKey("end");
+			json.writeTokenId(token->getLineIndex(), token->getFieldIndex());
+			json.endObject();
+		}
+		json.endArray();
+	}
+
+	if (fields & HumJsonWriter::FIELD_PARAMETERS) {
+		((HumHash*)this)->printJson(json);
+	}
+
+	if (fields & (HumJsonWriter::FIELD_LINES | HumJsonWriter::FIELD_TOKENS)) {
+		json.writeKey("lines");
+		json.beginArray();
+		for (int i=0; i<getLineCount(); i++) {
+			m_lines[i]->printJson(json, fields);
+		}
+		json.endArray();
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFile::printXmlParameterInfo -- Print contents of HumHash for HumdrumFile.
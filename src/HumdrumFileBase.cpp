@@ -16,6 +16,7 @@
 //
 
 #include "Convert.h"
+#include "HumParamSet.h"
 #include "HumRegex.h"
 #include "HumdrumFileBase.h"
 
@@ -23,6 +24,8 @@
 #include <cstring>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
 
 using namespace std;
 
@@ -93,6 +96,24 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::HumdrumFileBase -- Move constructor.  The lines,
+//     tokens and analysis state of the input file are transferred without
+//     copying, and the input file is left empty.
+//
+
+HumdrumFileBase::HumdrumFileBase(HumdrumFileBase&& infile) noexcept :
+		HumHash() {
+	m_ticksperquarternote = -1;
+	m_quietParse = false;
+	m_segmentlevel = 0;
+	m_displayError = false;
+	moveFrom(infile);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::operator = -- HumdrumFileStructure::analyzeStructure()
@@ -105,6 +126,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 		return *this;
 	}
 
+	clear();
 	m_filename = infile.m_filename;
 	m_segmentlevel = infile.m_segmentlevel;
 	m_trackstarts.clear();
@@ -132,6 +154,259 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::operator = -- Move assignment.  The current contents
+//     are deleted and the contents of the input file are transferred.
+//
+
+HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase&& infile) noexcept {
+	if (this == &infile) {
+		return *this;
+	}
+	clear();
+	moveFrom(infile);
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::moveFrom -- Transfer the contents of another file into
+//     this one, which should be empty.  The other file is left empty.
+//
+
+void HumdrumFileBase::moveFrom(HumdrumFileBase& infile) noexcept {
+	HumHash::operator=(std::move(infile));
+
+	m_lines               = std::move(infile.m_lines);
+	m_filename            = std::move(infile.m_filename);
+	m_segmentlevel        = infile.m_segmentlevel;
+	m_trackstarts         = std::move(infile.m_trackstarts);
+	m_trackends           = std::move(infile.m_trackends);
+	m_trackindex          = std::move(infile.m_trackindex);
+	m_trackindexvalid     = infile.m_trackindexvalid;
+	m_barlines            = std::move(infile.m_barlines);
+	m_ticksperquarternote = infile.m_ticksperquarternote;
+	m_idprefix            = std::move(infile.m_idprefix);
+	m_strand1d            = std::move(infile.m_strand1d);
+	m_strand2d            = std::move(infile.m_strand2d);
+	m_strophes1d          = std::move(infile.m_strophes1d);
+	m_strophes2d          = std::move(infile.m_strophes2d);
+	m_quietParse          = infile.m_quietParse;
+	m_parseError          = std::move(infile.m_parseError);
+	m_displayError        = infile.m_displayError;
+	m_signifiers          = std::move(infile.m_signifiers);
+	m_analyses            = infile.m_analyses;
+
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setOwner(this);
+	}
+
+	// The lines now belong to this file, so only forget them here:
+	infile.m_lines.clear();
+	infile.m_parseError.clear();
+	infile.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::cloneFrom -- Replace the contents of this file with a
+//     duplicate of another file.  Unlike the copy constructor and
+//     assignment operator, the text is not parsed again: lines and tokens
+//     are copied along with their analysis data, and all token links
+//     (spine connections, strands, null resolutions, parameters, etc.)
+//     are redirected to the new tokens.
+//
+
+void HumdrumFileBase::cloneFrom(const HumdrumFileBase& infile) {
+	if (this == &infile) {
+		return;
+	}
+	clear();
+	HumHash::operator=(infile);
+
+	m_filename            = infile.m_filename;
+	m_segmentlevel        = infile.m_segmentlevel;
+	m_ticksperquarternote = infile.m_ticksperquarternote;
+	m_idprefix            = infile.m_idprefix;
+	m_quietParse          = infile.m_quietParse;
+	m_parseError          = infile.m_parseError;
+	m_displayError        = infile.m_displayError;
+	m_signifiers          = infile.m_signifiers;
+	m_analyses            = infile.m_analyses;
+
+	int tokencount = 0;
+	for (int i=0; i<(int)infile.m_lines.size(); i++) {
+		tokencount += (int)infile.m_lines[i]->m_tokens.size();
+	}
+	unordered_map<HTp, HTp> tokenmap;
+	tokenmap.reserve(tokencount);
+	unordered_map<HLp, HLp> linemap;
+	linemap.reserve(infile.m_lines.size());
+
+	// Duplicate the lines and tokens:
+	m_lines.resize(infile.m_lines.size());
+	for (int i=0; i<(int)infile.m_lines.size(); i++) {
+		HLp oldline = infile.m_lines[i];
+		HLp line = new HumdrumLine;
+		(string&)(*line)            = (const string&)(*oldline);
+		(HumHash&)(*line)           = (const HumHash&)(*oldline);
+		line->m_lineindex           = oldline->m_lineindex;
+		line->m_tabs                = oldline->m_tabs;
+		line->m_duration            = oldline->m_duration;
+		line->m_durationFromStart   = oldline->m_durationFromStart;
+		line->m_durationFromBarline = oldline->m_durationFromBarline;
+		line->m_durationToBarline   = oldline->m_durationToBarline;
+		line->m_linkedParameters    = oldline->m_linkedParameters;
+		line->m_rhythm_analyzed     = oldline->m_rhythm_analyzed;
+		line->m_owner               = this;
+		line->m_tokens.resize(oldline->m_tokens.size());
+		for (int j=0; j<(int)oldline->m_tokens.size(); j++) {
+			HTp oldtok = oldline->m_tokens[j];
+			HTp token = new HumdrumToken;
+			(string&)(*token)              = (const string&)(*oldtok);
+			(HumHash&)(*token)             = (const HumHash&)(*oldtok);
+			token->m_address               = oldtok->m_address;
+			token->setOwner(line);
+			token->m_duration              = oldtok->m_duration;
+			token->m_nextTokens            = oldtok->m_nextTokens;
+			token->m_previousTokens        = oldtok->m_previousTokens;
+			token->m_nextNonNullTokens     = oldtok->m_nextNonNullTokens;
+			token->m_previousNonNullTokens = oldtok->m_previousNonNullTokens;
+			token->m_rhycheck              = oldtok->m_rhycheck;
+			token->m_strand                = oldtok->m_strand;
+			token->m_nullresolve           = oldtok->m_nullresolve;
+			token->m_rhythm_analyzed       = oldtok->m_rhythm_analyzed;
+			if (oldtok->m_cold) {
+				HumdrumToken::ColdData& cold = token->getColdData();
+				cold.m_linkedParameterTokens = oldtok->m_cold->m_linkedParameterTokens;
+				cold.m_strophe               = oldtok->m_cold->m_strophe;
+			}
+			line->m_tokens[j] = token;
+			tokenmap[oldtok] = token;
+		}
+		m_lines[i] = line;
+		linemap[oldline] = line;
+	}
+
+	// Redirect token links to the new tokens:
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HLp line = m_lines[i];
+		line->remapTokens(tokenmap);
+		remapTokenList(line->m_linkedParameters, tokenmap);
+		for (int j=0; j<(int)line->m_tokens.size(); j++) {
+			HTp token = line->m_tokens[j];
+			HTp oldtok = infile.m_lines[i]->m_tokens[j];
+			token->HumHash::remapTokens(tokenmap);
+			remapTokenList(token->m_nextTokens, tokenmap);
+			remapTokenList(token->m_previousTokens, tokenmap);
+			remapTokenList(token->m_nextNonNullTokens, tokenmap);
+			remapTokenList(token->m_previousNonNullTokens, tokenmap);
+			token->m_nullresolve = remapToken(token->m_nullresolve, tokenmap);
+			if (token->m_cold) {
+				HumdrumToken::ColdData& cold = *token->m_cold;
+				remapTokenList(cold.m_linkedParameterTokens, tokenmap);
+				cold.m_strophe = remapToken(cold.m_strophe, tokenmap);
+				if (oldtok->m_cold->m_parameterSet) {
+					cold.m_parameterSet = new HumParamSet(token);
+				}
+			}
+		}
+	}
+
+	// Redirect file-level token and line lists:
+	HumHash::remapTokens(tokenmap);
+	m_trackstarts = infile.m_trackstarts;
+	remapTokenList(m_trackstarts, tokenmap);
+	m_trackends = infile.m_trackends;
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		remapTokenList(m_trackends[i], tokenmap);
+	}
+	m_barlines = infile.m_barlines;
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		auto found = linemap.find(m_barlines[i]);
+		if (found != linemap.end()) {
+			m_barlines[i] = found->second;
+		}
+	}
+	m_strand1d = infile.m_strand1d;
+	remapTokenPairs(m_strand1d, tokenmap);
+	m_strand2d = infile.m_strand2d;
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		remapTokenPairs(m_strand2d[i], tokenmap);
+	}
+	m_strophes1d = infile.m_strophes1d;
+	remapTokenPairs(m_strophes1d, tokenmap);
+	m_strophes2d = infile.m_strophes2d;
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		remapTokenPairs(m_strophes2d[i], tokenmap);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapToken -- Return the counterpart of a token in the
+//     given map, or the token itself if it is not in the map.
+//
+
+HTp HumdrumFileBase::remapToken(HTp token,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	if (token == NULL) {
+		return token;
+	}
+	auto found = tokenmap.find(token);
+	if (found == tokenmap.end()) {
+		return token;
+	}
+	return found->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapTokenList -- Apply remapToken to a list of tokens.
+//
+
+void HumdrumFileBase::remapTokenList(vector<HTp>& tokens,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<(int)tokens.size(); i++) {
+		tokens[i] = remapToken(tokens[i], tokenmap);
+	}
+}
+
+
+void HumdrumFileBase::remapTokenList(HumTokenLinks& tokens,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<tokens.size(); i++) {
+		tokens[i] = remapToken(tokens[i], tokenmap);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::remapTokenPairs -- Apply remapToken to both ends of
+//     a list of token pairs.
+//
+
+void HumdrumFileBase::remapTokenPairs(vector<TokenPair>& pairs,
+		const unordered_map<HTp, HTp>& tokenmap) {
+	for (int i=0; i<(int)pairs.size(); i++) {
+		pairs[i].first = remapToken(pairs[i].first, tokenmap);
+		pairs[i].last  = remapToken(pairs[i].last, tokenmap);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::~HumdrumFileBase -- HumdrumFileBase deconstructor.
@@ -161,6 +436,8 @@ void HumdrumFileBase::clear(void) {
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
 	m_trackends.clear();
+	m_trackindex.clear();
+	m_trackindexvalid = false;
 	m_barlines.clear();
 	m_ticksperquarternote = -1;
 	m_idprefix.clear();
@@ -855,12 +1132,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 void HumdrumFileBase::appendLine(const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
+	m_trackindexvalid = false;
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
 	// deletion will be handled by class.
 	m_lines.push_back(line);
+	m_trackindexvalid = false;
 }
 
 
@@ -874,6 +1153,7 @@ void HumdrumFileBase::appendLine(HLp line) {
 void HumdrumFileBase::insertLine(int index, const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.insert(m_lines.begin() + index, s);
+	m_trackindexvalid = false;
 
 	// Update the line indexes for this line and the following ones:
 	for (int i=index; i<(int)m_lines.size(); i++) {
@@ -885,6 +1165,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 void HumdrumFileBase::insertLine(int index, HLp line) {
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
+	m_trackindexvalid = false;
 
 	// Update the line indexes for this line and the following ones:
 	for (int i=index; i<(int)m_lines.size(); i++) {
@@ -914,6 +1195,7 @@ void HumdrumFileBase::deleteLine(int index) {
 		m_lines[i-1] = m_lines[i];
 	}
 	m_lines.resize(m_lines.size() - 1);
+	m_trackindexvalid = false;
 }
 
 
@@ -1140,19 +1422,10 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts) {
 
 void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 		const string& exinterp) {
-	string newexinterp;
-	if (exinterp.compare(0, 2, "**") == 0) {
-		newexinterp = exinterp;
-	} else {
-		newexinterp = "**";
-		newexinterp += exinterp;
-	}
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
-	for (int i=1; i<(int)m_trackstarts.size(); i++) {
-		if (newexinterp == *m_trackstarts[i]) {
-			spinestarts.push_back(m_trackstarts[i]);
-		}
+	for (HTp start : getSpineStartView(exinterp)) {
+		spinestarts.push_back(start);
 	}
 }
 
@@ -1180,6 +1453,34 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::getSpineStartView -- Return a view of the starting
+//     exclusive interpretations of the spines, optionally only those
+//     for the given data type ("**" is added to the data type if needed,
+//     so an empty data type gives no spines, as in getSpineStartList()).
+//     The view does not copy the list of spine starts.
+//
+
+HumSpineStartView HumdrumFileBase::getSpineStartView(void) {
+	if (m_trackstarts.size() < 2) {
+		return HumSpineStartView();
+	}
+	return HumSpineStartView(m_trackstarts.data() + 1,
+			m_trackstarts.data() + m_trackstarts.size());
+}
+
+
+HumSpineStartView HumdrumFileBase::getSpineStartView(const string& exinterp) {
+	if (m_trackstarts.size() < 2) {
+		return HumSpineStartView();
+	}
+	return HumSpineStartView(m_trackstarts.data() + 1,
+			m_trackstarts.data() + m_trackstarts.size(), exinterp);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::getKernSpineStartList -- return only the spines that are **kern.
@@ -1295,11 +1596,9 @@ void HumdrumFileBase::getSpineSequence(vector<vector<HTp> >& sequence,
 
 void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 		int options) {
-	vector<vector<HTp> > tempseq;
-	getTrackSequence(tempseq, track, options | OPT_PRIMARY);
-	sequence.resize(tempseq.size());
-	for (int i=0; i<(int)tempseq.size(); i++) {
-		sequence[i] = tempseq[i][0];
+	sequence.resize(0);
+	for (auto row : getPrimaryTrackView(track, options)) {
+		sequence.push_back(row.front());
 	}
 }
 
@@ -1310,7 +1609,8 @@ void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 // HumdrumFileBase::getTrackSequence -- Extract a sequence of tokens
 //    for the given spine.  All subspine tokens will be included.
 //    See getPrimaryTrackSequence() if you only want the first subspine for
-//    a track on all lines.
+//    a track on all lines, and getTrackView() to iterate over the tokens
+//    without copying them.
 //
 // The following options are used for the getPrimaryTrackTokens:
 // * OPT_PRIMARY    => only extract primary subspine/subtrack.
@@ -1327,6 +1627,9 @@ void HumdrumFileBase::getPrimaryTrackSequence(vector<HTp>& sequence, int track,
 //                        a list of tokens from lines which hasSpines() it true.
 // * OPT_NOREST     => don't include **kern rests.
 // * OPT_NOTIE      => don't include **kern secondary tied notes.
+// * OPT_NOBARLINE  => don't include barlines.
+// * OPT_NODATA     => don't include data tokens (other than barlines).
+// * OPT_NOTANDEM   => don't include any interpretation tokens.
 // Compound options:
 // * OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 //     Only data tokens (including barlines)
@@ -1343,90 +1646,105 @@ void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 
 void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 		int track, int options) {
-	bool primaryQ   = (options & OPT_PRIMARY) ? true : false;
-	bool nonullQ    = (options & OPT_NONULL) ? true : false;
-	bool noemptyQ   = (options & OPT_NOEMPTY) ? true : false;
-	bool nointerpQ  = (options & OPT_NOINTERP) ? true : false;
-	bool nomanipQ   = (options & OPT_NOMANIP) ? true : false;
-	bool nocommentQ = (options & OPT_NOCOMMENT) ? true : false;
-	bool noglobalQ  = (options & OPT_NOGLOBAL) ? true : false;
-	bool norestQ    = (options & OPT_NOREST) ? true : false;
-	bool notieQ     = (options & OPT_NOTIE) ? true : false;
-
-	vector<vector<HTp> >& output = sequence;
-	output.reserve(getLineCount());
-	output.resize(0);
-
-	vector<HTp> tempout;
-	auto& infile = *this;
-	int i, j;
-	bool allNull;
-	HTp token;
-	bool foundTrack;
+	sequence.reserve(getLineCount());
+	sequence.resize(0);
+	for (auto row : getTrackView(track, options)) {
+		sequence.emplace_back(row.begin(), row.end());
+	}
+}
 
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isEmpty()) {
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTrackView -- Return a view of the tokens in a track
+//     (indexed from 1 to getMaxTrack()), filtered by the same options as
+//     getTrackSequence().  The view reads the track index which is built
+//     when the track structure is analyzed, and it is rebuilt here if
+//     lines or tokens have been added or removed since then.  An empty
+//     view is returned for invalid tracks.
+//
+
+HumTrackView HumdrumFileBase::getTrackView(int track, int options) {
+	if (!m_trackindexvalid) {
+		buildTrackIndex();
+	}
+	if ((track < 1) || (track >= (int)m_trackindex.size())) {
+		return HumTrackView();
+	}
+	return HumTrackView(&m_trackindex[track], options);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::buildTrackIndex -- Store the tokens of each track in
+//     line order for use by HumTrackView.  Empty lines are skipped, and
+//     global lines are added to the index of every track.
+//
+
+void HumdrumFileBase::buildTrackIndex(void) {
+	int maxtrack = getMaxTrack();
+	m_trackindex.resize(maxtrack + 1);
+	for (int i=0; i<(int)m_trackindex.size(); i++) {
+		m_trackindex[i].clear();
+	}
+
+	int rowcount = 0;
+	int globalcount = 0;
+	vector<int> tokencount(maxtrack + 1, 0);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.isEmpty()) {
 			continue;
 		}
-		tempout.resize(0);
-		if (!noglobalQ && (infile[i].isGlobal())) {
-			tempout.push_back(infile[i].token(0));
-			output.push_back(tempout);
+		rowcount++;
+		if (line.isGlobal()) {
+			globalcount++;
 			continue;
 		}
-		if (noemptyQ) {
-			allNull = true;
-			for (j=0; j<infile[i].getFieldCount(); j++) {
-				if (infile[i].token(j)->getTrack() != track) {
-					continue;
-				}
-				if (!infile[i].token(j)->isNull()) {
-					allNull = false;
-					break;
-				}
-			}
-			if (allNull) {
-				continue;
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			int track = line.m_tokens[j]->getTrack();
+			if ((track > 0) && (track <= maxtrack)) {
+				tokencount[track]++;
 			}
 		}
+	}
+	for (int t=1; t<=maxtrack; t++) {
+		m_trackindex[t].m_tokens.reserve(tokencount[t] + globalcount);
+		m_trackindex[t].m_rows.reserve(rowcount + 1);
+		m_trackindex[t].m_global.reserve(rowcount);
+	}
 
-		foundTrack = false;
-		for (j=0; j<infile[i].getFieldCount(); j++) {
-			token = infile[i].token(j);
-			if (token->getTrack() != track) {
-				continue;
-			}
-			if (primaryQ && foundTrack) {
-				continue;
-			}
-			foundTrack = true;
-			if (nointerpQ && (infile[i].token(j)->isManipulator() ||
-					infile[i].token(j)->isTerminator() ||
-					infile[i].token(j)->isExclusive())) {
-				continue;
-			}
-			if (nomanipQ && infile[i].token(j)->isManipulator()) {
-				continue;
-			}
-			if (nonullQ && infile[i].token(j)->isNull()) {
-				continue;
-			}
-			if (nocommentQ && infile[i].token(j)->isComment()) {
-				continue;
-			}
-			if (norestQ && infile[i].token(j)->isRest()) {
-				continue;
-			}
-			if (notieQ && infile[i].token(j)->isSecondaryTiedNote()) {
-				continue;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.isEmpty()) {
+			continue;
+		}
+		bool globalQ = line.isGlobal();
+		for (int t=1; t<=maxtrack; t++) {
+			HumTrackIndex& index = m_trackindex[t];
+			index.m_rows.push_back((int)index.m_tokens.size());
+			index.m_global.push_back(globalQ);
+			if (globalQ && !line.m_tokens.empty()) {
+				index.m_tokens.push_back(line.m_tokens[0]);
 			}
-
-			tempout.push_back(infile[i].token(j));
 		}
-		if (tempout.size() > 0) {
-			output.push_back(tempout);
+		if (globalQ) {
+			continue;
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			int track = line.m_tokens[j]->getTrack();
+			if ((track > 0) && (track <= maxtrack)) {
+				m_trackindex[track].m_tokens.push_back(line.m_tokens[j]);
+			}
 		}
 	}
+	for (int t=1; t<=maxtrack; t++) {
+		m_trackindex[t].m_rows.push_back((int)m_trackindex[t].m_tokens.size());
+	}
+	m_trackindexvalid = true;
 }
 
 
@@ -1523,7 +1841,8 @@ bool HumdrumFileBase::analyzeLines(void) {
 //////////////////////////////
 //
 // HumdrumFileBase::analyzeTracks -- Analyze the track structure of the
-//     data.  Returns false if there was a parse error.
+//     data and build the track index used by HumTrackView.  Returns false
+//     if there was a parse error.
 //
 
 bool HumdrumFileBase::analyzeTracks(void) {
@@ -1533,6 +1852,7 @@ bool HumdrumFileBase::analyzeTracks(void) {
 			return false;
 		}
 	}
+	buildTrackIndex();
 	return isValid();
 }
 
@@ -1708,6 +2028,7 @@ bool HumdrumFileBase::stitchLinesTogether(HumdrumLine& previous,
 bool HumdrumFileBase::analyzeSpines(void) {
 	vector<string> datatype;
 	vector<string> sinfo;
+	vector<HTp> sinfotokens;  // previous token with the same spine info
 	vector<vector<HTp> > lastspine;
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
@@ -1733,11 +2054,13 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			datatype.resize(m_lines[i]->getTokenCount());
 			sinfo.resize(m_lines[i]->getTokenCount());
 			lastspine.resize(m_lines[i]->getTokenCount());
+			sinfotokens.resize(m_lines[i]->getTokenCount());
 			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
 				datatype[j] = m_lines[i]->getTokenString(j);
 				addToTrackStarts(m_lines[i]->token(j));
 				sinfo[j]    = to_string(j+1);
 				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+				sinfotokens[j] = m_lines[i]->token(j);
 				m_lines[i]->token(j)->setFieldIndex(j);
 				lastspine[j].push_back(m_lines[i]->token(j));
 			}
@@ -1755,13 +2078,21 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			return setParseError(err);
 		}
 		for (j=0; j<m_lines[i]->getTokenCount(); j++) {
-			m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			// The spine info only changes after manipulators, so
+			// share the string with the previous token in the spine:
+			if (sinfotokens[j]) {
+				m_lines[i]->token(j)->shareSpineInfo(sinfotokens[j]);
+			} else {
+				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			}
+			sinfotokens[j] = m_lines[i]->token(j);
 			m_lines[i]->token(j)->setFieldIndex(j);
 		}
 		if (!m_lines[i]->isManipulator()) {
 			continue;
 		}
 		if (!adjustSpines(*m_lines[i], datatype, sinfo)) { return isValid(); }
+		sinfotokens.assign(sinfo.size(), NULL);
 	}
 	return isValid();
 }
@@ -2180,14 +2511,14 @@ bool HumdrumFileBase::processNonNullDataTokensForTrackForward(HTp starttoken,
 //    variable in HumdrumTokens)
 //
 
-void HumdrumFileBase::addUniqueTokens(vector<HTp>& target,
+void HumdrumFileBase::addUniqueTokens(HumTokenLinks& target,
 		vector<HTp>& source) {
 	int i, j;
 	bool found;
 	for (i=0; i<(int)source.size(); i++) {
 		found = false;
-		for (j=0; j<(int)target.size(); j++) {
-			if (source[i] == target[i]) {
+		for (j=0; j<target.size(); j++) {
+			if (source[i] == target[j]) {
 				found = true;
 			}
 		}
@@ -2878,6 +3209,334 @@ void HumdrumFileBase::clearTokenLinkInfo(void) {
 
 
 
+//////////////////////////////
+//
+// HumTrackView::isAccepted -- Return true if the token is not removed
+//     by the OPT_* filters in the options (OPT_PRIMARY, OPT_NOEMPTY and
+//     OPT_NOGLOBAL apply to whole rows and are ignored here).
+//
+
+bool HumTrackView::isAccepted(HTp token, int options) {
+	if ((options & OPT_NOINTERP) && (token->isManipulator() ||
+			token->isTerminator() || token->isExclusive())) {
+		return false;
+	}
+	if ((options & OPT_NOMANIP) && token->isManipulator()) {
+		return false;
+	}
+	if ((options & OPT_NONULL) && token->isNull()) {
+		return false;
+	}
+	if ((options & OPT_NOCOMMENT) && token->isComment()) {
+		return false;
+	}
+	if ((options & OPT_NOREST) && token->isRest()) {
+		return false;
+	}
+	if ((options & OPT_NOTIE) && token->isSecondaryTiedNote()) {
+		return false;
+	}
+	if ((options & OPT_NOBARLINE) && token->isBarline()) {
+		return false;
+	}
+	if ((options & OPT_NODATA) && token->isData()) {
+		return false;
+	}
+	if ((options & OPT_NOTANDEM) && token->isInterpretation()) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::getRowCount -- Return the number of rows in the track
+//     index, before filtering.
+//
+
+int HumTrackView::getRowCount(const HumTrackIndex* index) {
+	if ((index == NULL) || index->m_rows.empty()) {
+		return 0;
+	}
+	return (int)index->m_rows.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::makeRow -- Set the output to the given row of the track
+//     index.  Returns false if the row is filtered out by the options or
+//     if none of its tokens pass the filters.  Global rows are only
+//     filtered by OPT_NOGLOBAL.
+//
+
+bool HumTrackView::makeRow(const HumTrackIndex* index, int options, int row,
+		Row& output) {
+	const HTp* first = index->m_tokens.data() + index->m_rows[row];
+	const HTp* last  = index->m_tokens.data() + index->m_rows[row+1];
+	if (first == last) {
+		return false;
+	}
+	if (index->m_global[row]) {
+		if (options & OPT_NOGLOBAL) {
+			return false;
+		}
+		output = Row(first, last, 0);
+		return true;
+	}
+	if (options & OPT_NOEMPTY) {
+		const HTp* ptr = first;
+		while ((ptr < last) && (*ptr)->isNull()) {
+			ptr++;
+		}
+		if (ptr == last) {
+			return false;
+		}
+	}
+	if (options & OPT_PRIMARY) {
+		last = first + 1;
+	}
+	output = Row(first, last, options);
+	return !output.empty();
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::size -- Return the number of rows in the view.
+//
+
+int HumTrackView::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::iterator -- Iterate over the rows of a view which are
+//     not empty after filtering.
+//
+
+HumTrackView::iterator::iterator(const HumTrackIndex* index, int options, int row)
+		: m_index(index), m_options(options), m_row(row) {
+	skip();
+}
+
+
+HumTrackView::iterator& HumTrackView::iterator::operator++(void) {
+	m_row++;
+	skip();
+	return *this;
+}
+
+
+void HumTrackView::iterator::skip(void) {
+	int count = HumTrackView::getRowCount(m_index);
+	while ((m_row < count) && !HumTrackView::makeRow(m_index, m_options, m_row, m_current)) {
+		m_row++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::token_iterator -- Iterate over the tokens of all rows in
+//     a view.
+//
+
+HumTrackView::token_iterator::token_iterator(iterator row, iterator last)
+		: m_row(row), m_last(last) {
+	if (m_row != m_last) {
+		m_token = m_row->begin();
+	}
+}
+
+
+HumTrackView::token_iterator& HumTrackView::token_iterator::operator++(void) {
+	++m_token;
+	if (m_token == m_row->end()) {
+		++m_row;
+		m_token = (m_row != m_last) ? m_row->begin() : Row::iterator();
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::Row -- The row starts at the first token which
+//     passes the filters.
+//
+
+HumTrackView::Row::Row(const HTp* first, const HTp* last, int options)
+		: m_first(first), m_last(last), m_options(options) {
+	while ((m_first < m_last) && !HumTrackView::isAccepted(*m_first, m_options)) {
+		m_first++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::size -- Return the number of tokens in the row
+//     which pass the filters.
+//
+
+int HumTrackView::Row::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::operator[] -- Return the given token in the row
+//     (counting only tokens which pass the filters), or NULL if the index
+//     is out of range.
+//
+
+HTp HumTrackView::Row::operator[](int index) const {
+	if (index < 0) {
+		return NULL;
+	}
+	for (iterator it = begin(); it != end(); ++it) {
+		if (index-- == 0) {
+			return *it;
+		}
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::getLineIndex -- Return the line index of the row.
+//
+
+int HumTrackView::Row::getLineIndex(void) const {
+	if (m_first == m_last) {
+		return -1;
+	}
+	return (*m_first)->getLineIndex();
+}
+
+
+
+//////////////////////////////
+//
+// HumTrackView::Row::iterator -- Iterate over the tokens of a row which
+//     pass the filters.  The starting token has already been checked
+//     by the Row constructor.
+//
+
+HumTrackView::Row::iterator::iterator(const HTp* current, const HTp* last,
+		int options) : m_current(current), m_last(last), m_options(options) {
+	// do nothing
+}
+
+
+HumTrackView::Row::iterator& HumTrackView::Row::iterator::operator++(void) {
+	m_current++;
+	skip();
+	return *this;
+}
+
+
+void HumTrackView::Row::iterator::skip(void) {
+	while ((m_current < m_last) && !HumTrackView::isAccepted(*m_current, m_options)) {
+		m_current++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::HumSpineStartView -- The exclusive interpretation
+//     is optional; "**" is added to it if needed.
+//
+
+HumSpineStartView::HumSpineStartView(const HTp* first, const HTp* last)
+		: m_first(first), m_last(last) {
+	// all spines
+}
+
+
+HumSpineStartView::HumSpineStartView(const HTp* first, const HTp* last,
+		const string& exinterp) : m_first(first), m_last(last) {
+	if (exinterp.compare(0, 2, "**") == 0) {
+		m_exinterp = exinterp;
+	} else {
+		m_exinterp = "**";
+		m_exinterp += exinterp;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::size -- Return the number of spines in the view.
+//
+
+int HumSpineStartView::size(void) const {
+	int output = 0;
+	for (iterator it = begin(); it != end(); ++it) {
+		output++;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumSpineStartView::iterator -- Iterate over the spine starts which
+//     match the exclusive interpretation of the view.
+//
+
+HumSpineStartView::iterator::iterator(const HTp* current, const HTp* last,
+		const string& exinterp) : m_current(current), m_last(last),
+		m_exinterp(exinterp) {
+	skip();
+}
+
+
+HumSpineStartView::iterator& HumSpineStartView::iterator::operator++(void) {
+	m_current++;
+	skip();
+	return *this;
+}
+
+
+void HumSpineStartView::iterator::skip(void) {
+	if (m_exinterp.empty()) {
+		return;
+	}
+	while ((m_current < m_last) && (**m_current != m_exinterp)) {
+		m_current++;
+	}
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
@@ -123,6 +123,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 
 	int lasttrack = -1;
 	vector<int> concurrentstate(70, 0);
+	HumKernToken info;  // lexed **kern data of the current token
 
 	for (i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].hasSpines()) {
@@ -180,7 +181,8 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 				continue;
 			}
 
-			int subcount = token->getSubtokenCount();
+			info.lex(*token);
+			int subcount = info.getNoteCount();
 			track = token->getTrack();
 
 			if (lasttrack != track) {
@@ -188,41 +190,27 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 			}
 			lasttrack = track;
 			int rindex = rtracks[track];
+			int octaveadjust = token->getValueInt("auto", "ottava");
+			int graceQ = token->isGrace();
 			for (k=0; k<subcount; k++) {
 				// bool tienote = false;
-				string subtok = token->getSubtoken(k);
-				if (subcount > 1) {
-					// Rests in chords represent unsounding notes.
-					// Rests can have pitch, but this is treated as
-					// Diatonic pitch which does not involve accidentals,
-					// so convert to pitch-like so that accidentals are
-					// processed on these notes.
-					for (int m=0; m<(int)subtok.size(); m++) {
-						if (subtok[m] == 'r') {
-							subtok[m] = 'R';
-						}
-					}
-				}
-				int b40 = Convert::kernToBase40(subtok);
-				int diatonic = Convert::kernToBase7(subtok);
-				int octaveadjust = token->getValueInt("auto", "ottava");
+				// Rests in chords represent unsounding notes.  Rests can
+				// have pitch, but this is treated as Diatonic pitch which
+				// does not involve accidentals, so the lexed note pitch
+				// (which ignores 'r') is used so that accidentals are
+				// processed on these notes.
+				const HumKernNote& note = info.getNote(k);
+				int b40 = note.getBase40();
+				int diatonic = note.getBase7();
 				diatonic -= octaveadjust * 7;
 				if (diatonic < 0) {
 					// Deal with extra-low notes later.
 					continue;
 				}
-				int graceQ = token->isGrace();
-				int accid = Convert::kernToAccidentalCount(subtok);
-				int hiddenQ = 0;
-				if (subtok.find("yy") == string::npos) {
-					if ((subtok.find("ny") != string::npos) ||
-					    (subtok.find("#y") != string::npos) ||
-					    (subtok.find("-y") != string::npos)) {
-						hiddenQ = 1;
-					}
-				}
+				int accid = note.getAccidentalCount();
+				int hiddenQ = note.isAccidentalHidden() ? 1 : 0;
 
-				if (((subtok.find("_") != string::npos) || (subtok.find("]") != string::npos))) {
+				if (note.isTieContinue() || note.isTieEnd()) {
 					// tienote = true;
 					// tied notes do not have accidentals, so skip them
 					if ((accid != keysigs[rindex][diatonic % 7]) && firstinbar[rindex]) {
@@ -232,10 +220,12 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						dstates[rindex][diatonic] = -1000 + accid;
 						gdstates[rindex][diatonic] = -1000 + accid;
 					}
-					auto loc = subtok.find('X');
-					if (loc == string::npos) {
+					if (!note.contains(*token, "X")) {
 						continue;
-					} else if (loc == 0) {
+					}
+					string subtok = note.getText(*token);
+					auto loc = subtok.find('X');
+					if (loc == 0) {
 						continue;
 					} else {
 						if (!((subtok[loc-1] == '#') || (subtok[loc-1] == '-') ||
@@ -248,8 +238,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 				}
 
 				size_t loc;
+				string subtok;
 				// check for accidentals on trills, mordents and turns.
-				if (subtok.find("t") != string::npos) {
+				if (note.hasOrnament(HumKernNote::ORN_TRILL_MINOR)) {
 					// minor second trill
 					int trillnote     = b40 + 5;
 					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
@@ -259,7 +250,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"trillAccidental", to_string(trillaccid));
 						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
 					}
-				} else if (subtok.find("T") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_TRILL_MAJOR)) {
 					// major second trill
 					int trillnote     = b40 + 6;
 					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
@@ -268,7 +259,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "trillAccidental", to_string(trillaccid));
 						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
 					}
-				} else if (subtok.find("M") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_MORDENT_MAJOR)) {
 					// major second upper mordent
 					int auxnote     = b40 + 6;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -277,7 +268,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "mordentUpperAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("m") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_MORDENT_MINOR)) {
 					// minor second upper mordent
 					int auxnote     = b40 + 5;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -286,7 +277,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						token->setValue("auto", to_string(k), "mordentUpperAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("W") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_LOWER_MAJOR)) {
 					// major second upper mordent
 					int auxnote     = b40 - 6;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -296,7 +287,7 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"mordentLowerAccidental", to_string(auxaccid));
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
-				} else if (subtok.find("w") != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_LOWER_MINOR)) {
 					// minor second upper mordent
 					int auxnote     = b40 - 5;
 					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
@@ -307,7 +298,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
 					}
 
-				} else if ((loc = subtok.find("$")) != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_INVERTED_TURN)) {
+					subtok = note.getText(*token);
+					loc = subtok.find("$");
 					int turndiatonic = Convert::base40ToDiatonic(b40);
 					// int turnaccid = Convert::base40ToAccidental(b40);
 					// inverted turn
@@ -361,7 +354,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 								"turnLowerAccidental", to_string(bacc));
 						dstates[rindex][lowerdiatonic] = -1000 + bacc;
 					}
-				} else if ((loc = subtok.find("S")) != string::npos) {
+				} else if (note.hasOrnament(HumKernNote::ORN_TURN)) {
+					subtok = note.getText(*token);
+					loc = subtok.find("S");
 					int turndiatonic = Convert::base40ToDiatonic(b40);
 					// int turnaccid = Convert::base40ToAccidental(b40);
 					// regular turn
@@ -455,13 +450,14 @@ bool HumdrumFileContent::analyzeKernAccidentals(const string& dataType) {
 					dstates[rindex][diatonic] = accid;
 					gdstates[rindex][diatonic] = accid;
 
-				} else if ((accid == 0) && (subtok.find("n") != string::npos) && !hiddenQ) {
+				} else if ((accid == 0) && note.hasExplicitNatural() && !hiddenQ) {
 					token->setValue("auto", to_string(k), "cautionaryAccidental", "true");
 					token->setValue("auto", to_string(k), "visualAccidental", "true");
-				} else if (subtok.find("XX") == string::npos) {
+				} else if (note.contains(*token, "X") && !note.contains(*token, "XX")) {
 					// The accidental is not necessary. See if there is a single "X"
 					// immediately after the accidental which means to force it to
 					// display.
+					subtok = note.getText(*token);
 					auto loc = subtok.find("X");
 					if ((loc != string::npos) && (loc > 0)) {
 						if (subtok[loc-1] == '#') {
@@ -192,11 +192,9 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 	string ignorebegin = linksig + "L";
 	string ignoreend = linksig + "J";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// beamopens == list of beam openings for each track and elision level
 	// first dimension: elision level
@@ -211,18 +209,20 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), 'L');
-			closecount = (int)count(token->begin(), token->end(), 'J');
+			info.lex(*token);
+			opencount = info.getBeamStartCount();
+			closecount = info.getBeamEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedBeamEnd(token, i, ignoreend);
@@ -230,7 +230,7 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getBeamEndElisionLevel(i);
+				elision = info.getBeamEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -293,7 +293,7 @@ bool HumdrumFileContent::analyzeKernBeams(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getBeamStartElisionLevel(i);
+				elision = info.getBeamStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -21,7 +21,10 @@
 #include "HumdrumFileContent.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
+#include <numeric>
 
 using namespace std;
 
@@ -31,7 +34,7 @@ namespace hum {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::getMetricLevels -- Each line in the output
+// HumdrumFileContent::getMetricLevels -- Each line in the output
 //     vector matches to the line of the metric analysis data.
 //     undefined is the value to represent undefined analysis data
 //     (for non-data spines).
@@ -45,76 +48,211 @@ namespace hum {
 
 void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		int track, double undefined) {
-
-	HumdrumFileStructure& infile = *this;
+	HumdrumFileContent& infile = *this;
 	int lineCount = infile.getLineCount();
 	output.resize(lineCount);
 	fill(output.begin(), output.end(), undefined);
-	vector<HTp> kernspines = infile.getKernSpineStartList();
-	if ((track == 0) && (kernspines.size() > 0)) {
-		track = kernspines[0]->getTrack();
+	if (lineCount == 0) {
+		return;
 	}
-	if (track == 0) {
-		track = 1;
+	track = getMetricTrack(track);
+	analyzeMetricIndex(track);
+	vector<HumMetricInfo>& index = m_metricIndex[track];
+	for (int i=0; i<lineCount; i++) {
+		if (infile[i].isData()) {
+			output[i] = index[i].m_level;
+		}
 	}
+}
+
 
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricInfo -- Return the prevailing meter, the
+//     position from the barline in ticks, the measure ordinal and the
+//     metric level for a line in the given track (see getMetricLevels()
+//     for the meaning of track 0).  The metric index for the track is
+//     built the first time that it is needed.
+//
+
+const HumMetricInfo& HumdrumFileContent::getMetricInfo(int line, int track) {
+	track = getMetricTrack(track);
+	analyzeMetricIndex(track);
+	return m_metricIndex[track].at(line);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricLevel -- Return the metric level of a line
+//     (see getMetricLevels()).  Non-data lines return NAN.
+//
+
+double HumdrumFileContent::getMetricLevel(int line, int track) {
+	return getMetricInfo(line, track).m_level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricTpq -- Return the ticks per quarter note
+//     used for the positions in the metric index.
+//
+
+int HumdrumFileContent::getMetricTpq(void) {
+	if (!m_analyses.m_metric_analyzed) {
+		analyzeMetricIndex(getMetricTrack(0));
+	}
+	return m_metricTpq;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricTrack -- Convert track 0 into the track of
+//     the first **kern spine (or track 1 if there are no **kern spines).
+//
+
+int HumdrumFileContent::getMetricTrack(int track) {
+	if (track > 0) {
+		return track;
+	}
+	vector<HTp> kernspines = getKernSpineStartList();
+	if (kernspines.size() > 0) {
+		return kernspines[0]->getTrack();
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeMetricIndex -- Fill in the metric index for
+//     the given track if it has not already been done.  Time signatures
+//     are read from the given track, and metric levels are calculated
+//     from integer tick positions in the measure:
+//     Beat levels are log2 based, with 0 being the beat.  In compound
+//     meters (such as 6/8), the first level is log3 based, and then log2
+//     for the smaller levels.
+//
+
+void HumdrumFileContent::analyzeMetricIndex(int track) {
+	if (!m_analyses.m_metric_analyzed) {
+		m_metricIndex.clear();
+		m_metricTpq = tpq();
+		m_analyses.m_metric_analyzed = true;
+	}
+	if (track >= (int)m_metricIndex.size()) {
+		m_metricIndex.resize(track + 1);
+	}
+	vector<HumMetricInfo>& index = m_metricIndex[track];
+	HumdrumFileContent& infile = *this;
+	int lineCount = infile.getLineCount();
+	if ((int)index.size() == lineCount) {
+		return;
+	}
+	index.resize(lineCount);
+
+	long long tpq = m_metricTpq;
 	int top = 1;                // top number of time signature (0 for no meter)
 	int bot = 4;                // bottom number of time signature
 	bool compoundQ = false;     // test for compound meters, such as 6/8
-	HumNum beatdur(1 * 4, bot); // duration of a beat in the measure
-	HumNum measurepos;          // quarter notes from the start of barline
-	HumNum combeatdur;          // for adjusting beat level in compound meters
-	HumNum commeasurepos;       // for adjusting beat level in compound meters
+	int measure = 0;
 
 	for (int i=0; i<lineCount; i++) {
-		if (infile[i].isInterpretation()) {
+		HumdrumLine& line = infile[i];
+		if (line.isInterpretation()) {
 			// check for time signature:
-			HumdrumLine& line = *infile.getLine(i);
 			for (int j=0; j<line.getFieldCount(); j++) {
-				int ttrack = line.token(j)->getTrack();
-				if (ttrack != track) {
+				HTp token = line.token(j);
+				if (token->getTrack() != track) {
 					continue;
 				}
-				if (sscanf(infile.token(i,j)->c_str(), "*M%d/%d", &top, &bot)) {
-					beatdur.setValue(1*4, bot); // converted to quarter-note units
-					if ((top % 3 == 0) && (top != 3)) {
-						// if meter top is a multiple of 3 but not 3, then compound
-						// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
-						compoundQ = true;
-						beatdur *= 3;
-					} else {
-						compoundQ = false;
-					}
+				if (getMeter(token, top, bot)) {
+					// if meter top is a multiple of 3 but not 3, then compound
+					// such as 6/8, 9/8, 6/4, but not 3/8, 3/4.
+					compoundQ = (top % 3 == 0) && (top != 3);
 					break;
 				}
 			}
+		} else if (line.isBarline()) {
+			measure++;
 		}
-		if (!infile[i].isData()) {
-				continue;
+
+		HumMetricInfo& info = index[i];
+		info.m_top     = top;
+		info.m_bottom  = bot;
+		info.m_measure = measure;
+		info.m_level   = NAN;
+		HumNum position = line.getDurationFromBarline() * (int)tpq;
+		info.m_tick = position.getNumerator() / position.getDenominator();
+		if (!line.isData()) {
+			continue;
 		}
 
-		measurepos = infile[i].getDurationFromBarline();
+		// Position in beats is tick * bot / (tpq * 4 [* 3 if compound]).
 		// Might want to handle cases where the time signature changes in
 		// the middle or a measure...
-		measurepos /= beatdur;
-		int denominator = measurepos.getDenominator();
+		long long tick = info.m_tick;
+		long long beatticks = tpq * 4 * (compoundQ ? 3 : 1);
+		long long denominator = beatticks / std::gcd(tick * bot, beatticks);
 		if (compoundQ) {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
-			if ((output[i] != 0.0) && (output[i] != 1.0)) {
+			info.m_level = Convert::nearIntQuantize(log(denominator) / log(3.0));
+			if ((info.m_level != 0.0) && (info.m_level != 1.0)) {
 				// if not the beat or first level, then calculate
 				// levels above level 1.  In 6/8 this means
 				// to move the 8th note level to be the "beat"
 				// and then use binary levels for rhythmic levels
 				// smaller than a beat.
-				combeatdur.setValue(4,bot);
-				commeasurepos = infile[i].getDurationFromBarline() / combeatdur;
-				denominator = commeasurepos.getDenominator();
-				output[i] = 1.0 + log(denominator)/log(2.0);
+				denominator = (tpq * 4) / std::gcd(tick * bot, tpq * 4);
+				info.m_level = 1.0 + log(denominator)/log(2.0);
 			}
 		} else {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
+			info.m_level = Convert::nearIntQuantize(log(denominator) / log(2.0));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMeter -- Read the top and bottom numbers of a
+//     time signature interpretation, such as "*M6/8".  The bottom is
+//     not changed if the time signature only has a top number.  Returns
+//     false if the token is not a time signature.
+//
+
+bool HumdrumFileContent::getMeter(HTp token, int& top, int& bot) {
+	const string& text = *token;
+	if ((text.size() < 3) || (text[0] != '*') || (text[1] != 'M')) {
+		return false;
+	}
+	if (!isdigit(text[2]) && (text[2] != '-') && (text[2] != '+')) {
+		return false;
+	}
+	int value = atoi(text.c_str() + 2);
+	top = value;
+	size_t slash = text.find('/', 3);
+	if (slash == string::npos) {
+		return true;
+	}
+	bool digits = true;
+	for (size_t k=3; k<slash; k++) {
+		if (!isdigit(text[k])) {
+			digits = false;
+			break;
 		}
 	}
+	if (digits && (slash + 1 < text.size()) && isdigit(text[slash+1])) {
+		bot = atoi(text.c_str() + slash + 1);
+	}
+	return true;
 }
 
 
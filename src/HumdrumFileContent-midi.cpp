@@ -75,22 +75,21 @@ void HumdrumFileContent::processStrandNotesForMidi(HTp sstart, HTp send, vector<
 			current = current->getNextToken();
 			continue;
 		}
-		vector<string> subtokens = current->getSubtokens();
-		for (int i=0; i<(int)subtokens.size(); i++) {
-			if (subtokens[i] == ".") {
+		for (const HumSubtoken& subtoken : current->getSubtokenView()) {
+			if (subtoken == ".") {
 				// something strange happened (no null tokens expected)
 				continue;
 			}
-			if (subtokens[i].find("r") != string::npos) {
+			if (subtoken.contains('r')) {
 				// rest, so store in MIDI[0]
 				trackInfo.at(0).emplace_back(current, 0);
-			} else if (subtokens[i].find("R") != string::npos) {
+			} else if (subtoken.contains('R')) {
 				// unpitched or quasi-pitched note, so store in MIDI[0]
 				trackInfo.at(0).emplace_back(current, 0);
 			} else {
-				int keyno = Convert::kernToMidiNoteNumber(subtokens[i]);
+				int keyno = subtoken.getMidiNoteNumber();
 				if ((keyno >= 0) && (keyno < 128)) {
-					trackInfo.at(keyno).emplace_back(current, i);
+					trackInfo.at(keyno).emplace_back(current, subtoken.getIndex());
 				}
 			}
 		}
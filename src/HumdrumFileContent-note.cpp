@@ -118,13 +118,8 @@ void HumdrumFileContent::checkDataForCrossStaffStems(HTp token, string& above, s
 		return;
 	}
 
-	if (token->find('/') != std::string::npos) {
-		// has a stem-up marker, so do not try to adjust stems;
-		return;
-	}
-
-	if (token->find('\\') != std::string::npos) {
-		// has a stem-down marker, so do not try to adjust stems;
+	if (token->hasStemDirection()) {
+		// has a stem-up or stem-down marker, so do not try to adjust stems;
 		return;
 	}
 
@@ -225,7 +220,7 @@ void HumdrumFileContent::prepareStaffAboveNoteStems(HTp token) {
 			curr2 = curr2->getNextToken();
 			continue;
 		}
-		if ((curr2->find('/') != std::string::npos) || (curr2->find('\\') != std::string::npos)) {
+		if (curr2->hasStemDirection()) {
 			// the note/chord has a stem direction, so ignore it
 			curr2 = curr2->getNextToken();
 			continue;
@@ -320,7 +315,7 @@ void HumdrumFileContent::prepareStaffBelowNoteStems(HTp token) {
 			curr2 = curr2->getNextToken();
 			continue;
 		}
-		if ((curr2->find('/') != std::string::npos) || (curr2->find('\\') != std::string::npos)) {
+		if (curr2->hasStemDirection()) {
 			// the note/chord has a stem direction, so ignore it
 			curr2 = curr2->getNextToken();
 			continue;
@@ -350,6 +345,7 @@ int HumdrumFileContent::getNoteCount(void) {
 	HumdrumFileContent& infile = *this;
 	int counter = 0;
 
+	HumKernToken info;  // lexed **kern data of the current token
 	int scount = infile.getStrandCount();
 	for (int i=0; i<scount; i++) {
 		HTp sstart = infile.getStrandStart(i);
@@ -371,21 +367,19 @@ int HumdrumFileContent::getNoteCount(void) {
 				current = current->getNextToken();
 				continue;
 			}
-			int subcount = current->getSubtokenCount();
+			info.lex(*current);
+			int subcount = info.getNoteCount();
 			if (subcount == 1) {
 				if (!current->isSecondaryTiedNote()) {
 					counter++;
 				}
 			} else {
-				vector<string> subtokens = current->getSubtokens();
-				for (int i=0; i<(int)subtokens.size(); i++) {
-					if (subtokens[i].find("_") != string::npos) {
-						continue;
-					}
-					if (subtokens[i].find("]") != string::npos) {
+				for (int i=0; i<subcount; i++) {
+					const HumKernNote& note = info.getNote(i);
+					if (note.isTieContinue() || note.isTieEnd()) {
 						continue;
 					}
-					if (subtokens[i].find("r") != string::npos) {
+					if (note.isRest()) {
 						continue;
 					}
 					counter++;
@@ -119,11 +119,9 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 	string ignorebegin = linksig + "{";
 	string ignoreend = linksig + "}";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// phraseopens == list of phrase openings for each track and elision level
 	// first dimension: elision level
@@ -138,18 +136,20 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), '{');
-			closecount = (int)count(token->begin(), token->end(), '}');
+			info.lex(*token);
+			opencount = info.getPhraseStartCount();
+			closecount = info.getPhraseEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedPhraseEnd(token, i, ignoreend);
@@ -157,7 +157,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getPhraseEndElisionLevel(i);
+				elision = info.getPhraseEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -220,7 +220,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getPhraseStartElisionLevel(i);
+				elision = info.getPhraseStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -308,9 +308,8 @@ void HumdrumFileContent::assignVerticalRestPosition(HTp first, HTp second, int b
 		return;
 	}
 
-	int count = notes->getSubtokenCount();
-	for (int i=0; i<count; i++) {
-		vpos.push_back(Convert::kernToBase7(notes->getSubtoken(i)) - baseline);
+	for (const HumSubtoken& subtoken : notes->getSubtokenView()) {
+		vpos.push_back(subtoken.getBase7() - baseline);
 	}
 
 	int rpos = 0;
@@ -192,11 +192,9 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 	string ignorebegin = linksig + "(";
 	string ignoreend = linksig + ")";
 
-	// tracktokens == the 2-D data list for the track,
-	// arranged in layers with the second dimension.
-	vector<vector<HTp> > tracktokens;
-	this->getTrackSeq(tracktokens, spinestart, OPT_DATA | OPT_NOEMPTY);
-	// printSequence(tracktokens);
+	// tracktokens == the data rows for the track, with the
+	// layers on each line in the rows.
+	HumTrackView tracktokens = getTrackView(spinestart, OPT_DATA | OPT_NOEMPTY);
 
 	// sluropens == list of slur openings for each track and elision level
 	// first dimension: elision level
@@ -211,18 +209,20 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 	int opencount = 0;
 	int closecount = 0;
 	int elision = 0;
-	HTp token;
-	for (int row=0; row<(int)tracktokens.size(); row++) {
-		for (int track=0; track<(int)tracktokens[row].size(); track++) {
-			token = tracktokens[row][track];
+	HumKernToken info;  // lexed **kern data of the current token
+	for (auto row : tracktokens) {
+		int track = -1;
+		for (HTp token : row) {
+			track++;
 			if (!token->isData()) {
 				continue;
 			}
 			if (token->isNull()) {
 				continue;
 			}
-			opencount = (int)count(token->begin(), token->end(), '(');
-			closecount = (int)count(token->begin(), token->end(), ')');
+			info.lex(*token);
+			opencount = info.getSlurStartCount();
+			closecount = info.getSlurEndCount();
 
 			for (int i=0; i<closecount; i++) {
 				bool isLinked = isLinkedSlurEnd(token, i, ignoreend);
@@ -230,7 +230,7 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 					linkends.push_back(token);
 					continue;
 				}
-				elision = token->getSlurEndElisionLevel(i);
+				elision = info.getSlurEndElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
@@ -293,7 +293,7 @@ bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 					linkstarts.push_back(token);
 					continue;
 				}
-				elision = token->getSlurStartElisionLevel(i);
+				elision = info.getSlurStartElisionLevel(i);
 				if (elision < 0) {
 					continue;
 				}
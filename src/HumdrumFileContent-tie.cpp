@@ -73,6 +73,7 @@ bool HumdrumFileContent::analyzeKernTies(
 		startdatabase[i].second = -1;
 	}
 
+	HumKernToken info;  // lexed **kern data of the current token
 	HumdrumFileContent& infile = *this;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
@@ -92,22 +93,25 @@ bool HumdrumFileContent::analyzeKernTies(
 			if (tok->isRest()) {
 				continue;
 			}
-			int scount = tok->getSubtokenCount();
+			info.lex(*tok);
+			int scount = info.getNoteCount();
 			int b40;
 			for (int k=0; k<scount; k++) {
 				int index = k;
 				if (scount == 1) {
 					index = -1;
 				}
-				std::string tstring = tok->getSubtoken(k);
-				if (tstring.find(lstart) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				const HumKernNote& note = info.getNote(k);
+				if (!(note.isTieStart() || note.isTieContinue() || note.isTieEnd())) {
+					continue;
+				}
+				b40 = note.getBase40();
+				if (note.isTieStart() && note.contains(*tok, lstart)) {
 					startdatabase[b40].first  = tok;
 					startdatabase[b40].second = index;
 					// linkedtiestarts.push_back(std::make_pair(tok, index));
 				}
-				if (tstring.find(lend) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				if (note.isTieEnd() && note.contains(*tok, lend)) {
 					if (startdatabase.at(b40).first) {
 						linkedtiestarts.push_back(startdatabase[b40]);
 						linkedtieends.push_back(std::make_pair(tok, index));
@@ -115,8 +119,7 @@ bool HumdrumFileContent::analyzeKernTies(
 						startdatabase[b40].second = -1;
 					}
 				}
-				if (tstring.find(lmiddle) != std::string::npos) {
-					b40 = Convert::kernToBase40(tstring);
+				if (note.isTieContinue() && note.contains(*tok, lmiddle)) {
 					if (startdatabase[b40].first) {
 						linkedtiestarts.push_back(startdatabase[b40]);
 						linkedtieends.push_back(std::make_pair(tok, index));
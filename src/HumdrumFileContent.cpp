@@ -14,6 +14,8 @@
 #include "HumRegex.h"
 #include "HumdrumFileContent.h"
 
+#include <utility>
+
 using namespace std;
 
 namespace hum {
@@ -54,6 +56,54 @@ HumdrumFileContent::~HumdrumFileContent() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::HumdrumFileContent -- Copy and move constructors.
+//
+
+HumdrumFileContent::HumdrumFileContent(HumdrumFileContent& infile) :
+		HumdrumFileStructure(infile) {
+	m_metricIndex = infile.m_metricIndex;
+	m_metricTpq   = infile.m_metricTpq;
+}
+
+
+HumdrumFileContent::HumdrumFileContent(HumdrumFileContent&& infile) noexcept :
+		HumdrumFileStructure(std::move(infile)) {
+	m_metricIndex = std::move(infile.m_metricIndex);
+	m_metricTpq   = infile.m_metricTpq;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::operator= -- Copy and move assignment.
+//
+
+HumdrumFileContent& HumdrumFileContent::operator=(HumdrumFileContent& infile) {
+	if (this == &infile) {
+		return *this;
+	}
+	HumdrumFileStructure::operator=(infile);
+	m_metricIndex = infile.m_metricIndex;
+	m_metricTpq   = infile.m_metricTpq;
+	return *this;
+}
+
+
+HumdrumFileContent& HumdrumFileContent::operator=(HumdrumFileContent&& infile) noexcept {
+	if (this == &infile) {
+		return *this;
+	}
+	HumdrumFileStructure::operator=(std::move(infile));
+	m_metricIndex = std::move(infile.m_metricIndex);
+	m_metricTpq   = infile.m_metricTpq;
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::analyzeRScale --
@@ -13,9 +13,11 @@
 #include "HumdrumFileSet.h"
 #include "HumdrumFileStream.h"
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 
@@ -221,6 +223,94 @@ int HumdrumFileSet::readAppendHumdrum(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// HumdrumFileSet::readSegments -- Read segments from a concatenated
+//    Humdrum file with a segment index, seeking directly to each segment
+//    instead of reading the whole file.  The segments are given by their
+//    indexes or their !!!!SEGMENT: names (all segments if no list is given).
+//    Unknown names and segments that cannot be read are skipped.  The
+//    segments can be read and parsed in parallel by several threads, each
+//    with its own stream to the data file, and are stored in the order
+//    given.  Returns the total number of segments in the set.
+//
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index, int threads) {
+	vector<int> segments(index.getSize());
+	for (int i=0; i<(int)segments.size(); i++) {
+		segments[i] = i;
+	}
+	return readSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index,
+		const vector<int>& segments, int threads) {
+	clear();
+	return readAppendSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readSegments(const HumSegmentIndex& index,
+		const vector<string>& names, int threads) {
+	vector<int> segments;
+	segments.reserve(names.size());
+	for (int i=0; i<(int)names.size(); i++) {
+		int segment = index.getSegment(names[i]);
+		if (segment >= 0) {
+			segments.push_back(segment);
+		}
+	}
+	return readSegments(index, segments, threads);
+}
+
+
+int HumdrumFileSet::readAppendSegments(const HumSegmentIndex& index,
+		const vector<int>& segments, int threads) {
+	int count = (int)segments.size();
+	if (count == 0) {
+		return (int)m_data.size();
+	}
+
+	vector<HumdrumFile*> files(count, NULL);
+	atomic<int> next(0);
+	auto readFiles = [&]() {
+		ifstream input(index.getFilename(), ios::binary);
+		if (!input.is_open()) {
+			return;
+		}
+		int i;
+		while ((i = next++) < count) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (HumdrumFileStream::readSegment(*infile, input, index, segments[i])) {
+				files[i] = infile;
+			} else {
+				delete infile;
+			}
+		}
+	};
+
+	int threadcount = min(max(threads, 1), count);
+	vector<thread> workers;
+	workers.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		workers.emplace_back(readFiles);
+	}
+	readFiles();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		if (files[i]) {
+			m_data.push_back(files[i]);
+		}
+	}
+	return (int)m_data.size();
+}
+
+
+
 //////////////////////////////
 //
 // appendHumdrumPointer --  The infile will be deleted by the object
@@ -158,6 +158,89 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::loadSegmentIndex -- Load the segment index of a
+//    concatenated Humdrum file for use with readSegment() (see
+//    HumSegmentIndex::load()).  Returns false if the file cannot be read.
+//
+
+bool HumdrumFileStream::loadSegmentIndex(const string& filename,
+		bool referencesQ) {
+	if (m_segmentstream.is_open()) {
+		m_segmentstream.close();
+	}
+	if (!m_segmentindex.load(filename, referencesQ)) {
+		return false;
+	}
+	m_segmentstream.open(filename, ios::binary);
+	return m_segmentstream.is_open();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a segment from a concatenated
+//    Humdrum file by seeking directly to it, either by its index in the
+//    file or by the name in its !!!!SEGMENT: record.  The result is the
+//    same as reading the file from the start with getFile() until the
+//    segment is reached.  The static version reads from the given data
+//    file stream, and can be used by several threads at once with separate
+//    streams.  Returns 0 if the segment cannot be read.
+//
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, int index) {
+	if (!m_segmentstream.is_open()) {
+		infile.clear();
+		return 0;
+	}
+	return readSegment(infile, m_segmentstream, m_segmentindex, index);
+}
+
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, const string& name) {
+	return readSegment(infile, m_segmentindex.getSegment(name));
+}
+
+
+int HumdrumFileStream::readSegment(HumdrumFile& infile, istream& input,
+		const HumSegmentIndex& segmentindex, int index) {
+	infile.clear();
+	string text;
+	if (!segmentindex.getText(input, index, text)) {
+		return 0;
+	}
+
+	// Set up a stream in the state that getFile() would be in when
+	// reaching the segment: the universal comments of the previous
+	// segments are stored, and after the first segment, the !!!!SEGMENT:
+	// or ** line which starts the segment has already been read.
+	HumdrumFileStream instream;
+	instream.m_curfile = 0;  // do not read from standard input
+	instream.m_universals = segmentindex.getUniversals(index);
+	if (index > 0) {
+		size_t newline = text.find('\n');
+		instream.m_newfilebuffer = text.substr(0, newline);
+		if (newline != string::npos) {
+			instream.m_stringbuffer.write(text.data() + newline + 1,
+					text.size() - newline - 1);
+		}
+	} else {
+		instream.m_stringbuffer << text;
+	}
+	if (!instream.getFile(infile)) {
+		return 0;
+	}
+	if ((index == 0) && infile.getFilename().empty()) {
+		// getFile() only uses the data filename for the first segment.
+		infile.setFilename(segmentindex.getFilename());
+	}
+	return 1;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::eof -- returns true if there is no more segements
@@ -344,10 +427,9 @@ restarting:
 	istream& input = *newinput;
 
 	// if the previous line from the last read starts with "**"
-	// then treat it as part of the current file.
-	if ((m_newfilebuffer.size() > 1) && (m_newfilebuffer.compare(0, 2, "**") == 0)) {
-		buffer << m_newfilebuffer << "\n";
-		m_newfilebuffer = "";
+	// then it is already the first line of the current file (the
+	// m_newfilebuffer line was moved into the buffer above).
+	if (buffer.str().compare(0, 2, "**") == 0) {
 		starstarFoundQ = 1;
 	}
 
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstring>
 #include <sstream>
+#include <utility>
 
 using namespace std;
 
@@ -61,6 +62,42 @@ HumdrumFileStructure::~HumdrumFileStructure() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::HumdrumFileStructure -- Copy and move constructors.
+//
+
+HumdrumFileStructure::HumdrumFileStructure(HumdrumFileStructure& infile) :
+		HumdrumFileBase(infile) {
+	// do nothing
+}
+
+
+HumdrumFileStructure::HumdrumFileStructure(HumdrumFileStructure&& infile) noexcept :
+		HumdrumFileBase(std::move(infile)) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::operator= -- Copy and move assignment.
+//
+
+HumdrumFileStructure& HumdrumFileStructure::operator=(HumdrumFileStructure& infile) {
+	HumdrumFileBase::operator=(infile);
+	return *this;
+}
+
+
+HumdrumFileStructure& HumdrumFileStructure::operator=(HumdrumFileStructure&& infile) noexcept {
+	HumdrumFileBase::operator=(std::move(infile));
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::read --  Read the contents of a file from a file or
@@ -609,51 +646,195 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 	if (getMaxTrack() == 0) {
 		return true;
 	}
-	int startline = getTrackStart(1)->getLineIndex();
-	int testline;
-	HumNum zero(0);
 
-	int i;
-	for (int i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
+	if (!assignDurationsFromStart()) { return false; }
+	if (!analyzeNullLineRhythms()) { return false; }
+	fillInNegativeStartTimes();
+	assignLineDurations();
+	if (!analyzeMeter()) { return false; }
+	if (!analyzeNonNullDataTokens()) { return false; }
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::assignDurationsFromStart -- Assign the
+//     durationFromStart of lines which contain the start of a note (or
+//     a spine terminator) in a rhythmic spine, in a single pass over
+//     the lines of the file.  For each token the running sum of note
+//     durations in its spine is taken from the token that precedes it on
+//     the previous line with spines (the sum is not increased by null
+//     tokens, so it is the start time of the next note in the spine).
+//     Spines which start after the first line of data (floating spines)
+//     are timed relative to their own start until they reach a line which
+//     already has a durationFromStart from the other spines, and then the
+//     tokens seen so far in the floating spine are assigned their times.
+//     Inconsistencies are reported by setLineDurationFromStart().
+//
+
+bool HumdrumFileStructure::assignDurationsFromStart(void) {
+	int maxtrack = getMaxTrack();
+	vector<bool> rhythmic(maxtrack + 1, false);
+	int maxfields = 0;
+	for (int i=1; i<=maxtrack; i++) {
+		HTp start = getTrackStart(i);
+		rhythmic[i] = start && start->hasRhythm();
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->getFieldCount() > maxfields) {
+			maxfields = m_lines[i]->getFieldCount();
+		}
+	}
+
+	// Running sums at the start and end of each token on the current line
+	// and at the end of each token on the previous line with spines.  The
+	// sums are absolute when the matching origin is 0, relative to the
+	// start of floating spine n-1 when the origin is n > 0, and unknown
+	// when the origin is negative (not rhythmic, or not connected to the
+	// previous line).
+	vector<HumNum> starts(maxfields);
+	vector<HumNum> ends(maxfields);
+	vector<HumNum> lastends(maxfields);
+	vector<int> endorigins(maxfields, -1);
+	vector<int> lastorigins(maxfields, -1);
+
+	// Start time of each floating spine (negative until known), and the
+	// tokens in the spine which are waiting for it:
+	vector<HumNum> offsets;
+	vector<vector<pair<HTp, HumNum>>> pending;
+
+	int startline = getTrackStart(1)->getLineIndex();
+	int lastline = -1;
+	HLp line;
+	HTp token;
+	HTp previous;
+	int track;
+	int origin;
+	HumNum duration;
+	for (int i=startline; i<(int)m_lines.size(); i++) {
+		line = m_lines[i];
+		if (!line->hasSpines()) {
 			continue;
 		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline == startline) {
-			if (!assignDurationsToTrack(getTrackStart(i), zero)) {
-				return false;
+		int fcount = line->getFieldCount();
+
+		// Lines which are not linked to the previous line (such as ones
+		// added by insertNullInterpretationLineAboveIndex()) are not in
+		// the path of any spine, so they keep their current time:
+		if (i > startline) {
+			bool linkedQ = false;
+			for (int j=0; j<fcount; j++) {
+				token = line->token(j);
+				if ((token->getPreviousTokenCount() > 0) ||
+						token->isExclusiveInterpretation()) {
+					linkedQ = true;
+					break;
+				}
+			}
+			if (!linkedQ) {
+				continue;
 			}
-		} else {
-			// Spine does not start at beginning of data, so
-			// the starting position of the spine has to be
-			// determined before continuing.  Search for a token
-			// which is on a line with assigned duration, then work
-			// outwards from that position.
-			continue;
 		}
-	}
 
-	// Go back and analyze spines that do not start at the
-	// beginning of the data stream.
-	for (i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
+		bool floatingQ = false;
+		for (int j=0; j<fcount; j++) {
+			endorigins[j] = -1;
+			token = line->token(j);
+			track = token->getTrack();
+			if ((track < 1) || (track > maxtrack) || !rhythmic[track]) {
+				continue;
+			}
+			if (token->getPreviousTokenCount() == 0) {
+				if (i == startline) {
+					starts[j] = 0;
+					origin = 0;
+				} else {
+					offsets.push_back(-1);
+					pending.resize(offsets.size());
+					starts[j] = 0;
+					origin = (int)offsets.size();
+				}
+			} else {
+				previous = token->getPreviousToken(0);
+				if (previous->getLineIndex() != lastline) {
+					continue;
+				}
+				int k = previous->getFieldIndex();
+				origin = lastorigins[k];
+				if (origin < 0) {
+					continue;
+				}
+				starts[j] = lastends[k];
+				if ((origin > 0) && offsets[origin-1].isNonNegative()) {
+					starts[j] += offsets[origin-1];
+					origin = 0;
+				}
+			}
+			endorigins[j] = origin;
+			if (origin > 0) {
+				// Floating spines are done after the line time is known.
+				floatingQ = true;
+				continue;
+			}
+			if (!setLineDurationFromStart(token, starts[j])) { return isValid(); }
+			ends[j] = starts[j];
+			duration = token->getDuration();
+			if (duration.isPositive()) {
+				ends[j] += duration;
+			}
 		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline > startline) {
-			if (!analyzeRhythmOfFloatingSpine(getTrackStart(i))) { return false; }
+
+		// Tokens in floating spines either use the line time to find the
+		// start of their spine, or wait for a later line:
+		for (int j=0; floatingQ && (j<fcount); j++) {
+			origin = endorigins[j];
+			if (origin <= 0) {
+				continue;
+			}
+			token = line->token(j);
+			ends[j] = starts[j];
+			duration = token->getDuration();
+			if (duration.isPositive()) {
+				ends[j] += duration;
+			}
+			if (offsets[origin-1].isNegative()) {
+				HumNum linestart = line->getDurationFromStart();
+				bool timedQ = token->isTerminateInterpretation()
+						|| duration.isNonNegative();
+				if (!(timedQ && linestart.isNonNegative())) {
+					pending[origin-1].emplace_back(token, starts[j]);
+					continue;
+				}
+				offsets[origin-1] = linestart - starts[j];
+				for (auto& item : pending[origin-1]) {
+					if (!setLineDurationFromStart(item.first,
+							item.second + offsets[origin-1])) {
+						return isValid();
+					}
+				}
+				pending[origin-1].clear();
+			}
+			starts[j] += offsets[origin-1];
+			ends[j] += offsets[origin-1];
+			endorigins[j] = 0;
+			if (!setLineDurationFromStart(token, starts[j])) { return isValid(); }
 		}
+
+		lastends.swap(ends);
+		lastorigins.swap(endorigins);
+		lastline = i;
 	}
 
-	if (!analyzeNullLineRhythms()) { return false; }
-	fillInNegativeStartTimes();
-	assignLineDurations();
-	if (!analyzeMeter()) { return false; }
-	if (!analyzeNonNullDataTokens()) { return false; }
+	for (int i=0; i<(int)offsets.size(); i++) {
+		if (offsets[i].isNegative()) {
+			return setParseError("Error cannot link floating spine to score.");
+		}
+	}
 
-	return true;
+	return isValid();
 }
 
 
@@ -997,90 +1178,6 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
-//
-
-bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
-		HumNum startdur) {
-	if (!starttoken->hasRhythm()) {
-		return isValid();
-	}
-	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
-	}
-	return isValid();
-}
-
-
-
-//////////////////////////////
-//
-// HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
-//
-
-bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
-	if (state != token->getState()) {
-		return isValid();
-	}
-
-	HumNum dursum = startdur;
-	token->incrementState();
-
-	if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	if (token->getDuration().isPositive()) {
-		dursum += token->getDuration();
-	}
-	int tcount = token->getNextTokenCount();
-
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
-
-	// Assign line durationFromStarts for primary track first.
-	while (tcount > 0) {
-		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
-		}
-		token = token->getNextToken(0);
-		if (state != token->getState()) {
-			break;
-		}
-		token->incrementState();
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-		if (token->getDuration().isPositive()) {
-			dursum += token->getDuration();
-		}
-		tcount = token->getNextTokenCount();
-	}
-
-	if ((tcount == 0) && (token->isTerminateInterpretation())) {
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	}
-
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::setLineDurationFromStart -- Set the duration of
@@ -1112,54 +1209,6 @@ bool HumdrumFileStructure::setLineDurationFromStart(HTp token,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::analyzeRhythmOfFloatingSpine --  This analysis
-//    function is used to analyze the rhythm of spines which do not start at
-//    the beginning of the data.  The function searches for the first line
-//    which has an assigned durationFromStart value, and then uses that
-//    as the basis for assigning the initial durationFromStart position
-//    for the spine.
-//
-
-bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
-		HTp spinestart) {
-	HumNum dursum = 0;
-	HumNum founddur = 0;
-	HTp token = spinestart;
-	int tcount = token->getNextTokenCount();
-
-	// Find a known durationFromStart for a line in the Humdrum file, then
-	// use that to calculate the starting duration of the floating spine.
-	if (token->getDurationFromStart().isNonNegative()) {
-		founddur = token->getLine()->getDurationFromStart();
-	} else {
-		tcount = token->getNextTokenCount();
-		while (tcount > 0) {
-			if (token->getDurationFromStart().isNonNegative()) {
-				founddur = token->getLine()->getDurationFromStart();
-				break;
-			}
-			if (token->getDuration().isPositive()) {
-				dursum += token->getDuration();
-			}
-			token = token->getNextToken(0);
-		}
-	}
-
-	if (founddur.isZero()) {
-		return setParseError("Error cannot link floating spine to score.");
-	}
-
-	if (!assignDurationsToTrack(spinestart, founddur - dursum)) {
-		return isValid();
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeNullLineRhythms -- When a series of null-token
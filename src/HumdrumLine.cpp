@@ -12,6 +12,7 @@
 //
 
 #include "Convert.h"
+#include "HumJsonWriter.h"
 #include "HumNum.h"
 #include "HumdrumFile.h"
 #include "HumdrumLine.h"
@@ -1291,6 +1292,7 @@ int HumdrumLine::createTokensFromLine(void) {
 	}
 	m_tokens.clear();
 	m_tabs.clear();
+	invalidateTrackIndex();
 	HTp token;
 	char ch = 0;
 	char lastch = 0;
@@ -1353,6 +1355,7 @@ int HumdrumLine::createTokensFromLine(void) {
 
 void HumdrumLine::createLineFromTokens(void) {
 	string& iline = *this;
+	bool emptyQ = iline.empty();
 	iline = "";
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
@@ -1376,6 +1379,10 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	if (iline.empty() != emptyQ) {
+		// empty lines are not in the owner's track index:
+		invalidateTrackIndex();
+	}
 }
 
 
@@ -1757,22 +1764,22 @@ ostream& HumdrumLine::printXml(ostream& out, int level, const string& indent) {
 		bool bend   = isKernBoundaryEnd();
 		if (bstart || bend) {
 			out << Convert::repeatString(indent, level);
-			cout << "<kernBoundary";
-			cout << " start=\"";
+			out << "<kernBoundary";
+			out << " start=\"";
 			if (bstart) {
-				cout << "true";
+				out << "true";
 			} else {
-				cout << "false";
+				out << "false";
 			}
-			cout << "\"";
-			cout << " end=\"";
+			out << "\"";
+			out << " end=\"";
 			if (bend) {
-				cout << "true";
+				out << "true";
 			} else {
-				cout << "false";
+				out << "false";
 			}
-			cout << "\"";
-			cout << "/>\n";
+			out << "\"";
+			out << "/>\n";
 		}
 
 		level--;
@@ -1874,6 +1881,139 @@ ostream& HumdrumLine::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::printJson -- Write the line as a JSON object.  Lines with
+//    spines contain a "tokens" array (if FIELD_TOKENS is selected); other
+//    lines contain the text of the line and reference record information.
+//
+
+void HumdrumLine::printJson(HumJsonWriter& json, int fields) {
+	bool linesQ  = fields & HumJsonWriter::FIELD_LINES;
+	bool tokensQ = fields & HumJsonWriter::FIELD_TOKENS;
+	bool rhythmQ = fields & HumJsonWriter::FIELD_RHYTHM;
+	bool paramQ  = fields & HumJsonWriter::FIELD_PARAMETERS;
+
+	json.beginObject();
+	json.writeKey("n");
+	json.writeInt(getLineIndex());
+	json.writeKey("id");
+	json.writeLineId(getLineIndex());
+
+	if (hasSpines()) {
+		if (linesQ) {
+			json.writeKey("type");
+			if (isData()) {
+				json.writeString("data");
+			} else if (isBarline()) {
+				json.writeString("barline");
+			} else if (isInterpretation()) {
+				json.writeString("interpretation");
+			} else if (isLocalComment()) {
+				json.writeString("local-comment");
+			}
+			json.writeKey("fieldCount");
+			json.writeInt(getFieldCount());
+			if (!tokensQ) {
+				json.writeKey("text");
+				json.writeString(*this);
+			}
+			bool bstart = isKernBoundaryStart();
+			bool bend   = isKernBoundaryEnd();
+			if (bstart || bend) {
+				json.writeKey("kernBoundary");
+				json.beginObject();
+				json.writeKey("start");
+				json.writeBool(bstart);
+				json.writeKey("end");
+				json.writeBool(bend);
+				json.endObject();
+			}
+		}
+		if (rhythmQ) {
+			json.writeKey("start");
+			json.writeNumber(getDurationFromStart());
+			json.writeKey("duration");
+			json.writeNumber(getDuration());
+			if (isBarline()) {
+				json.writeKey("barlineDuration");
+				json.writeNumber(getBarlineDuration());
+			}
+		}
+		if (paramQ) {
+			((HumHash*)this)->printJson(json);
+		}
+		if (tokensQ) {
+			json.writeKey("tokens");
+			json.beginArray();
+			for (int i=0; i<getFieldCount(); i++) {
+				token(i)->printJson(json, fields);
+			}
+			json.endArray();
+		}
+	} else {
+		if (linesQ) {
+			json.writeKey("type");
+			if (isGlobalReference()) {
+				json.writeString("reference");
+			} else if (isUniversalReference()) {
+				json.writeString("ureference");
+			} else if (isBlank()) {
+				json.writeString("empty");
+			} else {
+				json.writeString("global-comment");
+			}
+			json.writeKey("text");
+			json.writeString(*this);
+
+			if (isReference()) {
+				string key = getReferenceKey();
+				string language;
+				bool primaryQ = false;
+				auto loc = key.find("@@");
+				if (loc != string::npos) {
+					language = key.substr(loc+2);
+					key = key.substr(0, loc);
+					primaryQ = true;
+				} else {
+					loc = key.find("@");
+					if (loc != string::npos) {
+						language = key.substr(loc+1);
+						key = key.substr(0, loc);
+					}
+				}
+				json.writeKey("referenceKey");
+				json.writeString(key);
+				if (!language.empty()) {
+					json.writeKey("language");
+					json.writeString(language);
+				}
+				if (primaryQ) {
+					json.writeKey("primary");
+					json.writeBool(true);
+				}
+				json.writeKey("referenceValue");
+				json.writeString(getGlobalReferenceValue());
+			}
+		}
+		if (rhythmQ) {
+			json.writeKey("start");
+			json.writeNumber(getDurationFromStart());
+		}
+		if (paramQ) {
+			((HumHash*)this)->printJson(json);
+			if (getTokenCount() > 0) {
+				// global comment parameters are stored in the only token:
+				((HumHash*)token(0))->printJson(json, "globalParameters");
+			}
+		}
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getXmlId -- Return a unique ID for the current line.
@@ -1957,6 +2097,21 @@ void HumdrumLine::setOwner(void* hfile) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::invalidateTrackIndex -- Tell the owning file that the
+//    tokens of the line have changed, so that its track index (used by
+//    HumTrackView) needs to be rebuilt.
+//
+
+void HumdrumLine::invalidateTrackIndex(void) {
+	if (m_owner) {
+		((HumdrumFileBase*)m_owner)->invalidateTrackIndex();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getOwner -- Return the HumdrumFile which manages
@@ -2049,6 +2204,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2056,6 +2212,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2063,6 +2220,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2070,6 +2228,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2105,6 +2264,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2112,6 +2272,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2119,6 +2280,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -2126,6 +2288,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	invalidateTrackIndex();
 }
 
 
@@ -0,0 +1,746 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 13:41:09 PDT 2026
+// Last Modified: Sat Oct 17 13:41:09 PDT 2026
+// Filename:      HumdrumLineStream.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumLineStream.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read Humdrum data one line at a time, keeping track
+//                of the spine structure (*^, *v, *x, *+, *-) incrementally
+//                so that each line can be given to a filter with its
+//                track and subtrack information and then discarded.
+//
+
+#include "HumdrumFileBase.h"
+#include "HumdrumLineStream.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::HumdrumLineStream --
+//
+
+HumdrumLineStream::HumdrumLineStream(void) {
+	// do nothing
+}
+
+HumdrumLineStream::HumdrumLineStream(const vector<string>& list) {
+	setFileList(list);
+}
+
+HumdrumLineStream::HumdrumLineStream(Options& options) {
+	vector<string> list;
+	options.getArgList(list);
+	setFileList(list);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::setFileList -- Set the list of files to read.  If
+//    the list is empty, then standard input will be read.
+//
+
+int HumdrumLineStream::setFileList(const vector<string>& list) {
+	m_filelist = list;
+	m_curfile = -1;
+	m_input = NULL;
+	m_stringQ = false;
+	return (int)m_filelist.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::loadString -- Read the data from a string rather
+//    than from files or standard input.
+//
+
+void HumdrumLineStream::loadString(const string& data) {
+	m_filelist.clear();
+	m_curfile = -1;
+	m_stringbuffer.str(data);
+	m_stringbuffer.clear();
+	m_input = NULL;
+	m_stringQ = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::readLine -- Read the next line of the input and
+//    analyze its spine structure.  Returns false when there is no more
+//    input.  Segments are split in the same manner as HumdrumFileStream:
+//    at the start of each file, at !!!!SEGMENT records and when a second
+//    exclusive interpretation line is found.  Universal comments at the
+//    start of a segment are demoted to global comments and repeated at
+//    the start of each following segment.  Lines which do not start with
+//    "*" or "!" outside of the spine data are considered to be the names
+//    of additional files to read.
+//
+
+bool HumdrumLineStream::readLine(void) {
+	string line;
+	while (true) {
+		if (!m_output.empty()) {
+			line = m_output.front();
+			m_output.erase(m_output.begin());
+			bool valid = isValid();
+			if (!analyzeLine(line) && valid) {
+				// Report the first spine error in the segment.
+				cerr << m_parseError << endl;
+			}
+			return true;
+		}
+
+		if (!getRawLine(line)) {
+			return false;
+		}
+
+		if ((line.compare(0, 11, "!!!!SEGMENT") == 0) && m_dataFound) {
+			startSegment();
+		}
+		if (line.compare(0, 2, "**") == 0) {
+			if (m_starstarFound) {
+				startSegment();
+			}
+			m_starstarFound = true;
+		}
+
+		int len = (int)line.size();
+		if ((len > 4) && (line.compare(0, 4, "!!!!") == 0) &&
+				(line[4] != '!') && !m_dataFound &&
+				(line.compare(0, 11, "!!!!filter:") != 0) &&
+				(line.compare(0, 12, "!!!!SEGMENT:") != 0)) {
+			// Universal comment which replaces any universal comments
+			// from previous segments.
+			if (!m_newUniversals) {
+				m_universals.clear();
+				m_newUniversals = true;
+			}
+			m_universals.push_back(line);
+			continue;
+		}
+
+		if (line.compare(0, 2, "*-") == 0) {
+			m_starminusFound = true;
+		}
+
+		if ((m_starminusFound || !m_starstarFound) && !line.empty() &&
+				(line[0] != '*') && (line[0] != '!') && (line[0] != ' ')) {
+			// Filename to add to the input list.
+			if (find(m_filelist.begin(), m_filelist.end(), line) == m_filelist.end()) {
+				m_filelist.push_back(line);
+			}
+			continue;
+		}
+
+		if (!m_dataFound) {
+			m_dataFound = true;
+			for (int i=0; i<(int)m_universals.size(); i++) {
+				if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
+					continue;
+				}
+				m_output.push_back(m_universals[i].substr(1));
+			}
+		}
+		m_output.push_back(line);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getRawLine -- Read the next line from the current
+//    input, opening the next input file if necessary.  The empty line
+//    after the last newline of an input is not returned.
+//
+
+bool HumdrumLineStream::getRawLine(string& line) {
+	while (true) {
+		if (m_input == NULL) {
+			if (!openNextInput()) {
+				return false;
+			}
+			startSegment();
+		}
+		if (getline(*m_input, line)) {
+			if (m_input->eof() && line.empty()) {
+				m_input = NULL;
+				continue;
+			}
+			return true;
+		}
+		m_input = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::openNextInput -- Returns false if there is no more
+//    input to read.
+//
+
+bool HumdrumLineStream::openNextInput(void) {
+	if (m_stringQ) {
+		if (m_curfile >= 0) {
+			return false;
+		}
+		m_curfile = 0;
+		m_filename = "";
+		m_input = &m_stringbuffer;
+		return true;
+	}
+
+	if (m_filelist.empty()) {
+		if (m_curfile >= 0) {
+			return false;
+		}
+		m_curfile = 0;
+		m_filename = "";
+		m_input = &cin;
+		return true;
+	}
+
+	while (m_curfile < (int)m_filelist.size() - 1) {
+		m_curfile++;
+		if (m_instream.is_open()) {
+			m_instream.close();
+		}
+		m_filename = m_filelist[m_curfile];
+		if (m_filename.find("://") != string::npos) {
+			#ifdef USING_URI
+				m_stringbuffer.str("");
+				m_stringbuffer.clear();
+				string webaddress = HumdrumFileBase::getUriToUrlMapping(m_filename);
+				HumdrumFileBase::readStringFromHttpUri(m_stringbuffer, webaddress);
+				m_input = &m_stringbuffer;
+				return true;
+			#else
+				continue;
+			#endif
+		}
+		m_instream.clear();
+		m_instream.open(m_filename);
+		if (!m_instream.is_open()) {
+			// Silently skip files which cannot be opened.
+			continue;
+		}
+		m_input = &m_instream;
+		return true;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::startSegment -- Prepare for reading a new segment.
+//
+
+void HumdrumLineStream::startSegment(void) {
+	m_dataFound      = false;
+	m_starstarFound  = false;
+	m_starminusFound = false;
+	m_newUniversals  = false;
+	m_segmentPending = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::reset -- Clear the spine structure in preparation
+//    for a new segment.
+//
+
+void HumdrumLineStream::reset(void) {
+	m_datatype.clear();
+	m_sinfo.clear();
+	m_strack.clear();
+	m_init        = false;
+	m_manipulator = false;
+	m_exclusiveStart = false;
+	m_maxtrack    = 0;
+	m_lineindex   = -1;
+	m_addOpen     = false;
+	m_parseError.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeLine -- Set the contents of the current line
+//    and calculate its track information from the spine manipulators
+//    on previous lines.  Returns false if there is a spine structure error.
+//    This function can be used directly (without readLine) to analyze
+//    lines from another source one at a time.
+//
+
+bool HumdrumLineStream::analyzeLine(const string& line) {
+	if (m_segmentPending) {
+		reset();
+		m_segment++;
+		m_segmentStart = true;
+		m_segmentPending = false;
+	} else {
+		m_segmentStart = false;
+		if (m_manipulator && !m_exclusiveStart && isValid()) {
+			// Spine manipulators on the previous line change the spine
+			// structure of this line.
+			adjustSpines();
+		}
+	}
+
+	m_line = line;
+	if (!m_line.empty() && (m_line.back() == 0x0d)) {
+		m_line.resize(m_line.size() - 1);
+	}
+	m_lineindex++;
+	tokenizeLine();
+	analyzeSpines();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::tokenizeLine -- Split the current line into tokens
+//    in the same manner as HumdrumLine::createTokensFromLine().
+//
+
+void HumdrumLineStream::tokenizeLine(void) {
+	m_tokens.clear();
+	if (m_line.empty() || (m_line.compare(0, 2, "!!") == 0)) {
+		m_tokens.push_back(m_line);
+		return;
+	}
+	size_t start = 0;
+	while (true) {
+		size_t tab = m_line.find('\t', start);
+		if (tab == string::npos) {
+			if (start < m_line.size()) {
+				m_tokens.emplace_back(m_line, start);
+			}
+			break;
+		}
+		m_tokens.emplace_back(m_line, start, tab - start);
+		start = m_line.find_first_not_of('\t', tab);
+		if (start == string::npos) {
+			break;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeSpines -- Assign spine information to the
+//    tokens on the current line.
+//
+
+void HumdrumLineStream::analyzeSpines(void) {
+	int count = (int)m_tokens.size();
+	m_manipulator = false;
+	m_exclusiveStart = false;
+	if (isInterpretation()) {
+		for (int i=0; i<count; i++) {
+			if (isManipulator(m_tokens[i])) {
+				m_manipulator = true;
+				break;
+			}
+		}
+	}
+	m_linetracks.assign(count, 0);
+	m_linesubtracks.assign(count, 0);
+	if (!hasSpines() || !isValid()) {
+		return;
+	}
+
+	if (!m_init) {
+		if (!isExclusive()) {
+			stringstream err;
+			err << "Error on line: " << (m_lineindex+1) << ':' << endl;
+			err << "   Data found before exclusive interpretation" << endl;
+			err << "   LINE: " << m_line;
+			setParseError(err.str());
+			return;
+		}
+		// The starting exclusive interpretations define the spines
+		// rather than manipulating them.
+		m_init = true;
+		m_exclusiveStart = true;
+		m_datatype = m_tokens;
+		m_sinfo.resize(count);
+		m_strack.resize(count);
+		for (int i=0; i<count; i++) {
+			m_sinfo[i] = to_string(i+1);
+			m_strack[i] = i+1;
+		}
+		m_maxtrack = count;
+		analyzeTracks();
+		return;
+	}
+
+	if ((int)m_sinfo.size() != count) {
+		stringstream err;
+		err << "Error on line " << (m_lineindex+1) << ':' << endl;
+		err << "   Expected " << m_sinfo.size() << " fields,"
+		    << "    but found " << count;
+		err << "\nLine is: " << m_line << endl;
+		setParseError(err.str());
+		return;
+	}
+
+	analyzeTracks();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::analyzeTracks -- Calculate the track and subtrack of
+//    each token on the line.  Subtracks index subspines from left to right
+//    on the line, and are 0 if a track is not split.
+//
+
+void HumdrumLineStream::analyzeTracks(void) {
+	int count = (int)m_tokens.size();
+	m_subtrackcount.assign(m_maxtrack + 1, 0);
+	m_subtrackindex.assign(m_maxtrack + 1, 0);
+	for (int i=0; i<count; i++) {
+		m_linetracks[i] = m_strack[i];
+		m_subtrackcount[m_strack[i]]++;
+	}
+	for (int i=0; i<count; i++) {
+		int track = m_linetracks[i];
+		if (m_subtrackcount[track] > 1) {
+			m_linesubtracks[i] = ++m_subtrackindex[track];
+		} else {
+			m_linesubtracks[i] = 0;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::adjustSpines -- Update the spine structure for the
+//    manipulators on the current line (in the same manner as
+//    HumdrumFileBase::adjustSpines()).
+//
+
+bool HumdrumLineStream::adjustSpines(void) {
+	vector<string> newtype;
+	vector<string> newinfo;
+	int count = (int)m_tokens.size();
+	newtype.reserve(count + 1);
+	newinfo.reserve(count + 1);
+	for (int i=0; i<count; i++) {
+		const string& token = m_tokens[i];
+		if (token == "*^") {
+			newtype.push_back(m_datatype[i]);
+			newtype.push_back(m_datatype[i]);
+			newinfo.push_back('(' + m_sinfo[i] + ")a");
+			newinfo.push_back('(' + m_sinfo[i] + ")b");
+		} else if (token == "*v") {
+			int mergecount = 0;
+			for (int j=i+1; j<count; j++) {
+				if (m_tokens[j] == "*v") {
+					mergecount++;
+				} else {
+					break;
+				}
+			}
+			newinfo.push_back(HumdrumFileBase::getMergedSpineInfo(m_sinfo, i, mergecount));
+			newtype.push_back(m_datatype[i]);
+			i += mergecount;
+		} else if (token == "*+") {
+			newtype.push_back(m_datatype[i]);
+			newtype.push_back("");
+			newinfo.push_back(m_sinfo[i]);
+			newinfo.push_back(to_string(++m_maxtrack));
+			m_addOpen = true;
+		} else if (token == "*x") {
+			if (i < count - 1) {
+				newtype.push_back(m_datatype[i+1]);
+				newtype.push_back(m_datatype[i]);
+				newinfo.push_back(m_sinfo[i+1]);
+				newinfo.push_back(m_sinfo[i]);
+				i++;
+			} else {
+				stringstream err;
+				err << "ERROR2 in *x calculation" << endl;
+				err << "Index " << i << " larger than allowed: " << count - 1;
+				return setParseError(err.str());
+			}
+		} else if (token == "*-") {
+			// spine is terminated
+		} else if (token.compare(0, 2, "**") == 0) {
+			if (!m_addOpen) {
+				stringstream err;
+				err << "Error: Exclusive interpretation with no preparation "
+				    << "on line " << m_lineindex << " spine index " << i << endl;
+				err << "Line: " << m_line;
+				return setParseError(err.str());
+			}
+			m_addOpen = false;
+			newtype.push_back(token);
+			newinfo.push_back(m_sinfo[i]);
+		} else {
+			newtype.push_back(m_datatype[i]);
+			newinfo.push_back(m_sinfo[i]);
+		}
+	}
+
+	m_datatype.swap(newtype);
+	m_sinfo.swap(newinfo);
+	m_strack.resize(m_sinfo.size());
+	for (int i=0; i<(int)m_sinfo.size(); i++) {
+		m_strack[i] = getTrackFromSpineInfo(m_sinfo[i]);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getTrackFromSpineInfo -- The track is the first
+//    number in the spine info string.
+//
+
+int HumdrumLineStream::getTrackFromSpineInfo(const string& info) {
+	int track = 0;
+	size_t i = info.find_first_of("0123456789");
+	if (i == string::npos) {
+		return 0;
+	}
+	while ((i < info.size()) && isdigit(info[i])) {
+		track = track * 10 + (info[i] - '0');
+		i++;
+	}
+	return track;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::setParseError -- Store the first error found in the
+//    spine structure of the current segment.  Tracks are not calculated
+//    for the rest of the segment after an error.
+//
+
+bool HumdrumLineStream::setParseError(const string& err) {
+	if (m_parseError.empty()) {
+		m_parseError = err;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getTrack -- Return the track number of the given
+//    token on the current line.
+//
+
+int HumdrumLineStream::getTrack(int index) const {
+	return m_linetracks.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getSubtrack -- Return the subtrack number of the
+//    given token on the current line (0 if the track is not split).
+//
+
+int HumdrumLineStream::getSubtrack(int index) const {
+	return m_linesubtracks.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getSpineInfo -- Return the spine info string of the
+//    given token on the current line, such as "1" or "(2)a".
+//
+
+const string& HumdrumLineStream::getSpineInfo(int index) const {
+	static const string empty;
+	if (!hasSpines() || !isValid() || (index >= (int)m_sinfo.size())) {
+		return empty;
+	}
+	return m_sinfo[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::getDataType -- Return the exclusive interpretation
+//    of the spine for the given token on the current line.
+//
+
+const string& HumdrumLineStream::getDataType(int index) const {
+	static const string empty;
+	if (!hasSpines() || !isValid() || (index >= (int)m_datatype.size())) {
+		return empty;
+	}
+	return m_datatype[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isData -- Returns true if data (but not measure).
+//
+
+bool HumdrumLineStream::isData(void) const {
+	return !(isComment() || isInterpretation() || isBarline() || isEmpty());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isReference -- Returns true if a global or universal
+//    reference record (!!!KEY: VALUE or !!!!KEY: VALUE).
+//
+
+bool HumdrumLineStream::isReference(void) const {
+	if (m_line.size() < 5) {
+		return false;
+	}
+	if (m_line.compare(0, 3, "!!!") != 0) {
+		return false;
+	}
+	if ((m_line[3] == '!') && (m_line[4] == '!')) {
+		return false;
+	}
+	size_t spaceloc = m_line.find(" ");
+	size_t tabloc = m_line.find("\t");
+	size_t colloc = m_line.find(":");
+	if (colloc == string::npos) {
+		return false;
+	}
+	if ((spaceloc != string::npos) && (spaceloc < colloc)) {
+		return false;
+	}
+	if ((tabloc != string::npos) && (tabloc < colloc)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isAllNull -- Returns true if all tokens on the line
+//    are null ("." if a data line, "*" if an interpretation line, "!"
+//    if a local comment line).
+//
+
+bool HumdrumLineStream::isAllNull(void) const {
+	if (!hasSpines()) {
+		return false;
+	}
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		const string& token = m_tokens[i];
+		if ((token != ".") && (token != "*") && (token != "!")) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::equalFieldsQ -- Returns true if all tokens on the
+//    line are in spines of the given exclusive interpretation and are
+//    equal to the given value.
+//
+
+bool HumdrumLineStream::equalFieldsQ(const string& exinterp,
+		const string& value) const {
+	for (int i=0; i<(int)m_tokens.size(); i++) {
+		const string& datatype = getDataType(i);
+		if (exinterp.compare(0, 2, "**") == 0) {
+			if (datatype != exinterp) {
+				return false;
+			}
+		} else if ((datatype.size() < 2) || (datatype.compare(2, string::npos, exinterp) != 0)) {
+			return false;
+		}
+		if (m_tokens[i] != value) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLineStream::isManipulator -- Returns true if the token is a
+//    spine manipulator (*^, *v, *x, *+, *- or an exclusive interpretation).
+//
+
+bool HumdrumLineStream::isManipulator(const string& token) {
+	if (token.compare(0, 2, "**") == 0) {
+		return true;
+	}
+	if ((token.size() != 2) || (token[0] != '*')) {
+		return false;
+	}
+	switch (token[1]) {
+		case '^':
+		case 'v':
+		case 'x':
+		case '+':
+		case '-':
+			return true;
+	}
+	return false;
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -32,22 +32,27 @@ namespace hum {
 //
 
 void HumdrumToken::getBase40Pitches(vector<int>& output) {
-	if (*this == ".") {
+	if ((*this == ".") || empty()) {
 		// Not resolving null tokens in this function.
 		output.clear();
 		return;
 	}
-	vector<string> pieces = this->getSubtokens();
+	HumSubtokenView pieces = this->getSubtokenView();
 	output.resize(pieces.size());
-	for (int i=0; i<(int)pieces.size(); i++) {
-		if (pieces[i].find("r") != string::npos) {
+	for (const HumSubtoken& piece : pieces) {
+		int i = piece.getIndex();
+		if (piece.contains('r')) {
 			output[i] = 0;
 		} else {
-			output[i] = Convert::kernToBase40(pieces[i]);
+			if (pieces.isKern()) {
+				output[i] = piece.getBase40();
+			} else {
+				output[i] = Convert::kernToBase40(piece.getString());
+			}
 			// sustained notes are negative values:
-			if (pieces[i].find("_") != string::npos) {
+			if (piece.contains('_')) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("]") != string::npos) {
+			} else if (piece.contains(']')) {
 				output[i] = -output[i];
 			}
 		}
@@ -149,22 +154,27 @@ void HumdrumToken::getBase40PitchesResolveNull(vector<int>& output) {
 	if (token == NULL) {
 		return;
 	}
-	if (*token == ".") {
+	if ((*token == ".") || token->empty()) {
 		return;
 	}
-	vector<string> pieces = token->getSubtokens();
+	HumSubtokenView pieces = token->getSubtokenView();
 	output.resize(pieces.size());
-	for (int i=0; i<(int)pieces.size(); i++) {
-		if (pieces[i].find("r") != string::npos) {
+	for (const HumSubtoken& piece : pieces) {
+		int i = piece.getIndex();
+		if (piece.contains('r')) {
 			output[i] = 0;
 		} else {
-			output[i] = Convert::kernToBase40(pieces[i]);
+			if (pieces.isKern()) {
+				output[i] = piece.getBase40();
+			} else {
+				output[i] = Convert::kernToBase40(piece.getString());
+			}
 			// sustained notes are negative values:
 			if (nullQ) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("_") != string::npos) {
+			} else if (piece.contains('_')) {
 				output[i] = -output[i];
-			} else if (pieces[i].find("]") != string::npos) {
+			} else if (piece.contains(']')) {
 				output[i] = -output[i];
 			}
 		}
@@ -12,6 +12,7 @@
 
 #include "Convert.h"
 #include "HumAddress.h"
+#include "HumJsonWriter.h"
 #include "HumRegex.h"
 #include "HumdrumFile.h"
 #include "HumdrumLine.h"
@@ -51,7 +52,6 @@ HumdrumToken::HumdrumToken(void) : string() {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -60,7 +60,6 @@ HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -69,7 +68,6 @@ HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
-	m_strophe     = NULL;
 }
 
 
@@ -85,7 +83,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token.getPrefix());
 }
 
@@ -102,7 +99,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token) :
 	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token->getPrefix());
 }
 
@@ -120,7 +116,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token, HLp owner) :
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token.getPrefix());
 }
 
@@ -137,7 +132,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token, HLp owner) :
 	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
 	setPrefix(token->getPrefix());
 }
 
@@ -165,7 +159,7 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix(token.getPrefix());
 
 	return *this;
@@ -184,7 +178,7 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix("!");
 
 	return *this;
@@ -203,7 +197,7 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
-	m_strophe         = NULL;
+	clearStrophe();
 	setPrefix("!");
 
 	return *this;
@@ -217,13 +211,28 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 //
 
 HumdrumToken::~HumdrumToken() {
-	if (m_parameterSet) {
-		delete m_parameterSet;
-		m_parameterSet = NULL;
+	if (m_cold) {
+		delete m_cold;
+		m_cold = NULL;
 	}
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumToken::getColdData -- Return the rarely used data for the token,
+//     allocating it if necessary.
+//
+
+HumdrumToken::ColdData& HumdrumToken::getColdData(void) {
+	if (!m_cold) {
+		m_cold = new ColdData;
+	}
+	return *m_cold;
+}
+
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -534,6 +543,19 @@ void HumdrumToken::setSpineInfo(const string& spineinfo) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::shareSpineInfo -- Use the spine info string of another
+//    token (which has the same spine info) rather than a copy of it.
+// @SEEALTO: setSpineInfo
+//
+
+void HumdrumToken::shareSpineInfo(HTp token) {
+	m_address.shareSpineInfo(token->m_address);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getSpineInfo -- Returns the spine split/merge history
@@ -773,7 +795,7 @@ HTp HumdrumToken::getNextToken(int index) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
-	return m_nextTokens;
+	return m_nextTokens.toVector();
 }
 
 
@@ -785,7 +807,7 @@ vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
-	return m_previousTokens;
+	return m_previousTokens.toVector();
 }
 
 
@@ -1346,9 +1368,9 @@ bool HumdrumToken::isRest(void) {
 			// token is a chord (rests in chords are used for non-sounding
 			// notes in artificial harmonics).
 			return false;
-		} else if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
+		} else if (isNull() && Convert::isKernRest(*resolveNull())) {
 			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
+		} else if (Convert::isKernRest(*this)) {
 			return true;
 		}
 	} else if (isMensLike()) {
@@ -1377,7 +1399,7 @@ bool HumdrumToken::isNote(void) {
 		return false;
 	}
 	if (isKernLike()) {
-		if (Convert::isKernNote((string)(*this))) {
+		if (Convert::isKernNote(*this)) {
 			return true;
 		}
 	} else if (isMensLike()) {
@@ -2005,7 +2027,7 @@ string HumdrumToken::getInstrumentAbbreviation(void) {
 
 bool HumdrumToken::hasSlurStart(void) {
 	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
+		if (Convert::hasKernSlurStart(*this)) {
 			return true;
 		}
 	}
@@ -2022,7 +2044,7 @@ bool HumdrumToken::hasSlurStart(void) {
 
 bool HumdrumToken::hasSlurEnd(void) {
 	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
+		if (Convert::hasKernSlurEnd(*this)) {
 			return true;
 		}
 	}
@@ -2238,7 +2260,7 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
 	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
+		if (Convert::isKernSecondaryTiedNote(*this)) {
 			return true;
 		}
 	}
@@ -2524,7 +2546,7 @@ bool HumdrumToken::isAddInterpretation(void) const {
 //
 
 bool HumdrumToken::isNull(void) const {
-	const string& tok = (string)(*this);
+	const string& tok = *this;
 	if (tok == NULL_DATA)           { return true; }
 	if (tok == NULL_INTERPRETATION) { return true; }
 	if (tok == NULL_COMMENT_LOCAL)  { return true; }
@@ -2682,6 +2704,28 @@ std::vector<std::string> HumdrumToken::getSubtokens (const std::string& separato
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getSubtokenView -- Return a view of the subtokens in the
+//     token which can be iterated without allocating strings.  Subtokens
+//     separated by spaces include the **kern record of each note:
+//
+//        for (auto& note : token->getSubtokenView()) {
+//           if (note.isNote()) {
+//              int b40 = note.getBase40();
+//              ...
+//           }
+//        }
+//
+//     default value: separator = " "
+//
+
+HumSubtokenView HumdrumToken::getSubtokenView(const string& separator) const {
+	return HumSubtokenView(*this, separator);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::replaceSubtoken --
@@ -2796,23 +2840,24 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 		// will also be suppressed by this if statement.
 		return -1;
 	}
-	for (int i=0; i<(int)m_linkedParameterTokens.size(); i++) {
-		if (m_linkedParameterTokens[i] == token) {
+	vector<HTp>& linkedParameterTokens = getColdData().m_linkedParameterTokens;
+	for (int i=0; i<(int)linkedParameterTokens.size(); i++) {
+		if (linkedParameterTokens[i] == token) {
 			return i;
 		}
 	}
 
-	if (m_linkedParameterTokens.empty()) {
-		m_linkedParameterTokens.push_back(token);
+	if (linkedParameterTokens.empty()) {
+		linkedParameterTokens.push_back(token);
 	} else {
 		int lineindex = token->getLineIndex();
-		if (lineindex >= m_linkedParameterTokens.back()->getLineIndex()) {
-			m_linkedParameterTokens.push_back(token);
+		if (lineindex >= linkedParameterTokens.back()->getLineIndex()) {
+			linkedParameterTokens.push_back(token);
 		} else {
 			// Store sorted by line number
-			for (auto it = m_linkedParameterTokens.begin(); it != m_linkedParameterTokens.end(); it++) {
+			for (auto it = linkedParameterTokens.begin(); it != linkedParameterTokens.end(); it++) {
 				if (lineindex < (*it)->getLineIndex()) {
-					m_linkedParameterTokens.insert(it, token);
+					linkedParameterTokens.insert(it, token);
 					break;
 				}
 			}
@@ -2820,7 +2865,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 
 	}
 
-	return (int)m_linkedParameterTokens.size() - 1;
+	return (int)linkedParameterTokens.size() - 1;
 }
 
 
@@ -2831,7 +2876,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
-	return m_linkedParameterTokens.at(index)->isCommentGlobal();
+	return getLinkedParameterToken(index)->isCommentGlobal();
 }
 
 
@@ -2842,7 +2887,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
-	return (int)m_linkedParameterTokens.size();
+	return m_cold ? (int)m_cold->m_linkedParameterTokens.size() : 0;
 }
 
 
@@ -2853,7 +2898,7 @@ int HumdrumToken::getLinkedParameterSetCount(void) {
 //
 
 HumParamSet* HumdrumToken::getParameterSet(void) {
-	return m_parameterSet;
+	return m_cold ? m_cold->m_parameterSet : NULL;
 }
 
 
@@ -2864,7 +2909,22 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
-	return m_linkedParameterTokens.at(index)->getParameterSet();
+	return getLinkedParameterToken(index)->getParameterSet();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getLinkedParameterToken -- Return the token containing
+//     the given linked parameter.
+//
+
+HTp HumdrumToken::getLinkedParameterToken(int index) {
+	if (!m_cold) {
+		throw out_of_range("HumdrumToken::getLinkedParameterToken: no linked parameters");
+	}
+	return m_cold->m_linkedParameterTokens.at(index);
 }
 
 
@@ -2876,14 +2936,14 @@ HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
 //
 
 void HumdrumToken::storeParameterSet(void) {
-	if (m_parameterSet) {
-		delete m_parameterSet;
-		m_parameterSet = NULL;
+	if (m_cold && m_cold->m_parameterSet) {
+		delete m_cold->m_parameterSet;
+		m_cold->m_parameterSet = NULL;
 	}
 	if (this->isCommentLocal() && (this->find(':') != string::npos)) {
-		m_parameterSet = new HumParamSet(this);
+		getColdData().m_parameterSet = new HumParamSet(this);
 	} else if (this->isCommentGlobal() && (this->find(':') != string::npos)) {
-		m_parameterSet = new HumParamSet(this);
+		getColdData().m_parameterSet = new HumParamSet(this);
 	}
 }
 
@@ -2905,7 +2965,9 @@ void HumdrumToken::clearLinkInfo(void) {
 	// }
 
 	// also clear linked parameters
-	m_linkedParameterTokens.clear();
+	if (m_cold) {
+		m_cold->m_linkedParameterTokens.clear();
+	}
 
 	// clear pointers to adjacent tokens
 	m_nextTokens.clear();
@@ -3410,7 +3472,10 @@ int  HumdrumToken::getStrandIndex(void) const {
 
 int HumdrumToken::getBeamStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernBeamStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernBeamStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3428,7 +3493,10 @@ int HumdrumToken::getBeamStartElisionLevel(int index) const {
 
 int HumdrumToken::getSlurStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernSlurStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernSlurStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3446,7 +3514,10 @@ int HumdrumToken::getSlurStartElisionLevel(int index) const {
 
 int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernPhraseStartElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernPhraseStartElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3464,7 +3535,10 @@ int HumdrumToken::getPhraseStartElisionLevel(int index) const {
 
 int HumdrumToken::getBeamEndElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernBeamEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernBeamEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3482,7 +3556,10 @@ int HumdrumToken::getBeamEndElisionLevel(int index) const {
 
 int HumdrumToken::getSlurEndElisionLevel(int index) const {
 	if (isDataType("**kern") || isDataType("**mens")) {
-		return Convert::getKernSlurEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernSlurEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3500,7 +3577,10 @@ int HumdrumToken::getSlurEndElisionLevel(int index) const {
 
 int HumdrumToken::getPhraseEndElisionLevel(int index) const {
 	if (isDataType("**kern")) {
-		return Convert::getKernPhraseEndElisionLevel((string)(*this), index);
+		if (index < 0) {
+			return -1;
+		}
+		return Convert::getKernPhraseEndElisionLevel(*this, index);
 	} else {
 		return -1;
 	}
@@ -3508,6 +3588,34 @@ int HumdrumToken::getPhraseEndElisionLevel(int index) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getKernInfo -- Return the lexed **kern information for
+//    the token (chord note records, and slur, phrase and beam markers).
+//    The token is lexed each time this function is called, so analyses
+//    that read many tokens should instead reuse one HumKernToken and call
+//    HumKernToken::lex() for each token.
+//
+
+HumKernToken HumdrumToken::getKernInfo(void) const {
+	return HumKernToken(*this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNote -- Return the lexed **kern record for a
+//    chord note in the token.
+//    Default value: index = 0
+//
+
+HumKernNote HumdrumToken::getKernNote(int index) const {
+	return getKernInfo().getNote(index);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::setStrandIndex -- Sets the 1-D strand index
@@ -3636,14 +3744,141 @@ ostream& HumdrumToken::printXml(ostream& out, int level, const string& indent) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::printJson -- Write the token as a JSON object.  The
+//    fields bitmask selects optional content (see HumJsonWriter::FIELD_*).
+//    IDs are the same as the XML IDs, using the prefix stored in the
+//    writer.
+//
+
+void HumdrumToken::printJson(HumJsonWriter& json, int fields) {
+	int line = getLineIndex();
+	json.beginObject();
+
+	json.writeKey("n");
+	json.writeInt(getFieldIndex());
+	json.writeKey("id");
+	json.writeTokenId(line, getFieldIndex());
+	json.writeKey("track");
+	json.writeInt(getTrack());
+	if (getSubtrack() > 0) {
+		json.writeKey("subtrack");
+		json.writeInt(getSubtrack());
+	}
+	json.writeKey("text");
+	json.writeString(*this);
+
+	json.writeKey("type");
+	if (isNull()) {
+		json.writeString("null");
+	} else if (isManipulator()) {
+		json.writeString("manipulator");
+	} else if (isCommentLocal()) {
+		json.writeString("local-comment");
+	} else if (isBarline()) {
+		json.writeString("barline");
+	} else if (isData()) {
+		json.writeString("data");
+	} else {
+		json.writeString("interpretation");
+	}
+
+	if (fields & HumJsonWriter::FIELD_RHYTHM) {
+		if (getDuration().isNonNegative()) {
+			json.writeKey("duration");
+			json.writeNumber(getDuration());
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_STRANDS) {
+		if (getStrandIndex() >= 0) {
+			json.writeKey("strand");
+			json.writeInt(getStrandIndex());
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_LINKS) {
+		HTp tok;
+		int count = getNextTokenCount();
+		if (count > 0) {
+			json.writeKey("next");
+			json.beginArray();
+			for (int i=0; i<count; i++) {
+				tok = getNextToken(i);
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+			json.endArray();
+		}
+		count = getPreviousTokenCount();
+		if (count > 0) {
+			json.writeKey("previous");
+			json.beginArray();
+			for (int i=0; i<count; i++) {
+				tok = getPreviousToken(i);
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+			json.endArray();
+		}
+		if (isNull()) {
+			tok = getPreviousNonNullDataToken(0);
+			if (tok != NULL) {
+				json.writeKey("nullResolve");
+				json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+			}
+		}
+	}
+
+	if (fields & HumJsonWriter::FIELD_PARAMETERS) {
+		((HumHash*)this)->printJson(json);
+
+		if (m_cold && !m_cold->m_linkedParameterTokens.empty()) {
+			json.writeKey("linkedParameters");
+			json.beginArray();
+			for (HTp tok : m_cold->m_linkedParameterTokens) {
+				HLp owner = tok->getOwner();
+				if (owner && owner->isGlobalComment()) {
+					json.writeLineId(owner->getLineIndex());
+				} else {
+					json.writeTokenId(tok->getLineIndex(), tok->getFieldIndex());
+				}
+			}
+			json.endArray();
+		}
+
+		HumParamSet* parameterSet = getParameterSet();
+		if (parameterSet && (parameterSet->getCount() > 0)) {
+			json.writeKey("parameterSet");
+			json.beginObject();
+			json.writeKey("ns1");
+			json.writeString(parameterSet->getNamespace1());
+			json.writeKey("ns2");
+			json.writeString(parameterSet->getNamespace2());
+			json.writeKey("parameters");
+			json.beginObject();
+			for (int i=0; i<parameterSet->getCount(); i++) {
+				json.writeKey(parameterSet->getParameterName(i));
+				json.writeString(parameterSet->getParameterValue(i));
+			}
+			json.endObject();
+			json.endObject();
+		}
+	}
+
+	json.endObject();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::printXmlLinkedParameters --
 //
 
 ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const string& indent) {
-	if (m_parameterSet) {
-		m_parameterSet->printXml(out, level, indent);
+	HumParamSet* parameterSet = getParameterSet();
+	if (parameterSet) {
+		parameterSet->printXml(out, level, indent);
 	}
 	return out;
 }
@@ -3656,23 +3891,24 @@ ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const s
 //
 
 ostream& HumdrumToken::printXmlLinkedParameterInfo(ostream& out, int level, const string& indent) {
-	if (m_linkedParameterTokens.empty()) {
+	if (!m_cold || m_cold->m_linkedParameterTokens.empty()) {
 		return out;
 	}
+	vector<HTp>& linkedParameterTokens = m_cold->m_linkedParameterTokens;
 
 	out << Convert::repeatString(indent, level);
 	out << "<parameters-linked>\n";
 
 	level++;
-	for (int i=0; i<(int)m_linkedParameterTokens.size(); i++) {
+	for (int i=0; i<(int)linkedParameterTokens.size(); i++) {
 		out << Convert::repeatString(indent, level);
 		out << "<linked-parameter";
 		out << " idref=\"";
-		HLp owner = m_linkedParameterTokens[i]->getOwner();
+		HLp owner = linkedParameterTokens[i]->getOwner();
 		if (owner && owner->isGlobalComment()) {
 			out << owner->getXmlId();
 		} else {
-			out << m_linkedParameterTokens[i]->getXmlId();
+			out << linkedParameterTokens[i]->getXmlId();
 		}
 		out << "\"";
 		out << ">\n";
@@ -4080,7 +4316,7 @@ void HumdrumToken::copyStructure(HTp token) {
 //
 
 HTp HumdrumToken::getStrophe(void) {
-	return m_strophe;
+	return m_cold ? m_cold->m_strophe : NULL;
 }
 
 
@@ -4101,7 +4337,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 		clearStrophe();
 		return;
 	}
-	m_strophe = strophe;
+	getColdData().m_strophe = strophe;
 }
 
 
@@ -4113,7 +4349,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 //
 
 bool HumdrumToken::hasStrophe(void) {
-	return m_strophe ? true : false;
+	return getStrophe() ? true : false;
 }
 
 
@@ -4125,7 +4361,9 @@ bool HumdrumToken::hasStrophe(void) {
 //
 
 void HumdrumToken::clearStrophe(void) {
-	m_strophe = NULL;
+	if (m_cold) {
+		m_cold->m_strophe = NULL;
+	}
 }
 
 
@@ -4137,10 +4375,11 @@ void HumdrumToken::clearStrophe(void) {
 //
 
 int HumdrumToken::getStropheStartIndex(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return -1;
 	}
-	return m_strophe->getLineIndex();
+	return strophe->getLineIndex();
 }
 
 
@@ -4152,14 +4391,15 @@ int HumdrumToken::getStropheStartIndex(void) {
 //
 
 bool HumdrumToken::isFirstStrophe(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return true;
 	}
-	HTp toleft = m_strophe->getPreviousField();
+	HTp toleft = strophe->getPreviousField();
 	if (!toleft) {
 		return true;
 	}
-	int track = m_strophe->getTrack();
+	int track = strophe->getTrack();
 	int ltrack = toleft->getTrack();
 	return track != ltrack;
 }
@@ -4178,16 +4418,17 @@ bool HumdrumToken::isPrimaryStrophe(void) {
 //
 
 bool HumdrumToken::isStrophe(const string& label) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return false;
 	}
 	if (label.empty()) {
-		return *m_strophe == "*S/";
+		return *strophe == "*S/";
 	}
 	if (label[0] == '*') {
-		return *m_strophe == label;
+		return *strophe == label;
 	}
-	return m_strophe->substr(3) == label;
+	return strophe->substr(3) == label;
 }
 
 
@@ -4199,13 +4440,182 @@ bool HumdrumToken::isStrophe(const string& label) {
 //
 
 string HumdrumToken::getStropheLabel(void) {
-	if (!m_strophe) {
+	HTp strophe = getStrophe();
+	if (!strophe) {
 		return "";
 	}
-	if (*m_strophe == "*S/") {
+	if (*strophe == "*S/") {
 		return "";
 	}
-	return m_strophe->substr(3);
+	return strophe->substr(3);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtoken class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtoken::getKernNote -- Return the **kern record for the subtoken.
+//    An empty record (no pitch or rhythm) is returned if the token is not
+//    **kern or the subtokens are not separated by spaces.
+//
+
+const HumKernNote& HumSubtoken::getKernNote(void) const {
+	static const HumKernNote empty;
+	return m_note ? *m_note : empty;
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtoken::getMidiNoteNumber -- Return the MIDI key number of the
+//    note (the same as Convert::kernToMidiNoteNumber() for the subtoken),
+//    or -1000 if the subtoken does not have a pitch.
+//
+
+int HumSubtoken::getMidiNoteNumber(void) const {
+	const HumKernNote& note = getKernNote();
+	if (!note.hasPitch()) {
+		return -1000;
+	}
+	static const int pcs[7] = {0, 2, 4, 5, 7, 9, 11};
+	return pcs[note.getDiatonicPC()] + note.getAccidentalCount()
+			+ 12 * (note.getOctave() + 1);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtokenView class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtokenView::HumSubtokenView -- The number of subtokens is the same
+//     as HumdrumToken::getSubtokenCount().  An empty separator gives one
+//     subtoken for each character, as in HumdrumToken::getSubtoken().
+//     Only **kern tokens separated by spaces are lexed for their notes.
+//     default value: separator = " "
+//
+
+HumSubtokenView::HumSubtokenView(const HumdrumToken& token,
+		const string& separator) {
+	m_text = std::string_view(token);
+	m_separator = separator;
+	if ((separator == " ") && token.isKern()) {
+		m_kern.lex(token);
+		m_kernQ = true;
+		m_size = m_kern.getNoteCount();
+	} else if (separator.empty()) {
+		m_size = (int)m_text.size();
+	} else {
+		m_size = 1;
+		size_t start = 0;
+		while ((start = m_text.find(m_separator, start)) != std::string_view::npos) {
+			m_size++;
+			start += m_separator.size();
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::operator[] -- Return a subtoken by index.  An empty
+//     subtoken is returned if the index is out of range.
+//
+
+HumSubtoken HumSubtokenView::operator[](int index) const {
+	if ((index < 0) || (index >= m_size)) {
+		HumSubtoken output;
+		output.m_index = index;
+		return output;
+	}
+	if (m_kernQ) {
+		return *iterator(this, index);
+	}
+	iterator it = begin();
+	for (int i=0; i<index; i++) {
+		++it;
+	}
+	return *it;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// HumSubtokenView::iterator class function definitions.
+//
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::iterator -- Only the first subtoken and
+//     the end position (index == size) can be accessed directly for
+//     separators other than spaces.
+//
+
+HumSubtokenView::iterator::iterator(const HumSubtokenView* view, int index) {
+	m_view = view;
+	m_current.m_index = index;
+	if (index < view->m_size) {
+		load(0);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::operator++ -- Move to the next subtoken.
+//
+
+HumSubtokenView::iterator& HumSubtokenView::iterator::operator++(void) {
+	int start = m_current.m_start + (int)m_current.m_text.size()
+			+ (int)m_view->m_separator.size();
+	m_current.m_index++;
+	if (m_current.m_index < m_view->m_size) {
+		load(start);
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumSubtokenView::iterator::load -- Set the text of the current subtoken,
+//     which starts at the given position in the token (ignored for
+//     space-separated subtokens, which are read from the **kern record).
+//
+
+void HumSubtokenView::iterator::load(int start) {
+	const std::string_view& text = m_view->m_text;
+	if (m_view->m_kernQ) {
+		m_current.m_note  = &m_view->m_kern.getNote(m_current.m_index);
+		m_current.m_start = m_current.m_note->getStart();
+		m_current.m_text  = text.substr(m_current.m_start, m_current.m_note->getLength());
+	} else if (m_view->m_separator.empty()) {
+		m_current.m_start = m_current.m_index;
+		m_current.m_text  = text.substr(m_current.m_start, 1);
+	} else {
+		size_t loc = text.find(m_view->m_separator, start);
+		if (loc == std::string_view::npos) {
+			loc = text.size();
+		}
+		m_current.m_start = start;
+		m_current.m_text  = text.substr(start, loc - start);
+	}
 }
 
 
@@ -0,0 +1,541 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 18:04:12 PDT 2026
+// Last Modified: Sat Oct 17 18:04:12 PDT 2026
+// Filename:      KeyEstimator.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/KeyEstimator.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Estimate the global key and local keys of a score.
+//
+
+#include "KeyEstimator.h"
+#include "Convert.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// Key profiles for C major and C minor.
+//
+
+// Bret Aarden: Essen Folksong Collection
+static const double keyestimator_aardenMajor[12] = {
+	17.7661, 0.145624, 14.9265, 0.160186, 19.8049, 11.3587,
+	0.291248, 22.062, 0.145624, 8.15494, 0.232998, 4.95122
+};
+static const double keyestimator_aardenMinor[12] = {
+	18.2648, 0.737619, 14.0499, 16.8599, 0.702494, 14.4362,
+	0.702494, 18.6161, 4.56621, 1.93186, 7.37619, 1.75623
+};
+
+// Helen Bellman and Helen Budge
+static const double keyestimator_bellmanMajor[12] = {
+	16.80, 0.86, 12.95, 1.41, 13.49, 11.93,
+	1.25, 20.28, 1.80, 8.04, 0.62, 10.57
+};
+static const double keyestimator_bellmanMinor[12] = {
+	18.16, 0.69, 12.99, 13.34, 1.07, 11.15,
+	1.38, 21.07, 7.49, 1.53, 0.92, 10.21
+};
+
+// Carol Krumhansl and Edward Kessler
+static const double keyestimator_krumhanslMajor[12] = {
+	6.35, 2.23, 3.48, 2.33, 4.38, 4.09,
+	2.52, 5.19, 2.39, 3.66, 2.29, 2.88
+};
+static const double keyestimator_krumhanslMinor[12] = {
+	6.33, 2.68, 3.52, 5.38, 2.60, 3.53,
+	2.54, 4.75, 3.98, 2.69, 3.34, 3.17
+};
+
+// David Temperley: Kostka-Payne corpus (Music and Probability 2006)
+static const double keyestimator_temperleyMajor[12] = {
+	0.748, 0.060, 0.488, 0.082, 0.670, 0.460,
+	0.096, 0.715, 0.104, 0.366, 0.057, 0.400
+};
+static const double keyestimator_temperleyMinor[12] = {
+	0.712, 0.084, 0.474, 0.618, 0.049, 0.460,
+	0.105, 0.747, 0.404, 0.067, 0.133, 0.330
+};
+
+// Craig Sapp: simple weights
+static const double keyestimator_simpleMajor[12] = {
+	2.0, 0.0, 1.0, 0.0, 1.0, 1.0,
+	0.0, 2.0, 0.0, 1.0, 0.0, 1.0
+};
+static const double keyestimator_simpleMinor[12] = {
+	2.0, 0.0, 1.0, 1.0, 0.0, 1.0,
+	0.0, 2.0, 1.0, 0.0, 0.5, 0.5
+};
+
+// Default base-40 spelling of the tonic for each major and minor key:
+static const int keyestimator_majorTonics[12] = {
+	2, 7, 8, 13, 14, 19, 20, 25, 30, 31, 36, 37
+};
+static const int keyestimator_minorTonics[12] = {
+	2, 3, 8, 13, 14, 19, 20, 25, 26, 31, 36, 37
+};
+
+static const int keyestimator_b7ToB12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+static const int keyestimator_b7ToB40[7] = { 2, 8, 14, 19, 25, 31, 37 };
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::KeyEstimator --
+//
+
+KeyEstimator::KeyEstimator(void) {
+	setProfile("aarden");
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::clear -- Remove the analysis of the previous score.  The
+//    profile and window settings are not changed.
+//
+
+void KeyEstimator::clear(void) {
+	m_slices.clear();
+	m_times.clear();
+	m_durations.clear();
+	m_noteStart.clear();
+	m_notes.clear();
+	m_scoreDuration = 0;
+	m_globalKey = -1;
+	m_globalCorrelation = 0.0;
+	m_globalName.clear();
+	m_keys.clear();
+	m_correlations.clear();
+	m_names.clear();
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::setProfile -- Choose the key profiles used for
+//    correlation: "aarden" (default), "bellman", "krumhansl",
+//    "temperley" or "simple".  Returns false if the name is not known,
+//    in which case the profile is not changed.
+//
+
+bool KeyEstimator::setProfile(const string& name) {
+	if (name == "aarden") {
+		prepareWeights(keyestimator_aardenMajor, keyestimator_aardenMinor);
+	} else if (name == "bellman") {
+		prepareWeights(keyestimator_bellmanMajor, keyestimator_bellmanMinor);
+	} else if (name == "krumhansl") {
+		prepareWeights(keyestimator_krumhanslMajor, keyestimator_krumhanslMinor);
+	} else if (name == "temperley") {
+		prepareWeights(keyestimator_temperleyMajor, keyestimator_temperleyMinor);
+	} else if (name == "simple") {
+		prepareWeights(keyestimator_simpleMajor, keyestimator_simpleMinor);
+	} else {
+		return false;
+	}
+	m_profile = name;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::prepareWeights -- Rotate the C major and C minor
+//    profiles to all tonics, then center each one on zero and scale it
+//    to unit length.  The Pearson correlation of a histogram with a key
+//    is then the dot product of the centered histogram with the key
+//    weights, divided by the length of the centered histogram.
+//
+
+void KeyEstimator::prepareWeights(const double* major, const double* minor) {
+	for (int mode=0; mode<2; mode++) {
+		const double* profile = mode ? minor : major;
+		double mean = 0.0;
+		for (int i=0; i<12; i++) {
+			mean += profile[i];
+		}
+		mean /= 12.0;
+		double length = 0.0;
+		for (int i=0; i<12; i++) {
+			length += (profile[i] - mean) * (profile[i] - mean);
+		}
+		length = sqrt(length);
+		for (int tonic=0; tonic<12; tonic++) {
+			double* weights = m_weights[mode * 12 + tonic];
+			for (int pc=0; pc<12; pc++) {
+				weights[pc] = (profile[(pc - tonic + 12) % 12] - mean) / length;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::correlate -- Calculate the correlation of the histogram
+//    with all 24 keys.  The correlations array must have 24 elements.
+//    All correlations are zero if the histogram is empty or flat.
+//
+
+void KeyEstimator::correlate(double* correlations,
+		const PitchClassHistogram& histogram) const {
+	double centered[12];
+	double mean = 0.0;
+	for (int i=0; i<12; i++) {
+		centered[i] = histogram.getBase12(i);
+		mean += centered[i];
+	}
+	mean /= 12.0;
+	double length = 0.0;
+	for (int i=0; i<12; i++) {
+		centered[i] -= mean;
+		length += centered[i] * centered[i];
+	}
+	if (length <= 0.0) {
+		fill(correlations, correlations + 24, 0.0);
+		return;
+	}
+	length = sqrt(length);
+	for (int k=0; k<24; k++) {
+		const double* weights = m_weights[k];
+		double sum = 0.0;
+		for (int i=0; i<12; i++) {
+			sum += weights[i] * centered[i];
+		}
+		correlations[k] = sum / length;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getBestKey -- Return the key with the highest correlation
+//    to the histogram, or -1 if the histogram is empty.
+//
+
+int KeyEstimator::getBestKey(const PitchClassHistogram& histogram,
+		double& correlation) const {
+	correlation = 0.0;
+	if (histogram.getTotal() <= 1.0e-9) {
+		return -1;
+	}
+	double correlations[24];
+	correlate(correlations, histogram);
+	int best = 0;
+	for (int k=1; k<24; k++) {
+		if (correlations[k] > correlations[best]) {
+			best = k;
+		}
+	}
+	correlation = correlations[best];
+	return best;
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::spellKey -- Return the **kern name of the tonic of a key,
+//    such as "E-" for E-flat major or "g#" for G-sharp minor.  Enharmonic
+//    tonics are spelled by the base-40 bins of the histogram, so that a
+//    score in C-sharp major is not called D-flat major.
+//
+
+string KeyEstimator::spellKey(int key, const PitchClassHistogram& histogram) {
+	if (key < 0) {
+		return "";
+	}
+	bool minor = isMinor(key);
+	int tonic = getTonic(key);
+	int best = minor ? keyestimator_minorTonics[tonic] : keyestimator_majorTonics[tonic];
+	for (int b7=0; b7<7; b7++) {
+		for (int acc=-1; acc<=1; acc++) {
+			if ((keyestimator_b7ToB12[b7] + acc + 12) % 12 != tonic) {
+				continue;
+			}
+			int pc40 = keyestimator_b7ToB40[b7] + acc;
+			if (histogram.getBase40(pc40) > histogram.getBase40(best)) {
+				best = pc40;
+			}
+		}
+	}
+	// Minor keys are lower case (octave 4), major keys upper case (octave 3):
+	return Convert::base40ToKern(best + (minor ? 4 : 3) * 40);
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::analyze -- Estimate the global key of the score and the
+//    local key at each line.  For each data line, the pitch-class
+//    histogram of all slices starting within half of the window
+//    duration before or after the line is correlated with the key
+//    profiles.  The window histogram is updated by adding the slices
+//    that enter the window and subtracting the ones that leave it, so
+//    each slice is only visited twice.  Local key regions shorter than
+//    the minimum duration are merged with the previous region.  A
+//    window duration of zero or less gives the global key to all lines.
+//
+
+void KeyEstimator::analyze(HumdrumFile& infile) {
+	clear();
+	getSliceNotes(infile);
+	int lineCount = infile.getLineCount();
+	int sliceCount = (int)m_slices.size();
+
+	PitchClassHistogram total;
+	for (int i=0; i<sliceCount; i++) {
+		for (int j=m_noteStart[i]; j<m_noteStart[i+1]; j++) {
+			total.addBase40(m_notes[j], m_durations[i]);
+		}
+	}
+	m_globalKey = getBestKey(total, m_globalCorrelation);
+	m_globalName = spellKey(m_globalKey, total);
+
+	vector<int> keys(sliceCount, m_globalKey);
+	vector<double> correlations(sliceCount, m_globalCorrelation);
+
+	if ((m_window > 0) && (sliceCount > 0)) {
+		HumNum half = m_window / 2;
+		PitchClassHistogram window;
+		int lo = 0;
+		int hi = 0;
+		for (int i=0; i<sliceCount; i++) {
+			while ((hi < sliceCount) && (m_times[hi] < m_times[i] + half)) {
+				for (int j=m_noteStart[hi]; j<m_noteStart[hi+1]; j++) {
+					window.addBase40(m_notes[j], m_durations[hi]);
+				}
+				hi++;
+			}
+			while ((lo < hi) && (m_times[lo] < m_times[i] - half)) {
+				for (int j=m_noteStart[lo]; j<m_noteStart[lo+1]; j++) {
+					window.addBase40(m_notes[j], -m_durations[lo]);
+				}
+				lo++;
+			}
+			keys[i] = getBestKey(window, correlations[i]);
+		}
+		smoothKeys(keys);
+	}
+
+	// Spell each key region from the notes in the region:
+	vector<string> names(sliceCount);
+	int start = 0;
+	while (start < sliceCount) {
+		int end = start + 1;
+		while ((end < sliceCount) && (keys[end] == keys[start])) {
+			end++;
+		}
+		PitchClassHistogram region;
+		for (int i=start; i<end; i++) {
+			for (int j=m_noteStart[i]; j<m_noteStart[i+1]; j++) {
+				region.addBase40(m_notes[j], m_durations[i]);
+			}
+		}
+		string name = spellKey(keys[start], region);
+		for (int i=start; i<end; i++) {
+			names[i] = name;
+		}
+		start = end;
+	}
+
+	// Store the results for each line: lines between slices get the key
+	// of the previous slice, and lines before the first slice the key of
+	// the first slice.
+	m_keys.assign(lineCount, -1);
+	m_correlations.assign(lineCount, 0.0);
+	m_names.assign(lineCount, "");
+	int slice = 0;
+	for (int i=0; i<lineCount; i++) {
+		while ((slice + 1 < sliceCount) && (m_slices[slice + 1] <= i)) {
+			slice++;
+		}
+		if (sliceCount == 0) {
+			break;
+		}
+		m_keys[i] = keys[slice];
+		m_correlations[i] = correlations[slice];
+		m_names[i] = names[slice];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getSliceNotes -- Store the pitches sounding in each
+//    data line (including notes sustained from previous lines), and
+//    the start time and duration of the line.  Lines with no duration
+//    (grace notes) are skipped.
+//
+
+void KeyEstimator::getSliceNotes(HumdrumFile& infile) {
+	m_scoreDuration = infile.getScoreDuration();
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			continue;
+		}
+		HumNum duration = infile[i].getDuration();
+		if (duration <= 0) {
+			continue;
+		}
+		m_slices.push_back(i);
+		m_times.push_back(infile[i].getDurationFromStart());
+		m_durations.push_back(duration.getFloat());
+		m_noteStart.push_back((int)m_notes.size());
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			if (token->isNull()) {
+				token = token->resolveNull();
+				if ((token == NULL) || token->isNull()) {
+					continue;
+				}
+			}
+			if (token->isRest()) {
+				continue;
+			}
+			int count = token->getSubtokenCount();
+			for (int k=0; k<count; k++) {
+				int base40 = Convert::kernToBase40(token->getSubtoken(k));
+				if (base40 < 0) {
+					continue;
+				}
+				m_notes.push_back(base40);
+			}
+		}
+	}
+	m_noteStart.push_back((int)m_notes.size());
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::smoothKeys -- Merge key regions shorter than the minimum
+//    duration into the previous region (or the next region if there is
+//    no previous one).  Slices with no key (empty windows) are given the
+//    key of the surrounding slices.
+//
+
+void KeyEstimator::smoothKeys(vector<int>& keys) {
+	int count = (int)keys.size();
+	for (int i=1; i<count; i++) {
+		if (keys[i] < 0) {
+			keys[i] = keys[i-1];
+		}
+	}
+	for (int i=count-2; i>=0; i--) {
+		if (keys[i] < 0) {
+			keys[i] = keys[i+1];
+		}
+	}
+
+	HumNum minimum = m_minimum;
+	if (minimum < 0) {
+		minimum = m_window / 2;
+	}
+	if (minimum <= 0) {
+		return;
+	}
+
+	int start = 0;
+	while (start < count) {
+		int end = start + 1;
+		while ((end < count) && (keys[end] == keys[start])) {
+			end++;
+		}
+		HumNum endtime = end < count ? m_times[end] : m_scoreDuration;
+		if (endtime - m_times[start] < minimum) {
+			int newkey = -1;
+			if (start > 0) {
+				newkey = keys[start - 1];
+			} else if (end < count) {
+				newkey = keys[end];
+			}
+			if (newkey >= 0) {
+				for (int i=start; i<end; i++) {
+					keys[i] = newkey;
+				}
+				// check again from the start of the merged region:
+				while ((start > 0) && (keys[start - 1] == newkey)) {
+					start--;
+				}
+				continue;
+			}
+		}
+		start = end;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getKeyChanges -- Return the line indexes of the data lines
+//    where the local key changes (not including the first key).
+//
+
+void KeyEstimator::getKeyChanges(vector<int>& lines) const {
+	lines.clear();
+	for (int i=1; i<(int)m_slices.size(); i++) {
+		int line = m_slices[i];
+		if (m_keys[line] != m_keys[m_slices[i-1]]) {
+			lines.push_back(line);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KeyEstimator::getKeyDesignation -- Return the local key at the line as
+//    a key designation interpretation, such as "*E-:", or an empty string
+//    if the key is not known.
+//
+
+string KeyEstimator::getKeyDesignation(int line) const {
+	return makeDesignation(m_names.at(line));
+}
+
+
+string KeyEstimator::getGlobalKeyDesignation(void) const {
+	return makeDesignation(m_globalName);
+}
+
+
+string KeyEstimator::makeDesignation(const string& name) {
+	if (name.empty()) {
+		return "";
+	}
+	return "*" + name + ":";
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -171,7 +171,7 @@ char& MuseRecordBasic::getColumn(int columnNumber) {
 		cerr << "Error trying to access column: " << columnNumber  << endl;
 		cerr << "CURRENT DATA: ===============================" << endl;
 		cerr << (*this);
-		static char x = ' ';
+		static thread_local char x = ' ';
 		return x;
 	} else if (realindex >= (int)m_recordString.size()) {
 		m_recordString.resize(realindex+1);
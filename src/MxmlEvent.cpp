@@ -37,8 +37,6 @@ namespace hum {
 class MxmlMeasure;
 class MxmlPart;
 
-int MxmlEvent::m_counter = 0;
-
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -50,7 +48,7 @@ int MxmlEvent::m_counter = 0;
 MxmlEvent::MxmlEvent(MxmlMeasure* measure) {
 	clear();
 	m_owner = measure;
-	m_sequence = m_counter++;
+	m_sequence = getNextSequenceNumber();
 	m_stems = false;
 }
 
@@ -119,8 +117,7 @@ void MxmlEvent::makeDummyRest(MxmlMeasure* owner, HumNum starttime,
 	// m_node remains null
 	// m_links remains empty
 	m_linked = false;
-	m_sequence = -m_counter;
-	m_counter++;
+	m_sequence = -getNextSequenceNumber();
 	m_voice = 1;  // don't know what the original voice number is
 	m_voiceindex = voiceindex;
 	m_staff = staffindex + 1;
@@ -823,6 +820,27 @@ int MxmlEvent::getSequenceNumber(void) const {
 
 
 
+//////////////////////////////
+//
+// MxmlEvent::getNextSequenceNumber -- Return the next unused event
+//     sequence number of the part which owns the event (or 0 if the event
+//     is not in a part).  The numbers are kept in the part rather than in
+//     a global counter so that separate scores can be parsed in parallel.
+//
+
+int MxmlEvent::getNextSequenceNumber(void) {
+	if (!m_owner) {
+		return 0;
+	}
+	MxmlPart* part = m_owner->getOwner();
+	if (!part) {
+		return 0;
+	}
+	return part->m_eventcount++;
+}
+
+
+
 //////////////////////////////
 //
 // MxmlEvent::getVoiceNumber -- Return the voice number of the event.
@@ -927,8 +945,9 @@ bool MxmlEvent::isInvisible(void) {
 int MxmlEvent::getStaffIndex(void) const {
 	if (m_staff > 0) {
 		vector<pair<int, int>> mapping = getOwner()->getOwner()->getVoiceMapping();
-		if (getVoiceNumber() < (int)mapping.size()) {
-			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[getVoiceNumber()];
+		int voicenumber = getVoiceNumber();
+		if ((voicenumber >= 0) && (voicenumber < (int)mapping.size())) {
+			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[voicenumber];
 			if (m_staff - 1 != mappingStaffIndex) {
 				return mappingStaffIndex;
 			}
@@ -960,8 +979,9 @@ int MxmlEvent::getStaffIndex(void) const {
 int MxmlEvent::getCrossStaffOffset(void) const {
 	if (m_staff > 0) {
 		vector<pair<int, int>> mapping = getOwner()->getOwner()->getVoiceMapping();
-		if (getVoiceNumber() < (int)mapping.size()) {
-			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[getVoiceNumber()];
+		int voicenumber = getVoiceNumber();
+		if ((voicenumber >= 0) && (voicenumber < (int)mapping.size())) {
+			const auto& [mappingStaffIndex, mappingVoiceIndex] = mapping[voicenumber];
 			return m_staff - 1 - mappingStaffIndex;
 		}
 	}
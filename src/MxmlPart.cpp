@@ -75,6 +75,7 @@ void MxmlPart::clear(void) {
 	m_verseCount.resize(0);
 	m_harmonyCount = 0;
 	m_editorialAccidental = false;
+	m_eventcount = 0;
 }
 
 
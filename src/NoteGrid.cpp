@@ -625,14 +625,8 @@ double NoteGrid::getMetricLevel(int sindex) {
 	if ((getSliceCount() == 0) || (getVoiceCount() == 0)) {
 		return NAN;
 	}
-	if (m_metriclevels.empty()) {
-		int track = 0;
-		if ((getVoiceCount() > 0) && (getSliceCount() > 0)) {
-			track = cell(0, 0)->getToken()->getTrack();
-		}
-		m_infile->getMetricLevels(m_metriclevels, track, NAN);
-	}
-	return m_metriclevels[sindex];
+	int track = cell(0, 0)->getToken()->getTrack();
+	return m_infile->getMetricLevel(sindex, track);
 }
 
 
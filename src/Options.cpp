@@ -15,10 +15,12 @@
 #include "HumRegex.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <utility>
 
 using namespace std;
 
@@ -292,6 +294,174 @@ ostream& Option_register::print(ostream& out) {
 
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// OptionSchema class function definitions.
+//
+
+
+//////////////////////////////
+//
+// OptionSchema::getEmpty -- Return the schema with no definitions, which
+//     is the starting point for all other schemas.
+//
+
+std::shared_ptr<const OptionSchema> OptionSchema::getEmpty(void) {
+	static const std::shared_ptr<const OptionSchema> empty = std::make_shared<OptionSchema>();
+	return empty;
+}
+
+
+
+//////////////////////////////
+//
+// OptionSchema::getIndex -- Return the entry index for an option name
+//     or alias, or -1 if the name is not defined.
+//
+
+int OptionSchema::getIndex(const string& name) const {
+	auto it = m_names.find(name);
+	if (it == m_names.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// OptionSchema::extend -- Return the schema with the given definition
+//     added after the definitions in this one.  Option definitions have
+//     this sructure:
+//        option-name|alias-name1|alias-name2=option-type:option-default
+// option-name :: name of the option (one or more character, not including
+//      spaces or equal signs.
+// alias-name  :: equivalent name(s) of the option.
+// option-type :: single charater indicating the option data type.
+// option-default :: default value for option if no given on the command-line.
+//
+// The new schema is stored, so adding the same definition and description
+// again returns the same schema without parsing the definition.  After
+// OPTION_MAX_SCHEMAS schemas have been stored, new schemas are returned
+// without being stored.  If the definition is invalid, NULL is returned
+// and the error message is placed in the error string.
+//
+
+std::shared_ptr<const OptionSchema> OptionSchema::extend(const string& definition,
+		const string& description, string& error) const {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto range = m_extensions.equal_range(definition);
+		for (auto it = range.first; it != range.second; it++) {
+			if (it->second->m_entries.back()->m_description == description) {
+				return it->second;
+			}
+		}
+	}
+
+	stringstream err;
+
+	// Error if definition string doesn't contain an equals sign
+	auto location = definition.find("=");
+	if (location == string::npos) {
+		err << "Error: no \"=\" in option definition: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	string aliases = definition.substr(0, location);
+	string rest    = definition.substr(location+1);
+	string otype   = rest;
+	string ovalue  = "";
+
+	location = rest.find(":");
+	if (location != string::npos) {
+		otype  = rest.substr(0, location);
+		ovalue = rest.substr(location+1);
+	}
+
+	// Remove anyspaces in the option type field
+	otype.erase(remove_if(otype.begin(), otype.end(), ::isspace), otype.end());
+
+	// Option types are only a single charater (b, i, d, c or s)
+	if (otype.size() != 1) {
+		err << "Error: option type is invalid: " << otype
+			  << " in option definition: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	// Check to make sure that the type is known
+	if (otype[0] != OPTION_STRING_TYPE  &&
+		 otype[0] != OPTION_INT_TYPE     &&
+		 otype[0] != OPTION_FLOAT_TYPE   &&
+		 otype[0] != OPTION_DOUBLE_TYPE  &&
+		 otype[0] != OPTION_BOOLEAN_TYPE &&
+		 otype[0] != OPTION_CHAR_TYPE ) {
+		err << "Error: unknown option type \'" << otype[0]
+			  << "\' in defintion: " << definition << endl;
+		error = err.str();
+		return NULL;
+	}
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	entry->m_definition  = definition;
+	entry->m_description = description;
+	entry->m_default     = ovalue;
+	entry->m_type        = otype[0];
+
+	std::shared_ptr<OptionSchema> output = std::make_shared<OptionSchema>();
+	output->m_entries.reserve(m_entries.size() + 1);
+	output->m_entries = m_entries;
+	output->m_entries.push_back(entry);
+	output->m_names = m_names;
+	int definitionIndex = (int)m_entries.size();
+
+	// Store option aliases
+	string optionName;
+	aliases += '|';
+	for (int i=0; i<(int)aliases.size(); i++) {
+		if (::isspace(aliases[i])) {
+			continue;
+		} else if (aliases[i] == '|') {
+			int index = output->getIndex(optionName);
+			if (index >= 0) {
+				err << "Option \"" << optionName << "\" from definition:" << endl;
+				err << "\t" << definition << endl;
+				err << "is already defined in: " << endl;
+				err << "\t" << output->getEntry(index).m_definition << endl;
+				error = err.str();
+				return NULL;
+			}
+			if (optionName.size() > 0) {
+				output->m_names[optionName] = definitionIndex;
+			}
+			optionName.clear();
+		} else {
+			optionName += aliases[i];
+		}
+	}
+
+	// Store the new schema, unless another thread has just done so:
+	static std::atomic<int> storedCount(0);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto range = m_extensions.equal_range(definition);
+	for (auto it = range.first; it != range.second; it++) {
+		if (it->second->m_entries.back()->m_description == description) {
+			return it->second;
+		}
+	}
+	if (storedCount.fetch_add(1) >= OPTION_MAX_SCHEMAS) {
+		storedCount--;
+		return output;
+	}
+	m_extensions.emplace(definition, output);
+	return output;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Options class function definitions.
@@ -316,16 +486,12 @@ Options::Options(const Options& options) {
 	m_argv = options.m_argv;
 	m_arguments = options.m_arguments;
 	m_optionFlag = options.m_optionFlag;
-	m_optionList = options.m_optionList;
+	m_schema = options.m_schema;
+	m_values = options.m_values;
 	m_options_error_checkQ = options.m_options_error_checkQ;
 	m_processedQ = options.m_processedQ;
 	m_suppressQ = options.m_suppressQ;
 	m_optionsArgQ = options.m_optionsArgQ;
-	for (int i=0; i<(int)options.m_optionRegister.size(); i++) {
-		Option_register* orr = new Option_register(*options.m_optionRegister[i]);
-		m_optionRegister.push_back(orr);
-	}
-
 }
 
 
@@ -353,24 +519,13 @@ Options& Options::operator=(const Options& options) {
 	m_argv = options.m_argv;
 	m_arguments = options.m_arguments;
 	m_optionFlag = options.m_optionFlag;
-	m_optionList = options.m_optionList;
+	m_schema = options.m_schema;
+	m_values = options.m_values;
 	m_options_error_checkQ = options.m_options_error_checkQ;
 	m_processedQ = options.m_processedQ;
 	m_suppressQ = options.m_suppressQ;
 	m_optionsArgQ = options.m_optionsArgQ;
-
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		delete m_optionRegister[i];
-		m_optionRegister[i] = NULL;
-	}
-	m_optionRegister.clear();
-
-	for (int i=0; i<(int)options.m_optionRegister.size(); i++) {
-		Option_register* orr = new Option_register(*options.m_optionRegister[i]);
-		m_optionRegister.push_back(orr);
-	}
-
-	m_error.str("");
+	m_error.reset();
 	return *this;
 }
 
@@ -400,99 +555,27 @@ const vector<string>& Options::argv(void) const {
 
 //////////////////////////////
 //
-// Options::define -- store an option definition in the registry.  Option
-//     definitions have this sructure:
-//        option-name|alias-name1|alias-name2=option-type:option-default
-// option-name :: name of the option (one or more character, not including
-//      spaces or equal signs.
-// alias-name  :: equivalent name(s) of the option.
-// option-type :: single charater indicating the option data type.
-// option-default :: default value for option if no given on the command-line.
+// Options::define -- store an option definition in the registry.  See
+//     OptionSchema::extend() for the structure of option definitions.
+//     Returns the index of the option, or -1 if the definition is invalid.
 //
 
 int Options::define(const string& aDefinition) {
-	Option_register* definitionEntry = NULL;
-
-	// Error if definition string doesn't contain an equals sign
-	auto location = aDefinition.find("=");
-	if (location == string::npos) {
-		m_error << "Error: no \"=\" in option definition: " << aDefinition << endl;
-		return -1;
-	}
-
-	string aliases = aDefinition.substr(0, location);
-	string rest    = aDefinition.substr(location+1);
-	string otype   = rest;
-	string ovalue  = "";
-
-	location = rest.find(":");
-	if (location != string::npos) {
-		otype  = rest.substr(0, location);
-		ovalue = rest.substr(location+1);
-	}
-
-	// Remove anyspaces in the option type field
-	otype.erase(remove_if(otype.begin(), otype.end(), ::isspace), otype.end());
-
-	// Option types are only a single charater (b, i, d, c or s)
-	if (otype.size() != 1) {
-		m_error << "Error: option type is invalid: " << otype
-			  << " in option definition: " << aDefinition << endl;
-		return -1;
-	}
-
-	// Check to make sure that the type is known
-	if (otype[0] != OPTION_STRING_TYPE  &&
-		 otype[0] != OPTION_INT_TYPE     &&
-		 otype[0] != OPTION_FLOAT_TYPE   &&
-		 otype[0] != OPTION_DOUBLE_TYPE  &&
-		 otype[0] != OPTION_BOOLEAN_TYPE &&
-		 otype[0] != OPTION_CHAR_TYPE ) {
-		m_error << "Error: unknown option type \'" << otype[0]
-			  << "\' in defintion: " << aDefinition << endl;
-		return -1;
-	}
-
-	// Set up space for a option entry in the registry
-	definitionEntry = new Option_register(aDefinition, otype[0], ovalue);
-
-	int definitionIndex = (int)m_optionRegister.size();
-
-	// Store option aliases
-	string optionName;
-	aliases += '|';
-	for (int i=0; i<(int)aliases.size(); i++) {
-		if (::isspace(aliases[i])) {
-			continue;
-		} else if (aliases[i] == '|') {
-			if (isDefined(optionName)) {
-				m_error << "Option \"" << optionName << "\" from definition:" << endl;
-				m_error << "\t" << aDefinition << endl;
-				m_error << "is already defined in: " << endl;
-				m_error << "\t" << getDefinition(optionName) << endl;
-				return -1;
-			}
-			if (optionName.size() > 0) {
-				m_optionList[optionName] = definitionIndex;
-			}
-			optionName.clear();
-		} else {
-			optionName += aliases[i];
-		}
-	}
-
-	// Store definition in registry and return its indexed location.
-	// This location will be used to link option aliases to the main
-	// command name.
-	m_optionRegister.push_back(definitionEntry);
-	return definitionIndex;
+	return define(aDefinition, "");
 }
 
 
 int Options::define(const string& aDefinition, const string& aDescription) {
-	int index = define(aDefinition);
-	m_optionRegister[index]->setDescription(aDescription);
-	return index;
+	string error;
+	std::shared_ptr<const OptionSchema> schema = m_schema->extend(aDefinition,
+			aDescription, error);
+	if (!schema) {
+		getErrorStream() << error;
+		return -1;
+	}
+	m_schema = std::move(schema);
+	m_values.resize(m_schema->getSize());
+	return m_schema->getSize() - 1;
 }
 
 
@@ -503,11 +586,7 @@ int Options::define(const string& aDefinition, const string& aDescription) {
 //
 
 int Options::isDefined(const string& name) {
-	if (m_optionList.find(name) == m_optionList.end()) {
-		return 0;
-	} else {
-		return 1;
-	}
+	return (m_schema->getIndex(name) < 0) ? 0 : 1;
 }
 
 
@@ -527,7 +606,7 @@ string Options::getArg(int index) {
 		}
 	}
 	if (index < 1 || index > (int)m_arguments.size()) {
-		m_error << "Error: argument " << index << " does not exist." << endl;
+		getErrorStream() << "Error: argument " << index << " does not exist." << endl;
 		return "";
 	}
 	return m_arguments[index - 1];
@@ -587,10 +666,10 @@ vector<string>& Options::getArgumentList(vector<string>& output) {
 
 bool Options::getBoolean(const string& optionName) {
 	int index = getRegIndex(optionName);
-	if (index < 0) {
+	if ((index < 0) || (index >= (int)m_values.size())) {
 		return 0;
 	}
-	return m_optionRegister[index]->isModified();
+	return m_values[index].m_modifiedQ;
 }
 
 
@@ -640,11 +719,11 @@ string Options::getCommandLine(void) {
 //
 
 string Options::getDefinition(const string& optionName) {
-	auto it = m_optionList.find(optionName);
-	if (it == m_optionList.end()) {
+	int index = m_schema->getIndex(optionName);
+	if (index < 0) {
 		return "";
 	} else {
-		return m_optionRegister[it->second]->getDefinition();
+		return m_schema->getEntry(index).m_definition;
 	}
 }
 
@@ -711,10 +790,12 @@ int Options::getInteger(const string& optionName) {
 
 string Options::getString(const string& optionName) {
 	int index = getRegIndex(optionName);
-	if (index < 0) {
+	if ((index < 0) || (index >= (int)m_values.size())) {
 		return "UNKNOWN OPTION";
+	} else if (m_values[index].m_modifiedQ) {
+		return m_values[index].m_value;
 	} else {
-		return m_optionRegister[index]->getOption();
+		return m_schema->getEntry(index).m_default;
 	}
 }
 
@@ -741,12 +822,12 @@ ostream& Options::print(ostream& out) {
 	vector<string> declarations;
 	vector<string> descriptions;
 	int maxlen = 0;
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		declarations.push_back(m_optionRegister[i]->getDefinition());
+	for (int i=0; i<m_schema->getSize(); i++) {
+		declarations.push_back(m_schema->getEntry(i).m_definition);
 		if (maxlen < (int)declarations.back().size()) {
 			maxlen = (int)declarations.back().size();
 		}
-		descriptions.push_back(m_optionRegister[i]->getDescription());
+		descriptions.push_back(m_schema->getEntry(i).m_description);
 	}
 	int separation = 3;
 
@@ -778,10 +859,10 @@ ostream& Options::printEmscripten(ostream& out) {
 	out << "!!      <th>Option</th><th>Type</th><th>Default</th><th>Description</th>" << endl;
 	out << "!!   </tr>" << endl;
 	HumRegex hre;
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
+	for (int i=0; i<m_schema->getSize(); i++) {
 		out << "!!   <tr>" << endl;
-		string definition = m_optionRegister[i]->getDefinition();
-		string description = m_optionRegister[i]->getDescription();
+		string definition = m_schema->getEntry(i).m_definition;
+		string description = m_schema->getEntry(i).m_description;
 		string option = "";
 		string optionType = "";
 		string defaultValue = "";
@@ -836,12 +917,8 @@ ostream& Options::printEmscripten(ostream& out) {
 void Options::reset(void) {
 	m_argv.clear();
 	m_arguments.clear();
-
-	for (int i=0; i<(int)m_optionRegister.size(); i++) {
-		delete m_optionRegister[i];
-		m_optionRegister[i] = NULL;
-	}
-	m_optionRegister.clear();
+	m_schema = OptionSchema::getEmpty();
+	m_values.clear();
 }
 
 
@@ -881,8 +958,8 @@ void Options::setModified(const string& optionName, const string& aString) {
 	if (index < 0) {
 		return;
 	}
-
-	m_optionRegister[getRegIndex(optionName)]->setModified(aString);
+	m_values[index].m_value = aString;
+	m_values[index].m_modifiedQ = true;
 }
 
 
@@ -1041,7 +1118,7 @@ char Options::getType(const string& optionName) {
 	if (index < 0) {
 		return -1;
 	} else {
-		return m_optionRegister[getRegIndex(optionName)]->getType();
+		return m_schema->getEntry(index).m_type;
 	}
 }
 
@@ -1114,10 +1191,11 @@ void Options::xverify(int error_check, int suppress) {
 	while ((i < (int)m_argv.size()) && !optionend) {
 		tcount++;
 		if (tcount > terminate) {
-			m_error << "Error: missing option argument" << endl;
-			m_error << "ARGV count: " << m_argv.size()  << endl;
-			m_error << "terminate: "  << terminate      << endl;
-			m_error << "tcount: "     << tcount         << endl;
+			stringstream& error = getErrorStream();
+			error << "Error: missing option argument" << endl;
+			error << "ARGV count: " << m_argv.size()  << endl;
+			error << "terminate: "  << terminate      << endl;
+			error << "tcount: "     << tcount         << endl;
 			break;
 		}
 		if (isOption(m_argv[i], i)) {
@@ -1173,10 +1251,10 @@ int Options::getRegIndex(const string& optionName) {
 		return -1;
 	}
 
-	auto it = m_optionList.find(optionName);
-	if (it == m_optionList.end()) {
+	int index = m_schema->getIndex(optionName);
+	if (index < 0) {
 		if (m_options_error_checkQ) {
-			m_error << "Error: unknown option \"" << optionName << "\"." << endl;
+			getErrorStream() << "Error: unknown option \"" << optionName << "\"." << endl;
 			#ifndef __EMSCRIPTEN__
 				cerr << "Error: unknown option \"" << optionName << "\"." << endl;
 			#endif
@@ -1189,7 +1267,7 @@ int Options::getRegIndex(const string& optionName) {
 			return -1;
 		}
 	} else {
-		return it->second;
+		return index;
 	}
 }
 
@@ -1281,7 +1359,7 @@ int Options::storeOption(int index, int& position, int& running) {
 			}
 			if (m_argv[index][position] == '=') {
 				if (optionType == OPTION_BOOLEAN_TYPE) {
-					m_error << "Error: boolean variable cannot have any options: "
+					getErrorStream() << "Error: boolean variable cannot have any options: "
 						  << tempname << endl;
 					return -1;
 				}
@@ -1312,7 +1390,7 @@ int Options::storeOption(int index, int& position, int& running) {
 	}
 
 	if (index >= (int)m_argv.size()) {
-		m_error << "Error: last option requires a parameter" << endl;
+		getErrorStream() << "Error: last option requires a parameter" << endl;
 		return -1;
 	}
 	setModified(tempname, &m_argv[index][position]);
@@ -1327,12 +1405,16 @@ int Options::storeOption(int index, int& position, int& running) {
 
 //////////////////////////////
 //
-// Options::printOptionList --
+// Options::printOptionList -- Print the option names (sorted) with the
+//    index of their definitions.
 //
 
 ostream& Options::printOptionList(ostream& out) {
-	for (auto it = m_optionList.begin(); it != m_optionList.end(); it++) {
-		out << it->first << "\t" << it->second << endl;
+	vector<std::pair<string, int>> names(m_schema->getNames().begin(),
+			m_schema->getNames().end());
+	sort(names.begin(), names.end());
+	for (auto& name : names) {
+		out << name.first << "\t" << name.second << endl;
 	}
 	return out;
 }
@@ -1345,9 +1427,11 @@ ostream& Options::printOptionList(ostream& out) {
 //
 
 ostream& Options::printOptionListBooleanState(ostream& out) {
-	for (auto it = m_optionList.begin(); it != m_optionList.end(); it++) {
-		out << it->first << "\t"
-			 << m_optionRegister[it->second]->isModified() << endl;
+	vector<std::pair<string, int>> names(m_schema->getNames().begin(),
+			m_schema->getNames().end());
+	sort(names.begin(), names.end());
+	for (auto& name : names) {
+		out << name.first << "\t" << m_values[name.second].m_modifiedQ << endl;
 	}
 	return out;
 }
@@ -1360,8 +1444,14 @@ ostream& Options::printOptionListBooleanState(ostream& out) {
 //
 
 ostream& Options::printRegister(ostream& out) {
-	for (auto it = m_optionRegister.begin(); it != m_optionRegister.end(); it++) {
-		(*it)->print(out);
+	for (int i=0; i<m_schema->getSize(); i++) {
+		const OptionSchema::Entry& entry = m_schema->getEntry(i);
+		out << "definition:\t"     << entry.m_definition      << endl;
+		out << "description:\t"    << entry.m_description     << endl;
+		out << "defaultOption:\t"  << entry.m_default         << endl;
+		out << "modifiedOption:\t" << m_values[i].m_value     << endl;
+		out << "modifiedQ:\t\t"    << m_values[i].m_modifiedQ << endl;
+		out << "type:\t\t"         << entry.m_type            << endl;
 	}
 	return out;
 }
@@ -1375,7 +1465,7 @@ ostream& Options::printRegister(ostream& out) {
 //
 
 bool Options::hasParseError(void) {
-	return !m_error.str().empty();
+	return m_error && !m_error->str().empty();
 }
 
 
@@ -1386,13 +1476,28 @@ bool Options::hasParseError(void) {
 //
 
 string Options::getParseError(void) {
-	return m_error.str();
+	return m_error ? m_error->str() : "";
 }
 
 
 ostream& Options::getParseError(ostream& out) {
-	out << m_error.str();
-	return m_error;
+	out << getParseError();
+	return out;
+}
+
+
+
+//////////////////////////////
+//
+// Options::getErrorStream -- Return the stream for error messages,
+//    which is only allocated when there is an error.
+//
+
+stringstream& Options::getErrorStream(void) {
+	if (!m_error) {
+		m_error.reset(new stringstream);
+	}
+	return *m_error;
 }
 
 
@@ -0,0 +1,595 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 11:02:37 PDT 2026
+// Last Modified: Sat Oct 17 11:02:37 PDT 2026
+// Filename:      PitchHistogram.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/PitchHistogram.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Fixed-size pitch histograms shared by pitch-counting tools.
+//
+
+#include "PitchHistogram.h"
+#include "Convert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// Base-40 pitch-class lookup tables (-1 = unused base-40 slot):
+//
+
+static const int histogram_b40ToB7[40] = {
+	 0,  0,  0,  0,  0, -1,
+	 1,  1,  1,  1,  1, -1,
+	 2,  2,  2,  2,  2,
+	 3,  3,  3,  3,  3, -1,
+	 4,  4,  4,  4,  4, -1,
+	 5,  5,  5,  5,  5, -1,
+	 6,  6,  6,  6,  6
+};
+
+static const int histogram_b40ToAcc[40] = {
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2,  0,
+	-2, -1,  0,  1,  2
+};
+
+static const int histogram_b7ToB12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+static const int histogram_b7ToB40[7] = { 2, 8, 14, 19, 25, 31, 37 };
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::PitchClassHistogram --
+//
+
+PitchClassHistogram::PitchClassHistogram(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::clear -- Set all bins to zero.
+//
+
+void PitchClassHistogram::clear(void) {
+	fill(m_base7, m_base7 + 7, 0.0);
+	fill(m_base12, m_base12 + 12, 0.0);
+	fill(m_base40, m_base40 + 40, 0.0);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::addBase40 -- Add a weight to the bins for the
+//    given base-40 pitch.  Returns false if the pitch is a rest or an
+//    invalid base-40 value.  Pitches are allowed down to three octaves
+//    below octave 0.
+//
+
+bool PitchClassHistogram::addBase40(int base40, double weight) {
+	if (base40 < -120) {
+		return false;
+	}
+	int pc40 = (base40 + 120) % 40;
+	int pc7 = histogram_b40ToB7[pc40];
+	if (pc7 < 0) {
+		return false;
+	}
+	int pc12 = (histogram_b7ToB12[pc7] + histogram_b40ToAcc[pc40] + 12) % 12;
+	m_base7[pc7]   += weight;
+	m_base12[pc12] += weight;
+	m_base40[pc40] += weight;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::addKern -- Add a weight for the first pitch in
+//    a **kern token.
+//
+
+bool PitchClassHistogram::addKern(const string& kern, double weight) {
+	return addBase40(Convert::kernToBase40(kern), weight);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase7Vector -- Copy the diatonic pitch-class
+//    bins into a vector, such as for Convert::pearsonCorrelation().
+//
+
+vector<double> PitchClassHistogram::getBase7Vector(void) const {
+	return vector<double>(m_base7, m_base7 + 7);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase12Vector -- Copy the chromatic pitch-class
+//    bins into a vector.
+//
+
+vector<double> PitchClassHistogram::getBase12Vector(void) const {
+	return vector<double>(m_base12, m_base12 + 12);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getBase40Vector -- Copy the base-40 pitch-class
+//    bins into a vector.
+//
+
+vector<double> PitchClassHistogram::getBase40Vector(void) const {
+	return vector<double>(m_base40, m_base40 + 40);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getTotal -- Return the sum of all bins.
+//
+
+double PitchClassHistogram::getTotal(void) const {
+	double sum = 0.0;
+	for (int i=0; i<7; i++) {
+		sum += m_base7[i];
+	}
+	return sum;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::getMaximum -- Return the largest base-40 bin.
+//
+
+double PitchClassHistogram::getMaximum(void) const {
+	return *max_element(m_base40, m_base40 + 40);
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::isEmpty -- Returns true if nothing has been added.
+//
+
+bool PitchClassHistogram::isEmpty(void) const {
+	for (int i=0; i<7; i++) {
+		if (m_base7[i] != 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchClassHistogram::operator+= -- Add the bins of another histogram.
+//
+
+PitchClassHistogram& PitchClassHistogram::operator+=(const PitchClassHistogram& other) {
+	for (int i=0; i<7; i++) {
+		m_base7[i] += other.m_base7[i];
+	}
+	for (int i=0; i<12; i++) {
+		m_base12[i] += other.m_base12[i];
+	}
+	for (int i=0; i<40; i++) {
+		m_base40[i] += other.m_base40[i];
+	}
+	return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// PitchHistogram::PitchHistogram --
+//
+
+PitchHistogram::PitchHistogram(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::clear -- Set all bins to zero.
+//
+
+void PitchHistogram::clear(void) {
+	m_pitchClasses.clear();
+	fill(m_base40, m_base40 + OCTAVES * 40, 0.0);
+	fill(m_base7, m_base7 + OCTAVES * 7, 0.0);
+	fill(m_midi, m_midi + 128, 0.0);
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::addBase40 -- Add a weight to the absolute pitch bins
+//    and to the pitch-class bins.  Returns false if the pitch is a rest,
+//    an invalid base-40 value, or outside of the storage range.
+//
+
+bool PitchHistogram::addBase40(int base40, double weight) {
+	int index = base40 - MINOCTAVE * 40;
+	if ((index < 0) || (index >= OCTAVES * 40)) {
+		return false;
+	}
+	int pc40 = index % 40;
+	int pc7 = histogram_b40ToB7[pc40];
+	if (pc7 < 0) {
+		return false;
+	}
+	int octave = index / 40;
+	int midi = (octave + MINOCTAVE + 1) * 12 + histogram_b7ToB12[pc7]
+			+ histogram_b40ToAcc[pc40];
+	m_pitchClasses.addBase40(base40, weight);
+	m_base40[index] += weight;
+	m_base7[pc7 + 7 * octave] += weight;
+	if ((midi >= 0) && (midi < 128)) {
+		m_midi[midi] += weight;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::addKern -- Add a weight for the first pitch in a
+//    **kern token.
+//
+
+bool PitchHistogram::addKern(const string& kern, double weight) {
+	return addBase40(Convert::kernToBase40(kern), weight);
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getBase40 -- Return the bin for an absolute base-40
+//    pitch (middle C = 162).
+//
+
+double PitchHistogram::getBase40(int base40) const {
+	int index = base40 - MINOCTAVE * 40;
+	if ((index < 0) || (index >= OCTAVES * 40)) {
+		return 0.0;
+	}
+	return m_base40[index];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getBase7 -- Return the bin for an absolute diatonic
+//    pitch, regardless of accidental (middle C = 28).
+//
+
+double PitchHistogram::getBase7(int base7) const {
+	int index = base7 - MINOCTAVE * 7;
+	if ((index < 0) || (index >= OCTAVES * 7)) {
+		return 0.0;
+	}
+	return m_base7[index];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getDiatonic -- Return the bin for an absolute diatonic
+//    pitch with the given chromatic alteration (-2 to +2).
+//
+
+double PitchHistogram::getDiatonic(int base7, int acc) const {
+	if ((acc < -2) || (acc > 2)) {
+		return 0.0;
+	}
+	int index = base7 - MINOCTAVE * 7;
+	if ((index < 0) || (index >= OCTAVES * 7)) {
+		return 0.0;
+	}
+	return m_base40[(index / 7) * 40 + histogram_b7ToB40[index % 7] + acc];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getMidi -- Return the bin for a MIDI key number.
+//
+
+double PitchHistogram::getMidi(int key) const {
+	if ((key < 0) || (key > 127)) {
+		return 0.0;
+	}
+	return m_midi[key];
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getLowestBase40 -- Return the lowest pitch that has
+//    a non-zero bin, or -1000 if the histogram is empty.
+//
+
+int PitchHistogram::getLowestBase40(void) const {
+	for (int i=0; i<OCTAVES * 40; i++) {
+		if (m_base40[i] != 0.0) {
+			return i + MINOCTAVE * 40;
+		}
+	}
+	return -1000;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::getHighestBase40 -- Return the highest pitch that has
+//    a non-zero bin, or -1000 if the histogram is empty.
+//
+
+int PitchHistogram::getHighestBase40(void) const {
+	for (int i=OCTAVES * 40 - 1; i>=0; i--) {
+		if (m_base40[i] != 0.0) {
+			return i + MINOCTAVE * 40;
+		}
+	}
+	return -1000;
+}
+
+
+
+//////////////////////////////
+//
+// PitchHistogram::operator+= -- Add the bins of another histogram.
+//
+
+PitchHistogram& PitchHistogram::operator+=(const PitchHistogram& other) {
+	m_pitchClasses += other.m_pitchClasses;
+	for (int i=0; i<OCTAVES * 40; i++) {
+		m_base40[i] += other.m_base40[i];
+	}
+	for (int i=0; i<OCTAVES * 7; i++) {
+		m_base7[i] += other.m_base7[i];
+	}
+	for (int i=0; i<128; i++) {
+		m_midi[i] += other.m_midi[i];
+	}
+	return *this;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////
+//
+// PitchProfile::PitchProfile --
+//
+
+PitchProfile::PitchProfile(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::clear -- Remove all analysis data (but keep the
+//    attack setting).
+//
+
+void PitchProfile::clear(void) {
+	m_files = 0;
+	m_range.clear();
+	m_measures.clear();
+	m_labels.clear();
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::analyze -- Add the notes of a file to the profile.
+//    Notes are weighted by duration, or by 1 for each attack if
+//    setAttacks(true) was called.  Each measure gets its own pitch-class
+//    histogram, labeled by filename and measure number; notes before
+//    the first barline are placed in measure 0.
+//
+
+void PitchProfile::analyze(HumdrumFile& infile) {
+	string filename = infile.getFilename();
+	m_files++;
+	bool inmeasure = false;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			int barnum = infile[i].getBarNumber();
+			if (barnum < 0) {
+				continue;
+			}
+			m_measures.emplace_back();
+			m_labels.push_back(filename + ":" + to_string(barnum));
+			inmeasure = true;
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			if (token->isNull() || token->isRest()) {
+				continue;
+			}
+			int count = token->getSubtokenCount();
+			for (int k=0; k<count; k++) {
+				string subtok = token->getSubtoken(k);
+				double weight = 1.0;
+				if (m_attacks) {
+					if (subtok.find("_") != string::npos) {
+						continue;
+					}
+					if (subtok.find("]") != string::npos) {
+						continue;
+					}
+				} else {
+					weight = Convert::recipToDuration(subtok).getFloat();
+				}
+				int base40 = Convert::kernToBase40(subtok);
+				if (!m_range.addBase40(base40, weight)) {
+					continue;
+				}
+				if (!inmeasure) {
+					m_measures.emplace_back();
+					m_labels.push_back(filename + ":0");
+					inmeasure = true;
+				}
+				m_measures.back().addBase40(base40, weight);
+			}
+		}
+	}
+}
+
+
+//
+// Analyze a set of files in parallel.  Each file gets its own profile
+// and the profiles are merged in input order, so the measure list is
+// the same as when analyzing the files one at a time.  Returns the
+// number of files analyzed.
+//
+
+int PitchProfile::analyze(HumdrumFileSet& infiles, int threads) {
+	int count = infiles.getCount();
+	if (count == 0) {
+		return 0;
+	}
+
+	vector<PitchProfile> profiles(count);
+	for (int i=0; i<count; i++) {
+		profiles[i].setAttacks(m_attacks);
+	}
+
+	atomic<int> next(0);
+	auto analyzeFiles = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			profiles[index].analyze(infiles[index]);
+		}
+	};
+
+	int threadcount = min(max(threads, 1), count);
+	vector<thread> workers;
+	workers.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		workers.emplace_back(analyzeFiles);
+	}
+	analyzeFiles();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		*this += profiles[i];
+	}
+	return count;
+}
+
+
+//
+// Analyze all files in a stream, reading them in batches so that only
+// a limited number of files are in memory at a time.
+//
+
+int PitchProfile::analyze(HumdrumFileStream& instream, int threads) {
+	int batchsize = max(threads, 1) * 16;
+	int total = 0;
+	bool done = false;
+	while (!done) {
+		HumdrumFileSet infiles;
+		while (infiles.getCount() < batchsize) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (!instream.getFile(*infile)) {
+				delete infile;
+				done = true;
+				break;
+			}
+			infiles.appendHumdrumPointer(infile);
+		}
+		total += analyze(infiles, threads);
+	}
+	return total;
+}
+
+
+
+//////////////////////////////
+//
+// PitchProfile::operator+= -- Merge another profile into this one.  The
+//    range and pitch-class histograms are summed, and the measures of
+//    the other profile are appended.
+//
+
+PitchProfile& PitchProfile::operator+=(const PitchProfile& other) {
+	m_files += other.m_files;
+	m_range += other.m_range;
+	m_measures.insert(m_measures.end(), other.m_measures.begin(), other.m_measures.end());
+	m_labels.insert(m_labels.end(), other.m_labels.begin(), other.m_labels.end());
+	return *this;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -538,24 +538,17 @@ PixelColor PixelColor::getColor(const string& colorstring) {
 	// check for decimal strings with spaces around numbers: "255 255 255"
 	if ((colorstring.find(' ') != string::npos) ||
 		 (colorstring.find('\t') != string::npos)) {
-		char buffer[256] = {0};
-		strcpy(buffer, colorstring.c_str());
-		char* ptr = strtok(buffer, " \t\n:;");
-		int tred   = -1;
-		int tgreen = -1;
-		int tblue  = -1;
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tred);
-			ptr = strtok(NULL, " \t\n;:");
-		}
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tgreen);
-			ptr = strtok(NULL, " \t\n;:");
-		}
-		if (ptr != NULL) {
-			sscanf(ptr, "%d", &tblue);
-			ptr = strtok(NULL, " \t\n;:");
+		const char* separators = " \t\n:;";
+		int values[3] = {-1, -1, -1};
+		size_t start = colorstring.find_first_not_of(separators);
+		for (int i=0; (i<3) && (start != string::npos); i++) {
+			size_t end = colorstring.find_first_of(separators, start);
+			sscanf(colorstring.substr(start, end - start).c_str(), "%d", &values[i]);
+			start = colorstring.find_first_not_of(separators, end);
 		}
+		int tred   = values[0];
+		int tgreen = values[1];
+		int tblue  = values[2];
 		if (tred > 0 && tgreen > 0 && tblue > 0) {
 			output.setColor(tred, tgreen, tblue);
 			return output;
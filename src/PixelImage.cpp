@@ -0,0 +1,434 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 19:05:48 PDT 2026
+// Last Modified: Sat Oct 17 19:05:48 PDT 2026
+// Filename:      PixelImage.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/PixelImage.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   RGB raster image for PixelColor-based image tools.
+//
+
+#include "PixelImage.h"
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// PixelImage::PixelImage --
+//
+
+PixelImage::PixelImage(void) {
+	// do nothing
+}
+
+PixelImage::PixelImage(int width, int height) {
+	setSize(width, height);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::clear -- Remove all rows from the image.
+//
+
+void PixelImage::clear(void) {
+	m_width = 0;
+	m_pixels.clear();
+	m_repeats.clear();
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setSize -- Set the image to the given number of black
+//    rows, each of which is stored separately.
+//
+
+void PixelImage::setSize(int width, int height) {
+	clear();
+	if ((width <= 0) || (height <= 0)) {
+		return;
+	}
+	m_width = width;
+	m_pixels.resize((size_t)width * height * 3, 0);
+	m_repeats.resize(height, 1);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getHeight -- Return the number of rows in the image,
+//    including repeated rows.
+//
+
+int PixelImage::getHeight(void) const {
+	int output = 0;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		output += m_repeats[i];
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setRowRepeat -- Set the number of times a stored row is
+//    repeated in the image (0 to remove it from the image).
+//
+
+void PixelImage::setRowRepeat(int row, int count) {
+	m_repeats.at(row) = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getRowData -- Return the RGB bytes of a stored row.
+//
+
+unsigned char* PixelImage::getRowData(int row) {
+	return m_pixels.data() + (size_t)row * m_width * 3;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::getPixel -- Return the color of a pixel in a stored row.
+//
+
+PixelColor PixelImage::getPixel(int row, int column) const {
+	const unsigned char* pixel = m_pixels.data()
+			+ ((size_t)row * m_width + column) * 3;
+	return PixelColor((int)pixel[0], (int)pixel[1], (int)pixel[2]);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::setPixel -- Set the color of a pixel in a stored row.
+//
+
+void PixelImage::setPixel(int row, int column, const PixelColor& color) {
+	unsigned char* pixel = m_pixels.data() + ((size_t)row * m_width + column) * 3;
+	pixel[0] = color.Red;
+	pixel[1] = color.Green;
+	pixel[2] = color.Blue;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::addRow -- Add a row to the bottom of the image.  Each
+//    pixel is repeated hrepeat times horizontally, and the row is
+//    repeated vrepeat times vertically.  A positive shift moves the row
+//    to the right by that many pixels, repeating the first pixel and
+//    dropping pixels at the end.  The first row sets the width of the
+//    image; later rows are cut off or padded with black to fit.
+//    Returns the index of the stored row.
+//
+
+int PixelImage::addRow(const vector<PixelColor>& pixels, int hrepeat,
+		int vrepeat, int shift) {
+	if (hrepeat < 1) {
+		hrepeat = 1;
+	}
+	if (m_repeats.empty()) {
+		m_width = (int)pixels.size() * hrepeat;
+	}
+	size_t start = m_pixels.size();
+	m_pixels.resize(start + (size_t)m_width * 3, 0);
+	m_repeats.push_back(vrepeat < 0 ? 0 : vrepeat);
+	unsigned char* rowdata = m_pixels.data() + start;
+
+	int available = (int)pixels.size() * hrepeat;
+	for (int i=0; i<m_width; i++) {
+		int source = i - shift;
+		if (source < 0) {
+			source = 0;
+		}
+		if (source >= available) {
+			break;
+		}
+		const PixelColor& color = pixels[source / hrepeat];
+		rowdata[3*i]   = color.Red;
+		rowdata[3*i+1] = color.Green;
+		rowdata[3*i+2] = color.Blue;
+	}
+	return (int)m_repeats.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePpm6 -- Write the image as a binary PPM file.
+//
+
+void PixelImage::writePpm6(ostream& out) const {
+	out << "P6\n" << m_width << " " << getHeight() << "\n255\n";
+	size_t rowsize = (size_t)m_width * 3;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		const char* rowdata = (const char*)m_pixels.data() + i * rowsize;
+		for (int j=0; j<m_repeats[i]; j++) {
+			out.write(rowdata, rowsize);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePpm3 -- Write the image as an ASCII PPM file, one
+//    image row per line.
+//
+
+void PixelImage::writePpm3(ostream& out) const {
+	out << "P3\n" << m_width << " " << getHeight() << "\n255\n";
+	string line;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		if (m_repeats[i] == 0) {
+			continue;
+		}
+		line.clear();
+		const unsigned char* rowdata = m_pixels.data() + (size_t)i * m_width * 3;
+		for (int j=0; j<m_width * 3; j++) {
+			line += to_string((int)rowdata[j]);
+			line += ' ';
+		}
+		line += '\n';
+		for (int j=0; j<m_repeats[i]; j++) {
+			out << line;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// PNG encoding helper functions:
+//
+
+//
+// pixelimage_crc -- Update the CRC-32 of a PNG chunk.
+//
+
+static unsigned int pixelimage_crc(unsigned int crc, const unsigned char* data,
+		size_t length) {
+	static const vector<unsigned int> table = []() {
+		vector<unsigned int> output(256);
+		for (unsigned int n=0; n<256; n++) {
+			unsigned int c = n;
+			for (int k=0; k<8; k++) {
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			output[n] = c;
+		}
+		return output;
+	}();
+	for (size_t i=0; i<length; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+
+//
+// pixelimage_adler -- Update the Adler-32 checksum of a zlib stream.
+//
+
+static void pixelimage_adler(unsigned int& a, unsigned int& b,
+		const unsigned char* data, size_t length) {
+	while (length > 0) {
+		// 5552 bytes can be added before the sums can overflow:
+		size_t count = length < 5552 ? length : 5552;
+		for (size_t i=0; i<count; i++) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += count;
+		length -= count;
+	}
+}
+
+
+//
+// pixelimage_writeInt -- Write a four-byte big-endian integer.
+//
+
+static void pixelimage_writeInt(unsigned char* output, unsigned int value) {
+	output[0] = (unsigned char)(value >> 24);
+	output[1] = (unsigned char)(value >> 16);
+	output[2] = (unsigned char)(value >> 8);
+	output[3] = (unsigned char)value;
+}
+
+
+//
+// pixelimage_writeChunk -- Write a PNG chunk with its length and CRC.
+//
+
+static void pixelimage_writeChunk(ostream& out, const char* type,
+		const unsigned char* data, size_t length) {
+	unsigned char buffer[4];
+	pixelimage_writeInt(buffer, (unsigned int)length);
+	out.write((const char*)buffer, 4);
+	out.write(type, 4);
+	if (length > 0) {
+		out.write((const char*)data, length);
+	}
+	unsigned int crc = 0xffffffffu;
+	crc = pixelimage_crc(crc, (const unsigned char*)type, 4);
+	crc = pixelimage_crc(crc, data, length);
+	pixelimage_writeInt(buffer, crc ^ 0xffffffffu);
+	out.write((const char*)buffer, 4);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::writePng -- Write the image as a PNG file.  The image
+//    data is not compressed: it is written in stored deflate blocks, so
+//    no compression library is needed.  Nothing is written for an empty
+//    image, since PNG files must contain at least one pixel.
+//
+
+void PixelImage::writePng(ostream& out) const {
+	int height = getHeight();
+	if ((m_width <= 0) || (height <= 0)) {
+		return;
+	}
+
+	static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	out.write((const char*)signature, 8);
+
+	unsigned char header[13];
+	pixelimage_writeInt(header, (unsigned int)m_width);
+	pixelimage_writeInt(header + 4, (unsigned int)height);
+	header[8]  = 8;  // bits per sample
+	header[9]  = 2;  // RGB color
+	header[10] = 0;  // deflate compression
+	header[11] = 0;  // adaptive filtering (only filter type 0 is used)
+	header[12] = 0;  // no interlacing
+	pixelimage_writeChunk(out, "IHDR", header, 13);
+
+	// The zlib stream is split into IDAT chunks of about 1 MB:
+	const size_t chunksize = 1 << 20;
+	vector<unsigned char> idat;
+	idat.reserve(chunksize + 8);
+	auto append = [&](const unsigned char* data, size_t length) {
+		while (length > 0) {
+			size_t count = chunksize - idat.size();
+			if (count > length) {
+				count = length;
+			}
+			idat.insert(idat.end(), data, data + count);
+			data += count;
+			length -= count;
+			if (idat.size() >= chunksize) {
+				pixelimage_writeChunk(out, "IDAT", idat.data(), idat.size());
+				idat.clear();
+			}
+		}
+	};
+
+	// zlib header: deflate with a 32K window and no compression:
+	static const unsigned char zlibheader[2] = {0x78, 0x01};
+	append(zlibheader, 2);
+
+	// Each image row is preceded by its filter type (0 = none).  The
+	// rows are written in stored blocks of up to 65535 bytes:
+	size_t rowsize = (size_t)m_width * 3;
+	size_t remaining = (size_t)height * (rowsize + 1);
+	size_t blockleft = 0;
+	unsigned int a = 1;
+	unsigned int b = 0;
+	auto deflate = [&](const unsigned char* data, size_t length) {
+		pixelimage_adler(a, b, data, length);
+		while (length > 0) {
+			if (blockleft == 0) {
+				blockleft = remaining < 65535 ? remaining : 65535;
+				remaining -= blockleft;
+				unsigned char blockheader[5];
+				blockheader[0] = remaining == 0 ? 1 : 0;
+				blockheader[1] = (unsigned char)(blockleft & 0xff);
+				blockheader[2] = (unsigned char)(blockleft >> 8);
+				blockheader[3] = (unsigned char)(~blockleft & 0xff);
+				blockheader[4] = (unsigned char)((~blockleft >> 8) & 0xff);
+				append(blockheader, 5);
+			}
+			size_t count = length < blockleft ? length : blockleft;
+			append(data, count);
+			data += count;
+			length -= count;
+			blockleft -= count;
+		}
+	};
+
+	static const unsigned char filter = 0;
+	for (int i=0; i<(int)m_repeats.size(); i++) {
+		const unsigned char* rowdata = m_pixels.data() + i * rowsize;
+		for (int j=0; j<m_repeats[i]; j++) {
+			deflate(&filter, 1);
+			deflate(rowdata, rowsize);
+		}
+	}
+
+	unsigned char checksum[4];
+	pixelimage_writeInt(checksum, (b << 16) | a);
+	append(checksum, 4);
+	if (!idat.empty()) {
+		pixelimage_writeChunk(out, "IDAT", idat.data(), idat.size());
+	}
+
+	pixelimage_writeChunk(out, "IEND", NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// PixelImage::write -- Write the image in the given format: "ppm" or
+//    "p6" for binary PPM, "p3" for ASCII PPM, or "png".  Returns false
+//    if the format is not known.
+//
+
+bool PixelImage::write(ostream& out, const string& format) const {
+	if ((format == "ppm") || (format == "p6") || (format == "P6")) {
+		writePpm6(out);
+	} else if ((format == "p3") || (format == "P3")) {
+		writePpm3(out);
+	} else if ((format == "png") || (format == "PNG")) {
+		writePng(out);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
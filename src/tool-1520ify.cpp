@@ -919,10 +919,15 @@ void Tool_1520ify::clearStates(void) {
 string Tool_1520ify::getDate(void) {
 	auto now = std::chrono::system_clock::now();
 	std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-	std::tm* local_time = std::localtime(&now_time);
-	int year = local_time->tm_year + 1900;
-	int month = local_time->tm_mon + 1; 
-	int day = local_time->tm_mday;
+	std::tm local_time;
+#ifdef _WIN32
+	localtime_s(&local_time, &now_time);
+#else
+	localtime_r(&now_time, &local_time);
+#endif
+	int year = local_time.tm_year + 1900;
+	int month = local_time.tm_mon + 1;
+	int day = local_time.tm_mday;
 	stringstream ss;
 	ss << year << "/";
 	ss << std::setw(2) << std::setfill('0') << month << "/";
@@ -940,8 +945,13 @@ string Tool_1520ify::getDate(void) {
 int Tool_1520ify::getYear(void) {
 	auto now = std::chrono::system_clock::now();
 	std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-	std::tm* local_time = std::localtime(&now_time);
-	int year = local_time->tm_year + 1900;
+	std::tm local_time;
+#ifdef _WIN32
+	localtime_s(&local_time, &now_time);
+#else
+	localtime_r(&now_time, &local_time);
+#endif
+	int year = local_time.tm_year + 1900;
 	return year;
 }
 
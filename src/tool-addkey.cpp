@@ -17,6 +17,9 @@
 //                -k key == Insert the given key.
 //                -K     == Insert the given key in a !!!key: reference
 //                          record as well.
+//                -e     == Insert the key estimated from the notes.
+//                -l     == Also insert estimated local key changes.
+//                -w dur == Window duration for local keys (default 16).
 //
 // Note: not all cases implemented yet
 //
@@ -41,6 +44,9 @@ namespace hum {
 Tool_addkey::Tool_addkey(void) {
 	define("k|key=s",           "Add given key designtation to data");
 	define("K|reference-key=b", "Update or add !!!key: designation, used with -k");
+	define("e|estimate=b",      "Add key designation estimated from the notes");
+	define("l|local=b",         "Also add estimated local key changes in the data");
+	define("w|window=d:16",     "Duration of window for local keys, in quarter notes");
 }
 
 
@@ -99,6 +105,9 @@ void Tool_addkey::initialize(void) {
 	m_addKeyRefQ = getBoolean("reference-key");
 	m_keyQ       = getBoolean("key");
 	m_key        = getString("key");
+	m_localQ     = getBoolean("local");
+	m_estimateQ  = getBoolean("estimate") || m_localQ;
+	m_window     = getDouble("window");
 	HumRegex hre;
 	hre.replaceDestructive(m_key, "", ":$");
 	hre.replaceDestructive(m_key, "", "^\\*");
@@ -113,8 +122,11 @@ void Tool_addkey::initialize(void) {
 
 void Tool_addkey::processFile(HumdrumFile& infile) {
 	initialize();
+	m_localKeys.clear();
 	if (m_keyQ) {
 		addInputKey(infile);
+	} else if (m_estimateQ) {
+		insertEstimatedKey(infile);
 	} else {
 		insertReferenceKey(infile);
 	}
@@ -209,6 +221,63 @@ void Tool_addkey::insertReferenceKey(HumdrumFile& infile) {
 	if (!hre.search(keyValue, "^\\*")) {
 		hre.replaceDestructive(keyValue, "*", "^");
 	}
+	insertKey(infile, keyValue);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::insertEstimatedKey -- Insert the key estimated from the
+//    notes in the score.  With the -l option, the initial key is the local
+//    key at the start of the music, and a key designation is also added
+//    before each data line where the local key changes.
+//
+
+void Tool_addkey::insertEstimatedKey(HumdrumFile& infile) {
+	getLineIndexes(infile);
+
+	m_estimator.setWindow(HumNum(int(m_window * 1000.0 + 0.5), 1000));
+	m_estimator.analyze(infile);
+
+	string desig = m_estimator.getGlobalKeyDesignation();
+	if (m_localQ) {
+		int startIndex = -1;
+		for (int i=0; i<infile.getLineCount(); i++) {
+			if (infile[i].isData()) {
+				startIndex = i;
+				break;
+			}
+		}
+		if (startIndex >= 0) {
+			desig = m_estimator.getKeyDesignation(startIndex);
+		}
+		vector<int> changes;
+		m_estimator.getKeyChanges(changes);
+		m_localKeys.resize(infile.getLineCount());
+		for (int i=0; i<(int)changes.size(); i++) {
+			m_localKeys.at(changes[i]) = m_estimator.getKeyDesignation(changes[i]);
+		}
+	}
+
+	if (desig.empty()) {
+		// No notes in the score.
+		return;
+	}
+	insertKey(infile, desig);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::insertKey -- Replace the key designations in the header
+//    with the given one, or add a key designation line after the key
+//    signature line (or before the first data line if there is no key
+//    signature).
+//
+
+void Tool_addkey::insertKey(HumdrumFile& infile, const string& desig) {
 	if (m_keyDesigIndex > 0) {
 		for (int i=m_exinterpIndex+1; i<=m_keyDesigIndex; i++) {
 			if (!infile[i].isInterpretation()) {
@@ -219,16 +288,17 @@ void Tool_addkey::insertReferenceKey(HumdrumFile& infile) {
 				if (!token->isKeyDesignation()) {
 					continue;
 				}
-				string text = "*" + keyValue;
-				token->setText(text);
+				token->setText(desig);
 			}
 		}
 		infile.generateLinesFromTokens();
-		m_humdrum_text << infile;
+		for (int i=0; i<infile.getLineCount(); i++) {
+			printLine(infile, i);
+		}
 	} else if (m_keySigIndex > 0) {
-		printKeyDesig(infile, m_keySigIndex, keyValue, +1);
+		printKeyDesig(infile, m_keySigIndex, desig, +1);
 	} else if (m_dataStartIndex > 0) {
-		printKeyDesig(infile, m_dataStartIndex, keyValue, -1);
+		printKeyDesig(infile, m_dataStartIndex, desig, -1);
 	}
 }
 
@@ -243,25 +313,14 @@ void Tool_addkey::printKeyDesig(HumdrumFile& infile, int index, const string& de
 	int index2 = index + direction;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (i != index2) {
-			m_humdrum_text << infile[i] << endl;
+			printLine(infile, i);
 		} else {
 			if (index > index2) {
-				m_humdrum_text << infile[i] << endl;
+				printLine(infile, i);
 			}
-			for (int j=0; j<infile[index].getFieldCount(); j++) {
-				HTp token = infile.token(index, j);
-				if (j > 0) {
-					m_humdrum_text << "\t";
-				}
-				if (token->isKern()) {
-					m_humdrum_text << desig;
-				} else {
-					m_humdrum_text << "*";
-				}
-			}
-			m_humdrum_text << endl;
+			printKeyLine(infile, index, desig);
 			if (index < index2) {
-				m_humdrum_text << infile[i] << endl;
+				printLine(infile, i);
 			}
 		}
 	}
@@ -269,6 +328,45 @@ void Tool_addkey::printKeyDesig(HumdrumFile& infile, int index, const string& de
 
 
 
+//////////////////////////////
+//
+// Tool_addkey::printKeyLine -- Print an interpretation line with the
+//    key designation in each **kern spine, using the spine layout of
+//    the given line.
+//
+
+void Tool_addkey::printKeyLine(HumdrumFile& infile, int index, const string& desig) {
+	for (int j=0; j<infile[index].getFieldCount(); j++) {
+		HTp token = infile.token(index, j);
+		if (j > 0) {
+			m_humdrum_text << "\t";
+		}
+		if (token->isKern()) {
+			m_humdrum_text << desig;
+		} else {
+			m_humdrum_text << "*";
+		}
+	}
+	m_humdrum_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_addkey::printLine -- Print a line of the input file, preceded by
+//    a local key designation line if the local key changes there.
+//
+
+void Tool_addkey::printLine(HumdrumFile& infile, int index) {
+	if ((index < (int)m_localKeys.size()) && !m_localKeys[index].empty()) {
+		printKeyLine(infile, index, m_localKeys[index]);
+	}
+	m_humdrum_text << infile[index] << endl;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_addkey::getLineIndexes --
@@ -835,7 +835,13 @@ void Tool_chantize::clearStates(void) {
 
 string Tool_chantize::getDate(void) {
 	time_t t = time(NULL);
-	tm* timeptr = localtime(&t);
+	tm localtm;
+#ifdef _WIN32
+	localtime_s(&localtm, &t);
+#else
+	localtime_r(&t, &localtm);
+#endif
+	tm* timeptr = &localtm;
 	stringstream ss;
 	int year = timeptr->tm_year + 1900;
 	int month = timeptr->tm_mon + 1;
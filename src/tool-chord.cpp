@@ -166,26 +166,32 @@ void Tool_chord::processFile(HumdrumFile& infile, int direction) {
 //
 
 void Tool_chord::processChord(HTp tok, int direction) {
-	vector<string> notes;
-	int count = (int)tok->getSubtokenCount();
-	for (int i=0; i<count; i++) {
-		notes.emplace_back(tok->getSubtoken(i));
-	}
-
-	if (notes.size() <= 1) {
+	HumSubtokenView subtokens = tok->getSubtokenView();
+	int count = subtokens.size();
+	if (count <= 1) {
 		// nothing to do
 		return;
 	}
 
 	bool ismin = false;
 	HumRegex hre;
-	if (!hre.search(notes[1], "[0-9]")) {
+	if (subtokens[1].getText().find_first_of("0123456789") == std::string_view::npos) {
 		ismin = true;
 	}
 
+	vector<string> notes;
+	notes.reserve(count);
 	vector<pair<int, int>> pitches(count);
-	for (int i=0; i<(int)pitches.size(); i++) {
-		pitches[i].first = Convert::kernToBase40(notes[i]);
+	for (const HumSubtoken& subtoken : subtokens) {
+		int i = subtoken.getIndex();
+		notes.emplace_back(subtoken.getText());
+		if (subtoken.hasPitch()) {
+			pitches[i].first = subtoken.getBase40();
+		} else {
+			// same as Convert::kernToBase40() for rests and subtokens
+			// without pitches:
+			pitches[i].first = subtoken.contains('r') ? -1000 : -2000;
+		}
 		pitches[i].second = i;
 	}
 
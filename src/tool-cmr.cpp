@@ -27,16 +27,20 @@
 #include "Convert.h"
 #include "HumRegex.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <thread>
+
 using namespace std;
 
 namespace hum {
 
 // START_MERGE
 
-double cmr_note_info::m_syncopationWeight = 1.0;
-double cmr_note_info::m_leapWeight = 0.5;
-
-
 ///////////////////////////////////////////////////////////////////////////
 //
 // cmr_note_info -- Helper class describing a conspicuous repetition note.
@@ -291,12 +295,16 @@ bool cmr_note_info::isLeapBefore(HTp token) {
 //
 
 double cmr_note_info::getMetricLevel(HTp token) {
-	HumNum beat = token->getDurationFromBarline();
-	if (!beat.isInteger()) { // anything less than quarter note level
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	if (tick % tpq != 0) { // anything less than quarter note level
 		return -1;
-	} else if (beat.getNumerator() % 4 == 0) { // whole note level
+	}
+	int quarters = tick / tpq;
+	if (quarters % 4 == 0) { // whole note level
 		return 2;
-	} else if (beat.getNumerator() % 2 == 0) { // half note level
+	} else if (quarters % 2 == 0) { // half note level
 		return 1;
 	} else { // quarter note level
 		return 0;
@@ -310,15 +318,17 @@ double cmr_note_info::getMetricLevel(HTp token) {
 // cmr_note_info::getNoteStrength -- Calculate a strength value for the
 //     note.  This is based on if the note is syncopated and/or if it
 //     is preceded by a melodic leap.
+// default value: syncopationWeight = 1.0
+// default value: leapWeight = 0.5
 //
 
-double cmr_note_info::getNoteStrength(void) {
+double cmr_note_info::getNoteStrength(double syncopationWeight, double leapWeight) {
 	double output = 1.0;
 	if (hasSyncopation()) {
-		output += m_syncopationWeight;
+		output += syncopationWeight;
 	}
 	if (hasLeapBefore()) {
-		output += m_leapWeight;
+		output += leapWeight;
 	}
 	return output;
 }
@@ -767,12 +777,14 @@ int cmr_group_info::getStartFieldNumber(void) {
 //////////////////////////////
 //
 // cmr_group_info::getGroupStrength -- Return the strength value for the CMR.
+// default value: syncopationWeight = 1.0
+// default value: leapWeight = 0.5
 //
 
-double cmr_group_info::getGroupStrength(void) {
+double cmr_group_info::getGroupStrength(double syncopationWeight, double leapWeight) {
 	double output = 0.0;
 	for (int i=0; i<(int)m_notes.size(); i++) {
-		output += m_notes[i].getNoteStrength();
+		output += m_notes[i].getNoteStrength(syncopationWeight, leapWeight);
 	}
 	return output;
 }
@@ -959,6 +971,116 @@ string cmr_group_info::getPitch(void) {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// cmr_range_max::clear -- Remove the contents of the table.
+//
+
+void cmr_range_max::clear(void) {
+	m_table.clear();
+	m_log2.clear();
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::build -- Prepare the sparse table for the given values.
+//    Each level k stores the maximum of the 2^k values starting at each
+//    index, so any range is covered by two (overlapping) table entries.
+//
+
+void cmr_range_max::build(const vector<int>& values) {
+	int size = (int)values.size();
+	m_log2.resize(size + 1);
+	m_log2[0] = 0;
+	if (size > 0) {
+		m_log2[1] = 0;
+	}
+	for (int i=2; i<=size; i++) {
+		m_log2[i] = m_log2[i/2] + 1;
+	}
+	int levels = size > 0 ? m_log2[size] + 1 : 0;
+	m_table.resize(levels);
+	if (levels == 0) {
+		return;
+	}
+	m_table[0] = values;
+	for (int k=1; k<levels; k++) {
+		int width = 1 << k;
+		int half = width / 2;
+		vector<int>& previous = m_table[k-1];
+		vector<int>& current = m_table[k];
+		current.resize(size - width + 1);
+		for (int i=0; i<(int)current.size(); i++) {
+			current[i] = max(previous[i], previous[i+half]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::getMaximum -- Return the maximum value in the inclusive
+//    index range.
+//
+
+int cmr_range_max::getMaximum(int index1, int index2) const {
+	int k = m_log2[index2 - index1 + 1];
+	return max(m_table[k][index1], m_table[k][index2 - (1 << k) + 1]);
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::findFirstAbove -- Return the first index in the inclusive
+//    range which has a value greater than the threshold, or -1 if none.
+//
+
+int cmr_range_max::findFirstAbove(int index1, int index2, int threshold) const {
+	if ((index1 > index2) || (getMaximum(index1, index2) <= threshold)) {
+		return -1;
+	}
+	while (index1 < index2) {
+		int middle = (index1 + index2) / 2;
+		if (getMaximum(index1, middle) > threshold) {
+			index2 = middle;
+		} else {
+			index1 = middle + 1;
+		}
+	}
+	return index1;
+}
+
+
+
+//////////////////////////////
+//
+// cmr_range_max::findLastAbove -- Return the last index in the inclusive
+//    range which has a value greater than the threshold, or -1 if none.
+//
+
+int cmr_range_max::findLastAbove(int index1, int index2, int threshold) const {
+	if ((index1 > index2) || (getMaximum(index1, index2) <= threshold)) {
+		return -1;
+	}
+	while (index1 < index2) {
+		int middle = (index1 + index2 + 1) / 2;
+		if (getMaximum(middle, index2) > threshold) {
+			index1 = middle;
+		} else {
+			index2 = middle - 1;
+		}
+	}
+	return index1;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 /////////////////////////////////
@@ -992,6 +1114,7 @@ Tool_cmr::Tool_cmr(void) {
 	define("strengthplot=b",              "output Vega-lite plot with strength scores");
 	define("h|half=b",                    "durations given in half notes (mimims)");
 	define("D|debug=b",                   "print debug information");
+	define("j|jobs|threads=i:1",          "number of threads for corpus statistics (-S, -v)");
 }
 
 
@@ -1002,6 +1125,11 @@ Tool_cmr::Tool_cmr(void) {
 //
 
 bool Tool_cmr::run(HumdrumFileSet& infiles) {
+	initialize();
+	if (isCorpusMode() && (infiles.getCount() > 1)) {
+		processCorpus(infiles);
+		return true;
+	}
 	bool status = true;
 	for (int i=0; i<infiles.getCount(); i++) {
 		status &= run(infiles[i]);
@@ -1040,6 +1168,41 @@ bool Tool_cmr::run(HumdrumFile& infile) {
 }
 
 
+//
+// Input files are read in batches when doing corpus statistics with
+// multiple threads, otherwise one at a time.
+//
+
+bool Tool_cmr::run(HumdrumFileStream& instream) {
+	initialize();
+	if (!isCorpusMode()) {
+		HumdrumFileSet infiles;
+		bool status = true;
+		while (instream.readSingleSegment(infiles)) {
+			status &= run(infiles);
+		}
+		return status;
+	}
+
+	int batchsize = m_threads * 16;
+	bool done = false;
+	while (!done) {
+		HumdrumFileSet infiles;
+		while (infiles.getCount() < batchsize) {
+			HumdrumFile* infile = new HumdrumFile;
+			if (!instream.getFile(*infile)) {
+				delete infile;
+				done = true;
+				break;
+			}
+			infiles.appendHumdrumPointer(infile);
+		}
+		processCorpus(infiles);
+	}
+	return true;
+}
+
+
 
 //////////////////////////////
 //
@@ -1077,14 +1240,110 @@ void Tool_cmr::initialize(void) {
 	m_infoQ        = getBoolean("info");
 	m_halfQ        = getBoolean("half");
 
-	cmr_note_info::m_syncopationWeight = getDouble("syncopation-weight");
-	cmr_note_info::m_leapWeight        = getDouble("leap-weight");
+	m_syncopationWeight = getDouble("syncopation-weight");
+	m_leapWeight        = getDouble("leap-weight");
+
+	m_threads = getInteger("threads");
+	if (m_threads < 1) {
+		m_threads = 1;
+	}
 
 	m_noteGroups.clear();
 }
 
 
 
+//////////////////////////////
+//
+// Tool_cmr::isCorpusMode -- True if only statistics are output for each
+//    file, so that the files can be analyzed in parallel.  Raw data
+//    and debugging output are printed directly and so are excluded.
+//
+
+bool Tool_cmr::isCorpusMode(void) {
+	if (m_threads <= 1) {
+		return false;
+	}
+	if (m_rawQ || m_debugQ || m_infoQ || m_localOnlyQ) {
+		return false;
+	}
+	return m_summaryQ || m_vegaQ || m_vegaCountQ || m_vegaStrengthQ;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cmr::processCorpus -- Analyze a set of files in parallel, with
+//    a separate Tool_cmr for each file.  The results are merged in input
+//    order, so the output is the same as processing the files one at a
+//    time.
+//
+
+void Tool_cmr::processCorpus(HumdrumFileSet& infiles) {
+	int count = infiles.getCount();
+	if (count == 0) {
+		return;
+	}
+
+	// Workers are configured before any thread starts so that option
+	// errors are reported in order.
+	vector<unique_ptr<Tool_cmr>> workers(count);
+	for (int i=0; i<count; i++) {
+		workers[i] = make_unique<Tool_cmr>();
+		workers[i]->process(m_argv);
+		workers[i]->initialize();
+	}
+
+	atomic<int> next(0);
+	auto analyze = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			workers[index]->processFile(infiles[index]);
+		}
+	};
+
+	int threadcount = min(m_threads, count);
+	vector<thread> threads;
+	threads.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		threads.emplace_back(analyze);
+	}
+	analyze();
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+
+	for (int i=0; i<count; i++) {
+		mergeCorpusResults(*workers[i]);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cmr::mergeCorpusResults -- Append the statistics and text output
+//    of a worker to the totals.
+//
+
+void Tool_cmr::mergeCorpusResults(Tool_cmr& worker) {
+	m_humdrum_text << worker.m_humdrum_text.str();
+	m_free_text    << worker.m_free_text.str();
+	m_warning_text << worker.m_warning_text.str();
+	m_error_text   << worker.m_error_text.str();
+	m_vegaData     << worker.m_vegaData.str();
+	m_cmrCount.insert(m_cmrCount.end(),
+			worker.m_cmrCount.begin(), worker.m_cmrCount.end());
+	m_cmrNoteCount.insert(m_cmrNoteCount.end(),
+			worker.m_cmrNoteCount.begin(), worker.m_cmrNoteCount.end());
+	m_scoreNoteCount.insert(m_scoreNoteCount.end(),
+			worker.m_scoreNoteCount.begin(), worker.m_scoreNoteCount.end());
+	m_noteCount += worker.m_noteCount;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cmr::processFile -- Do CMR analysis on score.
@@ -1210,6 +1469,7 @@ void Tool_cmr::processSpine(HTp startok, HumdrumFile&  infile) {
 	getMetlev(m_metlevs, m_notelist);
 	getSyncopation(m_syncopation, m_notelist);
 	getLeapBefore(m_leapbefore, m_midinums);
+	prepareRangeQueries(infile);
 
 	if (m_localQ) {
 		markNotes(m_notelist, m_localpeaks, m_local_marker);
@@ -1257,6 +1517,7 @@ void Tool_cmr::processSpineFlipped(HTp startok, HumdrumFile& infile) {
 	getMetlev(m_metlevs, m_notelist);
 	getSyncopation(m_syncopation, m_notelist);
 	getLeapBefore(m_leapbefore, m_midinums);
+	prepareRangeQueries(infile);
 
 
 	if (m_rawQ) {
@@ -1305,64 +1566,43 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 	}
 
 	int pitch = m_midinums.at(index);
+	int64_t onset = m_onsets.at(index);
 
 	// Create list of notes with same pitch within target duration after target note.
 	vector<int> candidates;
 	candidates.push_back(index);
 
-	int i = index+1;
-	HumNum duration = 0;
-	if (i < (int)m_notelist.size()) {
-		duration = m_notelist.at(i).at(0)->getDurationFromStart() - m_notelist.at(index).at(0)->getDurationFromStart();
+	// Check for matching peaks after target note.  The search stops at
+	// the end of the time window or before the first note that is more
+	// than a major second above the peak note:
+	int last = (int)(upper_bound(m_onsets.begin() + index + 1, m_onsets.end(),
+			onset + m_cmrTicks) - m_onsets.begin()) - 1;
+	int blocker = m_pitchMax.findFirstAbove(index + 1, last, pitch + 2);
+	if (blocker >= 0) {
+		last = blocker - 1;
 	}
-
-	// Check for matching peaks after target note:
-	while ((i < (int)m_notelist.size()) && (duration.getFloat() <= m_cmrDur)) {
-		if (m_midinums.at(i) > pitch + 2) {
-			// Cannot exceed a major second above peak note
-			// maybe check if adjacent to a peak note
-			break;
+	for (int i=m_nextSame.at(index); (i >= 0) && (i <= last); i = m_nextSame.at(i)) {
+		if (m_accented.at(i)) {
+			candidates.push_back(i);
 		}
-		if (m_midinums.at(i) == pitch) {
-			double metlev = m_metlevs.at(i);
-			if (metlev > 1) { // has to be on whole-note level (metlev == 2)
-				candidates.push_back(i);
-			} else if (isMelodicallyAccented(i)) {
-				candidates.push_back(i);
-			}
-		}
-		i++;
-		if (i < (int)m_notelist.size()) {
-			duration = m_notelist.at(i).at(0)->getDurationFromStart() - m_notelist.at(index).at(0)->getDurationFromStart();
-		}
-	}
-
-	i = index-1;
-	duration = 0;
-	if (i < (int)m_notelist.size()) {
-		duration = m_notelist.at(index).at(0)->getDurationFromStart() - m_notelist.at(i).at(0)->getDurationFromStart();
 	}
 
 	// Check for matching peaks before target note:
-	while ((i >= 0) && (duration.getFloat() <= m_cmrDur)) {
-		if (m_midinums.at(i) > pitch + 2) {
-			// Cannot exceed a major second above peak note
-			// maybe check if adjacent to a peak note
-			break;
-		}
-		if (m_midinums.at(i) == pitch) {
-			double metlev = m_metlevs.at(i);
-			if (metlev > 1) { // has to be on whole-note level (metlev == 2)
-				candidates.insert(candidates.begin(), i);
-			} else if (isMelodicallyAccented(i)) {
-				candidates.insert(candidates.begin(), i);
-			}
-		}
-		i--;
-		if (i >= 0) {
-			duration = m_notelist.at(index).at(0)->getDurationFromStart() - m_notelist.at(i).at(0)->getDurationFromStart();
+	int first = (int)(lower_bound(m_onsets.begin(), m_onsets.begin() + index,
+			onset - m_cmrTicks) - m_onsets.begin());
+	blocker = m_pitchMax.findLastAbove(first, index - 1, pitch + 2);
+	if (blocker >= 0) {
+		first = blocker + 1;
+	}
+	vector<int> before;
+	for (int i=m_prevSame.at(index); (i >= 0) && (i >= first); i = m_prevSame.at(i)) {
+		if (m_accented.at(i)) {
+			before.push_back(i);
 		}
 	}
+	if (!before.empty()) {
+		candidates.insert(candidates.begin(), before.rbegin(), before.rend());
+	}
 
 	if ((int)candidates.size() < m_cmrNum) {
 		// Not enough notes to consider a CMR.
@@ -1372,13 +1612,10 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 	for (int i=0; i<=(int)candidates.size() - m_cmrNum; i++) {
 		int index1 = candidates.at(i);
 		int index2 = candidates.at(i+m_cmrNum-1);
-		HumNum dur1 = m_notelist.at(index1).at(0)->getDurationFromStart();
-		HumNum dur2 = m_notelist.at(index2).at(0)->getDurationFromStart();
-		HumNum duration = dur2 - dur1;
-		if (duration > m_cmrDur) {
+		if (m_onsets.at(index2) - m_onsets.at(index1) > m_cmrTicks) {
 			continue;
 		}
-		if (hasHigher(pitch, 2, m_midinums, m_notelist, index1, index2)) {
+		if (hasHigher(pitch, 2, index1, index2)) {
 			continue;
 		}
 
@@ -1398,14 +1635,16 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 		}
 	}
 
+	if (m_noteGroups.empty()) {
+		return;
+	}
+
 	int leapcount = m_noteGroups.back().getLeapCount();
 	int syncocount  = m_noteGroups.back().getSyncopationCount();
 	if (syncocount == 0) {
 		if (leapcount < 3) {
 			// Delete groups since it has less than three leaps and no syncopations
-			if (m_noteGroups.size() > 0) {
-				m_noteGroups.resize(m_noteGroups.size() - 1);
-			}
+			m_noteGroups.resize(m_noteGroups.size() - 1);
 		}
 	}
 
@@ -1441,28 +1680,69 @@ void Tool_cmr::checkForCmr(int index, int direction, HumdrumFile& infile) {
 // Tool_cmr::hasHigher -- There may be a note a step higher
 //     (or lower) between any two notes of the CMR provided
 //     that that higher note is not on a strong beat.
-//     True = invalid CMR case.
+//     True = invalid CMR case.  Uses the range-maximum tables
+//     prepared in prepareRangeQueries().
+//
+
+bool Tool_cmr::hasHigher(int pitch, int tolerance, int index1, int index2) {
+	// Only a step above (major or minor second) is allowed.
+	// Input tolerance is 2.
+	if (m_pitchMax.getMaximum(index1, index2) > pitch + tolerance) {
+		return true;
+	}
+	// If a higher note is accented, then invalidate the cmr.
+	if (m_strongMax.getMaximum(index1, index2) > pitch) {
+		return true;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cmr::prepareRangeQueries -- Store integer onset times, strong-beat
+//     and accent flags, same-pitch links and range-maximum tables for
+//     the current part so that checkForCmr() does not need to rescan
+//     notes for each candidate.  Must be called after m_midinums,
+//     m_metlevs, m_syncopation and m_leapbefore are prepared.
 //
 
-bool Tool_cmr::hasHigher(int pitch, int tolerance, vector<int>& midinums, vector<vector<HTp>>& notelist, int index1, int index2) {
+void Tool_cmr::prepareRangeQueries(HumdrumFile& infile) {
+	int count = (int)m_notelist.size();
+	int tpq = infile.tpq();
+	m_cmrTicks = (int64_t)floor(m_cmrDur * tpq);
 
-	for (int i=index1; i<=index2; i++) {
-		// Only a step above (major or minor second) is allowed.
-		// Input tolerance is 2.
-		if (midinums.at(i) > pitch + tolerance) {
-			return true;
-		}
+	m_onsets.resize(count);
+	m_strongBeat.resize(count);
+	m_accented.resize(count);
+	vector<int> strongpitches(count);
+	for (int i=0; i<count; i++) {
+		HTp token = m_notelist.at(i).at(0);
+		HumNum onset = token->getDurationFromStart() * tpq;
+		m_onsets[i] = (int64_t)onset.getNumerator() / onset.getDenominator();
+		m_strongBeat[i] = isOnStrongBeat(token);
+		// has to be on whole-note level (metlev == 2) or melodically accented:
+		m_accented[i] = (m_metlevs.at(i) > 1) || isMelodicallyAccented(i);
+		strongpitches[i] = m_strongBeat[i] ? m_midinums.at(i) : INT_MIN;
+	}
 
-		if (midinums.at(i) > pitch) {
-			// If the higher note is accented, then invalidate the cmr.
-			if (isOnStrongBeat(notelist.at(i).at(0))) {
-				return true;
-			}
+	m_nextSame.assign(count, -1);
+	m_prevSame.assign(count, -1);
+	map<int, int> lastindex;
+	for (int i=0; i<count; i++) {
+		auto it = lastindex.find(m_midinums.at(i));
+		if (it != lastindex.end()) {
+			m_prevSame[i] = it->second;
+			m_nextSame[it->second] = i;
+			it->second = i;
+		} else {
+			lastindex[m_midinums.at(i)] = i;
 		}
-
 	}
 
-	return false;
+	m_pitchMax.build(m_midinums);
+	m_strongMax.build(strongpitches);
 }
 
 
@@ -1770,7 +2050,7 @@ void Tool_cmr::printGroupStatistics(HumdrumFile& infile) {
 		m_humdrum_text << "!!!cmr_end_measure: "   << m_noteGroups[i].getMeasureEnd()       << endl;
 		// Durations are in units of whole notes (semibreves):
 		m_humdrum_text << "!!!cmr_duration: "      << groupDuration << m_durUnit            << endl;
-		m_humdrum_text << "!!!cmr_strength: "      << m_noteGroups[i].getGroupStrength()    << endl;
+		m_humdrum_text << "!!!cmr_strength: "      << m_noteGroups[i].getGroupStrength(m_syncopationWeight, m_leapWeight) << endl;
 		m_humdrum_text << "!!!cmr_direction: "     << m_noteGroups[i].getDirection()        << endl;
 		m_humdrum_text << "!!!cmr_note_count: "    << m_noteGroups[i].getNoteCount()        << endl;
 		m_humdrum_text << "!!!cmr_pitch: "         << m_noteGroups[i].getPitch()            << endl;
@@ -2522,14 +2802,10 @@ void Tool_cmr::getBeat(vector<bool>& metpos, vector<vector<HTp>>& notelist) {
 //
 
 bool Tool_cmr::isOnStrongBeat(HTp token) {
-	HumNum position = token->getDurationFromBarline();
-	if (position.getDenominator() != 1) {
-		return false;
-	} if (position.getNumerator() % 4 == 0) {
-		return true;
-	} else {
-		return false;
-	}
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	return tick % (tpq * 4) == 0;
 }
 
 
@@ -2634,7 +2910,7 @@ int Tool_cmr::getStrengthScore(void) {
 	int output = 0;
 	for (int i=0; i<(int)m_noteGroups.size(); i++) {
 		if (m_noteGroups[i].isValid()) {
-			output += m_noteGroups[i].getGroupStrength();
+			output += m_noteGroups[i].getGroupStrength(m_syncopationWeight, m_leapWeight);
 		}
 	}
 	return output;
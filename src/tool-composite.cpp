@@ -23,6 +23,7 @@
 #include "Convert.h"
 #include "HumRegex.h"
 
+#include <bitset>
 #include <sstream>
 
 using namespace std;
@@ -45,6 +46,223 @@ namespace hum {
 #define COMPOSITE_TREMOLO_MARKER "||"
 
 
+
+//////////////////////////////
+//
+// OnsetBitmap::resize -- Set the number of bits in the bitmap.  All
+//    bits are cleared.
+//
+
+void OnsetBitmap::resize(int size) {
+	m_size = size < 0 ? 0 : size;
+	m_words.resize((m_size + 63) / 64);
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::clear -- Set all bits to zero.
+//
+
+void OnsetBitmap::clear(void) {
+	fill(m_words.begin(), m_words.end(), 0);
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::set -- Turn on a bit.
+//
+
+void OnsetBitmap::set(int index) {
+	m_words.at(index >> 6) |= ((uint64_t)1) << (index & 63);
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::unset -- Turn off a bit.
+//
+
+void OnsetBitmap::unset(int index) {
+	m_words.at(index >> 6) &= ~(((uint64_t)1) << (index & 63));
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::test -- Returns true if the bit is on.
+//
+
+bool OnsetBitmap::test(int index) const {
+	if ((index < 0) || (index >= m_size)) {
+		return false;
+	}
+	return (m_words[index >> 6] >> (index & 63)) & 1;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::count -- Returns the number of bits that are on.
+//
+
+int OnsetBitmap::count(void) const {
+	int output = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		output += (int)std::bitset<64>(m_words[i]).count();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::next -- Returns the index of the first bit that is on
+//    starting at the given index.  Returns -1 if there are no more
+//    bits that are on.
+//
+
+int OnsetBitmap::next(int index) const {
+	if (index < 0) {
+		index = 0;
+	}
+	if (index >= m_size) {
+		return -1;
+	}
+	int w = index >> 6;
+	uint64_t word = m_words[w] & (~((uint64_t)0) << (index & 63));
+	while (true) {
+		if (word) {
+			int bit = 0;
+			while (!(word & 1)) {
+				word >>= 1;
+				bit++;
+			}
+			int output = (w << 6) + bit;
+			return output < m_size ? output : -1;
+		}
+		w++;
+		if (w >= (int)m_words.size()) {
+			return -1;
+		}
+		word = m_words[w];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::clearBefore -- Turn off all bits before the given index.
+//
+
+void OnsetBitmap::clearBefore(int index) {
+	if (index >= m_size) {
+		clear();
+		return;
+	}
+	for (int i=0; i<(index >> 6); i++) {
+		m_words[i] = 0;
+	}
+	if (index > 0) {
+		m_words[index >> 6] &= ~((uint64_t)0) << (index & 63);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::shiftUp -- Move all bits to the next higher index.
+//
+
+OnsetBitmap& OnsetBitmap::shiftUp(void) {
+	uint64_t carry = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		uint64_t newcarry = m_words[i] >> 63;
+		m_words[i] = (m_words[i] << 1) | carry;
+		carry = newcarry;
+	}
+	if (m_size & 63) {
+		m_words.back() &= (((uint64_t)1) << (m_size & 63)) - 1;
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::operator|= -- Union of two bitmaps.
+//
+
+OnsetBitmap& OnsetBitmap::operator|=(const OnsetBitmap& other) {
+	int count = (int)std::min(m_words.size(), other.m_words.size());
+	for (int i=0; i<count; i++) {
+		m_words[i] |= other.m_words[i];
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::operator&= -- Intersection of two bitmaps.
+//
+
+OnsetBitmap& OnsetBitmap::operator&=(const OnsetBitmap& other) {
+	for (int i=0; i<(int)m_words.size(); i++) {
+		if (i < (int)other.m_words.size()) {
+			m_words[i] &= other.m_words[i];
+		} else {
+			m_words[i] = 0;
+		}
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::andNot -- Turn off bits that are on in the other bitmap.
+//
+
+OnsetBitmap& OnsetBitmap::andNot(const OnsetBitmap& other) {
+	int count = (int)std::min(m_words.size(), other.m_words.size());
+	for (int i=0; i<count; i++) {
+		m_words[i] &= ~other.m_words[i];
+	}
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// OnsetBitmap::invert -- Toggle all bits.
+//
+
+OnsetBitmap& OnsetBitmap::invert(void) {
+	for (int i=0; i<(int)m_words.size(); i++) {
+		m_words[i] = ~m_words[i];
+	}
+	if (m_size & 63) {
+		m_words.back() &= (((uint64_t)1) << (m_size & 63)) - 1;
+	}
+	return *this;
+}
+
+
 /////////////////////////////////
 //
 // Tool_composite::Tool_composite -- Set the recognized options for the tool.
@@ -288,6 +506,8 @@ void Tool_composite::processFile(HumdrumFile& infile) {
 	if (m_groupsQ) {
 		checkForAutomaticGrouping(infile);
 	}
+	// Build the bitmaps after any grouping lines are inserted into the file:
+	buildOnsetBitmaps(infile);
 
 	if (m_coincidenceQ) {
 		analyzeCoincidenceRhythms(infile);
@@ -1008,7 +1228,7 @@ string Tool_composite::getCoincidenceToken(HumdrumFile& infile, int line) {
 		} else if (line == m_instrumentNameIndex) {
 			string output = "*I\"Coincidence";
 			if (m_eventQ) {
-				m_coincidenceEventCount = getEventCount(m_coincidence);
+				m_coincidenceEventCount = m_coincidenceEvents.count();
 				stringstream value;
 				value.str("");
 				value << "\\n(" << m_coincidenceEventCount << " event";
@@ -1070,7 +1290,7 @@ string Tool_composite::getFullCompositeToken(HumdrumFile& infile, int line) {
 		} else if (line == m_instrumentNameIndex) {
 			string output = "*I\"Composite";
 			if (m_eventQ) {
-				m_fullCompositeEventCount = getEventCount(m_fullComposite);
+				m_fullCompositeEventCount = m_fullCompositeEvents.count();
 				stringstream value;
 				value.str("");
 				value << "\\n(" << m_fullCompositeEventCount << " event";
@@ -1223,7 +1443,7 @@ string Tool_composite::getGroupCompositeToken(HumdrumFile& infile, int line, int
 			if (group == 0) {
 				string output = "*I\"Group A";
 				if (m_eventQ) {
-					m_groupAEventCount = getEventCount(m_groups.at(0));
+					m_groupAEventCount = m_groupEvents.at(0).count();
 					stringstream value;
 					value.str("");
 					value << "\\n(" << m_groupAEventCount << " event";
@@ -1237,7 +1457,7 @@ string Tool_composite::getGroupCompositeToken(HumdrumFile& infile, int line, int
 			} else {
 				string output = "*I\"Group B";
 				if (m_eventQ) {
-					m_groupBEventCount = getEventCount(m_groups.at(1));
+					m_groupBEventCount = m_groupEvents.at(1).count();
 					stringstream value;
 					value.str("");
 					value << "\\n(" << m_groupBEventCount << " event";
@@ -1349,56 +1569,135 @@ string Tool_composite::getMetricSymbol(HumdrumFile& infile, int line, const stri
 
 //////////////////////////////
 //
-// Tool_composite::analyzeFullCompositeRhythm --
+// Tool_composite::buildOnsetBitmaps -- Store the note states of each **kern
+//    track as bitmaps with one bit for each data line (slice) in the file.
+//    Slice start times are stored as integer ticks based on the tpq of the
+//    file, so rhythm durations can be calculated without HumNum arithmetic
+//    until they are rendered as **recip values.
 //
 
-void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
-
-	vector<HumNum> durations(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
-	}
-
-	vector<int> isRest(infile.getLineCount(), false);
-	vector<int> isNull(infile.getLineCount(), false);
-	vector<int> isSustain(infile.getLineCount(), false);
-
+void Tool_composite::buildOnsetBitmaps(HumdrumFile& infile) {
+	m_tpq = infile.tpq();
+	m_sliceLine.clear();
+	m_sliceTick.clear();
+	m_lineSlice.resize(infile.getLineCount());
+	fill(m_lineSlice.begin(), m_lineSlice.end(), -1);
+	m_lineTick.resize(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
-		if (durations[i] == 0) {
+		HumNum start = infile[i].getDurationFromStart();
+		m_lineTick[i] = (int64_t)start.getNumerator() * (m_tpq / start.getDenominator());
+		if (!infile[i].isData()) {
 			continue;
 		}
-		bool allnull = true;
-		bool allrest = true;
-		bool allsustain = true;
+		m_lineSlice[i] = (int)m_sliceLine.size();
+		m_sliceLine.push_back(i);
+		m_sliceTick.push_back(m_lineTick[i]);
+	}
+	// Rhythms end at the last line of the file (which is usually the same
+	// as the duration of the score).
+	m_endTick = m_lineTick.empty() ? 0 : m_lineTick.back();
+
+	int slicecount = (int)m_sliceLine.size();
+	m_nonNullSlices.resize(slicecount);
+	m_graceSlices.resize(slicecount);
+	m_fullCompositeEvents.resize(slicecount);
+	m_coincidenceEvents.resize(slicecount);
+	m_groupEvents.resize(2);
+	m_groupEvents[0].resize(slicecount);
+	m_groupEvents[1].resize(slicecount);
+	m_voiceNotes.resize(infile.getMaxTrack() + 1);
+	m_voiceAttacks.resize(infile.getMaxTrack() + 1);
+	for (int i=0; i<(int)m_voiceNotes.size(); i++) {
+		m_voiceNotes[i].resize(slicecount);
+		m_voiceAttacks[i].resize(slicecount);
+	}
+
+	for (int s=0; s<slicecount; s++) {
+		int i = m_sliceLine[s];
+		if (infile[i].getDuration() == 0) {
+			m_graceSlices.set(s);
+		}
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp tok = infile.token(i, j);
-			if (tok->isNull()) {
+			HTp token = infile.token(i, j);
+			if (token->isNull()) {
 				continue;
 			}
-			allnull = false;
-			if (!tok->isKern()) {
+			m_nonNullSlices.set(s);
+			if (!token->isKern()) {
 				continue;
 			}
-			if (tok->isNote()) {
-				allrest = false;
-				allnull = false;
-				if ((tok->find("_") == string::npos) &&
-				    (tok->find("]") == string::npos)) {
-					allsustain = false;
-				} else {
-				// 	cerr << "NOTE THAT IS SUSTAIN: " << tok << endl;
-				}
-			} else {
-				// cerr << "TOKEN IS NOT NOTE " << tok << endl;
+			if (!token->isNote()) {
+				continue;
 			}
-			if (tok->isRest()) {
-				allnull = false;
+			int track = token->getTrack();
+			m_voiceNotes[track].set(s);
+			if ((token->find('_') == string::npos) && (token->find(']') == string::npos)) {
+				m_voiceAttacks[track].set(s);
 			}
 		}
-		isRest[i]    = allrest    ? true : false;
-		isNull[i]    = allnull    ? true : false;
-		isSustain[i] = allsustain ? true : false;
 	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::getStateBitmap -- Convert a list of note states for each
+//    line in the file into a bitmap of the slices that have a state in the
+//    range from minstate to maxstate (inclusive).
+//
+
+void Tool_composite::getStateBitmap(OnsetBitmap& bitmap, vector<int>& states,
+		int minstate, int maxstate) {
+	bitmap.resize((int)m_sliceLine.size());
+	for (int s=0; s<(int)m_sliceLine.size(); s++) {
+		int value = states.at(m_sliceLine[s]);
+		if ((value >= minstate) && (value <= maxstate)) {
+			bitmap.set(s);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::getSliceDuration -- Return the duration between the
+//    start of two slices.  If the ending slice is invalid, then the
+//    duration extends to the last line of the file.
+//
+
+HumNum Tool_composite::getSliceDuration(int startslice, int endslice) {
+	int64_t endtick = m_endTick;
+	if ((endslice >= 0) && (endslice < (int)m_sliceTick.size())) {
+		endtick = m_sliceTick[endslice];
+	}
+	return HumNum((int)(endtick - m_sliceTick.at(startslice)), m_tpq);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_composite::analyzeFullCompositeRhythm -- The full composite rhythm
+//     is the union of the note states of each **kern track.  A composite
+//     note is sustained if there are no note attacks in any track, and a rest
+//     if no tracks contain notes.  The duration of a composite note extends
+//     to the next slice that is not null.
+//
+
+void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
+	int slicecount = (int)m_sliceLine.size();
+	OnsetBitmap notes(slicecount);
+	OnsetBitmap attacks(slicecount);
+	for (int i=0; i<(int)m_voiceNotes.size(); i++) {
+		notes   |= m_voiceNotes[i];
+		attacks |= m_voiceAttacks[i];
+	}
+
+	// Grace-note slices are not null, so they also end the previous rhythm:
+	OnsetBitmap stops = m_nonNullSlices;
+	stops |= m_graceSlices;
 
 	string pstring = m_pitch;
 	if (m_upstemQ) {
@@ -1406,12 +1705,10 @@ void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
 	}
 
 	HumRegex hre;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
+	for (int s=0; s<slicecount; s++) {
+		int i = m_sliceLine[s];
 
-		if (infile[i].getDuration() == 0) {
+		if (m_graceSlices.test(s)) {
 			// Grace note data line (most likely)
 			if (!m_graceQ) {
 				continue;
@@ -1445,40 +1742,40 @@ void Tool_composite::analyzeFullCompositeRhythm(HumdrumFile& infile) {
 					full += pstring;
 					full += beam;
 					m_fullComposite[i] = full;
+					m_fullCompositeEvents.set(s);
 					break;
 				}
 			}
 			continue;
 		}
 
-		HumNum duration = getLineDuration(infile, i, isNull);
-		string output;
-		if (isNull[i]) {
+		if (!m_nonNullSlices.test(s)) {
 			m_fullComposite[i] = ".";
 			continue;
-		} else {
-			output = Convert::durationToRecip(duration);
 		}
 
+		HumNum duration = getSliceDuration(s, stops.next(s+1));
+		string output = Convert::durationToRecip(duration);
+
 //		if (onlyAuxTremoloNotes(infile, i)) {
 //			// mark auxiliary notes so that they can be merged
 //			// with a preceding note later.
 //			output += COMPOSITE_TREMOLO_MARKER;
 //		}
 
-		if (isRest[i]) {
+		if (!notes.test(s)) {
 			output += "r";
 		} else {
 			output += pstring;
-			if (isSustain.at(i)) {
+			if (attacks.test(s)) {
+				m_fullCompositeEvents.set(s);
+			} else {
 				output += "]";
 			}
 		}
 		m_fullComposite[i] = output;
-		// cerr << output << "\tS:" << isSustain[i] << "\tR:" << isRest[i] << "\tN:" << isNull[i] << endl;
 	}
 
-
 	fixTiedNotes(m_fullComposite, infile);
 
 //	removeAuxTremolosFromCompositeRhythm(infile);
@@ -1534,7 +1831,13 @@ void Tool_composite::fixTiedNotes(vector<string>& data, HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_composite::analyzeCoincidenceRhythms --
+// Tool_composite::analyzeCoincidenceRhythms -- Coincidence rhythms are the
+//     intersection of the group A and B note states.  The state of each
+//     group is split into bitmaps:
+//        attack  = note attack in the group.
+//        tie     = sustained note that is printed (tied note).
+//        rest    = group is resting (or non-data).
+//     and then merged with bitwise operations.
 //
 
 void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
@@ -1548,87 +1851,67 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 	getNumericGroupStates(groupAstates, infile, "A");
 	getNumericGroupStates(groupBstates, infile, "B");
 
-	vector<HumNum> timestamps(infile.getLineCount(), 0);
-	for (int i=0; i<infile.getLineCount(); i++) {
-		timestamps[i] = infile[i].getDurationFromStart();
-	}
-
-	vector<int> merged(infile.getLineCount(), 0);
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (groupAstates.at(i) == groupBstates.at(i)) {
-			merged[i] = groupAstates.at(i);
-		} else if (groupAstates[i] == 0 || (groupBstates[i] == 0)) {
-			merged[i] = 0;
-		} else if ((groupAstates[i] > 0) && (groupBstates[i] < 0)) {
-			merged[i] = groupBstates[i];
-		} else if ((groupAstates[i] < 0) && (groupBstates[i] > 0)) {
-			merged[i] = groupAstates[i];
-		} else {
-			merged[i] = -1;
-		}
-	}
-
-	bool foundFirstAttackA = false;
-	bool foundFirstAttackB = false;
+	int slicecount = (int)m_sliceLine.size();
+	OnsetBitmap attackA;
+	OnsetBitmap attackB;
+	OnsetBitmap tieA;
+	OnsetBitmap tieB;
+	OnsetBitmap restA;
+	OnsetBitmap restB;
+	getStateBitmap(attackA, groupAstates, 1, 1);
+	getStateBitmap(attackB, groupBstates, 1, 1);
+	getStateBitmap(tieA, groupAstates, -2, -2);
+	getStateBitmap(tieB, groupBstates, -2, -2);
+	getStateBitmap(restA, groupAstates, 0, 0);
+	getStateBitmap(restB, groupBstates, 0, 0);
+
+	// Coincidences start only after both groups have had a note attack:
+	int startA = attackA.first();
+	int startB = attackB.first();
+	int start = slicecount;
+	if ((startA >= 0) && (startB >= 0)) {
+		start = startA > startB ? startA : startB;
+	}
+
+	// Merged attack: both groups have an attack.
+	OnsetBitmap attacks = attackA;
+	attacks &= attackB;
+	attacks.clearBefore(start);
+
+	// Merged tie: one group has a tied note and the other an attack or tied note.
+	OnsetBitmap ties = tieB;
+	ties |= attackB;
+	ties &= tieA;
+	OnsetBitmap tiesB = attackA;
+	tiesB &= tieB;
+	ties |= tiesB;
+	ties.clearBefore(start);
+
+	// Merged rest: either group is resting.
+	OnsetBitmap rests = restA;
+	rests |= restB;
+	rests.invert();
+	rests.clearBefore(start);
+	rests.invert();
+
+	// Rest onsets are rests that are not preceded by another rest.
+	OnsetBitmap restAttacks = rests;
+	OnsetBitmap prevRests = rests;
+	prevRests.shiftUp();
+	restAttacks.andNot(prevRests);
+
+	OnsetBitmap onsets = attacks;
+	onsets |= ties;
+	onsets |= restAttacks;
 
 	m_coincidence.resize(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
 		m_coincidence[i] = "";
 	}
 
-	vector<int> noteAttack(infile.getLineCount(), 0);
-	int currValue = -1000;
-	int lastValue = -1000;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		lastValue = currValue;
-		if (groupAstates[i] > 0) {
-			foundFirstAttackA = true;
-		}
-		if (groupBstates[i] > 0) {
-			foundFirstAttackB = true;
-		}
-		int value = merged[i];
-		if (!foundFirstAttackA) {
-			value = 0;
-		}
-		if (!foundFirstAttackB) {
-			value = 0;
-		}
-		currValue = value;
-
-		if (currValue == 1) {
-			noteAttack[i] = 1;
-		} else if (currValue == -2) {
-			// sustained note attack
-			noteAttack[i] = -2;
-		} else if ((currValue == 0) && (lastValue != 0)) {
-			noteAttack[i] = 2; // 2 means a "rest" note.
-		}
-	}
-
 	// Need to split rests across barlines (at least non-invisible ones).
 	// Also split rests if they generate an unprintable rhythm...
 
-	vector<int> nextAttackIndex(infile.getLineCount(), -1);
-	vector<int> prevAttackIndex(infile.getLineCount(), -1);
-	int lasti = 0;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (noteAttack[i] != 0) {
-			prevAttackIndex[i] = lasti;
-			lasti = i;
-		}
-	}
-	int nexti = infile.getLineCount() - 1;
-	for (int i=infile.getLineCount()-1; i>=0; i--) {
-		if (noteAttack[i] != 0) {
-			nextAttackIndex[i] = nexti;
-			nexti = i;
-		}
-	}
-
 	string lastnote = "";
 	HumNum remainder;
 	bool barline = false;
@@ -1659,59 +1942,64 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 				}
 			}
 		}
-		if (noteAttack[i]) {
-			HumNum duration = infile[nextAttackIndex[i]].getDurationFromStart() -
-				infile[i].getDurationFromStart();
-			HumNum durtobar = infile[i].getDurationToBarline();
-			if (duration > durtobar) {
-				// clip the duration to the duration of the rest of the measure
-				remainder = duration - durtobar;
-				duration = durtobar;
-			}
-
-			string recip = Convert::durationToRecip(duration);
-			string text;
-			if (noteAttack[i] == -2) {
-				text = recip + "eR";
-				// this is either a middle tie if next note is also a tie
-				// or is a tie end if the next note is an attack (1) or rest (2)
-				if (noteAttack[nextAttackIndex[i]] > 0) {
-					// tie end
-					if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
-						m_coincidence[i] = recip + "r";
-						// previous note is not a tie, so switch this note to a rest from
-						// a sustained tied note
+		int s = m_lineSlice[i];
+		if ((s < 0) || !onsets.test(s)) {
+			continue;
+		}
+		int nexts = onsets.next(s+1);
+		HumNum duration = getSliceDuration(s, nexts);
+		HumNum durtobar = infile[i].getDurationToBarline();
+		if (duration > durtobar) {
+			// clip the duration to the duration of the rest of the measure
+			remainder = duration - durtobar;
+			duration = durtobar;
+		}
+		bool nextAttack = (nexts >= 0) && !ties.test(nexts);
+		bool nextTie = (nexts >= 0) && ties.test(nexts);
+
+		string recip = Convert::durationToRecip(duration);
+		string text;
+		if (ties.test(s)) {
+			text = recip + "eR";
+			// this is either a middle tie if next note is also a tie
+			// or is a tie end if the next note is an attack or rest
+			if (nextAttack) {
+				// tie end
+				if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
+					m_coincidence[i] = recip + "r";
+					// previous note is not a tie, so switch this note to a rest from
+					// a sustained tied note
 
-					} else {
-						m_coincidence[i] = text;
-						m_coincidence[i] += "]";
-					}
-					lastnote = m_coincidence[i];
 				} else {
-					// tie middle
-					if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
-						m_coincidence[i] = text + "[";
-					} else {
-						m_coincidence[i] = text + "_";
-					}
-					lastnote = m_coincidence[i];
+					m_coincidence[i] = text;
+					m_coincidence[i] += "]";
 				}
-			} else if (noteAttack[i] == 1) {
-				text = recip + "eR";
-				// Start a tie if the next note is a tied note
-				if (noteAttack[nextAttackIndex[i]] == -2) {
-					m_coincidence[i] = "[" + text;
-					lastnote = m_coincidence[i];
+				lastnote = m_coincidence[i];
+			} else {
+				// tie middle
+				if ((lastnote.find("[") == string::npos) && (lastnote.find("_") == string::npos)) {
+					m_coincidence[i] = text + "[";
+					m_coincidenceEvents.set(s);
 				} else {
-					m_coincidence[i] = text;
-					lastnote = m_coincidence[i];
+					m_coincidence[i] = text + "_";
 				}
-			} else if (noteAttack[i] == 2) {
-				// rest
-				text = recip + "r";
-				m_coincidence[i] = text;
 				lastnote = m_coincidence[i];
 			}
+		} else if (attacks.test(s)) {
+			text = recip + "eR";
+			// Start a tie if the next note is a tied note
+			if (nextTie) {
+				m_coincidence[i] = "[" + text;
+			} else {
+				m_coincidence[i] = text;
+			}
+			m_coincidenceEvents.set(s);
+			lastnote = m_coincidence[i];
+		} else {
+			// rest
+			text = recip + "r";
+			m_coincidence[i] = text;
+			lastnote = m_coincidence[i];
 		}
 	}
 
@@ -1719,13 +2007,15 @@ void Tool_composite::analyzeCoincidenceRhythms(HumdrumFile& infile) {
 
 	if (m_debugQ) {
 		cerr << "MERGED Coincidence states:" << endl;
-		cerr << "TS\tA\tB\tMerged\tAttack\tIndex\tNext\tPrev\tCoin\tInput\n";
-		for (int i=0; i<(int)merged.size(); i++) {
-			cerr << timestamps[i] << "\t";
+		cerr << "TS\tA\tB\tAttack\tTie\tRest\tIndex\tCoin\tInput\n";
+		for (int i=0; i<infile.getLineCount(); i++) {
+			int s = m_lineSlice[i];
+			cerr << infile[i].getDurationFromStart() << "\t";
 			cerr << groupAstates[i] << "\t" << groupBstates[i];
-			cerr << "\t" << merged[i] << "\t" << noteAttack[i];
+			cerr << "\t" << ((s >= 0) && attacks.test(s));
+			cerr << "\t" << ((s >= 0) && ties.test(s));
+			cerr << "\t" << ((s >= 0) && restAttacks.test(s));
 			cerr << "\t" << i;
-			cerr << "\t" << nextAttackIndex[i] << "\t" << prevAttackIndex[i];
 			cerr << "\t" << m_coincidence[i];
 			cerr << "\t" << infile[i] << endl;
 		}
@@ -1854,45 +2144,6 @@ void Tool_composite::getNumericGroupStates(vector<int>& states,
 //
 
 void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
-	vector<HumNum> durations(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
-	}
-
-	vector<int> isRest(infile.getLineCount(), false);
-	vector<int> isNull(infile.getLineCount(), false);
-
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (durations[i] == 0) {
-			continue;
-		}
-		bool allnull = true;
-		bool allrest = true;
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp tok = infile.token(i, j);
-			string value = tok->getValue("auto", "ignoreTremoloNote");
-			if (value == "1") {
-				continue;
-			}
-			if (tok->isNull()) {
-				continue;
-			}
-			allnull = false;
-			if (!tok->isKern()) {
-				continue;
-			}
-			if (tok->isNote()) {
-				allrest = false;
-				break;
-			}
-			if (tok->isRest()) {
-				allnull = false;
-			}
-		}
-		isRest[i] = allrest ? true : false;
-		isNull[i] = allnull ? true : false;
-	}
-
 	string pstring = m_pitch;
 	if (m_upstemQ) {
 		pstring += "/";
@@ -1910,6 +2161,11 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 
 	vector<vector<int>> groupstates;
 	getGroupStates(groupstates, infile);
+	for (int i=0; i<(int)m_groupEvents.size(); i++) {
+		// Grace notes are added as events below if they are displayed:
+		getStateBitmap(m_groupEvents[i], groupstates[i], TYPE_NoteAttack, TYPE_NoteAttack);
+		m_groupEvents[i].andNot(m_graceSlices);
+	}
 
 	vector<vector<HumNum>> groupdurs;
 	getGroupDurations(groupdurs, groupstates, infile);
@@ -1975,8 +2231,10 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 					string group = infile.token(i, j)->getValue("auto", "group");
 					if (group == "A") {
 						m_groups[0][i] = full;
+						m_groupEvents[0].set(m_lineSlice[i]);
 					} else if (group == "B") {
 						m_groups[1][i] = full;
+						m_groupEvents[1].set(m_lineSlice[i]);
 					}
 					break;
 				}
@@ -1985,7 +2243,6 @@ void Tool_composite::analyzeGroupCompositeRhythms(HumdrumFile& infile) {
 		}
 
 		// dealing with a non-zero data line:
-		HumNum duration = getLineDuration(infile, i, isNull);
 		string recip = rhythms[0][i];
 		string recip2 = rhythms[1][i];
 		if (recip.empty()) {
@@ -2095,7 +2352,11 @@ void Tool_composite::getGroupRhythms(vector<string>& rhythms, vector<HumNum>& du
 
 //////////////////////////////
 //
-// Tool_composite::getGroupDurations --
+// Tool_composite::getGroupDurations -- Calculate the durations of
+//    group events (lines that have a positive group state).  Each event
+//    lasts until the next event, or to the end of the score for the last
+//    event.  Non-data lines do not have a group state, so they are also
+//    events (TYPE_UNDEFINED) that end the previous event.
 //
 
 void Tool_composite::getGroupDurations(vector<vector<HumNum>>& groupdurs,
@@ -2108,28 +2369,23 @@ void Tool_composite::getGroupDurations(vector<vector<HumNum>>& groupdurs,
 
 void Tool_composite::getGroupDurations(vector<HumNum>& groupdurs,
 		vector<int>& groupstates, HumdrumFile& infile) {
-	HumNum enddur = infile.getScoreDuration();
 	groupdurs.resize(groupstates.size());
 	fill(groupdurs.begin(), groupdurs.end(), -1);
 	int eventi = -1;
-	HumNum lasttime = 0;
+	int64_t lasttick = 0;
 	for (int i=0; i<(int)groupdurs.size(); i++) {
-		if (groupstates[i] > 0) {
-			if (eventi >= 0) {
-				HumNum eventtime = infile[i].getDurationFromStart();
-				HumNum duration = eventtime - lasttime;
-				groupdurs[eventi] = duration;
-				lasttime = eventtime;
-				eventi = i;
-				continue;
-			} else {
-				eventi = i;
-			}
+		if (groupstates[i] <= 0) {
+			continue;
+		}
+		if (eventi >= 0) {
+			groupdurs[eventi] = HumNum((int)(m_lineTick[i] - lasttick), m_tpq);
+			lasttick = m_lineTick[i];
 		}
+		eventi = i;
 	}
 	if (eventi >= 0) {
-		HumNum duration = enddur - lasttime;
-		groupdurs[eventi] = duration;
+		HumNum enddur = infile.getScoreDuration();
+		groupdurs[eventi] = enddur - HumNum((int)lasttick, m_tpq);
 	}
 }
 
@@ -2181,35 +2437,6 @@ void Tool_composite::getGroupStates(vector<vector<int>>& groupstates, HumdrumFil
 
 
 
-//////////////////////////////
-//
-// Tool_composite::getLineDuration -- Return the duration of the line, but return
-//    0 if the line only contains nulls.  Also add the duration of any subsequent
-//    lines that are null lines before any data content lines.
-
-HumNum Tool_composite::getLineDuration(HumdrumFile& infile, int index, vector<int>& isNull) {
-	if (isNull[index]) {
-		return 0;
-	}
-	if (!infile[index].isData()) {
-		return 0;
-	}
-	HumNum output = infile[index].getDuration();
-	for (int i=index+1; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		if (isNull[i]) {
-			output += infile[i].getDuration();
-		} else {
-			break;
-		}
-	}
-	return output;
-}
-
-
-
 //////////////////////////////
 //
 // Tool_composite::assignGroups -- Add a parameter
@@ -3344,42 +3571,6 @@ void Tool_composite::convertNotesToRhythms(HumdrumFile& infile) {
 
 
 
-//////////////////////////////
-//
-// getEventCount -- Return the number of note attacks.
-//
-
-int Tool_composite::getEventCount(vector<string>& data) {
-	int output = 0;
-	for (int i=0; i<(int)data.size(); i++) {
-		if (data[i] == "") {
-			continue;
-		}
-		if (data[i] == ".") {
-			continue;
-		}
-		if (data[i].find("*") != string::npos) {
-			continue;
-		}
-		if (data[i].find("!") != string::npos) {
-			continue;
-		}
-		if (data[i].find("r") != string::npos) {
-			continue;
-		}
-		if (data[i].find("_") != string::npos) {
-			continue;
-		}
-		if (data[i].find("]") != string::npos) {
-			continue;
-		}
-		output++;
-	}
-	return output;
-}
-
-
-
 // END_MERGE
 
 } // end namespace hum
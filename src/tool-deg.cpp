@@ -21,18 +21,6 @@ namespace hum {
 
 // START_MERGE
 
-/////////////////////////////////
-//
-// Tool_deg::ScaleDegree static member variables:
-//
-
-bool Tool_deg::ScaleDegree::m_showTiesQ  = false;
-bool Tool_deg::ScaleDegree::m_showZerosQ = false;
-bool Tool_deg::ScaleDegree::m_octaveQ = false;
-string Tool_deg::ScaleDegree::m_forcedKey = "";
-
-
-
 /////////////////////////////////
 //
 // Tool_deg::Tool_deg -- Set the recognized options for the tool.
@@ -51,6 +39,7 @@ Tool_deg::Tool_deg(void) {
 	define("k|kern-tracks=s",                            "process only the specified kern spines");
 	define("kd|dk|key-default|default-key=s",            "default (initial) key if none specified in data");
 	define("kf|fk|key-force|force-key|forced-key=s",     "use the given key for analysing deg data (ignore modulations)");
+	define("ke|ek|key-estimate|estimate-key=b",          "estimate local keys from the notes where no key designation is given");
 	define("o|octave|octaves|degree=b",                  "encode octave information int **degree spines");
 	define("r|recip=b",                                  "prefix output data with **recip spine with -I option");
 	define("t|ties=b",                                   "include scale degrees for tied notes");
@@ -131,7 +120,7 @@ void Tool_deg::initialize(void) {
 		m_recipQ = true;
 	}
 	m_degTiesQ = getBoolean("ties");
-	Tool_deg::ScaleDegree::setShowOctaves(getBoolean("octave"));
+	m_degOptions.octaveQ = getBoolean("octave");
 
 	if (getBoolean("spine-tracks")) {
 		m_spineTracks = getString("spine-tracks");
@@ -139,6 +128,9 @@ void Tool_deg::initialize(void) {
 		m_kernTracks = getString("kern-tracks");
 	}
 
+	m_estimateKeyQ = getBoolean("estimate-key");
+
+	m_defaultKey.clear();
 	if (getBoolean("default-key")) {
 		m_defaultKey = getString("default-key");
 		if (!m_defaultKey.empty()) {
@@ -162,12 +154,12 @@ void Tool_deg::initialize(void) {
 			if (m_forcedKey.find(":") == string::npos) {
 				m_forcedKey += ":";
 			}
-			Tool_deg::ScaleDegree::setForcedKey(m_forcedKey);
 		}
 	}
 
-	Tool_deg::ScaleDegree::setShowTies(m_degTiesQ);
-	Tool_deg::ScaleDegree::setShowZeros(getBoolean("zeros"));
+	m_degOptions.forcedKey  = m_forcedKey;
+	m_degOptions.showTiesQ  = m_degTiesQ;
+	m_degOptions.showZerosQ = getBoolean("zeros");
 }
 
 
@@ -183,6 +175,18 @@ void Tool_deg::processFile(HumdrumFile& infile) {
 		return;
 	}
 
+	if (m_estimateKeyQ && m_forcedKey.empty()) {
+		m_keyEstimator.analyze(infile);
+		if (m_defaultKey.empty()) {
+			for (int i=0; i<infile.getLineCount(); i++) {
+				if (infile[i].isData()) {
+					m_defaultKey = m_keyEstimator.getKeyDesignation(i);
+					break;
+				}
+			}
+		}
+	}
+
 	// Create storage space for scale degree analyses:
 	int kernCount = (int)m_selectedKernSpines.size();
 	m_degSpines.resize(kernCount);
@@ -1485,17 +1489,28 @@ void Tool_deg::prepareDegSpine(vector<vector<ScaleDegree>>& degspine, HTp kernst
 
 	bool isUnpitched = false;
 
+	// Follow the estimated local key until the spine gives its own key:
+	bool estimateQ = m_estimateKeyQ && m_forcedKey.empty();
+	string estimate = m_defaultKey;
+
 	while (current) {
 		int line = current->getLineIndex();
 		if (!current->getOwner()->hasSpines()) {
 			degspine.at(line).resize(1);
 			degspine.at(line).back().setLinkedKernToken(current, mode, b40tonic, isUnpitched);
+			degspine.at(line).back().setOptions(&m_degOptions);
 			current = current->getNextToken();
 			continue;
 		}
 		if (current->isKeyDesignation()) {
 			getModeAndTonic(mode, b40tonic, *current);
-
+			estimateQ = false;
+		} else if (estimateQ && current->isData()) {
+			string key = m_keyEstimator.getKeyDesignation(line);
+			if (!key.empty() && (key != estimate)) {
+				getModeAndTonic(mode, b40tonic, key);
+				estimate = key;
+			}
 		}
 		if (current->isClef()) {
 			if (*current == "*clefX") {
@@ -1513,6 +1528,7 @@ void Tool_deg::prepareDegSpine(vector<vector<ScaleDegree>>& degspine, HTp kernst
 			}
 			degspine.at(line).resize((int)degspine.at(line).size() + 1);
 			degspine.at(line).back().setLinkedKernToken(curr, mode, b40tonic, isUnpitched);
+			degspine.at(line).back().setOptions(&m_degOptions);
 			curr = curr->getNextFieldToken();
 		}
 		current = current->getNextToken();
@@ -1818,6 +1834,22 @@ HTp Tool_deg::ScaleDegree::getLinkedKernToken(void) const {
 
 
 
+//////////////////////////////
+//
+// Tool_deg::ScaleDegree::getOptions -- Return the rendering options set by
+//     the owning Tool_deg, or the default options if none were given.
+//
+
+const Tool_deg::ScaleDegreeOptions& Tool_deg::ScaleDegree::getOptions(void) const {
+	static const ScaleDegreeOptions defaults;
+	if (m_options) {
+		return *m_options;
+	}
+	return defaults;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_deg::ScaleDegree:getDegToken -- Convert the ScaleDegre
@@ -1835,7 +1867,7 @@ string Tool_deg::ScaleDegree::getDegToken(void) const {
 	}
 
 	if (isExclusiveInterpretation()) {
-		if (m_octaveQ) {
+		if (getOptions().octaveQ) {
 			return "**degree";
 		} else {
 			return "**deg";
@@ -1844,7 +1876,7 @@ string Tool_deg::ScaleDegree::getDegToken(void) const {
 		return getManipulator();
 	} else if (isInterpretation()) {
 		if (isKeyDesignation()) {
-			if (m_forcedKey.empty()) {
+			if (getOptions().forcedKey.empty()) {
 				return *token;
 			} else{
 				return "*";
@@ -1901,7 +1933,7 @@ string Tool_deg::ScaleDegree::generateDegDataToken(void) const {
 
 	// Include tied notes or suppress them:
 
-	if (m_showTiesQ)  {
+	if (getOptions().showTiesQ)  {
 		// Secondary tied notes scale degrees should be shown.
 		string output;
 		for (int i=0; i<subtokenCount; i++) {
@@ -1968,7 +2000,7 @@ string Tool_deg::ScaleDegree::generateDegDataSubtoken(int index) const {
 	int degree = m_degrees.at(index);
 	if (degree == 0) {
 		output += "r";
-		if (m_showZerosQ) {
+		if (getOptions().showZerosQ) {
 			output += "0";
 		}
    } else if ((degree > 0) && (degree <= 7)) {
@@ -1989,7 +2021,7 @@ string Tool_deg::ScaleDegree::generateDegDataSubtoken(int index) const {
 	}
 
 	// Add octave information if requested:
-	if (m_octaveQ && (degree != 0)) {
+	if (getOptions().octaveQ && (degree != 0)) {
 		output += "/";
 		output += to_string(m_octaves.at(index));
 	}
@@ -2414,9 +2414,14 @@ void Tool_esac2hum::printPdfLinks(ostream& output) {
 
 void Tool_esac2hum::printConversionDate(ostream& output) {
 	std::time_t t = std::time(nullptr);
-	std::tm* now = std::localtime(&t);
+	std::tm now;
+#ifdef _WIN32
+	localtime_s(&now, &t);
+#else
+	localtime_r(&t, &now);
+#endif
 	output << "!!!ONB: Converted on ";
-	output << std::put_time(now, "%Y/%m/%d");
+	output << std::put_time(&now, "%Y/%m/%d");
 	output << " with esac2hum" << endl;
 }
 
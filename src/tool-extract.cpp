@@ -110,7 +110,10 @@ bool Tool_extract::run(HumdrumFile& infile, ostream& out) {
 //
 
 bool Tool_extract::run(HumdrumFile& infile) {
-	initialize(infile);
+	initialize();
+	if (rkernQ) {
+		fieldstring = reverseFieldString(getString("K"), infile.getMaxTrack());
+	}
 	processFile(infile);
 	// Re-load the text for each line from their tokens.
 	// infile.createLinesFromTokens();
@@ -119,6 +122,285 @@ bool Tool_extract::run(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_extract::run -- Process the input one line at a time.  Spine
+//    selections which only depend on track numbers are extracted directly
+//    from the line stream.  Other options need a complete segment, so the
+//    input is processed one segment at a time for them.
+//
+
+bool Tool_extract::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	if (hasAnyText() || !isStreamable()) {
+		clearOutput();
+		return processSegments(instream, out);
+	}
+
+	// A segment which does not start with all of the tracks in the field
+	// list is read into a HumdrumFile so that invalid field entries are
+	// handled in the same way as when extracting from a file.
+	int maxfield = getMaxFieldNumber(fieldstring);
+	bool status = true;
+	bool active = false;
+	bool checked = false;
+	bool buffered = false;
+	int maxtrack = 0;
+	string filename;
+	stringstream segment;
+	while (true) {
+		bool found = instream.readLine();
+		if ((!found || instream.isSegmentStart()) && active) {
+			if (countQ) {
+				out << maxtrack << endl;
+			} else if (buffered) {
+				status &= processSegment(segment, filename, out);
+			}
+		}
+		if (!found) {
+			break;
+		}
+		if (instream.isSegmentStart()) {
+			filename = instream.getFilename();
+			checked = false;
+			buffered = false;
+		}
+		active = true;
+		maxtrack = instream.getMaxTrack();
+		if (countQ) {
+			continue;
+		}
+		if (!checked && instream.hasSpines()) {
+			checked = true;
+			if (fieldQ || excludeQ) {
+				if (maxfield > maxtrack) {
+					buffered = true;
+				} else {
+					fillFieldData(field, subfield, model, fieldstring, maxtrack, NULL);
+				}
+			}
+		}
+		if (buffered) {
+			segment << instream.getLine() << '\n';
+			continue;
+		}
+		if (fieldQ) {
+			extractLine(instream);
+		} else if (excludeQ) {
+			excludeLine(instream);
+		} else {
+			m_humdrum_text << instream.getLine() << '\n';
+		}
+		out << m_humdrum_text.str();
+		m_humdrum_text.str("");
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::isStreamable -- Returns true if the options only
+//    need the track numbers of each line.
+//
+
+bool Tool_extract::isStreamable(void) {
+	if (expandQ || interpQ || reverseQ || removerestQ || grepQ || emptyQ ||
+			noEmptyQ || kernQ || rkernQ || traceQ || spineListQ || debugQ ||
+			addRestsQ) {
+		return false;
+	}
+	if (countQ) {
+		return true;
+	}
+	if (fieldQ || excludeQ) {
+		// Only plain track numbers and ranges (no $, subspines or models).
+		for (int i=0; i<(int)fieldstring.size(); i++) {
+			char ch = fieldstring[i];
+			if (!(isdigit(ch) || isspace(ch) || (ch == ',') || (ch == '-'))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::getMaxFieldNumber -- Return the largest number in a field
+//     list string.
+//
+
+int Tool_extract::getMaxFieldNumber(const string& fieldstring) {
+	int output = 0;
+	int value = 0;
+	for (int i=0; i<(int)fieldstring.size(); i++) {
+		if (isdigit(fieldstring[i])) {
+			value = value * 10 + (fieldstring[i] - '0');
+			if (value > output) {
+				output = value;
+			}
+		} else {
+			value = 0;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::processSegments -- Read each segment of the line stream
+//    into a HumdrumFile for options which need the full file.
+//
+
+bool Tool_extract::processSegments(HumdrumLineStream& instream, ostream& out) {
+	bool status = true;
+	bool active = false;
+	string filename;
+	stringstream segment;
+	while (true) {
+		bool found = instream.readLine();
+		if ((!found || instream.isSegmentStart()) && active) {
+			status &= processSegment(segment, filename, out);
+		}
+		if (!found) {
+			break;
+		}
+		if (instream.isSegmentStart()) {
+			filename = instream.getFilename();
+		}
+		active = true;
+		segment << instream.getLine() << '\n';
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::processSegment -- Process the lines of a segment as a
+//    HumdrumFile, print the results and clear the segment contents.
+//
+
+bool Tool_extract::processSegment(stringstream& segment, const string& filename,
+		ostream& out) {
+	HumdrumFile infile;
+	infile.readNoRhythm(segment);
+	infile.setFilename(filename);
+	infile.setFilenameFromSegment();
+	bool status = run(infile);
+	getAllText(out);
+	m_humdrum_text.str("");
+	m_json_text.str("");
+	m_free_text.str("");
+	segment.str("");
+	segment.clear();
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::extractLine -- Print the listed tracks of a line from a
+//    line stream.
+//
+
+void Tool_extract::extractLine(HumdrumLineStream& line) {
+	if (!line.hasSpines()) {
+		m_humdrum_text << line.getLine() << '\n';
+		return;
+	}
+
+	if (line.isManipulator()) {
+		int count = line.getFieldCount();
+		vector<string> spineinfo(count);
+		for (int j=0; j<count; j++) {
+			spineinfo[j] = line.getSpineInfo(j);
+		}
+		dealWithSpineManipulators(line.getTokens(), line.getTracks(), spineinfo,
+				line.getLine(), line.getMaxTrack(), field, subfield, model);
+		return;
+	}
+
+	int start = 0;
+	for (int t=0; t<(int)field.size(); t++) {
+		int target = field[t];
+		if (target == 0) {
+			if (start != 0) {
+				m_humdrum_text << '\t';
+			}
+			start = 1;
+			if (line.isLocalComment()) {
+				m_humdrum_text << "!";
+			} else if (line.isBarline()) {
+				m_humdrum_text << line.getToken(0);
+			} else if (line.isData()) {
+				m_humdrum_text << ".";
+			} else if (line.isInterpretation()) {
+				HumdrumToken token(line.getToken(0));
+				if (token.isExpansionLabel() || token.isExpansionList()) {
+					m_humdrum_text << token;
+				} else {
+					m_humdrum_text << "*";
+				}
+			}
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			if (line.getTrack(j) != target) {
+				continue;
+			}
+			if (start != 0) {
+				m_humdrum_text << '\t';
+			}
+			start = 1;
+			m_humdrum_text << line.getToken(j);
+		}
+	}
+
+	if (start != 0) {
+		m_humdrum_text << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_extract::excludeLine -- Print all tracks of a line from a line
+//    stream except the ones in the list of fields.
+//
+
+void Tool_extract::excludeLine(HumdrumLineStream& line) {
+	if (!line.hasSpines()) {
+		m_humdrum_text << line.getLine() << '\n';
+		return;
+	}
+	int start = 0;
+	for (int j=0; j<line.getFieldCount(); j++) {
+		if (isInList(line.getTrack(j), field)) {
+			continue;
+		}
+		if (start != 0) {
+			m_humdrum_text << '\t';
+		}
+		start = 1;
+		m_humdrum_text << line.getToken(j);
+	}
+	if (start != 0) {
+		m_humdrum_text << endl;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_extract::processFile --
@@ -717,8 +999,17 @@ void Tool_extract::reverseSpines(vector<int>& field, vector<int>& subfield,
 
 void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 		vector<int>& model, string& fieldstring, HumdrumFile& infile) {
+	fillFieldData(field, subfield, model, fieldstring, infile.getMaxTrack(), &infile);
+}
 
-	int maxtrack = infile.getMaxTrack();
+
+//
+// Field list for a given maximum track number (infile is only needed
+// for -k and -K extraction).
+//
+
+void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
+		vector<int>& model, string& fieldstring, int maxtrack, HumdrumFile* infile) {
 
 	field.reserve(maxtrack);
 	field.resize(0);
@@ -741,7 +1032,8 @@ void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 		tempfield.clear();
 		tempsubfield.clear();
 		tempmodel.clear();
-		processFieldEntry(tempfield, tempsubfield, tempmodel, hre.getMatch(1), infile);
+		processFieldEntry(tempfield, tempsubfield, tempmodel, hre.getMatch(1),
+				maxtrack, infile);
 		start += hre.getMatchEndIndex(1);
 		field.insert(field.end(), tempfield.begin(), tempfield.end());
 		subfield.insert(subfield.end(), tempsubfield.begin(), tempsubfield.end());
@@ -761,13 +1053,14 @@ void Tool_extract::fillFieldData(vector<int>& field, vector<int>& subfield,
 
 void Tool_extract::processFieldEntry(vector<int>& field,
 		vector<int>& subfield, vector<int>& model, const string& astring,
-		HumdrumFile& infile) {
+		int maxtrack, HumdrumFile* infile) {
 
 	int finitsize = (int)field.size();
-	int maxtrack = infile.getMaxTrack();
 
 	vector<HTp> ktracks;
-	infile.getKernSpineStartList(ktracks);
+	if (infile) {
+		infile->getKernSpineStartList(ktracks);
+	}
 	int maxkerntrack = (int)ktracks.size();
 
 	int modletter;
@@ -874,7 +1167,7 @@ void Tool_extract::processFieldEntry(vector<int>& field,
 		}
 	}
 
-	if (!kernQ) {
+	if (!kernQ || !infile) {
 		return;
 	}
 
@@ -884,7 +1177,7 @@ void Tool_extract::processFieldEntry(vector<int>& field,
 	vector<int> newmodel;
 
 	vector<HTp> trackstarts;
-	infile.getTrackStartList(trackstarts);
+	infile->getTrackStartList(trackstarts);
 	int spine;
 
 	// convert kern tracks into spine tracks:
@@ -1458,22 +1751,46 @@ void Tool_extract::getSearchPat(string& spat, int target, const string& modifier
 
 void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 		vector<int>& field, vector<int>& subfield, vector<int>& model) {
+	int count = infile[line].getFieldCount();
+	vector<string> tokens(count);
+	vector<int> tracks(count);
+	vector<string> spineinfo(count);
+	for (int j=0; j<count; j++) {
+		HTp token = infile.token(line, j);
+		tokens[j] = *token;
+		tracks[j] = token->getTrack();
+		spineinfo[j] = token->getSpineInfo();
+	}
+	dealWithSpineManipulators(tokens, tracks, spineinfo, infile[line],
+			infile.getMaxTrack(), field, subfield, model);
+}
+
+
+//
+// Spine manipulator processing on the contents of a line (also used
+// when reading from a HumdrumLineStream).
+//
+
+void Tool_extract::dealWithSpineManipulators(const vector<string>& tokens,
+		const vector<int>& tracks, const vector<string>& spineinfo,
+		const string& linetext, int maxtrack, vector<int>& field,
+		vector<int>& subfield, vector<int>& model) {
 
 	vector<int> vmanip;  // counter for *v records on line
-	vmanip.resize(infile[line].getFieldCount());
+	vmanip.resize((int)tokens.size());
 	fill(vmanip.begin(), vmanip.end(), 0);
 
 	vector<int> xmanip; // counter for *x record on line
-	xmanip.resize(infile[line].getFieldCount());
+	xmanip.resize((int)tokens.size());
 	fill(xmanip.begin(), xmanip.end(), 0);
 
 	int i = 0;
 	int j;
 	for (j=0; j<(int)vmanip.size(); j++) {
-		if (*infile.token(line, j) == "*v") {
+		if (tokens[j] == "*v") {
 			vmanip[j] = 1;
 		}
-		if (*infile.token(line, j) == "*x") {
+		if (tokens[j] == "*x") {
 			xmanip[j] = 1;
 		}
 	}
@@ -1505,11 +1822,15 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 	fill(fieldoccur.begin(), fieldoccur.end(), 0);
 
 	vector<int> trackcounter; // counter of input spines occurances in output
-	trackcounter.resize(infile.getMaxTrack()+1);
+	trackcounter.resize(maxtrack+1);
 	fill(trackcounter.begin(), trackcounter.end(), 0);
 
 	for (i=0; i<(int)field.size(); i++) {
 		if (field[i] != 0) {
+			if (field[i] >= (int)trackcounter.size()) {
+				// track not yet present in a streamed segment
+				trackcounter.resize(field[i]+1, 0);
+			}
 			trackcounter[field[i]]++;
 			fieldoccur[i] = trackcounter[field[i]];
 		}
@@ -1558,13 +1879,13 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 		}
 		suppress = 0;
 		if (target == 0) {
-			if (infile.token(line, 0)->compare(0, 2, "**") == 0) {
+			if (tokens[0].compare(0, 2, "**") == 0) {
 				storeToken(tempout, blankName);
 				tval = 0;
 				vserial.push_back(tval);
 				xserial.push_back(tval);
 				fpos.push_back(tval);
-			} else if (*infile.token(line, 0) == "*-") {
+			} else if (tokens[0] == "*-") {
 				storeToken(tempout, "*-");
 				tval = 0;
 				vserial.push_back(tval);
@@ -1578,19 +1899,19 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 				fpos.push_back(tval);
 			}
 		} else {
-			for (j=0; j<infile[line].getFieldCount(); j++) {
-				if (infile[line].token(j)->getTrack() != target) {
+			for (j=0; j<(int)tokens.size(); j++) {
+				if (tracks[j] != target) {
 					continue;
 				}
 		// filter by subfield
 		if (subtarget == 'a') {
 			getSearchPat(spat, target, "b");
-			if (hre.search(infile.token(line, j)->getSpineInfo(), spat)) {
+			if (hre.search(spineinfo[j], spat)) {
 						continue;
 			}
 		} else if (subtarget == 'b') {
 			getSearchPat(spat, target, "a");
-			if (hre.search(infile.token(line, j)->getSpineInfo(), spat)) {
+			if (hre.search(spineinfo[j], spat)) {
 				continue;
 			}
 		}
@@ -1598,29 +1919,29 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 				switch (subtarget) {
 				case 'a':
 
-					if (!hre.search(infile.token(line, j)->getSpineInfo(), "\\(")) {
-						if (*infile.token(line, j)  == "*^") {
+					if (!hre.search(spineinfo[j], "\\(")) {
+						if (tokens[j]  == "*^") {
 							 storeToken(tempout, "*");
 						} else {
-							 storeToken(tempout, *infile.token(line, j));
+							 storeToken(tempout, tokens[j]);
 						}
 					} else {
 						getSearchPat(spat, target, "a");
-						spinepat =  infile.token(line, j)->getSpineInfo();
+						spinepat =  spineinfo[j];
 						hre.replaceDestructive(spinepat, "\\(", "\\(", "g");
 						hre.replaceDestructive(spinepat, "\\)", "\\)", "g");
 
-						if ((*infile.token(line, j) == "*v") &&
+						if ((tokens[j] == "*v") &&
 							    (spinepat == spat)) {
 							 storeToken(tempout, "*");
 						} else {
 							getSearchPat(spat, target, "b");
 							if ((spinepat == spat) &&
-									(*infile.token(line, j) ==  "*v")) {
+									(tokens[j] ==  "*v")) {
 								// do nothing
 								suppress = 1;
 							} else {
-								storeToken(tempout, *infile.token(line, j));
+								storeToken(tempout, tokens[j]);
 							}
 						}
 					}
@@ -1628,29 +1949,29 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 					break;
 				case 'b':
 
-					if (!hre.search(infile.token(line, j)->getSpineInfo(), "\\(")) {
-						if (*infile.token(line, j) == "*^") {
+					if (!hre.search(spineinfo[j], "\\(")) {
+						if (tokens[j] == "*^") {
 							storeToken(tempout, "*");
 						} else {
-							storeToken(tempout, *infile.token(line, j));
+							storeToken(tempout, tokens[j]);
 						}
 					} else {
 						getSearchPat(spat, target, "b");
-						spinepat = infile.token(line, j)->getSpineInfo();
+						spinepat = spineinfo[j];
 						hre.replaceDestructive(spinepat, "\\(", "\\(", "g");
 						hre.replaceDestructive(spinepat, "\\)", "\\)", "g");
 
-						if ((*infile.token(line, j) ==  "*v") &&
+						if ((tokens[j] ==  "*v") &&
 								(spinepat == spat)) {
 							storeToken(tempout, "*");
 						} else {
 							getSearchPat(spat, target, "a");
 							if ((spinepat == spat) &&
-									(*infile.token(line, j) == "*v")) {
+									(tokens[j] == "*v")) {
 								// do nothing
 								suppress = 1;
 							} else {
-								storeToken(tempout, *infile.token(line, j));
+								storeToken(tempout, tokens[j]);
 							}
 						}
 					}
@@ -1658,10 +1979,10 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 					break;
 				case 'c':
 					// work on later
-					storeToken(tempout, *infile.token(line, j));
+					storeToken(tempout, tokens[j]);
 					break;
 				default:
-					storeToken(tempout, *infile.token(line, j));
+					storeToken(tempout, tokens[j]);
 				}
 
 				if (suppress) {
@@ -1701,7 +2022,7 @@ void Tool_extract::dealWithSpineManipulators(HumdrumFile& infile, int line,
 	}
 
 	if (debugQ && vdebug) {
-		m_humdrum_text << "!!LINE: " << infile[line] << endl;
+		m_humdrum_text << "!!LINE: " << linetext << endl;
 		m_humdrum_text << "!! *v serials = ";
 		for (int ii=0; ii<(int)vserial.size(); ii++) {
 			m_humdrum_text << vserial[ii] << " ";
@@ -2097,7 +2418,7 @@ void Tool_extract::usage(const string& command) {
 // Tool_extract::initialize --
 //
 
-void Tool_extract::initialize(HumdrumFile& infile) {
+void Tool_extract::initialize(void) {
 	// handle basic options:
 	if (getBoolean("author")) {
 		m_free_text << "Written by Craig Stuart Sapp, "
@@ -2183,15 +2504,18 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 
 	if (excludeQ) {
 		fieldstring = getString("x");
+		rkernQ = false;
 	} else if (fieldQ) {
 		fieldstring = getString("f");
+		rkernQ = false;
 	} else if (kernQ) {
 		fieldstring = getString("k");
 		fieldQ = true;
+		rkernQ = false;
 	} else if (rkernQ) {
+		// field numbers are reversed for each file in run()
 		fieldstring = getString("K");
 		fieldQ = true;
-		fieldstring = reverseFieldString(fieldstring, infile.getMaxTrack());
 	}
 
 	spineListQ = getBoolean("spine-list");
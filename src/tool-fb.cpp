@@ -193,6 +193,9 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 	lastNumbers.resize((int)grid.getVoiceCount());
 	vector<vector<int>> currentNumbers = {};
 
+	// Base-40 pitches of the current token (reused for each token):
+	vector<int> base40Pitches;
+
 	// Interate through the NoteGrid and fill the numbers vector with
 	// all generated FiguredBassNumbers
 	for (int i=0; i<(int)grid.getSliceCount(); i++) {
@@ -213,7 +216,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 				// Handle spine splits
 				do {
 					HTp resolvedToken = currentToken->resolveNull();
-					int lowest = getLowestBase40Pitch(resolvedToken->getBase40Pitches());
+					resolvedToken->getBase40Pitches(base40Pitches);
+					int lowest = getLowestBase40Pitch(base40Pitches);
 
 					if (abs(lowest) < lowestNotePitch) {
 						lowestNotePitch = abs(lowest);
@@ -259,7 +263,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 		// Handle spine splits
 		do {
 			HTp resolvedToken = currentToken->resolveNull();
-			int lowest = getLowestBase40Pitch(resolvedToken->getBase40Pitches());
+			resolvedToken->getBase40Pitches(base40Pitches);
+			int lowest = getLowestBase40Pitch(base40Pitches);
 
 			// Ignore if base is a rest or silent note
 			if ((lowest != 0) && (lowest != -1000) && (lowest != -2000)) {
@@ -298,7 +303,8 @@ void Tool_fb::processFile(HumdrumFile& infile) {
 			// Handle spine splits
 			do {
 				HTp resolvedToken = currentToken->resolveNull();
-				for (int subtokenBase40: resolvedToken->getBase40Pitches()) {
+				resolvedToken->getBase40Pitches(base40Pitches);
+				for (int subtokenBase40: base40Pitches) {
 
 					// Ignore if target is a rest or silent note
 					if ((subtokenBase40 == 0) || (subtokenBase40 == -1000) || (subtokenBase40 == -2000)) {
@@ -778,18 +784,20 @@ string Tool_fb::getKeySignature(HumdrumFile& infile, int lineIndex) {
 //    TODO: Handle negative values and sustained notes
 //
 
-int Tool_fb::getLowestBase40Pitch(vector<int> base40Pitches) {
-	vector<int> filteredBase40Pitches;
-	copy_if(base40Pitches.begin(), base40Pitches.end(), std::back_inserter(filteredBase40Pitches), [](int base40Pitch) {
+int Tool_fb::getLowestBase40Pitch(const vector<int>& base40Pitches) {
+	int lowest = -2000;
+	bool foundQ = false;
+	for (int base40Pitch : base40Pitches) {
 		// Ignore if base is a rest or silent note
-		return (base40Pitch != -1000) && (base40Pitch != -2000) && (base40Pitch != 0);
-	});
-
-	if (filteredBase40Pitches.size() == 0) {
-		return -2000;
+		if ((base40Pitch == -1000) || (base40Pitch == -2000) || (base40Pitch == 0)) {
+			continue;
+		}
+		if (!foundQ || (base40Pitch < lowest)) {
+			lowest = base40Pitch;
+			foundQ = true;
+		}
 	}
-
-	return *min_element(begin(filteredBase40Pitches), end(filteredBase40Pitches));
+	return lowest;
 }
 
 
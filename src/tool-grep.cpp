@@ -94,30 +94,50 @@ void Tool_grep::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_grep::run -- Process the input one line at a time.
+//
+
+bool Tool_grep::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	while (instream.readLine()) {
+		if (isPrintedLine(instream.getLine())) {
+			out << instream.getLine() << "\n";
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_grep::processFile --
 //
 
 void Tool_grep::processFile(HumdrumFile& infile) {
-	HumRegex hre;
-	bool match;
 	for (int i=0; i<infile.getLineCount(); i++) {
-		match = hre.search(infile[i], m_regex);
-		if (m_negateQ) {
-			if (match) {
-				continue;
-			}
-		} else {
-			if (!match) {
-				continue;
-			}
+		if (isPrintedLine(infile[i])) {
+			m_humdrum_text << infile[i] << "\n";
 		}
-		m_humdrum_text << infile[i] << "\n";
 	}
 }
 
 
+
+//////////////////////////////
+//
+// Tool_grep::isPrintedLine -- Returns true if the line matches the
+//     regular expression (or does not match when using -v).
+//
+
+bool Tool_grep::isPrintedLine(const string& line) {
+	bool match = m_hre.search(line, m_regex);
+	return m_negateQ ? !match : match;
+}
+
+
 // END_MERGE
 
 } // end namespace hum
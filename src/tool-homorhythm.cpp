@@ -404,22 +404,20 @@ void Tool_homorhythm::analyzeLine(HumdrumFile& infile, int line) {
 			nullQ = 0;
 		}
 		int track = token->getTrack();
-		vector<string> subtokens = token->getSubtokens();
-		for (int j=0; j<(int)subtokens.size(); j++) {
+		for (const HumSubtoken& subtoken : token->getSubtokenView()) {
 			note.track = track;
 			note.line = token->getLineIndex();
 			note.field = token->getFieldIndex();
-			note.subfield = j;
+			note.subfield = subtoken.getIndex();
 			note.token = token;
-			note.text = subtokens[j];
-			note.duration = Convert::recipToDuration(note.text);
+			note.text.assign(subtoken.getText());
+			note.duration = subtoken.getDuration();
 			if (nullQ) {
 				note.attack = false;
 				note.nullQ = true;
 			} else {
 				note.nullQ = false;
-				if ((note.text.find("_") != string::npos) ||
-				    (note.text.find("]") != string::npos)) {
+				if (subtoken.contains('_') || subtoken.contains(']')) {
 					note.attack = false;
 				} else {
 					note.attack = true;
@@ -9,8 +9,7 @@
 //
 // Description:   Counterpoint imitation tool.
 //
-// Todo:          retrograde/inversion searches
-//                imitation at specific rhythmic scaling (double, half, etc)
+// Todo:          imitation at specific rhythmic scaling (double, half, etc)
 //                add inexact rhythm for first/last note in match
 //                allow inexact rhythm after x notes with exact rhythm
 //                color imitations by interval
@@ -35,7 +34,124 @@ namespace hum {
 // START_MERGE
 
 
-int Tool_imitation::Enumerator = 0;
+const uint64_t ImitationIndex::NoKey;
+const uint64_t ImitationIndex::RestBit;
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::build -- Store the positions of each window key in a
+//    voice.  Positions with no key (windows starting on a rest interval
+//    or running past the end of the voice) are not stored.  Positions
+//    for each key are in ascending order.
+//
+
+void ImitationIndex::build(const vector<uint64_t>& keys) {
+	m_positions.clear();
+	m_positions.reserve(keys.size());
+	for (int i=0; i<(int)keys.size(); i++) {
+		if (keys[i] == NoKey) {
+			continue;
+		}
+		m_positions[keys[i]].push_back(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::find -- Return the positions in the voice which have
+//    the given window key.
+//
+
+const vector<int>& ImitationIndex::find(uint64_t key) const {
+	auto it = m_positions.find(key);
+	if (it == m_positions.end()) {
+		return m_empty;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::getSymbols -- Convert the interval sequence of a voice
+//    into one number for each position, combining the diatonic interval
+//    to the next note and (optionally) the duration of the note.  Two
+//    positions match in Tool_imitation::compareSequences() only if they
+//    have the same symbol.  Intervals to/from rests all share one value
+//    and are marked with RestBit.  If negate is true, the intervals are
+//    inverted so that inversions can be found with the same index.
+//
+
+void ImitationIndex::getSymbols(vector<uint64_t>& symbols,
+		vector<NoteCell*>& attacks, vector<double>& intervals, bool negate,
+		bool duration) {
+	symbols.resize(intervals.size());
+	for (int i=0; i<(int)intervals.size(); i++) {
+		bool rest = Convert::isNaN(intervals[i]);
+		uint64_t value = 0x9e3779b97f4a7c15ULL;
+		if (!rest) {
+			int64_t interval = (int64_t)intervals[i];
+			if (negate) {
+				interval = -interval;
+			}
+			value = (uint64_t)interval;
+		}
+		if (duration) {
+			HumNum dur = attacks[i]->getDuration();
+			value = (value * 1000003) ^ (uint64_t)dur.getNumerator();
+			value = (value * 1000003) ^ (uint64_t)dur.getDenominator();
+		}
+		// mix bits so that keys of nearby values are spread out:
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		if (rest) {
+			value |= RestBit;
+		} else {
+			value &= ~RestBit;
+		}
+		symbols[i] = value;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ImitationIndex::getWindowKeys -- Calculate a rolling hash of length
+//    symbols starting at each position in the sequence.  Positions where
+//    the window starts on a rest or does not fit are given NoKey.
+//
+
+void ImitationIndex::getWindowKeys(vector<uint64_t>& keys,
+		const vector<uint64_t>& symbols, int length) {
+	int size = (int)symbols.size();
+	keys.assign(size, 0);
+	if ((length < 1) || (size < length)) {
+		return;
+	}
+	const uint64_t base = 0x100000001b3ULL;
+	uint64_t power = 1;
+	uint64_t hash = 0;
+	for (int i=0; i<length; i++) {
+		power *= base;
+		hash = hash * base + symbols[i];
+	}
+	for (int i=0; i+length<=size; i++) {
+		if (!(symbols[i] & RestBit)) {
+			keys[i] = (hash == NoKey) ? 1 : hash;
+		}
+		if (i + length < size) {
+			hash = hash * base + symbols[i+length] - power * symbols[i];
+		}
+	}
+}
+
 
 
 /////////////////////////////////
@@ -121,7 +237,7 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
+	m_enumerator = 0;
 
 	NoteGrid grid(infile);
 
@@ -130,7 +246,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -217,7 +333,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 	}
 	m_marker = originalMarker;
 
-	if (!getBoolean("no-info")) {
+	if (!getBoolean("no-info") && !results.empty()) {
 		string exinterp = getString("exinterp");
 		vector<HTp> kernspines = infile.getKernSpineStartList();
 		infile.appendDataSpine(results.back(), "", exinterp);
@@ -226,7 +342,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -272,6 +388,8 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
+	prepareTargets(attacks, intervals);
+
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=i+1; j<(int)attacks.size(); j++) {
 			analyzeImitation(results, attacks, intervals, i, j);
@@ -281,6 +399,62 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::prepareTargets -- Calculate the window keys of each
+//    voice and index the window positions of each voice as a target of
+//    imitation.  Windows are m_threshold - 2 intervals long, which is
+//    the minimum number of matching intervals for a match to be
+//    reported, so each voice pair only needs to compare the positions
+//    that share a key.  Inversion searches index the inverted intervals
+//    of the target voice, and retrograde searches index the target
+//    voice in reverse order.
+//
+
+void Tool_imitation::prepareTargets(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals) {
+	int voices = (int)attacks.size();
+	int length = m_threshold - 2;
+
+	m_retroAttacks.clear();
+	m_retroIntervals.clear();
+	if (m_retrograde) {
+		m_retroAttacks.resize(voices);
+		m_retroIntervals.resize(voices);
+		for (int i=0; i<voices; i++) {
+			m_retroAttacks[i].assign(attacks[i].rbegin(), attacks[i].rend());
+			vector<NoteCell*>& retro = m_retroAttacks[i];
+			m_retroIntervals[i].resize(retro.size());
+			for (int j=0; j<(int)retro.size() - 1; j++) {
+				m_retroIntervals[i][j] = *retro[j+1] - *retro[j];
+			}
+			if (!retro.empty()) {
+				m_retroIntervals[i].back() = NAN;
+			}
+		}
+	}
+
+	m_keys.resize(voices);
+	m_index.resize(voices);
+	vector<uint64_t> symbols;
+	vector<uint64_t> targetkeys;
+	for (int i=0; i<voices; i++) {
+		ImitationIndex::getSymbols(symbols, attacks[i], intervals[i], false, m_duration);
+		ImitationIndex::getWindowKeys(m_keys[i], symbols, length);
+		if (!(m_inversion || m_retrograde)) {
+			m_index[i].build(m_keys[i]);
+			continue;
+		}
+		vector<NoteCell*>& tattacks = m_retrograde ? m_retroAttacks[i] : attacks[i];
+		vector<double>& tintervals = m_retrograde ? m_retroIntervals[i] : intervals[i];
+		ImitationIndex::getSymbols(symbols, tattacks, tintervals, m_inversion, m_duration);
+		ImitationIndex::getWindowKeys(targetkeys, symbols, length);
+		m_index[i].build(targetkeys);
+	}
+}
+
+
+
 ///////////////////////////////
 //
 // Tool_imitation::getIntervals --
@@ -291,7 +465,9 @@ void Tool_imitation::getIntervals(vector<double>& intervals,
 	for (int i=0; i<(int)attacks.size() - 1; i++) {
 		intervals.at(i) = *attacks.at(i+1) - *attacks.at(i);
 	}
-	intervals.back() = NAN;
+	if (!intervals.empty()) {
+		intervals.back() = NAN;
+	}
 
 	if (getBoolean("debug")) {
 		cout << endl;
@@ -315,33 +491,45 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 		int v1, int v2) {
 
 	vector<NoteCell*>& v1a = attacks.at(v1);
-	vector<NoteCell*>& v2a = attacks.at(v2);
+	vector<NoteCell*>& v2a = m_retrograde ? m_retroAttacks.at(v2) : attacks.at(v2);
 	vector<double>& v1i = intervals.at(v1);
-	vector<double>& v2i = intervals.at(v2);
+	vector<double>& v2i = m_retrograde ? m_retroIntervals.at(v2) : intervals.at(v2);
+	vector<uint64_t>& keys = m_keys.at(v1);
+	ImitationIndex& index = m_index.at(v2);
 
 	int min = m_threshold - 1;
 	int count;
 
-	vector<int> enum1(v1a.size(), 0);
-	vector<int> enum2(v2a.size(), 0);
-
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
-		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
+		if (m_rest || m_rest2) {
+			if ((i > 0) && (!Convert::isNaN(v1a.at(i-1)->getSgnDiatonicPitch()))) {
+				// match initiator must be preceded by a rest (or start of music)
+				continue;
+			}
+		}
+		if (keys.at(i) == ImitationIndex::NoKey) {
+			continue;
+		}
+		// Only positions in the second voice that share the window key
+		// can match at least min-1 intervals:
+		const vector<int>& positions = index.find(keys.at(i));
+		int skip = -1;
+		for (int p=0; p<(int)positions.size(); p++) {
+			int j = positions[p];
+			if (j >= (int)v2i.size() - 1) {
+				break;
+			}
+			if (j <= skip) {
+				continue;
 			}
 			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				if ((j > 0) && (!Convert::isNaN(v2a.at(j-1)->getSgnDiatonicPitch()))) {
 					// match target must be preceded by a rest (or start of music)
 					continue;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
-				// avoid re-matching an existing match as a submatch
+			if (extendsBackward(v1a, v1i, i, v2a, v2i, j)) {
+				// only report maximal matches, not their suffixes
 				continue;
 			}
 			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
@@ -349,30 +537,29 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
 				continue;
 			}
 
+			// Index of the first note of the match in the second voice
+			// (the match runs backwards in the score for retrograde):
+			int j2 = m_retrograde ? (int)v2a.size() - j - count : j;
+
 			// cout << "Match length count " << count << endl;
 			HTp token1 = attacks.at(v1).at(i)->getToken();
-			HTp token2 = attacks.at(v2).at(j)->getToken();
+			HTp token2 = attacks.at(v2).at(j2)->getToken();
 			HumNum time1 = token1->getDurationFromStart();
 			HumNum time2 = token2->getDurationFromStart();
 			HumNum distance1 = time2 - time1;
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				skip = j + count;
 				continue;
 			}
 
-			Enumerator++;
-			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
-			}
+			m_enumerator++;
 
-			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
+			int interval = int(*v2a.at(j) - *attacks.at(v1).at(i));
 
 			if (!m_noInfo) {
 				if (!(m_first && (distance1 < 0))) {
@@ -392,7 +579,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -482,7 +669,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				}
 
 				if (!(m_first && (distance2 <= 0))) {
-					int line2 = attacks.at(v2).at(j)->getLineIndex();
+					int line2 = attacks.at(v2).at(j2)->getLineIndex();
 
 					if (!results.at(v2).at(line2).empty()) {
 						results.at(v2).at(line2) += " ";
@@ -499,7 +686,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -508,7 +695,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						}
 						data2 = true;
 						results.at(v2).at(line2) += "m";
-						int line = attacks.at(v2).at(j)->getToken()->getLineIndex();
+						int line = attacks.at(v2).at(j2)->getToken()->getLineIndex();
 						results.at(v2).at(line2) += to_string(m_barlines[line]);
 					}
 
@@ -518,7 +705,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						}
 						data2 = true;
 						results.at(v2).at(line2) += "b";
-						HLp humline = attacks.at(v2).at(j)->getToken()->getOwner();
+						HLp humline = attacks.at(v2).at(j2)->getToken()->getOwner();
 						stringstream ss;
 						ss.str("");
 						ss << humline->getBeat().getFloat();
@@ -534,8 +721,8 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						// time1 is the starttime
 						HumNum endtime;
 						HTp endtoken = NULL;
-						if (j+count < (int)attacks.at(v2).size()) {
-							endtoken = attacks.at(v2).at(j+count)->getToken();
+						if (j2+count < (int)attacks.at(v2).size()) {
+							endtoken = attacks.at(v2).at(j2+count)->getToken();
 							endtime = endtoken->getDurationFromStart();
 						} else {
 							endtime = token2->getOwner()->getOwner()->getScoreDuration();
@@ -594,10 +781,10 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						break;
 					}
 					token1 = attacks.at(v1).at(i+z)->getToken();
-					if (j+z >= (int)attacks.at(v2).size()) {
+					if (j+z >= (int)v2a.size()) {
 						break;
 					}
-					token2 = attacks.at(v2).at(j+z)->getToken();
+					token2 = v2a.at(j+z)->getToken();
 					if (m_single) {
 						if (token1->find(m_marker) == string::npos) {
 							token1->setText(*token1 + m_marker);
@@ -616,17 +803,17 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					}
 
-               if (attacks.at(v2).at(j+z)->isRest() && (z < count - 1) ) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
-					} else if (!attacks.at(v2).at(j+z)->isRest()) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
+               if (v2a.at(j+z)->isRest() && (z < count - 1) ) {
+						markedTiedNotes(v2a.at(j+z)->m_tiedtokens);
+					} else if (!v2a.at(j+z)->isRest()) {
+						markedTiedNotes(v2a.at(j+z)->m_tiedtokens);
 					}
 
 				}
 			}
 
-			// skip over match (need to do in i as well somehow)
-			j += count;
+			// skip over match
+			skip = j + count;
 		} // j loop
 	} // i loop
 }
@@ -679,6 +866,41 @@ int Tool_imitation::checkForIntervalSequence(vector<int>& m_intervals,
 
 
 
+///////////////////////////////
+//
+// Tool_imitation::extendsBackward -- Returns true if the notes before
+//     i1 and i2 also match, in which case a match starting at i1/i2
+//     is the continuation of a longer match.
+//
+
+bool Tool_imitation::extendsBackward(vector<NoteCell*>& attack1,
+		vector<double>& seq1, int i1, vector<NoteCell*>& attack2,
+		vector<double>& seq2, int i2) {
+	if ((i1 == 0) || (i2 == 0)) {
+		return false;
+	}
+	double interval1 = seq1.at(i1-1);
+	double interval2 = seq2.at(i2-1);
+	// matches cannot start with rests
+	if (Convert::isNaN(interval1) || Convert::isNaN(interval2)) {
+		return false;
+	}
+	if (m_inversion) {
+		interval2 = -interval2;
+	}
+	if (interval1 != interval2) {
+		return false;
+	}
+	if (m_duration) {
+		if (attack1.at(i1-1)->getDuration() != attack2.at(i2-1)->getDuration()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
 ///////////////////////////////
 //
 // Tool_imitation::compareSequences -- Returns the number of notes that
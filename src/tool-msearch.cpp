@@ -14,6 +14,8 @@
 #include "Convert.h"
 #include "HumRegex.h"
 
+#include <fstream>
+
 using namespace std;
 
 namespace hum {
@@ -129,6 +131,9 @@ Tool_msearch::Tool_msearch(void) {
 	define("i|interval=s:2222",           "interval query string");
 	define("r|d|rhythm|duration=s:44444", "rhythm query string");
 	define("t|text=s:",                   "lyrical text query string");
+	define("w|words=b",                   "look up text query words in a word index");
+	define("index=s",                     "word index file for -w (made with --make-index)");
+	define("make-index=b",                "print word index of input instead of searching");
 	define("O|no-overlap=b",              "do not allow matches to overlap");
 	define("x|cross=b",                   "search across parts");
 	define("c|color=s",                   "highlight color");
@@ -190,6 +195,12 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 	}
 	initialize();
 
+	if (getBoolean("make-index")) {
+		HumWordIndex index(infile);
+		index.writeIndex(m_free_text);
+		return true;
+	}
+
 	if (getBoolean("text")) {
 		m_text = getString("text");
 	}
@@ -307,22 +318,51 @@ void Tool_msearch::fillWordsForTrack(vector<TextInfo*>& words,
 //////////////////////////////
 //
 // Tool_msearch::doTextSearch -- do a basic text search of all parts.
+//     Each query word is a regular expression which is searched for
+//     (without case) in every word.  With the -w option, query words
+//     are instead looked up in a HumWordIndex of the file: whole words
+//     are compared without case, diacritics or punctuation, "*" matches
+//     any characters and "?" matches one character.
 //
 
 void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		vector<MSearchTextQuery>& query) {
 
-	vector<TextInfo*> words;
-	words.reserve(10000);
-	fillWords(infile, words);
 	int tcount = 0;
 
-	HumRegex hre;
-	for (int i=0; i<(int)query.size(); i++) {
-		for (int j=0; j<(int)words.size(); j++) {
-			if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
+	if (!(getBoolean("words") || getBoolean("index"))) {
+		vector<TextInfo*> words;
+		words.reserve(10000);
+		fillWords(infile, words);
+		HumRegex hre;
+		for (int i=0; i<(int)query.size(); i++) {
+			for (int j=0; j<(int)words.size(); j++) {
+				if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
+					tcount++;
+					markTextMatch(infile, *words[j]);
+				}
+			}
+		}
+		for (int i=0; i<(int)words.size(); i++) {
+			delete words[i];
+			words[i] = NULL;
+		}
+	} else {
+		HumWordIndex built;
+		const HumWordIndex* index = getWordIndex(infile);
+		if (!index) {
+			built.build(infile);
+			index = &built;
+		}
+		vector<int> matches;
+		TextInfo word;
+		for (int i=0; i<(int)query.size(); i++) {
+			index->find(matches, query[i].word);
+			for (int j=0; j<(int)matches.size(); j++) {
+				word.starttoken = index->getStartToken(infile, matches[j]);
+				word.nexttoken = index->getNextToken(infile, matches[j]);
 				tcount++;
-				markTextMatch(infile, *words[j]);
+				markTextMatch(infile, word);
 			}
 		}
 	}
@@ -358,11 +398,6 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 		infile.createLinesFromTokens();
 	}
 
-	for (int i=0; i<(int)words.size(); i++) {
-		delete words[i];
-		words[i] = NULL;
-	}
-
 	if (!m_quietQ) {
 		addTextSearchSummary(infile, tcount, m_marker);
 	}
@@ -370,6 +405,42 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 
 
 
+//////////////////////////////
+//
+// Tool_msearch::getWordIndex -- Return the index for the file from the
+//     word index file given with the --index option, or NULL if there is
+//     no index for the file.  The index file is read the first time that
+//     it is needed.  An index is used only if it has the same filename and
+//     line count as the input file.
+//
+
+const HumWordIndex* Tool_msearch::getWordIndex(HumdrumFile& infile) {
+	if (!getBoolean("index")) {
+		return NULL;
+	}
+	if (!m_wordIndexesReadQ) {
+		m_wordIndexesReadQ = true;
+		ifstream input(getString("index"));
+		if (!input.is_open()) {
+			cerr << "Warning: cannot read word index file " << getString("index") << endl;
+			return NULL;
+		}
+		HumWordIndex index;
+		while (index.readIndex(input)) {
+			m_wordIndexes.push_back(index);
+		}
+	}
+	for (int i=0; i<(int)m_wordIndexes.size(); i++) {
+		if ((m_wordIndexes[i].getName() == infile.getFilename()) &&
+				(m_wordIndexes[i].getLineCount() == infile.getLineCount())) {
+			return &m_wordIndexes[i];
+		}
+	}
+	return NULL;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::printQuery --
@@ -23,9 +23,12 @@
 #include "HumRegex.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
+#include <utility>
 
 using namespace std;
 using namespace pugi;
@@ -45,6 +48,7 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("j|jobs|threads=i:1", "number of threads for parsing parts");
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -121,10 +125,13 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	// for debugging:
 	//printPartInfo(partids, partinfo, partcontent, partdata);
 
+	forEachPart((int)partdata.size(), [&](int i) {
+		partdata[i].prepareVoiceMapping();
+	});
+
 	m_maxstaff = 0;
 	// check the voice info
 	for (int i=0; i<(int)partdata.size(); i++) {
-		partdata[i].prepareVoiceMapping();
 		m_maxstaff += partdata[i].getStaffCount();
 		// for debugging:
 		if (VoiceDebugQ) {
@@ -134,6 +141,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 
 	// re-index voices to disallow empty intermediate voices.
 	reindexVoices(partdata);
+	preparePartEvents(partdata);
 
 	HumGrid outdata;
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
@@ -240,7 +248,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		HumdrumFile outfile2;
 		outfile2.readString(sstream.str());
 		gracebeam.run(outfile2);
-		outfile = outfile2;
+		outfile = std::move(outfile2);
 	}
 
 	if (m_hasTransposition) {
@@ -664,18 +672,56 @@ void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::initialize(void) {
 	m_recipQ = getBoolean("recip");
 	m_stemsQ = getBoolean("stems");
+	m_threads = getInteger("threads");
+	if (m_threads < 1) {
+		m_threads = 1;
+	}
 	m_hasOrnamentsQ = false;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::forEachPart -- Call a function for each part index.
+//     With more than one thread (-j option), the parts are handed out to
+//     the threads as they become free, so the function must only modify
+//     the data for the given part.
+//
+
+void Tool_musicxml2hum::forEachPart(int count, const std::function<void(int)>& process) {
+	if (count <= 0) {
+		return;
+	}
+	atomic<int> next(0);
+	auto work = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			process(index);
+		}
+	};
+
+	int threadcount = min(m_threads, count);
+	vector<thread> threads;
+	threads.reserve(threadcount - 1);
+	for (int i=1; i<threadcount; i++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::reindexVoices --
 //
 
 void Tool_musicxml2hum::reindexVoices(vector<MxmlPart>& partdata) {
-	for (int p=0; p<(int)partdata.size(); p++) {
+	forEachPart((int)partdata.size(), [&](int p) {
 		for (int m=0; m<(int)partdata[p].getMeasureCount(); m++) {
 			MxmlMeasure* measure = partdata[p].getMeasure(m);
 			if (!measure) {
@@ -683,7 +729,30 @@ void Tool_musicxml2hum::reindexVoices(vector<MxmlPart>& partdata) {
 			}
 			reindexMeasure(measure);
 		}
-	}
+	});
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePartEvents -- Add dummy rests for empty
+//     voices and attach hairpin endings to notes in each measure before
+//     the parts are merged into the grid.  This only depends on the
+//     events within each part, so parts are prepared in parallel.
+//
+
+void Tool_musicxml2hum::preparePartEvents(vector<MxmlPart>& partdata) {
+	forEachPart((int)partdata.size(), [&](int p) {
+		for (int m=0; m<(int)partdata[p].getMeasureCount(); m++) {
+			MxmlMeasure* measure = partdata[p].getMeasure(m);
+			if (!measure) {
+				continue;
+			}
+			checkForDummyRests(measure);
+			attachHairpinEndings(measure);
+		}
+	});
 }
 
 
@@ -841,11 +910,25 @@ bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
 		const vector<string>& partids, map<string, xml_node>& partinfo,
 		map<string, xml_node>& partcontent) {
 
-	bool output = true;
-	for (int i=0; i<(int)partinfo.size(); i++) {
+	// Look up the nodes before any threads start, since map::operator[]
+	// may insert into the maps:
+	int count = (int)partinfo.size();
+	vector<xml_node> declarations(count);
+	vector<xml_node> contents(count);
+	for (int i=0; i<count; i++) {
+		declarations[i] = partinfo[partids[i]];
+		contents[i] = partcontent[partids[i]];
+	}
+
+	vector<char> status(count, true);
+	forEachPart(count, [&](int i) {
 		partdata[i].setPartNumber(i+1);
-		output &= fillPartData(partdata[i], partids[i], partinfo[partids[i]],
-				partcontent[partids[i]]);
+		status[i] = fillPartData(partdata[i], partids[i], declarations[i], contents[i]);
+	});
+
+	bool output = true;
+	for (int i=0; i<count; i++) {
+		output &= (bool)status[i];
 	}
 	return output;
 }
@@ -1197,7 +1280,6 @@ bool Tool_musicxml2hum::insertMeasure(HumGrid& outdata, int mnum,
 			gm->setTimestamp(partdata[i].getMeasure(mnum)->getTimestamp());
 			gm->setTimeSigDur(partdata[i].getMeasure(mnum)->getTimeSigDur());
 		}
-		checkForDummyRests(xmeasure);
 		sevents.push_back(xmeasure->getSortedEvents());
 		if (i == 0) {
 			// only checking measure style of first barline
@@ -1220,32 +1302,8 @@ bool Tool_musicxml2hum::insertMeasure(HumGrid& outdata, int mnum,
 			measuredata[i]->setTimeSigDur(tsdur);
 		}
 
-		// Keep track of hairpin endings that should be attached
-		// the the previous note (and doubling the ending marker
-		// to indicate that the timestamp of the ending is at the
-		// end rather than the start of the note.
-		vector<MxmlEvent*>& events = measuredata[i]->getEventList();
-		xml_node hairpin = xml_node(NULL);
-		for (int j=(int)events.size() - 1; j >= 0; j--) {
-			if (events[j]->getElementName() == "note") {
-				if (hairpin) {
-					events[j]->setHairpinEnding(hairpin);
-					hairpin = xml_node(NULL);
-				}
-				break;
-			} else if (events[j]->getElementName() == "direction") {
-				stringstream ss;
-				ss.str("");
-				events[j]->getNode().print(ss);
-				if (ss.str().find("wedge") != string::npos) {
-					if (ss.str().find("stop") != string::npos) {
-						hairpin = events[j]->getNode();
-					}
-				}
-			}
-		}
-
 		if (VoiceDebugQ) {
+			vector<MxmlEvent*>& events = measuredata[i]->getEventList();
 			for (int j=0; j<(int)events.size(); j++) {
 				cerr << "!!ELEMENT: ";
 				cerr << "\tTIME:  " << events[j]->getStartTime();
@@ -1546,6 +1604,39 @@ void Tool_musicxml2hum::checkForDummyRests(MxmlMeasure* measure) {
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::attachHairpinEndings -- Keep track of hairpin endings
+//     that should be attached the the previous note (and doubling the
+//     ending marker to indicate that the timestamp of the ending is at the
+//     end rather than the start of the note.
+//
+
+void Tool_musicxml2hum::attachHairpinEndings(MxmlMeasure* measure) {
+	vector<MxmlEvent*>& events = measure->getEventList();
+	xml_node hairpin = xml_node(NULL);
+	for (int j=(int)events.size() - 1; j >= 0; j--) {
+		if (events[j]->getElementName() == "note") {
+			if (hairpin) {
+				events[j]->setHairpinEnding(hairpin);
+				hairpin = xml_node(NULL);
+			}
+			break;
+		} else if (events[j]->getElementName() == "direction") {
+			stringstream ss;
+			ss.str("");
+			events[j]->getNode().print(ss);
+			if (ss.str().find("wedge") != string::npos) {
+				if (ss.str().find("stop") != string::npos) {
+					hairpin = events[j]->getNode();
+				}
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::convertNowEvents --
@@ -14,6 +14,7 @@
 #include "tool-pccount.h"
 #include "Convert.h"
 #include "HumRegex.h"
+#include "PitchHistogram.h"
 
 using namespace std;
 
@@ -29,11 +30,13 @@ namespace hum {
 
 Tool_pccount::Tool_pccount(void) {
 	define("a|attacks=b",                 "count attacks instead of durations");
+	define("C|corpus=b",                  "count pitch classes for all input files together");
 	define("d|data|vega-data=b",          "display the vega-lite template.");
 	define("f|full=b",                    "full count attacks all single sharps and flats.");
 	define("ff|double-full=b",            "full count attacks all double sharps and flats.");
 	define("h|html=b",                    "generate vega-lite HTML content");
 	define("i|id=s:id",                   "ID for use as variable and in plot title");
+	define("j|jobs|threads=i:1",          "number of threads for --corpus analysis");
 	define("K|no-key|no-final=b",         "do not label key tonic or final");
 	define("m|maximum=b",                 "normalize by maximum count");
 	define("n|normalize=b",               "normalize counts");
@@ -61,6 +64,20 @@ bool Tool_pccount::run(HumdrumFileSet& infiles) {
 }
 
 
+bool Tool_pccount::run(HumdrumFileStream& instream) {
+	if (!getBoolean("corpus")) {
+		HumdrumFileSet infiles;
+		bool status = true;
+		while (instream.readSingleSegment(infiles)) {
+			status &= run(infiles);
+		}
+		return status;
+	}
+	processCorpus(instream);
+	return true;
+}
+
+
 bool Tool_pccount::run(const string& indata, ostream& out) {
 	HumdrumFile infile(indata);
 	return run(infile, out);
@@ -204,6 +221,37 @@ string Tool_pccount::getFinal(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_pccount::processCorpus -- Sum the pitch classes of all files
+//     in the input stream into a single "all" column.  Files are
+//     analyzed in parallel with the --threads option.
+//
+
+void Tool_pccount::processCorpus(HumdrumFileStream& instream) {
+	m_attack    = getBoolean("attacks");
+	m_normalize = getBoolean("normalize");
+	m_maximum   = getBoolean("maximum");
+
+	PitchProfile profile;
+	profile.setAttacks(m_attack);
+	profile.analyze(instream, getInteger("threads"));
+
+	m_names.assign(1, "all");
+	m_abbreviations.assign(1, "all");
+	m_counts.assign(1, profile.getPitchClasses().getBase40Vector());
+
+	m_free_text << "!!!files: " << profile.getFileCount() << endl;
+	const PitchHistogram& range = profile.getRange();
+	if (!profile.getPitchClasses().isEmpty()) {
+		m_free_text << "!!!range: " << Convert::base40ToKern(range.getLowestBase40());
+		m_free_text << "-" << Convert::base40ToKern(range.getHighestBase40()) << endl;
+	}
+	printHumdrumTable();
+}
+
+
+
 //////////////////////////////
 //
 // Tool_pccount::processFile --
@@ -482,25 +530,22 @@ void Tool_pccount::countPitches(HumdrumFile& infile) {
 	if (m_parttracks.size() == 0) {
 		return;
 	}
-	m_counts.clear();
-	m_counts.resize(m_parttracks.size());
-	for (int i=0; i<(int)m_parttracks.size(); i++) {
-		m_counts[i].resize(40);
-		fill(m_counts[i].begin(), m_counts[i].end(), 0.0);
-	}
+	vector<PitchClassHistogram> histograms(m_parttracks.size());
 	for (int i=0; i<infile.getStrandCount(); i++) {
 		HTp sstart = infile.getStrandStart(i);
 		HTp send = infile.getStrandEnd(i);
-		addCounts(sstart, send);
+		addCounts(histograms, sstart, send);
 	}
 
 	// fill in sum for all parts
-	for (int i=0; i<(int)m_counts[0].size(); i++) {
-		for (int j=1; j<(int)m_counts.size(); j++) {
-			m_counts[0][i] += m_counts[j][i];
-		}
+	for (int i=1; i<(int)histograms.size(); i++) {
+		histograms[0] += histograms[i];
 	}
 
+	m_counts.resize(histograms.size());
+	for (int i=0; i<(int)histograms.size(); i++) {
+		m_counts[i] = histograms[i].getBase40Vector();
+	}
 }
 
 
@@ -509,7 +554,8 @@ void Tool_pccount::countPitches(HumdrumFile& infile) {
 // Tool_pccount::addCounts --
 //
 
-void Tool_pccount::addCounts(HTp sstart, HTp send) {
+void Tool_pccount::addCounts(vector<PitchClassHistogram>& histograms,
+		HTp sstart, HTp send) {
 	if (!sstart) {
 		return;
 	}
@@ -539,12 +585,11 @@ void Tool_pccount::addCounts(HTp sstart, HTp send) {
 					continue;
 				}
 			}
-			int b40 = Convert::kernToBase40(subtokens[i]);
 			if (m_attack) {
-				m_counts[kindex][b40%40]++;
+				histograms[kindex].addKern(subtokens[i]);
 			} else {
 				double duration = Convert::recipToDuration(subtokens[i]).getFloat();
-				m_counts[kindex][b40%40] += duration;
+				histograms[kindex].addKern(subtokens[i], duration);
 			}
 		}
 		current = current->getNextToken();
@@ -62,6 +62,7 @@ _VoiceInfo::_VoiceInfo(void) {
 void _VoiceInfo::clear(void) {
 	name = "";
 	abbr = "";
+	histogram.clear();
 	midibins.resize(128);
 	fill(midibins.begin(), midibins.end(), 0.0);
 	diatonic.resize(7 * 12);
@@ -78,6 +79,29 @@ void _VoiceInfo::clear(void) {
 }
 
 
+//////////////////////////////
+//
+// _VoiceInfo::loadHistogram -- Copy the pitch histogram into the
+//    midibins and diatonic arrays used for printing.  Diatonic index 0
+//    is three octaves below octave 0, and the second dimension is the
+//    sum for all accidentals followed by double-flat to double-sharp.
+//
+
+void _VoiceInfo::loadHistogram(void) {
+	for (int i=0; i<(int)midibins.size(); i++) {
+		midibins[i] = histogram.getMidi(i);
+	}
+	for (int i=0; i<(int)diatonic.size(); i++) {
+		int base7 = i - 3 * 7;
+		diatonic[i][0] = histogram.getBase7(base7);
+		for (int j=1; j<(int)diatonic[i].size(); j++) {
+			diatonic[i][j] = histogram.getDiatonic(base7, j - 3);
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // _VoiceInfo::print --
@@ -466,15 +490,11 @@ void Tool_prange::mergeAllVoiceInfo(vector<_VoiceInfo>& voiceInfo) {
 			voiceInfo.at(0).namfinal.push_back(voiceInfo.at(i).name);
 		}
 
-		for (int j=0; j<(int)voiceInfo[i].midibins.size(); j++) {
-			voiceInfo[0].midibins[j] += voiceInfo[i].midibins[j];
-		}
+		voiceInfo[0].histogram += voiceInfo[i].histogram;
+	}
 
-		for (int j=0; j<(int)voiceInfo.at(i).diatonic.size(); j++) {
-			for (int k=0; k<(int)voiceInfo.at(i).diatonic.at(k).size(); k++) {
-				voiceInfo[0].diatonic.at(j).at(k) += voiceInfo.at(i).diatonic.at(j).at(k);
-			}
-		}
+	for (int i=0; i<(int)voiceInfo.size(); i++) {
+		voiceInfo[i].loadHistogram();
 	}
 }
 
@@ -705,13 +725,11 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 					cerr << "Accidental too sharp: " << tokens[k] << endl;
 					continue;
 				}
-				int diatonic = dpc + 7 * octave;
 				int realdiatonic = dpc + 7 * (octave-3);
 
 				diafinal.at(track).push_back(realdiatonic);
 				accfinal.at(track).push_back(acc);
 
-				acc += 3;
 				int midi = Convert::kernToMidiNoteNumber(tokens[k]);
 				if (midi < 0) {
 					cerr << "MIDI pitch too low: " << tokens[k] << endl;
@@ -719,11 +737,10 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 				if (midi > 127) {
 					cerr << "MIDI pitch too high: " << tokens[k] << endl;
 				}
+				int base40 = Convert::kernToBase40(tokens[k]);
 				if (m_durationQ) {
 					double duration = Convert::kernToDuration(tokens[k]).getFloat();
-					voiceInfo[track].diatonic.at(diatonic).at(0) += duration;
-					voiceInfo[track].diatonic.at(diatonic).at(acc) += duration;
-					voiceInfo[track].midibins.at(midi) += duration;
+					voiceInfo[track].histogram.addBase40(base40, duration);
 				} else {
 					if (tokens[k].find("]") != string::npos) {
 						continue;
@@ -731,9 +748,7 @@ void Tool_prange::fillHistograms(vector<_VoiceInfo>& voiceInfo, HumdrumFile& inf
 					if (tokens[k].find("_") != string::npos) {
 						continue;
 					}
-					voiceInfo[track].diatonic.at(diatonic).at(0)++;
-					voiceInfo[track].diatonic.at(diatonic).at(acc)++;
-					voiceInfo[track].midibins.at(midi)++;
+					voiceInfo[track].histogram.addBase40(base40);
 				}
 			}
 		}
@@ -126,6 +126,24 @@ void Tool_rid::initialize(void) {
 
 
 
+//////////////////////////////
+//
+// Tool_rid::run -- Process the input one line at a time.
+//
+
+bool Tool_rid::run(HumdrumLineStream& instream, ostream& out) {
+	initialize();
+	bool revQ = option_V;
+	while (instream.readLine()) {
+		if (isRemovedLine(instream) == revQ) {
+			out << instream.getLine() << "\n";
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_rid::processFile --
@@ -261,6 +279,81 @@ void Tool_rid::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_rid::isRemovedLine -- Returns true if the line should be removed
+//     (or printed when the -V option is used).  This is the same test as
+//     in processFile(), for input read one line at a time.
+//
+
+bool Tool_rid::isRemovedLine(HumdrumLineStream& line) {
+   if (option_D && (line.isBarline() || line.isData())) {
+      // remove data lines if -D is specified
+      return true;
+   }
+   if (option_d) {
+      // remove null data lines if -d is specified
+      if (option_k && line.isData() && line.equalFieldsQ("**kern", ".")) {
+         // remove if only all **kern spines are null.
+         return true;
+      } else if (!option_k && line.isData() && line.isAllNull()) {
+         // remove null data lines if all spines are null.
+         return true;
+      }
+   }
+   if (option_G && (line.isGlobalComment() || line.isReference())) {
+      // remove global comments if -G is specified
+      return true;
+   }
+   if (option_g && m_hre.search(line.getToken(0), "^!!+\\s*$")) {
+      // remove empty global comments if -g is specified
+      return true;
+   }
+   if (option_I && line.isInterpretation()) {
+      // remove all interpretation records
+      return true;
+   }
+   if (option_i && line.isInterpretation() && line.isAllNull()) {
+      // remove null interpretation records
+      return true;
+   }
+   if (option_L && line.isLocalComment()) {
+      // remove all local comments
+      return true;
+   }
+   if (option_l && line.isLocalComment() && line.isAllNull()) {
+      // remove null local comments
+      return true;
+   }
+   if (option_T && (line.isInterpretation() && !line.isManipulator())) {
+      // remove tandem (non-manipulator) interpretations
+      return true;
+   }
+   if (option_U) {
+      // remove unnecessary (duplicate exclusive) interpretations
+      // HumdrumFile class does not allow duplicate ex. interps.
+   }
+
+   // non-classical options:
+
+   if (option_M && line.isBarline()) {
+      // remove all measure lines
+      return true;
+   }
+   if (option_C && line.isComment()) {
+      // remove all comments (local & global)
+      return true;
+   }
+   if (option_c && (line.isLocalComment() || line.isGlobalComment())) {
+      // remove all comments (local & global)
+      return true;
+   }
+
+   return false;
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
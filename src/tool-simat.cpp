@@ -13,6 +13,7 @@
 #include "tool-simat.h"
 #include "Convert.h"
 #include "HumRegex.h"
+#include "PitchHistogram.h"
 
 #include "pugixml.hpp"
 
@@ -315,6 +316,7 @@ void MeasureData::generateNoteHistogram(void) {
 		return;
 	}
 
+	PitchClassHistogram histogram;
 	HumdrumFile& infile = *m_owner;
 	for (int i=m_startline; i<m_stopline; i++) {
 		if (!infile[i].isData()) {
@@ -335,18 +337,12 @@ void MeasureData::generateNoteHistogram(void) {
 			int subtokcount = token->getSubtokenCount();
 			for (int k=0; k<subtokcount; k++) {
 				string subtok = token->getSubtoken(k);
-				int pc = Convert::kernToBase7PC(subtok);
-				if (pc < 0) {
-					continue;
-				}
-				m_hist7pc.at(pc) += duration;
+				histogram.addKern(subtok, duration);
 			}
 		}
 	}
-	m_sum7pc = 0.0;
-	for (int i=0; i<(int)m_hist7pc.size(); i++) {
-		m_sum7pc += m_hist7pc[i];
-	}
+	m_hist7pc = histogram.getBase7Vector();
+	m_sum7pc = histogram.getTotal();
 }
 
 
@@ -215,14 +215,17 @@ bool Tool_synco::isSyncopated(HTp token) {
 //
 
 double Tool_synco::getMetricLevel(HTp token) {
-	HumNum durbar = token->getDurationFromBarline();
-	if (!durbar.isInteger()) {
+	HumdrumFile* infile = token->getOwner()->getOwner();
+	int tpq = infile->getMetricTpq();
+	int tick = infile->getMetricInfo(token->getLineIndex(), token->getTrack()).m_tick;
+	if (tick % tpq != 0) {
 		return -1.0;
 	}
-	if (durbar.getNumerator() % 4 == 0) {
+	int quarters = tick / tpq;
+	if (quarters % 4 == 0) {
 		return 2.0;
 	}
-	if (durbar.getNumerator() % 2 == 0) {
+	if (quarters % 2 == 0) {
 		return 1.0;
 	}
 	return 0.0;
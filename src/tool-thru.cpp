@@ -11,10 +11,9 @@
 //
 
 #include "tool-thru.h"
+#include "HumdrumExpansionView.h"
 #include "HumRegex.h"
 
-#include <cstdlib>
-#include <cstring>
 #include <iostream>
 
 using namespace std;
@@ -286,238 +285,45 @@ int Tool_thru::getBarline(HumdrumFile& infile, int line) {
 
 //////////////////////////////
 //
-// Tool_thru::processData --
+// Tool_thru::processData -- Print the lines of the file in the order
+//    given by the expansion list.  If there is no expansion list, the
+//    file is echoed with a *thru line added after the exclusive
+//    interpretations.
 //
 
 void Tool_thru::processData(HumdrumFile& infile) {
-	vector<string> labelsequence;
-	labelsequence.reserve(1000);
-
-	vector<string> labels;
-	labels.reserve(1000);
-
-	vector<int> startline;
-	startline.reserve(1000);
-
-	vector<int> stopline;
-	stopline.reserve(1000);
-
-	int header = -1;
-	int footer = -1;
-	string labelsearch;
-	labelsearch = "*>";
-	labelsearch += m_variation;
-	labelsearch += "[";
-
-	// check for label to expand
-	int foundlabel = 0;
-	string tempseq;
-	if (m_realization.size()  == 0) {
-		for (int i=0; i<infile.getLineCount(); i++) {
-			if (!infile[i].isInterpretation()) {
-				continue;
+	HumdrumExpansionView view;
+	view.setKeepLists(m_keepQ);
+	view.analyze(infile, m_variation, m_realization);
+
+	int sequence = 0;
+	int sequenceCount = view.getSequenceCount();
+	for (int i=0; i<view.getLineCount(); i++) {
+		while ((sequence < sequenceCount) && (view.getSequenceStart(sequence) <= i)) {
+			if (!view.hasSequenceLabel(sequence)) {
+				m_humdrum_text << "!! THRU ERROR: label " << view.getSequenceLabel(sequence)
+				               << " does not exist, skipping.\n";
 			}
-			HTp token = infile.token(i, 0);
-			if (token->compare(0, labelsearch.size(), labelsearch) != 0) {
-				continue;
-			}
-
-			tempseq = token->substr(labelsearch.size());
-			getLabelSequence(labelsequence, tempseq);
-			foundlabel = 1;
-			break;
-		}
-	} else {
-		foundlabel = 1;
-		getLabelSequence(labelsequence, m_realization);
-	}
-
-	if (foundlabel == 0) {
-		// did not find the label to expand, so echo the data back
-		for (int i=0; i<infile.getLineCount(); i++) {
-			HTp token = infile.token(i, 0);
-			if (*token == "*thru") {
-				continue;
-			}
-			m_humdrum_text << infile[i] << "\n";
-			if (token->compare(0, 2, "**") == 0) {
-				for (int j=0; j<infile[i].getFieldCount(); j++) {
-					m_humdrum_text << "*thru";
-					if (j < infile[i].getFieldCount() - 1) {
-						m_humdrum_text << "\t";
-					}
-				}
-				m_humdrum_text << "\n";
-			}
-		}
-		return;
-	}
-
-	// for (i=0; i<(int)labelsequence.size(); i++) {
-	//    m_humdrum_text << i+1 << "\t=\t" << labelsequence[i] << endl;
-	// }
-
-	// search for the labeled sections in the music
-	string label;
-	int location;
-	int index;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		HTp token = infile.token(i, 0);
-		if (*token == "*-") {
-			location = i-1;
-			footer = i;
-			stopline.push_back(location);
-		}
-		if (token->compare(0, 2, "*>") != 0) {
-			continue;
-		}
-		if (token->find('[') != string::npos) {
-			continue;
+			sequence++;
 		}
-		if (token->find(']') != string::npos) {
-			continue;
-		}
-
-		if (labels.size() == 0) {
-			header = i-1;
-		}
-
-		label = token->substr(2);
-		index = (int)labels.size();
-		location = i-1;
-		if (startline.size() > 0) {
-			stopline.push_back(location);
-		}
-		labels.resize(index+1);
-		labels[index] = label;
-		startline.push_back(i);
-	}
-
-	// m_humdrum_text << "FOOTER = " << footer << endl;
-	// m_humdrum_text << "HEADER = " << header << endl;
-	// for (i=0; i<(int)labels.size(); i++) {
-	//    m_humdrum_text << "\t" << i << "\t=\t" << labels[i]
-	//         << "\t" << startline[i] << "\t" << stopline[i]
-	//         << endl;
-	// }
-
-	// now ready to copy the labeled segements into a final file.
-
-
-	// print header:
-	for (int i=0; i<=header; i++) {
-		HTp token = infile.token(i, 0);
-		if (*token == "*thru") {
-			continue;
-		}
-
-		if (!m_keepQ) {
-			if (infile[i].isInterpretation()) {
-				if (token->compare(0, 2, "*>") == 0) {
-					if (token->find('[') != string::npos) {
-						continue;
-					}
-				}
-			}
-		}
-
-		m_humdrum_text << infile[i] << "\n";
-		if (token->compare(0, 2, "**") == 0) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
+		HumdrumLine& line = view[i];
+		m_humdrum_text << line << "\n";
+		if (view.isHeader(i) && line.isExclusiveInterpretation()) {
+			for (int j=0; j<line.getFieldCount(); j++) {
 				m_humdrum_text << "*thru";
-				if (j < infile[i].getFieldCount() - 1) {
+				if (j < line.getFieldCount() - 1) {
 					m_humdrum_text << "\t";
 				}
 			}
 			m_humdrum_text << "\n";
 		}
 	}
-
-	int start;
-	int stop;
-	for (int i=0; i<(int)labelsequence.size(); i++) {
-		index = getLabelIndex(labels, labelsequence[i]);
-		if (index < 0) {
-			m_humdrum_text << "!! THRU ERROR: label " << labelsequence[i]
-				  << " does not exist, skipping.\n";
-		}
-		start = startline[index];
-		stop  = stopline[index];
-		for (int j=start; j<=stop; j++) {
-			if (!m_keepQ) {
-				if (infile[j].isInterpretation()) {
-					HTp token = infile.token(j, 0);
-					if (token->compare(0, 2, "*>") == 0) {
-						if (token->find('[') != string::npos) {
-							continue;
-						}
-					}
-				}
-			}
-			m_humdrum_text << infile[j] << "\n";
+	for (; sequence<sequenceCount; sequence++) {
+		if (!view.hasSequenceLabel(sequence)) {
+			m_humdrum_text << "!! THRU ERROR: label " << view.getSequenceLabel(sequence)
+			               << " does not exist, skipping.\n";
 		}
 	}
-
-	// print footer:
-	for (int i=footer; i<infile.getLineCount(); i++) {
-		if (!m_keepQ) {
-			if (infile[i].isInterpretation()) {
-				HTp token = infile.token(i, 0);
-				if (token->compare(0, 2, "*>") == 0) {
-					if (token->find('[') != string::npos) {
-						continue;
-					}
-				}
-			}
-		}
-		m_humdrum_text << infile[i] << "\n";
-	}
-
-}
-
-
-
-//////////////////////////////
-//
-// Tool_thru::getLabelIndex --
-//
-
-int Tool_thru::getLabelIndex(vector<string>& labels, string& key) {
-	for (int i=0; i<(int)labels.size(); i++) {
-		if (key == labels[i]) {
-			return i;
-		}
-	}
-	return -1;
-}
-
-
-
-//////////////////////////////
-//
-// Tool_thru::getLabelSequence --
-//
-
-void Tool_thru::getLabelSequence(vector<string>& labelsequence,
-		const string& astring) {
-	int slength = (int)astring.size();
-	char* sdata = new char[slength+1];
-	strcpy(sdata, astring.c_str());
-	const char* ignorecharacters = ", [] ";
-	int index;
-
-	char* strptr = strtok(sdata, ignorecharacters);
-	while (strptr != NULL) {
-		labelsequence.resize((int)labelsequence.size() + 1);
-		index = (int)labelsequence.size() - 1;
-		labelsequence[index] = strptr;
-		strptr = strtok(NULL, ignorecharacters);
-	}
-
-	delete [] sdata;
 }
 
 
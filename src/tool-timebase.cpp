@@ -15,7 +15,11 @@
 #include "Convert.h"
 
 #include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstring>
+#include <numeric>
+#include <sstream>
 
 using namespace std;
 
@@ -34,6 +38,7 @@ Tool_timebase::Tool_timebase(void) {
 	define("m|min=b",         "use minimum time in score for timebase");
 	define("t|timebase=s:16", "timebase rhythm");
 	define("q|quiet=b",       "quiet mode: Do not output warnings");
+	define("c|collapse=b",    "remove null data lines added by timebase");
 }
 
 
@@ -52,6 +57,12 @@ bool Tool_timebase::run(HumdrumFileSet& infiles) {
 }
 
 bool Tool_timebase::run(const string& indata, ostream& out) {
+	if (getBoolean("collapse")) {
+		// Collapsing does not need a parsed file:
+		collapseText(indata);
+		getAllText(out);
+		return true;
+	}
 	HumdrumFile infile(indata);
 	return run(infile, out);
 }
@@ -59,6 +70,11 @@ bool Tool_timebase::run(const string& indata, ostream& out) {
 
 bool Tool_timebase::run(HumdrumFile& infile, ostream& out) {
 	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	} else {
+		out << infile;
+	}
 	return status;
 }
 
@@ -78,6 +94,10 @@ bool Tool_timebase::run(HumdrumFile& infile) {
 void Tool_timebase::processFile(HumdrumFile& infile) {
 	m_grace   = getBoolean("grace");
 	m_quiet   = getBoolean("quiet");
+	if (getBoolean("collapse")) {
+		collapseScore(infile);
+		return;
+	}
 	if (!getBoolean("timebase")) {
 		m_basedur = getMinimumTime(infile);
 	} else {
@@ -93,79 +113,296 @@ void Tool_timebase::processFile(HumdrumFile& infile) {
 
 //////////////////////////////
 //
-// Tool_timebase::expandScore --
+// Tool_timebase::buildRuns -- Store the duration of each line in the
+//    file as a count of timebase units (mindur).  The counts are
+//    calculated with integer arithmetic rather than by dividing HumNums.
 //
 
-void Tool_timebase::expandScore(HumdrumFile& infile, HumNum mindur) {
+void Tool_timebase::buildRuns(HumdrumFile& infile, HumNum mindur) {
+	m_runs.clear();
+	m_runs.reserve(infile.getLineCount());
+	long long basenum = mindur.getNumerator();
+	long long baseden = mindur.getDenominator();
 	for (int i=0; i<infile.getLineCount(); i++) {
+		m_runs.emplace_back();
+		TimebaseRun& run = m_runs.back();
+		run.m_line = i;
 		if (!infile[i].isData()) {
-			m_humdrum_text << infile[i] << endl;
 			continue;
 		}
 		HumNum duration = infile[i].getDuration();
-		if (duration == 0) {
+		// duration / mindur = num / den:
+		long long num = duration.getNumerator() * baseden;
+		long long den = duration.getDenominator() * basenum;
+		run.m_units = (int)(num / den);
+		run.m_exact = (num % den) == 0;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::expandScore -- Print each data line followed by enough
+//     lines of null tokens so that every data line has the timebase
+//     duration.  The null lines are copied from templates for each
+//     field count.
+//
+
+void Tool_timebase::expandScore(HumdrumFile& infile, HumNum mindur) {
+	buildRuns(infile, mindur);
+	// Null data lines in the output, and the ones which are from the input:
+	int nullcount = 0;
+	vector<int> inputnulls;
+	for (const TimebaseRun& run : m_runs) {
+		HumdrumLine& line = infile[run.m_line];
+		if (!line.isData()) {
+			m_humdrum_text << line << '\n';
+			continue;
+		}
+		if ((run.m_units == 0) && run.m_exact) {
+			// grace-note line
 			if (m_grace) {
-				m_humdrum_text << infile[i] << endl;
+				m_humdrum_text << line << '\n';
+				if (line.isAllNull()) {
+					inputnulls.push_back(++nullcount);
+				}
 			}
 			continue;
 		}
-		HumNum count = duration / mindur;
-		if (count < 1) {
+		if (run.m_units == 0) {
 			if (!m_quiet) {
 				m_humdrum_text << "!!Warning: following commented line was too short to be included in timebase output:\n";
-				m_humdrum_text << "!! " << infile[i] << endl;
+				m_humdrum_text << "!! " << line << '\n';
 			}
 			continue;
-		} else if (count.getDenominator() != 1) {
+		} else if (!run.m_exact) {
 			if (!m_quiet) {
+				HumNum count = line.getDuration() / mindur;
 				m_humdrum_text << "!!Warning: next line does not have proper duration for representing with timebase: " << count.getFloat() << endl;
 			}
 		}
-		m_humdrum_text << infile[i] << endl;
-		int repeats = int(count.getFloat()) - 1;
-		for (int j=0; j<repeats; j++) {
-			for (int k=0; k<infile[i].getFieldCount(); k++) {
-				m_humdrum_text << ".";
-				if (k < infile[i].getFieldCount() - 1) {
-					m_humdrum_text << "\t";
-				}
-			}
-			m_humdrum_text << endl;
+		m_humdrum_text << line << '\n';
+		if (line.isAllNull()) {
+			inputnulls.push_back(++nullcount);
 		}
+		const string& nullline = getNullLine(line.getFieldCount());
+		for (int j=1; j<run.m_units; j++) {
+			m_humdrum_text << nullline;
+		}
+		nullcount += run.m_units - 1;
 	}
 	if (!m_quiet) {
 		HumNum rhythm = Convert::durationToRecip(mindur);
 		m_humdrum_text << "!!timebased: " << rhythm << endl;
 	}
+	if (!inputnulls.empty()) {
+		// Needed by collapseScore() to keep the null lines of the input:
+		m_humdrum_text << "!!timebased-nulls:";
+		for (int number : inputnulls) {
+			m_humdrum_text << ' ' << number;
+		}
+		m_humdrum_text << '\n';
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::getNullLine -- Return a line of null data tokens (with
+//    a newline at the end) for the given number of fields.
+//
+
+const string& Tool_timebase::getNullLine(int fieldCount) {
+	if (fieldCount >= (int)m_nullLines.size()) {
+		m_nullLines.resize(fieldCount + 1);
+	}
+	string& output = m_nullLines[fieldCount];
+	if (output.empty()) {
+		for (int i=0; i<fieldCount; i++) {
+			output += (i == 0) ? "." : "\t.";
+		}
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::collapseScore -- Remove the null data lines added by
+//     expandScore(), and its timebase markers, so that each data line
+//     lasts until the next line with a note, rest or other data.  Null
+//     data lines from the input of expandScore() are listed in its
+//     "!!timebased-nulls:" marker and are kept.  Lines which expandScore()
+//     left out (grace-note lines without -g and lines shorter than the
+//     timebase) cannot be restored.
+//
+
+void Tool_timebase::collapseScore(HumdrumFile& infile) {
+	vector<bool> inputnulls;
+	for (int i=infile.getLineCount()-1; i>=0; i--) {
+		if (infile[i].compare(0, 18, "!!timebased-nulls:") == 0) {
+			getInputNulls(infile[i], inputnulls);
+			break;
+		}
+	}
+	int nullcount = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		if (line.isData() && line.isAllNull()) {
+			nullcount++;
+			if ((nullcount >= (int)inputnulls.size()) || !inputnulls[nullcount]) {
+				continue;
+			}
+		}
+		if (line.isCommentGlobal() && isTimebaseMarker(line.c_str())) {
+			continue;
+		}
+		m_humdrum_text << line << '\n';
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::isTimebaseMarker -- Returns true if the text starts with
+//     one of the global comments added by expandScore().
+//
 
+bool Tool_timebase::isTimebaseMarker(const char* text) {
+	return (strncmp(text, "!!timebased:", 12) == 0)
+			|| (strncmp(text, "!!timebased-nulls:", 18) == 0);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_timebase::getInputNulls -- Read the "!!timebased-nulls:" marker
+//     of expandScore(), which lists the null data lines (counting only
+//     null data lines, starting at 1) which are from its input.  The
+//     output is indexed by that count.
+//
+
+void Tool_timebase::getInputNulls(const string& marker, vector<bool>& output) {
+	output.clear();
+	stringstream input(marker.substr(18));
+	int number;
+	while (input >> number) {
+		if (number < 1) {
+			continue;
+		}
+		if (number >= (int)output.size()) {
+			output.resize(number + 1, false);
+		}
+		output[number] = true;
+	}
 }
 
 
 
+//////////////////////////////
+//
+// Tool_timebase::collapseText -- Same as collapseScore(), but for Humdrum
+//     data which has not been parsed.  Lines which only contain null data
+//     tokens ("." separated by tabs) are checked, which is much faster
+//     than reading a timebased file into a HumdrumFile.  Lines may end
+//     in "\r\n", which is kept in the output.
+//
+
+void Tool_timebase::collapseText(const string& indata) {
+	vector<bool> inputnulls;
+	size_t marker = indata.rfind("!!timebased-nulls:");
+	if ((marker != string::npos) && ((marker == 0) || (indata[marker-1] == '\n'))) {
+		size_t end = indata.find('\n', marker);
+		if (end == string::npos) {
+			end = indata.size();
+		}
+		getInputNulls(indata.substr(marker, end - marker), inputnulls);
+	}
+
+	int nullcount = 0;
+	size_t start = 0;
+	while (start < indata.size()) {
+		size_t end = indata.find('\n', start);
+		if (end == string::npos) {
+			end = indata.size();
+		}
+		size_t stop = end;
+		if ((stop > start) && (indata[stop-1] == '\r')) {
+			stop--;
+		}
+		bool nullQ = (stop - start) % 2 == 1;
+		for (size_t i=start; nullQ && (i<stop); i++) {
+			nullQ = indata[i] == (((i - start) % 2) ? '\t' : '.');
+		}
+		if (nullQ) {
+			nullcount++;
+			nullQ = (nullcount >= (int)inputnulls.size()) || !inputnulls[nullcount];
+		}
+		if (!nullQ && !isTimebaseMarker(indata.c_str() + start)) {
+			m_humdrum_text.write(indata.data() + start, end - start);
+			m_humdrum_text << '\n';
+		}
+		start = end + 1;
+	}
+}
+
+
 
 ///////////////////////////////
 //
 // Tool_timebase::getMinimumTime -- Get the minimum time unit
-//    in the file.  This is the smallest non-zero line duration.
+//    in the file.  This is the largest duration which all non-zero
+//    line durations are a multiple of (the greatest common divisor
+//    of the durations), which is the smallest line duration for most
+//    files.  Mixed tuplets can make the divisor much smaller than any
+//    line, so if it would give more than TIMEBASE_MAX_EXPANSION lines
+//    for the smallest line duration, the smallest line duration is used
+//    instead (with a warning), as lines which are not a multiple of it
+//    are handled by expandScore().
 //
 
 HumNum Tool_timebase::getMinimumTime(HumdrumFile& infile) {
-	HumNum minimum(0, 1);
+	long long numerator = 0;
+	long long denominator = 1;
+	HumNum smallest = 0;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
 		HumNum duration = infile[i].getDuration();
-		if (minimum == 0) {
-			minimum = duration;
+		if (duration.getNumerator() <= 0) {
 			continue;
 		}
-		if (minimum > duration) {
-			minimum = duration;
+		if ((smallest == 0) || (duration < smallest)) {
+			smallest = duration;
+		}
+		if (denominator <= INT_MAX) {
+			numerator = std::gcd(numerator, (long long)duration.getNumerator());
+			denominator = std::lcm(denominator, (long long)duration.getDenominator());
 		}
 	}
+	if (numerator == 0) {
+		return 0;
+	}
 	// minimum is in units of quarter notes.
-	return minimum;
+	if (denominator <= INT_MAX) {
+		HumNum divisor((int)numerator, (int)denominator);
+		if (smallest / divisor <= TIMEBASE_MAX_EXPANSION) {
+			return divisor;
+		}
+	}
+	if (!m_quiet) {
+		m_humdrum_text << "!!Warning: line durations have no common timebase which is at least 1/"
+		               << TIMEBASE_MAX_EXPANSION << " of the shortest line, so using the shortest line duration"
+		               << endl;
+	}
+	return smallest;
 }
 
 
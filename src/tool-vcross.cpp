@@ -269,14 +269,14 @@ void Tool_vcross::getMidiInfo(vector<int>& midis, HTp token) {
 			return;
 		}
 	}
-	vector<string> subtokens = token->getSubtokens();
+	HumSubtokenView subtokens = token->getSubtokenView();
 	midis.resize(subtokens.size());
-	for (int i=0; i<(int)subtokens.size(); i++) {
-		if (subtokens[i].find("r") != string::npos) {
-			midis.at(i) = -1;
+	for (const HumSubtoken& subtoken : subtokens) {
+		if (subtoken.contains('r')) {
+			midis.at(subtoken.getIndex()) = -1;
 			continue;
 		}
-		midis.at(i) = Convert::kernToMidiNoteNumber(subtokens.at(i));
+		midis.at(subtoken.getIndex()) = subtoken.getMidiNoteNumber();
 	}
 }
 
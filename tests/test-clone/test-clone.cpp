@@ -0,0 +1,173 @@
+// Description: Check HumdrumFile::clone() and move semantics.  The clone
+//              must print the same as the original, keep the same
+//              analysis data, and not contain any links to tokens in the
+//              original file.  Also reports the time needed to copy the
+//              file by reparsing the text versus cloning it.
+//
+// Usage:       test-clone [-n count] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+#include <set>
+#include <utility>
+
+using namespace hum;
+
+int checkLinks(HumdrumFile& infile, HumdrumFile& original);
+int checkLink(HTp token, std::set<HTp>& owned, std::set<HTp>& foreign);
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10", "number of copies to time for each file");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] file(s)" << endl;
+		return 1;
+	}
+	int count = options.getInteger("count");
+	if (count < 1) {
+		count = 1;
+	}
+
+	int status = 0;
+	for (int i=0; i<options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i+1))) {
+			return 1;
+		}
+		infile.analyzeStrands();
+		int errors = 0;
+
+		HumdrumFile cloned = infile.clone();
+		stringstream text1;
+		stringstream text2;
+		text1 << infile;
+		text2 << cloned;
+		if (text1.str() != text2.str()) {
+			cerr << "Clone text differs" << endl;
+			errors++;
+		}
+		for (int j=0; j<infile.getLineCount(); j++) {
+			if (infile[j].getDurationFromStart() != cloned[j].getDurationFromStart()) {
+				cerr << "Clone timestamp differs on line " << j+1 << endl;
+				errors++;
+			}
+		}
+		if (infile.getStrandCount() != cloned.getStrandCount()) {
+			cerr << "Clone strand count differs" << endl;
+			errors++;
+		}
+		errors += checkLinks(cloned, infile);
+
+		HumdrumFile moved(std::move(cloned));
+		if ((cloned.getLineCount() != 0) ||
+				(moved.getLineCount() != infile.getLineCount())) {
+			cerr << "Move constructor did not transfer lines" << endl;
+			errors++;
+		}
+		if (moved[0].getOwner() != &moved) {
+			cerr << "Moved lines have the wrong owner" << endl;
+			errors++;
+		}
+		HumdrumFile assigned;
+		assigned = std::move(moved);
+		stringstream text3;
+		text3 << assigned;
+		if ((moved.getLineCount() != 0) || (text3.str() != text1.str())) {
+			cerr << "Move assignment did not transfer lines" << endl;
+			errors++;
+		}
+		errors += checkLinks(assigned, infile);
+
+		double parsetime = 0.0;
+		double clonetime = 0.0;
+		for (int j=0; j<count; j++) {
+			auto start = std::chrono::steady_clock::now();
+			HumdrumFile reparsed;
+			reparsed.readString(text1.str());
+			reparsed.analyzeStrands();
+			auto middle = std::chrono::steady_clock::now();
+			HumdrumFile copy = infile.clone();
+			auto stop = std::chrono::steady_clock::now();
+			parsetime += std::chrono::duration<double, std::milli>(middle - start).count();
+			clonetime += std::chrono::duration<double, std::milli>(stop - middle).count();
+		}
+
+		cout << options.getArg(i+1);
+		cout << "\tlines=" << infile.getLineCount();
+		cout << "\tparse-ms=" << parsetime / count;
+		cout << "\tclone-ms=" << clonetime / count;
+		cout << "\t" << (errors ? "FAIL" : "OK") << endl;
+		if (errors) {
+			status = 1;
+		}
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// checkLinks -- Return the number of token links in infile which point
+//     to tokens in the original file rather than to tokens in infile.
+//
+
+int checkLinks(HumdrumFile& infile, HumdrumFile& original) {
+	std::set<HTp> owned;
+	std::set<HTp> foreign;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			owned.insert(infile.token(i, j));
+			foreign.insert(original.token(i, j));
+		}
+	}
+	int errors = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (token->getOwner() != &infile[i]) {
+				errors++;
+			}
+			for (int k=0; k<token->getNextTokenCount(); k++) {
+				errors += checkLink(token->getNextToken(k), owned, foreign);
+			}
+			for (int k=0; k<token->getPreviousTokenCount(); k++) {
+				errors += checkLink(token->getPreviousToken(k), owned, foreign);
+			}
+			errors += checkLink(token->resolveNull(), owned, foreign);
+		}
+	}
+	for (int i=0; i<infile.getStrandCount(); i++) {
+		errors += checkLink(infile.getStrandStart(i), owned, foreign);
+		errors += checkLink(infile.getStrandEnd(i), owned, foreign);
+	}
+	for (int i=1; i<=infile.getMaxTrack(); i++) {
+		errors += checkLink(infile.getTrackStart(i), owned, foreign);
+	}
+	if (errors) {
+		cerr << "Found " << errors << " links to the original file" << endl;
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// checkLink -- Return 1 if the token belongs to the other file.
+//
+
+int checkLink(HTp token, std::set<HTp>& owned, std::set<HTp>& foreign) {
+	if (token == NULL) {
+		return 0;
+	}
+	if (owned.find(token) != owned.end()) {
+		return 0;
+	}
+	if (foreign.find(token) != foreign.end()) {
+		return 1;
+	}
+	return 0;
+}
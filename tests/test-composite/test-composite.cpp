@@ -0,0 +1,220 @@
+// Description: Test and benchmark for Tool_composite.  With no input
+//              files, the output of the tool for the files in tests/files
+//              (with a set of group, coincidence and event options) is
+//              compared with the output of the previous implementation,
+//              which is stored in tests/test-composite/expected.txt.
+//              Input files are used to benchmark the full, group and
+//              coincidence rhythm analyses (average time per run).
+//
+// Usage:       test-composite [-w] [-d dir] [-e expected.txt]
+//              test-composite [-n count] file.krn [file2.krn ...]
+//
+// The expected outputs can be recreated with the -w option from a build
+// of the previous implementation.
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+string runComposite  (const string& filename, const string& args);
+int    compareOutputs(const string& dir, const string& expectedfile, bool writeQ);
+void   benchmark     (Options& options);
+
+// Input files and options which are compared (spine manipulations other
+// than *^/*v are not supported by the tool):
+vector<string> CompareFiles = {
+	"test-global-param.krn",
+	"test-local-param.krn",
+	"test-meter-change.krn",
+	"test-null-4ths.krn",
+	"test-previous.krn",
+	"test-previous2.krn",
+	"test-rhythms.krn",
+	"test-simple-null-token.krn",
+	"test-simple-text.krn"
+};
+
+vector<string> CompareOptions = {
+	"",
+	"-c",
+	"-g",
+	"-g -e",
+	"-c -g",
+	"-g -x",
+	"-o A"
+};
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10", "number of analysis runs for each file");
+	options.define("w|write=b", "write the expected outputs");
+	options.define("d|dir=s:tests/files", "directory of the input files to compare");
+	options.define("e|expected=s:tests/test-composite/expected.txt", "expected outputs");
+	options.process(argc, argv);
+
+	if (options.getArgCount() > 0) {
+		benchmark(options);
+		return 0;
+	}
+
+	int errors = compareOutputs(options.getString("dir"),
+			options.getString("expected"), options.getBoolean("write"));
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// runComposite -- Return the output of the composite tool for a file, in
+//     the same way as the command-line interface.
+//
+
+string runComposite(const string& filename, const string& args) {
+	vector<string> argv = { "composite" };
+	HumRegex hre;
+	vector<string> words;
+	hre.split(words, args, " ");
+	for (auto& word : words) {
+		if (!word.empty()) {
+			argv.push_back(word);
+		}
+	}
+	stringstream output;
+	HumdrumFile infile;
+	if (!infile.read(filename)) {
+		output << "Cannot read " << filename << "\n";
+		return output.str();
+	}
+	Tool_composite composite;
+	composite.process(argv);
+	composite.run(infile);
+	if (composite.hasAnyText()) {
+		composite.getAllText(output);
+	} else {
+		output << infile;
+	}
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// compareOutputs -- Compare the output of each input file and option set
+//     with the expected output (each of which follows a line starting with
+//     "@@ ").  If writeQ is true, the expected outputs are written instead.
+//
+
+int compareOutputs(const string& dir, const string& expectedfile, bool writeQ) {
+	if (writeQ) {
+		ofstream output(expectedfile);
+		for (auto& file : CompareFiles) {
+			for (auto& args : CompareOptions) {
+				output << "@@ composite " << args << (args.empty() ? "" : " ") << file << "\n";
+				output << runComposite(dir + "/" + file, args);
+			}
+		}
+		return 0;
+	}
+
+	ifstream input(expectedfile);
+	if (!input.is_open()) {
+		cerr << "Cannot read " << expectedfile << endl;
+		return 1;
+	}
+	map<string, string> expected;
+	string name;
+	string line;
+	while (getline(input, line)) {
+		if (line.compare(0, 3, "@@ ") == 0) {
+			name = line.substr(3);
+			expected[name] = "";
+		} else {
+			expected[name] += line + "\n";
+		}
+	}
+
+	int errors = 0;
+	for (auto& file : CompareFiles) {
+		for (auto& args : CompareOptions) {
+			name = "composite " + args + (args.empty() ? "" : " ") + file;
+			string output = runComposite(dir + "/" + file, args);
+			if (output == expected[name]) {
+				continue;
+			}
+			stringstream a(output);
+			stringstream b(expected[name]);
+			string linea;
+			string lineb;
+			int count = 1;
+			while (getline(a, linea) && getline(b, lineb) && (linea == lineb)) {
+				count++;
+			}
+			cerr << name << ": line " << count << " differs:\n\t" << linea
+			     << "\n\texpected:\n\t" << lineb << endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// benchmark -- Time the full, group and coincidence rhythm analyses for
+//     each input file.
+//
+
+void benchmark(Options& options) {
+	int count = options.getInteger("count");
+	if (count < 1) {
+		count = 1;
+	}
+
+	for (int i=0; i<options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i+1))) {
+			return;
+		}
+		stringstream text;
+		text << infile;
+		double total = 0.0;
+		string counts;
+		for (int j=0; j<count; j++) {
+			HumdrumFile work;
+			work.readString(text.str());
+			Tool_composite composite;
+			vector<string> argv2 = { "composite", "-c", "-g", "-e", "-x" };
+			composite.process(argv2);
+			auto start = std::chrono::steady_clock::now();
+			composite.run(work);
+			auto stop = std::chrono::steady_clock::now();
+			total += std::chrono::duration<double, std::milli>(stop - start).count();
+			if (j == 0) {
+				HumRegex hre;
+				vector<string> lines;
+				hre.split(lines, composite.getAllText(), "\n");
+				for (int k=0; k<(int)lines.size(); k++) {
+					if (hre.search(lines[k], "^!!!(.*-event-count): (\\d+)")) {
+						counts += "\t" + hre.getMatch(1) + "=" + hre.getMatch(2);
+					}
+				}
+			}
+		}
+		cout << options.getArg(i+1);
+		cout << "\tlines=" << infile.getLineCount();
+		cout << "\tspines=" << infile.getMaxTrack();
+		cout << "\tms=" << total / count;
+		cout << counts << endl;
+	}
+}
+
+
+
@@ -0,0 +1,88 @@
+// Description: Benchmark imitation analysis on large (motet) scores.
+//              Runs the imitation tool on each input file with normal,
+//              inversion and retrograde searches, and reports the
+//              average time per run and the number of matches found.
+//
+// Usage:       test-imitation [-n count] [-t threshold] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10", "number of analysis runs for each file");
+	options.define("t|threshold=i:7", "minimum number of notes to match");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] [-t threshold] file(s)" << endl;
+		return 1;
+	}
+	int count = options.getInteger("count");
+	if (count < 1) {
+		count = 1;
+	}
+	string threshold = to_string(options.getInteger("threshold"));
+
+	vector<pair<string, string>> searches = {
+		{ "normal",     ""   },
+		{ "inversion",  "-v" },
+		{ "retrograde", "-g" }
+	};
+
+	for (int i=0; i<options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i+1))) {
+			return 1;
+		}
+		stringstream text;
+		text << infile;
+		cout << options.getArg(i+1);
+		cout << "\tlines=" << infile.getLineCount();
+		cout << "\tvoices=" << infile.getKernSpineStartList().size();
+		for (int s=0; s<(int)searches.size(); s++) {
+			double total = 0.0;
+			int matches = 0;
+			for (int j=0; j<count; j++) {
+				HumdrumFile work;
+				work.readString(text.str());
+				Tool_imitation imitation;
+				vector<string> argv2 = { "imitation", "-n", threshold };
+				if (!searches[s].second.empty()) {
+					argv2.push_back(searches[s].second);
+				}
+				imitation.process(argv2);
+				auto start = std::chrono::steady_clock::now();
+				imitation.run(work);
+				auto stop = std::chrono::steady_clock::now();
+				total += std::chrono::duration<double, std::milli>(stop - start).count();
+				if (j == 0) {
+					// Count the distinct enumeration labels (such as "n12")
+					// in the analysis spines:
+					set<string> labels;
+					stringstream output(imitation.getAllText());
+					string item;
+					while (output >> item) {
+						if (item.size() < 2) {
+							continue;
+						}
+						if ((item[0] != 'n') && (item[0] != 'v') && (item[0] != 'r')) {
+							continue;
+						}
+						if (!isdigit(item[1])) {
+							continue;
+						}
+						labels.insert(item.substr(0, item.find(':')));
+					}
+					matches = (int)labels.size();
+				}
+			}
+			cout << "\t" << searches[s].first << "-ms=" << total / count;
+			cout << "\t" << searches[s].first << "-matches=" << matches;
+		}
+		cout << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,460 @@
+// Description: Check and benchmark HumdrumFile::printJson().  The JSON
+//              output for each input file (or for a generated score if no
+//              files are given) is parsed to check that it is valid, that
+//              every token ID is present and that field selection removes
+//              the unselected content.  Then the time to write the file
+//              with printXml() and printJson() (indented and compact) is
+//              compared.
+//
+// Usage:       test-jsonwriter [-n count] [-m measures] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+class JsonChecker {
+	public:
+		JsonChecker(const string& text) : m_text(text) { }
+		bool   check     (void);
+		string getError  (void) { return m_error; }
+		int    getStrings(void) { return m_strings; }
+		bool   hasKey    (const string& key) { return m_keys.count(key) > 0; }
+		bool   hasString (const string& value) { return m_values.count(value) > 0; }
+
+	protected:
+		bool   value     (int depth);
+		bool   string1   (string* output);
+		void   space     (void);
+		bool   fail      (const string& message);
+
+	private:
+		const string& m_text;
+		size_t        m_pos = 0;
+		string        m_error;
+		int           m_strings = 0;
+		set<string>   m_keys;
+		set<string>   m_values;
+};
+
+void   makeScore     (stringstream& out, int measures);
+double timeOutput    (HumdrumFile& infile, const string& method, int count,
+                      size_t& bytes);
+int    checkFile     (HumdrumFile& infile, const string& name);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:5", "number of runs for each method");
+	options.define("m|measures=i:2000", "measures in the generated score");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	if (count < 1) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] [-m measures] [file.krn ...]" << endl;
+		return 1;
+	}
+
+	vector<HumdrumFile*> files;
+	vector<string> names;
+	if (options.getArgCount() == 0) {
+		stringstream score;
+		makeScore(score, options.getInteger("measures"));
+		files.push_back(new HumdrumFile);
+		files.back()->read(score);
+		names.push_back("generated");
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			files.push_back(new HumdrumFile);
+			files.back()->read(options.getArg(i));
+			names.push_back(options.getArg(i));
+		}
+	}
+
+	int errors = 0;
+	for (int i=0; i<(int)files.size(); i++) {
+		// Content analyses which create "auto" parameters:
+		files[i]->analyzeKernAccidentals();
+		files[i]->analyzeSlurs();
+		files[i]->analyzeKernTies();
+		errors += checkFile(*files[i], names[i]);
+	}
+
+	cout << "file\tlines\tmethod\tbytes\tms" << endl;
+	vector<string> methods = {"xml", "json", "json-compact"};
+	for (int i=0; i<(int)files.size(); i++) {
+		for (auto& method : methods) {
+			size_t bytes = 0;
+			double ms = timeOutput(*files[i], method, count, bytes);
+			cout << names[i] << "\t" << files[i]->getLineCount() << "\t" << method
+			     << "\t" << bytes << "\t" << ms << endl;
+		}
+	}
+
+	for (auto file : files) {
+		delete file;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkFile -- Parse the JSON output and check its contents.
+//
+
+int checkFile(HumdrumFile& infile, const string& name) {
+	int errors = 0;
+	vector<pair<string, string>> indents = {{"indented", "\t"}, {"compact", ""}};
+	for (auto& indent : indents) {
+		stringstream out;
+		infile.printJson(out, "", indent.second);
+		string text = out.str();
+		JsonChecker checker(text);
+		if (!checker.check()) {
+			cerr << name << " (" << indent.first << "): " << checker.getError() << endl;
+			errors++;
+			continue;
+		}
+		for (int i=0; i<infile.getLineCount(); i++) {
+			if (!checker.hasString(infile[i].getXmlId())) {
+				cerr << name << ": missing line ID " << infile[i].getXmlId() << endl;
+				errors++;
+				break;
+			}
+			if (!infile[i].hasSpines()) {
+				continue;
+			}
+			for (int j=0; j<infile[i].getFieldCount(); j++) {
+				HTp token = infile.token(i, j);
+				if (!checker.hasString(token->getXmlId())) {
+					cerr << name << ": missing token ID " << token->getXmlId() << endl;
+					errors++;
+					break;
+				}
+			}
+		}
+	}
+
+	// Field selection:
+	vector<pair<string, vector<string>>> tests = {
+		{"rhythm",     {"duration"}},
+		{"lines",      {"lines", "type", "text", "fieldCount"}},
+		{"tokens",     {"lines", "tokens", "track"}},
+		{"links",      {}},
+		{"strands",    {"strands"}},
+		{"parameters", {}}
+	};
+	vector<string> optional = {"duration", "barlineDuration", "strands",
+			"strand", "next", "previous", "nullResolve", "parameters", "tokens",
+			"lines", "fieldCount", "tpq"};
+	for (auto& test : tests) {
+		stringstream out;
+		infile.printJson(out, test.first, "");
+		string text = out.str();
+		JsonChecker checker(text);
+		if (!checker.check()) {
+			cerr << name << " (" << test.first << "): " << checker.getError() << endl;
+			errors++;
+			continue;
+		}
+		for (auto& key : test.second) {
+			if (!checker.hasKey(key)) {
+				cerr << name << " (" << test.first << "): missing key " << key << endl;
+				errors++;
+			}
+		}
+		for (auto& key : optional) {
+			if (!checker.hasKey(key)) {
+				continue;
+			}
+			if (find(test.second.begin(), test.second.end(), key) != test.second.end()) {
+				continue;
+			}
+			if ((key == "parameters") && (test.first == "parameters")) {
+				continue;
+			}
+			if ((key == "tpq") && (test.first == "rhythm")) {
+				continue;
+			}
+			cerr << name << " (" << test.first << "): unexpected key " << key << endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// timeOutput -- Return the average time in milliseconds to write the file.
+//
+
+double timeOutput(HumdrumFile& infile, const string& method, int count,
+		size_t& bytes) {
+	double total = 0.0;
+	for (int i=0; i<count; i++) {
+		stringstream out;
+		auto start = std::chrono::steady_clock::now();
+		if (method == "xml") {
+			infile.printXml(out);
+		} else if (method == "json") {
+			infile.printJson(out);
+		} else {
+			infile.printJson(out, "", "");
+		}
+		auto end = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(end - start).count();
+		bytes = out.str().size();
+	}
+	return total / count;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a four-part score with slurs, ties, accidentals,
+//    spine splits and layout parameters.
+//
+
+void makeScore(stringstream& out, int measures) {
+	out << "!!!COM: Generated\n";
+	out << "!!!OTL@@EN: \"Test\" score\n";
+	out << "**kern\t**kern\t**kern\t**kern\n";
+	out << "*M4/4\t*M4/4\t*M4/4\t*M4/4\n";
+	const char* pitches[4] = {"C", "g", "cc", "ee"};
+	for (int m=1; m<=measures; m++) {
+		out << "=" << m << "\t=" << m << "\t=" << m << "\t=" << m << "\n";
+		if (m % 8 == 1) {
+			out << "*^\t*\t*\t*\n";
+			out << "4" << pitches[0] << "\t4G\t4" << pitches[1] << "\t4" << pitches[2] << "#\t4" << pitches[3] << "\n";
+			out << "*v\t*v\t*\t*\t*\n";
+		} else {
+			out << "4" << pitches[0] << "\t4" << pitches[1] << "\t4" << pitches[2] << "#\t4" << pitches[3] << "\n";
+		}
+		out << "!\t!\t!LO:N:vis=2\t!\n";
+		out << "(8" << pitches[0] << "L\t[4" << pitches[1] << "\t8" << pitches[2] << "n\t2" << pitches[3] << "-\n";
+		out << "8" << pitches[0] << "J)\t.\t8" << pitches[2] << "\t.\n";
+		out << "2" << pitches[0] << "\t4" << pitches[1] << "]\t2r\t.\n";
+		out << ".\t4" << pitches[1] << "\t.\t4" << pitches[3] << "\n";
+		out << "!! comment \"" << m << "\"\n";
+	}
+	out << "==\t==\t==\t==\n";
+	out << "*-\t*-\t*-\t*-\n";
+}
+
+
+
+//////////////////////////////
+//
+// JsonChecker::check -- Parse the text as one JSON value.
+//
+
+bool JsonChecker::check(void) {
+	space();
+	if (!value(0)) {
+		return false;
+	}
+	space();
+	if (m_pos != m_text.size()) {
+		return fail("extra text after value");
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// JsonChecker::value -- Parse a value.
+//
+
+bool JsonChecker::value(int depth) {
+	if (depth > 64) {
+		return fail("nesting too deep");
+	}
+	space();
+	if (m_pos >= m_text.size()) {
+		return fail("unexpected end");
+	}
+	char ch = m_text[m_pos];
+	if (ch == '{') {
+		m_pos++;
+		space();
+		if ((m_pos < m_text.size()) && (m_text[m_pos] == '}')) {
+			m_pos++;
+			return true;
+		}
+		while (true) {
+			space();
+			string key;
+			if (!string1(&key)) {
+				return false;
+			}
+			m_keys.insert(key);
+			space();
+			if ((m_pos >= m_text.size()) || (m_text[m_pos] != ':')) {
+				return fail("expected colon");
+			}
+			m_pos++;
+			if (!value(depth + 1)) {
+				return false;
+			}
+			space();
+			if (m_pos >= m_text.size()) {
+				return fail("unterminated object");
+			}
+			if (m_text[m_pos] == ',') {
+				m_pos++;
+				continue;
+			}
+			if (m_text[m_pos] == '}') {
+				m_pos++;
+				return true;
+			}
+			return fail("expected comma or }");
+		}
+	}
+	if (ch == '[') {
+		m_pos++;
+		space();
+		if ((m_pos < m_text.size()) && (m_text[m_pos] == ']')) {
+			m_pos++;
+			return true;
+		}
+		while (true) {
+			if (!value(depth + 1)) {
+				return false;
+			}
+			space();
+			if (m_pos >= m_text.size()) {
+				return fail("unterminated array");
+			}
+			if (m_text[m_pos] == ',') {
+				m_pos++;
+				continue;
+			}
+			if (m_text[m_pos] == ']') {
+				m_pos++;
+				return true;
+			}
+			return fail("expected comma or ]");
+		}
+	}
+	if (ch == '"') {
+		string text;
+		if (!string1(&text)) {
+			return false;
+		}
+		m_values.insert(text);
+		return true;
+	}
+	if ((ch == '-') || isdigit(ch)) {
+		if (ch == '-') {
+			m_pos++;
+		}
+		if ((m_pos >= m_text.size()) || !isdigit(m_text[m_pos])) {
+			return fail("bad number");
+		}
+		if ((m_text[m_pos] == '0') && (m_pos + 1 < m_text.size()) && isdigit(m_text[m_pos+1])) {
+			return fail("leading zero");
+		}
+		while ((m_pos < m_text.size()) && isdigit(m_text[m_pos])) {
+			m_pos++;
+		}
+		return true;
+	}
+	for (const char* word : {"true", "false", "null"}) {
+		size_t len = strlen(word);
+		if (m_text.compare(m_pos, len, word) == 0) {
+			m_pos += len;
+			return true;
+		}
+	}
+	return fail("unexpected character");
+}
+
+
+
+//////////////////////////////
+//
+// JsonChecker::string1 -- Parse a string (decoding escapes).
+//
+
+bool JsonChecker::string1(string* output) {
+	if ((m_pos >= m_text.size()) || (m_text[m_pos] != '"')) {
+		return fail("expected string");
+	}
+	m_pos++;
+	m_strings++;
+	while (m_pos < m_text.size()) {
+		unsigned char ch = m_text[m_pos++];
+		if (ch == '"') {
+			return true;
+		}
+		if (ch < 0x20) {
+			return fail("control character in string");
+		}
+		if (ch != '\\') {
+			*output += ch;
+			continue;
+		}
+		if (m_pos >= m_text.size()) {
+			break;
+		}
+		ch = m_text[m_pos++];
+		switch (ch) {
+			case '"': case '\\': case '/': *output += ch; break;
+			case 'b': *output += '\b'; break;
+			case 'f': *output += '\f'; break;
+			case 'n': *output += '\n'; break;
+			case 'r': *output += '\r'; break;
+			case 't': *output += '\t'; break;
+			case 'u':
+				if ((m_pos + 4 > m_text.size()) ||
+						!isxdigit(m_text[m_pos]) || !isxdigit(m_text[m_pos+1]) ||
+						!isxdigit(m_text[m_pos+2]) || !isxdigit(m_text[m_pos+3])) {
+					return fail("bad \\u escape");
+				}
+				*output += (char)stoi(m_text.substr(m_pos, 4), NULL, 16);
+				m_pos += 4;
+				break;
+			default:
+				return fail("bad escape");
+		}
+	}
+	return fail("unterminated string");
+}
+
+
+
+//////////////////////////////
+//
+// JsonChecker::space -- Skip whitespace.
+//
+
+void JsonChecker::space(void) {
+	while ((m_pos < m_text.size()) && ((m_text[m_pos] == ' ') ||
+			(m_text[m_pos] == '\t') || (m_text[m_pos] == '\n') || (m_text[m_pos] == '\r'))) {
+		m_pos++;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// JsonChecker::fail -- Store an error message with the position.
+//
+
+bool JsonChecker::fail(const string& message) {
+	m_error = message + " at byte " + to_string(m_pos);
+	return false;
+}
+
+
+
@@ -0,0 +1,234 @@
+// Description: Check and benchmark the single-pass **kern lexer
+//              (HumKernToken).  Every **kern data token in the input
+//              files is compared with the Convert scanners that the lexer
+//              replaces (isKernRest, isKernNote, isKernSecondaryTiedNote,
+//              hasKernSlurStart, hasKernStemDirection, the elision level
+//              functions, and kernToBase40, kernToBase7 and
+//              kernToAccidentalCount for each chord note).  Then the time
+//              to answer those queries with the scanners is compared to
+//              lexing each token into a reused HumKernToken.
+//
+// Usage:       test-kernlex [-n count] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+int  checkToken (HTp token);
+int  scanTokens (std::vector<HTp>& tokens);
+int  lexTokens  (std::vector<HTp>& tokens);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10", "number of runs for each method");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	if ((options.getArgCount() < 1) || (count < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] file.krn [file2.krn ...]" << endl;
+		return 1;
+	}
+
+	vector<HumdrumFile> infiles(options.getArgCount());
+	vector<HTp> tokens;
+	for (int i=0; i<options.getArgCount(); i++) {
+		infiles[i].read(options.getArg(i+1));
+		for (int j=0; j<infiles[i].getLineCount(); j++) {
+			if (!infiles[i][j].isData()) {
+				continue;
+			}
+			for (int k=0; k<infiles[i][j].getFieldCount(); k++) {
+				HTp token = infiles[i].token(j, k);
+				if (token->isKern() && !token->isNull()) {
+					tokens.push_back(token);
+				}
+			}
+		}
+	}
+
+	int errors = 0;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		errors += checkToken(tokens[i]);
+	}
+	cout << "tokens: " << tokens.size() << "\terrors: " << errors << endl;
+
+	vector<string> methods = { "convert", "lex" };
+	for (int i=0; i<(int)methods.size(); i++) {
+		double total = 0.0;
+		for (int j=0; j<count; j++) {
+			auto start = std::chrono::steady_clock::now();
+			if (methods[i] == "convert") {
+				scanTokens(tokens);
+			} else {
+				lexTokens(tokens);
+			}
+			auto stop = std::chrono::steady_clock::now();
+			total += std::chrono::duration<double, std::milli>(stop - start).count();
+		}
+		cout << methods[i] << "\t" << (total / count) << " ms" << endl;
+	}
+
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkToken -- Compare the lexed record with the Convert scanners.
+//     Returns the number of differences.
+//
+
+int checkToken(HTp token) {
+	string text = *token;
+	HumKernToken info(*token);
+	int errors = 0;
+	auto compare = [&](const string& name, int expected, int actual) {
+		if (expected != actual) {
+			cerr << "ERROR: " << name << " of \"" << text << "\": " << actual
+			     << " instead of " << expected << endl;
+			errors++;
+		}
+	};
+
+	compare("rest", Convert::isKernRest(text), info.hasRest());
+	compare("note", Convert::isKernNote(text), info.isNote());
+	compare("secondary tie", Convert::isKernSecondaryTiedNote(text), info.isSecondaryTiedNote());
+	compare("attack", Convert::isKernNoteAttack(text), info.isNoteAttack());
+	compare("slur start", Convert::hasKernSlurStart(text), info.getSlurStartCount() > 0);
+	compare("slur end", Convert::hasKernSlurEnd(text), info.getSlurEndCount() > 0);
+	compare("phrase start", Convert::hasKernPhraseStart(text), info.getPhraseStartCount() > 0);
+	compare("phrase end", Convert::hasKernPhraseEnd(text), info.getPhraseEndCount() > 0);
+	compare("stem", Convert::hasKernStemDirection(text), info.getStemDirection());
+	for (int i=0; i<4; i++) {
+		compare("slur start elision", Convert::getKernSlurStartElisionLevel(text, i), info.getSlurStartElisionLevel(i));
+		compare("slur end elision", Convert::getKernSlurEndElisionLevel(text, i), info.getSlurEndElisionLevel(i));
+		compare("phrase start elision", Convert::getKernPhraseStartElisionLevel(text, i), info.getPhraseStartElisionLevel(i));
+		compare("phrase end elision", Convert::getKernPhraseEndElisionLevel(text, i), info.getPhraseEndElisionLevel(i));
+		compare("beam start elision", Convert::getKernBeamStartElisionLevel(text, i), info.getBeamStartElisionLevel(i));
+		compare("beam end elision", Convert::getKernBeamEndElisionLevel(text, i), info.getBeamEndElisionLevel(i));
+	}
+
+	compare("note count", token->getSubtokenCount(), info.getNoteCount());
+	for (int i=0; i<info.getNoteCount(); i++) {
+		const HumKernNote& note = info.getNote(i);
+		string subtok = token->getSubtoken(i);
+		compare("subtoken", 1, note.getText(text) == subtok);
+		for (int j=0; j<(int)subtok.size(); j++) {
+			if (subtok[j] == 'r') {
+				subtok[j] = 'R';
+			}
+		}
+		if (note.hasPitch()) {
+			compare("base40", Convert::kernToBase40(subtok), note.getBase40());
+			compare("base7", Convert::kernToBase7(subtok), note.getBase7());
+		}
+		compare("accidentals", Convert::kernToAccidentalCount(subtok), note.getAccidentalCount());
+		if (note.getRhythmDenominator() == 1) {
+			compare("duration", 1, Convert::kernToDuration(subtok) == note.getDuration());
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// scanTokens -- Query the tokens with the Convert scanners.
+//
+
+int scanTokens(vector<HTp>& tokens) {
+	int output = 0;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		const string& text = *tokens[i];
+		output += Convert::isKernRest(text);
+		output += Convert::isKernNote(text);
+		output += Convert::isKernSecondaryTiedNote(text);
+		output += Convert::hasKernStemDirection(text) ? 1 : 0;
+		int count = (int)std::count(text.begin(), text.end(), '(');
+		for (int j=0; j<count; j++) {
+			output += Convert::getKernSlurStartElisionLevel(text, j);
+		}
+		count = (int)std::count(text.begin(), text.end(), ')');
+		for (int j=0; j<count; j++) {
+			output += Convert::getKernSlurEndElisionLevel(text, j);
+		}
+		count = (int)std::count(text.begin(), text.end(), 'L');
+		for (int j=0; j<count; j++) {
+			output += Convert::getKernBeamStartElisionLevel(text, j);
+		}
+		count = (int)std::count(text.begin(), text.end(), 'J');
+		for (int j=0; j<count; j++) {
+			output += Convert::getKernBeamEndElisionLevel(text, j);
+		}
+		count = tokens[i]->getSubtokenCount();
+		for (int j=0; j<count; j++) {
+			string subtok = tokens[i]->getSubtoken(j);
+			output += Convert::kernToBase40(subtok);
+			output += Convert::kernToAccidentalCount(subtok);
+			output += subtok.find('_') != string::npos ? 1 : 0;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// queryInfo -- Answer the same queries as scanTokens() with a lexed token.
+//
+
+static int queryInfo(const HumKernToken& info) {
+	int output = 0;
+	output += info.hasRest();
+	output += info.isNote();
+	output += info.isSecondaryTiedNote();
+	output += info.getStemDirection() ? 1 : 0;
+	int count = info.getSlurStartCount();
+	for (int j=0; j<count; j++) {
+		output += info.getSlurStartElisionLevel(j);
+	}
+	count = info.getSlurEndCount();
+	for (int j=0; j<count; j++) {
+		output += info.getSlurEndElisionLevel(j);
+	}
+	count = info.getBeamStartCount();
+	for (int j=0; j<count; j++) {
+		output += info.getBeamStartElisionLevel(j);
+	}
+	count = info.getBeamEndCount();
+	for (int j=0; j<count; j++) {
+		output += info.getBeamEndElisionLevel(j);
+	}
+	for (int j=0; j<info.getNoteCount(); j++) {
+		const HumKernNote& note = info.getNote(j);
+		output += note.getBase40();
+		output += note.getAccidentalCount();
+		output += note.isTieContinue() ? 1 : 0;
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// lexTokens -- Lex each token and query the record.
+//
+
+int lexTokens(vector<HTp>& tokens) {
+	int output = 0;
+	HumKernToken info;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		info.lex(*tokens[i]);
+		output += queryInfo(info);
+	}
+	return output;
+}
+
+
+
@@ -0,0 +1,168 @@
+// Description: Benchmark for parallel part parsing in Tool_musicxml2hum.
+//              Each input MusicXML file (or a generated ensemble score if
+//              no files are given) is converted with one thread and then
+//              with several threads (-j option of musicxml2hum).  The
+//              outputs must be identical; conversion times are reported.
+//
+// Usage:       test-mxmlthreads [-j threads] [-n count] [-p parts] [-m measures] [file.xml ...]
+
+#include "humlib.h"
+
+#include <chrono>
+#include <fstream>
+
+using namespace std;
+using namespace hum;
+
+void   makeScore    (stringstream& out, int parts, int measures);
+double timeConvert  (const string& data, int threads, int count, string& output);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("j|threads=i:8", "number of threads for parallel conversion");
+	options.define("n|count=i:5", "number of conversions for timing");
+	options.define("p|parts=i:48", "parts in the generated score");
+	options.define("m|measures=i:200", "measures in the generated score");
+	options.process(argc, argv);
+	int threads = options.getInteger("threads");
+	int count = options.getInteger("count");
+	if ((threads < 1) || (count < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-j threads] [-n count] [-p parts] [-m measures] [file.xml ...]" << endl;
+		return 1;
+	}
+
+	vector<string> names;
+	vector<string> inputs;
+	if (options.getArgCount() == 0) {
+		stringstream score;
+		makeScore(score, options.getInteger("parts"), options.getInteger("measures"));
+		names.push_back("generated-" + to_string(options.getInteger("parts")) + "-parts");
+		inputs.push_back(score.str());
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			ifstream input(options.getArg(i));
+			if (!input.is_open()) {
+				cerr << "Cannot read " << options.getArg(i) << endl;
+				return 1;
+			}
+			names.push_back(options.getArg(i));
+			inputs.emplace_back(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+		}
+	}
+
+	int errors = 0;
+	for (int i=0; i<(int)inputs.size(); i++) {
+		string serial;
+		string parallel;
+		double ms1 = timeConvert(inputs[i], 1, count, serial);
+		double ms2 = timeConvert(inputs[i], threads, count, parallel);
+		if (serial != parallel) {
+			cerr << names[i] << ": output with " << threads
+			     << " threads differs from single-threaded output" << endl;
+			errors++;
+		}
+		cout << names[i] << "\tbytes " << inputs[i].size() << endl;
+		cout << "\t1 thread:\t" << ms1 << " ms" << endl;
+		cout << "\t" << threads << " threads:\t" << ms2 << " ms" << endl;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// timeConvert -- Return the average conversion time in milliseconds.
+//
+
+double timeConvert(const string& data, int threads, int count, string& output) {
+	double total = 0.0;
+	for (int i=0; i<count; i++) {
+		Tool_musicxml2hum converter;
+		converter.process({"musicxml2hum", "-j", to_string(threads)});
+		stringstream out;
+		auto start = std::chrono::steady_clock::now();
+		converter.convert(out, data.c_str());
+		auto end = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(end - start).count();
+		output = out.str();
+	}
+	return total / count;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate an ensemble score in MusicXML.  Every part has
+//    the same meter, with a different rhythm, chords, two voices,
+//    lyrics, dynamics and hairpins depending on the part number.
+//
+
+void makeScore(stringstream& out, int parts, int measures) {
+	const char* steps = "CDEFGAB";
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	out << "<score-partwise version=\"3.1\">\n<part-list>\n";
+	for (int p=1; p<=parts; p++) {
+		out << "<score-part id=\"P" << p << "\"><part-name>Part " << p
+		    << "</part-name></score-part>\n";
+	}
+	out << "</part-list>\n";
+	for (int p=1; p<=parts; p++) {
+		out << "<part id=\"P" << p << "\">\n";
+		for (int m=1; m<=measures; m++) {
+			out << "<measure number=\"" << m << "\">\n";
+			if (m == 1) {
+				out << "<attributes><divisions>4</divisions><key><fifths>0</fifths></key>";
+				out << "<time><beats>4</beats><beat-type>4</beat-type></time>";
+				out << "<clef><sign>G</sign><line>2</line></clef></attributes>\n";
+			}
+			if (m % 4 == 1) {
+				out << "<direction placement=\"below\"><direction-type><dynamics><"
+				    << ((m + p) % 2 ? "p" : "f") << "/></dynamics></direction-type></direction>\n";
+				out << "<direction placement=\"below\"><direction-type><wedge type=\"crescendo\"/>"
+				    << "</direction-type></direction>\n";
+			}
+			// voice 1: eighth notes or quarter notes depending on the part
+			int step = (p + m) % 7;
+			int notes = (p % 2) ? 8 : 4;
+			int dur = 16 / notes;
+			for (int n=0; n<notes; n++) {
+				out << "<note><pitch><step>" << steps[(step + n) % 7] << "</step><octave>"
+				    << 4 + (step + n) / 7 << "</octave></pitch><duration>" << dur
+				    << "</duration><voice>1</voice><type>" << (dur == 2 ? "eighth" : "quarter")
+				    << "</type>";
+				if (n == 0) {
+					out << "<lyric number=\"1\"><syllabic>single</syllabic><text>la"
+					    << m << "</text></lyric>";
+				}
+				out << "</note>\n";
+				if ((p % 3 == 0) && (n % 2 == 0)) {
+					out << "<note><chord/><pitch><step>" << steps[(step + n + 2) % 7]
+					    << "</step><octave>4</octave></pitch><duration>" << dur
+					    << "</duration><voice>1</voice><type>" << (dur == 2 ? "eighth" : "quarter")
+					    << "</type></note>\n";
+				}
+			}
+			if (m % 4 == 1) {
+				out << "<direction placement=\"below\"><direction-type><wedge type=\"stop\"/>"
+				    << "</direction-type></direction>\n";
+			}
+			// voice 2 in every fourth part:
+			if (p % 4 == 0) {
+				out << "<backup><duration>16</duration></backup>\n";
+				out << "<note><pitch><step>" << steps[step] << "</step><octave>3</octave></pitch>"
+				    << "<duration>8</duration><voice>2</voice><type>half</type></note>\n";
+				out << "<note><rest/><duration>8</duration><voice>2</voice><type>half</type></note>\n";
+			}
+			out << "</measure>\n";
+		}
+		out << "</part>\n";
+	}
+	out << "</score-partwise>\n";
+}
+
+
+
@@ -0,0 +1,198 @@
+// Description: Test and benchmark for Options.  A set of command lines is
+//              parsed with a fixed set of option definitions, and the
+//              option values and arguments are compared with the results
+//              of the original Options implementation, and options
+//              are defined past the limit of shared schemas.  Then the time to
+//              construct tools (which define their options) and to process
+//              a command line with them is measured.
+//
+// Usage:       test-options [-n count]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+string parseCommandLine (const vector<string>& argv);
+int    checkDefinitions (void);
+
+template <class TOOL>
+double timeTool(const vector<string>& argv, int count) {
+	int errors = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		TOOL tool;
+		if (!tool.process(argv)) {
+			errors++;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	if (errors) {
+		cerr << argv[0] << ": " << errors << " option errors" << endl;
+	}
+	return std::chrono::duration<double, std::micro>(end - start).count() / count;
+}
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10000", "number of tool instances for timing");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+
+	// Command lines and the values parsed by the original implementation
+	// (option values are printed in definition order, then the arguments):
+	vector<pair<vector<string>, string>> tests = {
+		{{"cmd"},
+			"a=0 b=0 n=3 s=abc d=1.5 c=x l= | "},
+		{{"cmd", "-a", "-n", "5", "file.krn"},
+			"a=1 b=0 n=5 s=abc d=1.5 c=x l= | file.krn "},
+		{{"cmd", "-ab", "-n5", "x", "y"},
+			"a=1 b=1 n=5 s=abc d=1.5 c=x l= | x y "},
+		{{"cmd", "--number=7", "--string", "xyz", "--all", "z"},
+			"a=1 b=0 n=7 s=xyz d=1.5 c=x l= | z "},
+		{{"cmd", "-an", "9", "-d", "0.25"},
+			"a=1 b=0 n=9 s=abc d=0.25 c=x l= | "},
+		{{"cmd", "-bas", "text", "--long-name", "value", "-c", "q"},
+			"a=1 b=1 n=3 s=text d=1.5 c=q l=value | "},
+		{{"cmd", "-n", "0x10", "--double=-2e3", "-", "file"},
+			"a=0 b=0 n=16 s=abc d=-2000 c=x l= | file "},
+		{{"cmd", "file1", "-a", "file2", "--string=a b"},
+			"a=1 b=0 n=3 s=a b d=1.5 c=x l= | file1 file2 "},
+		{{"cmd", "--all", "--bee", "--char", "zz", "-s="},
+			"a=1 b=1 n=3 s== d=1.5 c=z l= | "}
+	};
+
+	int errors = checkDefinitions();
+	for (auto& test : tests) {
+		string output = parseCommandLine(test.first);
+		if (output != test.second) {
+			cerr << "Command line";
+			for (auto& arg : test.first) {
+				cerr << " " << arg;
+			}
+			cerr << "\n\tparsed as: " << output << "\n\texpected:  " << test.second << endl;
+			errors++;
+		}
+	}
+
+	// Tool construction and option processing:
+	vector<pair<string, double>> times = {
+		{ "autobeam",  timeTool<Tool_autobeam>({"autobeam", "-l"}, count)                    },
+		{ "composite", timeTool<Tool_composite>({"composite", "-a", "--grace"}, count)       },
+		{ "extract",   timeTool<Tool_extract>({"extract", "-i", "**kern"}, count)            },
+		{ "msearch",   timeTool<Tool_msearch>({"msearch", "-p", "cde", "-t", "gloria"}, count) },
+		{ "transpose", timeTool<Tool_transpose>({"transpose", "-b", "-3"}, count)            },
+		{ "filter",    timeTool<Tool_filter>({"filter", "-v", "x"}, count)                   }
+	};
+	cout << "tool construction and option processing (" << count << " instances):" << endl;
+	for (auto& item : times) {
+		cout << "\t" << item.first << ":\t" << item.second << " us" << endl;
+	}
+
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// parseCommandLine -- Parse a command line and print the option values
+//     and arguments.
+//
+
+string parseCommandLine(const vector<string>& argv) {
+	Options options;
+	options.define("a|all=b",             "boolean a");
+	options.define("b|bee=b",             "boolean b");
+	options.define("n|number=i:3",        "an integer");
+	options.define("s|str|string=s:abc",  "a string");
+	options.define("d|double=d:1.5",      "a double");
+	options.define("c|char=c:x",          "a character");
+	options.define("long-name=s",         "a long option name");
+	options.process(argv);
+
+	stringstream output;
+	output << "a=" << options.getBoolean("all");
+	output << " b=" << options.getBoolean("b");
+	output << " n=" << options.getInteger("number");
+	output << " s=" << options.getString("str");
+	output << " d=" << options.getDouble("d");
+	output << " c=" << options.getChar("char");
+	output << " l=" << options.getString("long-name");
+	output << " | ";
+	for (int i=1; i<=options.getArgCount(); i++) {
+		output << options.getArg(i) << " ";
+	}
+	if (options.hasParseError()) {
+		output << "error: " << options.getParseError();
+	}
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// checkDefinitions -- Check the errors for invalid option definitions,
+//     and the values of options in copies of an Options object.
+//
+
+int checkDefinitions(void) {
+	int errors = 0;
+	Options options;
+	options.define("a|all=b", "boolean a");
+	if (options.define("missing-type") >= 0) {
+		errors++;
+	}
+	if (options.define("x=q") >= 0) {
+		errors++;
+	}
+	if (options.define("all|again=b") >= 0) {
+		errors++;
+	}
+	string expected = "Error: no \"=\" in option definition: missing-type\n"
+		"Error: unknown option type 'q' in defintion: x=q\n"
+		"Option \"all\" from definition:\n"
+		"\tall|again=b\n"
+		"is already defined in: \n"
+		"\ta|all=b\n";
+	if (options.getParseError() != expected) {
+		cerr << "Definition errors:\n" << options.getParseError()
+		     << "expected:\n" << expected;
+		errors++;
+	}
+
+	Options first;
+	first.define("v|value=i:1");
+	first.define("q|quiet=b");
+	first.process(vector<string>{"cmd", "-v", "4", "-q"});
+	Options second = first;
+	second.process(vector<string>{"cmd", "-v", "5"});
+	if ((first.getInteger("value") != 4) || !first.getBoolean("quiet") ||
+			(second.getInteger("v") != 5) || !second.getBoolean("q")) {
+		cerr << "Copied options have the wrong values" << endl;
+		errors++;
+	}
+
+	// Options which are defined from data are still parsed after the
+	// number of stored schemas reaches OPTION_MAX_SCHEMAS:
+	for (int i=0; i<OPTION_MAX_SCHEMAS + 100; i++) {
+		Options generated;
+		string name = "option" + to_string(i);
+		generated.define(name + "=i:" + to_string(i));
+		generated.process(vector<string>{"cmd"});
+		if (generated.getInteger(name) != i) {
+			cerr << "Generated option " << name << " has the wrong value" << endl;
+			errors++;
+			break;
+		}
+	}
+	return errors;
+}
+
+
+
@@ -0,0 +1,71 @@
+// Description: Benchmark writing PixelImage rasters.  A hue gradient
+//              image is written as ASCII text one PixelColor at a time
+//              (the way image tools wrote P3 images before PixelImage),
+//              and with PixelImage as P3, P6 and PNG.  The average time
+//              and output size are reported for each format.
+//
+// Usage:       test-pixelimage [-c columns] [-r rows] [-v repeat] [-n count]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("c|columns=i:3000", "number of columns in image");
+	options.define("r|rows=i:1500", "number of distinct rows in image");
+	options.define("v|vertical-repeat=i:1", "number of times each row is repeated");
+	options.define("n|count=i:3", "number of runs for each format");
+	options.process(argc, argv);
+	int cols = options.getInteger("columns");
+	int rows = options.getInteger("rows");
+	int repeat = options.getInteger("vertical-repeat");
+	int count = options.getInteger("count");
+	if ((cols < 1) || (rows < 1) || (repeat < 1) || (count < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-c columns] [-r rows] [-v repeat] [-n count]" << endl;
+		return 1;
+	}
+
+	vector<vector<PixelColor>> pixels(rows);
+	PixelImage image;
+	for (int y=0; y<rows; y++) {
+		pixels[y].resize(cols);
+		for (int x=0; x<cols; x++) {
+			pixels[y][x].setHue((double)(x + y) / (cols + rows));
+		}
+		image.addRow(pixels[y], 1, repeat);
+	}
+
+	cout << "image: " << image.getWidth() << "x" << image.getHeight() << endl;
+
+	vector<string> formats = { "pixel", "p3", "p6", "png" };
+	for (int i=0; i<(int)formats.size(); i++) {
+		double total = 0.0;
+		size_t size = 0;
+		for (int j=0; j<count; j++) {
+			stringstream out;
+			auto start = std::chrono::steady_clock::now();
+			if (formats[i] == "pixel") {
+				out << "P3\n" << cols << " " << rows * repeat << "\n255\n";
+				for (int y=0; y<rows; y++) {
+					for (int k=0; k<repeat; k++) {
+						for (int x=0; x<cols; x++) {
+							out << pixels[y][x] << ' ';
+						}
+						out << "\n";
+					}
+				}
+			} else {
+				image.write(out, formats[i]);
+			}
+			auto stop = std::chrono::steady_clock::now();
+			total += std::chrono::duration<double, std::milli>(stop - start).count();
+			size = out.str().size();
+		}
+		cout << formats[i] << "\t" << (total / count) << " ms\t" << size << " bytes" << endl;
+	}
+
+	return 0;
+}
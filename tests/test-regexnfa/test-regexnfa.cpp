@@ -0,0 +1,369 @@
+// Description: Check and benchmark the linear-time regular expression
+//              matcher (HumRegexNfa) used by HumRegex.  Searches, full
+//              matches and replacements for a list of expressions from
+//              the library and tools and for randomly generated expressions
+//              are compared with std::regex (submatch positions included).
+//              Then the time to search the tokens of the input files with
+//              std::regex (compiled for each search, as HumRegex did
+//              previously, and compiled once) is compared to HumRegexNfa,
+//              and a long global comment line is searched with both.
+//
+// Usage:       test-regexnfa [-n count] [-r patterns] [-l length] [-s] [file.krn ...]
+//              -s: also search the long line with std::regex (this can
+//                  overflow the stack).
+
+#include "humlib.h"
+
+#include <chrono>
+#include <random>
+
+using namespace hum;
+
+int  checkExpression (const string& exp, bool icase, const vector<string>& inputs,
+                      int& supported);
+string randomExpression(std::mt19937& generator, int depth);
+string randomInput   (std::mt19937& generator);
+double timeSearches  (const string& method, const vector<string>& exps,
+                      const vector<string>& inputs, int count);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:3", "number of runs for each method");
+	options.define("r|random=i:20000", "number of random expressions to check");
+	options.define("l|length=i:200000", "length of the long line");
+	options.define("s|std-long=b", "search the long line with std::regex");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	if (count < 1) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] [-r patterns] [-l length] [-s] [file.krn ...]" << endl;
+		return 1;
+	}
+
+	// Expressions of the kind used in the library and tools:
+	vector<string> expressions = {
+		"^\\*\\*kern$", "^\\*\\*", "^\\*M(\\d+)/(\\d+)", "^\\*([A-Ga-g][#-]*):(.*)$",
+		"^!!!([^:]+)\\s*:\\s*(.*)\\s*$", "^!!!?([^!:][^:]*):(.*)$", "^\\*I\"(.*)",
+		"([a-gA-G]+)([#n-]*)", "(\\d+)(%(\\d+))?(\\.*)", "^(\\d+)\\.*$", "[LJkK]+",
+		"([\\[\\]_])", "\\(+", "[;<>]", "q+", "^=(\\d+)?", "^=+$", "(\\d+)/(\\d+)",
+		"^\\*>(.*)", "\\*\\*\\w+", "^\\s+|\\s+$", "\\s+", "[^\\s]+", "^\\*[^*]",
+		"^([A-Z]+)(\\d+)$", "^\\*(\\d+)\\*?$", "ab|a", "a*?b", "(a+)+b", "(x+x+)+y",
+		"(a|ab)(c|bcd)(d*)", "(?:(a)|b)+", "(a)|b", "\\bfoo\\b", "\\Bo", "colou?r",
+		"x{2,3}?", "[a-c]{2}", "[-a]", "[a-]", "[\\]]", "[\\-]", "a\\.b", "\\x41",
+		"[^\\d\\s]+", "a]", "a}", "", "^", "$", "^$", "a|", "|a", "(|a)b", "(a)(b)?",
+		"([a-z]+)@([a-z]+)\\.com", "\\t", "[\\t ]+", "(\\d{1,3})(?:,(\\d{3}))*",
+		"(\\d+)([a-z])?r", "^(.*?)(\\s*)$", "<[^>]*>", "\\\\", "\\/", "\\-", "\\$",
+		// unsupported expressions (std::regex is used for these):
+		"(a)\\1", "(?=a)a", "[[:alpha:]]+", "(a*)*", "(a*)+b", "(a?)*", "\\cA",
+		"\\u0041", "\\k", "[]a]", "a**", "\\0",
+		// invalid expressions:
+		"a{", "(a", "a)", "[a", "*a", "a{3,2}", "[b-a]", "[\\d-z]", "a|*"
+	};
+	vector<string> inputs = {
+		"", "a", "b", "ab", "abab", "aab", "aaab", "abcd", "abc", "xxxy", "xxxxxxxxx",
+		"**kern", "**kern2", "*M3/4", "*M12/8", "*C:", "*f#:dor", "!!!COM: Bach, Johann Sebastian",
+		"!!!OTL@@DE: Title", "*I\"Violin", "4c#L", "8.ddd-J", "[4AA", "16ee-]", "(4g;",
+		"4r", "=12", "==", "=", "*>A", "*>[A,A,B]", "  trim me  ", "foo bar_foo", "fo",
+		"color", "colour", "xxxxx", "a-b", "a]b", "a}", "a.b", "axb", "ABC", "aBc",
+		"9, 10,000,000", "12r", "x3", "<a href>text</a>", "\\", "/", "$5", "\t x",
+		"a\nb", "a\rb", "caf\xc3\xa9", "user@example.com"
+	};
+
+	int errors = 0;
+	int supported = 0;
+	for (int i=0; i<(int)expressions.size(); i++) {
+		errors += checkExpression(expressions[i], false, inputs, supported);
+		errors += checkExpression(expressions[i], true, inputs, supported);
+	}
+	cout << "expressions: " << 2 * expressions.size() << "\tsupported: " << supported
+	     << "\terrors: " << errors << endl;
+
+	std::mt19937 generator(1);
+	int randomcount = options.getInteger("random");
+	int randomsupported = 0;
+	int randomerrors = 0;
+	for (int i=0; i<randomcount; i++) {
+		string exp = randomExpression(generator, 0);
+		vector<string> randominputs;
+		for (int j=0; j<8; j++) {
+			randominputs.push_back(randomInput(generator));
+		}
+		randomerrors += checkExpression(exp, i % 4 == 0, randominputs, randomsupported);
+	}
+	errors += randomerrors;
+	cout << "random: " << randomcount << "\tsupported: " << randomsupported
+	     << "\terrors: " << randomerrors << endl;
+
+	// Throughput on the tokens of the input files:
+	vector<string> tokens;
+	for (int i=0; i<options.getArgCount(); i++) {
+		HumdrumFile infile;
+		infile.read(options.getArg(i+1));
+		for (int j=0; j<infile.getLineCount(); j++) {
+			for (int k=0; k<infile[j].getFieldCount(); k++) {
+				tokens.push_back(*infile.token(j, k));
+			}
+		}
+	}
+	if (tokens.empty()) {
+		tokens = inputs;
+	}
+	vector<string> benchmark = { "^\\*M(\\d+)/(\\d+)", "(\\d+)(%(\\d+))?(\\.*)",
+		"([a-gA-G]+)([#n-]*)", "^!!!([^:]+)\\s*:\\s*(.*)\\s*$", "q+", "[LJkK]+" };
+	cout << "tokens: " << tokens.size() << "\texpressions: " << benchmark.size() << endl;
+	vector<string> methods = { "std::regex", "std::regex/compiled", "HumRegexNfa", "HumRegex" };
+	for (int i=0; i<(int)methods.size(); i++) {
+		cout << methods[i] << "\t" << timeSearches(methods[i], benchmark, tokens, count)
+		     << " ms" << endl;
+	}
+
+	// Long global comment line:
+	string line = "!!";
+	int length = options.getInteger("length");
+	while ((int)line.size() < length) {
+		line += "4c 8d 8e ";
+	}
+	vector<string> longexps = { "^!!(.*)$", "^!!\\s*(?:[a-g0-9]+\\s*)*$", "(e|f)+z" };
+	for (int i=0; i<(int)longexps.size(); i++) {
+		HumRegex hre;
+		auto start = std::chrono::steady_clock::now();
+		int result = hre.search(line, longexps[i]);
+		auto stop = std::chrono::steady_clock::now();
+		cout << "long " << longexps[i] << "\tHumRegex\t" << result << "\t"
+		     << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << endl;
+		if (options.getBoolean("std-long")) {
+			start = std::chrono::steady_clock::now();
+			std::smatch matches;
+			result = std::regex_search(line, matches, std::regex(longexps[i]));
+			stop = std::chrono::steady_clock::now();
+			cout << "long " << longexps[i] << "\tstd::regex\t" << result << "\t"
+			     << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << endl;
+		}
+	}
+
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkExpression -- Compare HumRegexNfa and HumRegex with std::regex
+//     for an expression on each input.  Returns the number of differences.
+//
+
+int checkExpression(const string& exp, bool icase, const vector<string>& inputs,
+		int& supported) {
+	auto flags = std::regex_constants::ECMAScript;
+	if (icase) {
+		flags |= std::regex_constants::icase;
+	}
+	string name = "\"" + exp + "\"" + (icase ? "i" : "");
+	std::regex re;
+	bool validQ = true;
+	try {
+		re = std::regex(exp, flags);
+	} catch (std::regex_error& error) {
+		validQ = false;
+	}
+	HumRegexNfa nfa(exp, icase);
+	if (!nfa.isValid()) {
+		return 0;
+	}
+	supported++;
+	if (!validQ) {
+		cerr << "ERROR: " << name << " is invalid for std::regex" << endl;
+		return 1;
+	}
+	int errors = 0;
+	if (nfa.getGroupCount() != (int)re.mark_count()) {
+		cerr << "ERROR: " << name << " has " << nfa.getGroupCount() << " groups instead of "
+		     << re.mark_count() << endl;
+		return 1;
+	}
+
+	HumRegex hre;
+	string options = icase ? "i" : "";
+	for (int i=0; i<(int)inputs.size(); i++) {
+		const string& input = inputs[i];
+		string where = name + " on \"" + input + "\"";
+
+		// searches starting at each position:
+		for (int start=0; start<=(int)input.size(); start++) {
+			std::smatch matches;
+			bool expected = std::regex_search(input.cbegin() + start, input.cend(), matches, re);
+			vector<int> captures;
+			bool actual = nfa.search(input, start, start, captures);
+			if (expected != actual) {
+				cerr << "ERROR: search " << where << " from " << start << ": "
+				     << actual << " instead of " << expected << endl;
+				errors++;
+				continue;
+			}
+			if (!expected) {
+				continue;
+			}
+			for (int j=0; j<(int)matches.size(); j++) {
+				int s = matches[j].matched ? start + (int)matches.position(j) : -1;
+				int e = matches[j].matched ? s + (int)matches.length(j) : -1;
+				if ((captures[2*j] != s) || (captures[2*j+1] != e)) {
+					cerr << "ERROR: search " << where << " from " << start << ": group " << j
+					     << " is [" << captures[2*j] << "," << captures[2*j+1]
+					     << ") instead of [" << s << "," << e << ")" << endl;
+					errors++;
+				}
+			}
+			if (start == 0) {
+				hre.search(input, exp, options);
+				if ((hre.getMatchCount() != (int)matches.size())
+						|| (hre.getPrefix() != matches.prefix().str())
+						|| (hre.getSuffix() != matches.suffix().str())) {
+					cerr << "ERROR: HumRegex search " << where << endl;
+					errors++;
+				}
+				for (int j=0; j<(int)matches.size(); j++) {
+					if ((hre.getMatch(j) != matches.str(j))
+							|| (hre.getMatchStartIndex(j) != (int)matches.position(j))
+							|| (hre.getMatchLength(j) != (int)matches.length(j))) {
+						cerr << "ERROR: HumRegex group " << j << " of " << where << endl;
+						errors++;
+					}
+				}
+			}
+		}
+
+		// full match:
+		if (nfa.match(input) != std::regex_match(input, re)) {
+			cerr << "ERROR: match " << where << ": " << nfa.match(input) << endl;
+			errors++;
+		}
+
+		// replacements:
+		string format = "<$&|$1|$`|$'|$$|$9>";
+		string expected = std::regex_replace(input, re, format);
+		string actual = hre.replaceCopy(input, format, exp + "");
+		if (!icase && (actual != expected)) {
+			cerr << "ERROR: replace " << where << ": \"" << actual << "\" instead of \""
+			     << expected << "\"" << endl;
+			errors++;
+		}
+		expected = std::regex_replace(input, re, format, std::regex_constants::format_first_only);
+		string copy = input;
+		hre.replaceDestructive(copy, format, exp, options);
+		if (copy != expected) {
+			cerr << "ERROR: replace first " << where << ": \"" << copy << "\" instead of \""
+			     << expected << "\"" << endl;
+			errors++;
+		}
+		expected = std::regex_replace(input, re, format);
+		copy = input;
+		hre.replaceDestructive(copy, format, exp, options + "g");
+		if (copy != expected) {
+			cerr << "ERROR: replace all " << where << ": \"" << copy << "\" instead of \""
+			     << expected << "\"" << endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// randomExpression -- Generate an expression from a small alphabet.
+//
+
+string randomExpression(std::mt19937& generator, int depth) {
+	static const vector<string> atoms = { "a", "b", "c", "A", ".", "[ab]", "[^a]",
+		"[a-c]", "\\d", "\\w", "\\s", "\\W", " ", "-", "1", "^", "$", "\\b", "\\B" };
+	static const vector<string> quantifiers = { "*", "+", "?", "{2}", "{1,2}", "{0,}",
+		"*?", "+?", "??", "{1,3}?" };
+	int terms = 1 + generator() % 4;
+	string output;
+	for (int i=0; i<terms; i++) {
+		int choice = generator() % 10;
+		if ((depth < 3) && (choice == 0)) {
+			output += "(" + randomExpression(generator, depth + 1) + ")";
+		} else if ((depth < 3) && (choice == 1)) {
+			output += "(?:" + randomExpression(generator, depth + 1) + ")";
+		} else if ((depth < 3) && (choice == 2)) {
+			output += randomExpression(generator, depth + 1) + "|"
+					+ randomExpression(generator, depth + 1);
+		} else {
+			output += atoms[generator() % atoms.size()];
+		}
+		if (generator() % 3 == 0) {
+			output += quantifiers[generator() % quantifiers.size()];
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// randomInput -- Generate a short input string.
+//
+
+string randomInput(std::mt19937& generator) {
+	static const string characters = "aabbcA1 -_\n";
+	int length = generator() % 12;
+	string output;
+	for (int i=0; i<length; i++) {
+		output += characters[generator() % characters.size()];
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// timeSearches -- Average time in milliseconds to search all inputs
+//     for each expression.
+//
+
+double timeSearches(const string& method, const vector<string>& exps,
+		const vector<string>& inputs, int count) {
+	double total = 0.0;
+	int found = 0;
+	for (int n=0; n<count; n++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i=0; i<(int)exps.size(); i++) {
+			if (method == "std::regex") {
+				for (int j=0; j<(int)inputs.size(); j++) {
+					std::smatch matches;
+					found += std::regex_search(inputs[j], matches, std::regex(exps[i]));
+				}
+			} else if (method == "std::regex/compiled") {
+				std::regex re(exps[i]);
+				for (int j=0; j<(int)inputs.size(); j++) {
+					std::smatch matches;
+					found += std::regex_search(inputs[j], matches, re);
+				}
+			} else if (method == "HumRegexNfa") {
+				HumRegexNfa nfa(exps[i]);
+				vector<int> captures;
+				for (int j=0; j<(int)inputs.size(); j++) {
+					found += nfa.search(inputs[j], 0, 0, captures);
+				}
+			} else {
+				HumRegex hre;
+				for (int j=0; j<(int)inputs.size(); j++) {
+					found += hre.search(inputs[j], exps[i]) ? 1 : 0;
+				}
+			}
+		}
+		auto stop = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+	if (found < 0) {
+		cerr << found << endl;
+	}
+	return total / count;
+}
+
+
+
@@ -0,0 +1,433 @@
+// Description: Compare the line-sweep assignment of line start times
+//              (HumdrumFileStructure::assignDurationsFromStart) with the
+//              previous per-spine recursive assignment (kept below as
+//              RhythmFile::oldAssignDurations) for each input file
+//              (concatenated files allowed) or for a generated score with
+//              nested spine splits, then time both.
+//
+// Usage:       test-rhythmsweep [-n count] [-m measures] [-d depth] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+class RhythmFile : public HumdrumFile {
+	public:
+		bool sweep(void) {
+			clearTimes();
+			return assignDurationsFromStart();
+		}
+		bool byTrack(void) {
+			clearTimes();
+			return oldAssignDurations();
+		}
+		void clearTimes(void) {
+			m_parseError.clear();
+			m_visits.resize(getLineCount());
+			for (int i=0; i<getLineCount(); i++) {
+				m_lines[i]->setDurationFromStart(-1);
+				m_visits[i].assign(m_lines[i]->getFieldCount(), 0);
+			}
+		}
+		void getTimes(vector<HumNum>& times) {
+			times.resize(getLineCount());
+			for (int i=0; i<getLineCount(); i++) {
+				times[i] = m_lines[i]->getDurationFromStart();
+			}
+		}
+
+	protected:
+		bool oldAssignDurations        (void);
+		bool oldAssignDurationsToTrack (HTp starttoken, HumNum startdur);
+		bool oldPrepareDurations       (HTp token, int state, HumNum startdur);
+		bool oldRhythmOfFloatingSpine  (HTp spinestart);
+		int& visits                    (HTp token) {
+			return m_visits[token->getLineIndex()][token->getFieldIndex()];
+		}
+
+	private:
+		// Visit counts of tokens (HumdrumToken::getState() is protected
+		// to the library):
+		vector<vector<int>> m_visits;
+};
+
+void   makeScore   (stringstream& out, int measures, int depth);
+double timeMethod  (RhythmFile& infile, bool sweepQ, int count);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:20", "number of runs for each method");
+	options.define("m|measures=i:500", "measures in the generated score");
+	options.define("d|depth=i:3", "spine split depth in the generated score");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	if (count < 1) {
+		cerr << "Usage: " << options.getCommand() << " [-n count] [-m measures] [-d depth] [file.krn ...]" << endl;
+		return 1;
+	}
+
+	vector<RhythmFile*> files;
+	vector<string> names;
+	if (options.getArgCount() == 0) {
+		vector<int> depths = {0, options.getInteger("depth")};
+		for (int depth : depths) {
+			stringstream score;
+			makeScore(score, options.getInteger("measures"), depth);
+			files.push_back(new RhythmFile);
+			files.back()->read(score);
+			names.push_back("generated-depth" + to_string(depth));
+		}
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			vector<string> filelist(1, options.getArg(i));
+			HumdrumFileStream instream(filelist);
+			while (true) {
+				RhythmFile* infile = new RhythmFile;
+				if (!instream.read(*infile)) {
+					delete infile;
+					break;
+				}
+				if (infile->getMaxTrack() == 0) {
+					delete infile;
+					continue;
+				}
+				// Run the (possibly deferred) rhythm analysis now so that it
+				// does not overwrite the times being compared later:
+				infile->analyzeRhythmStructure();
+				names.push_back(options.getArg(i) + ":" + to_string(files.size()));
+				files.push_back(infile);
+			}
+		}
+	}
+
+	int errors = 0;
+	int failures = 0;
+	vector<HumNum> times1;
+	vector<HumNum> times2;
+	for (int i=0; i<(int)files.size(); i++) {
+		bool status2 = files[i]->byTrack();
+		string error2 = files[i]->getParseError();
+		files[i]->getTimes(times2);
+		bool status1 = files[i]->sweep();
+		string error1 = files[i]->getParseError();
+		files[i]->getTimes(times1);
+		if (status1 != status2) {
+			cerr << names[i] << ": sweep " << (status1 ? "succeeded" : "failed")
+			     << " but by-track " << (status2 ? "succeeded" : "failed") << endl;
+			cerr << error1 << error2;
+			errors++;
+			continue;
+		}
+		if (!status1) {
+			failures++;
+			continue;
+		}
+		for (int j=0; j<(int)times1.size(); j++) {
+			if (times1[j] != times2[j]) {
+				cerr << names[i] << ": line " << (j+1) << " starts at " << times1[j]
+				     << " (sweep) and " << times2[j] << " (by-track)" << endl;
+				errors++;
+				break;
+			}
+		}
+	}
+
+	double ms1 = 0.0;
+	double ms2 = 0.0;
+	int lines = 0;
+	for (int i=0; i<(int)files.size(); i++) {
+		lines += files[i]->getLineCount();
+		ms2 += timeMethod(*files[i], false, count);
+		ms1 += timeMethod(*files[i], true, count);
+		if (options.getArgCount() == 0) {
+			cout << names[i] << "\tlines " << files[i]->getLineCount() << endl;
+			cout << "\tby-track:\t" << timeMethod(*files[i], false, count) << " ms" << endl;
+			cout << "\tsweep:\t\t" << timeMethod(*files[i], true, count) << " ms" << endl;
+		}
+	}
+	cout << "files: " << files.size() << "\tlines: " << lines
+	     << "\tparse errors (both methods): " << failures << endl;
+	cout << "by-track total:\t" << ms2 << " ms" << endl;
+	cout << "sweep total:\t" << ms1 << " ms" << endl;
+
+	for (auto file : files) {
+		delete file;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// timeMethod -- Return the average time in milliseconds for one method.
+//
+
+double timeMethod(RhythmFile& infile, bool sweepQ, int count) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		if (sweepQ) {
+			infile.sweep();
+		} else {
+			infile.byTrack();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / count;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a four-track score in which each track is split
+//    into 2^depth subspines in every measure and merged again at the end
+//    of the measure.
+//
+
+void makeScore(stringstream& out, int measures, int depth) {
+	int tracks = 4;
+	out << "**kern\t**kern\t**kern\t**kern\n";
+	out << "*M4/4\t*M4/4\t*M4/4\t*M4/4\n";
+	for (int m=1; m<=measures; m++) {
+		int width = 1;
+		for (int d=0; d<depth; d++) {
+			for (int i=0; i<tracks * width; i++) {
+				out << (i ? "\t" : "") << "*^";
+			}
+			out << "\n";
+			width *= 2;
+		}
+		for (int beat=0; beat<4; beat++) {
+			for (int i=0; i<tracks * width; i++) {
+				out << (i ? "\t" : "");
+				if (i % 3 == 0) {
+					out << "4c";
+				} else if (i % 3 == 1) {
+					out << ((beat % 2 == 0) ? "2e" : ".");
+				} else {
+					out << ((beat == 0) ? "1g" : ".");
+				}
+			}
+			out << "\n";
+		}
+		if (depth > 0) {
+			// Merge one track at a time, since adjacent *v tokens in
+			// different tracks would be merged together:
+			for (int t=0; t<tracks; t++) {
+				for (int i=0; i<t; i++) {
+					out << (i ? "\t" : "") << "*";
+				}
+				for (int i=0; i<width; i++) {
+					out << ((t || i) ? "\t" : "") << "*v";
+				}
+				for (int i=t+1; i<tracks; i++) {
+					for (int k=0; k<width; k++) {
+						out << "\t*";
+					}
+				}
+				out << "\n";
+			}
+		}
+		for (int i=0; i<tracks; i++) {
+			out << (i ? "\t" : "") << "=" << m;
+		}
+		out << "\n";
+	}
+	for (int i=0; i<tracks; i++) {
+		out << (i ? "\t" : "") << "*-";
+	}
+	out << "\n";
+}
+
+
+
+//////////////////////////////
+//
+// RhythmFile::oldAssignDurations -- Assign the durationFromStart of lines
+//     by following each rhythmic spine through its next-token links
+//     (recursively for split spines).  This is the algorithm which
+//     HumdrumFileStructure used before assignDurationsFromStart(), kept
+//     here as the reference for comparison.
+//
+
+bool RhythmFile::oldAssignDurations(void) {
+	int startline = getTrackStart(1)->getLineIndex();
+	int testline;
+	HumNum zero(0);
+
+	int i;
+	for (int i=1; i<=getMaxTrack(); i++) {
+		if (!getTrackStart(i)->hasRhythm()) {
+			// Can't analyze rhythm of spines that do not have rhythm.
+			continue;
+		}
+		testline = getTrackStart(i)->getLineIndex();
+		if (testline == startline) {
+			if (!oldAssignDurationsToTrack(getTrackStart(i), zero)) {
+				return false;
+			}
+		} else {
+			// Spine does not start at beginning of data, so
+			// the starting position of the spine has to be
+			// determined before continuing.  Search for a token
+			// which is on a line with assigned duration, then work
+			// outwards from that position.
+			continue;
+		}
+	}
+
+	// Go back and analyze spines that do not start at the
+	// beginning of the data stream.
+	for (i=1; i<=getMaxTrack(); i++) {
+		if (!getTrackStart(i)->hasRhythm()) {
+			// Can't analyze rhythm of spines that do not have rhythm.
+			continue;
+		}
+		testline = getTrackStart(i)->getLineIndex();
+		if (testline > startline) {
+			if (!oldRhythmOfFloatingSpine(getTrackStart(i))) { return false; }
+		}
+	}
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RhythmFile::oldAssignDurationsToTrack -- Assign duration from starts
+//    for each rhythmic spine in the file.  Analysis is done recursively, one
+//    sub-spine at a time.  Duplicate analyses are prevented by the state
+//    variable in the HumdrumToken (currently called rhycheck because it is only
+//    used in this function).  After the durationFromStarts have been assigned
+//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
+//    done elsewhere.
+//
+
+bool RhythmFile::oldAssignDurationsToTrack(HTp starttoken,
+		HumNum startdur) {
+	if (!starttoken->hasRhythm()) {
+		return isValid();
+	}
+	int state = visits(starttoken);
+	if (!oldPrepareDurations(starttoken, state, startdur)) {
+		return isValid();
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// RhythmFile::oldPrepareDurations -- Helper function for
+//     RhythmFile::oldAssignDurationsToTrack() which does all of the
+//     work for assigning durationFromStart values.
+//
+
+bool RhythmFile::oldPrepareDurations(HTp token, int state,
+		HumNum startdur) {
+	if (state != visits(token)) {
+		return isValid();
+	}
+
+	HumNum dursum = startdur;
+	visits(token)++;
+
+	if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
+	if (token->getDuration().isPositive()) {
+		dursum += token->getDuration();
+	}
+	int tcount = token->getNextTokenCount();
+
+	vector<HTp> reservoir;
+	vector<HumNum> startdurs;
+
+	// Assign line durationFromStarts for primary track first.
+	while (tcount > 0) {
+		for (int t=1; t<tcount; t++) {
+			reservoir.push_back(token->getNextToken(t));
+			startdurs.push_back(dursum);
+		}
+		token = token->getNextToken(0);
+		if (state != visits(token)) {
+			break;
+		}
+		visits(token)++;
+		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
+		if (token->getDuration().isPositive()) {
+			dursum += token->getDuration();
+		}
+		tcount = token->getNextTokenCount();
+	}
+
+	if ((tcount == 0) && (token->isTerminateInterpretation())) {
+		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
+	}
+
+	// Process secondary tracks next:
+	int newstate = state;
+
+	for (int i=(int)reservoir.size()-1; i>=0; i--) {
+		oldPrepareDurations(reservoir[i], newstate, startdurs[i]);
+	}
+
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// RhythmFile::oldRhythmOfFloatingSpine --  This analysis
+//    function is used to analyze the rhythm of spines which do not start at
+//    the beginning of the data.  The function searches for the first line
+//    which has an assigned durationFromStart value, and then uses that
+//    as the basis for assigning the initial durationFromStart position
+//    for the spine.
+//
+
+bool RhythmFile::oldRhythmOfFloatingSpine(
+		HTp spinestart) {
+	HumNum dursum = 0;
+	HumNum founddur = 0;
+	HTp token = spinestart;
+	int tcount = token->getNextTokenCount();
+
+	// Find a known durationFromStart for a line in the Humdrum file, then
+	// use that to calculate the starting duration of the floating spine.
+	if (token->getDurationFromStart().isNonNegative()) {
+		founddur = token->getLine()->getDurationFromStart();
+	} else {
+		tcount = token->getNextTokenCount();
+		while (tcount > 0) {
+			if (token->getDurationFromStart().isNonNegative()) {
+				founddur = token->getLine()->getDurationFromStart();
+				break;
+			}
+			if (token->getDuration().isPositive()) {
+				dursum += token->getDuration();
+			}
+			token = token->getNextToken(0);
+		}
+	}
+
+	if (founddur.isZero()) {
+		return setParseError("Error cannot link floating spine to score.");
+	}
+
+	if (!oldAssignDurationsToTrack(spinestart, founddur - dursum)) {
+		return isValid();
+	}
+
+	return isValid();
+}
+
+
+
@@ -0,0 +1,161 @@
+// Description: Check and benchmark reading segments of a concatenated
+//              Humdrum file with a HumSegmentIndex.  Every segment read
+//              with a direct seek (by index and by name) is compared with
+//              the same segment read from the start of the file with
+//              HumdrumFileStream.  Then the time to read the last segment
+//              and all segments is compared for the stream and the index.
+//              The default input file, concatenated.krn in this directory,
+//              contains the files in tests/files, mostly concatenated
+//              without !!!!SEGMENT: records.
+//
+// Usage:       test-segmentindex [-j threads] [-n count] [file.krn]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("j|jobs|threads=i:4", "number of threads for reading all segments");
+	options.define("n|count=i:3", "number of runs for each method");
+	options.define("r|references=b", "store reference keys in the index");
+	options.process(argc, argv);
+	int threads = options.getInteger("threads");
+	int count = options.getInteger("count");
+	if ((options.getArgCount() > 1) || (count < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-j threads] [-n count] [file.krn]" << endl;
+		return 1;
+	}
+	string filename = "tests/test-segmentindex/concatenated.krn";
+	if (options.getArgCount() == 1) {
+		filename = options.getArg(1);
+	}
+	vector<string> filelist(1, filename);
+
+	auto start = std::chrono::steady_clock::now();
+	HumSegmentIndex index;
+	index.build(filename, options.getBoolean("references"));
+	auto stop = std::chrono::steady_clock::now();
+	double buildtime = std::chrono::duration<double, std::milli>(stop - start).count();
+	index.writeIndex(HumSegmentIndex::getIndexFilename(filename));
+
+	start = std::chrono::steady_clock::now();
+	HumSegmentIndex sidecar;
+	sidecar.load(filename);
+	stop = std::chrono::steady_clock::now();
+	double loadtime = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	int errors = 0;
+	if (sidecar.getSize() != index.getSize()) {
+		cerr << "ERROR: sidecar has " << sidecar.getSize() << " segments instead of "
+		     << index.getSize() << endl;
+		errors++;
+	}
+
+	// Compare the indexed reads with reading the file from the start:
+	HumdrumFileStream instream(filelist);
+	HumdrumFileStream seekstream;
+	seekstream.loadSegmentIndex(filename);
+	HumdrumFile infile;
+	HumdrumFile segment;
+	int i = 0;
+	while (instream.read(infile)) {
+		if (i >= index.getSize()) {
+			cerr << "ERROR: more segments in the file than in the index" << endl;
+			errors++;
+			break;
+		}
+		stringstream expected;
+		expected << infile;
+		seekstream.readSegment(segment, i);
+		stringstream actual;
+		actual << segment;
+		if (actual.str() != expected.str()) {
+			cerr << "ERROR: segment " << i << " (" << index.getName(i) << ") differs" << endl;
+			errors++;
+		}
+		if (segment.getFilename() != infile.getFilename()) {
+			cerr << "ERROR: segment " << i << " is named " << segment.getFilename()
+			     << " instead of " << infile.getFilename() << endl;
+			errors++;
+		}
+		if (!index.getName(i).empty() && (index.getSegment(index.getName(i)) == i)) {
+			seekstream.readSegment(segment, index.getName(i));
+			stringstream named;
+			named << segment;
+			if (named.str() != expected.str()) {
+				cerr << "ERROR: segment " << index.getName(i) << " differs when read by name" << endl;
+				errors++;
+			}
+		}
+		i++;
+	}
+	if (i != index.getSize()) {
+		cerr << "ERROR: " << i << " segments in the file instead of " << index.getSize() << endl;
+		errors++;
+	}
+	cout << "segments: " << index.getSize() << "\terrors: " << errors << endl;
+	cout << "build\t" << buildtime << " ms" << endl;
+	cout << "sidecar\t" << loadtime << " ms" << endl;
+	if (index.getSize() == 0) {
+		return errors ? 1 : 0;
+	}
+
+	// Time to read the last segment:
+	double total = 0.0;
+	for (int j=0; j<count; j++) {
+		start = std::chrono::steady_clock::now();
+		HumdrumFileStream stream(filelist);
+		for (int k=0; k<index.getSize(); k++) {
+			stream.read(infile);
+		}
+		stop = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+	cout << "last/stream\t" << (total / count) << " ms" << endl;
+
+	total = 0.0;
+	for (int j=0; j<count; j++) {
+		start = std::chrono::steady_clock::now();
+		HumdrumFileStream stream;
+		stream.loadSegmentIndex(filename);
+		stream.readSegment(infile, index.getSize() - 1);
+		stop = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+	cout << "last/index\t" << (total / count) << " ms" << endl;
+
+	// Time to read all segments:
+	total = 0.0;
+	for (int j=0; j<count; j++) {
+		start = std::chrono::steady_clock::now();
+		HumdrumFileSet infiles;
+		HumdrumFileStream stream(filelist);
+		infiles.read(stream);
+		stop = std::chrono::steady_clock::now();
+		total += std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+	cout << "all/stream\t" << (total / count) << " ms" << endl;
+
+	for (int t=1; t<=threads; t*=2) {
+		total = 0.0;
+		for (int j=0; j<count; j++) {
+			start = std::chrono::steady_clock::now();
+			HumdrumFileSet infiles;
+			infiles.readSegments(sidecar, t);
+			stop = std::chrono::steady_clock::now();
+			total += std::chrono::duration<double, std::milli>(stop - start).count();
+			if (infiles.getCount() != index.getSize()) {
+				cerr << "ERROR: read " << infiles.getCount() << " segments with "
+				     << t << " threads" << endl;
+				errors++;
+			}
+		}
+		cout << "all/index -j" << t << "\t" << (total / count) << " ms" << endl;
+	}
+
+	return errors ? 1 : 0;
+}
+
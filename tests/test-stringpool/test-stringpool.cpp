@@ -0,0 +1,122 @@
+// Description: Measure how much memory a HumStringPool would save for the
+//              token text of a HumdrumFileSet.  The input files are read
+//              repeatedly until the set has the requested number of files.
+//              Token text that fits in the small-string buffer of
+//              std::string is stored inside of the HumdrumToken object, so
+//              only longer text is stored on the heap, and only duplicate
+//              copies of that text can be saved by pooling.  The pool is
+//              also filled by several threads at once to check that equal
+//              strings are given the same pointer.
+//
+// Usage:       test-stringpool [-c files] [-j threads] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("c|count=i:10000", "number of files in the set");
+	options.define("j|jobs|threads=i:4", "number of threads filling the pool");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	int threads = options.getInteger("threads");
+	if ((options.getArgCount() < 1) || (count < 1) || (threads < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-c files] [-j threads] file.krn [file2.krn ...]" << endl;
+		return 1;
+	}
+
+	HumdrumFileSet infiles;
+	while (infiles.getCount() < count) {
+		int oldcount = infiles.getCount();
+		for (int i=0; (i<options.getArgCount()) && (infiles.getCount() < count); i++) {
+			infiles.readAppendFile(options.getArg(i+1));
+		}
+		if (infiles.getCount() == oldcount) {
+			cerr << "Error: no data in input files" << endl;
+			return 1;
+		}
+	}
+
+	size_t ssosize = string().capacity();
+	vector<HTp> tokens;
+	size_t linecount = 0;
+	size_t linebytes = 0;
+	size_t heaptokens = 0;
+	size_t heapbytes = 0;
+	for (int i=0; i<infiles.getCount(); i++) {
+		HumdrumFile& infile = infiles[i];
+		for (int j=0; j<infile.getLineCount(); j++) {
+			linecount++;
+			const string& line = infile[j];
+			if (line.capacity() > ssosize) {
+				linebytes += line.capacity() + 1;
+			}
+			for (int k=0; k<infile[j].getFieldCount(); k++) {
+				HTp token = infile.token(j, k);
+				tokens.push_back(token);
+				if (token->capacity() > ssosize) {
+					heaptokens++;
+					heapbytes += token->capacity() + 1;
+				}
+			}
+		}
+	}
+
+	// Intern the token text from several threads:
+	HumStringPool pool;
+	vector<const string*> pointers(tokens.size(), NULL);
+	std::atomic<int> next(0);
+	int blocksize = 1024;
+	auto internTokens = [&]() {
+		int block;
+		while ((block = next++) * blocksize < (int)tokens.size()) {
+			int end = std::min((int)tokens.size(), (block + 1) * blocksize);
+			for (int i=block * blocksize; i<end; i++) {
+				pointers[i] = pool.intern(*tokens[i]);
+			}
+		}
+	};
+	auto start = std::chrono::steady_clock::now();
+	vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(internTokens);
+	}
+	internTokens();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+	auto stop = std::chrono::steady_clock::now();
+	double interntime = std::chrono::duration<double, std::milli>(stop - start).count();
+
+	int errors = 0;
+	size_t pooledheap = 0;
+	std::unordered_set<const string*> seen;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		if ((pointers[i] == NULL) || (*pointers[i] != *tokens[i]) ||
+				(pool.find(*tokens[i]) != pointers[i])) {
+			errors++;
+			continue;
+		}
+		if ((tokens[i]->capacity() > ssosize) && seen.insert(pointers[i]).second) {
+			pooledheap += pointers[i]->size() + 1;
+		}
+	}
+
+	cout << "files:\t" << infiles.getCount() << endl;
+	cout << "lines:\t" << linecount << endl;
+	cout << "tokens:\t" << tokens.size() << "\tdistinct: " << pool.getSize()
+	     << "\terrors: " << errors << endl;
+	cout << "token objects:\t" << tokens.size() * sizeof(HumdrumToken) << " bytes" << endl;
+	cout << "line text:\t" << linebytes << " bytes" << endl;
+	cout << "token text:\t" << heapbytes << " bytes in " << heaptokens
+	     << " tokens longer than " << ssosize << " characters" << endl;
+	cout << "pooled text:\t" << pooledheap << " bytes" << endl;
+	cout << "pool saving:\t" << (heapbytes > pooledheap ? heapbytes - pooledheap : 0)
+	     << " bytes" << endl;
+	cout << "intern time:\t" << interntime << " ms" << endl;
+
+	return errors ? 1 : 0;
+}
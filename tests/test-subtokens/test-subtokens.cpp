@@ -0,0 +1,358 @@
+// Description: Test and benchmark for HumSubtokenView.  For each input
+//              file (or a generated chord-heavy keyboard score if no files
+//              are given), the subtokens of every **kern token are compared
+//              with getSubtoken(), and the pitch and duration of each
+//              subtoken with the Convert functions for the subtoken string.
+//              Then the time to read the chord notes with getSubtokens() and
+//              the Convert functions is compared with the time to read them
+//              with the subtoken views, and the run time of the tools which
+//              use the views is measured.
+//
+// Usage:       test-subtokens [-n count] [-m measures] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+void   makeScore      (stringstream& out, int measures);
+int    checkToken     (HTp token);
+int    checkSeparators(void);
+void   oldBase40Pitches(HTp token, vector<int>& output);
+
+template <class TOOL>
+double timeTool(const vector<string>& argv, HumdrumFile& infile, int count) {
+	stringstream text;
+	text << infile;
+	auto start = std::chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		stringstream input(text.str());
+		HumdrumFile copy;
+		copy.read(input);
+		TOOL tool;
+		tool.process(argv);
+		tool.run(copy);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / count;
+}
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10", "number of traversals for timing");
+	options.define("m|measures=i:400", "measures in the generated score");
+	options.process(argc, argv);
+
+	vector<HumdrumFile*> files;
+	if (options.getArgCount() == 0) {
+		stringstream score;
+		makeScore(score, options.getInteger("measures"));
+		files.push_back(new HumdrumFile);
+		files.back()->read(score);
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			files.push_back(new HumdrumFile);
+			if (!files.back()->read(options.getArg(i))) {
+				cerr << "Cannot read " << options.getArg(i) << endl;
+				return 1;
+			}
+		}
+	}
+
+	vector<HTp> tokens;
+	int notecount = 0;
+	for (auto file : files) {
+		for (int i=0; i<file->getLineCount(); i++) {
+			if (!(*file)[i].isData()) {
+				continue;
+			}
+			for (int j=0; j<(*file)[i].getFieldCount(); j++) {
+				HTp token = (*file)[i].token(j);
+				if (token->isKern() && !token->isNull() && !token->empty()) {
+					tokens.push_back(token);
+					notecount += token->getSubtokenCount();
+				}
+			}
+		}
+	}
+
+	int errors = checkSeparators();
+	// Empty tokens (only found in malformed files) have no pitches:
+	HumdrumToken emptytoken;
+	if (!emptytoken.getBase40Pitches().empty()) {
+		cerr << "An empty token has base-40 pitches" << endl;
+		errors++;
+	}
+	for (HTp token : tokens) {
+		errors += checkToken(token);
+	}
+
+	// Time reading the pitch, duration and ties of every chord note:
+	int count = options.getInteger("count");
+	long long oldsum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int n=0; n<count; n++) {
+		for (HTp token : tokens) {
+			vector<string> subtokens = token->getSubtokens();
+			for (int i=0; i<(int)subtokens.size(); i++) {
+				oldsum += Convert::kernToBase40(subtokens[i]);
+				oldsum += Convert::recipToDuration(subtokens[i]).getNumerator();
+				oldsum += (subtokens[i].find("]") != string::npos) ? 1 : 0;
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double oldms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	long long viewsum = 0;
+	start = std::chrono::steady_clock::now();
+	for (int n=0; n<count; n++) {
+		for (HTp token : tokens) {
+			for (const HumSubtoken& subtoken : token->getSubtokenView()) {
+				viewsum += subtoken.contains('r') ? -1000 : subtoken.getBase40();
+				viewsum += subtoken.getDuration().getNumerator();
+				viewsum += subtoken.contains(']') ? 1 : 0;
+			}
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	double viewms = std::chrono::duration<double, std::milli>(end - start).count();
+	if (oldsum != viewsum) {
+		cerr << "Subtoken views read different values: " << viewsum
+		     << ", expected " << oldsum << endl;
+		errors++;
+	}
+
+	cout << "tokens: " << tokens.size() << "\tchord notes: " << notecount
+	     << "\ttraversals: " << count << endl;
+	cout << "getSubtokens:\t" << oldms << " ms" << endl;
+	cout << "subtoken views:\t" << viewms << " ms" << endl;
+
+	// Tools which read chord notes:
+	HumdrumFile& infile = *files[0];
+	vector<pair<string, double>> times = {
+		{ "homorhythm", timeTool<Tool_homorhythm>({"homorhythm"}, infile, count) },
+		{ "chord",      timeTool<Tool_chord>({"chord", "-u"}, infile, count)     },
+		{ "fb",         timeTool<Tool_fb>({"fb"}, infile, count)                 },
+		{ "vcross",     timeTool<Tool_vcross>({"vcross"}, infile, count)         }
+	};
+	cout << "tool run time (including reading the file):" << endl;
+	for (auto& item : times) {
+		cout << "\t" << item.first << ":\t" << item.second << " ms" << endl;
+	}
+
+	for (auto file : files) {
+		delete file;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkToken -- Compare the subtoken view of a token with getSubtoken(),
+//    and the pitch and duration of each subtoken with the Convert
+//    functions.
+//
+
+int checkToken(HTp token) {
+	int errors = 0;
+	HumSubtokenView view = token->getSubtokenView();
+	if (view.size() != token->getSubtokenCount()) {
+		cerr << "Token " << token << " has " << view.size() << " subtokens, expected "
+		     << token->getSubtokenCount() << endl;
+		return 1;
+	}
+	int index = 0;
+	for (const HumSubtoken& subtoken : view) {
+		string text = token->getSubtoken(index);
+		string problem;
+		if ((subtoken.getIndex() != index) || (subtoken.getString() != text)) {
+			problem = "text";
+		} else if (view[index].getText() != subtoken.getText()) {
+			problem = "indexed text";
+		} else if (Convert::recipToDuration(text) != subtoken.getDuration()) {
+			problem = "duration";
+		} else if (text.find('r') == string::npos) {
+			if (Convert::kernToBase40(text) != subtoken.getBase40()) {
+				problem = "base40";
+			} else if (Convert::kernToBase7(text) != subtoken.getBase7()) {
+				problem = "base7";
+			} else if (subtoken.hasPitch() &&
+					(Convert::kernToMidiNoteNumber(text) != subtoken.getMidiNoteNumber())) {
+				problem = "MIDI note number";
+			}
+		}
+		if (!problem.empty()) {
+			cerr << "Subtoken " << index << " of " << token << ": " << problem
+			     << " differs" << endl;
+			errors++;
+		}
+		index++;
+	}
+
+	vector<int> expected;
+	oldBase40Pitches(token, expected);
+	if (token->getBase40Pitches() != expected) {
+		cerr << "Base-40 pitches of " << token << " differ" << endl;
+		errors++;
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// checkSeparators -- Check subtokens for separators other than a space.
+//
+
+int checkSeparators(void) {
+	vector<pair<string, string>> tests = {
+		{"a;b;;c",  ";"},
+		{";a;",     ";"},
+		{"",        ";"},
+		{"x<>y<>z", "<>"},
+		{"abc",     ""},
+		{" 4c  4e ", " "}
+	};
+	int errors = 0;
+	for (auto& test : tests) {
+		HumdrumToken token(test.first);
+		HumSubtokenView view = token.getSubtokenView(test.second);
+		// (getSubtokenCount() does not handle an empty separator):
+		int count = (int)test.first.size();
+		if (!test.second.empty()) {
+			count = token.getSubtokenCount(test.second);
+		}
+		int index = 0;
+		bool same = view.size() == count;
+		for (const HumSubtoken& subtoken : view) {
+			same = same && (subtoken.getString() == token.getSubtoken(index, test.second));
+			same = same && (view[index].getText() == subtoken.getText());
+			index++;
+		}
+		if (!same || (index != count)) {
+			cerr << "Subtokens of \"" << test.first << "\" separated by \""
+			     << test.second << "\" differ" << endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// oldBase40Pitches -- The previous implementation of
+//    HumdrumToken::getBase40Pitches().
+//
+
+void oldBase40Pitches(HTp token, vector<int>& output) {
+	if (*token == ".") {
+		output.clear();
+		return;
+	}
+	vector<string> pieces = token->getSubtokens();
+	output.resize(pieces.size());
+	for (int i=0; i<(int)pieces.size(); i++) {
+		if (pieces[i].find("r") != string::npos) {
+			output[i] = 0;
+		} else {
+			output[i] = Convert::kernToBase40(pieces[i]);
+			if (pieces[i].find("_") != string::npos) {
+				output[i] = -output[i];
+			} else if (pieces[i].find("]") != string::npos) {
+				output[i] = -output[i];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a keyboard score with chords of up to five notes
+//    in each hand, ties, rests, grace notes, accidentals and beams.
+//
+
+void makeScore(stringstream& out, int measures) {
+	const char* lower[] = {"C", "D", "E-", "F", "G", "A", "B-", "c", "d", "e", "f#", "g"};
+	const char* upper[] = {"c", "d", "e", "f", "g", "a", "b", "cc", "dd", "ee-", "ff#", "gg"};
+	unsigned int seed = 12345;
+	auto next = [&seed](int range) {
+		seed = seed * 1103515245 + 12345;
+		return (int)((seed >> 16) % range);
+	};
+	// Random chord pitches (the same pitch may occur twice):
+	auto chord = [&](const char** pitches) {
+		vector<string> output;
+		int size = 1 + next(5);
+		for (int i=0; i<size; i++) {
+			output.push_back(pitches[(i * 2 + next(4)) % 12]);
+		}
+		return output;
+	};
+	// Chord token with a prefix and suffix for each note, and a beam
+	// on the first note:
+	auto text = [](const vector<string>& notes, const string& prefix,
+			const string& suffix, const string& beam) {
+		string output;
+		for (int i=0; i<(int)notes.size(); i++) {
+			if (i > 0) {
+				output += " ";
+			}
+			output += prefix + notes[i] + suffix;
+			if (i == 0) {
+				output += beam;
+			}
+		}
+		return output;
+	};
+
+	out << "!!!OTL: Generated keyboard score\n";
+	out << "**kern\t**kern\n";
+	out << "*staff2\t*staff1\n";
+	out << "*clefF4\t*clefG2\n";
+	out << "*M3/4\t*M3/4\n";
+	vector<string> tied;
+	for (int m=1; m<=measures; m++) {
+		out << "=" << m << "\t=" << m << "\n";
+		if (m % 7 == 0) {
+			out << ".\t8qcc#\n";
+		}
+		// beat 1:
+		if (!tied.empty()) {
+			out << text(chord(lower), "4", "", "") << "\t" << text(tied, "4", "]", "") << "\n";
+			tied.clear();
+		} else if (m % 5 == 0) {
+			out << text(chord(lower), "4", "", "") << "\t4r\n";
+		} else {
+			out << text(chord(lower), "4", "", "") << "\t" << text(chord(upper), "4", "", "") << "\n";
+		}
+		// beat 2:
+		out << text(chord(lower), "8", "", "L") << "\t" << text(chord(upper), "4", "", "") << "\n";
+		out << text(chord(lower), "8", "", "J") << "\t.\n";
+		// beat 3:
+		if (m % 4 == 0) {
+			tied = chord(upper);
+			out << text(chord(lower), "4", "", "") << "\t" << text(chord(upper), "8", "", "L") << "\n";
+			out << ".\t" << text(tied, "[8", "", "J") << "\n";
+		} else {
+			out << text(chord(lower), "4", "", "") << "\t" << text(chord(upper), "8", "", "L") << "\n";
+			out << ".\t" << text(chord(upper), "8", "", "J") << "\n";
+		}
+	}
+	out << "==\t==\n";
+	out << "*-\t*-\n";
+}
+
+
+
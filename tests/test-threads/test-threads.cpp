@@ -0,0 +1,306 @@
+// Description: Multi-threaded stress test for the library.  Each input
+//              file is loaded, analyzed and processed by a set of tools
+//              (plus a MusicXML conversion and HumInstrument lookups),
+//              first one job at a time to get the expected output, and
+//              then by several threads at once, each job using its own
+//              HumdrumFile and tool objects.  Any output which differs
+//              from the single-threaded output is reported.  Compile with
+//              ThreadSanitizer to check for data races ("make thread-test"
+//              does this and runs the test on tests/files/*.krn).
+//
+// Usage:       test-threads [-j threads] [-n rounds] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace hum;
+
+typedef string (*JobFunction)(const string& data);
+
+string analyzeFile       (const string& data);
+string runCmr            (const string& data);
+string runDeg            (const string& data);
+string runImitation      (const string& data);
+string runTandeminfo     (const string& data);
+string runTranspose      (const string& data);
+string runExtract        (const string& data);
+string runAutobeam       (const string& data);
+string runMsearch        (const string& data);
+string convertMusicXml   (const string& data);
+string lookupInstruments (const string& data);
+
+template <class TOOL>
+string runTool(const vector<string>& argv, const string& data) {
+	TOOL tool;
+	if (!tool.process(argv)) {
+		return "option error: " + tool.getError();
+	}
+	HumdrumFile infile;
+	infile.readString(data);
+	tool.run(infile);
+	stringstream output;
+	if (tool.hasAnyText()) {
+		tool.getAllText(output);
+	} else {
+		output << infile;
+	}
+	if (tool.hasError()) {
+		output << "error: " << tool.getError();
+	}
+	return output.str();
+}
+
+// Small two-part score for Tool_musicxml2hum (chord, tie, two voices,
+// lyric and dynamic):
+static const char* musicxml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<score-partwise version="3.1">
+<part-list>
+<score-part id="P1"><part-name>Flute</part-name></score-part>
+<score-part id="P2"><part-name>Piano</part-name></score-part>
+</part-list>
+<part id="P1">
+<measure number="1">
+<attributes><divisions>2</divisions><key><fifths>1</fifths></key>
+<time><beats>3</beats><beat-type>4</beat-type></time>
+<clef><sign>G</sign><line>2</line></clef></attributes>
+<direction placement="below"><direction-type><dynamics><p/></dynamics></direction-type></direction>
+<note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><voice>1</voice><type>quarter</type>
+<lyric number="1"><syllabic>single</syllabic><text>la</text></lyric></note>
+<note><pitch><step>A</step><octave>4</octave></pitch><duration>1</duration><voice>1</voice><type>eighth</type></note>
+<note><pitch><step>B</step><octave>4</octave></pitch><duration>1</duration><voice>1</voice><type>eighth</type></note>
+<note><pitch><step>C</step><octave>5</octave></pitch><duration>2</duration><tie type="start"/><voice>1</voice><type>quarter</type></note>
+</measure>
+<measure number="2">
+<note><pitch><step>C</step><octave>5</octave></pitch><duration>2</duration><tie type="stop"/><voice>1</voice><type>quarter</type></note>
+<note><rest/><duration>4</duration><voice>1</voice><type>half</type></note>
+<barline location="right"><bar-style>light-heavy</bar-style></barline>
+</measure>
+</part>
+<part id="P2">
+<measure number="1">
+<attributes><divisions>2</divisions><key><fifths>1</fifths></key>
+<time><beats>3</beats><beat-type>4</beat-type></time>
+<clef><sign>F</sign><line>4</line></clef></attributes>
+<note><pitch><step>G</step><octave>2</octave></pitch><duration>6</duration><voice>1</voice><type>half</type><dot/></note>
+<note><chord/><pitch><step>D</step><octave>3</octave></pitch><duration>6</duration><voice>1</voice><type>half</type><dot/></note>
+<backup><duration>6</duration></backup>
+<note><pitch><step>B</step><octave>3</octave></pitch><duration>2</duration><voice>2</voice><type>quarter</type></note>
+<note><pitch><step>A</step><octave>3</octave></pitch><duration>4</duration><voice>2</voice><type>half</type></note>
+</measure>
+<measure number="2">
+<note><pitch><step>C</step><octave>3</octave></pitch><duration>6</duration><voice>1</voice><type>half</type><dot/></note>
+<barline location="right"><bar-style>light-heavy</bar-style></barline>
+</measure>
+</part>
+</score-partwise>
+)";
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("j|threads=i:8", "number of threads");
+	options.define("n|rounds=i:10", "number of times each job is run in parallel");
+	options.process(argc, argv);
+	int threadcount = options.getInteger("threads");
+	int rounds = options.getInteger("rounds");
+	if ((options.getArgCount() == 0) || (threadcount < 1) || (rounds < 1)) {
+		cerr << "Usage: " << options.getCommand() << " [-j threads] [-n rounds] file.krn [file2.krn ...]" << endl;
+		return 1;
+	}
+
+	vector<pair<string, JobFunction>> functions = {
+		{ "analysis",     analyzeFile       },
+		{ "cmr",          runCmr            },
+		{ "deg",          runDeg            },
+		{ "imitation",    runImitation      },
+		{ "tandeminfo",   runTandeminfo     },
+		{ "transpose",    runTranspose      },
+		{ "extract",      runExtract        },
+		{ "autobeam",     runAutobeam       },
+		{ "msearch",      runMsearch        },
+		{ "instruments",  lookupInstruments }
+	};
+
+	// Each job is a function applied to the contents of an input file:
+	vector<string> names;
+	vector<string> inputs;
+	vector<JobFunction> jobs;
+	for (int i=1; i<=options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i))) {
+			cerr << "Cannot read " << options.getArg(i) << endl;
+			return 1;
+		}
+		stringstream text;
+		text << infile;
+		for (auto& function : functions) {
+			names.push_back(options.getArg(i) + ":" + function.first);
+			inputs.push_back(text.str());
+			jobs.push_back(function.second);
+		}
+	}
+	names.push_back("musicxml2hum");
+	inputs.push_back(musicxml);
+	jobs.push_back(convertMusicXml);
+
+	int jobcount = (int)jobs.size();
+	vector<string> expected(jobcount);
+	for (int i=0; i<jobcount; i++) {
+		expected[i] = jobs[i](inputs[i]);
+	}
+
+	// Interleave the jobs so that different tools run at the same time:
+	int total = jobcount * rounds;
+	atomic<int> next(0);
+	atomic<int> errors(0);
+	vector<atomic<int>> failures(jobcount);
+	auto work = [&]() {
+		int index;
+		while ((index = next++) < total) {
+			int job = (index * 7919) % jobcount;
+			if (jobs[job](inputs[job]) != expected[job]) {
+				failures[job] = 1;
+				errors++;
+			}
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	vector<thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(work);
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	for (int i=0; i<jobcount; i++) {
+		if (failures[i]) {
+			cerr << names[i] << ": output differs from single-threaded output" << endl;
+		}
+	}
+	cout << "jobs: " << jobcount << "\truns: " << total << "\tthreads: " << threadcount
+	     << "\ttime: " << std::chrono::duration<double, std::milli>(end - start).count()
+	     << " ms" << endl;
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// analyzeFile -- Load a file and run the content analyses which are not
+//     done automatically, then print the analyzed structure.
+//
+
+string analyzeFile(const string& data) {
+	HumdrumFile infile;
+	infile.readString(data);
+	infile.analyzeSlurs();
+	infile.analyzeKernTies();
+	infile.analyzeKernAccidentals();
+	infile.analyzeBeams();
+	infile.analyzeRestPositions();
+	stringstream output;
+	output << infile.getScoreDuration() << "\t" << infile.getStrandCount() << "\n";
+	infile.printJson(output, "", "");
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// Tool runners --
+//
+
+string runCmr(const string& data) {
+	return runTool<Tool_cmr>({"cmr", "-p"}, data);
+}
+
+string runDeg(const string& data) {
+	return runTool<Tool_deg>({"deg", "-t", "--octave", "--forced-key", "G"}, data);
+}
+
+string runImitation(const string& data) {
+	return runTool<Tool_imitation>({"imitation", "-n", "3"}, data);
+}
+
+string runTandeminfo(const string& data) {
+	return runTool<Tool_tandeminfo>({"tandeminfo"}, data);
+}
+
+string runTranspose(const string& data) {
+	return runTool<Tool_transpose>({"transpose", "-b", "-3"}, data);
+}
+
+string runExtract(const string& data) {
+	return runTool<Tool_extract>({"extract", "-i", "**kern"}, data);
+}
+
+string runAutobeam(const string& data) {
+	return runTool<Tool_autobeam>({"autobeam"}, data);
+}
+
+string runMsearch(const string& data) {
+	return runTool<Tool_msearch>({"msearch", "-p", "cde"}, data);
+}
+
+
+
+//////////////////////////////
+//
+// convertMusicXml -- Convert MusicXML data to Humdrum, with the parts
+//     parsed in parallel.
+//
+
+string convertMusicXml(const string& data) {
+	Tool_musicxml2hum converter;
+	converter.process({"musicxml2hum", "-j", "2"});
+	stringstream output;
+	converter.convert(output, data.c_str());
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// lookupInstruments -- Look up the instrument codes in a file, and check
+//     that a change to the instrument table of one HumInstrument does not
+//     affect other objects.
+//
+
+string lookupInstruments(const string& data) {
+	HumdrumFile infile;
+	infile.readString(data);
+	stringstream output;
+	HumInstrument local;
+	local.setGM("test", 12);
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (token->compare(0, 2, "*I") != 0) {
+				continue;
+			}
+			HumInstrument instrument(token->substr(2));
+			output << *token << "\t" << instrument.getGM() << "\t" << instrument.getName() << "\n";
+		}
+	}
+	HumInstrument fresh;
+	output << "local=" << local.getGM("*Itest") << "\tfresh=" << fresh.getGM("*Itest") << "\n";
+	output << "flute=" << fresh.getGM("*Iflt") << "\n";
+	return output.str();
+}
+
+
+
@@ -0,0 +1,476 @@
+// Description: Test and benchmark for Tool_timebase.  For each input file
+//              (or a generated orchestral movement if no files are given),
+//              the timebase expansion is compared with the previous
+//              implementation, and the expanded score is collapsed and
+//              compared with the input.  Grace-note lines are left out of
+//              the expansion, so they are removed from the input before
+//              comparing, and inputs with lines which are not a multiple
+//              of the timebase are not compared.  Null data lines of the
+//              input, "\r\n" line endings and scores with mixed tuplets
+//              are also checked.  Then the time to expand the score
+//              with each implementation, to read the expanded score and to
+//              collapse it (from the parsed file and from the text) is
+//              measured.
+//
+// Usage:       test-timebase [-t rhythm] [-m measures] [-s spines] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+void   makeScore      (stringstream& out, int measures, int spines);
+void   oldExpandScore (HumdrumFile& infile, HumNum mindur, ostream& out);
+HumNum oldMinimumTime (HumdrumFile& infile);
+string runTimebase    (HumdrumFile& infile, const vector<string>& argv);
+HumNum getTimebase    (const string& expanded);
+string removeLine     (const string& text, const string& prefix);
+int    checkSpecialCases(void);
+bool   getCollapsible (HumdrumFile& infile, HumNum mindur, string& output);
+int    compareText    (const string& name, const string& text, const string& expected);
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("t|timebase=s:128", "timebase rhythm for timing");
+	options.define("m|measures=i:300", "measures in the generated score");
+	options.define("s|spines=i:24", "spines in the generated score");
+	options.process(argc, argv);
+
+	vector<string> names;
+	vector<string> texts;
+	if (options.getArgCount() == 0) {
+		stringstream score;
+		makeScore(score, options.getInteger("measures"), options.getInteger("spines"));
+		texts.push_back(score.str());
+		names.push_back("generated");
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			HumdrumFile infile;
+			if (!infile.read(options.getArg(i))) {
+				cerr << "Cannot read " << options.getArg(i) << endl;
+				return 1;
+			}
+			stringstream text;
+			text << infile;
+			texts.push_back(text.str());
+			names.push_back(options.getArg(i));
+		}
+	}
+
+	int errors = 0;
+	string timebase = options.getString("timebase");
+	for (int i=0; i<(int)texts.size(); i++) {
+		HumdrumFile infile;
+		infile.readString(texts[i]);
+
+		// The minimum time unit of the file and a fixed timebase:
+		for (const string& rhythm : {string(""), timebase}) {
+			vector<string> argv = {"timebase"};
+			HumNum mindur = oldMinimumTime(infile);
+			if (!rhythm.empty()) {
+				argv.push_back("-t");
+				argv.push_back(rhythm);
+				mindur = Convert::recipToDuration(rhythm);
+			}
+			string expanded = runTimebase(infile, argv);
+			if (rhythm.empty()) {
+				// The tool uses the greatest common divisor of the line
+				// durations, which can be smaller than oldMinimumTime():
+				mindur = getTimebase(expanded);
+			}
+			stringstream expected;
+			oldExpandScore(infile, mindur, expected);
+			errors += compareText(names[i] + " expanded to " + Convert::durationToRecip(mindur),
+					removeLine(expanded, "!!timebased-nulls:"), expected.str());
+
+			string original;
+			if (!getCollapsible(infile, mindur, original)) {
+				continue;
+			}
+			HumdrumFile timebased;
+			timebased.readString(expanded);
+			string collapsed = runTimebase(timebased, {"timebase", "-c"});
+			errors += compareText(names[i] + " collapsed from " + Convert::durationToRecip(mindur),
+					collapsed, original);
+
+			// Collapsing the text without parsing it:
+			Tool_timebase tool;
+			tool.process(vector<string>{"timebase", "-c"});
+			stringstream output;
+			tool.run(expanded, output);
+			errors += compareText(names[i] + " text collapsed from " + Convert::durationToRecip(mindur),
+					output.str(), original);
+		}
+	}
+
+	errors += checkSpecialCases();
+
+	// Timing for the first file:
+	HumdrumFile infile;
+	infile.readString(texts[0]);
+	HumNum mindur = Convert::recipToDuration(timebase);
+
+	auto start = std::chrono::steady_clock::now();
+	stringstream oldoutput;
+	oldExpandScore(infile, mindur, oldoutput);
+	double oldms = elapsed(start);
+
+	start = std::chrono::steady_clock::now();
+	string expanded = runTimebase(infile, {"timebase", "-t", timebase});
+	double newms = elapsed(start);
+
+	start = std::chrono::steady_clock::now();
+	HumdrumFile timebased;
+	timebased.readString(expanded);
+	double readms = elapsed(start);
+
+	start = std::chrono::steady_clock::now();
+	string collapsed = runTimebase(timebased, {"timebase", "-c"});
+	double collapsems = elapsed(start);
+
+	start = std::chrono::steady_clock::now();
+	Tool_timebase tool;
+	tool.process(vector<string>{"timebase", "-c"});
+	stringstream textoutput;
+	tool.run(expanded, textoutput);
+	double textms = elapsed(start);
+
+	cout << "lines: " << infile.getLineCount() << "\tspines: " << infile.getMaxTrack()
+	     << "\ttimebased lines: " << timebased.getLineCount()
+	     << " (" << timebase << " timebase)" << endl;
+	cout << "previous expansion:\t" << oldms << " ms" << endl;
+	cout << "run-length expansion:\t" << newms << " ms" << endl;
+	cout << "reading expansion:\t" << readms << " ms" << endl;
+	cout << "collapse:\t\t" << collapsems << " ms" << endl;
+	cout << "text collapse:\t\t" << textms << " ms" << endl;
+
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// runTimebase -- Run the timebase tool and return its output.
+//
+
+string runTimebase(HumdrumFile& infile, const vector<string>& argv) {
+	Tool_timebase tool;
+	tool.process(argv);
+	tool.run(infile);
+	stringstream output;
+	tool.getAllText(output);
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// getTimebase -- Return the timebase from the marker at the end of the
+//    output of the timebase tool.
+//
+
+HumNum getTimebase(const string& expanded) {
+	HumRegex hre;
+	if (!hre.search(expanded, "!!timebased: ([^\\n]+)")) {
+		return 0;
+	}
+	return Convert::recipToDuration(hre.getMatch(1));
+}
+
+
+
+//////////////////////////////
+//
+// getCollapsible -- Store the input without the grace-note lines, which
+//    are lost when an expanded score is collapsed.  Returns false if a
+//    line does not last a multiple of the timebase, since the expansion
+//    adds warnings for such lines.
+//
+
+bool getCollapsible(HumdrumFile& infile, HumNum mindur, string& output) {
+	stringstream out;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			HumNum duration = infile[i].getDuration();
+			if (duration == 0) {
+				continue;
+			}
+			if ((duration / mindur).getDenominator() != 1) {
+				return false;
+			}
+		}
+		out << infile[i] << '\n';
+	}
+	output = out.str();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// removeLine -- Remove the first line which starts with the prefix.
+//
+
+string removeLine(const string& text, const string& prefix) {
+	size_t start = text.find("\n" + prefix);
+	if (start == string::npos) {
+		return text;
+	}
+	size_t end = text.find('\n', start + 1);
+	return text.substr(0, start) + (end == string::npos ? "\n" : text.substr(end));
+}
+
+
+
+//////////////////////////////
+//
+// checkSpecialCases -- Check that null data lines of the input are kept
+//    when collapsing, that text with "\r\n" line endings is collapsed,
+//    and that the minimum timebase is limited for a score with mixed
+//    tuplets.
+//
+
+int checkSpecialCases(void) {
+	int errors = 0;
+	string input =
+		"**kern\t**kern\n"
+		"2c\t2e\n"
+		".\t.\n"
+		"4d\t4f\n"
+		"=\t=\n"
+		".\t.\n"
+		"1e\t1g\n"
+		"*-\t*-\n";
+	HumdrumFile infile;
+	infile.readString(input);
+	string expanded = runTimebase(infile, {"timebase", "-t", "16"});
+	HumdrumFile timebased;
+	timebased.readString(expanded);
+	errors += compareText("null lines collapsed", runTimebase(timebased, {"timebase", "-c"}), input);
+
+	Tool_timebase tool;
+	tool.process(vector<string>{"timebase", "-c"});
+	stringstream output;
+	tool.run(expanded, output);
+	errors += compareText("null lines text collapsed", output.str(), input);
+
+	// "\r\n" line endings:
+	HumRegex hre;
+	string crlf = expanded;
+	hre.replaceDestructive(crlf, "\r\n", "\n", "g");
+	string expected = input;
+	hre.replaceDestructive(expected, "\r\n", "\n", "g");
+	Tool_timebase crlftool;
+	crlftool.process(vector<string>{"timebase", "-c"});
+	stringstream crlfoutput;
+	crlftool.run(crlf, crlfoutput);
+	errors += compareText("CRLF text collapsed", crlfoutput.str(), expected);
+
+	// Triplets, quintuplets and septuplets have a common timebase of a
+	// 840th note, so the 7th-note lines are used as the timebase instead:
+	stringstream tuplets;
+	tuplets << "**kern\t**kern\n";
+	vector<string> rhythms = {"12", "12", "12", "20", "20", "20", "20", "20",
+		"28", "28", "28", "28", "28", "28", "28", "8", "8"};
+	for (int i=0; i<(int)rhythms.size(); i++) {
+		tuplets << (i ? "." : "1C") << "\t" << rhythms[i] << "c\n";
+	}
+	tuplets << "*-\t*-\n";
+	infile.readString(tuplets.str());
+	expanded = runTimebase(infile, {"timebase"});
+	if (getTimebase(expanded) != HumNum(1, 7)) {
+		cerr << "Mixed tuplets expanded to " << Convert::durationToRecip(getTimebase(expanded))
+		     << " instead of 28" << endl;
+		errors++;
+	}
+	if (expanded.compare(0, 10, "!!Warning:") != 0) {
+		cerr << "No warning for the timebase of mixed tuplets" << endl;
+		errors++;
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// compareText -- Report the first line which differs in two texts.
+//
+
+int compareText(const string& name, const string& text, const string& expected) {
+	if (text == expected) {
+		return 0;
+	}
+	stringstream a(text);
+	stringstream b(expected);
+	string linea;
+	string lineb;
+	int line = 1;
+	while (getline(a, linea) && getline(b, lineb) && (linea == lineb)) {
+		line++;
+	}
+	cerr << name << ": line " << line << " differs:\n\t" << linea
+	     << "\n\texpected:\n\t" << lineb << endl;
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// oldExpandScore -- The previous implementation of
+//    Tool_timebase::expandScore() (with the default options).
+//
+
+void oldExpandScore(HumdrumFile& infile, HumNum mindur, ostream& out) {
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			out << infile[i] << endl;
+			continue;
+		}
+		HumNum duration = infile[i].getDuration();
+		if (duration == 0) {
+			continue;
+		}
+		HumNum count = duration / mindur;
+		if (count < 1) {
+			out << "!!Warning: following commented line was too short to be included in timebase output:\n";
+			out << "!! " << infile[i] << endl;
+			continue;
+		} else if (count.getDenominator() != 1) {
+			out << "!!Warning: next line does not have proper duration for representing with timebase: " << count.getFloat() << endl;
+		}
+		out << infile[i] << endl;
+		int repeats = int(count.getFloat()) - 1;
+		for (int j=0; j<repeats; j++) {
+			for (int k=0; k<infile[i].getFieldCount(); k++) {
+				out << ".";
+				if (k < infile[i].getFieldCount() - 1) {
+					out << "\t";
+				}
+			}
+			out << endl;
+		}
+	}
+	HumNum rhythm = Convert::durationToRecip(mindur);
+	out << "!!timebased: " << rhythm << endl;
+}
+
+
+
+//////////////////////////////
+//
+// oldMinimumTime -- The previous implementation of
+//    Tool_timebase::getMinimumTime(), which is the smallest line
+//    duration.  The timebase of the tool is now the greatest common
+//    divisor of the line durations, which is the same if the smallest
+//    duration divides all of the others.
+//
+
+HumNum oldMinimumTime(HumdrumFile& infile) {
+	HumNum minimum(0, 1);
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			continue;
+		}
+		HumNum duration = infile[i].getDuration();
+		if (minimum == 0) {
+			minimum = duration;
+			continue;
+		}
+		if (minimum > duration) {
+			minimum = duration;
+		}
+	}
+	return minimum;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate an orchestral movement in 4/4 with a different
+//    rhythm pattern in each spine and measure (down to 32nd notes).
+//
+
+void makeScore(stringstream& out, int measures, int spines) {
+	// Rhythm patterns which fill one beat:
+	vector<vector<string>> patterns = {
+		{"4"}, {"8", "8"}, {"16", "16", "16", "16"}, {"8.", "16"},
+		{"16", "8."}, {"8", "16", "16"}, {"32", "32", "16", "8"}
+	};
+	const char* pitches[] = {"c", "d", "e", "f", "g", "a", "b", "cc"};
+	unsigned int seed = 54321;
+	auto next = [&seed](int range) {
+		seed = seed * 1103515245 + 12345;
+		return (int)((seed >> 16) % range);
+	};
+
+	out << "!!!OTL: Generated orchestral movement\n";
+	for (int s=0; s<spines; s++) {
+		out << (s ? "\t" : "") << "**kern";
+	}
+	out << "\n";
+	for (int s=0; s<spines; s++) {
+		out << (s ? "\t" : "") << "*M4/4";
+	}
+	out << "\n";
+
+	for (int m=1; m<=measures; m++) {
+		for (int s=0; s<spines; s++) {
+			out << (s ? "\t" : "") << "=" << m;
+		}
+		out << "\n";
+		for (int beat=0; beat<4; beat++) {
+			// Onset times (in 32nd notes) of the notes in each spine:
+			vector<vector<pair<int, string>>> notes(spines);
+			vector<int> onsets;
+			for (int s=0; s<spines; s++) {
+				const vector<string>& pattern = patterns[next((int)patterns.size())];
+				int time = 0;
+				for (auto& rhythm : pattern) {
+					notes[s].emplace_back(time, rhythm + pitches[next(8)]);
+					onsets.push_back(time);
+					time += (Convert::recipToDuration(rhythm) * 8).getNumerator();
+				}
+			}
+			sort(onsets.begin(), onsets.end());
+			onsets.erase(unique(onsets.begin(), onsets.end()), onsets.end());
+			vector<int> index(spines, 0);
+			for (int time : onsets) {
+				for (int s=0; s<spines; s++) {
+					out << (s ? "\t" : "");
+					if ((index[s] < (int)notes[s].size()) && (notes[s][index[s]].first == time)) {
+						out << notes[s][index[s]++].second;
+					} else {
+						out << ".";
+					}
+				}
+				out << "\n";
+			}
+		}
+	}
+	for (int s=0; s<spines; s++) {
+		out << (s ? "\t" : "") << "==";
+	}
+	out << "\n";
+	for (int s=0; s<spines; s++) {
+		out << (s ? "\t" : "") << "*-";
+	}
+	out << "\n";
+}
+
+
+
@@ -0,0 +1,109 @@
+// Description: Report the memory used per token when reading Humdrum
+//              files.  The heap is measured by counting the bytes of
+//              all allocations that are still live after a file has been
+//              read and analyzed, so the result includes the token
+//              objects, their link lists and parameter data, as well as
+//              the line and file structures (divided over the tokens).
+//
+// Usage:       test-tokensize [-c] file.krn [file2.krn ...]
+
+#include "humlib.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+using namespace hum;
+
+static std::atomic<long long> liveBytes(0);
+
+// Store the size of each allocation in front of the memory block:
+static const size_t headerSize = 16;
+
+void* operator new(size_t size) {
+	void* block = malloc(size + headerSize);
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	*(size_t*)block = size;
+	liveBytes += size;
+	return (char*)block + headerSize;
+}
+
+void operator delete(void* ptr) noexcept {
+	if (!ptr) {
+		return;
+	}
+	void* block = (char*)ptr - headerSize;
+	liveBytes -= *(size_t*)block;
+	free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("c|content=b", "also do content analyses (slurs, ties, etc.)");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " [-c] file(s)" << endl;
+		return 1;
+	}
+	bool contentQ = options.getBoolean("content");
+
+	cout << "sizeof(HumdrumToken)  = " << sizeof(HumdrumToken) << endl;
+	cout << "sizeof(HumAddress)    = " << sizeof(HumAddress) << endl;
+	cout << "sizeof(HumTokenLinks) = " << sizeof(HumTokenLinks) << endl;
+	cout << "sizeof(HumdrumLine)   = " << sizeof(HumdrumLine) << endl;
+
+	long long totalBytes = 0;
+	long long totalTokens = 0;
+	for (int i=0; i<options.getArgCount(); i++) {
+		long long before = liveBytes;
+		HumdrumFile* infile = new HumdrumFile;
+		if (!infile->read(options.getArg(i+1))) {
+			return 1;
+		}
+		if (contentQ) {
+			infile->analyzeSlurs();
+			infile->analyzeKernTies();
+			infile->analyzeKernAccidentals();
+			infile->analyzeStrands();
+		}
+		long long bytes = liveBytes - before;
+		int tokens = 0;
+		for (int j=0; j<infile->getLineCount(); j++) {
+			tokens += (*infile)[j].getFieldCount();
+		}
+		delete infile;
+		totalBytes += bytes;
+		totalTokens += tokens;
+		if (options.getArgCount() > 1) {
+			cout << options.getArg(i+1) << "\t" << tokens << " tokens\t"
+			     << std::fixed << std::setprecision(1)
+			     << (tokens ? (double)bytes / tokens : 0.0) << " bytes/token" << endl;
+		}
+	}
+
+	cout << "TOTAL\t" << totalTokens << " tokens\t" << totalBytes << " bytes\t"
+	     << std::fixed << std::setprecision(1)
+	     << (totalTokens ? (double)totalBytes / totalTokens : 0.0)
+	     << " bytes/token" << endl;
+
+	return 0;
+}
@@ -0,0 +1,358 @@
+// Description: Test HumTrackView.  For each input file (or a generated
+//              score with spine splits if no files are given), the track
+//              sequences returned by getTrackSequence() (which now reads
+//              the track views) are compared with the previous
+//              implementation that scanned every line of the file, for
+//              every track and a set of filter options.  The views are
+//              also checked after lines are inserted into the file, and
+//              the time to traverse all tracks with views is compared
+//              with the time to build the sequences with the previous
+//              method.  The spine start views are compared with the
+//              spine start lists.
+//
+// Usage:       test-trackview [-n count] [-m measures] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+void makeScore       (stringstream& out, int measures);
+void oldTrackSequence(HumdrumFile& infile, vector<vector<HTp>>& sequence,
+                      int track, int options);
+int  checkFile       (HumdrumFile& infile, const string& name);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:20", "number of traversals for timing");
+	options.define("m|measures=i:500", "measures in the generated score");
+	options.process(argc, argv);
+
+	vector<string> names;
+	vector<HumdrumFile*> files;
+	if (options.getArgCount() == 0) {
+		stringstream score;
+		makeScore(score, options.getInteger("measures"));
+		files.push_back(new HumdrumFile);
+		files.back()->read(score);
+		names.push_back("generated");
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			files.push_back(new HumdrumFile);
+			if (!files.back()->read(options.getArg(i))) {
+				cerr << "Cannot read " << options.getArg(i) << endl;
+				return 1;
+			}
+			names.push_back(options.getArg(i));
+		}
+	}
+
+	int errors = 0;
+	for (int i=0; i<(int)files.size(); i++) {
+		errors += checkFile(*files[i], names[i]);
+	}
+
+	// Time a traversal of all tracks, counting note attacks:
+	int count = options.getInteger("count");
+	vector<vector<HTp>> sequence;
+	int oldcount = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int n=0; n<count; n++) {
+		for (auto file : files) {
+			for (int track=1; track<=file->getMaxTrack(); track++) {
+				oldTrackSequence(*file, sequence, track, OPT_ATTACKS);
+				for (auto& row : sequence) {
+					oldcount += (int)row.size();
+				}
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double oldms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	int viewcount = 0;
+	start = std::chrono::steady_clock::now();
+	for (int n=0; n<count; n++) {
+		for (auto file : files) {
+			for (int track=1; track<=file->getMaxTrack(); track++) {
+				for (HTp token : file->getTrackView(track, OPT_ATTACKS).tokens()) {
+					viewcount += token ? 1 : 0;
+				}
+			}
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	double viewms = std::chrono::duration<double, std::milli>(end - start).count();
+	if (oldcount != viewcount) {
+		cerr << "Views found " << viewcount << " tokens, expected " << oldcount << endl;
+		errors++;
+	}
+
+	cout << "files: " << files.size() << "\ttraversals: " << count << endl;
+	cout << "sequences:\t" << oldms << " ms\t(" << oldcount << " tokens)" << endl;
+	cout << "views:\t\t" << viewms << " ms\t(" << viewcount << " tokens)" << endl;
+
+	for (auto file : files) {
+		delete file;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkFile -- Compare the track sequences and views of a file with the
+//    previous implementation of getTrackSequence(), then again after
+//    inserting lines into the file.
+//
+
+int checkFile(HumdrumFile& infile, const string& name) {
+	vector<int> optionlist = {
+		0,
+		OPT_PRIMARY,
+		OPT_NOEMPTY,
+		OPT_NONULL,
+		OPT_NOINTERP,
+		OPT_NOMANIP | OPT_NOGLOBAL,
+		OPT_DATA,
+		OPT_DATA | OPT_NOEMPTY,
+		OPT_ATTACKS,
+		OPT_ATTACKS | OPT_PRIMARY,
+		OPT_NOCOMMENT | OPT_NOEMPTY | OPT_PRIMARY
+	};
+	int errors = 0;
+	vector<vector<HTp>> expected;
+	vector<vector<HTp>> sequence;
+	vector<HTp> primary;
+
+	for (int pass=0; pass<2; pass++) {
+		for (int track=1; track<=infile.getMaxTrack(); track++) {
+			for (int options : optionlist) {
+				oldTrackSequence(infile, expected, track, options);
+				infile.getTrackSequence(sequence, track, options);
+				if (sequence != expected) {
+					cerr << name << ": track " << track << " options " << options
+					     << " pass " << pass << ": sequence has " << sequence.size()
+					     << " rows, expected " << expected.size() << endl;
+					errors++;
+				}
+				infile.getPrimaryTrackSequence(primary, track, options);
+				bool same = primary.size() == expected.size();
+				for (int i=0; same && (i<(int)primary.size()); i++) {
+					same = primary[i] == expected[i][0];
+				}
+				if ((options & OPT_PRIMARY) && !same) {
+					cerr << name << ": track " << track << " options " << options
+					     << ": primary sequence differs" << endl;
+					errors++;
+				}
+				HumTrackView view = infile.getTrackView(track, options);
+				int tokencount = 0;
+				for (auto& row : expected) {
+					tokencount += (int)row.size();
+				}
+				int viewcount = 0;
+				for (HTp token : view.tokens()) {
+					viewcount += token ? 1 : 0;
+				}
+				if ((view.size() != (int)expected.size()) || (viewcount != tokencount)) {
+					cerr << name << ": track " << track << " options " << options
+					     << ": view has " << view.size() << " rows and " << viewcount
+					     << " tokens, expected " << expected.size() << " and "
+					     << tokencount << endl;
+					errors++;
+				}
+			}
+		}
+
+		// The kern spine starts:
+		vector<HTp> starts;
+		for (HTp start : infile.getKernSpineStartView()) {
+			starts.push_back(start);
+		}
+		vector<HTp> kernstarts;
+		for (int track=1; track<=infile.getMaxTrack(); track++) {
+			if (infile.getTrackStart(track)->isKern()) {
+				kernstarts.push_back(infile.getTrackStart(track));
+			}
+		}
+		if ((starts != kernstarts) || (infile.getKernSpineStartList() != kernstarts)) {
+			cerr << name << ": kern spine starts differ" << endl;
+			errors++;
+		}
+
+		// Iterators stay valid after their view is copied and destroyed:
+		starts.clear();
+		HumSpineStartView::iterator it;
+		HumSpineStartView::iterator end;
+		{
+			HumSpineStartView view = infile.getKernSpineStartView();
+			HumSpineStartView copy = view;
+			it = copy.begin();
+			end = copy.end();
+		}
+		for (; it != end; ++it) {
+			starts.push_back(*it);
+		}
+		if (starts != kernstarts) {
+			cerr << name << ": kern spine start iterators differ after the view was destroyed" << endl;
+			errors++;
+		}
+
+		// An empty data type gives no spines, and no data type gives all:
+		vector<HTp> list;
+		infile.getSpineStartList(list, "");
+		if (!infile.getSpineStartView("").empty() || !list.empty()) {
+			cerr << name << ": spine starts found for an empty data type" << endl;
+			errors++;
+		}
+		if (infile.getSpineStartView().size() != infile.getMaxTrack()) {
+			cerr << name << ": spine start view does not have all spines" << endl;
+			errors++;
+		}
+
+		// Insert lines for the second pass, which should be seen by the
+		// views without analyzing the file again:
+		if (pass == 0) {
+			infile.insertLine(1, "!! inserted global comment");
+			infile.insertLine(infile.getLineCount() - 1, "");
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// oldTrackSequence -- The previous implementation of
+//    HumdrumFileBase::getTrackSequence().
+//
+
+void oldTrackSequence(HumdrumFile& infile, vector<vector<HTp>>& sequence,
+		int track, int options) {
+	bool primaryQ   = (options & OPT_PRIMARY) ? true : false;
+	bool nonullQ    = (options & OPT_NONULL) ? true : false;
+	bool noemptyQ   = (options & OPT_NOEMPTY) ? true : false;
+	bool nointerpQ  = (options & OPT_NOINTERP) ? true : false;
+	bool nomanipQ   = (options & OPT_NOMANIP) ? true : false;
+	bool nocommentQ = (options & OPT_NOCOMMENT) ? true : false;
+	bool noglobalQ  = (options & OPT_NOGLOBAL) ? true : false;
+	bool norestQ    = (options & OPT_NOREST) ? true : false;
+	bool notieQ     = (options & OPT_NOTIE) ? true : false;
+
+	sequence.reserve(infile.getLineCount());
+	sequence.resize(0);
+	vector<HTp> tempout;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isEmpty()) {
+			continue;
+		}
+		tempout.resize(0);
+		if (!noglobalQ && (infile[i].isGlobal())) {
+			tempout.push_back(infile[i].token(0));
+			sequence.push_back(tempout);
+			continue;
+		}
+		if (noemptyQ) {
+			bool allNull = true;
+			for (int j=0; j<infile[i].getFieldCount(); j++) {
+				if (infile[i].token(j)->getTrack() != track) {
+					continue;
+				}
+				if (!infile[i].token(j)->isNull()) {
+					allNull = false;
+					break;
+				}
+			}
+			if (allNull) {
+				continue;
+			}
+		}
+		bool foundTrack = false;
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile[i].token(j);
+			if (token->getTrack() != track) {
+				continue;
+			}
+			if (primaryQ && foundTrack) {
+				continue;
+			}
+			foundTrack = true;
+			if (nointerpQ && (token->isManipulator() || token->isTerminator() ||
+					token->isExclusive())) {
+				continue;
+			}
+			if (nomanipQ && token->isManipulator()) {
+				continue;
+			}
+			if (nonullQ && token->isNull()) {
+				continue;
+			}
+			if (nocommentQ && token->isComment()) {
+				continue;
+			}
+			if (norestQ && token->isRest()) {
+				continue;
+			}
+			if (notieQ && token->isSecondaryTiedNote()) {
+				continue;
+			}
+			tempout.push_back(token);
+		}
+		if (tempout.size() > 0) {
+			sequence.push_back(tempout);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a four-spine score with a **text spine, spine
+//    splits in the second **kern spine, rests, ties, local comments
+//    and global comments.
+//
+
+void makeScore(stringstream& out, int measures) {
+	const char* pitches[] = {"c", "d", "e", "f", "g", "a", "b", "cc"};
+	out << "!!!OTL: Generated score\n";
+	out << "**kern\t**kern\t**text\t**dynam\n";
+	out << "*M4/4\t*M4/4\t*\t*\n";
+	for (int m=1; m<=measures; m++) {
+		out << "=" << m << "\t=" << m << "\t=" << m << "\t=" << m << "\n";
+		if (m % 10 == 0) {
+			out << "!! measure " << m << "\n";
+		}
+		if (m % 3 == 0) {
+			out << "*\t*^\t*\t*\n";
+			for (int n=0; n<4; n++) {
+				out << "4" << pitches[(m + n) % 8] << "\t4" << pitches[(m + n + 2) % 8]
+				    << "\t" << ((n % 2) ? "4r" : "4" + string(pitches[(n + 4) % 8]))
+				    << "\tla\t" << (n ? "." : "p") << "\n";
+				if (n == 1) {
+					out << "!\t!\t! split\t!\t!\n";
+				}
+			}
+			out << "*\t*v\t*v\t*\t*\n";
+		} else {
+			for (int n=0; n<4; n++) {
+				string tie = (n == 1) ? "[" : ((n == 2) ? "]" : "");
+				out << "4" << pitches[(m + n) % 8] << "\t" << tie << "4"
+				    << pitches[(m + 5) % 8] << tie << "\t" << ((n % 2) ? "." : "la")
+				    << "\t" << ((n == 3) ? "f" : ".") << "\n";
+			}
+		}
+	}
+	out << "==\t==\t==\t==\n";
+	out << "*-\t*-\t*-\t*-\n";
+}
+
+
+
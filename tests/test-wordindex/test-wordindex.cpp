@@ -0,0 +1,338 @@
+// Description: Test HumWordIndex.  For each input file (or a generated
+//              corpus of lyric files if no files are given), the word
+//              index is built, written into a single corpus index and read
+//              back.  Exact, prefix and wildcard lookups for every word in
+//              the corpus are compared with a scan of all words, and the
+//              index lookup time is compared with a case-insensitive
+//              regular-expression search of every word (the default
+//              msearch -t method).  Then msearch -t is run on the first
+//              file with the regular-expression search, with -w and with
+//              a word index file.
+//
+// Usage:       test-wordindex [-f files] [-w words] [file.krn ...]
+
+#include "humlib.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+using namespace hum;
+
+void makeFile       (stringstream& out, int number, int words);
+int  checkNormalize (void);
+int  checkMsearch   (HumdrumFile& infile);
+string runMsearch   (HumdrumFile& infile, const vector<string>& argv);
+int  compare        (const string& name, const string& query,
+                     vector<int>& matches, vector<int>& expected);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("f|files=i:200", "files in the generated corpus");
+	options.define("w|words=i:400", "words in each generated file");
+	options.process(argc, argv);
+
+	vector<HumdrumFile*> files;
+	if (options.getArgCount() == 0) {
+		for (int i=0; i<options.getInteger("files"); i++) {
+			stringstream data;
+			makeFile(data, i, options.getInteger("words"));
+			files.push_back(new HumdrumFile);
+			files.back()->read(data);
+			files.back()->setFilename("generated-" + to_string(i + 1) + ".krn");
+		}
+	} else {
+		for (int i=1; i<=options.getArgCount(); i++) {
+			files.push_back(new HumdrumFile);
+			if (!files.back()->read(options.getArg(i))) {
+				cerr << "Cannot read " << options.getArg(i) << endl;
+				return 1;
+			}
+		}
+	}
+
+	int errors = checkNormalize();
+
+	// Build the indexes and store them in one corpus index:
+	stringstream corpus;
+	int wordcount = 0;
+	for (int i=0; i<(int)files.size(); i++) {
+		HumWordIndex index(*files[i]);
+		wordcount += index.getSize();
+		index.writeIndex(corpus);
+	}
+	vector<HumWordIndex> indexes;
+	HumWordIndex index;
+	while (index.readIndex(corpus)) {
+		indexes.push_back(index);
+	}
+	if (indexes.size() != files.size()) {
+		cerr << "Read " << indexes.size() << " indexes from the corpus index, expected "
+		     << files.size() << endl;
+		return 1;
+	}
+
+	// Compare lookups with a scan of all words:
+	vector<int> matches;
+	vector<int> expected;
+	int queries = 0;
+	for (int i=0; i<(int)indexes.size(); i++) {
+		HumWordIndex& index = indexes[i];
+		const string& name = files[i]->getFilename();
+		if ((index.getName() != name) || (index.getLineCount() != files[i]->getLineCount())) {
+			cerr << name << ": index was read back with the wrong name or line count" << endl;
+			errors++;
+		}
+		for (int j=0; j<index.getSize(); j++) {
+			// The first syllable (without a hyphen) starts the word:
+			HTp token = index.getStartToken(*files[i], j);
+			string syllable = token ? token->getText() : "";
+			if (!syllable.empty() && (syllable.back() == '-')) {
+				syllable.pop_back();
+			}
+			if (!token || (index.getWord(j).compare(0, syllable.size(), syllable) != 0)) {
+				cerr << name << ": word " << index.getWord(j) << " does not start at token "
+				     << (token ? *token : "NULL") << endl;
+				errors++;
+			}
+			string key = index.getKey(j);
+			if (key.empty()) {
+				continue;
+			}
+			string prefix = key.substr(0, 2) + "*";
+			string wild = key;
+			wild[wild.size() / 2] = '?';
+			wild = "*" + wild.substr(1);
+
+			for (int k=0; k<3; k++) {
+				string query = (k == 0) ? index.getWord(j) : ((k == 1) ? prefix : wild);
+				expected.clear();
+				for (int m=0; m<index.getSize(); m++) {
+					const string& other = index.getKey(m);
+					if (other.empty()) {
+						continue;
+					}
+					if ((k == 0) && (other == key)) {
+						expected.push_back(m);
+					} else if ((k == 1) && (other.compare(0, 2, key, 0, 2) == 0)) {
+						expected.push_back(m);
+					} else if ((k == 2) && HumWordIndex::wildcardMatch(wild.c_str(), other.c_str())) {
+						expected.push_back(m);
+					}
+				}
+				index.find(matches, query);
+				errors += compare(name, query, matches, expected);
+				queries++;
+			}
+		}
+	}
+
+	// Time index lookups against a regular expression for each word:
+	vector<string> querywords = {"domine", "gloria", "sanctus", "xyzzy"};
+	int count = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto& word : querywords) {
+		for (auto& index : indexes) {
+			count += index.find(matches, word);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double indexms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	int rcount = 0;
+	HumRegex hre;
+	start = std::chrono::steady_clock::now();
+	for (auto& word : querywords) {
+		for (auto& index : indexes) {
+			for (int i=0; i<index.getSize(); i++) {
+				if (hre.search(index.getWord(i), "^" + word + "$", "i")) {
+					rcount++;
+				}
+			}
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	double regexms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	cout << "files: " << files.size() << "\twords: " << wordcount
+	     << "\tchecked queries: " << queries << endl;
+	cout << "index lookups:\t" << indexms << " ms\t(" << count << " matches)" << endl;
+	cout << "regex scan:\t" << regexms << " ms\t(" << rcount << " matches)" << endl;
+
+	errors += checkMsearch(*files[0]);
+
+	for (auto file : files) {
+		delete file;
+	}
+	cout << errors << " errors" << endl;
+	return errors ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// checkMsearch -- Check that msearch -t is a regular-expression search
+//    (so "omin" matches "Domine"), and that msearch -w gives the same
+//    result with and without a word index file.
+//
+
+int checkMsearch(HumdrumFile& infile) {
+	int errors = 0;
+	string nomatches = "!!@MATCHES:\t0\n";
+	string regex = runMsearch(infile, {"msearch", "-t", "omin"});
+	string word  = runMsearch(infile, {"msearch", "-w", "-t", "omin"});
+	if (regex.find(nomatches) != string::npos) {
+		cerr << "msearch -t omin did not mark any words" << endl;
+		errors++;
+	}
+	if (word.find(nomatches) == string::npos) {
+		cerr << "msearch -w -t omin marked part of a word" << endl;
+		errors++;
+	}
+
+	string indexfile = "test-wordindex.tmp";
+	ofstream output(indexfile);
+	HumWordIndex(infile).writeIndex(output);
+	output.close();
+	word = runMsearch(infile, {"msearch", "-w", "-t", "domine"});
+	string indexed = runMsearch(infile, {"msearch", "--index", indexfile, "-t", "domine"});
+	remove(indexfile.c_str());
+	if (word.find(nomatches) != string::npos) {
+		cerr << "msearch -w -t domine did not mark any words" << endl;
+		errors++;
+	}
+	if (indexed != word) {
+		cerr << "msearch --index does not match msearch -w" << endl;
+		errors++;
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// runMsearch -- Run msearch on a copy of a file.
+//
+
+string runMsearch(HumdrumFile& infile, const vector<string>& argv) {
+	stringstream text;
+	text << infile;
+	HumdrumFile copy;
+	copy.read(text);
+	copy.setFilename(infile.getFilename());
+	Tool_msearch msearch;
+	msearch.process(argv);
+	stringstream output;
+	msearch.run(copy, output);
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// compare -- Report a difference between index and scanned matches.
+//
+
+int compare(const string& name, const string& query, vector<int>& matches,
+		vector<int>& expected) {
+	if (matches == expected) {
+		return 0;
+	}
+	cerr << name << ": query \"" << query << "\" found " << matches.size()
+	     << " words, expected " << expected.size() << endl;
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// checkNormalize -- Check the normalization of some words.
+//
+
+int checkNormalize(void) {
+	vector<pair<string, string>> tests = {
+		{"D\xc3\xb3mine,",       "domine"},
+		{"Kyri&eacute;",         "kyrie"},
+		{"\xc5\x92uvre",         "oeuvre"},
+		{"Stra\xc3\x9f" "e",     "strasse"},
+		{"\xc3\x85ngstr\xc3\xb6m", "angstrom"},
+		{"\xe2\x80\x9c" "Ave\xe2\x80\x9d", "ave"},
+		{"e\xcc\x81l\xc3\xa8ve", "eleve"},
+		{"M\xc4\x85" "dro\xc5\x9b\xc4\x87", "madrosc"},
+		{"\xce\x9a\xcf\x8d\xcf\x81\xce\xb9\xce\xb5", "\xce\x9a\xcf\x8d\xcf\x81\xce\xb9\xce\xb5"}
+	};
+	int errors = 0;
+	for (auto& test : tests) {
+		string output = HumWordIndex::normalize(test.first);
+		if (output != test.second) {
+			cerr << "normalize(" << test.first << ") = " << output
+			     << ", expected " << test.second << endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+
+
+//////////////////////////////
+//
+// makeFile -- Generate a two-voice file with **text spines.  Words are
+//    made from a small syllable list and some are split into syllables.
+//
+
+void makeFile(stringstream& out, int number, int words) {
+	vector<string> lexicon = {"Do-mi-ne", "Glo-ri-a", "San-ctus", "De-us", "et",
+		"in", "ter-ra", "pax", "ho-mi-ni-bus", "Al-le-lu-ia", "Ky-ri-e", "e-le-i-son",
+		"Chri-ste", "B\xc3\xa9-n\xc3\xa9-dic-tus", "qui", "ve-nit", "no-mi-ne,", "A-men."};
+	out << "!!!OTL: Generated " << number + 1 << "\n";
+	out << "**kern\t**text\t**kern\t**text\n";
+	out << "*M4/4\t*\t*M4/4\t*\n";
+	vector<vector<string>> syllables(2);
+	for (int v=0; v<2; v++) {
+		for (int w=0; w<words; w++) {
+			const string& word = lexicon[(number * 7 + w * (v + 3)) % lexicon.size()];
+			size_t start = 0;
+			bool first = true;
+			while (start <= word.size()) {
+				size_t dash = word.find('-', start);
+				string syl = word.substr(start, dash == string::npos ? string::npos : dash - start);
+				string token = first ? syl : "-" + syl;
+				if (dash != string::npos) {
+					token += "-";
+				}
+				syllables[v].push_back(token);
+				first = false;
+				if (dash == string::npos) {
+					break;
+				}
+				start = dash + 1;
+			}
+		}
+	}
+	int notes = (int)max(syllables[0].size(), syllables[1].size());
+	for (int n=0; n<notes; n++) {
+		for (int v=0; v<2; v++) {
+			out << (v ? "\t" : "");
+			if (n < (int)syllables[v].size()) {
+				out << "4c\t" << syllables[v][n];
+			} else {
+				out << "4r\t.";
+			}
+		}
+		out << "\n";
+		if (n % 4 == 3) {
+			out << "=\t=\t=\t=\n";
+		}
+	}
+	out << "*-\t*-\t*-\t*-\n";
+}
+
+
+